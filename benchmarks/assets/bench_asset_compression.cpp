@@ -0,0 +1,253 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Compresses a made-up mix of assets (mesh vertex data, script and material
+// text, and texture data that is already block-compressed and so mostly
+// incompressible) with each codec level, then reports the ratio, compression
+// speed and decode speed on one core and across the job system, and the end
+// to end time to load every asset out of a pack stored raw and compressed.
+// Cold loads first ask the OS to drop the pack from the page cache, which
+// only Linux supports here.
+// Usage: AssetCompressionBenchmarks [megabytes] [directory]
+
+#include <cmath>      // For sinf, cosf
+#include <cstdint>    // For uint64_t
+#include <cstdio>     // For printf
+#include <cstdlib>    // For atoi, exit
+#include <cstring>    // For memcpy, strlen
+#include <filesystem> // For std::filesystem
+#include <random>     // For std::mt19937
+#include <string>     // For std::string
+#include <thread>     // For std::thread::hardware_concurrency
+#include <vector>     // For std::vector
+
+#if defined(__linux__)
+#include <fcntl.h>  // For open, posix_fadvise
+#include <unistd.h> // For close, fdatasync
+#endif
+
+#include "asset_compression.h"
+#include "asset_pack.h"
+#include "benchmark.h"
+#include "job_system.h"
+
+namespace fs = std::filesystem;
+using namespace toybox::assets;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static const int kRuns = 5;
+
+struct SourceAsset {
+    std::string name;
+    std::vector<uint8_t> bytes;
+};
+
+static bool Evict(const std::string& path) {
+#if defined(__linux__)
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+    fdatasync(descriptor);
+    bool ok = posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(descriptor);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+// Interleaved position, normal, uv and colour of a smooth surface
+static std::vector<uint8_t> MakeMesh(size_t size, std::mt19937& rng) {
+    std::vector<uint8_t> bytes(size);
+    size_t vertices = size / 36;
+    float phase = float(rng() % 1000) / 100.0f;
+    for (size_t v = 0; v < vertices; ++v) {
+        float u = float(v % 256) / 255.0f, w = float(v / 256) / 255.0f;
+        float vertex[9] = { u * 10.0f, sinf(u * 6.0f + phase) * cosf(w * 4.0f), w * 10.0f, 0.0f, 1.0f, 0.0f,
+                            u, w, 0.0f };
+        memcpy(bytes.data() + v * 36, vertex, 32);
+        uint32_t colour = 0xFF808080u;
+        memcpy(bytes.data() + v * 36 + 32, &colour, 4);
+    }
+    return bytes;
+}
+
+static std::vector<uint8_t> MakeText(size_t size, std::mt19937& rng) {
+    static const char* words[] = { "let ",     "fn ",      "return ", "if ",     "position", "velocity", "(",
+                                   ")",        "{\n    ",  "}\n",     " = ",     "0.25",     "albedo",   "roughness",
+                                   "metallic", "texture:", "\"",      "levels/", "props/",   ".mesh",    ";\n" };
+    std::vector<uint8_t> bytes;
+    while (bytes.size() < size) {
+        const char* word = words[rng() % (sizeof(words) / sizeof(words[0]))];
+        bytes.insert(bytes.end(), word, word + strlen(word));
+    }
+    bytes.resize(size);
+    return bytes;
+}
+
+// BC1-like: endpoint pairs that vary smoothly and index bits that are
+// close to random
+static std::vector<uint8_t> MakeTexture(size_t size, std::mt19937& rng) {
+    std::vector<uint8_t> bytes(size);
+    for (size_t b = 0; b + 8 <= size; b += 8) {
+        uint16_t endpoint = uint16_t(0x4208 + (b / 8 % 64) * 0x21);
+        memcpy(bytes.data() + b, &endpoint, 2);
+        memcpy(bytes.data() + b + 2, &endpoint, 2);
+        uint32_t indices = rng();
+        memcpy(bytes.data() + b + 4, &indices, 4);
+    }
+    return bytes;
+}
+
+static std::vector<SourceAsset> MakeAssets(size_t total) {
+    std::vector<SourceAsset> assets;
+    std::mt19937 rng(4242);
+    size_t made = 0;
+    for (int i = 0; made < total; ++i) {
+        SourceAsset asset;
+        switch (i % 3) {
+        case 0:
+            asset.name = "meshes/mesh_" + std::to_string(i) + ".mesh";
+            asset.bytes = MakeMesh(64 * 1024 + rng() % (1024 * 1024), rng);
+            break;
+        case 1:
+            asset.name = "scripts/script_" + std::to_string(i) + ".ember";
+            asset.bytes = MakeText(8 * 1024 + rng() % (256 * 1024), rng);
+            break;
+        default:
+            asset.name = "textures/texture_" + std::to_string(i) + ".dds";
+            asset.bytes = MakeTexture(128 * 1024 + rng() % (2 * 1024 * 1024), rng);
+            break;
+        }
+        made += asset.bytes.size();
+        assets.push_back(std::move(asset));
+    }
+    return assets;
+}
+
+static void MeasureCodec(const char* name, AssetCompression level, const std::vector<SourceAsset>& assets,
+                         JobSystem* jobs) {
+    size_t raw = 0, stored = 0;
+    std::vector<DynamicArray<uint8_t>> compressed(assets.size());
+    Stopwatch watch;
+    for (size_t i = 0; i < assets.size(); ++i) {
+        CompressAsset(assets[i].bytes.data(), assets[i].bytes.size(), level, &compressed[i]);
+        raw += assets[i].bytes.size();
+        stored += compressed[i].Size();
+    }
+    double compress_s = watch.ElapsedNs() / 1e9;
+
+    std::vector<uint8_t> destination;
+    auto decode_all = [&](JobSystem* with) {
+        for (size_t i = 0; i < assets.size(); ++i) {
+            CompressedAsset asset;
+            destination.resize(assets[i].bytes.size());
+            if (!asset.Open(compressed[i].Data(), compressed[i].Size()) || !asset.Decode(destination.data(), with)) {
+                printf("Decode failed\n");
+                exit(1);
+            }
+            DoNotOptimize(destination[0]);
+        }
+    };
+    decode_all(nullptr);
+    watch.Restart();
+    for (int run = 0; run < kRuns; ++run) decode_all(nullptr);
+    double serial_s = watch.ElapsedNs() / 1e9;
+    watch.Restart();
+    for (int run = 0; run < kRuns; ++run) decode_all(jobs);
+    double parallel_s = watch.ElapsedNs() / 1e9;
+
+    printf("  %-6s ratio %.3f, compress %7.1f MB/s, decode %5.2f GB/s on one core, %5.2f GB/s on %u threads\n", name,
+           double(stored) / double(raw), raw / 1048576.0 / compress_s, raw * double(kRuns) / 1e9 / serial_s,
+           raw * double(kRuns) / 1e9 / parallel_s, jobs->ThreadCount());
+}
+
+// Loads every asset out of the pack into a buffer of its own, the way a
+// level load hands them to their systems
+static double LoadPack(const std::string& path, const std::vector<SourceAsset>& assets, JobSystem* jobs,
+                       std::vector<std::vector<uint8_t>>* loaded) {
+    Stopwatch watch;
+    AssetPack pack;
+    if (!pack.Open(path.c_str())) exit(1);
+    for (size_t i = 0; i < assets.size(); ++i) {
+        AssetSpan span;
+        if (!pack.Find(assets[i].name.c_str(), assets[i].name.size(), &span)) exit(1);
+        (*loaded)[i].resize(size_t(span.raw_size));
+        if (!LoadAsset(span, (*loaded)[i].data(), jobs)) exit(1);
+    }
+    return watch.ElapsedMs();
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? size_t(atoi(argv[1])) : 128;
+    fs::path root = argc > 2 ? fs::path(argv[2]) : fs::temp_directory_path() / "toybox_compression_bench";
+    fs::remove_all(root);
+    fs::create_directories(root);
+
+    std::vector<SourceAsset> assets = MakeAssets(megabytes << 20);
+    uint32_t workers = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0;
+    JobSystem jobs;
+    jobs.Init(workers);
+    printf("%zu assets, %zu MB, %u threads\n", assets.size(), megabytes, jobs.ThreadCount());
+
+    Section("Codec, 128 KB blocks");
+    MeasureCodec("Fast", AssetCompression::Fast, assets, &jobs);
+    MeasureCodec("High", AssetCompression::High, assets, &jobs);
+
+    const AssetCompression levels[] = { AssetCompression::None, AssetCompression::Fast, AssetCompression::High };
+    const char* names[] = { "Raw", "Fast", "High" };
+    std::string paths[3];
+    for (int l = 0; l < 3; ++l) {
+        AssetPackWriter writer;
+        for (const SourceAsset& asset : assets) {
+            writer.Add(asset.name.c_str(), asset.bytes.data(), asset.bytes.size(), levels[l]);
+        }
+        paths[l] = (root / (std::string(names[l]) + ".pack")).string();
+        if (!writer.Write(paths[l].c_str())) {
+            printf("%s\n", writer.Error());
+            return 1;
+        }
+        printf("%s pack: %.1f MB\n", names[l], writer.PayloadSize() / 1048576.0);
+    }
+    if (!Evict(paths[0])) printf("Cannot drop files from the page cache here; cold loads are warm\n");
+
+    std::vector<std::vector<uint8_t>> loaded(assets.size());
+    Section("Load every asset, cold");
+    for (int l = 0; l < 3; ++l) {
+        double total = 0.0;
+        for (int run = 0; run < kRuns; ++run) {
+            Evict(paths[l]);
+            total += LoadPack(paths[l], assets, &jobs, &loaded);
+        }
+        printf("  %-6s %8.1f ms, %7.1f MB/s loaded\n", names[l], total / kRuns,
+               megabytes * 1000.0 * kRuns / total);
+    }
+    for (size_t i = 0; i < assets.size(); ++i) {
+        if (loaded[i] != assets[i].bytes) {
+            printf("%s loaded wrong\n", assets[i].name.c_str());
+            return 1;
+        }
+    }
+
+    Section("Load every asset, warm");
+    for (int l = 0; l < 3; ++l) {
+        LoadPack(paths[l], assets, &jobs, &loaded);
+        double total = 0.0;
+        for (int run = 0; run < kRuns; ++run) total += LoadPack(paths[l], assets, &jobs, &loaded);
+        printf("  %-6s %8.1f ms, %7.1f MB/s loaded\n", names[l], total / kRuns,
+               megabytes * 1000.0 * kRuns / total);
+    }
+
+    jobs.Shutdown();
+    fs::remove_all(root);
+    return 0;
+}
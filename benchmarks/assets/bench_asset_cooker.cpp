@@ -0,0 +1,320 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Cooks a made-up project of textures, meshes, scripts that include shared
+// headers, and materials that depend on the textures they use, then times
+// rebuilds from a fresh cooker each time, as a fresh run of a build tool
+// would: nothing changed, one texture changed, one shared header changed,
+// and everything from the cache after losing the manifest.
+// Usage: AssetCookerBenchmarks [asset_count] [directory]
+
+#include <algorithm>  // For std::sort
+#include <chrono>     // For std::chrono::hours
+#include <cstdint>    // For uint8_t, uint32_t, uint64_t
+#include <cstdio>     // For printf, fopen, fwrite, fclose
+#include <cstdlib>    // For atoi, exit
+#include <cstring>    // For memcpy, memcmp
+#include <filesystem> // For std::filesystem
+#include <random>     // For std::mt19937
+#include <string>     // For std::string
+#include <thread>     // For std::thread::hardware_concurrency
+#include <vector>     // For std::vector
+
+#include "asset_compression.h"
+#include "asset_cooker.h"
+#include "benchmark.h"
+#include "job_system.h"
+
+namespace fs = std::filesystem;
+using namespace toybox::assets;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static const int kRuns = 5;
+static const uint32_t kSharedHeaders = 50;
+static const uint32_t kTextureWidth = 64;
+
+struct ProjectAsset {
+    std::string name;
+    std::string source;
+    const char* processor;
+    std::string settings;
+    std::vector<std::string> dependencies;
+};
+
+static void Append(DynamicArray<uint8_t>* out, const void* data, size_t size) {
+    size_t at = out->Size();
+    out->Resize(at + size);
+    memcpy(out->Data() + at, data, size);
+}
+
+// A box-filtered mip chain of a greyscale image, compressed
+static bool CookTexture(CookContext* context) {
+    uint32_t width = kTextureWidth, height = uint32_t(context->SourceSize() / kTextureWidth);
+    std::vector<uint8_t> level(context->Source(), context->Source() + width * height);
+    std::vector<uint8_t> chain = level;
+    while (width > 1 && height > 1) {
+        std::vector<uint8_t> next((width / 2) * (height / 2));
+        for (uint32_t y = 0; y < height / 2; ++y) {
+            for (uint32_t x = 0; x < width / 2; ++x) {
+                const uint8_t* row = &level[(y * 2) * width + x * 2];
+                next[y * (width / 2) + x] = uint8_t((row[0] + row[1] + row[width] + row[width + 1] + 2) / 4);
+            }
+        }
+        chain.insert(chain.end(), next.begin(), next.end());
+        level.swap(next);
+        width /= 2;
+        height /= 2;
+    }
+    CompressAsset(chain.data(), chain.size(), AssetCompression::High, context->Output());
+    return true;
+}
+
+// Positions quantized to 16 bits within their bounds
+static bool CookMesh(CookContext* context) {
+    size_t count = context->SourceSize() / sizeof(float);
+    std::vector<float> values(count);
+    memcpy(values.data(), context->Source(), count * sizeof(float));
+    float low = *std::min_element(values.begin(), values.end());
+    float high = *std::max_element(values.begin(), values.end());
+    float scale = high > low ? 65535.0f / (high - low) : 0.0f;
+    Append(context->Output(), &low, sizeof(low));
+    Append(context->Output(), &high, sizeof(high));
+    for (float value : values) {
+        uint16_t quantized = uint16_t((value - low) * scale + 0.5f);
+        Append(context->Output(), &quantized, sizeof(quantized));
+    }
+    return true;
+}
+
+// The source with every "#include <path>" line replaced by the file
+static bool CookScript(CookContext* context) {
+    const char* text = reinterpret_cast<const char*>(context->Source());
+    size_t size = context->SourceSize(), line = 0;
+    while (line < size) {
+        size_t end = line;
+        while (end < size && text[end] != '\n') ++end;
+        if (end - line > 9 && memcmp(text + line, "#include ", 9) == 0) {
+            std::string path(text + line + 9, end - line - 9);
+            DynamicArray<uint8_t> included;
+            if (!context->ReadInput(path.c_str(), &included)) {
+                context->Fail("missing include");
+                return false;
+            }
+            Append(context->Output(), included.Data(), included.Size());
+        } else {
+            Append(context->Output(), text + line, end - line);
+        }
+        Append(context->Output(), "\n", 1);
+        line = end + 1;
+    }
+    return true;
+}
+
+// Its own parameters followed by the cooked size of each texture it
+// samples, named in its settings
+static bool CookMaterial(CookContext* context) {
+    Append(context->Output(), context->Source(), context->SourceSize());
+    std::string names = context->Settings();
+    for (size_t start = 0; start < names.size();) {
+        size_t end = names.find(',', start);
+        if (end == std::string::npos) end = names.size();
+        DynamicArray<uint8_t> texture;
+        if (!context->ReadDependency(names.substr(start, end - start).c_str(), &texture)) return false;
+        uint64_t size = texture.Size();
+        Append(context->Output(), &size, sizeof(size));
+        start = end + 1;
+    }
+    return true;
+}
+
+static void WriteFile(const std::string& path, const void* data, size_t size) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) {
+        printf("Could not write %s\n", path.c_str());
+        exit(1);
+    }
+    fwrite(data, 1, size, file);
+    fclose(file);
+}
+
+// Sources written long before the first build, as in a real checkout
+static void Age(const std::string& path) {
+    fs::last_write_time(path, fs::file_time_type::clock::now() - std::chrono::hours(24));
+}
+
+static std::vector<ProjectAsset> MakeProject(const fs::path& root, uint32_t count) {
+    std::mt19937 rng(5150);
+    fs::create_directories(root / "textures");
+    fs::create_directories(root / "meshes");
+    fs::create_directories(root / "scripts");
+    fs::create_directories(root / "materials");
+    fs::create_directories(root / "shared");
+
+    for (uint32_t h = 0; h < kSharedHeaders; ++h) {
+        std::string path = (root / "shared" / ("header_" + std::to_string(h) + ".ember")).string();
+        std::string text;
+        for (int line = 0; line < 40; ++line) text += "let shared_" + std::to_string(h * 100 + line) + " = 1;\n";
+        WriteFile(path, text.data(), text.size());
+        Age(path);
+    }
+
+    // Six in ten textures, two in ten meshes, one each scripts and materials
+    std::vector<ProjectAsset> assets;
+    uint32_t textures = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        ProjectAsset asset;
+        uint32_t kind = i % 10;
+        if (kind < 6) {
+            asset.name = "textures/t" + std::to_string(i);
+            asset.processor = "texture";
+            asset.source = (root / (asset.name + ".raw")).string();
+            std::vector<uint8_t> pixels(kTextureWidth * 128);
+            uint32_t base = rng() % 200;
+            for (size_t p = 0; p < pixels.size(); ++p) pixels[p] = uint8_t(base + (p % kTextureWidth) / 8 + rng() % 8);
+            WriteFile(asset.source, pixels.data(), pixels.size());
+            ++textures;
+        } else if (kind < 8) {
+            asset.name = "meshes/m" + std::to_string(i);
+            asset.processor = "mesh";
+            asset.source = (root / (asset.name + ".obj")).string();
+            std::vector<float> positions(1536);
+            for (size_t p = 0; p < positions.size(); ++p) positions[p] = float(rng() % 10000) / 100.0f;
+            WriteFile(asset.source, positions.data(), positions.size() * sizeof(float));
+        } else if (kind == 8) {
+            asset.name = "scripts/s" + std::to_string(i);
+            asset.processor = "script";
+            asset.source = (root / (asset.name + ".ember")).string();
+            std::string text;
+            for (int include = 0; include < 3; ++include) {
+                uint32_t header = rng() % kSharedHeaders;
+                text += "#include " + (root / "shared" / ("header_" + std::to_string(header) + ".ember")).string();
+                text += "\n";
+            }
+            for (int line = 0; line < 60; ++line) text += "fn f" + std::to_string(line) + "() { return 0; }\n";
+            WriteFile(asset.source, text.data(), text.size());
+        } else {
+            asset.name = "materials/mat" + std::to_string(i);
+            asset.processor = "material";
+            asset.source = (root / (asset.name + ".mat")).string();
+            std::string text = "roughness=0.5\nmetallic=0.0\n";
+            WriteFile(asset.source, text.data(), text.size());
+            // The two textures before it
+            asset.dependencies.push_back("textures/t" + std::to_string(i - 9));
+            asset.dependencies.push_back("textures/t" + std::to_string(i - 8));
+            asset.settings = asset.dependencies[0] + "," + asset.dependencies[1];
+        }
+        Age(asset.source);
+        assets.push_back(asset);
+    }
+    return assets;
+}
+
+// One run of the build tool: a fresh cooker declares the project and builds
+static double Build(const std::vector<ProjectAsset>& assets, const std::string& cache, JobSystem* jobs,
+                    CookStats* stats) {
+    Stopwatch watch;
+    AssetCooker cooker;
+    if (!cooker.Open(cache.c_str())) {
+        printf("%s\n", cooker.Error());
+        exit(1);
+    }
+    AssetProcessor processors[] = {
+        { "texture", 1, &CookTexture },
+        { "mesh", 1, &CookMesh },
+        { "script", 1, &CookScript },
+        { "material", 1, &CookMaterial },
+    };
+    for (const AssetProcessor& processor : processors) cooker.AddProcessor(processor);
+    std::vector<const char*> dependencies;
+    for (const ProjectAsset& asset : assets) {
+        dependencies.clear();
+        for (const std::string& dependency : asset.dependencies) dependencies.push_back(dependency.c_str());
+        cooker.Add(asset.name.c_str(), asset.source.c_str(), cooker.FindProcessor(asset.processor), asset.settings.c_str(),
+                   dependencies.data(), uint32_t(dependencies.size()));
+    }
+    if (!cooker.Build(jobs)) {
+        printf("%s\n", cooker.Error());
+        exit(1);
+    }
+    *stats = cooker.Stats();
+    return watch.ElapsedMs();
+}
+
+static void Print(const char* name, double ms, const CookStats& stats) {
+    printf("  %-28s %9.1f ms  (%u cooked, %u from cache, %u up to date, %u files hashed)\n", name, ms, stats.cooked,
+           stats.from_cache, stats.up_to_date, stats.files_hashed);
+}
+
+static double Median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? uint32_t(atoi(argv[1])) : 10000;
+    fs::path root = argc > 2 ? fs::path(argv[2]) : fs::temp_directory_path() / "toybox_cooker_bench";
+    fs::remove_all(root);
+    std::vector<ProjectAsset> assets = MakeProject(root / "project", count);
+    std::string cache = (root / "cache").string();
+
+    uint32_t workers = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0;
+    JobSystem jobs;
+    jobs.Init(workers);
+    printf("%u assets, %u shared headers, %u threads\n", count, kSharedHeaders, jobs.ThreadCount());
+
+    Section("Builds");
+    CookStats stats;
+    double ms = Build(assets, cache, &jobs, &stats);
+    Print("Full, empty cache", ms, stats);
+
+    // Let the sources settle outside the window in which stats are not
+    // trusted, then build once to take their hashes
+    Build(assets, cache, &jobs, &stats);
+    std::vector<double> runs;
+    for (int run = 0; run < kRuns; ++run) runs.push_back(Build(assets, cache, &jobs, &stats));
+    Print("Nothing changed", Median(runs), stats);
+
+    runs.clear();
+    for (int run = 0; run < kRuns; ++run) {
+        std::vector<uint8_t> pixels(kTextureWidth * 128, uint8_t(run * 16));
+        WriteFile(assets[0].source, pixels.data(), pixels.size());
+        runs.push_back(Build(assets, cache, &jobs, &stats));
+    }
+    Print("One texture changed", Median(runs), stats);
+
+    runs.clear();
+    std::string header = (root / "project" / "shared" / "header_0.ember").string();
+    for (int run = 0; run < kRuns; ++run) {
+        std::string text = "let changed = " + std::to_string(run) + ";\n";
+        WriteFile(header, text.data(), text.size());
+        runs.push_back(Build(assets, cache, &jobs, &stats));
+    }
+    Print("One shared header changed", Median(runs), stats);
+
+    runs.clear();
+    for (int run = 0; run < kRuns; ++run) {
+        fs::remove(fs::path(cache) / "manifest");
+        runs.push_back(Build(assets, cache, &jobs, &stats));
+    }
+    Print("Manifest lost, objects kept", Median(runs), stats);
+
+    runs.clear();
+    for (int run = 0; run < kRuns; ++run) {
+        fs::remove_all(cache);
+        runs.push_back(Build(assets, cache, &jobs, &stats));
+    }
+    Print("Full, empty cache", Median(runs), stats);
+
+    jobs.Shutdown();
+    fs::remove_all(root);
+    return 0;
+}
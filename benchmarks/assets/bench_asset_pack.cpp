@@ -0,0 +1,196 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Loads a set of small assets from loose files, one read per file, and
+// from a pack mapped and used in place, touching every byte either way.
+// Cold runs first ask the OS to drop the files from the page cache, which
+// only Linux supports here; elsewhere the cold runs are warm.
+// Usage: AssetsBenchmarks [asset_count] [directory]
+
+#include <cstdint>    // For uint64_t
+#include <cstdio>     // For printf, fopen, fwrite, fclose
+#include <cstdlib>    // For atoi, exit
+#include <cstring>    // For memcpy
+#include <filesystem> // For std::filesystem
+#include <string>     // For std::string
+#include <vector>     // For std::vector
+
+#if defined(__linux__)
+#include <fcntl.h>  // For open, posix_fadvise
+#include <unistd.h> // For close, fdatasync
+#endif
+
+#include "asset_pack.h"
+#include "benchmark.h"
+
+namespace fs = std::filesystem;
+using namespace toybox::assets;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+
+static const int kRuns = 5;
+
+// Drops the file's pages from the page cache, writing them back first
+static bool Evict(const std::string& path) {
+#if defined(__linux__)
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+    fdatasync(descriptor);
+    bool ok = posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(descriptor);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+static uint64_t Checksum(const uint8_t* data, size_t size) {
+    uint64_t sum = 0;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        sum += word;
+    }
+    for (; i < size; ++i) sum += data[i];
+    return sum;
+}
+
+struct Asset {
+    std::string name;
+    std::string path;
+};
+
+static std::vector<Asset> MakeAssets(const fs::path& root, int count) {
+    std::vector<Asset> assets;
+    std::vector<uint8_t> bytes;
+    uint32_t state = 12345;
+    for (int i = 0; i < count; ++i) {
+        state = state * 1664525u + 1013904223u;
+        // Mostly a few KB, like materials, small meshes and script bytecode
+        size_t size = 256 + (state >> 8) % ((i % 10 == 0) ? 65536 : 8192);
+        bytes.resize(size);
+        for (size_t b = 0; b < size; ++b) bytes[b] = uint8_t(b * 131 + i);
+        Asset asset;
+        asset.name = "level" + std::to_string(i % 8) + "/asset_" + std::to_string(i) + ".bin";
+        asset.path = (root / asset.name).string();
+        fs::create_directories(fs::path(asset.path).parent_path());
+        FILE* file = fopen(asset.path.c_str(), "wb");
+        if (!file || fwrite(bytes.data(), 1, size, file) != size) {
+            printf("Could not write %s\n", asset.path.c_str());
+            exit(1);
+        }
+        fclose(file);
+        assets.push_back(asset);
+    }
+    return assets;
+}
+
+static uint64_t LoadLoose(const std::vector<Asset>& assets) {
+    DynamicArray<uint8_t> buffer;
+    uint64_t sum = 0;
+    for (const Asset& asset : assets) {
+        if (!toybox::utils::io::ReadFile(asset.path.c_str(), &buffer)) exit(1);
+        sum += Checksum(buffer.Data(), buffer.Size());
+    }
+    return sum;
+}
+
+static uint64_t LoadPacked(const std::string& pack_path, const std::vector<Asset>& assets) {
+    AssetPack pack;
+    if (!pack.Open(pack_path.c_str())) exit(1);
+    uint64_t sum = 0;
+    for (const Asset& asset : assets) {
+        AssetSpan span;
+        if (!pack.Find(asset.name.c_str(), asset.name.size(), &span)) exit(1);
+        sum += Checksum(span.data, span.size);
+    }
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 5000;
+    fs::path root = argc > 2 ? fs::path(argv[2]) : fs::temp_directory_path() / "toybox_asset_bench";
+    fs::remove_all(root);
+    fs::create_directories(root / "loose");
+
+    std::vector<Asset> assets = MakeAssets(root / "loose", count);
+    AssetPackWriter writer;
+    for (const Asset& asset : assets) writer.AddFile(asset.name.c_str(), asset.path.c_str());
+    std::string pack_path = (root / "assets.pack").string();
+    Stopwatch pack_watch;
+    if (!writer.Write(pack_path.c_str())) {
+        printf("%s\n", writer.Error());
+        return 1;
+    }
+    double pack_ms = pack_watch.ElapsedMs();
+    printf("%d assets, %.1f MB, packed in %.1f ms\n", count, writer.PayloadSize() / 1048576.0, pack_ms);
+
+    bool evicts = Evict(pack_path);
+    if (!evicts) printf("Cannot drop files from the page cache here; cold runs are warm\n");
+    const size_t loads = size_t(count) * kRuns;
+
+    Section("Cold, every file dropped from the page cache first");
+    {
+        double loose_ns = 0.0, packed_ns = 0.0;
+        uint64_t loose_sum = 0, packed_sum = 0;
+        for (int run = 0; run < kRuns; ++run) {
+            for (const Asset& asset : assets) Evict(asset.path);
+            Stopwatch watch;
+            loose_sum = LoadLoose(assets);
+            loose_ns += watch.ElapsedNs();
+
+            Evict(pack_path);
+            watch.Restart();
+            packed_sum = LoadPacked(pack_path, assets);
+            packed_ns += watch.ElapsedNs();
+        }
+        Report("Loose files, per asset", loose_ns, loads);
+        Report("Pack, per asset", packed_ns, loads);
+        printf("    %.2fx faster%s\n", loose_ns / packed_ns, loose_sum == packed_sum ? "" : ", CHECKSUMS DIFFER");
+    }
+
+    Section("Warm, everything in the page cache");
+    {
+        LoadLoose(assets);
+        LoadPacked(pack_path, assets);
+        Stopwatch watch;
+        uint64_t loose_sum = 0, packed_sum = 0;
+        for (int run = 0; run < kRuns; ++run) loose_sum += LoadLoose(assets);
+        double loose_ns = watch.ElapsedNs();
+        watch.Restart();
+        for (int run = 0; run < kRuns; ++run) packed_sum += LoadPacked(pack_path, assets);
+        double packed_ns = watch.ElapsedNs();
+        Report("Loose files, per asset", loose_ns, loads);
+        Report("Pack, per asset", packed_ns, loads);
+        printf("    %.2fx faster%s\n", loose_ns / packed_ns, loose_sum == packed_sum ? "" : ", CHECKSUMS DIFFER");
+    }
+
+    Section("Lookup alone, pack open");
+    {
+        AssetPack pack;
+        pack.Open(pack_path.c_str());
+        size_t found = 0;
+        Stopwatch watch;
+        for (int run = 0; run < kRuns * 10; ++run) {
+            for (const Asset& asset : assets) {
+                AssetSpan span;
+                found += pack.Find(asset.name.c_str(), asset.name.size(), &span);
+                DoNotOptimize(span.data);
+            }
+        }
+        Report("Find", watch.ElapsedNs(), size_t(count) * kRuns * 10);
+        DoNotOptimize(found);
+    }
+
+    fs::remove_all(root);
+    return 0;
+}
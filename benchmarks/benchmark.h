@@ -0,0 +1,62 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <chrono> // For std::chrono::steady_clock
+#include <cstddef> // For size_t
+#include <cstdio>  // For printf
+
+namespace toybox
+{
+namespace benchmarks
+{
+
+struct Stopwatch {
+private:
+    std::chrono::steady_clock::time_point start;
+
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+    void Restart() {
+        start = std::chrono::steady_clock::now();
+    }
+
+    double ElapsedNs() const {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double ElapsedMs() const {
+        return ElapsedNs() / 1e6;
+    }
+};
+
+// Keeps the optimiser from discarding a value the benchmark computed
+template<typename T>
+inline void DoNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+inline void Report(const char* name, double total_ns, size_t operations) {
+    printf("%-52s %12.2f ns/op %12.3f ms total\n", name, total_ns / (operations ? operations : 1), total_ns / 1e6);
+}
+
+inline void Section(const char* title) {
+    printf("\n== %s ==\n", title);
+}
+
+} // namespace benchmarks
+} // namespace toybox
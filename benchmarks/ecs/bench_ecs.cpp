@@ -0,0 +1,112 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Compares packed and sparse Part storage under add/remove churn and iteration.
+// Usage: ECSBenchmarks [toy_count]
+
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi
+
+#include "benchmark.h"
+#include "world.h"
+
+using namespace toybox::ecs;
+using namespace toybox::benchmarks;
+
+struct Position {
+    float x, y, z;
+};
+
+struct Velocity {
+    float x, y, z;
+};
+
+struct PackedTag {
+    int frames;
+};
+
+struct SparseTag {
+    static constexpr PartStorage kStorage = PartStorage::Sparse;
+    int frames;
+};
+
+typedef PartRegistry<Position, Velocity, PackedTag, SparseTag> BenchParts;
+typedef World<BenchParts> BenchWorld;
+
+static const int kFrames = 20;
+
+template<typename Tag>
+static void RunStorage(const char* label, int toy_count) {
+    BenchWorld world;
+    Toy* toys = new Toy[toy_count];
+    for (int i = 0; i < toy_count; ++i) {
+        toys[i] = world.Create();
+        world.Add<Position>(toys[i], Position{ float(i), 0.0f, 0.0f });
+        world.Add<Velocity>(toys[i], Velocity{ 1.0f, 0.0f, 0.0f });
+        if (i % 2 == 0) world.Add<Tag>(toys[i], Tag{ i });
+    }
+
+    // Toggle the tag on 10% of toys per frame, rotating through the population
+    char name[128];
+    size_t toggles = 0;
+    Stopwatch watch;
+    for (int frame = 0; frame < kFrames; ++frame) {
+        for (int i = frame % 10; i < toy_count; i += 10) {
+            if (world.template Has<Tag>(toys[i])) {
+                world.template Remove<Tag>(toys[i]);
+            } else {
+                world.template Add<Tag>(toys[i], Tag{ i });
+            }
+            ++toggles;
+        }
+    }
+    snprintf(name, sizeof(name), "%s add/remove churn", label);
+    Report(name, watch.ElapsedNs(), toggles);
+
+    size_t visited = 0;
+    watch.Restart();
+    for (int frame = 0; frame < kFrames; ++frame) {
+        world.template Each<Position, const Velocity, const Tag>(
+            [&visited](Toy, Position& p, const Velocity& v, const Tag&) {
+                p.x += v.x;
+                ++visited;
+            });
+    }
+    snprintf(name, sizeof(name), "%s iterate Position+Velocity+Tag", label);
+    Report(name, watch.ElapsedNs(), visited);
+
+    visited = 0;
+    watch.Restart();
+    for (int frame = 0; frame < kFrames; ++frame) {
+        world.template Each<Position, const Velocity>([&visited](Toy, Position& p, const Velocity& v) {
+            p.x += v.x;
+            ++visited;
+        });
+    }
+    snprintf(name, sizeof(name), "%s iterate Position+Velocity", label);
+    Report(name, watch.ElapsedNs(), visited);
+
+    float checksum = 0.0f;
+    world.template Each<const Position>([&checksum](Toy, const Position& p) { checksum += p.x; });
+    DoNotOptimize(checksum);
+    delete[] toys;
+}
+
+int main(int argc, char** argv) {
+    int toy_count = argc > 1 ? atoi(argv[1]) : 100000;
+    printf("ECS storage benchmark: %d toys, %d frames\n", toy_count, kFrames);
+
+    Section("Packed tag (group storage)");
+    RunStorage<PackedTag>("packed", toy_count);
+
+    Section("Sparse tag (sparse-set storage)");
+    RunStorage<SparseTag>("sparse", toy_count);
+    return 0;
+}
@@ -0,0 +1,297 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Replays an asset access trace through the I/O service a frame at a time,
+// on each backend, and reports throughput, the latency from Read to the
+// read finishing by priority, the latency to delivery, and how long
+// Update holds up the main thread.
+//
+// A trace is CSV, one read per line: frame,priority,file,offset,size, with
+// priority 0 critical, 1 visible, 2 prefetch and file an index into the
+// data files. With no trace given one is made up, shaped like a camera
+// moving through streamed level chunks, and written next to the data so it
+// can be edited and replayed. Files are dropped from the page cache before
+// each run where the OS allows it (Linux only here).
+// Usage: IoBenchmarks [trace.csv] [directory]
+
+#include <algorithm>  // For std::sort
+#include <chrono>     // For std::chrono::milliseconds
+#include <cstdint>    // For uint64_t
+#include <cstdio>     // For printf, fopen, fprintf, fscanf
+#include <cstdlib>    // For exit
+#include <filesystem> // For std::filesystem
+#include <string>     // For std::string
+#include <thread>     // For std::this_thread::sleep_until, yield
+#include <vector>     // For std::vector
+
+#if defined(__linux__)
+#include <fcntl.h>  // For open, posix_fadvise
+#include <unistd.h> // For close, fdatasync
+#endif
+
+#include "benchmark.h"
+#include "io_service.h"
+
+namespace fs = std::filesystem;
+using namespace toybox::benchmarks;
+using namespace toybox::utils::io;
+using toybox::utils::data_structures::DynamicArray;
+
+static const int kFileCount = 4;
+static const uint64_t kFileBytes = 32ull << 20;
+static const int kFrames = 400;
+static const auto kFrameTime = std::chrono::microseconds(4000);
+static const size_t kMaxRead = 256 * 1024;
+static const uint32_t kBuffers = 512; // Reads outstanding at once; more wait a frame
+
+struct TraceRead {
+    uint32_t frame;
+    uint32_t priority;
+    uint32_t file;
+    uint64_t offset;
+    uint32_t size;
+};
+
+static bool Evict(const std::string& path) {
+#if defined(__linux__)
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+    fdatasync(descriptor);
+    bool ok = posix_fadvise(descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(descriptor);
+    return ok;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+static uint64_t Percentile(std::vector<uint64_t>& values, double fraction) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t index = size_t(fraction * double(values.size() - 1) + 0.5);
+    return values[index];
+}
+
+static std::vector<std::string> MakeFiles(const fs::path& root) {
+    std::vector<std::string> paths;
+    std::vector<uint8_t> block(1 << 20);
+    for (int f = 0; f < kFileCount; ++f) {
+        std::string path = (root / ("chunks" + std::to_string(f) + ".bin")).string();
+        FILE* file = fopen(path.c_str(), "wb");
+        for (uint64_t written = 0; file && written < kFileBytes; written += block.size()) {
+            for (size_t i = 0; i < block.size(); i += 64) block[i] = uint8_t(written / block.size() + f);
+            fwrite(block.data(), 1, block.size(), file);
+        }
+        if (!file || fclose(file) != 0) {
+            printf("Could not write %s\n", path.c_str());
+            exit(1);
+        }
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+// Each frame streams the next run of the chunk the camera is in as visible
+// reads in adjacent 16-64 KB pieces, prefetches further ahead in larger
+// reads, and now and then needs a small read anywhere right away
+static std::vector<TraceRead> MakeTrace() {
+    std::vector<TraceRead> trace;
+    uint32_t state = 2024;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    };
+    uint64_t cursor[kFileCount] = {};
+    uint64_t ahead[kFileCount] = {};
+    for (uint32_t frame = 0; frame < uint32_t(kFrames); ++frame) {
+        uint32_t file = (frame / 60) % kFileCount;
+        uint32_t pieces = 2 + next() % 10;
+        for (uint32_t p = 0; p < pieces; ++p) {
+            uint32_t size = (16 + next() % 48) * 1024;
+            if (cursor[file] + size > kFileBytes) cursor[file] = 0;
+            trace.push_back(TraceRead{ frame, 1, file, cursor[file], size });
+            cursor[file] += size;
+        }
+        if (frame % 4 == 0) {
+            uint32_t target = (file + 1) % kFileCount;
+            for (int p = 0; p < 3; ++p) {
+                uint32_t size = uint32_t(kMaxRead);
+                if (ahead[target] + size > kFileBytes) ahead[target] = 0;
+                trace.push_back(TraceRead{ frame, 2, target, ahead[target], size });
+                ahead[target] += size;
+            }
+        }
+        if (next() % 3 == 0) {
+            uint32_t size = (4 + next() % 12) * 1024;
+            uint64_t offset = uint64_t(next() % uint32_t(kFileBytes / 4096 - 16)) * 4096;
+            trace.push_back(TraceRead{ frame, 0, next() % kFileCount, offset, size });
+        }
+    }
+    return trace;
+}
+
+static void WriteTrace(const std::string& path, const std::vector<TraceRead>& trace) {
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) return;
+    fprintf(file, "frame,priority,file,offset,size\n");
+    for (const TraceRead& read : trace) {
+        fprintf(file, "%u,%u,%u,%llu,%u\n", read.frame, read.priority, read.file, (unsigned long long)read.offset,
+                read.size);
+    }
+    fclose(file);
+}
+
+static std::vector<TraceRead> ReadTrace(const char* path) {
+    std::vector<TraceRead> trace;
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        printf("Could not open %s\n", path);
+        exit(1);
+    }
+    char header[128];
+    if (!fgets(header, sizeof(header), file)) exit(1);
+    TraceRead read;
+    unsigned long long offset;
+    while (fscanf(file, "%u,%u,%u,%llu,%u", &read.frame, &read.priority, &read.file, &offset, &read.size) == 5) {
+        read.offset = offset;
+        if (read.priority >= kIoPriorityCount || read.file >= uint32_t(kFileCount) || read.size > kMaxRead) {
+            printf("Bad trace line for frame %u\n", read.frame);
+            exit(1);
+        }
+        trace.push_back(read);
+    }
+    fclose(file);
+    std::stable_sort(trace.begin(), trace.end(),
+                     [](const TraceRead& a, const TraceRead& b) { return a.frame < b.frame; });
+    return trace;
+}
+
+static void Replay(const char* name, IoBackend backend, uint64_t frame_budget, bool paced,
+                   const std::vector<TraceRead>& trace, const std::vector<std::string>& paths) {
+    IoService service;
+    IoServiceConfig config;
+    config.backend = backend;
+    config.frame_byte_budget = frame_budget;
+    if (!service.Init(config)) {
+        printf("  %-34s unavailable here\n", name);
+        return;
+    }
+    for (const std::string& path : paths) Evict(path);
+    int32_t files[kFileCount];
+    for (int f = 0; f < kFileCount; ++f) files[f] = service.OpenFile(paths[f].c_str());
+
+    std::vector<uint8_t> arena(size_t(kBuffers) * kMaxRead);
+    std::vector<uint32_t> free_buffers;
+    for (uint32_t b = kBuffers; b-- > 0;) free_buffers.push_back(b);
+    std::vector<uint8_t> buffer_priority(kBuffers);
+    std::vector<uint64_t> read_ns[kIoPriorityCount]; // Read to finished, by priority
+    std::vector<uint64_t> delivery_ns;               // Read to handed over by Update
+    DynamicArray<IoCompletion> completions;
+    std::vector<uint64_t> update_ns;
+    uint64_t checksum = 0;
+    size_t next = 0;
+    uint32_t frame = 0, deferred = 0;
+
+    Stopwatch watch;
+    auto frame_start = std::chrono::steady_clock::now();
+    while (next < trace.size() || service.Outstanding() > 0) {
+        // Deliver what finished during the last frame, then issue this one's
+        Stopwatch update_watch;
+        completions.Clear();
+        service.Update(&completions);
+        update_ns.push_back(uint64_t(update_watch.ElapsedNs()));
+        uint64_t now = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                    std::chrono::steady_clock::now().time_since_epoch())
+                                    .count());
+        for (const IoCompletion& completion : completions) {
+            uint32_t buffer = uint32_t(reinterpret_cast<uintptr_t>(completion.user));
+            free_buffers.push_back(buffer);
+            if (completion.bytes > 0) checksum += completion.buffer[0];
+            read_ns[buffer_priority[buffer]].push_back(completion.completed_ns - completion.submitted_ns);
+            delivery_ns.push_back(now - completion.submitted_ns);
+        }
+
+        for (; next < trace.size() && trace[next].frame <= frame; ++next) {
+            if (free_buffers.empty()) {
+                ++deferred;
+                break;
+            }
+            const TraceRead& read = trace[next];
+            uint32_t buffer = free_buffers.back();
+            free_buffers.pop_back();
+            buffer_priority[buffer] = uint8_t(read.priority);
+            service.Read(files[read.file], read.offset, read.size, arena.data() + size_t(buffer) * kMaxRead,
+                         IoPriority(read.priority), reinterpret_cast<void*>(uintptr_t(buffer)));
+        }
+
+        ++frame;
+        if (paced) {
+            frame_start += kFrameTime;
+            std::this_thread::sleep_until(frame_start);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    double seconds = watch.ElapsedNs() / 1e9;
+    DoNotOptimize(checksum);
+
+    IoServiceStats stats = service.Stats();
+    printf("  %-10s %7.1f MB/s over %u frames, delivered p99 %.2f ms, Update p99 %.1f us max %.1f us\n", name,
+           stats.bytes_read / 1048576.0 / seconds, frame, Percentile(delivery_ns, 0.99) / 1e6,
+           Percentile(update_ns, 0.99) / 1e3, Percentile(update_ns, 1.0) / 1e3);
+    const char* names[kIoPriorityCount] = { "critical", "visible", "prefetch" };
+    for (uint32_t p = 0; p < kIoPriorityCount; ++p) {
+        printf("    %-9s read p50 %6.2f ms  p99 %6.2f ms  p99.9 %6.2f ms  (%zu reads)\n", names[p],
+               Percentile(read_ns[p], 0.5) / 1e6, Percentile(read_ns[p], 0.99) / 1e6,
+               Percentile(read_ns[p], 0.999) / 1e6, read_ns[p].size());
+    }
+    printf("    %llu backend reads, %llu requests coalesced, %llu budget stalls, %u frames out of buffers\n",
+           (unsigned long long)stats.reads_issued, (unsigned long long)stats.coalesced,
+           (unsigned long long)stats.budget_stalls, deferred);
+}
+
+int main(int argc, char** argv) {
+    fs::path root = argc > 2 ? fs::path(argv[2]) : fs::temp_directory_path() / "toybox_io_bench";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    std::vector<std::string> paths = MakeFiles(root);
+
+    std::vector<TraceRead> trace;
+    if (argc > 1) {
+        trace = ReadTrace(argv[1]);
+        printf("Replaying %s\n", argv[1]);
+    } else {
+        trace = MakeTrace();
+        std::string trace_path = (root / "trace.csv").string();
+        WriteTrace(trace_path, trace);
+        printf("Replaying a made-up trace, written to %s\n", trace_path.c_str());
+    }
+    uint64_t bytes = 0;
+    for (const TraceRead& read : trace) bytes += read.size;
+    printf("%zu reads, %.1f MB, %d files of %llu MB, %lld ms frames\n", trace.size(), bytes / 1048576.0,
+           kFileCount, (unsigned long long)(kFileBytes >> 20), (long long)kFrameTime.count() / 1000);
+    if (!Evict(paths[0])) printf("Cannot drop files from the page cache here; runs are warm\n");
+
+    Section("Paced frames, no byte budget");
+    Replay("Threads", IoBackend::Threads, 0, true, trace, paths);
+    Replay("io_uring", IoBackend::Uring, 0, true, trace, paths);
+
+    Section("Paced frames, 1 MB a frame");
+    Replay("Threads", IoBackend::Threads, 1 << 20, true, trace, paths);
+    Replay("io_uring", IoBackend::Uring, 1 << 20, true, trace, paths);
+
+    Section("Flat out, a frame as soon as the last is done");
+    Replay("Threads", IoBackend::Threads, 0, false, trace, paths);
+    Replay("io_uring", IoBackend::Uring, 0, false, trace, paths);
+
+    fs::remove_all(root);
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures job overhead and ParallelFor scaling.
+// Usage: JobSystemBenchmarks [worker_threads]
+
+#include <cmath>   // For sqrtf
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi
+#include <thread>  // For std::thread::hardware_concurrency
+
+#include "benchmark.h"
+#include "job_system.h"
+#include "parallel_for.h"
+
+using namespace toybox::utils::jobs;
+using namespace toybox::benchmarks;
+
+static const int kRounds = 50;
+static const uint32_t kJobsPerRound = 2000;
+static const size_t kItems = 1 << 20;
+
+static void EmptyJob(Job*, void*) {}
+
+static void RunJobOverhead(JobSystem* system) {
+    Stopwatch watch;
+    for (int round = 0; round < kRounds; ++round) {
+        JobHandle root = system->Create(&EmptyJob, nullptr, 0);
+        for (uint32_t i = 0; i < kJobsPerRound; ++i) {
+            system->Run(system->Create(&EmptyJob, nullptr, 0, root));
+        }
+        system->Run(root);
+        system->Wait(root);
+    }
+    Report("empty child jobs", watch.ElapsedNs(), size_t(kRounds) * kJobsPerRound);
+}
+
+static void RunParallelFor(JobSystem* system, float* data) {
+    char name[128];
+    size_t grains[] = { 0, 256, 4096, 65536 };
+    for (size_t grain : grains) {
+        Stopwatch watch;
+        for (int round = 0; round < kRounds; ++round) {
+            ParallelFor(system, 0, kItems, grain, [data](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    data[i] = sqrtf(data[i] * data[i] + 1.0f);
+                }
+            });
+        }
+        if (grain == 0) {
+            snprintf(name, sizeof(name), "ParallelFor, auto grain");
+        } else {
+            snprintf(name, sizeof(name), "ParallelFor, grain %zu", grain);
+        }
+        Report(name, watch.ElapsedNs(), size_t(kRounds) * kItems);
+    }
+    DoNotOptimize(data[kItems / 2]);
+}
+
+static void RunSerial(float* data) {
+    Stopwatch watch;
+    for (int round = 0; round < kRounds; ++round) {
+        for (size_t i = 0; i < kItems; ++i) {
+            data[i] = sqrtf(data[i] * data[i] + 1.0f);
+        }
+        DoNotOptimize(data[round]);
+    }
+    Report("serial loop", watch.ElapsedNs(), size_t(kRounds) * kItems);
+}
+
+int main(int argc, char** argv) {
+    uint32_t hardware = std::thread::hardware_concurrency();
+    uint32_t workers = argc > 1 ? uint32_t(atoi(argv[1])) : (hardware > 1 ? hardware - 1 : 0);
+
+    float* data = new float[kItems];
+    for (size_t i = 0; i < kItems; ++i) data[i] = float(i % 1000);
+
+    Section("Serial baseline");
+    RunSerial(data);
+
+    uint32_t counts[] = { 0, workers };
+    for (uint32_t count : counts) {
+        JobSystem system;
+        system.Init(count);
+
+        char title[64];
+        snprintf(title, sizeof(title), "%u worker threads", count);
+        Section(title);
+        RunJobOverhead(&system);
+        RunParallelFor(&system, data);
+        if (workers == 0) break;
+    }
+
+    delete[] data;
+    return 0;
+}
@@ -0,0 +1,108 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Compares the SIMD batch kernels with their scalar references.
+// Usage: MathBenchmarks [element_count]
+
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi, rand
+
+#include "batch.h"
+#include "benchmark.h"
+
+using namespace toybox::math;
+using namespace toybox::benchmarks;
+
+static const int kRepeats = 20;
+
+static float RandomFloat(float range) {
+    return (static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f) * range;
+}
+
+// Streams for every kernel, allocated together
+struct Streams {
+    float* data[10];
+    Mat4* matrices;
+    Mat4* matrices_b;
+    Mat4* matrices_out;
+
+    explicit Streams(size_t count) {
+        for (int s = 0; s < 10; ++s) {
+            data[s] = new float[count];
+            for (size_t i = 0; i < count; ++i) data[s][i] = RandomFloat(100.0f);
+        }
+        matrices = new Mat4[count];
+        matrices_b = new Mat4[count];
+        matrices_out = new Mat4[count];
+        for (size_t i = 0; i < count; ++i) {
+            Quat rotation = Normalize(Quat{ RandomFloat(1.0f), RandomFloat(1.0f), RandomFloat(1.0f), 1.0f });
+            matrices[i] = Mat4Compose(Vec3{ RandomFloat(50.0f), RandomFloat(50.0f), RandomFloat(50.0f) }, rotation,
+                                      Vec3{ 1.0f, 2.0f, 0.5f });
+            matrices_b[i] = Mat4Compose(Vec3{ RandomFloat(5.0f), 0.0f, 0.0f }, rotation, Vec3{ 1.0f, 1.0f, 1.0f });
+        }
+    }
+
+    ~Streams() {
+        for (int s = 0; s < 10; ++s) delete[] data[s];
+        delete[] matrices;
+        delete[] matrices_b;
+        delete[] matrices_out;
+    }
+
+    Vec3SoA Points() { return Vec3SoA{ data[0], data[1], data[2] }; }
+    Vec3SoA Output() { return Vec3SoA{ data[3], data[4], data[5] }; }
+    QuatSoA Quats() { return QuatSoA{ data[6], data[7], data[8], data[9] }; }
+    AabbSoA LocalBoxes() { return AabbSoA{ data[0], data[1], data[2], data[6], data[7], data[8] }; }
+    AabbSoA WorldBoxes() { return AabbSoA{ data[3], data[4], data[5], data[9], data[9], data[9] }; }
+};
+
+template<typename Fn>
+static void Measure(const char* kernel, const char* level, size_t count, const Fn& fn) {
+    char name[128];
+    snprintf(name, sizeof(name), "%-28s %s", kernel, level);
+    fn(); // Warm caches
+    Stopwatch watch;
+    for (int r = 0; r < kRepeats; ++r) fn();
+    Report(name, watch.ElapsedNs(), count * kRepeats);
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? size_t(atoi(argv[1])) : 100000;
+    Streams s(count);
+    Mat4 matrix = s.matrices[0];
+    const char* level = SimdLevelName();
+
+    printf("SIMD level: %s, %zu elements\n", level, count);
+
+    Section("Transform points");
+    Measure("TransformPoints", "scalar", count, [&] { scalar::TransformPoints(matrix, s.Points(), s.Output(), count); });
+    Measure("TransformPoints", level, count, [&] { TransformPoints(matrix, s.Points(), s.Output(), count); });
+
+    Section("Multiply matrices");
+    Measure("MultiplyMatrices", "scalar", count,
+            [&] { scalar::MultiplyMatrices(s.matrices, s.matrices_b, s.matrices_out, count); });
+    Measure("MultiplyMatrices", level, count,
+            [&] { MultiplyMatrices(s.matrices, s.matrices_b, s.matrices_out, count); });
+
+    Section("Normalize quaternions");
+    Measure("NormalizeQuaternions", "scalar", count, [&] { scalar::NormalizeQuaternions(s.Quats(), count); });
+    Measure("NormalizeQuaternions", level, count, [&] { NormalizeQuaternions(s.Quats(), count); });
+
+    Section("AABB bounds");
+    Measure("TransformAabbs", "scalar", count,
+            [&] { scalar::TransformAabbs(s.matrices, s.LocalBoxes(), s.WorldBoxes(), count); });
+    Measure("TransformAabbs", level, count, [&] { TransformAabbs(s.matrices, s.LocalBoxes(), s.WorldBoxes(), count); });
+
+    Aabb bounds;
+    Measure("BoundsOfPoints", "scalar", count, [&] { bounds = scalar::BoundsOfPoints(s.Points(), count); });
+    Measure("BoundsOfPoints", level, count, [&] { bounds = BoundsOfPoints(s.Points(), count); });
+    DoNotOptimize(bounds);
+    return 0;
+}
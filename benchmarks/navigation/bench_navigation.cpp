@@ -0,0 +1,203 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures grid pathfinding on the usual kinds of benchmark map: random
+// obstacles, a maze and open ground with scattered rooms. Compares A*, Jump
+// Point Search and HPA*, then runs a crowd's worth of requests through the
+// path service with a per-frame budget.
+// Usage: NavigationBenchmarks [map_size] [worker_threads]
+
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi, rand, srand
+#include <thread>  // For std::thread::hardware_concurrency
+
+#include "benchmark.h"
+#include "grid_map.h"
+#include "grid_pathfinder.h"
+#include "hierarchical_grid.h"
+#include "job_system.h"
+#include "path_service.h"
+
+using namespace toybox::navigation;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static const uint32_t kPathQueries = 200;
+static const uint32_t kCrowdRequests = 2000;
+static const double kFrameBudgetMs = 2.0;
+
+static void MakeRandom(GridMap& map, int32_t size, int blocked_percent) {
+    map.Init(size, size);
+    for (int32_t y = 0; y < size; ++y) {
+        for (int32_t x = 0; x < size; ++x) {
+            map.SetBlocked(x, y, rand() % 100 < blocked_percent);
+        }
+    }
+}
+
+// Corridors one cell wide, carved by a depth-first walk over odd cells, with
+// a few extra walls knocked out so there is more than one way round
+static void MakeMaze(GridMap& map, int32_t size) {
+    map.Init(size, size);
+    for (int32_t y = 0; y < size; ++y) {
+        for (int32_t x = 0; x < size; ++x) map.SetBlocked(x, y, true);
+    }
+
+    DynamicArray<GridCell> stack;
+    stack.PushBack(GridCell{ 1, 1 });
+    map.SetBlocked(1, 1, false);
+    static const int32_t kSteps[4][2] = { { 2, 0 }, { -2, 0 }, { 0, 2 }, { 0, -2 } };
+    while (!stack.Empty()) {
+        GridCell cell = stack.Back();
+        int32_t options[4];
+        int32_t option_count = 0;
+        for (int32_t d = 0; d < 4; ++d) {
+            int32_t x = cell.x + kSteps[d][0];
+            int32_t y = cell.y + kSteps[d][1];
+            if (x > 0 && y > 0 && x < size - 1 && y < size - 1 && !map.IsWalkable(x, y)) options[option_count++] = d;
+        }
+        if (option_count == 0) {
+            stack.PopBack();
+            continue;
+        }
+        int32_t d = options[rand() % option_count];
+        map.SetBlocked(cell.x + kSteps[d][0] / 2, cell.y + kSteps[d][1] / 2, false);
+        map.SetBlocked(cell.x + kSteps[d][0], cell.y + kSteps[d][1], false);
+        stack.PushBack(GridCell{ cell.x + kSteps[d][0], cell.y + kSteps[d][1] });
+    }
+    for (int32_t i = 0; i < size * size / 50; ++i) {
+        map.SetBlocked(1 + rand() % (size - 2), 1 + rand() % (size - 2), false);
+    }
+}
+
+// Mostly open ground with hollow rooms that have a door on each side
+static void MakeOpen(GridMap& map, int32_t size) {
+    map.Init(size, size);
+    for (int32_t room = 0; room < size / 8; ++room) {
+        int32_t width = 6 + rand() % 20;
+        int32_t height = 6 + rand() % 20;
+        int32_t left = rand() % (size - width);
+        int32_t top = rand() % (size - height);
+        for (int32_t x = left; x < left + width; ++x) {
+            map.SetBlocked(x, top, x != left + width / 2);
+            map.SetBlocked(x, top + height - 1, x != left + width / 2);
+        }
+        for (int32_t y = top; y < top + height; ++y) {
+            map.SetBlocked(left, y, y != top + height / 2);
+            map.SetBlocked(left + width - 1, y, y != top + height / 2);
+        }
+    }
+}
+
+static GridCell RandomOpenCell(const GridMap& map) {
+    for (;;) {
+        GridCell cell = { rand() % map.Width(), rand() % map.Height() };
+        if (map.IsWalkable(cell.x, cell.y)) return cell;
+    }
+}
+
+static void RunMap(const char* title, const GridMap& map, JobSystem* jobs) {
+    char name[128];
+    snprintf(name, sizeof(name), "%s, %dx%d", title, map.Width(), map.Height());
+    Section(name);
+
+    HierarchicalGrid hierarchy;
+    Stopwatch watch;
+    hierarchy.Build(map, 16);
+    Report("HPA* build serial", watch.ElapsedNs(), 1);
+    watch.Restart();
+    hierarchy.Build(map, 16, jobs);
+    Report("HPA* build parallel", watch.ElapsedNs(), 1);
+    printf("%u clusters, %u entrance nodes\n", hierarchy.ClusterCount(), hierarchy.NodeCount());
+
+    // Only pairs that are connected, so every algorithm does a full search
+    GridPathfinder pathfinder;
+    DynamicArray<GridCell> path;
+    GridCell* starts = new GridCell[kPathQueries];
+    GridCell* goals = new GridCell[kPathQueries];
+    for (uint32_t i = 0; i < kPathQueries; ++i) {
+        do {
+            starts[i] = RandomOpenCell(map);
+            goals[i] = RandomOpenCell(map);
+        } while (!pathfinder.FindPath(map, starts[i], goals[i], PathAlgorithm::JumpPoint, &path));
+    }
+
+    const PathAlgorithm algorithms[] = { PathAlgorithm::AStar, PathAlgorithm::JumpPoint, PathAlgorithm::Hierarchical };
+    const char* labels[] = { "A*", "Jump Point Search", "HPA*" };
+    double optimal_cost = 0.0;
+    for (int a = 0; a < 3; ++a) {
+        double cost = 0.0;
+        double expanded = 0.0;
+        watch.Restart();
+        for (uint32_t i = 0; i < kPathQueries; ++i) {
+            pathfinder.FindPath(map, starts[i], goals[i], algorithms[a], &path, &hierarchy);
+            cost += PathCost(path.Data(), uint32_t(path.Size()));
+            expanded += pathfinder.ExpandedNodes();
+        }
+        double elapsed = watch.ElapsedNs();
+        if (a == 0) optimal_cost = cost;
+
+        snprintf(name, sizeof(name), "%s per path", labels[a]);
+        Report(name, elapsed, kPathQueries);
+        printf("    %.0f nodes expanded, path length %.1f%% of optimal\n", expanded / kPathQueries,
+               cost / optimal_cost * 100.0);
+    }
+
+    // A crowd repathing at once, drained a budgeted frame at a time
+    for (int pass = 0; pass < 2; ++pass) {
+        JobSystem* system = pass == 0 ? nullptr : jobs;
+        PathService service;
+        service.Init(&map, kCrowdRequests, system, &hierarchy);
+        for (uint32_t i = 0; i < kCrowdRequests; ++i) {
+            uint32_t q = i % kPathQueries;
+            service.Submit(PathRequest{ starts[q], goals[(q * 7 + i) % kPathQueries], PathAlgorithm::JumpPoint });
+        }
+
+        uint32_t frames = 0;
+        double worst_ms = 0.0;
+        watch.Restart();
+        while (service.PendingCount() > 0) {
+            Stopwatch frame;
+            service.Update(kFrameBudgetMs);
+            double ms = frame.ElapsedMs();
+            if (ms > worst_ms) worst_ms = ms;
+            ++frames;
+        }
+        snprintf(name, sizeof(name), "Crowd of %u JPS requests, %s", kCrowdRequests, system ? "parallel" : "serial");
+        Report(name, watch.ElapsedNs(), kCrowdRequests);
+        printf("    %u frames at a %.1f ms budget, slowest frame %.2f ms\n", frames, kFrameBudgetMs, worst_ms);
+        service.Shutdown();
+    }
+
+    delete[] starts;
+    delete[] goals;
+}
+
+int main(int argc, char** argv) {
+    int32_t size = argc > 1 ? atoi(argv[1]) : 512;
+    uint32_t hardware = std::thread::hardware_concurrency();
+    uint32_t workers = argc > 2 ? uint32_t(atoi(argv[2])) : (hardware > 1 ? hardware - 1 : 1);
+    JobSystem jobs;
+    jobs.Init(workers);
+    printf("%u workers\n", workers);
+    srand(1);
+
+    GridMap map;
+    MakeRandom(map, size, 25);
+    RunMap("Random, 25% blocked", map, &jobs);
+    MakeMaze(map, size | 1);
+    RunMap("Maze", map, &jobs);
+    MakeOpen(map, size);
+    RunMap("Open with rooms", map, &jobs);
+
+    jobs.Shutdown();
+    return 0;
+}
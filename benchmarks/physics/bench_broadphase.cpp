@@ -0,0 +1,153 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures the sweep-and-prune broadphase on boxes drifting around a cube
+// sized for a few overlaps per box: incremental updates on one thread and
+// on the job system, sorting from scratch every frame, and brute force for
+// the smallest scene.
+// Usage: BroadphaseBenchmarks [worker_threads]
+
+#include <cmath>   // For cbrtf
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi, rand, srand
+#include <thread>  // For std::thread::hardware_concurrency
+
+#include "benchmark.h"
+#include "broadphase.h"
+#include "dynamicarray.h"
+#include "job_system.h"
+
+using namespace toybox::physics;
+using namespace toybox::math;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static const int kFrames = 30;
+
+static float RandomRange(float low, float high) {
+    return low + (high - low) * (float(rand()) / float(RAND_MAX));
+}
+
+struct MovingBoxes {
+    DynamicArray<Vec3> centres;
+    DynamicArray<Vec3> halves;
+    DynamicArray<Vec3> velocities;
+    DynamicArray<Aabb> bounds;
+    float size;
+
+    void Init(uint32_t count) {
+        // About four neighbours per box
+        size = cbrtf(16.0f * float(count));
+        centres.Clear();
+        halves.Clear();
+        velocities.Clear();
+        for (uint32_t i = 0; i < count; ++i) {
+            centres.PushBack(Vec3{ RandomRange(0.0f, size), RandomRange(0.0f, size), RandomRange(0.0f, size) });
+            halves.PushBack(Vec3{ RandomRange(0.5f, 1.5f), RandomRange(0.5f, 1.5f), RandomRange(0.5f, 1.5f) });
+            velocities.PushBack(Vec3{ RandomRange(-0.1f, 0.1f), RandomRange(-0.1f, 0.1f), RandomRange(-0.1f, 0.1f) });
+        }
+        bounds.Resize(count);
+        Refresh();
+    }
+
+    void Refresh() {
+        for (size_t i = 0; i < centres.Size(); ++i) {
+            bounds.Data()[i] = Aabb{ centres.Data()[i] - halves.Data()[i], centres.Data()[i] + halves.Data()[i] };
+        }
+    }
+
+    // Moves every box a little, bouncing off the walls of the cube
+    void Move() {
+        for (size_t i = 0; i < centres.Size(); ++i) {
+            Vec3& c = centres.Data()[i];
+            Vec3& v = velocities.Data()[i];
+            c = c + v;
+            if (c.x < 0.0f || c.x > size) v.x = -v.x;
+            if (c.y < 0.0f || c.y > size) v.y = -v.y;
+            if (c.z < 0.0f || c.z > size) v.z = -v.z;
+        }
+        Refresh();
+    }
+};
+
+static void Run(uint32_t count, JobSystem* jobs) {
+    char name[128];
+    snprintf(name, sizeof(name), "%u moving boxes", count);
+    Section(name);
+    MovingBoxes boxes;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        JobSystem* system = pass == 0 ? nullptr : jobs;
+        srand(count);
+        boxes.Init(count);
+        SweepAndPrune sap;
+        sap.Update(boxes.bounds.Data(), count, system);
+        uint64_t pairs = 0, swaps = 0;
+        double total = 0.0;
+        for (int f = 0; f < kFrames; ++f) {
+            boxes.Move();
+            Stopwatch watch;
+            sap.Update(boxes.bounds.Data(), count, system);
+            total += watch.ElapsedNs();
+            pairs += sap.PairCount();
+            swaps += sap.SwapCount();
+        }
+        Report(system ? "Incremental, job system, per frame" : "Incremental, one thread, per frame", total, kFrames);
+        if (pass == 0) {
+            printf("    %llu pairs, %llu swaps, %u stripes per frame\n", (unsigned long long)(pairs / kFrames),
+                   (unsigned long long)(swaps / kFrames), sap.StripeCount());
+        }
+    }
+
+    {
+        srand(count);
+        boxes.Init(count);
+        double total = 0.0;
+        for (int f = 0; f < kFrames; ++f) {
+            boxes.Move();
+            SweepAndPrune fresh;
+            Stopwatch watch;
+            fresh.Update(boxes.bounds.Data(), count, jobs);
+            total += watch.ElapsedNs();
+            DoNotOptimize(fresh.PairCount());
+        }
+        Report("From scratch, job system, per frame", total, kFrames);
+    }
+
+    if (count <= 1000) {
+        srand(count);
+        boxes.Init(count);
+        Stopwatch watch;
+        uint64_t pairs = 0;
+        for (int f = 0; f < kFrames; ++f) {
+            const Aabb* bounds = boxes.bounds.Data();
+            for (uint32_t a = 0; a < count; ++a) {
+                for (uint32_t b = a + 1; b < count; ++b) pairs += Overlaps(bounds[a], bounds[b]) ? 1 : 0;
+            }
+        }
+        Report("Brute force, per frame", watch.ElapsedNs(), kFrames);
+        DoNotOptimize(pairs);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t hardware = std::thread::hardware_concurrency();
+    uint32_t workers = argc > 1 ? uint32_t(atoi(argv[1])) : (hardware > 1 ? hardware - 1 : 1);
+    JobSystem jobs;
+    jobs.Init(workers);
+    printf("%u workers\n", workers);
+
+    const uint32_t counts[] = { 1000, 10000, 100000 };
+    for (uint32_t count : counts) Run(count, &jobs);
+
+    jobs.Shutdown();
+    return 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures the physics integration layer headless: fixed steps over every
+// body, steps solving heaps of crates in contact island by island, then whole
+// frames with ECS sync where only some bodies move, synced by changed bodies
+// only against copying every transform both ways.
+// Usage: PhysicsBenchmarks [body_count] [moving_percent] [worker_threads]
+
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi, rand, srand
+#include <thread>  // For std::thread::hardware_concurrency
+
+#include "benchmark.h"
+#include "job_system.h"
+#include "physics_sync.h"
+
+using namespace toybox::physics;
+using namespace toybox::math;
+using namespace toybox::benchmarks;
+using toybox::ecs::Toy;
+using toybox::scene::Transform;
+using toybox::utils::jobs::JobSystem;
+
+typedef toybox::ecs::PartRegistry<PhysicsBody, Transform> BenchParts;
+typedef toybox::ecs::World<BenchParts> BenchWorld;
+
+static const int kSteps = 300;
+static const int kFrames = 300;
+
+static float RandomRange(float low, float high) {
+    return low + (high - low) * (float(rand()) / float(RAND_MAX));
+}
+
+static BodyDesc RandomBody(bool moving) {
+    BodyDesc desc = BodyDescDefault();
+    desc.type = moving ? BodyType::Dynamic : BodyType::Static;
+    desc.position = Vec3{ RandomRange(-200.0f, 200.0f), RandomRange(0.0f, 100.0f), RandomRange(-200.0f, 200.0f) };
+    desc.linear_velocity = Vec3{ RandomRange(-5.0f, 5.0f), RandomRange(0.0f, 10.0f), RandomRange(-5.0f, 5.0f) };
+    desc.angular_velocity = Vec3{ RandomRange(-1.0f, 1.0f), RandomRange(-1.0f, 1.0f), RandomRange(-1.0f, 1.0f) };
+    return desc;
+}
+
+static void RunSteps(uint32_t count, JobSystem* jobs) {
+    char name[128];
+    snprintf(name, sizeof(name), "Fixed steps, %u awake bodies", count);
+    Section(name);
+    for (int pass = 0; pass < 2; ++pass) {
+        JobSystem* system = pass == 0 ? nullptr : jobs;
+        PhysicsWorld world;
+        srand(2);
+        for (uint32_t i = 0; i < count; ++i) world.Create(RandomBody(true));
+        Stopwatch watch;
+        for (int s = 0; s < kSteps; ++s) world.Step(system);
+        Report(system ? "Step, job system, per body" : "Step, one thread, per body", watch.ElapsedNs(),
+               size_t(count) * kSteps);
+        DoNotOptimize(world.Position(world.BodyAt(0)));
+    }
+}
+
+// Heaps of ten crates on a ground plane, far enough apart that each heap is
+// an island of its own until they settle and sleep
+static void BuildHeaps(PhysicsWorld& world, uint32_t count) {
+    BodyDesc floor = BodyDescDefault();
+    floor.type = BodyType::Static;
+    floor.position = Vec3{ 0.0f, -0.5f, 0.0f };
+    floor.half_extents = Vec3{ 10000.0f, 0.5f, 10000.0f };
+    world.Create(floor);
+    uint32_t heaps = (count + 9) / 10;
+    uint32_t side = 1;
+    while (side * side < heaps) ++side;
+    srand(4);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t heap = i / 10;
+        BodyDesc desc = BodyDescDefault();
+        desc.position = Vec3{ float(heap % side) * 4.0f + RandomRange(-0.3f, 0.3f), 0.5f + float(i % 10) * 0.95f,
+                              float(heap / side) * 4.0f + RandomRange(-0.3f, 0.3f) };
+        world.Create(desc);
+    }
+}
+
+static void RunIslands(uint32_t count, JobSystem* jobs) {
+    char name[128];
+    snprintf(name, sizeof(name), "Contact islands, %u crates in heaps of ten", count);
+    Section(name);
+    for (int pass = 0; pass < 2; ++pass) {
+        JobSystem* system = pass == 0 ? nullptr : jobs;
+        PhysicsWorld world;
+        BuildHeaps(world, count);
+        // The first steps, while every heap is awake and pressing down
+        uint64_t islands = 0, contacts = 0;
+        const int steps = 60;
+        Stopwatch watch;
+        for (int s = 0; s < steps; ++s) {
+            world.Step(system);
+            islands += world.Islands().Count();
+            contacts += world.ContactCount();
+        }
+        Report(system ? "Step, job system, per body" : "Step, one thread, per body", watch.ElapsedNs(),
+               size_t(count) * steps);
+        printf("    %llu islands, %llu contacts per step\n", (unsigned long long)(islands / steps),
+               (unsigned long long)(contacts / steps));
+        DoNotOptimize(world.Position(world.BodyAt(1)));
+    }
+}
+
+static void BuildScene(BenchWorld& world, PhysicsWorld& physics, uint32_t count, uint32_t moving_percent) {
+    srand(3);
+    for (uint32_t i = 0; i < count; ++i) {
+        Toy toy = world.Create();
+        BodyDesc desc = RandomBody(uint32_t(rand()) % 100 < moving_percent);
+        desc.user_data = UserDataFromToy(toy);
+        world.Add<Transform>(toy, Transform{ desc.position, desc.rotation, Vec3{ 1.0f, 1.0f, 1.0f } });
+        world.Add<PhysicsBody>(toy, physics.Create(desc));
+    }
+}
+
+// Frame times that wander around 60 Hz, as a real game loop's do
+static float FrameTime(int frame) {
+    return (frame % 7 == 0 ? 1.0f / 45.0f : 1.0f / 70.0f);
+}
+
+static void RunFrames(uint32_t count, uint32_t moving_percent, JobSystem* jobs) {
+    char name[128];
+    snprintf(name, sizeof(name), "Frames with ECS sync, %u bodies, %u%% moving", count, moving_percent);
+    Section(name);
+
+    {
+        BenchWorld world;
+        PhysicsWorld physics;
+        BuildScene(world, physics, count, moving_percent);
+        PhysicsSync<BenchParts> sync;
+        uint64_t pulled = 0;
+        Stopwatch watch;
+        for (int f = 0; f < kFrames; ++f) {
+            sync.Run(world, physics, FrameTime(f), jobs);
+            pulled += sync.PulledCount();
+        }
+        Report("Changed bodies only, per frame", watch.ElapsedNs(), kFrames);
+        printf("    %llu transforms written per frame, %llu steps\n", (unsigned long long)(pulled / kFrames),
+               (unsigned long long)physics.StepCount());
+    }
+
+    {
+        // Every transform pushed and every body read back, every frame
+        BenchWorld world;
+        PhysicsWorld physics;
+        BuildScene(world, physics, count, moving_percent);
+        Stopwatch watch;
+        for (int f = 0; f < kFrames; ++f) {
+            world.EachBlock<const PhysicsBody, const Transform>(
+                [&physics](uint32_t rows, const Toy*, const PhysicsBody* bodies, const Transform* transforms) {
+                    physics.SetPoses(bodies, transforms, rows);
+                });
+            physics.Advance(FrameTime(f), jobs);
+            world.EachBlock<const PhysicsBody, Transform>(
+                [&physics](uint32_t rows, const Toy*, const PhysicsBody* bodies, Transform* transforms) {
+                    for (uint32_t r = 0; r < rows; ++r) {
+                        transforms[r].position = physics.Position(bodies[r]);
+                        transforms[r].rotation = physics.Rotation(bodies[r]);
+                    }
+                });
+        }
+        Report("Copy everything, per frame", watch.ElapsedNs(), kFrames);
+        printf("    %u transforms written per frame\n", count);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? uint32_t(atoi(argv[1])) : 10000;
+    uint32_t moving_percent = argc > 2 ? uint32_t(atoi(argv[2])) : 20;
+    uint32_t hardware = std::thread::hardware_concurrency();
+    uint32_t workers = argc > 3 ? uint32_t(atoi(argv[3])) : (hardware > 1 ? hardware - 1 : 1);
+    JobSystem jobs;
+    jobs.Init(workers);
+    printf("%u workers, %u bodies, %u%% moving\n", workers, count, moving_percent);
+
+    RunSteps(count, &jobs);
+    RunIslands(count, &jobs);
+    RunFrames(count, moving_percent, &jobs);
+
+    jobs.Shutdown();
+    return 0;
+}
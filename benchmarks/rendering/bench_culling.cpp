@@ -0,0 +1,193 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures CPU visibility culling without a GPU: the frustum test one object
+// at a time against the SIMD path, the full stage serial and across the job
+// system, and a city of buildings where the nearest blocks hide most of the
+// rest from a street-level camera.
+// Usage: RenderingBenchmarks [object_count] [worker_threads]
+
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi, rand, srand
+#include <thread>  // For std::thread::hardware_concurrency
+
+#include "benchmark.h"
+#include "culling.h"
+#include "job_system.h"
+#include "occlusion_buffer.h"
+
+using namespace toybox::rendering;
+using namespace toybox::math;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static const int kRepeats = 10;
+static const int32_t kOcclusionWidth = 320;
+static const int32_t kOcclusionHeight = 180;
+
+static float RandomRange(float low, float high) {
+    return low + (high - low) * (float(rand()) / float(RAND_MAX));
+}
+
+struct Scene {
+    DynamicArray<float> center_x, center_y, center_z;
+    DynamicArray<float> extent_x, extent_y, extent_z;
+    DynamicArray<float> radius;
+
+    void Add(Vec3 center, Vec3 extent) {
+        center_x.PushBack(center.x);
+        center_y.PushBack(center.y);
+        center_z.PushBack(center.z);
+        extent_x.PushBack(extent.x);
+        extent_y.PushBack(extent.y);
+        extent_z.PushBack(extent.z);
+        radius.PushBack(Length(extent));
+    }
+
+    CullBounds Bounds() const {
+        return CullBounds{ center_x.Data(), center_y.Data(), center_z.Data(), extent_x.Data(),
+                           extent_y.Data(), extent_z.Data(), radius.Data() };
+    }
+
+    uint32_t Count() const { return uint32_t(center_x.Size()); }
+};
+
+static Mat4 Camera(Vec3 eye, Vec3 target) {
+    return Mat4Perspective(1.0f, 16.0f / 9.0f, 0.5f, 1000.0f) * Mat4LookAt(eye, target, Vec3{ 0.0f, 1.0f, 0.0f });
+}
+
+static void RunFrustum(uint32_t count, JobSystem* jobs) {
+    Section("Frustum culling");
+    Scene scene;
+    for (uint32_t i = 0; i < count; ++i) {
+        scene.Add(Vec3{ RandomRange(-1000.0f, 1000.0f), RandomRange(-50.0f, 50.0f), RandomRange(-1000.0f, 1000.0f) },
+                  Vec3{ RandomRange(0.5f, 5.0f), RandomRange(0.5f, 5.0f), RandomRange(0.5f, 5.0f) });
+    }
+    Mat4 view_projection = Camera(Vec3{ 0.0f, 10.0f, 0.0f }, Vec3{ 1.0f, 9.8f, -1.0f });
+    Frustum frustum = FrustumFromMatrix(view_projection);
+
+    DynamicArray<uint32_t> visible;
+    visible.Resize(count);
+    uint32_t written = 0;
+    Stopwatch watch;
+    for (int r = 0; r < kRepeats; ++r) {
+        written = toybox::rendering::scalar::FrustumCull(frustum, scene.Bounds(), 0, count, visible.Data());
+        DoNotOptimize(written);
+    }
+    Report("Scalar per object", watch.ElapsedNs(), size_t(count) * kRepeats);
+    watch.Restart();
+    for (int r = 0; r < kRepeats; ++r) {
+        written = FrustumCull(frustum, scene.Bounds(), 0, count, visible.Data());
+        DoNotOptimize(written);
+    }
+    Report("SIMD per object", watch.ElapsedNs(), size_t(count) * kRepeats);
+    printf("    %u of %u objects in the frustum\n", written, count);
+
+    CullingStage stage;
+    watch.Restart();
+    for (int r = 0; r < kRepeats; ++r) stage.Run(view_projection, scene.Bounds(), count, &visible);
+    Report("Stage serial per object", watch.ElapsedNs(), size_t(count) * kRepeats);
+    watch.Restart();
+    for (int r = 0; r < kRepeats; ++r) stage.Run(view_projection, scene.Bounds(), count, &visible, jobs);
+    Report("Stage parallel per object", watch.ElapsedNs(), size_t(count) * kRepeats);
+}
+
+// City blocks of tall buildings on a grid, each with a few dozen small props
+// around it; the buildings are the occluders
+static void RunCity(JobSystem* jobs) {
+    Section("Occlusion culling, city blocks");
+    const int32_t blocks = 40;
+    const float spacing = 40.0f;
+    Scene scene;
+    DynamicArray<Vec3> vertices;
+    DynamicArray<uint32_t> indices;
+    for (int32_t bz = 0; bz < blocks; ++bz) {
+        for (int32_t bx = 0; bx < blocks; ++bx) {
+            Vec3 base{ (float(bx) - blocks * 0.5f) * spacing, 0.0f, -float(bz) * spacing - 20.0f };
+            Vec3 half{ 14.0f, RandomRange(20.0f, 60.0f), 14.0f };
+            Vec3 center = base + Vec3{ 0.0f, half.y, 0.0f };
+            scene.Add(center, half);
+
+            // The front and side walls are enough to occlude from the street
+            uint32_t first = uint32_t(vertices.Size());
+            vertices.PushBack(Vec3{ center.x - half.x, 0.0f, center.z + half.z });
+            vertices.PushBack(Vec3{ center.x + half.x, 0.0f, center.z + half.z });
+            vertices.PushBack(Vec3{ center.x + half.x, 2.0f * half.y, center.z + half.z });
+            vertices.PushBack(Vec3{ center.x - half.x, 2.0f * half.y, center.z + half.z });
+            vertices.PushBack(Vec3{ center.x - half.x, 0.0f, center.z - half.z });
+            vertices.PushBack(Vec3{ center.x - half.x, 2.0f * half.y, center.z - half.z });
+            vertices.PushBack(Vec3{ center.x + half.x, 0.0f, center.z - half.z });
+            vertices.PushBack(Vec3{ center.x + half.x, 2.0f * half.y, center.z - half.z });
+            const uint32_t quads[][4] = { { 0, 1, 2, 3 }, { 4, 0, 3, 5 }, { 1, 6, 7, 2 } };
+            for (const auto& quad : quads) {
+                const uint32_t corners[6] = { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] };
+                for (uint32_t corner : corners) indices.PushBack(first + corner);
+            }
+
+            for (int p = 0; p < 40; ++p) {
+                scene.Add(base + Vec3{ RandomRange(-19.0f, 19.0f), RandomRange(0.5f, 3.0f), RandomRange(-19.0f, 19.0f) },
+                          Vec3{ 0.5f, 0.5f, 0.5f });
+            }
+        }
+    }
+    uint32_t triangles = uint32_t(indices.Size() / 3);
+    printf("%u objects, %u occluder triangles\n", scene.Count(), triangles);
+
+    Mat4 view_projection = Camera(Vec3{ 0.0f, 2.0f, 10.0f }, Vec3{ 0.0f, 2.0f, -100.0f });
+    OcclusionBuffer buffer;
+    buffer.Init(kOcclusionWidth, kOcclusionHeight);
+    CullingStage stage;
+    DynamicArray<uint32_t> visible;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        JobSystem* system = pass == 0 ? nullptr : jobs;
+        const char* mode = system ? "parallel" : "serial";
+        char name[128];
+
+        Stopwatch watch;
+        for (int r = 0; r < kRepeats; ++r) {
+            buffer.Begin(view_projection);
+            buffer.RasterizeOccluders(vertices.Data(), uint32_t(vertices.Size()), indices.Data(), triangles, system);
+            buffer.Finish(system);
+        }
+        snprintf(name, sizeof(name), "Rasterise occluders, %s", mode);
+        Report(name, watch.ElapsedNs(), kRepeats);
+
+        watch.Restart();
+        for (int r = 0; r < kRepeats; ++r) stage.Run(view_projection, scene.Bounds(), scene.Count(), &visible, system);
+        snprintf(name, sizeof(name), "Frustum only, %s", mode);
+        Report(name, watch.ElapsedNs(), kRepeats);
+
+        watch.Restart();
+        for (int r = 0; r < kRepeats; ++r) {
+            stage.Run(view_projection, scene.Bounds(), scene.Count(), &visible, system, &buffer);
+        }
+        snprintf(name, sizeof(name), "Frustum and occlusion, %s", mode);
+        Report(name, watch.ElapsedNs(), kRepeats);
+    }
+    printf("    %u in the frustum, %u left after occlusion\n", stage.Stats().in_frustum, stage.Stats().visible);
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? uint32_t(atoi(argv[1])) : 1000000;
+    uint32_t hardware = std::thread::hardware_concurrency();
+    uint32_t workers = argc > 2 ? uint32_t(atoi(argv[2])) : (hardware > 1 ? hardware - 1 : 1);
+    JobSystem jobs;
+    jobs.Init(workers);
+    printf("%u workers\n", workers);
+    srand(1);
+
+    RunFrustum(count, &jobs);
+    RunCity(&jobs);
+
+    jobs.Shutdown();
+    return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures frame graph compilation on a typical deferred frame (shadow
+// cascades, G-buffer, SSAO, lighting, bloom chain, TAA, post and debug
+// views that end up culled) and on large random graphs, and reports how
+// much memory transient aliasing saves.
+// Usage: FrameGraphBenchmarks [width] [height]
+
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi, rand, srand
+
+#include "benchmark.h"
+#include "frame_graph.h"
+
+using namespace toybox::rendering;
+using namespace toybox::benchmarks;
+
+static const int kCompiles = 1000;
+static const uint32_t kShadowCascades = 4;
+static const uint32_t kBloomLevels = 6;
+
+static FrameResourceDesc Texture(uint32_t width, uint32_t height, uint32_t bytes) {
+    return FrameResourceDesc{ FrameResourceKind::Texture, width, height, bytes };
+}
+
+static void DeclareDeferredFrame(FrameGraph& graph, uint32_t width, uint32_t height) {
+    FrameResource backbuffer = graph.Import("backbuffer", Texture(width, height, 4), ResourceState::Present);
+    FrameResource history = graph.Import("taa history", Texture(width, height, 8), ResourceState::ShaderRead);
+
+    FrameResource cascades[kShadowCascades];
+    for (uint32_t c = 0; c < kShadowCascades; ++c) {
+        cascades[c] = graph.CreateTransient("shadow cascade", Texture(2048, 2048, 4));
+        FramePass pass = graph.AddPass("shadow cascade");
+        graph.Write(pass, cascades[c], ResourceState::DepthWrite);
+    }
+
+    FrameResource depth = graph.CreateTransient("depth", Texture(width, height, 4));
+    FrameResource albedo = graph.CreateTransient("albedo", Texture(width, height, 4));
+    FrameResource normals = graph.CreateTransient("normals", Texture(width, height, 8));
+    FrameResource material = graph.CreateTransient("material", Texture(width, height, 4));
+    FrameResource velocity = graph.CreateTransient("velocity", Texture(width, height, 4));
+    FramePass gbuffer = graph.AddPass("gbuffer");
+    graph.Write(gbuffer, depth, ResourceState::DepthWrite);
+    graph.Write(gbuffer, albedo, ResourceState::RenderTarget);
+    graph.Write(gbuffer, normals, ResourceState::RenderTarget);
+    graph.Write(gbuffer, material, ResourceState::RenderTarget);
+    graph.Write(gbuffer, velocity, ResourceState::RenderTarget);
+
+    FrameResource ao = graph.CreateTransient("ssao", Texture(width / 2, height / 2, 1));
+    FrameResource ao_blur = graph.CreateTransient("ssao blur", Texture(width / 2, height / 2, 1));
+    FramePass ssao = graph.AddPass("ssao");
+    graph.Read(ssao, depth, ResourceState::ShaderRead);
+    graph.Read(ssao, normals, ResourceState::ShaderRead);
+    graph.Write(ssao, ao, ResourceState::UnorderedAccess);
+    FramePass blur = graph.AddPass("ssao blur");
+    graph.Read(blur, ao, ResourceState::ShaderRead);
+    graph.Write(blur, ao_blur, ResourceState::UnorderedAccess);
+
+    FrameResource hdr = graph.CreateTransient("hdr", Texture(width, height, 8));
+    FramePass lighting = graph.AddPass("lighting");
+    graph.Read(lighting, albedo, ResourceState::ShaderRead);
+    graph.Read(lighting, normals, ResourceState::ShaderRead);
+    graph.Read(lighting, material, ResourceState::ShaderRead);
+    graph.Read(lighting, depth, ResourceState::ShaderRead);
+    graph.Read(lighting, ao_blur, ResourceState::ShaderRead);
+    for (uint32_t c = 0; c < kShadowCascades; ++c) graph.Read(lighting, cascades[c], ResourceState::ShaderRead);
+    graph.Write(lighting, hdr, ResourceState::RenderTarget);
+
+    FramePass transparent = graph.AddPass("transparent");
+    graph.Read(transparent, hdr, ResourceState::RenderTarget);
+    graph.Read(transparent, depth, ResourceState::DepthRead);
+    graph.Write(transparent, hdr, ResourceState::RenderTarget);
+
+    FrameResource resolved = graph.CreateTransient("taa resolve", Texture(width, height, 8));
+    FramePass taa = graph.AddPass("taa");
+    graph.Read(taa, hdr, ResourceState::ShaderRead);
+    graph.Read(taa, velocity, ResourceState::ShaderRead);
+    graph.Read(taa, history, ResourceState::ShaderRead);
+    graph.Write(taa, resolved, ResourceState::RenderTarget);
+    FramePass history_copy = graph.AddPass("taa history copy");
+    graph.Read(history_copy, resolved, ResourceState::CopySource);
+    graph.Write(history_copy, history, ResourceState::CopyDest);
+
+    // Bloom: downsample to a chain of mips, then add them back up
+    FrameResource down[kBloomLevels];
+    FrameResource source = resolved;
+    for (uint32_t l = 0; l < kBloomLevels; ++l) {
+        down[l] = graph.CreateTransient("bloom down", Texture(width >> (l + 1), height >> (l + 1), 8));
+        FramePass pass = graph.AddPass("bloom downsample");
+        graph.Read(pass, source, ResourceState::ShaderRead);
+        graph.Write(pass, down[l], ResourceState::RenderTarget);
+        source = down[l];
+    }
+    for (uint32_t l = kBloomLevels - 1; l > 0; --l) {
+        FrameResource up = graph.CreateTransient("bloom up", Texture(width >> l, height >> l, 8));
+        FramePass pass = graph.AddPass("bloom upsample");
+        graph.Read(pass, source, ResourceState::ShaderRead);
+        graph.Read(pass, down[l - 1], ResourceState::ShaderRead);
+        graph.Write(pass, up, ResourceState::RenderTarget);
+        source = up;
+    }
+
+    FrameResource dof = graph.CreateTransient("depth of field", Texture(width, height, 8));
+    FramePass dof_pass = graph.AddPass("depth of field");
+    graph.Read(dof_pass, resolved, ResourceState::ShaderRead);
+    graph.Read(dof_pass, depth, ResourceState::ShaderRead);
+    graph.Write(dof_pass, dof, ResourceState::RenderTarget);
+
+    // Debug views nobody looks at this frame
+    const char* debug_names[] = { "debug normals", "debug overdraw", "debug cascades" };
+    for (const char* name : debug_names) {
+        FrameResource view = graph.CreateTransient(name, Texture(width, height, 4));
+        FramePass pass = graph.AddPass(name);
+        graph.Read(pass, normals, ResourceState::ShaderRead);
+        graph.Write(pass, view, ResourceState::RenderTarget);
+    }
+
+    FramePass tonemap = graph.AddPass("tonemap");
+    graph.Read(tonemap, dof, ResourceState::ShaderRead);
+    graph.Read(tonemap, source, ResourceState::ShaderRead);
+    graph.Write(tonemap, backbuffer, ResourceState::RenderTarget);
+    FramePass ui = graph.AddPass("ui");
+    graph.Read(ui, backbuffer, ResourceState::RenderTarget);
+    graph.Write(ui, backbuffer, ResourceState::RenderTarget);
+    FramePass present = graph.AddPass("present", true);
+    graph.Read(present, backbuffer, ResourceState::Present);
+}
+
+static void DeclareRandomGraph(FrameGraph& graph, uint32_t pass_count, uint32_t resource_count) {
+    FrameResource output = graph.Import("output", Texture(1920, 1080, 4), ResourceState::Undefined);
+    for (uint32_t r = 0; r < resource_count; ++r) {
+        graph.CreateTransient("transient", Texture(64u << (rand() % 5), 64u << (rand() % 5), 4));
+    }
+    for (uint32_t p = 0; p < pass_count; ++p) {
+        FramePass pass = graph.AddPass("pass", rand() % 50 == 0);
+        // Mostly reads of recent resources, like a real chain of passes
+        for (int a = rand() % 4; a > 0; --a) {
+            uint32_t near = (p * resource_count / pass_count + resource_count - uint32_t(rand()) % 8) % resource_count;
+            graph.Read(pass, 1 + near, ResourceState::ShaderRead);
+        }
+        graph.Write(pass, 1 + (p * resource_count / pass_count) % resource_count, ResourceState::RenderTarget);
+        if (p + 1 == pass_count) graph.Write(pass, output, ResourceState::RenderTarget);
+    }
+}
+
+static void ReportMemory(const FrameGraph& graph) {
+    double unaliased = double(graph.UnaliasedMemorySize()) / (1024.0 * 1024.0);
+    double aliased = double(graph.TransientMemorySize()) / (1024.0 * 1024.0);
+    printf("    %u of %u passes kept, transient memory %.1f MB aliased vs %.1f MB (%.0f%% saved)\n",
+           graph.ExecutionCount(), graph.PassCount(), aliased, unaliased,
+           unaliased > 0.0 ? (1.0 - aliased / unaliased) * 100.0 : 0.0);
+}
+
+int main(int argc, char** argv) {
+    uint32_t width = argc > 1 ? uint32_t(atoi(argv[1])) : 1920;
+    uint32_t height = argc > 2 ? uint32_t(atoi(argv[2])) : 1080;
+    srand(1);
+
+    FrameGraph graph;
+    char name[128];
+    snprintf(name, sizeof(name), "Deferred frame, %ux%u", width, height);
+    Section(name);
+    Stopwatch watch;
+    for (int i = 0; i < kCompiles; ++i) {
+        graph.Reset();
+        DeclareDeferredFrame(graph, width, height);
+    }
+    Report("Declare", watch.ElapsedNs(), kCompiles);
+    watch.Restart();
+    for (int i = 0; i < kCompiles; ++i) graph.Compile();
+    Report("Compile", watch.ElapsedNs(), kCompiles);
+    ReportMemory(graph);
+
+    const uint32_t sizes[][2] = { { 100, 60 }, { 500, 300 }, { 2000, 1000 } };
+    for (const auto& size : sizes) {
+        snprintf(name, sizeof(name), "Random graph, %u passes, %u resources", size[0], size[1]);
+        Section(name);
+        graph.Reset();
+        DeclareRandomGraph(graph, size[0], size[1]);
+        int compiles = int(kCompiles * 100 / size[0]);
+        watch.Restart();
+        for (int i = 0; i < compiles; ++i) graph.Compile();
+        Report("Compile", watch.ElapsedNs(), size_t(compiles));
+        ReportMemory(graph);
+    }
+    return 0;
+}
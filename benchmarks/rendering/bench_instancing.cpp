@@ -0,0 +1,160 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures draw extraction on the null backend: a crowd of toys sharing a
+// few dozen meshes and materials submitted one draw per object against
+// automatic instancing, and a static level merged into batches at load time
+// against drawing its pieces one by one.
+// Usage: InstancingBenchmarks [object_count] [worker_threads]
+
+#include <cmath>   // For cosf, sinf
+#include <cstdio>  // For printf
+#include <cstdlib> // For atoi, rand, srand
+#include <thread>  // For std::thread::hardware_concurrency
+
+#include "benchmark.h"
+#include "instancing.h"
+#include "job_system.h"
+
+using namespace toybox::rendering;
+using namespace toybox::math;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static const int kFrames = 20;
+static const uint32_t kMeshes = 40;
+static const uint32_t kMaterials = 25;
+static const uint32_t kPipelines = 4;
+static const uint32_t kStaticPieces = 20000;
+
+static float RandomRange(float low, float high) {
+    return low + (high - low) * (float(rand()) / float(RAND_MAX));
+}
+
+static void RunInstancing(uint32_t count, JobSystem* jobs) {
+    Section("Automatic instancing");
+    DynamicArray<uint32_t> mesh, material, pipeline, color, visible;
+    DynamicArray<Mat4> world;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t m = uint32_t(rand()) % kMaterials;
+        mesh.PushBack(uint32_t(rand()) % kMeshes);
+        material.PushBack(m);
+        pipeline.PushBack(m % kPipelines);
+        color.PushBack(uint32_t(rand()));
+        world.PushBack(Mat4Translation(Vec3{ RandomRange(-500.0f, 500.0f), 0.0f, RandomRange(-500.0f, 500.0f) }));
+        visible.PushBack(i);
+    }
+    DynamicArray<MeshRange> meshes;
+    for (uint32_t m = 0; m < kMeshes; ++m) meshes.PushBack(MeshRange{ m * 1000, 300 });
+    RenderObjects objects{ mesh.Data(), material.Data(), pipeline.Data(), world.Data(), color.Data() };
+
+    RenderQueue queue;
+    queue.Init(1);
+    NullBackend backend;
+
+    // One draw per object, sorted so state changes are already minimal
+    Stopwatch watch;
+    for (int f = 0; f < kFrames; ++f) {
+        queue.Clear();
+        CommandBuffer* recorder = queue.Recorder(0);
+        for (uint32_t i = 0; i < count; ++i) {
+            const MeshRange& range = meshes.Data()[mesh.Data()[i]];
+            recorder->Draw(MakeOpaqueKey(0, 0, pipeline.Data()[i], material.Data()[i], 0.0f),
+                           DrawPayload{ mesh.Data()[i], range.first_index, range.index_count, i, 1 });
+        }
+        queue.Sort();
+        backend.Reset();
+        queue.Execute(backend);
+    }
+    Report("One draw per object, per object", watch.ElapsedNs(), size_t(count) * kFrames);
+    printf("    %u draws, %u state changes\n", backend.draws, backend.pipeline_binds + backend.material_binds);
+
+    InstanceExtractor extractor;
+    for (int pass = 0; pass < 2; ++pass) {
+        JobSystem* system = pass == 0 ? nullptr : jobs;
+        watch.Restart();
+        for (int f = 0; f < kFrames; ++f) {
+            queue.Clear();
+            extractor.Extract(objects, visible.Data(), count, meshes.Data(), 0, 0, queue.Recorder(0), system);
+            queue.Sort();
+            backend.Reset();
+            queue.Execute(backend);
+        }
+        Report(system ? "Instanced, job system, per object" : "Instanced, one thread, per object", watch.ElapsedNs(),
+               size_t(count) * kFrames);
+    }
+    printf("    %u draws, %u state changes, %.1f MB of instance data\n", backend.draws,
+           backend.pipeline_binds + backend.material_binds,
+           double(extractor.InstanceCount() * sizeof(InstanceData)) / (1024.0 * 1024.0));
+}
+
+static void RunStaticBatching() {
+    Section("Static batch merging");
+    // A 12-sided column, the kind of prop a level repeats everywhere
+    const uint32_t sides = 12;
+    DynamicArray<Vec3> positions, normals;
+    DynamicArray<uint32_t> indices;
+    for (uint32_t s = 0; s < sides; ++s) {
+        float angle = 6.2831853f * float(s) / float(sides);
+        Vec3 out{ cosf(angle), 0.0f, sinf(angle) };
+        positions.PushBack(out * 0.5f);
+        positions.PushBack(out * 0.5f + Vec3{ 0.0f, 4.0f, 0.0f });
+        normals.PushBack(out);
+        normals.PushBack(out);
+        uint32_t a = s * 2, b = ((s + 1) % sides) * 2;
+        const uint32_t quad[6] = { a, b, b + 1, a, b + 1, a + 1 };
+        for (uint32_t index : quad) indices.PushBack(index);
+    }
+    MeshGeometry column{ positions.Data(), normals.Data(), uint32_t(positions.Size()), indices.Data(),
+                         uint32_t(indices.Size()) };
+
+    StaticBatcher batcher;
+    for (uint32_t i = 0; i < kStaticPieces; ++i) {
+        Vec3 place{ RandomRange(-400.0f, 400.0f), 0.0f, RandomRange(-400.0f, 400.0f) };
+        batcher.Add(0, uint32_t(rand()) % 8, 0, Mat4Translation(place));
+    }
+    Stopwatch watch;
+    batcher.Build(&column);
+    Report("Build per piece", watch.ElapsedNs(), kStaticPieces);
+    printf("    %u pieces merged into %u batches, %u vertices\n", kStaticPieces, batcher.BatchCount(),
+           batcher.VertexCount());
+
+    Mat4 camera = Mat4Perspective(1.0f, 16.0f / 9.0f, 0.5f, 1000.0f) *
+                  Mat4LookAt(Vec3{ 0.0f, 20.0f, 0.0f }, Vec3{ 100.0f, 0.0f, -100.0f }, Vec3{ 0.0f, 1.0f, 0.0f });
+    Frustum frustum = FrustumFromMatrix(camera);
+    RenderQueue queue;
+    queue.Init(1);
+    uint32_t submitted = 0;
+    watch.Restart();
+    for (int f = 0; f < kFrames; ++f) {
+        queue.Clear();
+        submitted = batcher.Submit(frustum, 0, 0, 0, queue.Recorder(0));
+        queue.Sort();
+    }
+    Report("Submit per frame", watch.ElapsedNs(), kFrames);
+    printf("    %u draws instead of up to %u\n", submitted, kStaticPieces);
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? uint32_t(atoi(argv[1])) : 100000;
+    uint32_t hardware = std::thread::hardware_concurrency();
+    uint32_t workers = argc > 2 ? uint32_t(atoi(argv[2])) : (hardware > 1 ? hardware - 1 : 1);
+    JobSystem jobs;
+    jobs.Init(workers);
+    printf("%u workers, %u objects, %u meshes, %u materials\n", workers, count, kMeshes, kMaterials);
+    srand(1);
+
+    RunInstancing(count, &jobs);
+    RunStaticBatching();
+
+    jobs.Shutdown();
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures the render command layer on the null backend: recording draws
+// from the job system's threads, merging and radix sorting them against
+// std::sort, and replaying them, with the state changes a backend would see
+// in recording order and in sorted order.
+// Usage: RenderQueueBenchmarks [draw_count] [worker_threads]
+
+#include <algorithm> // For std::sort
+#include <cstdio>    // For printf
+#include <cstdlib>   // For atoi, rand, srand
+#include <thread>    // For std::thread::hardware_concurrency
+#include <utility>   // For std::pair
+
+#include "benchmark.h"
+#include "job_system.h"
+#include "parallel_for.h"
+#include "render_queue.h"
+
+using namespace toybox::rendering;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static const int kFrames = 20;
+static const uint32_t kPipelines = 64;
+static const uint32_t kMaterials = 2048;
+
+struct Draw {
+    uint32_t pipeline;
+    uint32_t material;
+    float depth;
+    bool blended;
+};
+
+// State changes a backend would make replaying keys in the given order
+static uint32_t CountStateChanges(const uint64_t* keys, uint32_t count) {
+    uint32_t changes = 0;
+    uint32_t pipeline = ~0u;
+    uint32_t material = ~0u;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t next_pipeline = SortKeyPipeline(keys[i]);
+        uint32_t next_material = SortKeyMaterial(keys[i]);
+        if (next_pipeline != pipeline) {
+            pipeline = next_pipeline;
+            material = ~0u;
+            ++changes;
+        }
+        if (next_material != material) {
+            material = next_material;
+            ++changes;
+        }
+    }
+    return changes;
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? uint32_t(atoi(argv[1])) : 200000;
+    uint32_t hardware = std::thread::hardware_concurrency();
+    uint32_t workers = argc > 2 ? uint32_t(atoi(argv[2])) : (hardware > 1 ? hardware - 1 : 1);
+    JobSystem jobs;
+    jobs.Init(workers);
+    printf("%u workers, %u draws, %u pipelines, %u materials\n", workers, count, kPipelines, kMaterials);
+    srand(1);
+
+    // A tenth of the draws are blended; materials belong to one pipeline each
+    DynamicArray<Draw> scene;
+    scene.Resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t material = uint32_t(rand()) % kMaterials;
+        scene.Data()[i] = Draw{ material % kPipelines, material, float(rand()) / float(RAND_MAX), rand() % 10 == 0 };
+    }
+    const Draw* draws = scene.Data();
+
+    RenderQueue queue;
+    queue.Init(jobs.ThreadCount() + 1);
+    auto record = [&queue, &jobs, draws](size_t begin, size_t end) {
+        CommandBuffer* recorder = queue.Recorder(jobs.CurrentThreadIndex());
+        for (size_t i = begin; i < end; ++i) {
+            const Draw& draw = draws[i];
+            uint64_t key = draw.blended ? MakeBlendedKey(0, 0, draw.pipeline, draw.material, draw.depth)
+                                        : MakeOpaqueKey(0, 0, draw.pipeline, draw.material, draw.depth);
+            recorder->Draw(key, DrawPayload{ uint32_t(i), 0, 36, 0, 1 });
+        }
+    };
+
+    Section("Recording");
+    Stopwatch watch;
+    for (int f = 0; f < kFrames; ++f) {
+        queue.Clear();
+        record(0, count);
+    }
+    Report("Record per draw, one thread", watch.ElapsedNs(), size_t(count) * kFrames);
+    watch.Restart();
+    for (int f = 0; f < kFrames; ++f) {
+        queue.Clear();
+        toybox::utils::jobs::ParallelFor(&jobs, 0, count, record);
+    }
+    Report("Record per draw, job system", watch.ElapsedNs(), size_t(count) * kFrames);
+
+    Section("Sorting");
+    watch.Restart();
+    for (int f = 0; f < kFrames; ++f) queue.Sort(&jobs);
+    Report("Merge and radix sort per draw", watch.ElapsedNs(), size_t(count) * kFrames);
+
+    DynamicArray<std::pair<uint64_t, uint32_t>> pairs;
+    pairs.Resize(count);
+    DynamicArray<uint64_t> recorded_keys;
+    recorded_keys.Resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const Draw& draw = draws[i];
+        recorded_keys.Data()[i] = draw.blended ? MakeBlendedKey(0, 0, draw.pipeline, draw.material, draw.depth)
+                                               : MakeOpaqueKey(0, 0, draw.pipeline, draw.material, draw.depth);
+    }
+    double sort_ns = 0.0;
+    for (int f = 0; f < kFrames; ++f) {
+        for (uint32_t i = 0; i < count; ++i) pairs.Data()[i] = { recorded_keys.Data()[i], i };
+        watch.Restart();
+        std::sort(pairs.Data(), pairs.Data() + count);
+        sort_ns += watch.ElapsedNs();
+        DoNotOptimize(pairs.Data()[0]);
+    }
+    Report("std::sort per draw", sort_ns, size_t(count) * kFrames);
+
+    Section("Submission");
+    NullBackend backend;
+    watch.Restart();
+    for (int f = 0; f < kFrames; ++f) {
+        backend.Reset();
+        queue.Execute(backend);
+    }
+    Report("Execute per draw, null backend", watch.ElapsedNs(), size_t(count) * kFrames);
+    printf("    recording order: %u state changes\n", CountStateChanges(recorded_keys.Data(), count));
+    printf("    sorted order: %u state changes (%u pipeline, %u material binds)\n",
+           backend.pipeline_binds + backend.material_binds, backend.pipeline_binds, backend.material_binds);
+
+    jobs.Shutdown();
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures transform hierarchy updates: everything dirty versus only the
+// nodes that moved this frame.
+// Usage: SceneBenchmarks [node_count] [wide|balanced|deep] [moving_percent] [worker_threads]
+
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi, atof, rand
+#include <cstring> // For strcmp
+#include <thread>  // For std::thread::hardware_concurrency
+
+#include "benchmark.h"
+#include "job_system.h"
+#include "transform_hierarchy.h"
+
+using namespace toybox::scene;
+using namespace toybox::math;
+using namespace toybox::benchmarks;
+using toybox::utils::jobs::JobSystem;
+
+static const int kFrames = 50;
+
+static float RandomFloat(float range) {
+    return (static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f) * range;
+}
+
+static Transform RandomLocal() {
+    Transform local = TransformIdentity();
+    local.position = Vec3{ RandomFloat(10.0f), RandomFloat(10.0f), RandomFloat(10.0f) };
+    local.rotation = QuatFromAxisAngle(Vec3{ 0.0f, 1.0f, 0.0f }, RandomFloat(3.0f));
+    return local;
+}
+
+// Parent of node i for each tree shape, or -1 for a root
+static long ParentOf(const char* shape, size_t i, size_t count) {
+    if (strcmp(shape, "wide") == 0) {
+        // 64 roots with everything else directly below them
+        return i < 64 ? -1 : long(i % 64);
+    }
+    if (strcmp(shape, "deep") == 0) {
+        // Chains 256 nodes long
+        size_t chains = count / 256 > 0 ? count / 256 : 1;
+        return i < chains ? -1 : long(i - chains);
+    }
+    // Balanced: every node has four children
+    return i == 0 ? -1 : long((i - 1) / 4);
+}
+
+static void MoveSome(TransformHierarchy* hierarchy, SceneNode* nodes, size_t count, size_t moving) {
+    for (size_t m = 0; m < moving; ++m) {
+        hierarchy->SetLocal(nodes[size_t(rand()) % count], RandomLocal());
+    }
+}
+
+static void Measure(const char* label, TransformHierarchy* hierarchy, SceneNode* nodes, size_t count, size_t moving,
+                    bool everything, JobSystem* jobs) {
+    double total_ns = 0.0;
+    size_t updated = 0;
+    for (int frame = 0; frame < kFrames; ++frame) {
+        MoveSome(hierarchy, nodes, count, moving);
+        if (everything) hierarchy->MarkAllDirty();
+        Stopwatch watch;
+        hierarchy->Update(jobs);
+        total_ns += watch.ElapsedNs();
+        updated += hierarchy->LastUpdatedCount();
+    }
+
+    char name[128];
+    snprintf(name, sizeof(name), "%-24s %s", label, jobs ? "parallel" : "serial");
+    Report(name, total_ns, kFrames);
+    printf("%-52s %12.1f us/frame %9zu nodes/frame\n", "", total_ns / kFrames / 1000.0, updated / kFrames);
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? size_t(atoi(argv[1])) : 100000;
+    const char* shape = argc > 2 ? argv[2] : "balanced";
+    double moving_percent = argc > 3 ? atof(argv[3]) : 1.0;
+    uint32_t hardware = std::thread::hardware_concurrency();
+    uint32_t workers = argc > 4 ? uint32_t(atoi(argv[4])) : (hardware > 1 ? hardware - 1 : 1);
+    size_t moving = size_t(double(count) * moving_percent / 100.0);
+
+    TransformHierarchy hierarchy;
+    SceneNode* nodes = new SceneNode[count];
+    for (size_t i = 0; i < count; ++i) {
+        long parent = ParentOf(shape, i, count);
+        nodes[i] = hierarchy.Create(parent < 0 ? kNoNode : nodes[parent], RandomLocal());
+    }
+    Stopwatch build;
+    hierarchy.Update();
+
+    printf("%zu nodes, %s tree, %u levels, %zu moving per frame, %u workers\n", count, shape,
+           hierarchy.LevelCount(), moving, workers);
+    printf("Initial sort and update: %.2f ms\n", build.ElapsedMs());
+
+    JobSystem jobs;
+    jobs.Init(workers);
+
+    Section("Static scene");
+    Measure("Nothing moved", &hierarchy, nodes, count, 0, false, nullptr);
+
+    Section("Moving nodes");
+    Measure("Full update", &hierarchy, nodes, count, moving, true, nullptr);
+    Measure("Full update", &hierarchy, nodes, count, moving, true, &jobs);
+    Measure("Dirty only", &hierarchy, nodes, count, moving, false, nullptr);
+    Measure("Dirty only", &hierarchy, nodes, count, moving, false, &jobs);
+
+    jobs.Shutdown();
+    delete[] nodes;
+    return 0;
+}
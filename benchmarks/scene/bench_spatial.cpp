@@ -0,0 +1,243 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures spatial index build, update and query throughput: the dynamic
+// BVH and the hash grid.
+// Usage: SpatialBenchmarks [object_count] [worker_threads]
+// Without an object count, runs 10K, 100K and 1M objects.
+
+#include <cstdio>  // For printf, snprintf
+#include <cstdlib> // For atoi, rand
+#include <thread>  // For std::thread::hardware_concurrency
+
+#include "benchmark.h"
+#include "dynamic_bvh.h"
+#include "job_system.h"
+#include "spatial_hash_grid.h"
+
+using namespace toybox::scene;
+using namespace toybox::math;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static const size_t kQueries = 1000;
+static const size_t kRays = 10000;
+static const int kUpdateFrames = 10;
+
+static float RandomFloat(float range) {
+    return (static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f) * range;
+}
+
+// Objects spread so density stays roughly constant as the count grows
+static float WorldExtent(size_t count) {
+    float extent = 10.0f;
+    while (extent * extent * extent < float(count) * 64.0f) extent *= 1.25f;
+    return extent;
+}
+
+static Aabb RandomBox(float extent) {
+    Vec3 min{ RandomFloat(extent), RandomFloat(extent), RandomFloat(extent) };
+    return Aabb{ min, min + Vec3{ 1.0f, 1.0f, 1.0f } };
+}
+
+static void Run(size_t count, JobSystem* jobs) {
+    float extent = WorldExtent(count);
+    char name[128];
+    snprintf(name, sizeof(name), "%zu objects in a %.0f unit cube", count, extent * 2.0f);
+    Section(name);
+
+    Aabb* boxes = new Aabb[count];
+    uint32_t* proxies = new uint32_t[count];
+    for (size_t i = 0; i < count; ++i) boxes[i] = RandomBox(extent);
+
+    DynamicBvh bvh(0.2f);
+    Stopwatch watch;
+    for (size_t i = 0; i < count; ++i) proxies[i] = bvh.CreateProxy(boxes[i], uint32_t(i));
+    Report("Insert", watch.ElapsedNs(), count);
+    printf("Tree height %u\n", bvh.Height());
+
+    // Every object drifts a little; one in a hundred jumps somewhere new
+    size_t reinserted = 0;
+    watch.Restart();
+    for (int frame = 0; frame < kUpdateFrames; ++frame) {
+        for (size_t i = 0; i < count; ++i) {
+            Vec3 delta = i % 100 == 0 ? Vec3{ RandomFloat(extent), 0.0f, 0.0f } : Vec3{ 0.05f, 0.0f, 0.0f };
+            boxes[i] = Aabb{ boxes[i].min + delta, boxes[i].max + delta };
+            reinserted += bvh.MoveProxy(proxies[i], boxes[i], delta) ? 1 : 0;
+        }
+    }
+    Report("Move (all objects)", watch.ElapsedNs(), count * kUpdateFrames);
+    printf("%.1f%% of moves reinserted a leaf\n", 100.0 * double(reinserted) / double(count * kUpdateFrames));
+
+    size_t found = 0;
+    watch.Restart();
+    for (size_t q = 0; q < kQueries; ++q) {
+        Aabb query = RandomBox(extent);
+        query.max = query.max + Vec3{ 8.0f, 8.0f, 8.0f };
+        bvh.QueryBox(query, [&found](uint32_t) {
+            ++found;
+            return true;
+        });
+    }
+    Report("Box query", watch.ElapsedNs(), kQueries);
+    if (count <= 100000) {
+        size_t brute = 0;
+        watch.Restart();
+        for (size_t q = 0; q < kQueries / 10; ++q) {
+            Aabb query = RandomBox(extent);
+            query.max = query.max + Vec3{ 8.0f, 8.0f, 8.0f };
+            for (size_t i = 0; i < count; ++i) brute += Overlaps(boxes[i], query) ? 1 : 0;
+        }
+        Report("Box query (linear scan)", watch.ElapsedNs(), kQueries / 10);
+        DoNotOptimize(brute);
+    }
+    DoNotOptimize(found);
+
+    Ray* rays = new Ray[kRays];
+    RayHit* hits = new RayHit[kRays];
+    for (size_t r = 0; r < kRays; ++r) {
+        Vec3 direction = Normalize(Vec3{ RandomFloat(1.0f), RandomFloat(1.0f), RandomFloat(1.0f) });
+        rays[r] = Ray{ Vec3{ RandomFloat(extent), RandomFloat(extent), RandomFloat(extent) }, direction, extent };
+    }
+    watch.Restart();
+    bvh.RayCastBatch(rays, hits, kRays);
+    Report("Closest ray hit serial", watch.ElapsedNs(), kRays);
+    watch.Restart();
+    bvh.RayCastBatch(rays, hits, kRays, jobs);
+    Report("Closest ray hit parallel", watch.ElapsedNs(), kRays);
+
+    // Main camera plus three shadow cascades, all looking into the middle
+    Frustum frustums[4];
+    DynamicArray<uint32_t> visible[4];
+    for (int f = 0; f < 4; ++f) {
+        Mat4 projection = Mat4Perspective(0.8f, 16.0f / 9.0f, 0.1f, extent * (0.25f + 0.25f * float(f)));
+        frustums[f] = FrustumFromMatrix(projection * Mat4LookAt(Vec3{ 0.0f, 0.0f, extent }, Vec3{ 0.0f, 0.0f, 0.0f },
+                                                                Vec3{ 0.0f, 1.0f, 0.0f }));
+    }
+    watch.Restart();
+    bvh.QueryFrustums(frustums, visible, 4, jobs);
+    snprintf(name, sizeof(name), "Frustum query x4 (%zu visible)",
+             visible[0].Size() + visible[1].Size() + visible[2].Size() + visible[3].Size());
+    Report(name, watch.ElapsedNs(), 4);
+
+    uint32_t nearest[8];
+    float distances[8];
+    watch.Restart();
+    for (size_t q = 0; q < kQueries; ++q) {
+        bvh.KNearest(Vec3{ RandomFloat(extent), RandomFloat(extent), RandomFloat(extent) }, 8, nearest, distances);
+    }
+    Report("8 nearest", watch.ElapsedNs(), kQueries);
+
+    delete[] rays;
+    delete[] hits;
+    delete[] boxes;
+    delete[] proxies;
+}
+
+// A roguelike frame: every agent steps, the grid is rebuilt, and every agent
+// looks for neighbours within a few tiles
+static void RunGrid(size_t count, JobSystem* jobs) {
+    const float kWorld = 1000.0f;
+    const float kSightRadius = 6.0f;
+    char name[128];
+    snprintf(name, sizeof(name), "Hash grid, %zu agents on %.0fx%.0f tiles", count, kWorld, kWorld);
+    Section(name);
+
+    float* x = new float[count];
+    float* y = new float[count];
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = (RandomFloat(1.0f) + 1.0f) * 0.5f * kWorld;
+        y[i] = (RandomFloat(1.0f) + 1.0f) * 0.5f * kWorld;
+    }
+
+    SpatialHashGrid grid(kSightRadius);
+    for (int pass = 0; pass < 2; ++pass) {
+        JobSystem* system = pass == 0 ? nullptr : jobs;
+        double build_ns = 0.0;
+        double query_ns = 0.0;
+        size_t neighbours = 0;
+        for (int frame = 0; frame < kUpdateFrames; ++frame) {
+            for (size_t i = 0; i < count; ++i) {
+                x[i] += float(rand() % 3 - 1);
+                y[i] += float(rand() % 3 - 1);
+            }
+
+            Stopwatch watch;
+            grid.Build(x, y, uint32_t(count), system);
+            build_ns += watch.ElapsedNs();
+
+            watch.Restart();
+            for (size_t i = 0; i < count; ++i) {
+                grid.QueryRadius(x[i], y[i], kSightRadius, [&neighbours](uint32_t) {
+                    ++neighbours;
+                    return true;
+                });
+            }
+            query_ns += watch.ElapsedNs();
+        }
+
+        snprintf(name, sizeof(name), "Rebuild %s", system ? "parallel" : "serial");
+        Report(name, build_ns, kUpdateFrames);
+        Report("Radius query per agent", query_ns, count * kUpdateFrames);
+        printf("Frame: %.2f ms, %.1f neighbours per agent\n", (build_ns + query_ns) / kUpdateFrames / 1e6,
+               double(neighbours) / double(count * kUpdateFrames));
+    }
+
+    // The same neighbour sets from one pass over the grid, counting each pair
+    // for both agents
+    double pair_ns = 0.0;
+    size_t pairs = 0;
+    for (int frame = 0; frame < kUpdateFrames; ++frame) {
+        Stopwatch watch;
+        grid.Build(x, y, uint32_t(count));
+        grid.ForEachPair(kSightRadius, [&pairs](uint32_t, uint32_t) { ++pairs; });
+        pair_ns += watch.ElapsedNs();
+    }
+    printf("Frame with pair pass: %.2f ms, %.1f neighbours per agent\n", pair_ns / kUpdateFrames / 1e6,
+           double(pairs * 2 + count * kUpdateFrames) / double(count * kUpdateFrames));
+
+    size_t visible = 0;
+    Stopwatch watch;
+    for (size_t i = 0; i < kQueries; ++i) {
+        float tx = x[i] + RandomFloat(20.0f);
+        float ty = y[i] + RandomFloat(20.0f);
+        grid.QueryLine(x[i], y[i], tx, ty, [&visible](uint32_t) {
+            ++visible;
+            return false;
+        });
+    }
+    Report("Line query (first blocker)", watch.ElapsedNs(), kQueries);
+    DoNotOptimize(visible);
+
+    delete[] x;
+    delete[] y;
+}
+
+int main(int argc, char** argv) {
+    uint32_t hardware = std::thread::hardware_concurrency();
+    uint32_t workers = argc > 2 ? uint32_t(atoi(argv[2])) : (hardware > 1 ? hardware - 1 : 1);
+    JobSystem jobs;
+    jobs.Init(workers);
+    printf("%u workers\n", workers);
+
+    if (argc > 1) {
+        Run(size_t(atoi(argv[1])), &jobs);
+        RunGrid(size_t(atoi(argv[1])), &jobs);
+    } else {
+        Run(10000, &jobs);
+        Run(100000, &jobs);
+        Run(1000000, &jobs);
+        RunGrid(100000, &jobs);
+    }
+
+    jobs.Shutdown();
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures what the script profiler costs in each mode, on a call-heavy
+// script (recursive fib) and a loop-heavy one with few calls.
+// Usage: ScriptProfilerBenchmarks [fib_n] [folded_stacks_path]
+
+#include <cstdio>  // For printf
+#include <cstdlib> // For abort, atoi
+#include <cstring> // For strlen
+
+#include "benchmark.h"
+#include "scripting_integration.h"
+
+using namespace toybox::scripting;
+using namespace toybox::benchmarks;
+
+static const int kRuns = 10;
+
+static const char* kScript = "fn fib(n) {\n"
+                             "    if (n < 2) { return n; }\n"
+                             "    return fib(n - 1) + fib(n - 2);\n"
+                             "}\n"
+                             "fn step(x) { return x * 0.5 + 1; }\n"
+                             "fn loop(n) {\n"
+                             "    let total = 0;\n"
+                             "    let i = 0;\n"
+                             "    while (i < n) {\n"
+                             "        total = total + i * 0.5 - total * 0.001;\n"
+                             "        if (i % 1000 == 0) { total = step(total); }\n"
+                             "        i = i + 1;\n"
+                             "    }\n"
+                             "    return total;\n"
+                             "}\n";
+
+static const char* ModeName(ProfileMode mode) {
+    switch (mode) {
+    case ProfileMode::Off: return "off";
+    case ProfileMode::Instrument: return "instrument";
+    case ProfileMode::Sample: return "sample, 1 ms";
+    }
+    return "?";
+}
+
+static void Measure(ScriptingSystem& system, Script script, const char* function, double argument, size_t calls) {
+    const ProfileMode modes[] = { ProfileMode::Off, ProfileMode::Instrument, ProfileMode::Sample };
+    double off_ns = 0.0;
+    for (ProfileMode mode : modes) {
+        system.Profiler().Reset();
+        system.Profiler().SetMode(mode);
+        Value value = NumberValue(argument);
+        Value result;
+        bool ok = true;
+        Stopwatch watch;
+        for (int run = 0; run < kRuns; ++run) ok &= system.Call(script, function, &value, 1, &result);
+        double elapsed = watch.ElapsedNs();
+        system.Profiler().SetMode(ProfileMode::Off);
+        if (!ok) {
+            printf("Call failed: %s\n", system.Error());
+            abort();
+        }
+        DoNotOptimize(result.number);
+
+        char name[96];
+        snprintf(name, sizeof(name), "Profiler %s, per script call", ModeName(mode));
+        Report(name, elapsed, calls * kRuns);
+        if (mode == ProfileMode::Off) off_ns = elapsed;
+        else printf("    %.2fx the time with the profiler off, %llu samples\n", elapsed / off_ns,
+                    (unsigned long long)system.Profiler().SampleCount());
+    }
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 25;
+    const char* folded_path = argc > 2 ? argv[2] : nullptr;
+
+    ScriptingSystem system;
+    Script script = system.Load("bench", kScript, strlen(kScript));
+    if (script == kNoScript) {
+        printf("Load failed: %s\n", system.Error());
+        abort();
+    }
+
+    // fib(n) makes fib(n + 1) * 2 - 1 calls
+    size_t fib_calls = 1, a = 1, b = 1;
+    for (int i = 2; i <= n + 1; ++i) {
+        size_t next = a + b;
+        a = b;
+        b = next;
+    }
+    fib_calls = 2 * b - 1;
+
+    char title[96];
+    snprintf(title, sizeof(title), "fib(%d), %zu calls", n, fib_calls);
+    Section(title);
+    Measure(system, script, "fib", n, fib_calls);
+
+    const double iterations = 2000000;
+    Section("Loop of 2M iterations, a call every 1000");
+    Measure(system, script, "loop", iterations, size_t(iterations / 1000));
+
+    if (folded_path) {
+        system.Profiler().Reset();
+        system.Profiler().SetMode(ProfileMode::Sample, 100);
+        Value value = NumberValue(n);
+        Value result;
+        for (int run = 0; run < kRuns; ++run) system.Call(script, "fib", &value, 1, &result);
+        system.Profiler().SetMode(ProfileMode::Off);
+        if (!system.Profiler().ExportFoldedStacks(folded_path)) printf("Could not write %s\n", folded_path);
+        else printf("\nFolded stacks written to %s\n", folded_path);
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Runs a script-heavy frame: every agent builds a few short-lived vectors,
+// and each frame keeps one result in a history the host holds on to. The
+// same frames run with the default nursery, one too small for a frame, and
+// none, where every array goes to the pools and only major collections
+// free them.
+// Usage: ScriptHeapBenchmarks [agents] [frames]
+
+#include <algorithm> // For std::sort
+#include <cstdio>    // For printf
+#include <cstdlib>   // For abort, atoi
+#include <cstring>   // For strlen
+#include <vector>    // For std::vector
+
+#include "benchmark.h"
+#include "scripting_integration.h"
+
+using namespace toybox::scripting;
+using namespace toybox::benchmarks;
+
+static const int kWarmupFrames = 20;
+
+static const char* kScript = "fn vadd(a, b) { return [a[0] + b[0], a[1] + b[1], a[2] + b[2]]; }\n"
+                             "fn vscale(a, s) { return [a[0] * s, a[1] * s, a[2] * s]; }\n"
+                             "fn history(n) { return array(n); }\n"
+                             "fn frame(agents, history, tick) {\n"
+                             "    let centre = [0, 0, 0];\n"
+                             "    let i = 0;\n"
+                             "    while (i < agents) {\n"
+                             "        let position = [i % 100, i % 37, 0];\n"
+                             "        let velocity = vscale([1, 0.5, 0.25], 0.016);\n"
+                             "        centre = vadd(centre, vadd(position, velocity));\n"
+                             "        i = i + 1;\n"
+                             "    }\n"
+                             "    history[tick % len(history)] = [centre, tick];\n"
+                             "    return centre[0];\n"
+                             "}\n";
+
+static uint64_t Percentile(std::vector<uint64_t>& values, double fraction) {
+    std::sort(values.begin(), values.end());
+    size_t index = size_t(fraction * double(values.size() - 1) + 0.5);
+    return values[index];
+}
+
+static void Measure(const char* name, size_t nursery_bytes, int agents, int frames) {
+    ScriptingSystem system;
+    system.Heap().SetNurseryBytes(nursery_bytes);
+    Script script = system.Load("agents", kScript, strlen(kScript));
+    if (script == kNoScript) {
+        printf("Load failed: %s\n", system.Error());
+        abort();
+    }
+    uint32_t function = uint32_t(system.FindFunction(script, "frame"));
+    Value size = NumberValue(256);
+    Value history;
+    if (!system.Call(script, "history", &size, 1, &history)) abort();
+    system.Heap().AddRoot(&history);
+
+    Value arguments[3] = { NumberValue(agents), history, NumberValue(0) };
+    auto run_frame = [&](int tick) {
+        arguments[1] = history;
+        arguments[2] = NumberValue(tick);
+        Value result;
+        if (!system.Call(script, function, arguments, 3, &result)) {
+            printf("Call failed: %s\n", system.Error());
+            abort();
+        }
+        DoNotOptimize(result.number);
+    };
+
+    int tick = 0;
+    for (; tick < kWarmupFrames; ++tick) {
+        run_frame(tick);
+        system.EndFrame();
+    }
+
+    ScriptHeapStats before = system.Heap().Stats();
+    std::vector<uint64_t> pauses;
+    pauses.reserve(size_t(frames));
+    uint64_t allocations = 0;
+    double script_ns = 0.0;
+    for (int f = 0; f < frames; ++f, ++tick) {
+        Stopwatch watch;
+        run_frame(tick);
+        script_ns += watch.ElapsedNs();
+        system.EndFrame();
+        ScriptHeapStats stats = system.Heap().Stats();
+        pauses.push_back(stats.last_pause_ns);
+        allocations += stats.frame_allocations;
+    }
+    ScriptHeapStats after = system.Heap().Stats();
+
+    Section(name);
+    Report("Script frame", script_ns, size_t(frames));
+    printf("    %.0f script allocations per frame, %.2f system allocations per frame\n",
+           double(allocations) / frames, double(after.system_allocations - before.system_allocations) / frames);
+    printf("    %.1f promoted per frame, %.0f made old with the nursery full\n",
+           double(after.promoted_objects - before.promoted_objects) / frames,
+           double(after.nursery_overflows - before.nursery_overflows) / frames);
+    printf("    %llu minor and %llu major collections, %.1f KB old at the end\n",
+           (unsigned long long)(after.minor_collections - before.minor_collections),
+           (unsigned long long)(after.major_collections - before.major_collections), after.old_bytes / 1024.0);
+    uint64_t max_pause = Percentile(pauses, 1.0);
+    printf("    Pause p50 %.1f us, p99 %.1f us, max %.1f us\n", Percentile(pauses, 0.5) / 1e3,
+           Percentile(pauses, 0.99) / 1e3, max_pause / 1e3);
+    system.Heap().RemoveRoot(&history);
+}
+
+int main(int argc, char** argv) {
+    int agents = argc > 1 ? atoi(argv[1]) : 1000;
+    int frames = argc > 2 ? atoi(argv[2]) : 600;
+    printf("%d agents, %d frames\n", agents, frames);
+
+    Measure("Nursery of 1 MB, the default", kScriptNurseryBytes, agents, frames);
+    Measure("Nursery of 64 KB, smaller than a frame", 64 * 1024, agents, frames);
+    Measure("No nursery, pools only", 0, agents, frames);
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures what crossing into a script costs per Toy: the same movement
+// function called once per Toy, over views one row long, against a script
+// Work that calls it once per block with views over the whole columns. The
+// same update written in C++ is the floor.
+// Usage: ScriptWorkBenchmarks [toy_count]
+
+#include <cstdio>  // For printf
+#include <cstdlib> // For abort, atoi
+#include <cstring> // For strlen
+
+#include "benchmark.h"
+#include "script_work.h"
+
+using namespace toybox::scripting;
+using namespace toybox::benchmarks;
+using toybox::ecs::PartRegistry;
+using toybox::ecs::Toy;
+using toybox::ecs::World;
+
+struct Position {
+    float x, y, z;
+};
+
+struct Velocity {
+    float x, y, z;
+};
+
+struct Health {
+    int32_t value;
+};
+
+typedef PartRegistry<Position, Velocity, Health> BenchParts;
+typedef World<BenchParts> BenchWorld;
+
+static const int kFrames = 30;
+static const float kDt = 1.0f / 60.0f;
+
+static const char* kScript = "fn move(count, dt, px, py, vx, vy) {\n"
+                             "    let i = 0;\n"
+                             "    while (i < count) {\n"
+                             "        px[i] = px[i] + vx[i] * dt;\n"
+                             "        vy[i] = vy[i] - 10 * dt;\n"
+                             "        py[i] = py[i] + vy[i] * dt;\n"
+                             "        i = i + 1;\n"
+                             "    }\n"
+                             "}\n";
+
+static void BuildWorld(BenchWorld& world, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        Toy toy = world.Create();
+        world.Add<Position>(toy, Position{ float(i % 1000), 100.0f, 0.0f });
+        world.Add<Velocity>(toy, Velocity{ 1.0f, 0.0f, 0.0f });
+        if (i % 4 == 0) world.Add<Health>(toy, Health{ 100 });
+    }
+}
+
+static float Checksum(BenchWorld& world) {
+    float sum = 0.0f;
+    world.EachBlock<const Position>([&sum](uint32_t count, const Toy*, const Position* positions) {
+        for (uint32_t i = 0; i < count; ++i) sum += positions[i].x + positions[i].y;
+    });
+    return sum;
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? uint32_t(atoi(argv[1])) : 100000;
+    printf("%u toys, %d frames\n", count, kFrames);
+
+    ScriptingSystem system;
+    Script script = system.Load("movement", kScript, strlen(kScript));
+    if (script == kNoScript) {
+        printf("Load failed: %s\n", system.Error());
+        abort();
+    }
+    const size_t updates = size_t(count) * kFrames;
+
+    Section("Movement update, per Toy");
+    {
+        BenchWorld world;
+        BuildWorld(world, count);
+        Stopwatch watch;
+        for (int f = 0; f < kFrames; ++f) {
+            world.EachBlock<Position, Velocity>(
+                [](uint32_t rows, const Toy*, Position* positions, Velocity* velocities) {
+                    for (uint32_t i = 0; i < rows; ++i) {
+                        positions[i].x += velocities[i].x * kDt;
+                        velocities[i].y -= 10.0f * kDt;
+                        positions[i].y += velocities[i].y * kDt;
+                    }
+                });
+        }
+        Report("C++", watch.ElapsedNs(), updates);
+        DoNotOptimize(Checksum(world));
+    }
+
+    {
+        // One call per Toy, each given views of just that Toy's row
+        BenchWorld world;
+        BuildWorld(world, count);
+        uint32_t function = uint32_t(system.FindFunction(script, "move"));
+        ScriptView views[4] = {};
+        Value arguments[6] = { NumberValue(1), NumberValue(kDt) };
+        for (int v = 0; v < 4; ++v) {
+            views[v] = ScriptView{ nullptr, 1, 0, ViewElement::Float32, false };
+            arguments[2 + v] = ViewValue(&views[v]);
+        }
+        bool ok = true;
+        Stopwatch watch;
+        for (int f = 0; f < kFrames; ++f) {
+            world.EachBlock<Position, Velocity>(
+                [&](uint32_t rows, const Toy*, Position* positions, Velocity* velocities) {
+                    for (uint32_t i = 0; i < rows; ++i) {
+                        views[0].data = reinterpret_cast<uint8_t*>(&positions[i].x);
+                        views[1].data = reinterpret_cast<uint8_t*>(&positions[i].y);
+                        views[2].data = reinterpret_cast<uint8_t*>(&velocities[i].x);
+                        views[3].data = reinterpret_cast<uint8_t*>(&velocities[i].y);
+                        Value result;
+                        ok &= system.Call(script, function, arguments, 6, &result);
+                    }
+                });
+        }
+        Report("Script call per Toy", watch.ElapsedNs(), updates);
+        if (!ok) printf("    failed: %s\n", system.Error());
+        DoNotOptimize(Checksum(world));
+    }
+
+    {
+        BenchWorld world;
+        BuildWorld(world, count);
+        ScriptWork<BenchParts, Position, Velocity> movement(system, script, "move");
+        movement.BindField(&Position::x);
+        movement.BindField(&Position::y);
+        movement.BindField(&Velocity::x);
+        movement.BindField(&Velocity::y);
+        Value dt = NumberValue(kDt);
+        bool ok = true;
+        Stopwatch watch;
+        for (int f = 0; f < kFrames; ++f) ok &= movement.Run(world, &dt, 1);
+        Report("Script Work, one call per block", watch.ElapsedNs(), updates);
+        printf("    %u script calls per frame for %u toys\n", movement.BlockCount(), movement.RowCount());
+        if (!ok) printf("    failed: %s\n", system.Error());
+        DoNotOptimize(Checksum(world));
+    }
+    return 0;
+}
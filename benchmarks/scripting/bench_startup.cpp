@@ -0,0 +1,163 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures script startup over a generated corpus: a cold start that
+// compiles everything and writes the bytecode cache, a warm start that links
+// every script straight from the mapped cache, and the compiler on its own.
+// Usage: ScriptingBenchmarks [script_count] [cache_path]
+
+#include <cstdio>  // For printf, snprintf, remove
+#include <cstdlib> // For abort, atoi
+
+#include "benchmark.h"
+#include "dynamicarray.h"
+#include "dynamicstring.h"
+#include "scripting_integration.h"
+
+using namespace toybox::scripting;
+using namespace toybox::benchmarks;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::data_structures::DynamicString;
+
+static const int kRuns = 5;
+
+static bool Clamp(void*, const Value* arguments, uint32_t count, Value* result) {
+    if (count != 1 || arguments[0].type != ValueType::Number) return false;
+    double value = arguments[0].number;
+    *result = NumberValue(value < 0.0 ? 0.0 : value > 100.0 ? 100.0 : value);
+    return true;
+}
+
+// A script of a few dozen lines, its constants varied so no two are alike
+static DynamicString MakeScript(uint32_t seed) {
+    char buffer[2048];
+    snprintf(buffer, sizeof(buffer),
+             "fn update(health, dt) {\n"
+             "    let regen = %u.5 * dt;\n"
+             "    if (health < %u) { regen = regen * 2; }\n"
+             "    return clamp(health + regen);\n"
+             "}\n"
+             "fn damage(health, amount, armour) {\n"
+             "    let taken = amount - armour * 0.%u;\n"
+             "    if (taken < 0) { taken = 0; }\n"
+             "    return clamp(health - taken);\n"
+             "}\n"
+             "fn score(kills, time) {\n"
+             "    let total = 0;\n"
+             "    let i = 0;\n"
+             "    while (i < kills) {\n"
+             "        total = total + %u + i %% 7;\n"
+             "        i = i + 1;\n"
+             "    }\n"
+             "    if (time > %u && total > 0) { total = total / 2; }\n"
+             "    return total;\n"
+             "}\n"
+             "fn think(distance, angle) {\n"
+             "    if (distance < %u.0 || angle * angle < 0.25) { return 1; }\n"
+             "    else if (distance > 500) { return -1; }\n"
+             "    return 0;\n"
+             "}\n",
+             seed % 9 + 1, seed % 50 + 10, seed % 10, seed % 100 + 1, seed % 300 + 60, seed % 20 + 2);
+    return DynamicString(buffer);
+}
+
+struct Corpus {
+    DynamicArray<DynamicString> names;
+    DynamicArray<DynamicString> sources;
+    size_t bytes;
+};
+
+static void BuildCorpus(Corpus& corpus, uint32_t count) {
+    corpus.bytes = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        char name[64];
+        snprintf(name, sizeof(name), "scripts/actor_%05u.ember", i);
+        corpus.names.PushBack(DynamicString(name));
+        corpus.sources.PushBack(MakeScript(i * 2654435761u));
+        corpus.bytes += corpus.sources.Back().Length();
+    }
+}
+
+// Loads the whole corpus as a game start would, returning the stats
+static ScriptLoadStats Start(const Corpus& corpus, const char* cache_path, bool save) {
+    ScriptingSystem system;
+    system.RegisterNative("clamp", Clamp, nullptr);
+    if (cache_path) system.OpenCache(cache_path);
+    for (size_t i = 0; i < corpus.names.Size(); ++i) {
+        const DynamicString& source = corpus.sources.Data()[i];
+        if (system.Load(corpus.names.Data()[i].CStr(), source.CStr(), source.Length()) == kNoScript) {
+            printf("Load failed: %s\n", system.Error());
+            abort();
+        }
+    }
+    if (save) system.SaveCache();
+    return system.LoadStats();
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? uint32_t(atoi(argv[1])) : 1000;
+    const char* cache_path = argc > 2 ? argv[2] : "scripting_bench.ebc";
+    Corpus corpus;
+    BuildCorpus(corpus, count);
+    printf("%u scripts, %zu bytes of source\n", count, corpus.bytes);
+
+    Section("Compiler only");
+    {
+        DynamicArray<uint8_t> blob;
+        CompileError error;
+        size_t blob_bytes = 0;
+        Stopwatch watch;
+        for (int run = 0; run < kRuns; ++run) {
+            for (size_t i = 0; i < corpus.sources.Size(); ++i) {
+                const DynamicString& source = corpus.sources.Data()[i];
+                CompileScript(source.CStr(), source.Length(), &blob, &error);
+                blob_bytes += blob.Size();
+            }
+        }
+        Report("Compile, per script", watch.ElapsedNs(), size_t(count) * kRuns);
+        printf("    %zu bytes of bytecode per run\n", blob_bytes / kRuns);
+    }
+
+    Section("Startup");
+    {
+        double cold = 0.0;
+        for (int run = 0; run < kRuns; ++run) {
+            remove(cache_path);
+            Stopwatch watch;
+            ScriptLoadStats stats = Start(corpus, cache_path, true);
+            cold += watch.ElapsedNs();
+            DoNotOptimize(stats);
+        }
+        Report("Cold start, compile and save, per script", cold, size_t(count) * kRuns);
+
+        double uncached = 0.0;
+        for (int run = 0; run < kRuns; ++run) {
+            Stopwatch watch;
+            ScriptLoadStats stats = Start(corpus, nullptr, false);
+            uncached += watch.ElapsedNs();
+            DoNotOptimize(stats);
+        }
+        Report("No cache, compile, per script", uncached, size_t(count) * kRuns);
+
+        double warm = 0.0;
+        ScriptLoadStats stats = {};
+        for (int run = 0; run < kRuns; ++run) {
+            Stopwatch watch;
+            stats = Start(corpus, cache_path, false);
+            warm += watch.ElapsedNs();
+        }
+        Report("Warm start, from the cache, per script", warm, size_t(count) * kRuns);
+        printf("    %u from the cache, %u compiled, %.1fx faster than compiling\n", stats.from_cache, stats.compiled,
+               uncached / (warm > 0.0 ? warm : 1.0));
+    }
+
+    remove(cache_path);
+    return 0;
+}
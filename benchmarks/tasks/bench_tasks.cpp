@@ -0,0 +1,102 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Measures coroutine task overhead: frame allocation, nested awaits and
+// hopping between the main thread and the workers.
+// Usage: TasksBenchmarks [task_count]
+
+#include <cstdio>  // For printf
+#include <cstdlib> // For atoi, malloc, free
+#include <thread>  // For std::thread::hardware_concurrency
+
+#include "benchmark.h"
+#include "task_scheduler.h"
+
+using namespace toybox::utils::tasks;
+using namespace toybox::utils::jobs;
+using namespace toybox::benchmarks;
+
+static Task<int> Leaf(int value) {
+    co_return value + 1;
+}
+
+static Task<void> Nested(int* sink) {
+    int total = 0;
+    for (int i = 0; i < 8; ++i) {
+        total += co_await Leaf(i);
+    }
+    *sink += total;
+}
+
+static Task<void> HopOnce(TaskScheduler* scheduler) {
+    co_await scheduler->OnWorker();
+    co_await scheduler->OnMainThread(FramePhase::Update);
+}
+
+static void RunFrameAllocation(int count) {
+    const size_t frame_bytes = 256;
+    void** frames = new void*[count];
+
+    Stopwatch watch;
+    for (int i = 0; i < count; ++i) frames[i] = malloc(frame_bytes);
+    for (int i = 0; i < count; ++i) free(frames[i]);
+    Report("malloc/free 256 byte frames", watch.ElapsedNs(), size_t(count));
+
+    // Warm the pool so the timed pass measures reuse
+    for (int i = 0; i < count; ++i) frames[i] = AllocateTaskFrame(frame_bytes);
+    for (int i = 0; i < count; ++i) FreeTaskFrame(frames[i], frame_bytes);
+
+    watch.Restart();
+    for (int i = 0; i < count; ++i) frames[i] = AllocateTaskFrame(frame_bytes);
+    for (int i = 0; i < count; ++i) FreeTaskFrame(frames[i], frame_bytes);
+    Report("task frame pool 256 byte frames", watch.ElapsedNs(), size_t(count));
+
+    delete[] frames;
+}
+
+int main(int argc, char** argv) {
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    uint32_t hardware = std::thread::hardware_concurrency();
+
+    JobSystem jobs;
+    jobs.Init(hardware > 1 ? hardware - 1 : 1);
+    TaskScheduler scheduler(&jobs);
+
+    Section("Frame allocation");
+    RunFrameAllocation(count);
+
+    Section("Synchronous tasks");
+    int sink = 0;
+    Stopwatch watch;
+    for (int i = 0; i < count; ++i) {
+        scheduler.Spawn(Nested(&sink));
+    }
+    Report("spawn + 8 nested awaits", watch.ElapsedNs(), size_t(count));
+    DoNotOptimize(sink);
+
+    Section("Thread hops");
+    const int batch = 2000;
+    watch.Restart();
+    for (int done = 0; done < count; done += batch) {
+        for (int i = 0; i < batch; ++i) {
+            scheduler.Spawn(HopOnce(&scheduler));
+        }
+        while (scheduler.ActiveTasks() > 0) {
+            jobs.RunPendingJob();
+            scheduler.RunPhase(FramePhase::Update);
+        }
+    }
+    Report("main -> worker -> main", watch.ElapsedNs(), size_t(count));
+
+    TaskFramePoolStats stats = GetTaskFramePoolStats();
+    printf("\nframe pool: %zu slabs, %zu oversize frames, %zu in use\n",
+           stats.slab_allocations, stats.oversize_allocations, stats.frames_in_use);
+    return 0;
+}
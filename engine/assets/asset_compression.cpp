@@ -0,0 +1,446 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <atomic>  // For std::atomic
+#include <bit>     // For std::countr_zero
+#include <cstring> // For memcpy, memset
+
+#include "asset_compression.h"
+#include "parallel_for.h"
+
+namespace toybox
+{
+namespace assets
+{
+
+using utils::data_structures::DynamicArray;
+
+// A sequence is a token, literal length bytes past 15, the literals, a
+// 16-bit offset and match length bytes past 15 + kMinMatch. The block ends
+// with a token of literals alone.
+static const size_t kMinMatch = 4;
+static const size_t kMaxOffset = 65535;
+// No match reaches into the last kLastLiterals bytes or starts within
+// kMatchLimit of the end, so the decoder's wide copies near the end of a
+// block fall back to exact ones well before they could overrun
+static const size_t kLastLiterals = 5;
+static const size_t kMatchLimit = 12;
+
+static const uint32_t kFastHashBits = 14;
+static const uint32_t kHighHashBits = 15;
+static const uint32_t kHighSearchDepth = 64;
+
+static uint32_t Read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+static uint64_t Read64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, 8);
+    return value;
+}
+
+static uint32_t HashOf(uint32_t sequence, uint32_t bits) {
+    return (sequence * 2654435761u) >> (32 - bits);
+}
+
+// Bytes that match from a and b onwards, up to limit. The first differing
+// byte of a word is its lowest on the little-endian targets we ship.
+static size_t MatchLength(const uint8_t* a, const uint8_t* b, const uint8_t* limit) {
+    const uint8_t* start = b;
+    while (b + 8 <= limit) {
+        uint64_t difference = Read64(a) ^ Read64(b);
+        if (difference) return size_t(b - start) + size_t(std::countr_zero(difference) >> 3);
+        a += 8;
+        b += 8;
+    }
+    while (b < limit && *a == *b) {
+        ++a;
+        ++b;
+    }
+    return size_t(b - start);
+}
+
+static uint8_t* WriteLength(uint8_t* out, size_t length) {
+    for (; length >= 255; length -= 255) *out++ = 255;
+    *out++ = uint8_t(length);
+    return out;
+}
+
+static uint8_t* EmitSequence(uint8_t* out, const uint8_t* literals, size_t literal_length, size_t offset,
+                             size_t match_length) {
+    uint8_t* token = out++;
+    *token = uint8_t((literal_length >= 15 ? 15 : literal_length) << 4);
+    if (literal_length >= 15) out = WriteLength(out, literal_length - 15);
+    memcpy(out, literals, literal_length);
+    out += literal_length;
+    *out++ = uint8_t(offset);
+    *out++ = uint8_t(offset >> 8);
+    size_t extra = match_length - kMinMatch;
+    *token |= uint8_t(extra >= 15 ? 15 : extra);
+    if (extra >= 15) out = WriteLength(out, extra - 15);
+    return out;
+}
+
+static uint8_t* EmitLastLiterals(uint8_t* out, const uint8_t* literals, size_t literal_length) {
+    *out++ = uint8_t((literal_length >= 15 ? 15 : literal_length) << 4);
+    if (literal_length >= 15) out = WriteLength(out, literal_length - 15);
+    memcpy(out, literals, literal_length);
+    return out + literal_length;
+}
+
+size_t CompressBlockBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+// Greedy: one hash table slot per hash, and the stride over unmatched data
+// grows the longer it goes without a match, so incompressible data passes
+// quickly
+static size_t CompressFast(const uint8_t* source, size_t size, uint8_t* destination) {
+    const uint8_t* end = source + size;
+    const uint8_t* match_end = end - kLastLiterals;
+    const uint8_t* search_end = end - kMatchLimit;
+    uint8_t* out = destination;
+    const uint8_t* anchor = source;
+    uint32_t table[1u << kFastHashBits];
+    memset(table, 0, sizeof(table));
+
+    const uint8_t* in = source + 1;
+    uint32_t misses = 1u << 6;
+    while (in < search_end) {
+        uint32_t hash = HashOf(Read32(in), kFastHashBits);
+        const uint8_t* candidate = source + table[hash];
+        table[hash] = uint32_t(in - source);
+        if (candidate >= in || size_t(in - candidate) > kMaxOffset || Read32(candidate) != Read32(in)) {
+            in += misses++ >> 6;
+            continue;
+        }
+        misses = 1u << 6;
+        // Back over literals that match too
+        while (in > anchor && candidate > source && in[-1] == candidate[-1]) {
+            --in;
+            --candidate;
+        }
+        size_t length = kMinMatch + MatchLength(candidate + kMinMatch, in + kMinMatch, match_end);
+        out = EmitSequence(out, anchor, size_t(in - anchor), size_t(in - candidate), length);
+        in += length;
+        anchor = in;
+        if (in < search_end) table[HashOf(Read32(in - 2), kFastHashBits)] = uint32_t(in - 2 - source);
+    }
+    return size_t(EmitLastLiterals(out, anchor, size_t(end - anchor)) - destination);
+}
+
+struct HashChains {
+    uint32_t head[1u << kHighHashBits];
+    uint16_t previous[kMaxOffset + 1]; // Distance back to the last position with the same hash
+};
+
+static void Insert(HashChains* chains, const uint8_t* source, size_t position) {
+    uint32_t hash = HashOf(Read32(source + position), kHighHashBits);
+    size_t distance = position - chains->head[hash];
+    chains->previous[position & kMaxOffset] = uint16_t(distance > kMaxOffset ? 0 : distance);
+    chains->head[hash] = uint32_t(position);
+}
+
+// Longest match for the bytes at position among those already inserted
+static size_t FindLongest(const HashChains* chains, const uint8_t* source, size_t position, const uint8_t* match_end,
+                          size_t* offset) {
+    const uint8_t* in = source + position;
+    size_t best = 0;
+    size_t candidate = chains->head[HashOf(Read32(in), kHighHashBits)];
+    for (uint32_t depth = 0; depth < kHighSearchDepth && candidate < position; ++depth) {
+        size_t distance = position - candidate;
+        if (distance > kMaxOffset) break;
+        const uint8_t* match = source + candidate;
+        // A longer match must also agree at the byte past the best so far
+        if (match[best] == in[best] && Read32(match) == Read32(in)) {
+            size_t length = kMinMatch + MatchLength(match + kMinMatch, in + kMinMatch, match_end);
+            if (length > best) {
+                best = length;
+                *offset = distance;
+                if (in + best >= match_end) break;
+            }
+        }
+        uint16_t step = chains->previous[candidate & kMaxOffset];
+        if (step == 0 || step > candidate) break;
+        candidate -= step;
+    }
+    return best >= kMinMatch ? best : 0;
+}
+
+// Hash chains searched to kHighSearchDepth, taking a match one byte later
+// when that one is longer
+static size_t CompressHigh(const uint8_t* source, size_t size, uint8_t* destination, HashChains* chains) {
+    const uint8_t* end = source + size;
+    const uint8_t* match_end = end - kLastLiterals;
+    const size_t search_end = size - kMatchLimit;
+    uint8_t* out = destination;
+    size_t anchor = 0;
+    size_t inserted = 0;
+    for (uint32_t& head : chains->head) head = 0;
+    memset(chains->previous, 0, sizeof(chains->previous));
+
+    size_t position = 1;
+    while (position < search_end) {
+        for (; inserted < position; ++inserted) Insert(chains, source, inserted);
+        size_t offset = 0;
+        size_t length = FindLongest(chains, source, position, match_end, &offset);
+        if (length == 0) {
+            ++position;
+            continue;
+        }
+        while (position + 1 < search_end) {
+            Insert(chains, source, inserted++);
+            size_t next_offset = 0;
+            size_t next_length = FindLongest(chains, source, position + 1, match_end, &next_offset);
+            if (next_length <= length) break;
+            ++position;
+            length = next_length;
+            offset = next_offset;
+        }
+        out = EmitSequence(out, source + anchor, position - anchor, offset, length);
+        position += length;
+        anchor = position;
+    }
+    return size_t(EmitLastLiterals(out, source + anchor, size - anchor) - destination);
+}
+
+size_t CompressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity,
+                     AssetCompression level) {
+    if (capacity < CompressBlockBound(size)) return 0;
+    size_t compressed;
+    if (size <= kMatchLimit + 1) {
+        compressed = size_t(EmitLastLiterals(destination, source, size) - destination);
+    } else if (level == AssetCompression::High) {
+        HashChains* chains = new HashChains;
+        compressed = CompressHigh(source, size, destination, chains);
+        delete chains;
+    } else {
+        compressed = CompressFast(source, size, destination);
+    }
+    return compressed < size ? compressed : 0;
+}
+
+// Adds the bytes of a length past its token's 15, failing past the input
+static bool ReadLength(const uint8_t** in, const uint8_t* end, size_t* length) {
+    uint8_t byte;
+    do {
+        if (*in >= end) return false;
+        byte = *(*in)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// Every read and write is checked against the ends, so a damaged block
+// fails rather than touching memory it should not; the wide copies run only
+// where at least 16 bytes of room remain
+bool DecompressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t raw_size) {
+    const uint8_t* in = source;
+    const uint8_t* in_end = source + size;
+    uint8_t* out = destination;
+    uint8_t* out_end = destination + raw_size;
+    for (;;) {
+        if (in >= in_end) return false;
+        uint8_t token = *in++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !ReadLength(&in, in_end, &literals)) return false;
+        if (literals > size_t(in_end - in) || literals > size_t(out_end - out)) return false;
+        if (literals <= 16 && in_end - in >= 16 && out_end - out >= 16) {
+            memcpy(out, in, 16);
+        } else {
+            memcpy(out, in, literals);
+        }
+        in += literals;
+        out += literals;
+        if (in == in_end) break;
+
+        if (in_end - in < 2) return false;
+        size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+        in += 2;
+        if (offset == 0 || offset > size_t(out - destination)) return false;
+        size_t length = token & 15;
+        if (length == 15 && !ReadLength(&in, in_end, &length)) return false;
+        length += kMinMatch;
+        if (length > size_t(out_end - out)) return false;
+
+        const uint8_t* match = out - offset;
+        if (offset >= 16 && size_t(out_end - out) >= length + 16) {
+            // 16 bytes back or more, each copy reads only finished output
+            for (size_t copied = 0; copied < length; copied += 16) memcpy(out + copied, match + copied, 16);
+        } else {
+            // The match overlaps what it writes: copy the period, then
+            // copies twice as long each time from the same start
+            size_t copied = 0;
+            while (copied < length) {
+                size_t chunk = size_t(out + copied - match);
+                if (chunk > length - copied) chunk = length - copied;
+                memcpy(out + copied, match, chunk);
+                copied += chunk;
+            }
+        }
+        out += length;
+    }
+    return out == out_end;
+}
+
+static uint32_t ClampBlockSize(uint32_t block_size) {
+    if (block_size < kMinCompressionBlock) return kMinCompressionBlock;
+    if (block_size > kMaxCompressionBlock) return kMaxCompressionBlock;
+    return block_size;
+}
+
+void CompressAsset(const void* data, size_t size, AssetCompression level, DynamicArray<uint8_t>* out,
+                   uint32_t block_size, utils::jobs::JobSystem* jobs) {
+    block_size = ClampBlockSize(block_size);
+    const uint8_t* source = static_cast<const uint8_t*>(data);
+    uint32_t block_count = uint32_t((size + block_size - 1) / block_size);
+    size_t bound = CompressBlockBound(block_size);
+
+    // Each block compresses into its own slot of scratch, then the slots
+    // are packed together behind the table
+    DynamicArray<uint8_t> scratch;
+    scratch.Resize(size_t(block_count) * bound);
+    DynamicArray<uint64_t> sizes;
+    sizes.Assign(block_count, 0);
+    auto compress = [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            size_t raw = b + 1 < block_count ? block_size : size - b * block_size;
+            const uint8_t* block = source + b * block_size;
+            uint8_t* slot = scratch.Data() + b * bound;
+            size_t compressed = CompressBlock(block, raw, slot, bound, level);
+            if (compressed == 0) {
+                memcpy(slot, block, raw);
+                compressed = raw;
+            }
+            sizes.Data()[b] = compressed;
+        }
+    };
+    if (jobs && block_count > 1) utils::jobs::ParallelFor(jobs, 0, block_count, 1, compress);
+    else compress(0, block_count);
+
+    size_t table_end = sizeof(CompressedAssetHeader) + size_t(block_count) * sizeof(uint64_t);
+    size_t total = table_end;
+    for (uint32_t b = 0; b < block_count; ++b) total += size_t(sizes.Data()[b]);
+    out->Resize(total);
+    CompressedAssetHeader header = { kCompressedAssetMagic, kCompressedAssetVersion, uint64_t(size), block_size,
+                                     block_count };
+    memcpy(out->Data(), &header, sizeof(header));
+    uint64_t at = 0;
+    for (uint32_t b = 0; b < block_count; ++b) {
+        memcpy(out->Data() + table_end + at, scratch.Data() + size_t(b) * bound, size_t(sizes.Data()[b]));
+        at += sizes.Data()[b];
+        memcpy(out->Data() + sizeof(header) + size_t(b) * sizeof(uint64_t), &at, sizeof(at));
+    }
+}
+
+CompressedAsset::CompressedAsset() : header(nullptr), block_ends(nullptr), blocks(nullptr) {}
+
+bool CompressedAsset::Open(const uint8_t* data, size_t size) {
+    header = nullptr;
+    if (size < sizeof(CompressedAssetHeader) || reinterpret_cast<uintptr_t>(data) % 8 != 0) return false;
+    const CompressedAssetHeader* candidate = reinterpret_cast<const CompressedAssetHeader*>(data);
+    if (candidate->magic != kCompressedAssetMagic || candidate->version != kCompressedAssetVersion ||
+        candidate->block_size < kMinCompressionBlock || candidate->block_size > kMaxCompressionBlock ||
+        uint64_t(candidate->block_count) != (candidate->raw_size + candidate->block_size - 1) / candidate->block_size) {
+        return false;
+    }
+    uint64_t table_end = sizeof(CompressedAssetHeader) + uint64_t(candidate->block_count) * sizeof(uint64_t);
+    if (table_end > size) return false;
+    const uint64_t* ends = reinterpret_cast<const uint64_t*>(data + sizeof(CompressedAssetHeader));
+    uint64_t previous = 0;
+    for (uint32_t b = 0; b < candidate->block_count; ++b) {
+        uint64_t raw = b + 1 < candidate->block_count ? candidate->block_size
+                                                      : candidate->raw_size - uint64_t(b) * candidate->block_size;
+        if (ends[b] <= previous || ends[b] - previous > raw) return false;
+        previous = ends[b];
+    }
+    if (previous != size - table_end) return false;
+    header = candidate;
+    block_ends = ends;
+    blocks = data + table_end;
+    return true;
+}
+
+uint64_t CompressedAsset::RawSize() const {
+    return header ? header->raw_size : 0;
+}
+
+uint32_t CompressedAsset::BlockCount() const {
+    return header ? header->block_count : 0;
+}
+
+uint32_t CompressedAsset::BlockSize() const {
+    return header ? header->block_size : 0;
+}
+
+bool CompressedAsset::DecodeBlock(uint32_t block, uint8_t* destination) const {
+    if (!header || block >= header->block_count) return false;
+    uint64_t start = block > 0 ? block_ends[block - 1] : 0;
+    size_t compressed = size_t(block_ends[block] - start);
+    size_t raw = size_t(block + 1 < header->block_count ? header->block_size
+                                                        : header->raw_size - uint64_t(block) * header->block_size);
+    if (compressed == raw) {
+        memcpy(destination, blocks + start, raw);
+        return true;
+    }
+    return DecompressBlock(blocks + start, compressed, destination, raw);
+}
+
+bool CompressedAsset::Decode(uint8_t* destination, utils::jobs::JobSystem* jobs) const {
+    if (!header) return false;
+    std::atomic<bool> failed(false);
+    auto decode = [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            if (!DecodeBlock(uint32_t(b), destination + b * header->block_size)) failed.store(true);
+        }
+    };
+    if (jobs && header->block_count > 1) utils::jobs::ParallelFor(jobs, 0, header->block_count, 1, decode);
+    else decode(0, header->block_count);
+    return !failed.load();
+}
+
+bool CompressedAsset::DecodeRange(uint64_t offset, size_t size, uint8_t* destination) const {
+    if (!header || offset > header->raw_size || size > header->raw_size - offset) return false;
+    if (size == 0) return true;
+    const uint64_t block_size = header->block_size;
+    DynamicArray<uint8_t> scratch;
+    for (uint64_t b = offset / block_size; b * block_size < offset + size; ++b) {
+        uint64_t block_start = b * block_size;
+        uint64_t block_end = block_start + block_size < header->raw_size ? block_start + block_size
+                                                                          : header->raw_size;
+        uint64_t from = offset > block_start ? offset : block_start;
+        uint64_t to = offset + size < block_end ? offset + size : block_end;
+        uint8_t* target = destination + (from - offset);
+        if (from == block_start && to == block_end) {
+            if (!DecodeBlock(uint32_t(b), target)) return false;
+            continue;
+        }
+        scratch.Resize(size_t(block_end - block_start));
+        if (!DecodeBlock(uint32_t(b), scratch.Data())) return false;
+        memcpy(target, scratch.Data() + (from - block_start), size_t(to - from));
+    }
+    return true;
+}
+
+bool LoadAsset(const AssetSpan& span, uint8_t* destination, utils::jobs::JobSystem* jobs) {
+    if (!span.compressed) {
+        if (span.size > 0) memcpy(destination, span.data, span.size);
+        return true;
+    }
+    CompressedAsset asset;
+    if (!asset.Open(span.data, span.size) || asset.RawSize() != span.raw_size) return false;
+    return asset.Decode(destination, jobs);
+}
+
+} // namespace assets
+} // namespace toybox
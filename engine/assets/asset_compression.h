@@ -0,0 +1,107 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint32_t, uint64_t
+
+#include "asset_pack.h"
+#include "dynamicarray.h"
+#include "job_system.h"
+
+namespace toybox
+{
+namespace assets
+{
+
+constexpr uint32_t kCompressedAssetMagic = 0x5A435442; // "TBCZ"
+constexpr uint32_t kCompressedAssetVersion = 1;
+
+// Blocks are compressed on their own: each can be decoded by a different
+// thread, straight into its place in the destination, and a range of a large
+// asset costs only the blocks it touches
+constexpr uint32_t kMinCompressionBlock = 64 * 1024;
+constexpr uint32_t kMaxCompressionBlock = 256 * 1024;
+constexpr uint32_t kDefaultCompressionBlock = 128 * 1024;
+
+// Followed by block_count uint64_t block ends, measured from the end of that
+// table, and then the blocks. A block whose compressed size equals its raw
+// size is stored as it is.
+struct CompressedAssetHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t raw_size;
+    uint32_t block_size; // Every block but the last is this size raw
+    uint32_t block_count;
+};
+
+// Worst case size of one compressed block of size bytes
+size_t CompressBlockBound(size_t size);
+
+// LZ77 into byte-aligned sequences in the manner of LZ4: a token holding
+// literal and match lengths, the literals, and a 16-bit match offset, so
+// decoding is copies and nothing else. Fast takes the first match a hash
+// table offers; High walks hash chains and looks one byte ahead for a longer
+// match, for a smaller block that decodes as fast. Returns the compressed
+// size, or 0 if it would not be smaller than the block, which is then best
+// stored. capacity must be at least CompressBlockBound(size).
+size_t CompressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t capacity,
+                     AssetCompression level);
+
+// Decodes a block into exactly raw_size bytes at destination, never writing
+// outside them. Returns false if the block is damaged.
+bool DecompressBlock(const uint8_t* source, size_t size, uint8_t* destination, size_t raw_size);
+
+// Compresses size bytes at data into a blocked asset, replacing out. Blocks
+// are compressed in parallel when jobs is given. block_size is clamped to
+// [kMinCompressionBlock, kMaxCompressionBlock].
+void CompressAsset(const void* data, size_t size, AssetCompression level,
+                   utils::data_structures::DynamicArray<uint8_t>* out, uint32_t block_size = kDefaultCompressionBlock,
+                   utils::jobs::JobSystem* jobs = nullptr);
+
+// A blocked asset read in place, typically out of a mapped pack
+struct CompressedAsset {
+private:
+    const CompressedAssetHeader* header;
+    const uint64_t* block_ends;
+    const uint8_t* blocks;
+
+public:
+    CompressedAsset();
+
+    // Checks the header and block table. The bytes must stay valid while the
+    // asset is used.
+    bool Open(const uint8_t* data, size_t size);
+
+    uint64_t RawSize() const;
+    uint32_t BlockCount() const;
+    uint32_t BlockSize() const;
+
+    // Decodes block into destination, which is where the block starts in the
+    // whole asset: block * BlockSize() bytes into it
+    bool DecodeBlock(uint32_t block, uint8_t* destination) const;
+
+    // Decodes the whole asset into RawSize() bytes at destination, spreading
+    // the blocks over jobs when given
+    bool Decode(uint8_t* destination, utils::jobs::JobSystem* jobs = nullptr) const;
+
+    // Decodes size bytes from offset into destination, touching only the
+    // blocks that hold them. Whole blocks are decoded in place; the partial
+    // ones at either end go through a block of scratch.
+    bool DecodeRange(uint64_t offset, size_t size, uint8_t* destination) const;
+};
+
+// Copies or decodes an asset found in a pack into span.raw_size bytes at
+// destination
+bool LoadAsset(const AssetSpan& span, uint8_t* destination, utils::jobs::JobSystem* jobs = nullptr);
+
+} // namespace assets
+} // namespace toybox
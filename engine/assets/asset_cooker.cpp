@@ -0,0 +1,809 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstdio>  // For snprintf
+#include <cstring> // For memcpy, strlen, strcmp
+#include <utility> // For std::move
+
+#include "asset_cooker.h"
+#include "file_io.h"
+#include "parallel_for.h"
+
+namespace toybox
+{
+namespace assets
+{
+
+using utils::data_structures::DynamicArray;
+using utils::data_structures::DynamicString;
+using utils::jobs::JobSystem;
+
+static const uint64_t kPrime1 = 11400714785074694791ULL;
+static const uint64_t kPrime2 = 14029467366897019727ULL;
+static const uint64_t kPrime3 = 1609587929392839161ULL;
+static const uint64_t kPrime4 = 9650029242287828579ULL;
+static const uint64_t kPrime5 = 2870177450012600261ULL;
+
+static inline uint64_t Rotate(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t Read64(const uint8_t* at) {
+    uint64_t value;
+    memcpy(&value, at, sizeof(value));
+    return value;
+}
+
+static inline uint32_t Read32(const uint8_t* at) {
+    uint32_t value;
+    memcpy(&value, at, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Round(uint64_t accumulator, uint64_t input) {
+    accumulator += input * kPrime2;
+    return Rotate(accumulator, 31) * kPrime1;
+}
+
+static inline uint64_t Merge(uint64_t hash, uint64_t accumulator) {
+    hash ^= Round(0, accumulator);
+    return hash * kPrime1 + kPrime4;
+}
+
+uint64_t HashContent(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* at = static_cast<const uint8_t*>(data);
+    const uint8_t* end = at + size;
+    uint64_t hash;
+    if (size >= 32) {
+        // Four lanes, so the multiplies of one stripe do not wait on each other
+        uint64_t lanes[4] = { seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1 };
+        do {
+            lanes[0] = Round(lanes[0], Read64(at));
+            lanes[1] = Round(lanes[1], Read64(at + 8));
+            lanes[2] = Round(lanes[2], Read64(at + 16));
+            lanes[3] = Round(lanes[3], Read64(at + 24));
+            at += 32;
+        } while (end - at >= 32);
+        hash = Rotate(lanes[0], 1) + Rotate(lanes[1], 7) + Rotate(lanes[2], 12) + Rotate(lanes[3], 18);
+        for (uint64_t lane : lanes) hash = Merge(hash, lane);
+    } else {
+        hash = seed + kPrime5;
+    }
+    hash += size;
+    for (; end - at >= 8; at += 8) hash = Rotate(hash ^ Round(0, Read64(at)), 27) * kPrime1 + kPrime4;
+    if (end - at >= 4) {
+        hash = Rotate(hash ^ (uint64_t(Read32(at)) * kPrime1), 23) * kPrime2 + kPrime3;
+        at += 4;
+    }
+    for (; at < end; ++at) hash = Rotate(hash ^ (*at * kPrime5), 11) * kPrime1;
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+static uint64_t HashText(const char* text) {
+    return HashContent(text, strlen(text));
+}
+
+static void Append(DynamicArray<uint8_t>* bytes, const void* data, size_t size) {
+    size_t at = bytes->Size();
+    if (at + size > bytes->Capacity()) bytes->Reserve(at + size > 2 * at ? at + size : 2 * at);
+    bytes->Resize(at + size);
+    if (size > 0) memcpy(bytes->Data() + at, data, size);
+}
+
+template<typename T>
+static void Append(DynamicArray<uint8_t>* bytes, T value) {
+    Append(bytes, &value, sizeof(value));
+}
+
+// Lengths go in ahead of strings so that no two lists of fields run
+// together into the same bytes
+static void AppendText(DynamicArray<uint8_t>* bytes, const char* text) {
+    uint32_t length = uint32_t(strlen(text));
+    Append(bytes, length);
+    Append(bytes, text, length + 1);
+}
+
+// Reads back what Append wrote, failing rather than reading past the end
+struct ByteReader {
+    const uint8_t* at;
+    const uint8_t* end;
+    bool ok;
+
+    template<typename T>
+    T Read() {
+        T value = {};
+        if (size_t(end - at) < sizeof(T)) {
+            ok = false;
+            return value;
+        }
+        memcpy(&value, at, sizeof(T));
+        at += sizeof(T);
+        return value;
+    }
+
+    const char* Text() {
+        uint32_t length = Read<uint32_t>();
+        if (!ok || size_t(end - at) <= length || at[length] != 0) {
+            ok = false;
+            return "";
+        }
+        const char* text = reinterpret_cast<const char*>(at);
+        at += length + 1;
+        return text;
+    }
+};
+
+// Chunks a wave is split into at most, well inside the jobs a thread may
+// have in flight, however large the project
+static const size_t kMaxChunks = 1024;
+
+// Runs fn(i) for every i below count, over jobs when given
+template<typename Fn>
+static void ForEach(JobSystem* jobs, size_t count, size_t grain, const Fn& fn) {
+    if (!jobs) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+    size_t least = (count + kMaxChunks - 1) / kMaxChunks;
+    if (grain != 0 && grain < least) grain = least;
+    utils::jobs::ParallelFor(jobs, 0, count, grain, [&fn](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) fn(i);
+    });
+}
+
+CookContext::CookContext()
+    : cooker(nullptr), asset(0), source(nullptr), source_size(0), output(nullptr) {
+    error[0] = 0;
+}
+
+const char* CookContext::Name() const {
+    return cooker->assets.Data()[asset].name.CStr();
+}
+
+const char* CookContext::SourcePath() const {
+    return cooker->files.Data()[cooker->assets.Data()[asset].source].path.CStr();
+}
+
+const char* CookContext::Settings() const {
+    return cooker->assets.Data()[asset].settings.CStr();
+}
+
+const uint8_t* CookContext::Source() const {
+    return source;
+}
+
+size_t CookContext::SourceSize() const {
+    return source_size;
+}
+
+DynamicArray<uint8_t>* CookContext::Output() {
+    return output;
+}
+
+bool CookContext::ReadInput(const char* path, DynamicArray<uint8_t>* out) {
+    AssetCooker::Asset& cooking = cooker->assets.Data()[asset];
+    // Stat first: should the file change while it is read, the stat kept is
+    // the older one and the next build hashes it again
+    utils::io::FileStat stat;
+    bool found = utils::io::StatFile(path, &stat) && utils::io::ReadFile(path, out);
+    if (!found) {
+        out->Clear();
+        stat.size = 0;
+        stat.modified_ns = kUnknownModification;
+    }
+    // A missing input is recorded too, as creating it may change the output
+    cooking.read_paths.PushBack(DynamicString(path));
+    cooking.read_hashes.PushBack(found ? HashContent(out->Data(), out->Size()) : 0);
+    cooking.read_stats.PushBack(stat);
+    return found;
+}
+
+bool CookContext::ReadDependency(const char* name, DynamicArray<uint8_t>* out) {
+    uint32_t index = cooker->FindAsset(name);
+    const DynamicArray<uint32_t>& dependencies = cooker->assets.Data()[asset].dependencies;
+    for (size_t i = 0; i < dependencies.Size(); ++i) {
+        if (dependencies.Data()[i] == index) return cooker->ReadCooked(index, out);
+    }
+    // Anything else might not have been cooked yet
+    snprintf(error, sizeof(error), "'%s' is not a dependency", name);
+    return false;
+}
+
+void CookContext::Fail(const char* message) {
+    snprintf(error, sizeof(error), "%s", message);
+}
+
+AssetCooker::AssetCooker() : stats() {
+    error[0] = 0;
+}
+
+bool AssetCooker::Open(const char* cache_directory) {
+    directory = cache_directory;
+    assets.Clear();
+    asset_index.Clear();
+    files.Clear();
+    file_index.Clear();
+    records.Clear();
+    record_index.Clear();
+    stats = CookStats();
+    error[0] = 0;
+
+    // Objects are spread over directories by the top byte of their key
+    char path[1024];
+    for (uint32_t shard = 0; shard < 256; ++shard) {
+        snprintf(path, sizeof(path), "%s/objects/%02x", cache_directory, shard);
+        if (!utils::io::CreateDirectories(path)) {
+            snprintf(error, sizeof(error), "Could not create a cache in %s", cache_directory);
+            directory.Clear();
+            return false;
+        }
+    }
+    LoadManifest();
+    return true;
+}
+
+uint32_t AssetCooker::AddProcessor(const AssetProcessor& processor) {
+    processors.PushBack(processor);
+    return uint32_t(processors.Size() - 1);
+}
+
+uint32_t AssetCooker::FindProcessor(const char* name) const {
+    for (size_t i = 0; i < processors.Size(); ++i) {
+        if (strcmp(processors.Data()[i].name, name) == 0) return uint32_t(i);
+    }
+    return kNoCookProcessor;
+}
+
+void AssetCooker::Add(const char* name, const char* source, uint32_t processor, const char* settings,
+                      const char* const* dependencies, uint32_t dependency_count) {
+    if (FindAsset(name) != kNoCookedAsset) {
+        if (!error[0]) snprintf(error, sizeof(error), "'%s' was added twice", name);
+        return;
+    }
+    Asset asset;
+    asset.name = name;
+    asset.settings = settings;
+    asset.source = FileIndex(source);
+    asset.processor = processor;
+    asset.record = kNoCookedAsset;
+    for (uint32_t i = 0; i < dependency_count; ++i) asset.dependency_names.PushBack(DynamicString(dependencies[i]));
+    asset.key = 0;
+    asset.output_hash = 0;
+    asset.output_size = 0;
+    asset.outcome = Outcome::Pending;
+    asset_index.Insert(HashText(name), uint32_t(assets.Size()));
+    assets.PushBack(asset);
+}
+
+uint32_t AssetCooker::FileIndex(const char* path) {
+    uint64_t hash = HashText(path);
+    if (const uint32_t* found = file_index.Find(hash)) {
+        if (strcmp(files.Data()[*found].path.CStr(), path) == 0) return *found;
+        // Two paths with the same hash; fall back on a search
+        for (size_t i = 0; i < files.Size(); ++i) {
+            if (strcmp(files.Data()[i].path.CStr(), path) == 0) return uint32_t(i);
+        }
+    }
+    File file;
+    file.path = path;
+    file.size = 0;
+    file.modified_ns = kUnknownModification;
+    file.hash = 0;
+    file.exists = false;
+    file.checked = false;
+    file.hashed = false;
+    file_index.Insert(hash, uint32_t(files.Size()));
+    files.PushBack(file);
+    return uint32_t(files.Size() - 1);
+}
+
+uint32_t AssetCooker::FindAsset(const char* name) const {
+    const uint32_t* found = asset_index.Find(HashText(name));
+    if (!found) return kNoCookedAsset;
+    if (strcmp(assets.Data()[*found].name.CStr(), name) == 0) return *found;
+    for (size_t i = 0; i < assets.Size(); ++i) {
+        if (strcmp(assets.Data()[i].name.CStr(), name) == 0) return uint32_t(i);
+    }
+    return kNoCookedAsset;
+}
+
+uint32_t AssetCooker::FindRecord(const char* name) const {
+    const uint32_t* found = record_index.Find(HashText(name));
+    if (!found) return kNoCookedAsset;
+    if (strcmp(records.Data()[*found].name.CStr(), name) == 0) return *found;
+    for (size_t i = 0; i < records.Size(); ++i) {
+        if (strcmp(records.Data()[i].name.CStr(), name) == 0) return uint32_t(i);
+    }
+    return kNoCookedAsset;
+}
+
+void AssetCooker::CheckFile(File* file) {
+    file->checked = true;
+    utils::io::FileStat stat;
+    if (!utils::io::StatFile(file->path.CStr(), &stat)) {
+        file->exists = false;
+        file->size = 0;
+        file->modified_ns = kUnknownModification;
+        file->hash = 0;
+        return;
+    }
+    if (file->exists && stat.size == file->size && stat.modified_ns == file->modified_ns) return;
+
+    DynamicArray<uint8_t> bytes;
+    file->hashed = true;
+    file->exists = utils::io::ReadFile(file->path.CStr(), &bytes);
+    file->size = stat.size;
+    file->modified_ns = file->exists ? stat.modified_ns : kUnknownModification;
+    file->hash = file->exists ? HashContent(bytes.Data(), bytes.Size()) : 0;
+}
+
+bool AssetCooker::LoadManifest() {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/manifest", directory.CStr());
+    utils::io::FileStat manifest_stat;
+    DynamicArray<uint8_t> bytes;
+    if (!utils::io::StatFile(path, &manifest_stat) || !utils::io::ReadFile(path, &bytes)) return false;
+
+    ByteReader reader = { bytes.Data(), bytes.Data() + bytes.Size(), true };
+    uint32_t magic = reader.Read<uint32_t>();
+    uint32_t version = reader.Read<uint32_t>();
+    uint32_t file_count = reader.Read<uint32_t>();
+    uint32_t record_count = reader.Read<uint32_t>();
+    if (!reader.ok || magic != kCookManifestMagic || version != kCookCacheVersion) return false;
+
+    for (uint32_t i = 0; i < file_count && reader.ok; ++i) {
+        uint32_t index = FileIndex(reader.Text());
+        File& file = files.Data()[index];
+        file.size = reader.Read<uint64_t>();
+        file.modified_ns = reader.Read<int64_t>();
+        file.hash = reader.Read<uint64_t>();
+        file.exists = reader.Read<uint8_t>() != 0;
+        // Too close to the save for the stat to be trusted
+        if (file.modified_ns >= manifest_stat.modified_ns - kRacyWindowNs) file.modified_ns = kUnknownModification;
+        if (index != i) reader.ok = false; // The same path twice
+    }
+    for (uint32_t i = 0; i < record_count && reader.ok; ++i) {
+        Record record;
+        record.name = reader.Text();
+        record.key = reader.Read<uint64_t>();
+        record.output_hash = reader.Read<uint64_t>();
+        record.output_size = reader.Read<uint64_t>();
+        uint32_t input_count = reader.Read<uint32_t>();
+        for (uint32_t j = 0; j < input_count && reader.ok; ++j) {
+            uint32_t input = reader.Read<uint32_t>();
+            if (input >= file_count) reader.ok = false;
+            record.inputs.PushBack(input);
+        }
+        record_index.Insert(HashText(record.name.CStr()), uint32_t(records.Size()));
+        records.PushBack(record);
+    }
+    if (!reader.ok) {
+        // Better to check every asset against the objects than trust it
+        files.Clear();
+        file_index.Clear();
+        records.Clear();
+        record_index.Clear();
+        return false;
+    }
+    return true;
+}
+
+bool AssetCooker::SaveManifest() {
+    DynamicArray<uint8_t> bytes;
+    Append(&bytes, kCookManifestMagic);
+    Append(&bytes, kCookCacheVersion);
+    Append(&bytes, uint32_t(files.Size()));
+    Append(&bytes, uint32_t(records.Size()));
+    for (size_t i = 0; i < files.Size(); ++i) {
+        const File& file = files.Data()[i];
+        AppendText(&bytes, file.path.CStr());
+        Append(&bytes, file.size);
+        Append(&bytes, file.modified_ns);
+        Append(&bytes, file.hash);
+        Append(&bytes, uint8_t(file.exists));
+    }
+    for (size_t i = 0; i < records.Size(); ++i) {
+        const Record& record = records.Data()[i];
+        AppendText(&bytes, record.name.CStr());
+        Append(&bytes, record.key);
+        Append(&bytes, record.output_hash);
+        Append(&bytes, record.output_size);
+        Append(&bytes, uint32_t(record.inputs.Size()));
+        Append(&bytes, record.inputs.Data(), record.inputs.Size() * sizeof(uint32_t));
+    }
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/manifest", directory.CStr());
+    return utils::io::WriteFileAtomic(path, bytes.Data(), bytes.Size());
+}
+
+void AssetCooker::ObjectPath(uint64_t key, char* path, size_t capacity) const {
+    snprintf(path, capacity, "%s/objects/%02x/%016llx", directory.CStr(), unsigned(key >> 56),
+             static_cast<unsigned long long>(key));
+}
+
+bool AssetCooker::ReadObjectHeader(uint64_t key, uint64_t* output_hash, uint64_t* output_size) const {
+    char path[1024];
+    ObjectPath(key, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    CookedObjectHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1;
+    fclose(file);
+    if (!ok || header.magic != kCookedObjectMagic || header.version != kCookCacheVersion || header.key != key) {
+        return false;
+    }
+    *output_hash = header.output_hash;
+    *output_size = header.output_size;
+    return true;
+}
+
+// The key covers everything the output is a function of. Inputs are given
+// by path and hash; dependencies by their output, so recooking one to the
+// same bytes changes nothing downstream.
+static void BeginKey(DynamicArray<uint8_t>* key, const AssetProcessor& processor, const DynamicString& settings,
+                     uint64_t source_hash, uint32_t input_count) {
+    AppendText(key, processor.name);
+    Append(key, processor.version);
+    AppendText(key, settings.CStr());
+    Append(key, source_hash);
+    Append(key, input_count);
+}
+
+void AssetCooker::Cook(uint32_t index) {
+    Asset& asset = assets.Data()[index];
+    if (asset.outcome == Outcome::Failed) return;
+    for (size_t i = 0; i < asset.dependencies.Size(); ++i) {
+        if (assets.Data()[asset.dependencies.Data()[i]].outcome == Outcome::Failed) {
+            asset.outcome = Outcome::Failed;
+            return;
+        }
+    }
+    const File& source = files.Data()[asset.source];
+    const AssetProcessor& processor = processors.Data()[asset.processor];
+    const Record* last = asset.record != kNoCookedAsset ? &records.Data()[asset.record] : nullptr;
+    char path[1024];
+
+    // Look the asset up by the inputs it read last time. Should it read
+    // different ones now, the object it is stored under will say so.
+    DynamicArray<uint8_t> key_bytes(512);
+    uint32_t input_count = last ? uint32_t(last->inputs.Size()) : 0;
+    BeginKey(&key_bytes, processor, asset.settings, source.hash, input_count);
+    for (uint32_t i = 0; i < input_count; ++i) {
+        const File& input = files.Data()[last->inputs.Data()[i]];
+        AppendText(&key_bytes, input.path.CStr());
+        Append(&key_bytes, input.hash);
+    }
+    for (size_t i = 0; i < asset.dependencies.Size(); ++i) {
+        Append(&key_bytes, assets.Data()[asset.dependencies.Data()[i]].output_hash);
+    }
+    uint64_t key = HashContent(key_bytes.Data(), key_bytes.Size());
+
+    utils::io::FileStat object_stat;
+    ObjectPath(key, path, sizeof(path));
+    if (last && key == last->key && utils::io::StatFile(path, &object_stat)) {
+        asset.key = key;
+        asset.output_hash = last->output_hash;
+        asset.output_size = last->output_size;
+        asset.inputs = last->inputs;
+        asset.outcome = Outcome::UpToDate;
+        return;
+    }
+    if (source.exists && ReadObjectHeader(key, &asset.output_hash, &asset.output_size)) {
+        asset.key = key;
+        if (last) asset.inputs = last->inputs;
+        else asset.inputs.Clear();
+        asset.outcome = Outcome::FromCache;
+        return;
+    }
+
+    DynamicArray<uint8_t> bytes;
+    if (!utils::io::ReadFile(source.path.CStr(), &bytes)) {
+        snprintf(path, sizeof(path), "'%s': could not read %s", asset.name.CStr(), source.path.CStr());
+        asset.failure = path;
+        asset.outcome = Outcome::Failed;
+        return;
+    }
+    DynamicArray<uint8_t> output;
+    CookContext context;
+    context.cooker = this;
+    context.asset = index;
+    context.source = bytes.Data();
+    context.source_size = bytes.Size();
+    context.output = &output;
+    asset.read_paths.Clear();
+    asset.read_hashes.Clear();
+    asset.read_stats.Clear();
+    if (!processor.process(&context)) {
+        snprintf(path, sizeof(path), "'%s': %s", asset.name.CStr(), context.error[0] ? context.error : "failed");
+        asset.failure = path;
+        asset.outcome = Outcome::Failed;
+        return;
+    }
+
+    // Stored under a key from what was actually read, so it can only ever
+    // be found by a build whose inputs hold the same
+    key_bytes.Clear();
+    BeginKey(&key_bytes, processor, asset.settings, HashContent(bytes.Data(), bytes.Size()),
+             uint32_t(asset.read_paths.Size()));
+    for (size_t i = 0; i < asset.read_paths.Size(); ++i) {
+        AppendText(&key_bytes, asset.read_paths.Data()[i].CStr());
+        Append(&key_bytes, asset.read_hashes.Data()[i]);
+    }
+    for (size_t i = 0; i < asset.dependencies.Size(); ++i) {
+        Append(&key_bytes, assets.Data()[asset.dependencies.Data()[i]].output_hash);
+    }
+    CookedObjectHeader header;
+    header.magic = kCookedObjectMagic;
+    header.version = kCookCacheVersion;
+    header.key = HashContent(key_bytes.Data(), key_bytes.Size());
+    header.output_hash = HashContent(output.Data(), output.Size());
+    header.output_size = output.Size();
+
+    DynamicArray<uint8_t> object(sizeof(header) + output.Size());
+    Append(&object, &header, sizeof(header));
+    Append(&object, output.Data(), output.Size());
+    ObjectPath(header.key, path, sizeof(path));
+    if (!utils::io::WriteFileAtomic(path, object.Data(), object.Size())) {
+        asset.failure = "Could not write to the cache";
+        asset.outcome = Outcome::Failed;
+        return;
+    }
+    asset.key = header.key;
+    asset.output_hash = header.output_hash;
+    asset.output_size = header.output_size;
+    asset.outcome = Outcome::Cooked;
+}
+
+void AssetCooker::Fold(uint32_t index) {
+    Asset& asset = assets.Data()[index];
+    if (asset.outcome == Outcome::Failed && asset.failure.Length() > 0 && !error[0]) {
+        snprintf(error, sizeof(error), "%s", asset.failure.CStr());
+    }
+    if (asset.outcome != Outcome::Cooked) return;
+    asset.inputs.Clear();
+    for (size_t i = 0; i < asset.read_paths.Size(); ++i) {
+        uint32_t input = FileIndex(asset.read_paths.Data()[i].CStr());
+        asset.inputs.PushBack(input);
+        File& file = files.Data()[input];
+        if (file.checked) continue;
+        const utils::io::FileStat& stat = asset.read_stats.Data()[i];
+        file.checked = true;
+        file.hash = asset.read_hashes.Data()[i];
+        file.exists = stat.modified_ns != kUnknownModification;
+        file.size = stat.size;
+        file.modified_ns = stat.modified_ns;
+    }
+    asset.read_paths.Clear();
+    asset.read_hashes.Clear();
+    asset.read_stats.Clear();
+}
+
+bool AssetCooker::Build(JobSystem* jobs) {
+    stats = CookStats();
+    if (directory.Length() == 0) {
+        snprintf(error, sizeof(error), "No cache directory is open");
+        return false;
+    }
+    uint32_t count = uint32_t(assets.Size());
+
+    // Resolve dependencies, and count each asset's dependents to lay them
+    // out contiguously
+    DynamicArray<uint32_t> waiting;
+    DynamicArray<uint32_t> dependent_start;
+    waiting.ReserveAndInitialize(count, 0);
+    dependent_start.ReserveAndInitialize(count + 1, 0);
+    for (uint32_t i = 0; i < count; ++i) {
+        Asset& asset = assets.Data()[i];
+        asset.outcome = Outcome::Pending;
+        asset.failure.Clear();
+        asset.dependencies.Clear();
+        asset.record = FindRecord(asset.name.CStr());
+        if (asset.processor >= processors.Size()) {
+            snprintf(error, sizeof(error), "'%s' has no processor", asset.name.CStr());
+            asset.outcome = Outcome::Failed;
+        }
+        for (size_t d = 0; d < asset.dependency_names.Size(); ++d) {
+            uint32_t dependency = FindAsset(asset.dependency_names.Data()[d].CStr());
+            if (dependency == kNoCookedAsset) {
+                if (!error[0]) {
+                    snprintf(error, sizeof(error), "'%s' depends on '%s', which was not added", asset.name.CStr(),
+                             asset.dependency_names.Data()[d].CStr());
+                }
+                asset.outcome = Outcome::Failed;
+                continue;
+            }
+            asset.dependencies.PushBack(dependency);
+            ++waiting.Data()[i];
+            ++dependent_start.Data()[dependency + 1];
+        }
+    }
+    for (uint32_t i = 0; i < count; ++i) dependent_start.Data()[i + 1] += dependent_start.Data()[i];
+    DynamicArray<uint32_t> dependents;
+    dependents.ReserveAndInitialize(dependent_start.Data()[count], 0);
+    {
+        DynamicArray<uint32_t> filled = dependent_start;
+        for (uint32_t i = 0; i < count; ++i) {
+            const Asset& asset = assets.Data()[i];
+            for (size_t d = 0; d < asset.dependencies.Size(); ++d) {
+                dependents.Data()[filled.Data()[asset.dependencies.Data()[d]]++] = i;
+            }
+        }
+    }
+
+    // Take the stat of every file the build could need, hashing those that
+    // changed
+    DynamicArray<uint8_t> wanted;
+    wanted.ReserveAndInitialize(files.Size(), 0);
+    DynamicArray<uint32_t> checks;
+    for (size_t i = 0; i < files.Size(); ++i) {
+        files.Data()[i].checked = false;
+        files.Data()[i].hashed = false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        const Asset& asset = assets.Data()[i];
+        if (!wanted.Data()[asset.source]) {
+            wanted.Data()[asset.source] = 1;
+            checks.PushBack(asset.source);
+        }
+        if (asset.record == kNoCookedAsset) continue;
+        const Record& record = records.Data()[asset.record];
+        for (size_t j = 0; j < record.inputs.Size(); ++j) {
+            uint32_t input = record.inputs.Data()[j];
+            if (wanted.Data()[input]) continue;
+            wanted.Data()[input] = 1;
+            checks.PushBack(input);
+        }
+    }
+    ForEach(jobs, checks.Size(), 0, [this, &checks](size_t i) { CheckFile(&files.Data()[checks.Data()[i]]); });
+    for (size_t i = 0; i < files.Size(); ++i) stats.files_hashed += files.Data()[i].hashed ? 1 : 0;
+
+    // Waves of the graph: an asset joins the wave after its last dependency
+    DynamicArray<uint32_t> wave;
+    DynamicArray<uint32_t> next;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (waiting.Data()[i] == 0) wave.PushBack(i);
+    }
+    uint32_t reached = 0;
+    while (wave.Size() > 0) {
+        ForEach(jobs, wave.Size(), 1, [this, &wave](size_t i) { Cook(wave.Data()[i]); });
+        next.Clear();
+        for (size_t w = 0; w < wave.Size(); ++w) {
+            uint32_t index = wave.Data()[w];
+            Fold(index);
+            ++reached;
+            for (uint32_t d = dependent_start.Data()[index]; d < dependent_start.Data()[index + 1]; ++d) {
+                uint32_t dependent = dependents.Data()[d];
+                if (--waiting.Data()[dependent] == 0) next.PushBack(dependent);
+            }
+        }
+        DynamicArray<uint32_t> done = std::move(wave);
+        wave = std::move(next);
+        next = std::move(done);
+    }
+    if (reached < count) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (waiting.Data()[i] == 0) continue;
+            if (!error[0]) snprintf(error, sizeof(error), "'%s' depends on itself", assets.Data()[i].name.CStr());
+            assets.Data()[i].outcome = Outcome::Failed;
+        }
+    }
+
+    // What this build learned becomes the manifest: a record for every
+    // asset, the old one where cooking failed, and the files they read
+    DynamicArray<Record> built;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Asset& asset = assets.Data()[i];
+        switch (asset.outcome) {
+        case Outcome::UpToDate: ++stats.up_to_date; break;
+        case Outcome::FromCache: ++stats.from_cache; break;
+        case Outcome::Cooked: ++stats.cooked; break;
+        default: ++stats.failed; break;
+        }
+        if (asset.outcome == Outcome::Failed) {
+            if (asset.record != kNoCookedAsset) built.PushBack(records.Data()[asset.record]);
+            continue;
+        }
+        Record record;
+        record.name = asset.name;
+        record.key = asset.key;
+        record.output_hash = asset.output_hash;
+        record.output_size = asset.output_size;
+        record.inputs = asset.inputs;
+        built.PushBack(record);
+    }
+    records = std::move(built);
+
+    // Drop the files nothing refers to any more
+    DynamicArray<uint32_t> remap;
+    remap.ReserveAndInitialize(files.Size(), kNoCookedAsset);
+    DynamicArray<File> kept;
+    auto keep = [&](uint32_t* file) {
+        if (remap.Data()[*file] == kNoCookedAsset) {
+            remap.Data()[*file] = uint32_t(kept.Size());
+            kept.PushBack(files.Data()[*file]);
+        }
+        *file = remap.Data()[*file];
+    };
+    for (uint32_t i = 0; i < count; ++i) {
+        Asset& asset = assets.Data()[i];
+        keep(&asset.source);
+        for (size_t j = 0; j < asset.inputs.Size(); ++j) keep(&asset.inputs.Data()[j]);
+    }
+    record_index.Clear();
+    for (size_t i = 0; i < records.Size(); ++i) {
+        Record& record = records.Data()[i];
+        for (size_t j = 0; j < record.inputs.Size(); ++j) keep(&record.inputs.Data()[j]);
+        record_index.Insert(HashText(record.name.CStr()), uint32_t(i));
+    }
+    files = std::move(kept);
+    file_index.Clear();
+    for (size_t i = 0; i < files.Size(); ++i) file_index.Insert(HashText(files.Data()[i].path.CStr()), uint32_t(i));
+
+    if (!SaveManifest()) {
+        if (!error[0]) snprintf(error, sizeof(error), "Could not write the manifest in %s", directory.CStr());
+        return false;
+    }
+    return error[0] == 0;
+}
+
+void AssetCooker::Reset() {
+    assets.Clear();
+    asset_index.Clear();
+    stats = CookStats();
+    error[0] = 0;
+}
+
+const CookStats& AssetCooker::Stats() const {
+    return stats;
+}
+
+uint32_t AssetCooker::AssetCount() const {
+    return uint32_t(assets.Size());
+}
+
+const char* AssetCooker::AssetName(uint32_t index) const {
+    return assets.Data()[index].name.CStr();
+}
+
+uint64_t AssetCooker::CookedKey(uint32_t index) const {
+    return assets.Data()[index].key;
+}
+
+bool AssetCooker::ReadCooked(uint32_t index, DynamicArray<uint8_t>* out) const {
+    const Asset& asset = assets.Data()[index];
+    if (asset.outcome == Outcome::Pending || asset.outcome == Outcome::Failed) return false;
+    char path[1024];
+    ObjectPath(asset.key, path, sizeof(path));
+    utils::io::MappedFile file;
+    if (!file.Open(path) || file.Size() < sizeof(CookedObjectHeader)) return false;
+    CookedObjectHeader header;
+    memcpy(&header, file.Data(), sizeof(header));
+    if (header.magic != kCookedObjectMagic || header.version != kCookCacheVersion || header.key != asset.key ||
+        header.output_size != file.Size() - sizeof(header)) {
+        return false;
+    }
+    const uint8_t* output = file.Data() + sizeof(header);
+    if (HashContent(output, size_t(header.output_size)) != header.output_hash) return false;
+    out->Resize(size_t(header.output_size));
+    if (header.output_size > 0) memcpy(out->Data(), output, size_t(header.output_size));
+    return true;
+}
+
+const char* AssetCooker::Error() const {
+    return error;
+}
+
+} // namespace assets
+} // namespace toybox
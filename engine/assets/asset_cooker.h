@@ -0,0 +1,245 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint32_t, uint64_t, int64_t, INT64_MIN
+
+#include "dynamicarray.h"
+#include "dynamicstring.h"
+#include "file_io.h"
+#include "hashmap.h"
+#include "job_system.h"
+
+namespace toybox
+{
+namespace assets
+{
+
+constexpr uint32_t kCookedObjectMagic = 0x4B434254; // "TBCK"
+constexpr uint32_t kCookManifestMagic = 0x4D434254; // "TBCM"
+constexpr uint32_t kCookCacheVersion = 1;
+
+constexpr uint32_t kNoCookProcessor = 0xFFFFFFFF;
+constexpr uint32_t kNoCookedAsset = 0xFFFFFFFF;
+
+// Files modified this close to when the manifest was saved have their hash
+// taken again next build: a second change inside the filesystem's timestamp
+// granularity would leave the stat as it was
+constexpr int64_t kRacyWindowNs = 2000000000;
+constexpr int64_t kUnknownModification = INT64_MIN;
+
+// Followed by output_size bytes of cooked output
+struct CookedObjectHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t output_hash;
+    uint64_t output_size;
+};
+
+// XXH64 of size bytes. Keys cooked objects and spots changed sources.
+uint64_t HashContent(const void* data, size_t size, uint64_t seed = 0);
+
+struct AssetCooker;
+
+// What a processor sees of the asset it is cooking
+struct CookContext {
+private:
+    friend struct AssetCooker;
+
+    AssetCooker* cooker;
+    uint32_t asset;
+    const uint8_t* source;
+    size_t source_size;
+    utils::data_structures::DynamicArray<uint8_t>* output;
+    char error[256];
+
+public:
+    CookContext();
+
+    // For messages: keys cover neither, so the output must not depend on them
+    const char* Name() const;
+    const char* SourcePath() const;
+    const char* Settings() const;
+    const uint8_t* Source() const;
+    size_t SourceSize() const;
+
+    // Cleared before the processor runs
+    utils::data_structures::DynamicArray<uint8_t>* Output();
+
+    // Reads a file the output depends on besides the source, such as an
+    // include, recording it so that changing it recooks the asset
+    bool ReadInput(const char* path, utils::data_structures::DynamicArray<uint8_t>* out);
+
+    // Reads the cooked output of one of the assets named when this one was
+    // added
+    bool ReadDependency(const char* name, utils::data_structures::DynamicArray<uint8_t>* out);
+
+    // Says why the processor is about to return false
+    void Fail(const char* message);
+};
+
+typedef bool (*AssetProcessFunction)(CookContext* context);
+
+// Turns a kind of source into what the game loads. Bump version whenever
+// the function starts producing different output, to retire what the old
+// one cooked.
+struct AssetProcessor {
+    const char* name;
+    uint32_t version;
+    AssetProcessFunction process;
+};
+
+struct CookStats {
+    uint32_t up_to_date; // Same key as the last build
+    uint32_t from_cache; // Key changed, but an object for it was cached
+    uint32_t cooked;
+    uint32_t failed; // Including assets whose dependencies failed
+    uint32_t files_hashed; // Files read to hash because their stat changed
+};
+
+// Cooks assets incrementally into a content-addressed cache. An asset's key
+// is a hash of its processor's name and version, its settings, the contents
+// of its source and of every file the processor read while cooking it, and
+// the cooked output of the assets it depends on. Objects are stored under
+// their key, so an unchanged asset is never cooked twice, reverting a change
+// finds the old object still there, and two assets cooked from the same
+// source with the same settings share one object.
+//
+// A manifest kept in the cache directory remembers, from the last build,
+// each file's size, modification time and hash, so a build only reads the
+// files whose stat changed, and each asset's key and inputs, so an asset
+// whose key has not moved costs no more than the stats of its files.
+//
+// Assets are declared afresh before every build. Build cooks them in waves
+// of the dependency graph, the dirty assets of each wave in parallel, and a
+// dependency recooked to the same bytes as before leaves its dependents
+// alone.
+struct AssetCooker {
+private:
+    friend struct CookContext;
+
+    enum class Outcome : uint8_t {
+        Pending,
+        UpToDate,
+        FromCache,
+        Cooked,
+        Failed,
+    };
+
+    struct Asset {
+        utils::data_structures::DynamicString name;
+        utils::data_structures::DynamicString settings;
+        uint32_t source; // Index into files
+        uint32_t processor;
+        uint32_t record; // Into records, resolved by Build
+        utils::data_structures::DynamicArray<utils::data_structures::DynamicString> dependency_names;
+        utils::data_structures::DynamicArray<uint32_t> dependencies; // Asset indices, once resolved
+        utils::data_structures::DynamicArray<uint32_t> inputs;       // Files read while cooking, into files
+        uint64_t key;
+        uint64_t output_hash;
+        uint64_t output_size;
+        Outcome outcome;
+        // Left by a cook on a worker for Build to fold into files
+        utils::data_structures::DynamicArray<utils::data_structures::DynamicString> read_paths;
+        utils::data_structures::DynamicArray<uint64_t> read_hashes;
+        utils::data_structures::DynamicArray<utils::io::FileStat> read_stats;
+        utils::data_structures::DynamicString failure;
+    };
+
+    // An asset as the last build left it
+    struct Record {
+        utils::data_structures::DynamicString name;
+        uint64_t key;
+        uint64_t output_hash;
+        uint64_t output_size;
+        utils::data_structures::DynamicArray<uint32_t> inputs;
+    };
+
+    struct File {
+        utils::data_structures::DynamicString path;
+        uint64_t size;
+        int64_t modified_ns; // kUnknownModification forces a fresh hash
+        uint64_t hash;       // 0 for a file that does not exist
+        bool exists;
+        bool checked; // Stat taken this build
+        bool hashed;  // Read this build
+    };
+
+    utils::data_structures::DynamicString directory;
+    utils::data_structures::DynamicArray<AssetProcessor> processors;
+    utils::data_structures::DynamicArray<Asset> assets;
+    utils::data_structures::DynamicArray<File> files;
+    utils::data_structures::DynamicArray<Record> records;
+    // Keyed by HashContent of the name or path, which is checked on a hit;
+    // mutable as HashMap::Find is not const
+    mutable utils::data_structures::HashMap<uint64_t, uint32_t> asset_index;
+    mutable utils::data_structures::HashMap<uint64_t, uint32_t> file_index;
+    mutable utils::data_structures::HashMap<uint64_t, uint32_t> record_index;
+    CookStats stats;
+    char error[256];
+
+    uint32_t FileIndex(const char* path);
+    uint32_t FindRecord(const char* name) const;
+    void CheckFile(File* file);
+    bool LoadManifest();
+    bool SaveManifest();
+    void ObjectPath(uint64_t key, char* path, size_t capacity) const;
+    bool ReadObjectHeader(uint64_t key, uint64_t* output_hash, uint64_t* output_size) const;
+    void Cook(uint32_t index);
+    void Fold(uint32_t index);
+
+public:
+    AssetCooker();
+
+    AssetCooker(const AssetCooker&) = delete;
+    AssetCooker& operator=(const AssetCooker&) = delete;
+
+    // Creates the cache directory if need be and loads the last build's
+    // manifest from it. A missing or stale manifest just makes the next
+    // build check every asset against the objects.
+    bool Open(const char* cache_directory);
+
+    uint32_t AddProcessor(const AssetProcessor& processor);
+    uint32_t FindProcessor(const char* name) const;
+
+    // Declares an asset cooked from the file at source by processor, after
+    // the assets named in dependencies. Settings are whatever the processor
+    // reads to decide how to cook, e.g. "format=bc7 mips=1".
+    void Add(const char* name, const char* source, uint32_t processor, const char* settings = "",
+             const char* const* dependencies = nullptr, uint32_t dependency_count = 0);
+
+    // Cooks whatever is out of date, in parallel over jobs when given, then
+    // saves the manifest. Returns false, saying why in Error(), if an asset
+    // was added twice or failed, a dependency is missing or circular, or the
+    // cache could not be written; the assets that did cook are kept either
+    // way.
+    bool Build(utils::jobs::JobSystem* jobs = nullptr);
+
+    // Forgets the assets declared, keeping the processors and what the last
+    // build learned, ready to declare the project again
+    void Reset();
+
+    const CookStats& Stats() const;
+    uint32_t AssetCount() const;
+    const char* AssetName(uint32_t index) const;
+    uint32_t FindAsset(const char* name) const;
+    uint64_t CookedKey(uint32_t index) const;
+
+    // The cooked bytes of an asset built by the last Build
+    bool ReadCooked(uint32_t index, utils::data_structures::DynamicArray<uint8_t>* out) const;
+
+    const char* Error() const;
+};
+
+} // namespace assets
+} // namespace toybox
@@ -0,0 +1,340 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <algorithm> // For std::sort
+#include <cstdio>    // For snprintf
+#include <cstring>   // For memcpy, memcmp, memset, strlen
+
+#include "asset_compression.h"
+#include "asset_pack.h"
+
+namespace toybox
+{
+namespace assets
+{
+
+using utils::data_structures::DynamicArray;
+
+// Seeds tried per bucket before the writer gives the slots more room
+static const uint32_t kMaxSeed = 1u << 16;
+
+static uint64_t AlignTo(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint64_t HashAssetName(const char* name, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= uint8_t(name[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// The second level of the perfect hash: the bucket's seed remixes the name
+// hash into a slot
+static uint32_t SlotOf(uint64_t hash, uint32_t seed, uint32_t slot_count) {
+    uint64_t x = hash ^ (uint64_t(seed) * 0x9E3779B97F4A7C15ull);
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ull;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return uint32_t(x % slot_count);
+}
+
+AssetPack::AssetPack()
+    : header(nullptr), entries(nullptr), seeds(nullptr), slots(nullptr), names(nullptr) {}
+
+bool AssetPack::Open(const char* path) {
+    Close();
+    if (!file.Open(path)) return false;
+    const uint8_t* data = file.Data();
+    uint64_t size = file.Size();
+    const AssetPackHeader* candidate = reinterpret_cast<const AssetPackHeader*>(data);
+    auto inside = [size](uint64_t offset, uint64_t bytes) { return offset <= size && bytes <= size - offset; };
+    bool valid = size >= sizeof(AssetPackHeader) && candidate->magic == kAssetPackMagic &&
+                 candidate->version == kAssetPackVersion && candidate->file_size == size &&
+                 candidate->bucket_count > 0 && candidate->slot_count > 0 &&
+                 inside(candidate->entries_offset, uint64_t(candidate->asset_count) * sizeof(AssetPackEntry)) &&
+                 inside(candidate->seeds_offset, uint64_t(candidate->bucket_count) * sizeof(uint32_t)) &&
+                 inside(candidate->slots_offset, uint64_t(candidate->slot_count) * sizeof(uint32_t)) &&
+                 inside(candidate->names_offset, candidate->names_size) && candidate->entries_offset % 8 == 0 &&
+                 candidate->seeds_offset % 4 == 0 && candidate->slots_offset % 4 == 0;
+    if (!valid) {
+        file.Close();
+        return false;
+    }
+
+    const AssetPackEntry* table = reinterpret_cast<const AssetPackEntry*>(data + candidate->entries_offset);
+    const uint32_t* slot_table = reinterpret_cast<const uint32_t*>(data + candidate->slots_offset);
+    const char* name_pool = reinterpret_cast<const char*>(data + candidate->names_offset);
+    // Only the tables are checked, so only their pages are read
+    for (uint32_t i = 0; i < candidate->asset_count && valid; ++i) {
+        const AssetPackEntry& entry = table[i];
+        valid = inside(entry.offset, entry.size) && entry.offset % kAssetPackAlignment == 0 &&
+                (entry.raw_size == entry.size || entry.size >= sizeof(CompressedAssetHeader)) &&
+                uint64_t(entry.name_offset) + entry.name_length < candidate->names_size &&
+                name_pool[entry.name_offset + entry.name_length] == 0;
+    }
+    for (uint32_t i = 0; i < candidate->slot_count && valid; ++i) {
+        valid = slot_table[i] == kNoAssetSlot || slot_table[i] < candidate->asset_count;
+    }
+    if (!valid) {
+        file.Close();
+        return false;
+    }
+
+    header = candidate;
+    entries = table;
+    seeds = reinterpret_cast<const uint32_t*>(data + candidate->seeds_offset);
+    slots = slot_table;
+    names = name_pool;
+    return true;
+}
+
+void AssetPack::Close() {
+    file.Close();
+    header = nullptr;
+    entries = nullptr;
+    seeds = nullptr;
+    slots = nullptr;
+    names = nullptr;
+}
+
+bool AssetPack::IsOpen() const {
+    return header != nullptr;
+}
+
+bool AssetPack::Find(const char* name, AssetSpan* span) const {
+    return Find(name, strlen(name), span);
+}
+
+bool AssetPack::Find(const char* name, size_t length, AssetSpan* span) const {
+    if (!header) return false;
+    uint64_t hash = HashAssetName(name, length);
+    uint32_t seed = seeds[hash % header->bucket_count];
+    uint32_t index = slots[SlotOf(hash, seed, header->slot_count)];
+    if (index == kNoAssetSlot) return false;
+    // Names not in the pack land on some slot too
+    const AssetPackEntry& entry = entries[index];
+    if (entry.name_hash != hash || entry.name_length != length ||
+        memcmp(names + entry.name_offset, name, length) != 0) {
+        return false;
+    }
+    *span = Asset(index);
+    return true;
+}
+
+uint32_t AssetPack::AssetCount() const {
+    return header ? header->asset_count : 0;
+}
+
+const char* AssetPack::AssetName(uint32_t index) const {
+    return names + entries[index].name_offset;
+}
+
+AssetSpan AssetPack::Asset(uint32_t index) const {
+    const AssetPackEntry& entry = entries[index];
+    return AssetSpan{ file.Data() + entry.offset, size_t(entry.size), entry.raw_size, entry.raw_size != entry.size };
+}
+
+AssetPackWriter::AssetPackWriter() {
+    error[0] = 0;
+}
+
+void AssetPackWriter::Add(const char* name, const void* data, size_t size, AssetCompression compression) {
+    const void* stored = data;
+    size_t stored_size = size;
+    DynamicArray<uint8_t> compressed;
+    if (compression != AssetCompression::None) {
+        CompressAsset(data, size, compression, &compressed);
+        // Kept only if the block table pays for itself
+        if (compressed.Size() < size) {
+            stored = compressed.Data();
+            stored_size = compressed.Size();
+        }
+    }
+
+    // Padded as it goes, so the payload is written out in one piece
+    uint64_t offset = AlignTo(payload.Size(), kAssetPackAlignment);
+    size_t end = size_t(offset + stored_size);
+    if (end > payload.Capacity()) payload.Reserve(end > payload.Capacity() * 2 ? end : payload.Capacity() * 2);
+    payload.Resize(end);
+    if (stored_size > 0) memcpy(payload.Data() + offset, stored, stored_size);
+    assets.PushBack(Pending{ utils::data_structures::DynamicString(name), HashAssetName(name, strlen(name)), offset,
+                             uint64_t(stored_size), uint64_t(size) });
+}
+
+bool AssetPackWriter::AddFile(const char* name, const char* path, AssetCompression compression) {
+    DynamicArray<uint8_t> contents;
+    if (!utils::io::ReadFile(path, &contents)) {
+        snprintf(error, sizeof(error), "Could not read %s", path);
+        return false;
+    }
+    Add(name, contents.Data(), contents.Size(), compression);
+    return true;
+}
+
+// Hash and displace: buckets are seeded largest first, while the slots are
+// still mostly free, each with the first seed that sends all its names to
+// free slots. A quarter more slots than names keeps the search short.
+bool AssetPackWriter::BuildHash(DynamicArray<uint32_t>* seeds, DynamicArray<uint32_t>* slots) {
+    uint32_t count = static_cast<uint32_t>(assets.Size());
+    const Pending* pending = assets.Data();
+
+    // Names that hash alike could never be told apart
+    DynamicArray<uint32_t> by_hash;
+    for (uint32_t i = 0; i < count; ++i) by_hash.PushBack(i);
+    std::sort(by_hash.Data(), by_hash.Data() + count,
+              [pending](uint32_t a, uint32_t b) { return pending[a].name_hash < pending[b].name_hash; });
+    for (uint32_t i = 1; i < count; ++i) {
+        const Pending& a = pending[by_hash.Data()[i - 1]];
+        const Pending& b = pending[by_hash.Data()[i]];
+        if (a.name_hash != b.name_hash) continue;
+        if (a.name == b.name) snprintf(error, sizeof(error), "'%s' was added twice", a.name.CStr());
+        else snprintf(error, sizeof(error), "'%s' and '%s' hash the same", a.name.CStr(), b.name.CStr());
+        return false;
+    }
+
+    uint32_t bucket_count = count / 4 + 1;
+    DynamicArray<uint32_t> bucket_start;
+    bucket_start.Assign(bucket_count + 1, 0);
+    for (uint32_t i = 0; i < count; ++i) ++bucket_start.Data()[pending[i].name_hash % bucket_count + 1];
+    for (uint32_t b = 0; b < bucket_count; ++b) bucket_start.Data()[b + 1] += bucket_start.Data()[b];
+    DynamicArray<uint32_t> members;
+    members.Assign(count, 0);
+    DynamicArray<uint32_t> filled;
+    filled.Assign(bucket_count, 0);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t b = uint32_t(pending[i].name_hash % bucket_count);
+        members.Data()[bucket_start.Data()[b] + filled.Data()[b]++] = i;
+    }
+    DynamicArray<uint32_t> order;
+    for (uint32_t b = 0; b < bucket_count; ++b) order.PushBack(b);
+    const uint32_t* start = bucket_start.Data();
+    std::sort(order.Data(), order.Data() + bucket_count, [start](uint32_t a, uint32_t b) {
+        uint32_t size_a = start[a + 1] - start[a], size_b = start[b + 1] - start[b];
+        return size_a != size_b ? size_a > size_b : a < b;
+    });
+
+    uint32_t slot_count = count + count / 4 + 1;
+    DynamicArray<uint32_t> placed;
+    for (int attempt = 0; attempt < 8; ++attempt, slot_count += slot_count / 8 + 1) {
+        seeds->Assign(bucket_count, 0);
+        slots->Assign(slot_count, kNoAssetSlot);
+        uint32_t* slot = slots->Data();
+        bool complete = true;
+        for (uint32_t o = 0; o < bucket_count && complete; ++o) {
+            uint32_t b = order.Data()[o];
+            if (start[b] == start[b + 1]) break;
+            bool seeded = false;
+            for (uint32_t seed = 0; seed < kMaxSeed && !seeded; ++seed) {
+                placed.Clear();
+                seeded = true;
+                for (uint32_t m = start[b]; m < start[b + 1]; ++m) {
+                    uint32_t index = members.Data()[m];
+                    uint32_t at = SlotOf(pending[index].name_hash, seed, slot_count);
+                    if (slot[at] != kNoAssetSlot) {
+                        seeded = false;
+                        break;
+                    }
+                    slot[at] = index;
+                    placed.PushBack(at);
+                }
+                if (seeded) {
+                    seeds->Data()[b] = seed;
+                } else {
+                    for (size_t p = 0; p < placed.Size(); ++p) slot[placed.Data()[p]] = kNoAssetSlot;
+                }
+            }
+            complete = seeded;
+        }
+        if (complete) return true;
+    }
+    snprintf(error, sizeof(error), "Could not build a perfect hash of %u names", count);
+    return false;
+}
+
+bool AssetPackWriter::Write(const char* path) {
+    error[0] = 0;
+    DynamicArray<uint32_t> seeds;
+    DynamicArray<uint32_t> slots;
+    if (!BuildHash(&seeds, &slots)) return false;
+
+    uint32_t count = static_cast<uint32_t>(assets.Size());
+    uint64_t names_size = 0;
+    for (uint32_t i = 0; i < count; ++i) names_size += assets.Data()[i].name.Length() + 1;
+    if (names_size > 0xFFFFFFFFull) {
+        snprintf(error, sizeof(error), "Names too long");
+        return false;
+    }
+
+    AssetPackHeader header = {};
+    header.magic = kAssetPackMagic;
+    header.version = kAssetPackVersion;
+    header.asset_count = count;
+    header.bucket_count = static_cast<uint32_t>(seeds.Size());
+    header.slot_count = static_cast<uint32_t>(slots.Size());
+    header.names_size = uint32_t(names_size);
+    header.entries_offset = sizeof(AssetPackHeader);
+    header.seeds_offset = header.entries_offset + uint64_t(count) * sizeof(AssetPackEntry);
+    header.slots_offset = header.seeds_offset + AlignTo(seeds.Size() * sizeof(uint32_t), 8);
+    header.names_offset = header.slots_offset + AlignTo(slots.Size() * sizeof(uint32_t), 8);
+    uint64_t payload_offset = AlignTo(header.names_offset + names_size, kAssetPackAlignment);
+    header.file_size = payload_offset + payload.Size();
+
+    DynamicArray<uint8_t> out;
+    out.Resize(size_t(header.file_size));
+    uint8_t* data = out.Data();
+    memset(data, 0, size_t(payload_offset));
+    memcpy(data, &header, sizeof(header));
+    AssetPackEntry* entries = reinterpret_cast<AssetPackEntry*>(data + header.entries_offset);
+    char* names = reinterpret_cast<char*>(data + header.names_offset);
+    uint32_t name_at = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Pending& asset = assets.Data()[i];
+        uint32_t length = static_cast<uint32_t>(asset.name.Length());
+        memcpy(names + name_at, asset.name.CStr(), length + 1);
+        entries[i] = AssetPackEntry{ asset.name_hash, payload_offset + asset.offset, asset.size, asset.raw_size,
+                                     name_at, length };
+        name_at += length + 1;
+    }
+    memcpy(data + header.seeds_offset, seeds.Data(), seeds.Size() * sizeof(uint32_t));
+    memcpy(data + header.slots_offset, slots.Data(), slots.Size() * sizeof(uint32_t));
+    if (!payload.Empty()) memcpy(data + payload_offset, payload.Data(), payload.Size());
+
+    if (!utils::io::WriteFileAtomic(path, data, out.Size())) {
+        snprintf(error, sizeof(error), "Could not write %s", path);
+        return false;
+    }
+    return true;
+}
+
+uint32_t AssetPackWriter::AssetCount() const {
+    return static_cast<uint32_t>(assets.Size());
+}
+
+uint64_t AssetPackWriter::PayloadSize() const {
+    return payload.Size();
+}
+
+uint64_t AssetPackWriter::RawSize() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < assets.Size(); ++i) total += assets.Data()[i].raw_size;
+    return total;
+}
+
+const char* AssetPackWriter::Error() const {
+    return error;
+}
+
+} // namespace assets
+} // namespace toybox
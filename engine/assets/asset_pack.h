@@ -0,0 +1,159 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint32_t, uint64_t
+
+#include "dynamicarray.h"
+#include "dynamicstring.h"
+#include "file_io.h"
+
+namespace toybox
+{
+namespace assets
+{
+
+constexpr uint32_t kAssetPackMagic = 0x4B504254; // "TBPK"
+constexpr uint32_t kAssetPackVersion = 2;
+
+// Payloads start on this boundary from the start of the file, and so in
+// memory too, the mapping being page aligned: enough for any SIMD load and
+// for a cache line never to hold the end of one asset and the start of the
+// next
+constexpr uint64_t kAssetPackAlignment = 64;
+
+constexpr uint32_t kNoAssetSlot = 0xFFFFFFFF;
+
+// How the writer stores an asset. Compressed assets whose blocks do not
+// shrink are stored as they are.
+enum class AssetCompression : uint8_t {
+    None,
+    Fast, // Quick to compress; about as quick to decode as High
+    High, // Slower to compress, smaller
+};
+
+struct AssetPackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t asset_count;
+    uint32_t bucket_count; // Seeds of the perfect hash
+    uint32_t slot_count;
+    uint32_t names_size;
+    uint64_t file_size; // Catches truncated files
+    uint64_t entries_offset;
+    uint64_t seeds_offset;
+    uint64_t slots_offset;
+    uint64_t names_offset;
+};
+
+struct AssetPackEntry {
+    uint64_t name_hash;
+    uint64_t offset; // From the start of the file, kAssetPackAlignment aligned
+    uint64_t size;
+    uint64_t raw_size;    // Once loaded; differs from size only when compressed
+    uint32_t name_offset; // Into the names, which are nul-terminated
+    uint32_t name_length;
+};
+
+// An asset's bytes, inside the mapping. A compressed asset's bytes are a
+// CompressedAsset, which LoadAsset decodes.
+struct AssetSpan {
+    const uint8_t* data;
+    size_t size;
+    uint64_t raw_size;
+    bool compressed;
+};
+
+// FNV-1a; the first level of the perfect hash and the check before names
+// are compared
+uint64_t HashAssetName(const char* name, size_t length);
+
+// A pack of assets mapped read-only and used in place: Find hands back a
+// pointer into the mapping, so meshes, bytecode and string tables need no
+// copy and no parse, and the pages of assets never used are never read.
+//
+// The table of contents is a perfect hash built by the writer. A name's
+// hash picks a bucket, the bucket's seed picks a slot, and the slot names
+// the entry, so a lookup is two reads and one name compare whatever the
+// number of assets.
+struct AssetPack {
+private:
+    utils::io::MappedFile file;
+    const AssetPackHeader* header;
+    const AssetPackEntry* entries;
+    const uint32_t* seeds;
+    const uint32_t* slots;
+    const char* names;
+
+public:
+    AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Maps the pack at path and checks its tables. Returns false, leaving
+    // the pack closed, if it is missing, truncated or not a pack of this
+    // version. Spans stay valid until Close.
+    bool Open(const char* path);
+    void Close();
+    bool IsOpen() const;
+
+    bool Find(const char* name, AssetSpan* span) const;
+    bool Find(const char* name, size_t length, AssetSpan* span) const;
+
+    // Assets in the order they were added to the writer
+    uint32_t AssetCount() const;
+    const char* AssetName(uint32_t index) const;
+    AssetSpan Asset(uint32_t index) const;
+};
+
+// Builds a pack. Assets are copied in as they are added, so the sources
+// can go once Add returns.
+struct AssetPackWriter {
+private:
+    struct Pending {
+        utils::data_structures::DynamicString name;
+        uint64_t name_hash;
+        uint64_t offset; // Into payload
+        uint64_t size;
+        uint64_t raw_size;
+    };
+
+    utils::data_structures::DynamicArray<Pending> assets;
+    utils::data_structures::DynamicArray<uint8_t> payload;
+    char error[256];
+
+    bool BuildHash(utils::data_structures::DynamicArray<uint32_t>* seeds,
+                   utils::data_structures::DynamicArray<uint32_t>* slots);
+
+public:
+    AssetPackWriter();
+
+    AssetPackWriter(const AssetPackWriter&) = delete;
+    AssetPackWriter& operator=(const AssetPackWriter&) = delete;
+
+    void Add(const char* name, const void* data, size_t size,
+             AssetCompression compression = AssetCompression::None);
+    bool AddFile(const char* name, const char* path, AssetCompression compression = AssetCompression::None);
+
+    // Writes to a temporary file renamed over path. Fails, saying why in
+    // Error(), if two assets share a name or the file cannot be written.
+    bool Write(const char* path);
+
+    uint32_t AssetCount() const;
+    uint64_t PayloadSize() const; // As stored, padding included
+    uint64_t RawSize() const;     // Of the assets as added
+    const char* Error() const;
+};
+
+} // namespace assets
+} // namespace toybox
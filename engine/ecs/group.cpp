@@ -0,0 +1,171 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstddef> // For size_t
+#include <cstdlib> // For malloc, free, abort
+#include <cstring> // For memset
+
+#include "group.h"
+
+namespace toybox
+{
+namespace ecs
+{
+
+static const size_t kColumnAlignment = 64;
+
+static size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Blocks are cache-line aligned so every column starts on its own line.
+static unsigned char* AllocateBlockMemory(size_t bytes) {
+    unsigned char* raw = static_cast<unsigned char*>(malloc(bytes + kColumnAlignment));
+    if (!raw) abort();
+    size_t shift = kColumnAlignment - (reinterpret_cast<size_t>(raw) & (kColumnAlignment - 1));
+    unsigned char* aligned = raw + shift;
+    aligned[-1] = static_cast<unsigned char>(shift);
+    return aligned;
+}
+
+static void FreeBlockMemory(unsigned char* memory) {
+    if (memory) {
+        free(memory - memory[-1]);
+    }
+}
+
+Group::Group(PartSignature part_signature, const PartInfo* part_infos)
+    : signature(part_signature), column_count(0), rows_per_block(0), count(0),
+      block_bytes(0), toys_offset(0) {
+    for (uint32_t i = 0; i < kMaxParts; ++i) {
+        column_of[i] = -1;
+        add_edges[i] = nullptr;
+        remove_edges[i] = nullptr;
+    }
+
+    size_t row_bytes = sizeof(Toy);
+    for (PartId id = 0; id < kMaxParts; ++id) {
+        if (!signature.Test(id)) continue;
+        part_ids[column_count] = id;
+        column_of[id] = static_cast<int32_t>(column_count);
+        infos[column_count] = &part_infos[id];
+        row_bytes += part_infos[id].size;
+        ++column_count;
+    }
+
+    // The version header and per-column padding come out of the block budget.
+    size_t header_bytes = AlignUp(2 * column_count * sizeof(uint32_t), kColumnAlignment);
+    size_t padding_bytes = (column_count + 1) * kColumnAlignment;
+    size_t usable = kBlockBytes > header_bytes + padding_bytes ? kBlockBytes - header_bytes - padding_bytes : 0;
+    rows_per_block = static_cast<uint32_t>(usable / row_bytes);
+    if (rows_per_block == 0) rows_per_block = 1;
+
+    toys_offset = header_bytes;
+    size_t offset = AlignUp(toys_offset + rows_per_block * sizeof(Toy), kColumnAlignment);
+    for (uint32_t c = 0; c < column_count; ++c) {
+        offset = AlignUp(offset, infos[c]->align > kColumnAlignment ? infos[c]->align : kColumnAlignment);
+        column_offsets[c] = offset;
+        offset += rows_per_block * infos[c]->size;
+    }
+    block_bytes = offset;
+}
+
+Group::~Group() {
+    for (size_t b = 0; b < blocks.Size(); ++b) {
+        Block& block = blocks.At(b);
+        for (uint32_t c = 0; c < column_count; ++c) {
+            if (!infos[c]->destroy) continue;
+            unsigned char* column = block.memory + column_offsets[c];
+            for (uint32_t i = 0; i < block.count; ++i) {
+                infos[c]->destroy(column + i * infos[c]->size);
+            }
+        }
+        FreeBlockMemory(block.memory);
+    }
+}
+
+uint32_t Group::PushRow(Toy toy, uint32_t tick) {
+    if (blocks.Empty() || blocks.Back().count == rows_per_block) {
+        Block block;
+        block.memory = AllocateBlockMemory(block_bytes);
+        block.changed_versions = reinterpret_cast<uint32_t*>(block.memory);
+        block.added_versions = block.changed_versions + column_count;
+        block.toys = reinterpret_cast<Toy*>(block.memory + toys_offset);
+        block.count = 0;
+        memset(block.changed_versions, 0, 2 * column_count * sizeof(uint32_t));
+        blocks.PushBack(block);
+    }
+
+    Block& block = blocks.Back();
+    for (uint32_t c = 0; c < column_count; ++c) {
+        block.changed_versions[c] = tick;
+    }
+    block.toys[block.count++] = toy;
+    return count++;
+}
+
+Toy Group::RemoveRow(uint32_t row, bool destroy_parts, uint32_t tick) {
+    uint32_t last = count - 1;
+    Block& block = BlockOf(row);
+    uint32_t slot = SlotOf(row);
+
+    if (destroy_parts) {
+        for (uint32_t c = 0; c < column_count; ++c) {
+            DestroyPart(*infos[c], static_cast<unsigned char*>(ColumnData(block, c)) + slot * infos[c]->size);
+        }
+    }
+
+    Toy moved = kInvalidToy;
+    Block& last_block = blocks.Back();
+    uint32_t last_slot = SlotOf(last);
+    if (row != last) {
+        for (uint32_t c = 0; c < column_count; ++c) {
+            size_t size = infos[c]->size;
+            MovePart(*infos[c], static_cast<unsigned char*>(ColumnData(block, c)) + slot * size,
+                     static_cast<unsigned char*>(ColumnData(last_block, c)) + last_slot * size);
+            block.changed_versions[c] = tick;
+            // The moved Part may have been added more recently than anything
+            // already in this block
+            if (VersionNewerThan(last_block.added_versions[c], block.added_versions[c])) {
+                block.added_versions[c] = last_block.added_versions[c];
+            }
+        }
+        moved = last_block.toys[last_slot];
+        block.toys[slot] = moved;
+    }
+
+    --last_block.count;
+    --count;
+    if (last_block.count == 0) {
+        FreeBlockMemory(last_block.memory);
+        blocks.PopBack();
+    }
+    return moved;
+}
+
+void* Group::ColumnData(const Block& block, uint32_t column) const {
+    return block.memory + column_offsets[column];
+}
+
+void* Group::PartAt(uint32_t row, uint32_t column) const {
+    const Block& block = blocks.At(row / rows_per_block);
+    return static_cast<unsigned char*>(ColumnData(block, column)) + SlotOf(row) * infos[column]->size;
+}
+
+Block& Group::BlockOf(uint32_t row) {
+    return blocks.At(row / rows_per_block);
+}
+
+uint32_t Group::SlotOf(uint32_t row) const {
+    return row % rows_per_block;
+}
+
+} // namespace ecs
+} // namespace toybox
@@ -0,0 +1,84 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint32_t
+
+#include "dynamicarray.h"
+#include "part_registry.h"
+#include "toy.h"
+
+namespace toybox
+{
+namespace ecs
+{
+
+using toybox::utils::data_structures::DynamicArray;
+
+// Target size of one block of a group. Every column of a block lives in the
+// same allocation, so a block is the unit of both iteration and change tracking.
+constexpr size_t kBlockBytes = 16 * 1024;
+
+// A fixed-capacity slice of a group. Each column carries the tick of the last
+// write and of the last time a Part was added to one of its rows, so Works can
+// skip blocks that have not changed since they last ran.
+struct Block {
+    unsigned char* memory;
+    Toy* toys;
+    uint32_t* changed_versions;
+    uint32_t* added_versions;
+    uint32_t count;
+};
+
+// Every Toy with exactly the same set of Parts lives in the same group, packed
+// into blocks of column arrays.
+struct Group {
+    PartSignature signature;
+    uint32_t column_count;
+    uint32_t rows_per_block;
+    uint32_t count;
+    size_t block_bytes;
+    size_t toys_offset;
+    PartId part_ids[kMaxParts];
+    int32_t column_of[kMaxParts]; // -1 if the Part is not in this group
+    size_t column_offsets[kMaxParts];
+    const PartInfo* infos[kMaxParts];
+    DynamicArray<Block> blocks;
+
+    // Cached neighbours in the group graph, indexed by PartId
+    Group* add_edges[kMaxParts];
+    Group* remove_edges[kMaxParts];
+
+    Group(PartSignature part_signature, const PartInfo* part_infos);
+    ~Group();
+
+    Group(const Group&) = delete;
+    Group& operator=(const Group&) = delete;
+
+    // Reserves a row for the Toy and stamps every column of its block as changed.
+    // The caller is responsible for constructing the Parts in the new row.
+    uint32_t PushRow(Toy toy, uint32_t tick);
+
+    // Swap-removes a row. If destroy_parts is false the Parts are assumed to have
+    // been moved out already. Returns the Toy that now occupies the row, or
+    // kInvalidToy if the removed row was the last one.
+    Toy RemoveRow(uint32_t row, bool destroy_parts, uint32_t tick);
+
+    void* ColumnData(const Block& block, uint32_t column) const;
+    void* PartAt(uint32_t row, uint32_t column) const;
+
+    Block& BlockOf(uint32_t row);
+    uint32_t SlotOf(uint32_t row) const;
+};
+
+} // namespace ecs
+} // namespace toybox
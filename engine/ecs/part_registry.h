@@ -0,0 +1,314 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef>     // For size_t
+#include <cstdint>     // For uint32_t, uint64_t
+#include <cstring>     // For memcpy
+#include <new>         // For placement new
+#include <string_view> // For std::string_view
+#include <type_traits> // For std::integral_constant, std::remove_const, std::void_t
+#include <utility>     // For std::move
+
+namespace toybox
+{
+namespace ecs
+{
+
+typedef uint32_t PartId;
+
+constexpr uint32_t kMaxParts = 128;
+constexpr uint32_t kSignatureWords = kMaxParts / 64;
+
+// A fixed-size bitset of PartIds. Everything is constexpr so signatures built
+// from Part lists fold down to constants.
+struct PartSignature {
+    uint64_t words[kSignatureWords];
+
+    constexpr PartSignature() : words{} {}
+
+    static constexpr PartSignature Of(PartId id) {
+        PartSignature signature;
+        signature.words[id / 64] = uint64_t(1) << (id % 64);
+        return signature;
+    }
+
+    constexpr bool Test(PartId id) const {
+        return (words[id / 64] >> (id % 64)) & 1;
+    }
+
+    constexpr bool Empty() const {
+        for (uint32_t i = 0; i < kSignatureWords; ++i) {
+            if (words[i]) return false;
+        }
+        return true;
+    }
+
+    // True if every Part in other is also in this signature
+    constexpr bool Contains(const PartSignature& other) const {
+        for (uint32_t i = 0; i < kSignatureWords; ++i) {
+            if ((words[i] & other.words[i]) != other.words[i]) return false;
+        }
+        return true;
+    }
+
+    constexpr PartSignature operator|(const PartSignature& other) const {
+        PartSignature result;
+        for (uint32_t i = 0; i < kSignatureWords; ++i) result.words[i] = words[i] | other.words[i];
+        return result;
+    }
+
+    constexpr PartSignature operator&(const PartSignature& other) const {
+        PartSignature result;
+        for (uint32_t i = 0; i < kSignatureWords; ++i) result.words[i] = words[i] & other.words[i];
+        return result;
+    }
+
+    constexpr PartSignature operator~() const {
+        PartSignature result;
+        for (uint32_t i = 0; i < kSignatureWords; ++i) result.words[i] = ~words[i];
+        return result;
+    }
+
+    constexpr PartSignature& operator|=(const PartSignature& other) {
+        for (uint32_t i = 0; i < kSignatureWords; ++i) words[i] |= other.words[i];
+        return *this;
+    }
+
+    constexpr PartSignature& operator&=(const PartSignature& other) {
+        for (uint32_t i = 0; i < kSignatureWords; ++i) words[i] &= other.words[i];
+        return *this;
+    }
+
+    constexpr bool operator==(const PartSignature& other) const {
+        for (uint32_t i = 0; i < kSignatureWords; ++i) {
+            if (words[i] != other.words[i]) return false;
+        }
+        return true;
+    }
+
+    constexpr bool operator!=(const PartSignature& other) const {
+        return !(*this == other);
+    }
+};
+
+// Where a Part's data lives. Packed Parts are columns of the Toy's group;
+// sparse Parts live in their own sparse set, so adding and removing them
+// never moves the Toy between groups.
+enum class PartStorage {
+    Packed,
+    Sparse
+};
+
+// Parts are packed unless they declare
+//     static constexpr PartStorage kStorage = PartStorage::Sparse;
+template<typename T, typename = void>
+struct PartStorageOf {
+    static constexpr PartStorage value = PartStorage::Packed;
+};
+
+template<typename T>
+struct PartStorageOf<T, std::void_t<decltype(T::kStorage)>> {
+    static constexpr PartStorage value = T::kStorage;
+};
+
+// The bare type name as the compiler spells it, cut out of the function
+// signature so it matches across GCC, Clang and MSVC.
+template<typename T>
+constexpr std::string_view PartTypeName() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    std::string_view signature = __FUNCSIG__;
+    std::string_view prefix = "PartTypeName<";
+    std::string_view suffix = ">(void)";
+    size_t start = signature.find(prefix) + prefix.size();
+    std::string_view name = signature.substr(start, signature.rfind(suffix) - start);
+    if (name.substr(0, 7) == "struct ") name.remove_prefix(7);
+    if (name.substr(0, 6) == "class ") name.remove_prefix(6);
+    return name;
+#else
+    std::string_view signature = __PRETTY_FUNCTION__;
+    std::string_view prefix = "T = ";
+    size_t start = signature.find(prefix) + prefix.size();
+    size_t end = signature.find_first_of(";]", start);
+    return signature.substr(start, end - start);
+#endif
+}
+
+// FNV-1a over the type name. Unlike PartIds, these do not depend on the order
+// of a registry, so they are what gets written into saved data.
+template<typename T>
+constexpr uint64_t PartNameHash() {
+    std::string_view name = PartTypeName<T>();
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < name.size(); ++i) {
+        hash ^= static_cast<unsigned char>(name[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Type-erased lifecycle functions so the storage can shuffle Parts between
+// groups without knowing their types. Trivial Parts leave move/copy and
+// destroy null so the storage can memcpy and skip destruction instead of
+// calling through a pointer per row.
+struct PartInfo {
+    size_t size;
+    size_t align;
+    uint64_t name_hash;
+    void (*construct)(void* dst);
+    void (*move)(void* dst, void* src); // Move-constructs dst from src, then destroys src
+    void (*copy)(void* dst, const void* src);
+    void (*destroy)(void* ptr);
+};
+
+template<typename T>
+struct PartLifecycle {
+    static void Construct(void* dst) {
+        new (dst) T();
+    }
+
+    static void Move(void* dst, void* src) {
+        T* from = static_cast<T*>(src);
+        new (dst) T(std::move(*from));
+        from->~T();
+    }
+
+    static void Copy(void* dst, const void* src) {
+        new (dst) T(*static_cast<const T*>(src));
+    }
+
+    static void Destroy(void* ptr) {
+        static_cast<T*>(ptr)->~T();
+    }
+};
+
+template<typename T>
+constexpr PartInfo MakePartInfo() {
+    // Storage records its shift to an aligned start in a single byte
+    static_assert(alignof(T) <= 128, "Parts may be aligned to at most 128 bytes");
+    constexpr bool trivial = std::is_trivially_copyable<T>::value;
+    return PartInfo{
+        sizeof(T),
+        alignof(T),
+        PartNameHash<T>(),
+        &PartLifecycle<T>::Construct,
+        trivial ? nullptr : &PartLifecycle<T>::Move,
+        trivial ? nullptr : &PartLifecycle<T>::Copy,
+        std::is_trivially_destructible<T>::value ? nullptr : &PartLifecycle<T>::Destroy
+    };
+}
+
+inline void MovePart(const PartInfo& info, void* dst, void* src) {
+    if (info.move) {
+        info.move(dst, src);
+    } else {
+        memcpy(dst, src, info.size);
+    }
+}
+
+inline void CopyPart(const PartInfo& info, void* dst, const void* src) {
+    if (info.copy) {
+        info.copy(dst, src);
+    } else {
+        memcpy(dst, src, info.size);
+    }
+}
+
+inline void DestroyPart(const PartInfo& info, void* ptr) {
+    if (info.destroy) {
+        info.destroy(ptr);
+    }
+}
+
+template<typename T, typename... Ts>
+struct PartIndexOf;
+
+template<typename T, typename... Ts>
+struct PartIndexOf<T, T, Ts...> : std::integral_constant<PartId, 0> {};
+
+template<typename T, typename U, typename... Ts>
+struct PartIndexOf<T, U, Ts...> : std::integral_constant<PartId, 1 + PartIndexOf<T, Ts...>::value> {};
+
+template<typename T, typename... Ts>
+struct PartListContains : std::bool_constant<(std::is_same<T, Ts>::value || ...)> {};
+
+template<typename... Ts>
+struct PartListUnique;
+
+template<>
+struct PartListUnique<> : std::true_type {};
+
+template<typename T, typename... Ts>
+struct PartListUnique<T, Ts...>
+    : std::bool_constant<!PartListContains<T, Ts...>::value && PartListUnique<Ts...>::value> {};
+
+// The list of Parts a game uses. A Part's id is its position in the list, so
+// ids are dense and stay the same from run to run as long as the list does.
+// Ids, signatures and the lifecycle table all resolve at compile time.
+template<typename... Parts>
+struct PartRegistry {
+    static constexpr uint32_t kCount = sizeof...(Parts);
+    static_assert(kCount <= kMaxParts, "Too many Parts for a PartSignature");
+    static_assert(PartListUnique<Parts...>::value, "A Part is listed twice in the registry");
+
+    template<typename T>
+    static constexpr bool Contains() {
+        return PartListContains<typename std::remove_const<T>::type, Parts...>::value;
+    }
+
+    template<typename T>
+    static constexpr PartId IdOf() {
+        static_assert(Contains<T>(), "Part is not in this registry");
+        return PartIndexOf<typename std::remove_const<T>::type, Parts...>::value;
+    }
+
+    template<typename T>
+    static constexpr bool IsSparse() {
+        return PartStorageOf<typename std::remove_const<T>::type>::value == PartStorage::Sparse;
+    }
+
+    template<typename... Ts>
+    static constexpr PartSignature SignatureOf() {
+        return (PartSignature() | ... | PartSignature::Of(IdOf<Ts>()));
+    }
+
+    template<typename... Ts>
+    static constexpr PartSignature PackedSignatureOf() {
+        return (PartSignature() | ... | (IsSparse<Ts>() ? PartSignature() : PartSignature::Of(IdOf<Ts>())));
+    }
+
+    template<typename... Ts>
+    static constexpr PartSignature SparseSignatureOf() {
+        return (PartSignature() | ... | (IsSparse<Ts>() ? PartSignature::Of(IdOf<Ts>()) : PartSignature()));
+    }
+
+    // Every sparse Part in the registry
+    static constexpr PartSignature SparseSignature() {
+        return SparseSignatureOf<Parts...>();
+    }
+
+    static constexpr PartInfo kInfos[kCount + 1] = { MakePartInfo<Parts>()..., PartInfo() };
+
+    static const PartInfo* Infos() {
+        return kInfos;
+    }
+
+    // Maps a saved name hash back to the current PartId; kCount if unknown
+    static constexpr PartId IdOfNameHash(uint64_t name_hash) {
+        for (PartId id = 0; id < kCount; ++id) {
+            if (kInfos[id].name_hash == name_hash) return id;
+        }
+        return kCount;
+    }
+};
+
+} // namespace ecs
+} // namespace toybox
@@ -0,0 +1,175 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstddef> // For size_t
+#include <cstdlib> // For malloc, realloc, free, abort
+#include <cstring> // For memset, memcpy
+
+#include "sparse_set.h"
+
+namespace toybox
+{
+namespace ecs
+{
+
+// Part storage keeps the Part's alignment, which may be more than malloc's.
+// The shift to the aligned start is stored in the byte before it.
+static unsigned char* AllocatePartMemory(size_t bytes, size_t alignment) {
+    unsigned char* raw = static_cast<unsigned char*>(malloc(bytes + alignment));
+    if (!raw) abort();
+    size_t shift = alignment - (reinterpret_cast<size_t>(raw) & (alignment - 1));
+    unsigned char* aligned = raw + shift;
+    aligned[-1] = static_cast<unsigned char>(shift);
+    return aligned;
+}
+
+static void FreePartMemory(unsigned char* memory) {
+    if (memory) {
+        free(memory - memory[-1]);
+    }
+}
+
+SparseSet::SparseSet(const PartInfo* part_info)
+    : pages(nullptr), page_count(0), toys(nullptr), parts(nullptr),
+      changed_versions(nullptr), added_versions(nullptr),
+      size(0), capacity(0), info(part_info) {}
+
+SparseSet::~SparseSet() {
+    for (uint32_t i = 0; info->destroy && i < size; ++i) {
+        info->destroy(PartAt(i));
+    }
+    for (uint32_t p = 0; p < page_count; ++p) {
+        free(pages[p]);
+    }
+    free(pages);
+    free(toys);
+    FreePartMemory(parts);
+    free(changed_versions);
+    free(added_versions);
+}
+
+void SparseSet::Grow(uint32_t new_capacity) {
+    // Non-trivial Parts are moved one by one; trivial ones are a single memcpy
+    unsigned char* new_parts = AllocatePartMemory(static_cast<size_t>(new_capacity) * info->size, info->align);
+    Toy* new_toys = static_cast<Toy*>(realloc(toys, static_cast<size_t>(new_capacity) * sizeof(Toy)));
+    if (!new_toys) abort();
+
+    if (info->move) {
+        for (uint32_t i = 0; i < size; ++i) {
+            info->move(new_parts + static_cast<size_t>(i) * info->size, PartAt(i));
+        }
+    } else if (size > 0) {
+        memcpy(new_parts, parts, static_cast<size_t>(size) * info->size);
+    }
+    FreePartMemory(parts);
+    parts = new_parts;
+    toys = new_toys;
+
+    uint32_t old_chunks = (capacity + kSparseChunkSize - 1) / kSparseChunkSize;
+    uint32_t new_chunks = (new_capacity + kSparseChunkSize - 1) / kSparseChunkSize;
+    changed_versions = static_cast<uint32_t*>(realloc(changed_versions, new_chunks * sizeof(uint32_t)));
+    added_versions = static_cast<uint32_t*>(realloc(added_versions, new_chunks * sizeof(uint32_t)));
+    if (!changed_versions || !added_versions) abort();
+    for (uint32_t c = old_chunks; c < new_chunks; ++c) {
+        changed_versions[c] = 0;
+        added_versions[c] = 0;
+    }
+
+    capacity = new_capacity;
+}
+
+uint32_t* SparseSet::SlotFor(uint32_t toy_index) {
+    uint32_t page = toy_index / kSparsePageSize;
+    if (page >= page_count) {
+        uint32_t new_count = page + 1;
+        pages = static_cast<uint32_t**>(realloc(pages, new_count * sizeof(uint32_t*)));
+        if (!pages) abort();
+        for (uint32_t p = page_count; p < new_count; ++p) {
+            pages[p] = nullptr;
+        }
+        page_count = new_count;
+    }
+    if (!pages[page]) {
+        pages[page] = static_cast<uint32_t*>(malloc(kSparsePageSize * sizeof(uint32_t)));
+        if (!pages[page]) abort();
+        memset(pages[page], 0xFF, kSparsePageSize * sizeof(uint32_t));
+    }
+    return &pages[page][toy_index % kSparsePageSize];
+}
+
+void* SparseSet::Insert(Toy toy, uint32_t tick) {
+    if (size == capacity) {
+        Grow(capacity ? capacity * 2 : 64);
+    }
+
+    uint32_t dense = size++;
+    *SlotFor(toy.index) = dense;
+    toys[dense] = toy;
+    changed_versions[dense / kSparseChunkSize] = tick;
+    added_versions[dense / kSparseChunkSize] = tick;
+    return PartAt(dense);
+}
+
+void SparseSet::Remove(uint32_t toy_index, uint32_t tick) {
+    uint32_t dense = DenseIndexOf(toy_index);
+    if (dense == kSparseEmpty) return;
+
+    DestroyPart(*info, PartAt(dense));
+    uint32_t last = size - 1;
+    if (dense != last) {
+        MovePart(*info, PartAt(dense), PartAt(last));
+        toys[dense] = toys[last];
+        *SlotFor(toys[dense].index) = dense;
+        changed_versions[dense / kSparseChunkSize] = tick;
+        uint32_t& added = added_versions[dense / kSparseChunkSize];
+        if (VersionNewerThan(added_versions[last / kSparseChunkSize], added)) {
+            added = added_versions[last / kSparseChunkSize];
+        }
+    }
+    *SlotFor(toy_index) = kSparseEmpty;
+    --size;
+}
+
+uint32_t SparseSet::DenseIndexOf(uint32_t toy_index) const {
+    uint32_t page = toy_index / kSparsePageSize;
+    if (page >= page_count || !pages[page]) return kSparseEmpty;
+    return pages[page][toy_index % kSparsePageSize];
+}
+
+bool SparseSet::Contains(uint32_t toy_index) const {
+    return DenseIndexOf(toy_index) != kSparseEmpty;
+}
+
+void* SparseSet::PartAt(uint32_t dense_index) const {
+    return parts + static_cast<size_t>(dense_index) * info->size;
+}
+
+void SparseSet::MarkChanged(uint32_t dense_index, uint32_t tick) {
+    changed_versions[dense_index / kSparseChunkSize] = tick;
+}
+
+uint32_t SparseSet::ChangedVersion(uint32_t dense_index) const {
+    return changed_versions[dense_index / kSparseChunkSize];
+}
+
+uint32_t SparseSet::AddedVersion(uint32_t dense_index) const {
+    return added_versions[dense_index / kSparseChunkSize];
+}
+
+const Toy* SparseSet::Toys() const {
+    return toys;
+}
+
+uint32_t SparseSet::Size() const {
+    return size;
+}
+
+} // namespace ecs
+} // namespace toybox
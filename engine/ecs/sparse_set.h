@@ -0,0 +1,84 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint32_t
+
+#include "part_registry.h"
+#include "toy.h"
+
+namespace toybox
+{
+namespace ecs
+{
+
+// Entries per page of the sparse index. Pages are only allocated once a Toy
+// index inside them holds the Part.
+constexpr uint32_t kSparsePageSize = 4096;
+
+// Dense entries sharing one change/added version pair.
+constexpr uint32_t kSparseChunkSize = 256;
+
+constexpr uint32_t kSparseEmpty = 0xFFFFFFFFu;
+
+// Storage for one sparse Part: a paged index from Toy index to dense slot, and
+// a packed dense array of Parts and their owners. Adding or removing a Part
+// never moves the Toy between groups.
+struct SparseSet {
+private:
+    uint32_t** pages;
+    uint32_t page_count;
+    Toy* toys;
+    unsigned char* parts;
+    uint32_t* changed_versions;
+    uint32_t* added_versions;
+    uint32_t size;
+    uint32_t capacity;
+    const PartInfo* info;
+
+    void Grow(uint32_t new_capacity);
+    uint32_t* SlotFor(uint32_t toy_index);
+
+public:
+    explicit SparseSet(const PartInfo* part_info);
+    ~SparseSet();
+
+    SparseSet(const SparseSet&) = delete;
+    SparseSet& operator=(const SparseSet&) = delete;
+
+    // Reserves a dense slot for the Toy and returns uninitialised storage for
+    // the Part. The Toy must not already be in the set.
+    void* Insert(Toy toy, uint32_t tick);
+
+    // Destroys the Toy's Part and swap-removes it from the dense array
+    void Remove(uint32_t toy_index, uint32_t tick);
+
+    // Dense slot of the Toy, or kSparseEmpty
+    uint32_t DenseIndexOf(uint32_t toy_index) const;
+
+    bool Contains(uint32_t toy_index) const;
+
+    // Pointer to the Part of a dense slot
+    void* PartAt(uint32_t dense_index) const;
+
+    // Stamps the chunk holding a dense slot as changed
+    void MarkChanged(uint32_t dense_index, uint32_t tick);
+
+    uint32_t ChangedVersion(uint32_t dense_index) const;
+    uint32_t AddedVersion(uint32_t dense_index) const;
+
+    const Toy* Toys() const;
+    uint32_t Size() const;
+};
+
+} // namespace ecs
+} // namespace toybox
@@ -0,0 +1,44 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t
+
+namespace toybox
+{
+namespace ecs
+{
+
+// A Toy is just a handle: an index into the world's records plus a generation
+// so stale handles to recycled slots can be detected.
+struct Toy {
+    uint32_t index;
+    uint32_t generation;
+
+    bool operator==(const Toy& other) const {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const Toy& other) const {
+        return !(*this == other);
+    }
+};
+
+constexpr Toy kInvalidToy = { 0xFFFFFFFFu, 0 };
+
+// Returns true if version a was stamped after version b. Written as a signed
+// difference so the comparison keeps working when the tick counter wraps.
+inline bool VersionNewerThan(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) > 0;
+}
+
+} // namespace ecs
+} // namespace toybox
@@ -0,0 +1,158 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint32_t
+#include <utility> // For std::index_sequence
+
+#include "dynamicarray.h"
+#include "group.h"
+#include "part_registry.h"
+#include "sparse_set.h"
+#include "toy.h"
+
+namespace toybox
+{
+namespace ecs
+{
+
+using toybox::utils::data_structures::DynamicArray;
+
+// Iteration filters. A block passes if any listed Part column was written to
+// (Changed) or had a Part added to one of its rows (Added) after `since`.
+// For sparse Parts the test is made per sparse-set chunk instead of per block.
+// The Parts of one filter must all use the same storage.
+struct NoFilter {};
+
+template<typename... Parts>
+struct Changed {
+    uint32_t since;
+};
+
+template<typename... Parts>
+struct Added {
+    uint32_t since;
+};
+
+// What a Work keeps between runs so its change filters only see what happened
+// since it last looked.
+struct WorkClock {
+    uint32_t last_run = 0;
+};
+
+template<typename Registry>
+struct World {
+private:
+    struct ToyRecord {
+        Group* group;
+        uint32_t row;
+        uint32_t generation;
+        PartSignature sparse_parts; // Sparse Parts the Toy currently has
+    };
+
+    DynamicArray<ToyRecord> records;
+    DynamicArray<uint32_t> free_indices;
+    DynamicArray<Group*> groups;
+    SparseSet* sparse_sets[kMaxParts];
+    Group* empty_group;
+    uint32_t change_tick;
+    uint32_t alive_count;
+
+    Group* FindOrCreateGroup(const PartSignature& signature);
+    Group* AddEdge(Group* group, PartId id);
+    Group* RemoveEdge(Group* group, PartId id);
+    void MoveToy(Toy toy, Group* destination);
+
+    template<typename T>
+    T& Fetch(void* column, uint32_t slot, uint32_t toy_index);
+
+    template<typename... Parts, typename Fn, size_t... I>
+    void Invoke(Fn& fn, Toy toy, void* const* columns, uint32_t slot, std::index_sequence<I...>);
+
+public:
+    World();
+    ~World();
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // Create an empty Toy
+    Toy Create();
+
+    // Destroy a Toy and all of its Parts
+    void Destroy(Toy toy);
+
+    // Check whether a handle still refers to a live Toy
+    bool Alive(Toy toy) const;
+
+    // Number of live Toys
+    size_t Count() const;
+
+    // Add a Part (or overwrite it if already present) and return a pointer to it
+    template<typename T>
+    T* Add(Toy toy, const T& value = T());
+
+    // Remove a Part if present
+    template<typename T>
+    void Remove(Toy toy);
+
+    template<typename T>
+    bool Has(Toy toy) const;
+
+    // Read-only access; does not touch change versions
+    template<typename T>
+    const T* Read(Toy toy) const;
+
+    // Write access; stamps the Part column of the Toy's block as changed
+    template<typename T>
+    T* Write(Toy toy);
+
+    // The tick stamped on writes made right now
+    uint32_t ChangeTick() const;
+
+    // Start a new tick; returns the new value
+    uint32_t AdvanceTick();
+
+    // Begins a Work run. Returns the tick to pass to Changed/Added filters,
+    // then advances the world so the run writes on a tick of its own.
+    uint32_t BeginWork(WorkClock* clock);
+
+    // Ends the run BeginWork began: counts everything written up to now,
+    // the run's own writes included, as seen by the Work, then advances the
+    // world so later writes are newer. A Work that filters on a Part it also
+    // writes must call this, or it finds its own writes on every run.
+    void EndWork(WorkClock* clock);
+
+    // Calls fn(count, toys, columns...) once per block holding all of Parts...
+    // that passes the filter. Non-const Parts are treated as writes and stamp
+    // the block's column version. Only packed Parts have columns; use Each to
+    // mix in sparse Parts.
+    template<typename... Parts, typename Filter, typename Fn>
+    void EachBlock(const Filter& filter, Fn fn);
+
+    template<typename... Parts, typename Fn>
+    void EachBlock(Fn fn);
+
+    // Calls fn(toy, parts...) for every Toy in blocks that pass the filter.
+    // Packed Parts drive the walk and sparse Parts are looked up per Toy; if
+    // every Part is sparse the smallest set is walked instead.
+    template<typename... Parts, typename Filter, typename Fn>
+    void Each(const Filter& filter, Fn fn);
+
+    template<typename... Parts, typename Fn>
+    void Each(Fn fn);
+};
+
+} // namespace ecs
+} // namespace toybox
+
+#include "world.inl"
@@ -0,0 +1,482 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef>     // For size_t
+#include <cstdint>     // For uint32_t
+#include <cstdlib>     // For abort
+#include <new>         // For placement new
+#include <type_traits> // For std::is_const
+
+namespace toybox
+{
+namespace ecs
+{
+
+// Per-filter tests. Filters over packed Parts are checked once per block and
+// filters over sparse Parts once per Toy. The masks list the Parts a Toy must
+// have for the filter to apply.
+template<typename Registry, typename Filter>
+struct FilterTraits;
+
+template<typename Registry>
+struct FilterTraits<Registry, NoFilter> {
+    static constexpr PartSignature PackedSignature() { return PartSignature(); }
+    static constexpr PartSignature SparseSignature() { return PartSignature(); }
+
+    static bool PassesBlock(const Group&, const Block&, const NoFilter&) {
+        return true;
+    }
+
+    static bool PassesToy(SparseSet* const*, uint32_t, const NoFilter&) {
+        return true;
+    }
+};
+
+template<typename Registry, typename... Parts>
+struct FilterTraits<Registry, Changed<Parts...>> {
+    static constexpr bool kSparse = !Registry::template SparseSignatureOf<Parts...>().Empty();
+    static_assert(!kSparse || Registry::template PackedSignatureOf<Parts...>().Empty(),
+                  "A Changed filter cannot mix packed and sparse Parts");
+
+    static constexpr PartSignature PackedSignature() { return Registry::template PackedSignatureOf<Parts...>(); }
+    static constexpr PartSignature SparseSignature() { return Registry::template SparseSignatureOf<Parts...>(); }
+
+    static bool PassesBlock(const Group& group, const Block& block, const Changed<Parts...>& filter) {
+        if constexpr (kSparse) {
+            return true;
+        } else {
+            return (false || ... || VersionNewerThan(
+                block.changed_versions[group.column_of[Registry::template IdOf<Parts>()]], filter.since));
+        }
+    }
+
+    static bool PassesToy(SparseSet* const* sets, uint32_t toy_index, const Changed<Parts...>& filter) {
+        if constexpr (kSparse) {
+            return (false || ... || VersionNewerThan(
+                sets[Registry::template IdOf<Parts>()]->ChangedVersion(
+                    sets[Registry::template IdOf<Parts>()]->DenseIndexOf(toy_index)), filter.since));
+        } else {
+            return true;
+        }
+    }
+};
+
+template<typename Registry, typename... Parts>
+struct FilterTraits<Registry, Added<Parts...>> {
+    static constexpr bool kSparse = !Registry::template SparseSignatureOf<Parts...>().Empty();
+    static_assert(!kSparse || Registry::template PackedSignatureOf<Parts...>().Empty(),
+                  "An Added filter cannot mix packed and sparse Parts");
+
+    static constexpr PartSignature PackedSignature() { return Registry::template PackedSignatureOf<Parts...>(); }
+    static constexpr PartSignature SparseSignature() { return Registry::template SparseSignatureOf<Parts...>(); }
+
+    static bool PassesBlock(const Group& group, const Block& block, const Added<Parts...>& filter) {
+        if constexpr (kSparse) {
+            return true;
+        } else {
+            return (false || ... || VersionNewerThan(
+                block.added_versions[group.column_of[Registry::template IdOf<Parts>()]], filter.since));
+        }
+    }
+
+    static bool PassesToy(SparseSet* const* sets, uint32_t toy_index, const Added<Parts...>& filter) {
+        if constexpr (kSparse) {
+            return (false || ... || VersionNewerThan(
+                sets[Registry::template IdOf<Parts>()]->AddedVersion(
+                    sets[Registry::template IdOf<Parts>()]->DenseIndexOf(toy_index)), filter.since));
+        } else {
+            return true;
+        }
+    }
+};
+
+template<typename Registry>
+World<Registry>::World()
+    : empty_group(nullptr), change_tick(1), alive_count(0) {
+    for (PartId id = 0; id < kMaxParts; ++id) {
+        bool sparse = id < Registry::kCount && Registry::SparseSignature().Test(id);
+        sparse_sets[id] = sparse ? new SparseSet(&Registry::Infos()[id]) : nullptr;
+    }
+    empty_group = FindOrCreateGroup(PartSignature());
+}
+
+template<typename Registry>
+World<Registry>::~World() {
+    for (size_t i = 0; i < groups.Size(); ++i) {
+        delete groups.At(i);
+    }
+    for (PartId id = 0; id < kMaxParts; ++id) {
+        delete sparse_sets[id];
+    }
+}
+
+template<typename Registry>
+Group* World<Registry>::FindOrCreateGroup(const PartSignature& signature) {
+    for (size_t i = 0; i < groups.Size(); ++i) {
+        if (groups.At(i)->signature == signature) return groups.At(i);
+    }
+    Group* group = new Group(signature, Registry::Infos());
+    groups.PushBack(group);
+    return group;
+}
+
+template<typename Registry>
+Group* World<Registry>::AddEdge(Group* group, PartId id) {
+    if (!group->add_edges[id]) {
+        group->add_edges[id] = FindOrCreateGroup(group->signature | PartSignature::Of(id));
+    }
+    return group->add_edges[id];
+}
+
+template<typename Registry>
+Group* World<Registry>::RemoveEdge(Group* group, PartId id) {
+    if (!group->remove_edges[id]) {
+        group->remove_edges[id] = FindOrCreateGroup(group->signature & ~PartSignature::Of(id));
+    }
+    return group->remove_edges[id];
+}
+
+template<typename Registry>
+void World<Registry>::MoveToy(Toy toy, Group* destination) {
+    ToyRecord& record = records.At(toy.index);
+    Group* source = record.group;
+    uint32_t source_row = record.row;
+    uint32_t row = destination->PushRow(toy, change_tick);
+
+    // Parts shared by both groups move across, taking their added versions
+    // with them; the rest are destroyed.
+    const Block& from_block = source->BlockOf(source_row);
+    Block& to_block = destination->BlockOf(row);
+    for (uint32_t c = 0; c < source->column_count; ++c) {
+        void* from = source->PartAt(source_row, c);
+        int32_t to = destination->column_of[source->part_ids[c]];
+        if (to >= 0) {
+            MovePart(*source->infos[c], destination->PartAt(row, static_cast<uint32_t>(to)), from);
+            uint32_t& added = to_block.added_versions[to];
+            if (VersionNewerThan(from_block.added_versions[c], added)) {
+                added = from_block.added_versions[c];
+            }
+        } else {
+            DestroyPart(*source->infos[c], from);
+        }
+    }
+
+    Toy moved = source->RemoveRow(source_row, false, change_tick);
+    if (moved != kInvalidToy) {
+        records.At(moved.index).row = source_row;
+    }
+    record.group = destination;
+    record.row = row;
+}
+
+template<typename Registry>
+Toy World<Registry>::Create() {
+    Toy toy;
+    if (!free_indices.Empty()) {
+        toy.index = free_indices.Back();
+        free_indices.PopBack();
+        toy.generation = records.At(toy.index).generation;
+    } else {
+        ToyRecord record = { nullptr, 0, 0, PartSignature() };
+        toy.index = static_cast<uint32_t>(records.Size());
+        toy.generation = 0;
+        records.PushBack(record);
+    }
+
+    ToyRecord& record = records.At(toy.index);
+    record.group = empty_group;
+    record.row = empty_group->PushRow(toy, change_tick);
+    ++alive_count;
+    return toy;
+}
+
+template<typename Registry>
+void World<Registry>::Destroy(Toy toy) {
+    if (!Alive(toy)) return;
+
+    ToyRecord& record = records.At(toy.index);
+    for (PartId id = 0; !record.sparse_parts.Empty(); ++id) {
+        if (record.sparse_parts.Test(id)) {
+            sparse_sets[id]->Remove(toy.index, change_tick);
+            record.sparse_parts &= ~PartSignature::Of(id);
+        }
+    }
+
+    Toy moved = record.group->RemoveRow(record.row, true, change_tick);
+    if (moved != kInvalidToy) {
+        records.At(moved.index).row = record.row;
+    }
+    record.group = nullptr;
+    ++record.generation;
+    free_indices.PushBack(toy.index);
+    --alive_count;
+}
+
+template<typename Registry>
+bool World<Registry>::Alive(Toy toy) const {
+    if (toy.index >= records.Size()) return false;
+    const ToyRecord& record = records.At(toy.index);
+    return record.group != nullptr && record.generation == toy.generation;
+}
+
+template<typename Registry>
+size_t World<Registry>::Count() const {
+    return alive_count;
+}
+
+template<typename Registry>
+template<typename T>
+T* World<Registry>::Add(Toy toy, const T& value) {
+    if (!Alive(toy)) return nullptr;
+
+    const PartId id = Registry::template IdOf<T>();
+    if (Has<T>(toy)) {
+        T* part = Write<T>(toy);
+        *part = value;
+        return part;
+    }
+
+    ToyRecord& record = records.At(toy.index);
+    if constexpr (Registry::template IsSparse<T>()) {
+        record.sparse_parts |= PartSignature::Of(id);
+        return new (sparse_sets[id]->Insert(toy, change_tick)) T(value);
+    }
+
+    MoveToy(toy, AddEdge(record.group, id));
+
+    Group* group = record.group;
+    uint32_t column = static_cast<uint32_t>(group->column_of[id]);
+    T* part = new (group->PartAt(record.row, column)) T(value);
+    group->BlockOf(record.row).added_versions[column] = change_tick;
+    return part;
+}
+
+template<typename Registry>
+template<typename T>
+void World<Registry>::Remove(Toy toy) {
+    if (!Has<T>(toy)) return;
+
+    const PartId id = Registry::template IdOf<T>();
+    ToyRecord& record = records.At(toy.index);
+    if constexpr (Registry::template IsSparse<T>()) {
+        sparse_sets[id]->Remove(toy.index, change_tick);
+        record.sparse_parts &= ~PartSignature::Of(id);
+    } else {
+        MoveToy(toy, RemoveEdge(record.group, id));
+    }
+}
+
+template<typename Registry>
+template<typename T>
+bool World<Registry>::Has(Toy toy) const {
+    if (!Alive(toy)) return false;
+
+    const PartId id = Registry::template IdOf<T>();
+    const ToyRecord& record = records.At(toy.index);
+    if constexpr (Registry::template IsSparse<T>()) {
+        return record.sparse_parts.Test(id);
+    } else {
+        return record.group->column_of[id] >= 0;
+    }
+}
+
+template<typename Registry>
+template<typename T>
+const T* World<Registry>::Read(Toy toy) const {
+    if (!Has<T>(toy)) return nullptr;
+
+    const PartId id = Registry::template IdOf<T>();
+    if constexpr (Registry::template IsSparse<T>()) {
+        return static_cast<const T*>(sparse_sets[id]->PartAt(sparse_sets[id]->DenseIndexOf(toy.index)));
+    } else {
+        const ToyRecord& record = records.At(toy.index);
+        int32_t column = record.group->column_of[id];
+        return static_cast<const T*>(record.group->PartAt(record.row, static_cast<uint32_t>(column)));
+    }
+}
+
+template<typename Registry>
+template<typename T>
+T* World<Registry>::Write(Toy toy) {
+    if (!Has<T>(toy)) return nullptr;
+
+    const PartId id = Registry::template IdOf<T>();
+    if constexpr (Registry::template IsSparse<T>()) {
+        uint32_t dense = sparse_sets[id]->DenseIndexOf(toy.index);
+        sparse_sets[id]->MarkChanged(dense, change_tick);
+        return static_cast<T*>(sparse_sets[id]->PartAt(dense));
+    } else {
+        ToyRecord& record = records.At(toy.index);
+        uint32_t column = static_cast<uint32_t>(record.group->column_of[id]);
+        record.group->BlockOf(record.row).changed_versions[column] = change_tick;
+        return static_cast<T*>(record.group->PartAt(record.row, column));
+    }
+}
+
+template<typename Registry>
+uint32_t World<Registry>::ChangeTick() const {
+    return change_tick;
+}
+
+template<typename Registry>
+uint32_t World<Registry>::AdvanceTick() {
+    return ++change_tick;
+}
+
+template<typename Registry>
+uint32_t World<Registry>::BeginWork(WorkClock* clock) {
+    // Taken before advancing, so a Work that never calls EndWork still sees
+    // every write from here on
+    uint32_t since = clock->last_run;
+    clock->last_run = change_tick;
+    AdvanceTick();
+    return since;
+}
+
+template<typename Registry>
+void World<Registry>::EndWork(WorkClock* clock) {
+    clock->last_run = change_tick;
+    AdvanceTick();
+}
+
+template<typename Registry>
+template<typename... Parts, typename Filter, typename Fn>
+void World<Registry>::EachBlock(const Filter& filter, Fn fn) {
+    static_assert(Registry::template SparseSignatureOf<Parts...>().Empty() &&
+                  FilterTraits<Registry, Filter>::SparseSignature().Empty(),
+                  "EachBlock only walks packed Parts; use Each to mix in sparse Parts");
+
+    constexpr PartSignature required =
+        Registry::template SignatureOf<Parts...>() | FilterTraits<Registry, Filter>::PackedSignature();
+    const uint32_t tick = change_tick;
+
+    for (size_t g = 0; g < groups.Size(); ++g) {
+        Group* group = groups.At(g);
+        if (group->count == 0 || !group->signature.Contains(required)) continue;
+
+        for (size_t b = 0; b < group->blocks.Size(); ++b) {
+            Block& block = group->blocks.At(b);
+            if (!FilterTraits<Registry, Filter>::PassesBlock(*group, block, filter)) continue;
+
+            // Only mutable columns count as writes
+            ((std::is_const<Parts>::value
+                ? void()
+                : void(block.changed_versions[group->column_of[Registry::template IdOf<Parts>()]] = tick)), ...);
+
+            fn(block.count, static_cast<const Toy*>(block.toys),
+               static_cast<Parts*>(group->ColumnData(block, group->column_of[Registry::template IdOf<Parts>()]))...);
+        }
+    }
+}
+
+template<typename Registry>
+template<typename... Parts, typename Fn>
+void World<Registry>::EachBlock(Fn fn) {
+    EachBlock<Parts...>(NoFilter(), fn);
+}
+
+template<typename Registry>
+template<typename T>
+T& World<Registry>::Fetch(void* column, uint32_t slot, uint32_t toy_index) {
+    if constexpr (Registry::template IsSparse<T>()) {
+        SparseSet* set = sparse_sets[Registry::template IdOf<T>()];
+        uint32_t dense = set->DenseIndexOf(toy_index);
+        if constexpr (!std::is_const<T>::value) {
+            set->MarkChanged(dense, change_tick);
+        }
+        return *static_cast<T*>(set->PartAt(dense));
+    } else {
+        return static_cast<T*>(column)[slot];
+    }
+}
+
+template<typename Registry>
+template<typename... Parts, typename Fn, size_t... I>
+void World<Registry>::Invoke(Fn& fn, Toy toy, void* const* columns, uint32_t slot, std::index_sequence<I...>) {
+    fn(toy, Fetch<Parts>(columns[I], slot, toy.index)...);
+}
+
+template<typename Registry>
+template<typename... Parts, typename Filter, typename Fn>
+void World<Registry>::Each(const Filter& filter, Fn fn) {
+    typedef FilterTraits<Registry, Filter> Traits;
+    constexpr PartSignature packed = Registry::template PackedSignatureOf<Parts...>() | Traits::PackedSignature();
+    constexpr PartSignature sparse = Registry::template SparseSignatureOf<Parts...>() | Traits::SparseSignature();
+    typedef std::index_sequence_for<Parts...> Indices;
+
+    if constexpr (sparse.Empty()) {
+        EachBlock<Parts...>(filter, [&fn](uint32_t count, const Toy* toys, Parts*... columns) {
+            for (uint32_t i = 0; i < count; ++i) {
+                fn(toys[i], columns[i]...);
+            }
+        });
+    } else if constexpr (!packed.Empty()) {
+        // Packed Parts drive the walk; sparse Parts are looked up per Toy
+        const uint32_t tick = change_tick;
+        for (size_t g = 0; g < groups.Size(); ++g) {
+            Group* group = groups.At(g);
+            if (group->count == 0 || !group->signature.Contains(packed)) continue;
+
+            for (size_t b = 0; b < group->blocks.Size(); ++b) {
+                Block& block = group->blocks.At(b);
+                if (!Traits::PassesBlock(*group, block, filter)) continue;
+
+                void* columns[sizeof...(Parts)] = {
+                    (Registry::template IsSparse<Parts>()
+                        ? nullptr
+                        : group->ColumnData(block, group->column_of[Registry::template IdOf<Parts>()]))...
+                };
+
+                bool wrote = false;
+                for (uint32_t slot = 0; slot < block.count; ++slot) {
+                    Toy toy = block.toys[slot];
+                    if (!records.At(toy.index).sparse_parts.Contains(sparse)) continue;
+                    if (!Traits::PassesToy(sparse_sets, toy.index, filter)) continue;
+                    Invoke<Parts...>(fn, toy, columns, slot, Indices());
+                    wrote = true;
+                }
+
+                if (wrote) {
+                    ((Registry::template IsSparse<Parts>() || std::is_const<Parts>::value
+                        ? void()
+                        : void(block.changed_versions[group->column_of[Registry::template IdOf<Parts>()]] = tick)), ...);
+                }
+            }
+        }
+    } else {
+        // Every Part is sparse: walk the smallest set and probe the others
+        SparseSet* driver = nullptr;
+        for (PartId id = 0; id < kMaxParts; ++id) {
+            if (sparse.Test(id) && (!driver || sparse_sets[id]->Size() < driver->Size())) {
+                driver = sparse_sets[id];
+            }
+        }
+
+        void* columns[sizeof...(Parts)] = {};
+        const Toy* toys = driver->Toys();
+        for (uint32_t i = 0; i < driver->Size(); ++i) {
+            Toy toy = toys[i];
+            if (!records.At(toy.index).sparse_parts.Contains(sparse)) continue;
+            if (!Traits::PassesToy(sparse_sets, toy.index, filter)) continue;
+            Invoke<Parts...>(fn, toy, columns, 0, Indices());
+        }
+    }
+}
+
+template<typename Registry>
+template<typename... Parts, typename Fn>
+void World<Registry>::Each(Fn fn) {
+    Each<Parts...>(NoFilter(), fn);
+}
+
+} // namespace ecs
+} // namespace toybox
@@ -0,0 +1,194 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "batch.h"
+#include "lanes.h"
+
+namespace toybox
+{
+namespace math
+{
+
+template<typename L>
+static size_t TransformPointsLanes(const Mat4& matrix, Vec3SoA in, Vec3SoA out, size_t i, size_t count) {
+    typedef typename L::Value V;
+    const float* m = matrix.m;
+    V m0 = L::Set(m[0]), m1 = L::Set(m[1]), m2 = L::Set(m[2]);
+    V m4 = L::Set(m[4]), m5 = L::Set(m[5]), m6 = L::Set(m[6]);
+    V m8 = L::Set(m[8]), m9 = L::Set(m[9]), m10 = L::Set(m[10]);
+    V m12 = L::Set(m[12]), m13 = L::Set(m[13]), m14 = L::Set(m[14]);
+
+    for (; i + L::kWidth <= count; i += L::kWidth) {
+        V x = L::Load(in.x + i);
+        V y = L::Load(in.y + i);
+        V z = L::Load(in.z + i);
+        L::Store(out.x + i, L::Add(L::Add(L::Add(L::Mul(m0, x), L::Mul(m4, y)), L::Mul(m8, z)), m12));
+        L::Store(out.y + i, L::Add(L::Add(L::Add(L::Mul(m1, x), L::Mul(m5, y)), L::Mul(m9, z)), m13));
+        L::Store(out.z + i, L::Add(L::Add(L::Add(L::Mul(m2, x), L::Mul(m6, y)), L::Mul(m10, z)), m14));
+    }
+    return i;
+}
+
+template<typename L>
+static size_t NormalizeQuaternionsLanes(QuatSoA q, size_t i, size_t count) {
+    typedef typename L::Value V;
+    for (; i + L::kWidth <= count; i += L::kWidth) {
+        V x = L::Load(q.x + i);
+        V y = L::Load(q.y + i);
+        V z = L::Load(q.z + i);
+        V w = L::Load(q.w + i);
+        V length = L::Sqrt(L::Add(L::Add(L::Mul(x, x), L::Mul(y, y)), L::Add(L::Mul(z, z), L::Mul(w, w))));
+        L::Store(q.x + i, L::Div(x, length));
+        L::Store(q.y + i, L::Div(y, length));
+        L::Store(q.z + i, L::Div(z, length));
+        L::Store(q.w + i, L::Div(w, length));
+    }
+    return i;
+}
+
+template<typename L>
+static size_t TransformAabbsLanes(const Mat4* matrices, AabbSoA local, AabbSoA world, size_t i, size_t count) {
+    typedef typename L::Value V;
+    const size_t stride = sizeof(Mat4) / sizeof(float);
+    V half = L::Set(0.5f);
+
+    for (; i + L::kWidth <= count; i += L::kWidth) {
+        const float* m = matrices[i].m;
+        V min_x = L::Load(local.min_x + i), max_x = L::Load(local.max_x + i);
+        V min_y = L::Load(local.min_y + i), max_y = L::Load(local.max_y + i);
+        V min_z = L::Load(local.min_z + i), max_z = L::Load(local.max_z + i);
+
+        V cx = L::Mul(L::Add(min_x, max_x), half);
+        V cy = L::Mul(L::Add(min_y, max_y), half);
+        V cz = L::Mul(L::Add(min_z, max_z), half);
+        V ex = L::Mul(L::Sub(max_x, min_x), half);
+        V ey = L::Mul(L::Sub(max_y, min_y), half);
+        V ez = L::Mul(L::Sub(max_z, min_z), half);
+
+        // Centre moves as a point; extents through the absolute rotation-scale
+        for (int row = 0; row < 3; ++row) {
+            V r0 = L::Gather(m + row, stride);
+            V r1 = L::Gather(m + 4 + row, stride);
+            V r2 = L::Gather(m + 8 + row, stride);
+            V t = L::Gather(m + 12 + row, stride);
+
+            V centre = L::Add(L::Add(L::Add(L::Mul(r0, cx), L::Mul(r1, cy)), L::Mul(r2, cz)), t);
+            V extent = L::Add(L::Add(L::Mul(L::Abs(r0), ex), L::Mul(L::Abs(r1), ey)), L::Mul(L::Abs(r2), ez));
+
+            float* out_min = row == 0 ? world.min_x : (row == 1 ? world.min_y : world.min_z);
+            float* out_max = row == 0 ? world.max_x : (row == 1 ? world.max_y : world.max_z);
+            L::Store(out_min + i, L::Sub(centre, extent));
+            L::Store(out_max + i, L::Add(centre, extent));
+        }
+    }
+    return i;
+}
+
+template<typename L>
+static size_t BoundsOfPointsLanes(Vec3SoA p, size_t i, size_t count, Aabb* bounds) {
+    typedef typename L::Value V;
+    if (i + L::kWidth > count) return i;
+
+    V min_x = L::Load(p.x + i), max_x = min_x;
+    V min_y = L::Load(p.y + i), max_y = min_y;
+    V min_z = L::Load(p.z + i), max_z = min_z;
+    for (i += L::kWidth; i + L::kWidth <= count; i += L::kWidth) {
+        V x = L::Load(p.x + i);
+        V y = L::Load(p.y + i);
+        V z = L::Load(p.z + i);
+        min_x = L::Min(min_x, x);
+        max_x = L::Max(max_x, x);
+        min_y = L::Min(min_y, y);
+        max_y = L::Max(max_y, y);
+        min_z = L::Min(min_z, z);
+        max_z = L::Max(max_z, z);
+    }
+
+    bounds->min = Min(bounds->min, Vec3{ L::ReduceMin(min_x), L::ReduceMin(min_y), L::ReduceMin(min_z) });
+    bounds->max = Max(bounds->max, Vec3{ L::ReduceMax(max_x), L::ReduceMax(max_y), L::ReduceMax(max_z) });
+    return i;
+}
+
+static Aabb EmptyBounds(Vec3SoA points) {
+    Vec3 first{ points.x[0], points.y[0], points.z[0] };
+    return Aabb{ first, first };
+}
+
+void TransformPoints(const Mat4& matrix, Vec3SoA in, Vec3SoA out, size_t count) {
+    size_t i = 0;
+#if defined(TOYBOX_MATH_AVX2)
+    i = TransformPointsLanes<Avx2Lanes>(matrix, in, out, i, count);
+#endif
+#if defined(TOYBOX_MATH_SSE4)
+    i = TransformPointsLanes<Sse4Lanes>(matrix, in, out, i, count);
+#endif
+    TransformPointsLanes<ScalarLanes>(matrix, in, out, i, count);
+}
+
+void NormalizeQuaternions(QuatSoA quats, size_t count) {
+    size_t i = 0;
+#if defined(TOYBOX_MATH_AVX2)
+    i = NormalizeQuaternionsLanes<Avx2Lanes>(quats, i, count);
+#endif
+#if defined(TOYBOX_MATH_SSE4)
+    i = NormalizeQuaternionsLanes<Sse4Lanes>(quats, i, count);
+#endif
+    NormalizeQuaternionsLanes<ScalarLanes>(quats, i, count);
+}
+
+void TransformAabbs(const Mat4* matrices, AabbSoA local, AabbSoA world, size_t count) {
+    size_t i = 0;
+#if defined(TOYBOX_MATH_AVX2)
+    i = TransformAabbsLanes<Avx2Lanes>(matrices, local, world, i, count);
+#endif
+#if defined(TOYBOX_MATH_SSE4)
+    i = TransformAabbsLanes<Sse4Lanes>(matrices, local, world, i, count);
+#endif
+    TransformAabbsLanes<ScalarLanes>(matrices, local, world, i, count);
+}
+
+Aabb BoundsOfPoints(Vec3SoA points, size_t count) {
+    Aabb bounds = EmptyBounds(points);
+    size_t i = 0;
+#if defined(TOYBOX_MATH_AVX2)
+    i = BoundsOfPointsLanes<Avx2Lanes>(points, i, count, &bounds);
+#endif
+#if defined(TOYBOX_MATH_SSE4)
+    i = BoundsOfPointsLanes<Sse4Lanes>(points, i, count, &bounds);
+#endif
+    BoundsOfPointsLanes<ScalarLanes>(points, i, count, &bounds);
+    return bounds;
+}
+
+namespace scalar
+{
+
+void TransformPoints(const Mat4& matrix, Vec3SoA in, Vec3SoA out, size_t count) {
+    TransformPointsLanes<ScalarLanes>(matrix, in, out, 0, count);
+}
+
+void NormalizeQuaternions(QuatSoA quats, size_t count) {
+    NormalizeQuaternionsLanes<ScalarLanes>(quats, 0, count);
+}
+
+void TransformAabbs(const Mat4* matrices, AabbSoA local, AabbSoA world, size_t count) {
+    TransformAabbsLanes<ScalarLanes>(matrices, local, world, 0, count);
+}
+
+Aabb BoundsOfPoints(Vec3SoA points, size_t count) {
+    Aabb bounds = EmptyBounds(points);
+    BoundsOfPointsLanes<ScalarLanes>(points, 0, count, &bounds);
+    return bounds;
+}
+
+} // namespace scalar
+
+} // namespace math
+} // namespace toybox
@@ -0,0 +1,79 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+
+#include "geometry.h"
+#include "matrix.h"
+#include "quaternion.h"
+#include "vector.h"
+
+namespace toybox
+{
+namespace math
+{
+
+// Kernels over struct-of-arrays streams. Each stream holds count floats; no
+// alignment is required. Inputs and outputs may be the same streams.
+
+struct Vec3SoA {
+    float* x;
+    float* y;
+    float* z;
+};
+
+struct QuatSoA {
+    float* x;
+    float* y;
+    float* z;
+    float* w;
+};
+
+struct AabbSoA {
+    float* min_x;
+    float* min_y;
+    float* min_z;
+    float* max_x;
+    float* max_y;
+    float* max_z;
+};
+
+// out[i] = matrix * in[i], treating each element as a point
+void TransformPoints(const Mat4& matrix, Vec3SoA in, Vec3SoA out, size_t count);
+
+// out[i] = a[i] * b[i]
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count);
+
+// Quaternions must be non-zero
+void NormalizeQuaternions(QuatSoA quats, size_t count);
+
+// world[i] is the axis-aligned box enclosing local[i] under matrices[i]
+void TransformAabbs(const Mat4* matrices, AabbSoA local, AabbSoA world, size_t count);
+
+// Smallest box containing every point; count must be at least one
+Aabb BoundsOfPoints(Vec3SoA points, size_t count);
+
+// The same kernels run one element at a time. They perform the same float
+// operations in the same order, so results match the SIMD paths exactly.
+namespace scalar
+{
+
+void TransformPoints(const Mat4& matrix, Vec3SoA in, Vec3SoA out, size_t count);
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count);
+void NormalizeQuaternions(QuatSoA quats, size_t count);
+void TransformAabbs(const Mat4* matrices, AabbSoA local, AabbSoA world, size_t count);
+Aabb BoundsOfPoints(Vec3SoA points, size_t count);
+
+} // namespace scalar
+
+} // namespace math
+} // namespace toybox
@@ -0,0 +1,144 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cmath> // For sqrtf, fabsf
+
+#include "matrix.h"
+#include "vector.h"
+
+namespace toybox
+{
+namespace math
+{
+
+struct Aabb {
+    Vec3 min;
+    Vec3 max;
+};
+
+inline Aabb Union(const Aabb& a, const Aabb& b) {
+    return Aabb{ Min(a.min, b.min), Max(a.max, b.max) };
+}
+
+inline bool Contains(const Aabb& outer, const Aabb& inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+inline bool Overlaps(const Aabb& a, const Aabb& b) {
+    return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y &&
+           a.min.z <= b.max.z && b.min.z <= a.max.z;
+}
+
+inline Aabb Expand(const Aabb& box, float margin) {
+    Vec3 grow{ margin, margin, margin };
+    return Aabb{ box.min - grow, box.max + grow };
+}
+
+inline Vec3 Center(const Aabb& box) {
+    return (box.min + box.max) * 0.5f;
+}
+
+inline float SurfaceArea(const Aabb& box) {
+    Vec3 size = box.max - box.min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// Zero when the point is inside
+inline float DistanceSquared(const Aabb& box, Vec3 point) {
+    Vec3 nearest = Min(Max(point, box.min), box.max);
+    return LengthSquared(point - nearest);
+}
+
+// Direction does not need to be normalised; distances are in units of its
+// length
+struct Ray {
+    Vec3 origin;
+    Vec3 direction;
+    float max_distance;
+};
+
+// Reciprocal direction for repeated slab tests against the same ray.
+// Zero components become infinities, which the slab test handles.
+inline Vec3 InverseDirection(Vec3 direction) {
+    return Vec3{ 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+}
+
+// Entry distance along the ray, or a negative value for a miss. A ray that
+// starts inside the box enters at zero.
+inline float RayIntersect(const Aabb& box, Vec3 origin, Vec3 inverse_direction, float max_distance) {
+    float tx0 = (box.min.x - origin.x) * inverse_direction.x;
+    float tx1 = (box.max.x - origin.x) * inverse_direction.x;
+    float ty0 = (box.min.y - origin.y) * inverse_direction.y;
+    float ty1 = (box.max.y - origin.y) * inverse_direction.y;
+    float tz0 = (box.min.z - origin.z) * inverse_direction.z;
+    float tz1 = (box.max.z - origin.z) * inverse_direction.z;
+    float enter = fmaxf(fmaxf(fminf(tx0, tx1), fminf(ty0, ty1)), fmaxf(fminf(tz0, tz1), 0.0f));
+    float exit = fminf(fminf(fmaxf(tx0, tx1), fmaxf(ty0, ty1)), fminf(fmaxf(tz0, tz1), max_distance));
+    return enter <= exit ? enter : -1.0f;
+}
+
+// Points with Dot(normal, p) + d >= 0 are on the inside
+struct Plane {
+    Vec3 normal;
+    float d;
+};
+
+enum class Containment { Outside, Intersecting, Inside };
+
+struct Frustum {
+    Plane planes[6]; // Left, right, bottom, top, near, far
+};
+
+// Planes of a view-projection matrix with clip-space depth from 0 to 1
+inline Frustum FrustumFromMatrix(const Mat4& view_projection) {
+    const float* m = view_projection.m;
+    // Rows of the column-major matrix
+    float r0[4] = { m[0], m[4], m[8], m[12] };
+    float r1[4] = { m[1], m[5], m[9], m[13] };
+    float r2[4] = { m[2], m[6], m[10], m[14] };
+    float r3[4] = { m[3], m[7], m[11], m[15] };
+    float raw[6][4];
+    for (int i = 0; i < 4; ++i) {
+        raw[0][i] = r3[i] + r0[i];
+        raw[1][i] = r3[i] - r0[i];
+        raw[2][i] = r3[i] + r1[i];
+        raw[3][i] = r3[i] - r1[i];
+        raw[4][i] = r2[i];
+        raw[5][i] = r3[i] - r2[i];
+    }
+
+    Frustum frustum;
+    for (int p = 0; p < 6; ++p) {
+        Vec3 normal{ raw[p][0], raw[p][1], raw[p][2] };
+        float scale = 1.0f / Length(normal);
+        frustum.planes[p] = Plane{ normal * scale, raw[p][3] * scale };
+    }
+    return frustum;
+}
+
+inline Containment Classify(const Frustum& frustum, const Aabb& box) {
+    Vec3 center = Center(box);
+    Vec3 extent = box.max - center;
+    Containment result = Containment::Inside;
+    for (const Plane& plane : frustum.planes) {
+        float distance = Dot(plane.normal, center) + plane.d;
+        float radius = fabsf(plane.normal.x) * extent.x + fabsf(plane.normal.y) * extent.y +
+                       fabsf(plane.normal.z) * extent.z;
+        if (distance < -radius) return Containment::Outside;
+        if (distance < radius) result = Containment::Intersecting;
+    }
+    return result;
+}
+
+} // namespace math
+} // namespace toybox
@@ -0,0 +1,130 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cmath>   // For sqrtf, fabsf
+#include <cstddef> // For size_t
+
+#include "simd.h"
+
+namespace toybox
+{
+namespace math
+{
+
+// Lane types for kernels over struct-of-arrays streams. A kernel is written
+// once against a lane type and instantiated for every width the build
+// supports; the widest lanes take the bulk of the stream and the narrower
+// ones finish the tail. Files including this need the SIMD flags: they
+// belong to MathModule or to a target linking MathLanes.
+
+struct ScalarLanes {
+    typedef float Value;
+    static constexpr size_t kWidth = 1;
+
+    static Value Load(const float* p) { return *p; }
+    static void Store(float* p, Value v) { *p = v; }
+    static Value Set(float v) { return v; }
+    static Value Add(Value a, Value b) { return a + b; }
+    static Value Sub(Value a, Value b) { return a - b; }
+    static Value Mul(Value a, Value b) { return a * b; }
+    static Value Div(Value a, Value b) { return a / b; }
+    static Value Sqrt(Value a) { return sqrtf(a); }
+    static Value Abs(Value a) { return fabsf(a); }
+    static Value Min(Value a, Value b) { return a < b ? a : b; }
+    static Value Max(Value a, Value b) { return a > b ? a : b; }
+    static Value Gather(const float* base, size_t) { return *base; }
+    // Bit i set where lane i of a is less than lane i of b
+    static int LessMask(Value a, Value b) { return a < b ? 1 : 0; }
+
+    static float ReduceMin(Value a) { return a; }
+    static float ReduceMax(Value a) { return a; }
+};
+
+#if defined(TOYBOX_MATH_SSE4)
+
+struct Sse4Lanes {
+    typedef __m128 Value;
+    static constexpr size_t kWidth = 4;
+
+    static Value Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, Value v) { _mm_storeu_ps(p, v); }
+    static Value Set(float v) { return _mm_set1_ps(v); }
+    static Value Add(Value a, Value b) { return _mm_add_ps(a, b); }
+    static Value Sub(Value a, Value b) { return _mm_sub_ps(a, b); }
+    static Value Mul(Value a, Value b) { return _mm_mul_ps(a, b); }
+    static Value Div(Value a, Value b) { return _mm_div_ps(a, b); }
+    static Value Sqrt(Value a) { return _mm_sqrt_ps(a); }
+    static Value Abs(Value a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    // minps/maxps return the second operand on ties and NaN, like the ternaries above
+    static Value Min(Value a, Value b) { return _mm_min_ps(a, b); }
+    static Value Max(Value a, Value b) { return _mm_max_ps(a, b); }
+
+    static int LessMask(Value a, Value b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+
+    static Value Gather(const float* base, size_t stride) {
+        return _mm_setr_ps(base[0], base[stride], base[2 * stride], base[3 * stride]);
+    }
+
+    static float ReduceMin(Value a) {
+        a = _mm_min_ps(a, _mm_movehl_ps(a, a));
+        a = _mm_min_ss(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_cvtss_f32(a);
+    }
+
+    static float ReduceMax(Value a) {
+        a = _mm_max_ps(a, _mm_movehl_ps(a, a));
+        a = _mm_max_ss(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_cvtss_f32(a);
+    }
+};
+
+#endif
+
+#if defined(TOYBOX_MATH_AVX2)
+
+struct Avx2Lanes {
+    typedef __m256 Value;
+    static constexpr size_t kWidth = 8;
+
+    static Value Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, Value v) { _mm256_storeu_ps(p, v); }
+    static Value Set(float v) { return _mm256_set1_ps(v); }
+    static Value Add(Value a, Value b) { return _mm256_add_ps(a, b); }
+    static Value Sub(Value a, Value b) { return _mm256_sub_ps(a, b); }
+    static Value Mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+    static Value Div(Value a, Value b) { return _mm256_div_ps(a, b); }
+    static Value Sqrt(Value a) { return _mm256_sqrt_ps(a); }
+    static Value Abs(Value a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static Value Min(Value a, Value b) { return _mm256_min_ps(a, b); }
+    static Value Max(Value a, Value b) { return _mm256_max_ps(a, b); }
+
+    static int LessMask(Value a, Value b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+
+    static Value Gather(const float* base, size_t stride) {
+        __m256i index = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                           _mm256_set1_epi32(static_cast<int>(stride)));
+        return _mm256_i32gather_ps(base, index, 4);
+    }
+
+    static float ReduceMin(Value a) {
+        return Sse4Lanes::ReduceMin(_mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)));
+    }
+
+    static float ReduceMax(Value a) {
+        return Sse4Lanes::ReduceMax(_mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1)));
+    }
+};
+
+#endif
+
+} // namespace math
+} // namespace toybox
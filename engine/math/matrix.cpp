@@ -0,0 +1,137 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "matrix.h"
+#include "batch.h"
+#include "simd.h"
+
+namespace toybox
+{
+namespace math
+{
+
+bool Inverse(const Mat4& a, Mat4* out) {
+    const float* m = a.m;
+    float inv[16];
+
+    // Cofactor expansion, grouped through 2x2 sub-determinants
+    float s0 = m[0] * m[5] - m[4] * m[1];
+    float s1 = m[0] * m[6] - m[4] * m[2];
+    float s2 = m[0] * m[7] - m[4] * m[3];
+    float s3 = m[1] * m[6] - m[5] * m[2];
+    float s4 = m[1] * m[7] - m[5] * m[3];
+    float s5 = m[2] * m[7] - m[6] * m[3];
+
+    float c5 = m[10] * m[15] - m[14] * m[11];
+    float c4 = m[9] * m[15] - m[13] * m[11];
+    float c3 = m[9] * m[14] - m[13] * m[10];
+    float c2 = m[8] * m[15] - m[12] * m[11];
+    float c1 = m[8] * m[14] - m[12] * m[10];
+    float c0 = m[8] * m[13] - m[12] * m[9];
+
+    float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+    if (det == 0.0f) return false;
+    float inv_det = 1.0f / det;
+
+    inv[0] = (m[5] * c5 - m[6] * c4 + m[7] * c3) * inv_det;
+    inv[1] = (-m[1] * c5 + m[2] * c4 - m[3] * c3) * inv_det;
+    inv[2] = (m[13] * s5 - m[14] * s4 + m[15] * s3) * inv_det;
+    inv[3] = (-m[9] * s5 + m[10] * s4 - m[11] * s3) * inv_det;
+
+    inv[4] = (-m[4] * c5 + m[6] * c2 - m[7] * c1) * inv_det;
+    inv[5] = (m[0] * c5 - m[2] * c2 + m[3] * c1) * inv_det;
+    inv[6] = (-m[12] * s5 + m[14] * s2 - m[15] * s1) * inv_det;
+    inv[7] = (m[8] * s5 - m[10] * s2 + m[11] * s1) * inv_det;
+
+    inv[8] = (m[4] * c4 - m[5] * c2 + m[7] * c0) * inv_det;
+    inv[9] = (-m[0] * c4 + m[1] * c2 - m[3] * c0) * inv_det;
+    inv[10] = (m[12] * s4 - m[13] * s2 + m[15] * s0) * inv_det;
+    inv[11] = (-m[8] * s4 + m[9] * s2 - m[11] * s0) * inv_det;
+
+    inv[12] = (-m[4] * c3 + m[5] * c1 - m[6] * c0) * inv_det;
+    inv[13] = (m[0] * c3 - m[1] * c1 + m[2] * c0) * inv_det;
+    inv[14] = (-m[12] * s3 + m[13] * s1 - m[14] * s0) * inv_det;
+    inv[15] = (m[8] * s3 - m[9] * s1 + m[10] * s0) * inv_det;
+
+    for (int i = 0; i < 16; ++i) {
+        out->m[i] = inv[i];
+    }
+    return true;
+}
+
+#if defined(TOYBOX_MATH_AVX2)
+
+Mat4 Multiply(const Mat4& a, const Mat4& b) {
+    // Two result columns per 256-bit register
+    __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.m[0]));
+    __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.m[4]));
+    __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.m[8]));
+    __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&a.m[12]));
+
+    Mat4 result;
+    for (int column = 0; column < 4; column += 2) {
+        __m256 bc = _mm256_loadu_ps(&b.m[column * 4]);
+        __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(bc, bc, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_shuffle_ps(bc, bc, _MM_SHUFFLE(1, 1, 1, 1))));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_shuffle_ps(bc, bc, _MM_SHUFFLE(2, 2, 2, 2))));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_shuffle_ps(bc, bc, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm256_storeu_ps(&result.m[column * 4], r);
+    }
+    return result;
+}
+
+#elif defined(TOYBOX_MATH_SSE4)
+
+Mat4 Multiply(const Mat4& a, const Mat4& b) {
+    __m128 a0 = _mm_load_ps(&a.m[0]);
+    __m128 a1 = _mm_load_ps(&a.m[4]);
+    __m128 a2 = _mm_load_ps(&a.m[8]);
+    __m128 a3 = _mm_load_ps(&a.m[12]);
+
+    Mat4 result;
+    for (int column = 0; column < 4; ++column) {
+        const float* bc = &b.m[column * 4];
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(bc[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(bc[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(bc[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(bc[3])));
+        _mm_store_ps(&result.m[column * 4], r);
+    }
+    return result;
+}
+
+#else
+
+Mat4 Multiply(const Mat4& a, const Mat4& b) {
+    return scalar::Multiply(a, b);
+}
+
+#endif
+
+// Here rather than with the other batch kernels, so Multiply is inlined
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = Multiply(a[i], b[i]);
+    }
+}
+
+namespace scalar
+{
+
+void MultiplyMatrices(const Mat4* a, const Mat4* b, Mat4* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = scalar::Multiply(a[i], b[i]);
+    }
+}
+
+} // namespace scalar
+
+} // namespace math
+} // namespace toybox
@@ -0,0 +1,178 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cmath> // For tanf
+
+#include "quaternion.h"
+#include "vector.h"
+
+namespace toybox
+{
+namespace math
+{
+
+// Column-major 4x4 matrix: m[column * 4 + row]. Points are column vectors,
+// so a * b applies b first.
+struct alignas(16) Mat4 {
+    float m[16];
+};
+
+inline Mat4 Mat4Identity() {
+    return Mat4{ { 1.0f, 0.0f, 0.0f, 0.0f,
+                   0.0f, 1.0f, 0.0f, 0.0f,
+                   0.0f, 0.0f, 1.0f, 0.0f,
+                   0.0f, 0.0f, 0.0f, 1.0f } };
+}
+
+inline Mat4 Mat4Translation(Vec3 t) {
+    Mat4 result = Mat4Identity();
+    result.m[12] = t.x;
+    result.m[13] = t.y;
+    result.m[14] = t.z;
+    return result;
+}
+
+inline Mat4 Mat4Scale(Vec3 s) {
+    Mat4 result = Mat4Identity();
+    result.m[0] = s.x;
+    result.m[5] = s.y;
+    result.m[10] = s.z;
+    return result;
+}
+
+// Translation * Rotation * Scale, built directly
+inline Mat4 Mat4Compose(Vec3 translation, Quat rotation, Vec3 scale) {
+    float x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
+    float xx = x * x, yy = y * y, zz = z * z;
+    float xy = x * y, xz = x * z, yz = y * z;
+    float wx = w * x, wy = w * y, wz = w * z;
+
+    Mat4 result;
+    result.m[0] = (1.0f - 2.0f * (yy + zz)) * scale.x;
+    result.m[1] = 2.0f * (xy + wz) * scale.x;
+    result.m[2] = 2.0f * (xz - wy) * scale.x;
+    result.m[3] = 0.0f;
+    result.m[4] = 2.0f * (xy - wz) * scale.y;
+    result.m[5] = (1.0f - 2.0f * (xx + zz)) * scale.y;
+    result.m[6] = 2.0f * (yz + wx) * scale.y;
+    result.m[7] = 0.0f;
+    result.m[8] = 2.0f * (xz + wy) * scale.z;
+    result.m[9] = 2.0f * (yz - wx) * scale.z;
+    result.m[10] = (1.0f - 2.0f * (xx + yy)) * scale.z;
+    result.m[11] = 0.0f;
+    result.m[12] = translation.x;
+    result.m[13] = translation.y;
+    result.m[14] = translation.z;
+    result.m[15] = 1.0f;
+    return result;
+}
+
+inline Mat4 Mat4Rotation(Quat rotation) {
+    return Mat4Compose(Vec3{ 0.0f, 0.0f, 0.0f }, rotation, Vec3{ 1.0f, 1.0f, 1.0f });
+}
+
+inline Mat4 Transpose(const Mat4& a) {
+    Mat4 result;
+    for (int column = 0; column < 4; ++column) {
+        for (int row = 0; row < 4; ++row) {
+            result.m[column * 4 + row] = a.m[row * 4 + column];
+        }
+    }
+    return result;
+}
+
+// General inverse; returns false and leaves out untouched if a is singular
+bool Inverse(const Mat4& a, Mat4* out);
+
+// Inverse of a rotation + translation matrix (no scale)
+inline Mat4 InverseRigid(const Mat4& a) {
+    Mat4 result = Transpose(a);
+    result.m[3] = 0.0f;
+    result.m[7] = 0.0f;
+    result.m[11] = 0.0f;
+    Vec3 t{ a.m[12], a.m[13], a.m[14] };
+    result.m[12] = -((result.m[0] * t.x + result.m[4] * t.y) + result.m[8] * t.z);
+    result.m[13] = -((result.m[1] * t.x + result.m[5] * t.y) + result.m[9] * t.z);
+    result.m[14] = -((result.m[2] * t.x + result.m[6] * t.y) + result.m[10] * t.z);
+    result.m[15] = 1.0f;
+    return result;
+}
+
+inline Vec3 TransformPoint(const Mat4& a, Vec3 p) {
+    return Vec3{
+        ((a.m[0] * p.x + a.m[4] * p.y) + a.m[8] * p.z) + a.m[12],
+        ((a.m[1] * p.x + a.m[5] * p.y) + a.m[9] * p.z) + a.m[13],
+        ((a.m[2] * p.x + a.m[6] * p.y) + a.m[10] * p.z) + a.m[14],
+    };
+}
+
+inline Vec3 TransformVector(const Mat4& a, Vec3 v) {
+    return Vec3{
+        (a.m[0] * v.x + a.m[4] * v.y) + a.m[8] * v.z,
+        (a.m[1] * v.x + a.m[5] * v.y) + a.m[9] * v.z,
+        (a.m[2] * v.x + a.m[6] * v.y) + a.m[10] * v.z,
+    };
+}
+
+inline Vec3 Translation(const Mat4& a) {
+    return Vec3{ a.m[12], a.m[13], a.m[14] };
+}
+
+// Right-handed view matrix; the camera looks down -z
+inline Mat4 Mat4LookAt(Vec3 eye, Vec3 target, Vec3 up) {
+    Vec3 f = Normalize(target - eye);
+    Vec3 s = Normalize(Cross(f, up));
+    Vec3 u = Cross(s, f);
+    return Mat4{ { s.x, u.x, -f.x, 0.0f,
+                   s.y, u.y, -f.y, 0.0f,
+                   s.z, u.z, -f.z, 0.0f,
+                   -Dot(s, eye), -Dot(u, eye), Dot(f, eye), 1.0f } };
+}
+
+// Right-handed perspective projection with clip-space depth from 0 at near
+// to 1 at far
+inline Mat4 Mat4Perspective(float fov_y, float aspect, float near_plane, float far_plane) {
+    float f = 1.0f / tanf(fov_y * 0.5f);
+    float range = 1.0f / (near_plane - far_plane);
+    return Mat4{ { f / aspect, 0.0f, 0.0f, 0.0f,
+                   0.0f, f, 0.0f, 0.0f,
+                   0.0f, 0.0f, far_plane * range, -1.0f,
+                   0.0f, 0.0f, near_plane * far_plane * range, 0.0f } };
+}
+
+namespace scalar
+{
+
+inline Mat4 Multiply(const Mat4& a, const Mat4& b) {
+    Mat4 result;
+    for (int column = 0; column < 4; ++column) {
+        const float* bc = &b.m[column * 4];
+        for (int row = 0; row < 4; ++row) {
+            result.m[column * 4 + row] = ((a.m[row] * bc[0] + a.m[4 + row] * bc[1]) +
+                                          a.m[8 + row] * bc[2]) + a.m[12 + row] * bc[3];
+        }
+    }
+    return result;
+}
+
+} // namespace scalar
+
+// Built into MathModule at its SIMD level; the result matches the scalar
+// version exactly
+Mat4 Multiply(const Mat4& a, const Mat4& b);
+
+inline Mat4 operator*(const Mat4& a, const Mat4& b) {
+    return Multiply(a, b);
+}
+
+} // namespace math
+} // namespace toybox
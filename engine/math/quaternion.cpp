@@ -0,0 +1,67 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "quaternion.h"
+#include "simd.h"
+
+namespace toybox
+{
+namespace math
+{
+
+#if defined(TOYBOX_MATH_SSE4)
+
+Quat Multiply(Quat a, Quat b) {
+    __m128 qa = _mm_load_ps(&a.x);
+    __m128 qb = _mm_load_ps(&b.x);
+
+    __m128 result = _mm_mul_ps(_mm_shuffle_ps(qa, qa, _MM_SHUFFLE(3, 3, 3, 3)), qb);
+
+    __m128 term = _mm_mul_ps(_mm_shuffle_ps(qa, qa, _MM_SHUFFLE(0, 0, 0, 0)),
+                             _mm_shuffle_ps(qb, qb, _MM_SHUFFLE(0, 1, 2, 3)));
+    result = _mm_add_ps(result, _mm_mul_ps(term, _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f)));
+
+    term = _mm_mul_ps(_mm_shuffle_ps(qa, qa, _MM_SHUFFLE(1, 1, 1, 1)),
+                      _mm_shuffle_ps(qb, qb, _MM_SHUFFLE(1, 0, 3, 2)));
+    result = _mm_add_ps(result, _mm_mul_ps(term, _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f)));
+
+    term = _mm_mul_ps(_mm_shuffle_ps(qa, qa, _MM_SHUFFLE(2, 2, 2, 2)),
+                      _mm_shuffle_ps(qb, qb, _MM_SHUFFLE(2, 3, 0, 1)));
+    result = _mm_add_ps(result, _mm_mul_ps(term, _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f)));
+
+    Quat q;
+    _mm_store_ps(&q.x, result);
+    return q;
+}
+
+Quat Normalize(Quat q) {
+    __m128 v = _mm_load_ps(&q.x);
+    __m128 squares = _mm_mul_ps(v, v);
+    __m128 pairs = _mm_hadd_ps(squares, squares);
+    __m128 length = _mm_sqrt_ps(_mm_hadd_ps(pairs, pairs));
+    Quat result;
+    _mm_store_ps(&result.x, _mm_div_ps(v, length));
+    return result;
+}
+
+#else
+
+Quat Multiply(Quat a, Quat b) {
+    return scalar::Multiply(a, b);
+}
+
+Quat Normalize(Quat q) {
+    return scalar::Normalize(q);
+}
+
+#endif
+
+} // namespace math
+} // namespace toybox
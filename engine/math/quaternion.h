@@ -0,0 +1,106 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cmath> // For sqrtf, sinf, cosf
+
+#include "vector.h"
+
+namespace toybox
+{
+namespace math
+{
+
+// Unit quaternion rotation, w last
+struct alignas(16) Quat {
+    float x, y, z, w;
+};
+
+inline Quat QuatIdentity() {
+    return Quat{ 0.0f, 0.0f, 0.0f, 1.0f };
+}
+
+// axis must be unit length; angle is in radians
+inline Quat QuatFromAxisAngle(Vec3 axis, float angle) {
+    float s = sinf(angle * 0.5f);
+    return Quat{ axis.x * s, axis.y * s, axis.z * s, cosf(angle * 0.5f) };
+}
+
+inline Quat Conjugate(Quat q) {
+    return Quat{ -q.x, -q.y, -q.z, q.w };
+}
+
+inline float Dot(Quat a, Quat b) {
+    return (a.x * b.x + a.y * b.y) + (a.z * b.z + a.w * b.w);
+}
+
+namespace scalar
+{
+
+// a * b applies b first, then a
+inline Quat Multiply(Quat a, Quat b) {
+    // Summed in the same order as the SIMD version, with the signs on b as
+    // there. Written as subtractions, GCC vectorises the four lanes into a
+    // fused multiply-subtract-add under -mfma even with -ffp-contract=off.
+    return Quat{
+        ((a.w * b.x + a.x * b.w) + a.y * b.z) + a.z * -b.y,
+        ((a.w * b.y + a.x * -b.z) + a.y * b.w) + a.z * b.x,
+        ((a.w * b.z + a.x * b.y) + a.y * -b.x) + a.z * b.w,
+        ((a.w * b.w + a.x * -b.x) + a.y * -b.y) + a.z * -b.z,
+    };
+}
+
+inline Quat Normalize(Quat q) {
+    float length = sqrtf((q.x * q.x + q.y * q.y) + (q.z * q.z + q.w * q.w));
+    return Quat{ q.x / length, q.y / length, q.z / length, q.w / length };
+}
+
+} // namespace scalar
+
+// Built into MathModule at its SIMD level; the results match the scalar
+// versions exactly
+Quat Multiply(Quat a, Quat b);
+Quat Normalize(Quat q);
+
+inline Quat operator*(Quat a, Quat b) {
+    return Multiply(a, b);
+}
+
+// Rotate v by the unit quaternion q
+inline Vec3 Rotate(Quat q, Vec3 v) {
+    // v + 2w(u x v) + 2u x (u x v), with u the vector part of q
+    Vec3 u{ q.x, q.y, q.z };
+    Vec3 t = Cross(u, v) * 2.0f;
+    return v + t * q.w + Cross(u, t);
+}
+
+// Shortest-path spherical interpolation; falls back to a normalized lerp when
+// the rotations are nearly identical
+inline Quat Slerp(Quat a, Quat b, float t) {
+    float cos_theta = Dot(a, b);
+    if (cos_theta < 0.0f) {
+        b = Quat{ -b.x, -b.y, -b.z, -b.w };
+        cos_theta = -cos_theta;
+    }
+
+    float wa = 1.0f - t;
+    float wb = t;
+    if (cos_theta < 0.9995f) {
+        float theta = acosf(cos_theta);
+        float sin_theta = sinf(theta);
+        wa = sinf(wa * theta) / sin_theta;
+        wb = sinf(wb * theta) / sin_theta;
+    }
+    return Normalize(Quat{ a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb, a.w * wa + b.w * wb });
+}
+
+} // namespace math
+} // namespace toybox
@@ -0,0 +1,38 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+// The SIMD level is fixed at compile time by one definition:
+// TOYBOX_MATH_AVX2, TOYBOX_MATH_SSE4 or TOYBOX_MATH_SCALAR. Only MathModule's
+// sources and targets linking MathLanes are built with it and its flags; the
+// public math headers never include this one, so their inline functions
+// compile the same way everywhere. Without a definition the plain C paths
+// are used.
+#if defined(TOYBOX_MATH_SCALAR)
+#undef TOYBOX_MATH_AVX2
+#undef TOYBOX_MATH_SSE4
+#elif defined(TOYBOX_MATH_AVX2) && !defined(TOYBOX_MATH_SSE4)
+#define TOYBOX_MATH_SSE4 1
+#endif
+
+// A file built without the flags for the level cannot compile its paths
+#if defined(TOYBOX_MATH_AVX2) && !defined(__AVX2__)
+#error "TOYBOX_MATH_AVX2 is set but the file is not built for AVX2; link MathLanes for its flags"
+#endif
+#if defined(TOYBOX_MATH_SSE4) && !defined(_MSC_VER) && !defined(__SSE4_1__)
+#error "TOYBOX_MATH_SSE4 is set but the file is not built for SSE4.1; link MathLanes for its flags"
+#endif
+
+#if defined(TOYBOX_MATH_AVX2)
+#include <immintrin.h> // For AVX2 intrinsics
+#elif defined(TOYBOX_MATH_SSE4)
+#include <smmintrin.h> // For SSE4.1 intrinsics
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "vector.h"
+#include "simd.h"
+
+namespace toybox
+{
+namespace math
+{
+
+#if defined(TOYBOX_MATH_SSE4)
+
+static __m128 Load(const Vec4& v) {
+    return _mm_load_ps(&v.x);
+}
+
+static Vec4 Store(__m128 v) {
+    Vec4 result;
+    _mm_store_ps(&result.x, v);
+    return result;
+}
+
+Vec4 operator+(Vec4 a, Vec4 b) {
+    return Store(_mm_add_ps(Load(a), Load(b)));
+}
+
+Vec4 operator-(Vec4 a, Vec4 b) {
+    return Store(_mm_sub_ps(Load(a), Load(b)));
+}
+
+Vec4 operator*(Vec4 a, float s) {
+    return Store(_mm_mul_ps(Load(a), _mm_set1_ps(s)));
+}
+
+float Dot(Vec4 a, Vec4 b) {
+    __m128 product = _mm_mul_ps(Load(a), Load(b));
+    __m128 pairs = _mm_hadd_ps(product, product);
+    return _mm_cvtss_f32(_mm_hadd_ps(pairs, pairs));
+}
+
+Vec4 Min(Vec4 a, Vec4 b) {
+    return Store(_mm_min_ps(Load(a), Load(b)));
+}
+
+Vec4 Max(Vec4 a, Vec4 b) {
+    return Store(_mm_max_ps(Load(a), Load(b)));
+}
+
+#else
+
+Vec4 operator+(Vec4 a, Vec4 b) {
+    return scalar::Add(a, b);
+}
+
+Vec4 operator-(Vec4 a, Vec4 b) {
+    return scalar::Sub(a, b);
+}
+
+Vec4 operator*(Vec4 a, float s) {
+    return scalar::Mul(a, s);
+}
+
+float Dot(Vec4 a, Vec4 b) {
+    return scalar::Dot(a, b);
+}
+
+Vec4 Min(Vec4 a, Vec4 b) {
+    return scalar::Min(a, b);
+}
+
+Vec4 Max(Vec4 a, Vec4 b) {
+    return scalar::Max(a, b);
+}
+
+#endif
+
+const char* SimdLevelName() {
+#if defined(TOYBOX_MATH_AVX2)
+    return "AVX2";
+#elif defined(TOYBOX_MATH_SSE4)
+    return "SSE4";
+#else
+    return "Scalar";
+#endif
+}
+
+} // namespace math
+} // namespace toybox
@@ -0,0 +1,136 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cmath> // For sqrtf
+
+namespace toybox
+{
+namespace math
+{
+
+struct Vec3 {
+    float x, y, z;
+};
+
+// Padded to 16 bytes so it loads straight into a SIMD register
+struct alignas(16) Vec4 {
+    float x, y, z, w;
+};
+
+inline Vec3 operator+(Vec3 a, Vec3 b) {
+    return Vec3{ a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+inline Vec3 operator-(Vec3 a, Vec3 b) {
+    return Vec3{ a.x - b.x, a.y - b.y, a.z - b.z };
+}
+
+inline Vec3 operator-(Vec3 a) {
+    return Vec3{ -a.x, -a.y, -a.z };
+}
+
+inline Vec3 operator*(Vec3 a, float s) {
+    return Vec3{ a.x * s, a.y * s, a.z * s };
+}
+
+inline Vec3 operator*(Vec3 a, Vec3 b) {
+    return Vec3{ a.x * b.x, a.y * b.y, a.z * b.z };
+}
+
+inline bool operator==(Vec3 a, Vec3 b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+inline float Dot(Vec3 a, Vec3 b) {
+    return (a.x * b.x + a.y * b.y) + a.z * b.z;
+}
+
+inline Vec3 Cross(Vec3 a, Vec3 b) {
+    return Vec3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+inline float LengthSquared(Vec3 v) {
+    return Dot(v, v);
+}
+
+inline float Length(Vec3 v) {
+    return sqrtf(Dot(v, v));
+}
+
+// Returns the zero vector for a zero-length input
+inline Vec3 Normalize(Vec3 v) {
+    float length = Length(v);
+    return length > 0.0f ? Vec3{ v.x / length, v.y / length, v.z / length } : Vec3{ 0.0f, 0.0f, 0.0f };
+}
+
+inline Vec3 Min(Vec3 a, Vec3 b) {
+    return Vec3{ a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z };
+}
+
+inline Vec3 Max(Vec3 a, Vec3 b) {
+    return Vec3{ a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z };
+}
+
+inline Vec3 Lerp(Vec3 a, Vec3 b, float t) {
+    return a + (b - a) * t;
+}
+
+// Reference versions of the SIMD operations, always compiled in
+namespace scalar
+{
+
+inline Vec4 Add(Vec4 a, Vec4 b) {
+    return Vec4{ a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+}
+
+inline Vec4 Sub(Vec4 a, Vec4 b) {
+    return Vec4{ a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+}
+
+inline Vec4 Mul(Vec4 a, float s) {
+    return Vec4{ a.x * s, a.y * s, a.z * s, a.w * s };
+}
+
+inline float Dot(Vec4 a, Vec4 b) {
+    // Paired the way the SIMD horizontal add sums lanes
+    return (a.x * b.x + a.y * b.y) + (a.z * b.z + a.w * b.w);
+}
+
+inline Vec4 Min(Vec4 a, Vec4 b) {
+    return Vec4{ a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z, a.w < b.w ? a.w : b.w };
+}
+
+inline Vec4 Max(Vec4 a, Vec4 b) {
+    return Vec4{ a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z, a.w > b.w ? a.w : b.w };
+}
+
+} // namespace scalar
+
+// Built into MathModule at its SIMD level, so every caller runs the same
+// code whatever flags it is compiled with. The results match the scalar
+// versions exactly.
+Vec4 operator+(Vec4 a, Vec4 b);
+Vec4 operator-(Vec4 a, Vec4 b);
+Vec4 operator*(Vec4 a, float s);
+float Dot(Vec4 a, Vec4 b);
+Vec4 Min(Vec4 a, Vec4 b);
+Vec4 Max(Vec4 a, Vec4 b);
+
+inline float Length(Vec4 v) {
+    return sqrtf(Dot(v, v));
+}
+
+// The SIMD level MathModule was built for: "AVX2", "SSE4" or "Scalar"
+const char* SimdLevelName();
+
+} // namespace math
+} // namespace toybox
@@ -0,0 +1,67 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "grid_map.h"
+
+namespace toybox
+{
+namespace navigation
+{
+
+GridMap::GridMap() : width(0), height(0), stride(2) {}
+
+void GridMap::Init(int32_t width, int32_t height) {
+    this->width = width;
+    this->height = height;
+    stride = width + 2;
+
+    blocked.Resize(static_cast<size_t>(stride) * static_cast<size_t>(height + 2));
+    blocked.Fill(1);
+    for (int32_t y = 0; y < height; ++y) {
+        uint8_t* row = blocked.Data() + IndexOf(0, y);
+        for (int32_t x = 0; x < width; ++x) row[x] = 0;
+    }
+}
+
+int32_t GridMap::Width() const {
+    return width;
+}
+
+int32_t GridMap::Height() const {
+    return height;
+}
+
+bool GridMap::InBounds(int32_t x, int32_t y) const {
+    return x >= 0 && y >= 0 && x < width && y < height;
+}
+
+bool GridMap::IsWalkable(int32_t x, int32_t y) const {
+    return InBounds(x, y) && IsOpen(IndexOf(x, y));
+}
+
+void GridMap::SetBlocked(int32_t x, int32_t y, bool is_blocked) {
+    if (!InBounds(x, y)) return;
+    blocked.Data()[IndexOf(x, y)] = is_blocked ? 1 : 0;
+}
+
+bool GridMap::CanStep(int32_t x, int32_t y, int32_t dx, int32_t dy) const {
+    if (!IsWalkable(x + dx, y + dy)) return false;
+    if (dx != 0 && dy != 0) {
+        return IsWalkable(x + dx, y) && IsWalkable(x, y + dy);
+    }
+    return true;
+}
+
+uint32_t GridMap::IndexCount() const {
+    return static_cast<uint32_t>(blocked.Size());
+}
+
+} // namespace navigation
+} // namespace toybox
@@ -0,0 +1,96 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, int32_t, uint8_t
+
+#include "dynamicarray.h"
+
+namespace toybox
+{
+namespace navigation
+{
+
+struct GridCell {
+    int32_t x;
+    int32_t y;
+
+    bool operator==(const GridCell& other) const {
+        return x == other.x && y == other.y;
+    }
+
+    bool operator!=(const GridCell& other) const {
+        return !(*this == other);
+    }
+};
+
+// Cost of a straight and a diagonal step
+constexpr float kStraightCost = 1.0f;
+constexpr float kDiagonalCost = 1.41421356f;
+
+// Walkable/blocked bitmap of a tile map. Agents move in eight directions, but
+// may only cut a corner diagonally when both cells beside the move are open.
+//
+// Cells are stored one byte each with a blocked border of one cell all round,
+// so searches step to neighbours by index without bounds checks.
+struct GridMap {
+private:
+    int32_t width;
+    int32_t height;
+    int32_t stride; // width + 2
+    utils::data_structures::DynamicArray<uint8_t> blocked;
+
+public:
+    GridMap();
+
+    // Resizes to width x height, all open
+    void Init(int32_t width, int32_t height);
+
+    int32_t Width() const;
+    int32_t Height() const;
+
+    bool InBounds(int32_t x, int32_t y) const;
+    // False outside the map
+    bool IsWalkable(int32_t x, int32_t y) const;
+    void SetBlocked(int32_t x, int32_t y, bool is_blocked);
+
+    // True if a single step of (dx, dy), each -1, 0 or 1, is allowed from an
+    // open cell
+    bool CanStep(int32_t x, int32_t y, int32_t dx, int32_t dy) const;
+
+    // Padded cell indices, for searches. Any cell in the map and its
+    // neighbours have valid indices.
+    uint32_t IndexOf(int32_t x, int32_t y) const;
+    GridCell CellAt(uint32_t index) const;
+    int32_t Stride() const;
+    uint32_t IndexCount() const;
+    bool IsOpen(uint32_t index) const;
+};
+
+inline uint32_t GridMap::IndexOf(int32_t x, int32_t y) const {
+    return static_cast<uint32_t>((y + 1) * stride + x + 1);
+}
+
+inline GridCell GridMap::CellAt(uint32_t index) const {
+    int32_t i = static_cast<int32_t>(index);
+    return GridCell{ i % stride - 1, i / stride - 1 };
+}
+
+inline bool GridMap::IsOpen(uint32_t index) const {
+    return blocked.Data()[index] == 0;
+}
+
+inline int32_t GridMap::Stride() const {
+    return stride;
+}
+
+} // namespace navigation
+} // namespace toybox
@@ -0,0 +1,482 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstdlib> // For abort, abs
+
+#include "grid_pathfinder.h"
+
+namespace toybox
+{
+namespace navigation
+{
+
+using utils::data_structures::DynamicArray;
+
+static const uint32_t kNoNode = 0xFFFFFFFF;
+static const uint32_t kNotOpen = 0xFFFFFFFF;
+static const uint32_t kClosed = 0xFFFFFFFE;
+
+// Children per node of the open list heap. A wider heap is shallower, which
+// makes the many decrease-key operations of a grid search cheaper.
+static const uint32_t kHeapArity = 4;
+
+// Exact cost of the cheapest unobstructed path between two cells
+static float Octile(int32_t dx, int32_t dy) {
+    dx = abs(dx);
+    dy = abs(dy);
+    int32_t diagonal = dx < dy ? dx : dy;
+    int32_t straight = (dx < dy ? dy : dx) - diagonal;
+    return float(diagonal) * kDiagonalCost + float(straight) * kStraightCost;
+}
+
+static int32_t Sign(int32_t value) {
+    return (value > 0) - (value < 0);
+}
+
+float PathCost(const GridCell* cells, uint32_t count) {
+    float cost = 0.0f;
+    for (uint32_t i = 1; i < count; ++i) {
+        bool diagonal = cells[i].x != cells[i - 1].x && cells[i].y != cells[i - 1].y;
+        cost += diagonal ? kDiagonalCost : kStraightCost;
+    }
+    return cost;
+}
+
+GridPathfinder::GridPathfinder() : generation(0), expanded(0) {}
+
+void GridPathfinder::BeginSearch(uint32_t node_count) {
+    if (search_nodes.Size() < node_count) {
+        size_t old_size = search_nodes.Size();
+        search_nodes.Resize(node_count);
+        for (size_t i = old_size; i < node_count; ++i) search_nodes.Data()[i].generation = 0;
+    }
+    if (++generation == 0) {
+        // Wrapped: clear the stamps so no stale node looks current
+        for (size_t i = 0; i < search_nodes.Size(); ++i) search_nodes.Data()[i].generation = 0;
+        generation = 1;
+    }
+    open.Clear();
+    expanded = 0;
+}
+
+GridPathfinder::SearchNode& GridPathfinder::Touch(uint32_t node) {
+    SearchNode& search_node = search_nodes.Data()[node];
+    if (search_node.generation != generation) {
+        search_node.g = kUnreachable;
+        search_node.parent = kNoNode;
+        search_node.generation = generation;
+        search_node.heap_index = kNotOpen;
+    }
+    return search_node;
+}
+
+static bool OpenLess(float f_a, float h_a, float f_b, float h_b) {
+    // Break ties towards the goal
+    return f_a < f_b || (f_a == f_b && h_a < h_b);
+}
+
+void GridPathfinder::SiftUp(uint32_t position) {
+    OpenEntry* heap = open.Data();
+    SearchNode* nodes = search_nodes.Data();
+    OpenEntry entry = heap[position];
+    while (position > 0) {
+        uint32_t parent = (position - 1) / kHeapArity;
+        if (!OpenLess(entry.f, entry.h, heap[parent].f, heap[parent].h)) break;
+        heap[position] = heap[parent];
+        nodes[heap[position].node].heap_index = position;
+        position = parent;
+    }
+    heap[position] = entry;
+    nodes[entry.node].heap_index = position;
+}
+
+void GridPathfinder::SiftDown(uint32_t position) {
+    OpenEntry* heap = open.Data();
+    SearchNode* nodes = search_nodes.Data();
+    uint32_t size = static_cast<uint32_t>(open.Size());
+    OpenEntry entry = heap[position];
+    for (;;) {
+        uint32_t first = position * kHeapArity + 1;
+        if (first >= size) break;
+        uint32_t last = first + kHeapArity < size ? first + kHeapArity : size;
+        uint32_t best = first;
+        for (uint32_t child = first + 1; child < last; ++child) {
+            if (OpenLess(heap[child].f, heap[child].h, heap[best].f, heap[best].h)) best = child;
+        }
+        if (!OpenLess(heap[best].f, heap[best].h, entry.f, entry.h)) break;
+        heap[position] = heap[best];
+        nodes[heap[position].node].heap_index = position;
+        position = best;
+    }
+    heap[position] = entry;
+    nodes[entry.node].heap_index = position;
+}
+
+void GridPathfinder::OpenPush(uint32_t node, float f, float h) {
+    open.PushBack(OpenEntry{ f, h, node });
+    SiftUp(static_cast<uint32_t>(open.Size() - 1));
+}
+
+void GridPathfinder::OpenDecrease(uint32_t node, float f, float h) {
+    uint32_t position = search_nodes.Data()[node].heap_index;
+    open.Data()[position].f = f;
+    open.Data()[position].h = h;
+    SiftUp(position);
+}
+
+uint32_t GridPathfinder::OpenPop() {
+    OpenEntry* heap = open.Data();
+    uint32_t top = heap[0].node;
+    heap[0] = open.Back();
+    open.PopBack();
+    if (!open.Empty()) SiftDown(0);
+    search_nodes.Data()[top].heap_index = kClosed;
+    ++expanded;
+    return top;
+}
+
+bool GridPathfinder::SearchAStar(const GridMap& map, uint32_t start, uint32_t goal) {
+    BeginSearch(map.IndexCount());
+    GridCell target = map.CellAt(goal);
+    GridCell origin = map.CellAt(start);
+    int32_t stride = map.Stride();
+
+    SearchNode& first = Touch(start);
+    first.g = 0.0f;
+    first.parent = start;
+    float h = Octile(target.x - origin.x, target.y - origin.y);
+    OpenPush(start, h, h);
+
+    while (!open.Empty()) {
+        uint32_t current = OpenPop();
+        if (current == goal) return true;
+
+        GridCell cell = map.CellAt(current);
+        float g = search_nodes.Data()[current].g;
+        for (int32_t dy = -1; dy <= 1; ++dy) {
+            for (int32_t dx = -1; dx <= 1; ++dx) {
+                if (dx == 0 && dy == 0) continue;
+                uint32_t next = current + dy * stride + dx;
+                if (!map.IsOpen(next)) continue;
+                float step = kStraightCost;
+                if (dx != 0 && dy != 0) {
+                    if (!map.IsOpen(current + dx) || !map.IsOpen(current + dy * stride)) continue;
+                    step = kDiagonalCost;
+                }
+
+                SearchNode& node = Touch(next);
+                if (node.heap_index == kClosed || g + step >= node.g) continue;
+                node.g = g + step;
+                node.parent = current;
+                float next_h = Octile(target.x - cell.x - dx, target.y - cell.y - dy);
+                if (node.heap_index == kNotOpen) {
+                    OpenPush(next, node.g + next_h, next_h);
+                } else {
+                    OpenDecrease(next, node.g + next_h, next_h);
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// Walks straight from a cell until something makes the walk worth stopping
+// at: the goal, or an open cell beside the walk whose cell behind is blocked,
+// which only this cell can reach cheaply. kNoNode if the walk hits a wall.
+static uint32_t JumpStraight(const GridMap& map, uint32_t from, int32_t step, int32_t side, uint32_t goal) {
+    uint32_t current = from;
+    for (;;) {
+        if (!map.IsOpen(current + step)) return kNoNode;
+        current += step;
+        if (current == goal) return current;
+        uint32_t behind = current - step;
+        if ((map.IsOpen(current + side) && !map.IsOpen(behind + side)) ||
+            (map.IsOpen(current - side) && !map.IsOpen(behind - side))) {
+            return current;
+        }
+    }
+}
+
+uint32_t GridPathfinder::Jump(const GridMap& map, uint32_t from, int32_t dx, int32_t dy, uint32_t goal) const {
+    int32_t stride = map.Stride();
+    if (dx == 0 || dy == 0) {
+        int32_t side = dx != 0 ? stride : 1;
+        return JumpStraight(map, from, dy * stride + dx, side, goal);
+    }
+
+    // Diagonal: stop wherever a straight walk along either component would
+    // find something
+    int32_t step = dy * stride + dx;
+    uint32_t current = from;
+    for (;;) {
+        if (!map.IsOpen(current + dx) || !map.IsOpen(current + dy * stride) || !map.IsOpen(current + step)) {
+            return kNoNode;
+        }
+        current += step;
+        if (current == goal) return current;
+        if (JumpStraight(map, current, dx, stride, goal) != kNoNode ||
+            JumpStraight(map, current, dy * stride, 1, goal) != kNoNode) {
+            return current;
+        }
+    }
+}
+
+bool GridPathfinder::SearchJumpPoint(const GridMap& map, uint32_t start, uint32_t goal) {
+    BeginSearch(map.IndexCount());
+    GridCell target = map.CellAt(goal);
+    GridCell origin = map.CellAt(start);
+
+    SearchNode& first = Touch(start);
+    first.g = 0.0f;
+    first.parent = start;
+    float h = Octile(target.x - origin.x, target.y - origin.y);
+    OpenPush(start, h, h);
+
+    static const int32_t kAllDirections[8][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 },
+                                                  { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+
+    while (!open.Empty()) {
+        uint32_t current = OpenPop();
+        if (current == goal) return true;
+
+        GridCell cell = map.CellAt(current);
+        const SearchNode& node = search_nodes.Data()[current];
+        float g = node.g;
+
+        // Prune to the directions an optimal path through this node can take
+        // next, given the direction it arrived from. With corner cutting
+        // forbidden, forced neighbours are the cells beside a straight move.
+        int32_t directions[8][2];
+        uint32_t direction_count = 0;
+        if (node.parent == current) {
+            for (uint32_t d = 0; d < 8; ++d) {
+                directions[d][0] = kAllDirections[d][0];
+                directions[d][1] = kAllDirections[d][1];
+            }
+            direction_count = 8;
+        } else {
+            GridCell from = map.CellAt(node.parent);
+            int32_t dx = Sign(cell.x - from.x);
+            int32_t dy = Sign(cell.y - from.y);
+            auto add = [&directions, &direction_count](int32_t x, int32_t y) {
+                directions[direction_count][0] = x;
+                directions[direction_count][1] = y;
+                ++direction_count;
+            };
+            if (dx != 0 && dy != 0) {
+                add(dx, 0);
+                add(0, dy);
+                add(dx, dy);
+            } else if (dx != 0) {
+                add(dx, 0);
+                add(0, 1);
+                add(0, -1);
+                add(dx, 1);
+                add(dx, -1);
+            } else {
+                add(0, dy);
+                add(1, 0);
+                add(-1, 0);
+                add(1, dy);
+                add(-1, dy);
+            }
+        }
+
+        for (uint32_t d = 0; d < direction_count; ++d) {
+            uint32_t jump = Jump(map, current, directions[d][0], directions[d][1], goal);
+            if (jump == kNoNode) continue;
+
+            GridCell landing = map.CellAt(jump);
+            SearchNode& next = Touch(jump);
+            float next_g = g + Octile(landing.x - cell.x, landing.y - cell.y);
+            if (next.heap_index == kClosed || next_g >= next.g) continue;
+            next.g = next_g;
+            next.parent = current;
+            float next_h = Octile(target.x - landing.x, target.y - landing.y);
+            if (next.heap_index == kNotOpen) {
+                OpenPush(jump, next_g + next_h, next_h);
+            } else {
+                OpenDecrease(jump, next_g + next_h, next_h);
+            }
+        }
+    }
+    return false;
+}
+
+void GridPathfinder::EmitPath(const GridMap& map, uint32_t goal, DynamicArray<GridCell>* path) const {
+    // Walk back from the goal, filling in the straight or diagonal run
+    // between each node and its parent
+    const SearchNode* nodes = search_nodes.Data();
+    uint32_t node = goal;
+    while (nodes[node].parent != node) {
+        GridCell cell = map.CellAt(node);
+        GridCell parent = map.CellAt(nodes[node].parent);
+        int32_t dx = Sign(parent.x - cell.x);
+        int32_t dy = Sign(parent.y - cell.y);
+        while (cell != parent) {
+            path->PushBack(cell);
+            cell.x += dx;
+            cell.y += dy;
+        }
+        node = nodes[node].parent;
+    }
+    path->PushBack(map.CellAt(node));
+    path->Reverse();
+}
+
+bool GridPathfinder::SearchHierarchical(const HierarchicalGrid& hierarchy, GridCell start, GridCell goal,
+                                        DynamicArray<GridCell>* path) {
+    const GridMap& map = *hierarchy.map;
+    const HierarchicalGrid::Cluster* clusters = hierarchy.clusters.Data();
+    const HierarchicalGrid::Node* nodes = hierarchy.nodes.Data();
+    uint32_t start_cluster = hierarchy.ClusterOf(start);
+    uint32_t goal_cluster = hierarchy.ClusterOf(goal);
+    const HierarchicalGrid::Cluster& first = clusters[start_cluster];
+    const HierarchicalGrid::Cluster& last = clusters[goal_cluster];
+
+    // Connect the start and goal to the entrances of their clusters
+    cluster_search.Run(map, first.x, first.y, first.width, first.height, start);
+    float direct = start_cluster == goal_cluster ? cluster_search.Distance(goal) : kUnreachable;
+    start_costs.Resize(first.node_count);
+    for (uint32_t k = 0; k < first.node_count; ++k) {
+        start_costs.Data()[k] = cluster_search.Distance(nodes[first.first_node + k].cell);
+    }
+    cluster_search.Run(map, last.x, last.y, last.width, last.height, goal);
+    goal_costs.Resize(last.node_count);
+    for (uint32_t k = 0; k < last.node_count; ++k) {
+        goal_costs.Data()[k] = cluster_search.Distance(nodes[last.first_node + k].cell);
+    }
+
+    // A* over the entrances. The goal is one extra node after them; the
+    // start entrances are seeded with their own index as parent.
+    uint32_t goal_node = hierarchy.NodeCount();
+    BeginSearch(goal_node + 1);
+    auto relax = [this, nodes, goal, goal_node](uint32_t node, uint32_t parent, float g) {
+        SearchNode& search_node = Touch(node);
+        if (search_node.heap_index == kClosed || g >= search_node.g) return;
+        search_node.g = g;
+        search_node.parent = parent;
+        float h = 0.0f;
+        if (node != goal_node) h = Octile(goal.x - nodes[node].cell.x, goal.y - nodes[node].cell.y);
+        if (search_node.heap_index == kNotOpen) {
+            OpenPush(node, g + h, h);
+        } else {
+            OpenDecrease(node, g + h, h);
+        }
+    };
+    for (uint32_t k = 0; k < first.node_count; ++k) {
+        float cost = start_costs.Data()[k];
+        if (cost < kUnreachable) relax(first.first_node + k, first.first_node + k, cost);
+    }
+
+    bool found = false;
+    while (!open.Empty()) {
+        // Nothing left can beat a path that stays inside the one cluster
+        if (open.Data()[0].f >= direct) break;
+        uint32_t current = OpenPop();
+        if (current == goal_node) {
+            found = true;
+            break;
+        }
+
+        const HierarchicalGrid::Node& node = nodes[current];
+        const HierarchicalGrid::Cluster& cluster = clusters[node.cluster];
+        float g = search_nodes.Data()[current].g;
+        uint32_t local = current - cluster.first_node;
+        relax(node.partner, current, g + kStraightCost);
+        for (uint32_t k = 0; k < cluster.node_count; ++k) {
+            float cost = hierarchy.Cost(cluster, local, k);
+            if (k != local && cost < kUnreachable) relax(cluster.first_node + k, current, g + cost);
+        }
+        if (node.cluster == goal_cluster) {
+            float cost = goal_costs.Data()[local];
+            if (cost < kUnreachable) relax(goal_node, current, g + cost);
+        }
+    }
+
+    path->PushBack(start);
+    if (!found) {
+        if (direct >= kUnreachable) {
+            path->Clear();
+            return false;
+        }
+        cluster_search.Run(map, first.x, first.y, first.width, first.height, start, &goal);
+        cluster_search.AppendPath(goal, path);
+        return true;
+    }
+
+    // Entrances from the first to the last
+    abstract_path.Clear();
+    uint32_t node = search_nodes.Data()[goal_node].parent;
+    for (;;) {
+        abstract_path.PushBack(node);
+        uint32_t parent = search_nodes.Data()[node].parent;
+        if (parent == node) break;
+        node = parent;
+    }
+    abstract_path.Reverse();
+
+    // Refine each hop to cells: crossings are a single step, and moves inside
+    // a cluster are searched again within it
+    const uint32_t* hops = abstract_path.Data();
+    uint32_t hop_count = static_cast<uint32_t>(abstract_path.Size());
+    GridCell entry = nodes[hops[0]].cell;
+    cluster_search.Run(map, first.x, first.y, first.width, first.height, start, &entry);
+    cluster_search.AppendPath(entry, path);
+    for (uint32_t i = 1; i < hop_count; ++i) {
+        const HierarchicalGrid::Node& from = nodes[hops[i - 1]];
+        const HierarchicalGrid::Node& to = nodes[hops[i]];
+        if (from.partner == hops[i]) {
+            path->PushBack(to.cell);
+            continue;
+        }
+        const HierarchicalGrid::Cluster& cluster = clusters[from.cluster];
+        cluster_search.Run(map, cluster.x, cluster.y, cluster.width, cluster.height, from.cell, &to.cell);
+        cluster_search.AppendPath(to.cell, path);
+    }
+    GridCell exit = nodes[hops[hop_count - 1]].cell;
+    cluster_search.Run(map, last.x, last.y, last.width, last.height, exit, &goal);
+    cluster_search.AppendPath(goal, path);
+    return true;
+}
+
+bool GridPathfinder::FindPath(const GridMap& map, GridCell start, GridCell goal, PathAlgorithm algorithm,
+                              DynamicArray<GridCell>* path, const HierarchicalGrid* hierarchy) {
+    path->Clear();
+    expanded = 0;
+    if (!map.IsWalkable(start.x, start.y) || !map.IsWalkable(goal.x, goal.y)) return false;
+    if (start == goal) {
+        path->PushBack(start);
+        return true;
+    }
+
+    uint32_t from = map.IndexOf(start.x, start.y);
+    uint32_t to = map.IndexOf(goal.x, goal.y);
+    switch (algorithm) {
+    case PathAlgorithm::AStar:
+        if (!SearchAStar(map, from, to)) return false;
+        break;
+    case PathAlgorithm::JumpPoint:
+        if (!SearchJumpPoint(map, from, to)) return false;
+        break;
+    case PathAlgorithm::Hierarchical:
+        if (!hierarchy || hierarchy->Map() != &map) abort();
+        return SearchHierarchical(*hierarchy, start, goal, path);
+    }
+    EmitPath(map, to, path);
+    return true;
+}
+
+uint32_t GridPathfinder::ExpandedNodes() const {
+    return expanded;
+}
+
+} // namespace navigation
+} // namespace toybox
@@ -0,0 +1,94 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint8_t
+
+#include "dynamicarray.h"
+#include "grid_map.h"
+#include "hierarchical_grid.h"
+
+namespace toybox
+{
+namespace navigation
+{
+
+enum class PathAlgorithm : uint8_t {
+    AStar,        // Optimal; expands every cell it touches
+    JumpPoint,    // Optimal; skips over open areas (Jump Point Search)
+    Hierarchical, // Near optimal; searches the HPA* abstraction, needs a HierarchicalGrid
+};
+
+// Finds paths on a GridMap. All search state is kept between calls and reset
+// lazily with a generation counter, so after warm-up a search allocates
+// nothing. Not thread safe: give each thread its own pathfinder.
+struct GridPathfinder {
+private:
+    struct SearchNode {
+        float g;
+        uint32_t parent;
+        uint32_t generation;
+        uint32_t heap_index; // kClosed once expanded
+    };
+
+    struct OpenEntry {
+        float f;
+        float h;
+        uint32_t node;
+    };
+
+    utils::data_structures::DynamicArray<SearchNode> search_nodes;
+    utils::data_structures::DynamicArray<OpenEntry> open;
+    uint32_t generation;
+    uint32_t expanded;
+
+    // Hierarchical search scratch
+    ClusterSearch cluster_search;
+    utils::data_structures::DynamicArray<float> start_costs;
+    utils::data_structures::DynamicArray<float> goal_costs;
+    utils::data_structures::DynamicArray<uint32_t> abstract_path;
+
+    void BeginSearch(uint32_t node_count);
+    SearchNode& Touch(uint32_t node);
+    void OpenPush(uint32_t node, float f, float h);
+    void OpenDecrease(uint32_t node, float f, float h);
+    uint32_t OpenPop();
+    void SiftUp(uint32_t position);
+    void SiftDown(uint32_t position);
+
+    bool SearchAStar(const GridMap& map, uint32_t start, uint32_t goal);
+    bool SearchJumpPoint(const GridMap& map, uint32_t start, uint32_t goal);
+    uint32_t Jump(const GridMap& map, uint32_t from, int32_t dx, int32_t dy, uint32_t goal) const;
+    bool SearchHierarchical(const HierarchicalGrid& hierarchy, GridCell start, GridCell goal,
+                            utils::data_structures::DynamicArray<GridCell>* path);
+    void EmitPath(const GridMap& map, uint32_t goal, utils::data_structures::DynamicArray<GridCell>* path) const;
+
+public:
+    GridPathfinder();
+
+    GridPathfinder(const GridPathfinder&) = delete;
+    GridPathfinder& operator=(const GridPathfinder&) = delete;
+
+    // Replaces path with every cell from start to goal, both included, and
+    // returns true; returns false with an empty path if there is none.
+    // Hierarchical searches use hierarchy, which must be built over map.
+    bool FindPath(const GridMap& map, GridCell start, GridCell goal, PathAlgorithm algorithm,
+                  utils::data_structures::DynamicArray<GridCell>* path, const HierarchicalGrid* hierarchy = nullptr);
+
+    // Nodes taken off the open list by the last search
+    uint32_t ExpandedNodes() const;
+};
+
+// Cost of the path along a list of cells
+float PathCost(const GridCell* cells, uint32_t count);
+
+} // namespace navigation
+} // namespace toybox
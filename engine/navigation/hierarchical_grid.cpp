@@ -0,0 +1,411 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstdlib> // For abort
+#include <cstring> // For memcpy
+
+#include "hierarchical_grid.h"
+#include "parallel_for.h"
+
+namespace toybox
+{
+namespace navigation
+{
+
+using utils::data_structures::DynamicArray;
+
+static const uint32_t kNoCluster = 0xFFFFFFFF;
+
+// Open border stretches at least this long get an entrance at each end
+static const int32_t kWideEntrance = 6;
+
+// Binary min-heap on cost over a DynamicArray
+template<typename T>
+static void HeapPush(DynamicArray<T>& heap, const T& value) {
+    heap.PushBack(value);
+    T* data = heap.Data();
+    size_t i = heap.Size() - 1;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!(data[i].cost < data[parent].cost)) break;
+        T swap = data[i];
+        data[i] = data[parent];
+        data[parent] = swap;
+        i = parent;
+    }
+}
+
+template<typename T>
+static T HeapPop(DynamicArray<T>& heap) {
+    T* data = heap.Data();
+    T top = data[0];
+    data[0] = heap.Back();
+    heap.PopBack();
+    size_t size = heap.Size();
+    size_t i = 0;
+    for (;;) {
+        size_t smallest = i;
+        size_t left = i * 2 + 1;
+        size_t right = left + 1;
+        if (left < size && data[left].cost < data[smallest].cost) smallest = left;
+        if (right < size && data[right].cost < data[smallest].cost) smallest = right;
+        if (smallest == i) break;
+        T swap = data[i];
+        data[i] = data[smallest];
+        data[smallest] = swap;
+        i = smallest;
+    }
+    return top;
+}
+
+ClusterSearch::ClusterSearch() : min_x(0), min_y(0), width(0), height(0) {}
+
+void ClusterSearch::Run(const GridMap& map, int32_t x, int32_t y, int32_t width, int32_t height, GridCell source,
+                        const GridCell* target) {
+    min_x = x;
+    min_y = y;
+    this->width = width;
+    this->height = height;
+    size_t cells = static_cast<size_t>(width) * static_cast<size_t>(height);
+    distance.Resize(cells);
+    distance.Fill(kUnreachable);
+    parent.Resize(cells);
+    heap.Clear();
+
+    uint32_t start = static_cast<uint32_t>((source.y - y) * width + (source.x - x));
+    uint32_t goal = target ? static_cast<uint32_t>((target->y - y) * width + (target->x - x)) : 0xFFFFFFFF;
+    float* dist = distance.Data();
+    uint32_t* from = parent.Data();
+    dist[start] = 0.0f;
+    from[start] = start;
+    HeapPush(heap, Entry{ 0.0f, start });
+
+    while (!heap.Empty()) {
+        Entry entry = HeapPop(heap);
+        if (entry.cost > dist[entry.cell]) continue;
+        if (entry.cell == goal) break;
+
+        int32_t cx = static_cast<int32_t>(entry.cell) % width;
+        int32_t cy = static_cast<int32_t>(entry.cell) / width;
+        uint32_t here = map.IndexOf(cx + x, cy + y);
+        for (int32_t dy = -1; dy <= 1; ++dy) {
+            for (int32_t dx = -1; dx <= 1; ++dx) {
+                if (dx == 0 && dy == 0) continue;
+                int32_t nx = cx + dx;
+                int32_t ny = cy + dy;
+                if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+                // Every cell of the rectangle is on the map, so padded
+                // neighbour indices are safe
+                if (!map.IsOpen(here + dy * map.Stride() + dx)) continue;
+                float step = kStraightCost;
+                if (dx != 0 && dy != 0) {
+                    if (!map.IsOpen(here + dx) || !map.IsOpen(here + dy * map.Stride())) continue;
+                    step = kDiagonalCost;
+                }
+                uint32_t next = static_cast<uint32_t>(ny * width + nx);
+                float cost = entry.cost + step;
+                if (cost < dist[next]) {
+                    dist[next] = cost;
+                    from[next] = entry.cell;
+                    HeapPush(heap, Entry{ cost, next });
+                }
+            }
+        }
+    }
+}
+
+float ClusterSearch::Distance(GridCell cell) const {
+    int32_t x = cell.x - min_x;
+    int32_t y = cell.y - min_y;
+    if (x < 0 || y < 0 || x >= width || y >= height) return kUnreachable;
+    return distance.Data()[y * width + x];
+}
+
+void ClusterSearch::AppendPath(GridCell cell, DynamicArray<GridCell>* path) const {
+    const uint32_t* from = parent.Data();
+    size_t first = path->Size();
+    uint32_t index = static_cast<uint32_t>((cell.y - min_y) * width + (cell.x - min_x));
+    while (from[index] != index) {
+        int32_t i = static_cast<int32_t>(index);
+        path->PushBack(GridCell{ i % width + min_x, i / width + min_y });
+        index = from[index];
+    }
+
+    // Collected goal first; flip the new tail
+    GridCell* data = path->Data();
+    for (size_t a = first, b = path->Size(); a + 1 < b; ++a, --b) {
+        GridCell swap = data[a];
+        data[a] = data[b - 1];
+        data[b - 1] = swap;
+    }
+}
+
+HierarchicalGrid::HierarchicalGrid()
+    : map(nullptr), cluster_size(0), clusters_x(0), clusters_y(0), any_dirty(false) {}
+
+uint32_t HierarchicalGrid::Neighbour(uint32_t cluster, Side side) const {
+    int32_t cx = static_cast<int32_t>(cluster) % clusters_x;
+    int32_t cy = static_cast<int32_t>(cluster) / clusters_x;
+    switch (side) {
+    case kWest:
+        return cx > 0 ? cluster - 1 : kNoCluster;
+    case kEast:
+        return cx + 1 < clusters_x ? cluster + 1 : kNoCluster;
+    case kNorth:
+        return cy > 0 ? cluster - clusters_x : kNoCluster;
+    default:
+        return cy + 1 < clusters_y ? cluster + clusters_x : kNoCluster;
+    }
+}
+
+uint32_t HierarchicalGrid::SideEntrances(const Cluster& cluster, Side side, int32_t* offsets) const {
+    uint32_t index = static_cast<uint32_t>(&cluster - clusters.Data());
+    if (Neighbour(index, side) == kNoCluster) return 0;
+
+    // Walk the cells along the side, paired with the cells across it. Both
+    // clusters walk a shared side in the same order, so their entrances pair
+    // up by position.
+    GridCell inside = { cluster.x, cluster.y };
+    GridCell across = inside;
+    int32_t step_x = 0;
+    int32_t step_y = 0;
+    int32_t length = 0;
+    switch (side) {
+    case kWest:
+        across.x -= 1;
+        step_y = 1;
+        length = cluster.height;
+        break;
+    case kEast:
+        inside.x += cluster.width - 1;
+        across.x = inside.x + 1;
+        step_y = 1;
+        length = cluster.height;
+        break;
+    case kNorth:
+        across.y -= 1;
+        step_x = 1;
+        length = cluster.width;
+        break;
+    default:
+        inside.y += cluster.height - 1;
+        across.y = inside.y + 1;
+        step_x = 1;
+        length = cluster.width;
+        break;
+    }
+
+    uint32_t count = 0;
+    int32_t run_start = -1;
+    for (int32_t i = 0; i <= length; ++i) {
+        bool open = i < length && map->IsWalkable(inside.x + i * step_x, inside.y + i * step_y) &&
+                    map->IsWalkable(across.x + i * step_x, across.y + i * step_y);
+        if (open && run_start < 0) run_start = i;
+        if (!open && run_start >= 0) {
+            int32_t run = i - run_start;
+            if (run < kWideEntrance) {
+                offsets[count++] = run_start + (run - 1) / 2;
+            } else {
+                offsets[count++] = run_start;
+                offsets[count++] = i - 1;
+            }
+            run_start = -1;
+        }
+    }
+    return count;
+}
+
+float HierarchicalGrid::Cost(const Cluster& cluster, uint32_t from, uint32_t to) const {
+    return costs.Data()[cluster.first_cost + from * cluster.node_count + to];
+}
+
+void HierarchicalGrid::Build(const GridMap& map, int32_t cluster_size, utils::jobs::JobSystem* jobs) {
+    if (cluster_size < 1 || cluster_size > kMaxClusterSize) abort();
+
+    this->map = &map;
+    this->cluster_size = cluster_size;
+    clusters_x = (map.Width() + cluster_size - 1) / cluster_size;
+    clusters_y = (map.Height() + cluster_size - 1) / cluster_size;
+
+    uint32_t count = static_cast<uint32_t>(clusters_x * clusters_y);
+    clusters.Resize(count);
+    for (uint32_t c = 0; c < count; ++c) {
+        Cluster& cluster = clusters.Data()[c];
+        cluster.x = static_cast<int32_t>(c) % clusters_x * cluster_size;
+        cluster.y = static_cast<int32_t>(c) / clusters_x * cluster_size;
+        cluster.width = map.Width() - cluster.x < cluster_size ? map.Width() - cluster.x : cluster_size;
+        cluster.height = map.Height() - cluster.y < cluster_size ? map.Height() - cluster.y : cluster_size;
+        cluster.first_node = 0;
+        cluster.node_count = 0;
+        cluster.first_cost = 0;
+    }
+    nodes.Clear();
+    costs.Clear();
+    dirty.Resize(count);
+    dirty.Fill(1);
+    any_dirty = true;
+
+    Update(jobs);
+}
+
+void HierarchicalGrid::MarkChanged(int32_t x, int32_t y) {
+    if (!map || !map->InBounds(x, y)) return;
+
+    uint32_t index = ClusterOf(GridCell{ x, y });
+    const Cluster& cluster = clusters.Data()[index];
+    uint8_t* flags = dirty.Data();
+    flags[index] = 1;
+
+    // Cells on a side also change the entrances of the cluster across it
+    Side touched[kSideCount];
+    uint32_t touched_count = 0;
+    if (x == cluster.x) touched[touched_count++] = kWest;
+    if (x == cluster.x + cluster.width - 1) touched[touched_count++] = kEast;
+    if (y == cluster.y) touched[touched_count++] = kNorth;
+    if (y == cluster.y + cluster.height - 1) touched[touched_count++] = kSouth;
+    for (uint32_t i = 0; i < touched_count; ++i) {
+        uint32_t neighbour = Neighbour(index, touched[i]);
+        if (neighbour != kNoCluster) flags[neighbour] = 1;
+    }
+    any_dirty = true;
+}
+
+void HierarchicalGrid::Update(utils::jobs::JobSystem* jobs) {
+    if (!any_dirty) return;
+
+    uint32_t count = static_cast<uint32_t>(clusters.Size());
+    DynamicArray<Cluster> previous(clusters);
+    Cluster* data = clusters.Data();
+    const uint8_t* flags = dirty.Data();
+
+    // Recount every entrance. Only sides next to a changed cell can differ,
+    // but the scan is cheap next to the cost searches.
+    auto count_entrances = [this, data](size_t begin, size_t end) {
+        int32_t offsets[kMaxClusterSize];
+        for (size_t c = begin; c < end; ++c) {
+            Cluster& cluster = data[c];
+            cluster.node_count = 0;
+            for (int side = 0; side < kSideCount; ++side) {
+                cluster.side_count[side] = SideEntrances(cluster, static_cast<Side>(side), offsets);
+                cluster.node_count += cluster.side_count[side];
+            }
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, count, count_entrances);
+    } else {
+        count_entrances(0, count);
+    }
+
+    uint32_t node_total = 0;
+    uint32_t cost_total = 0;
+    for (uint32_t c = 0; c < count; ++c) {
+        data[c].first_node = node_total;
+        data[c].first_cost = cost_total;
+        node_total += data[c].node_count;
+        cost_total += data[c].node_count * data[c].node_count;
+    }
+
+    DynamicArray<Node> new_nodes;
+    DynamicArray<float> new_costs;
+    new_nodes.Resize(node_total);
+    new_costs.Resize(cost_total);
+    Node* node_data = new_nodes.Data();
+    float* cost_data = new_costs.Data();
+    const Cluster* old_data = previous.Data();
+    const float* old_costs = costs.Data();
+
+    auto build_clusters = [this, data, flags, node_data, cost_data, old_data, old_costs](size_t begin, size_t end) {
+        int32_t offsets[kMaxClusterSize];
+        ClusterSearch search;
+        for (size_t c = begin; c < end; ++c) {
+            const Cluster& cluster = data[c];
+
+            // Place the entrances, and link them to the matching entrance of
+            // the cluster across
+            uint32_t node = cluster.first_node;
+            for (int side = 0; side < kSideCount; ++side) {
+                uint32_t entrances = SideEntrances(cluster, static_cast<Side>(side), offsets);
+                uint32_t neighbour = Neighbour(static_cast<uint32_t>(c), static_cast<Side>(side));
+                int opposite = side ^ 1;
+                uint32_t partner_first = 0;
+                if (neighbour != kNoCluster) {
+                    const Cluster& other = data[neighbour];
+                    partner_first = other.first_node;
+                    for (int s = 0; s < opposite; ++s) partner_first += other.side_count[s];
+                }
+                for (uint32_t k = 0; k < entrances; ++k, ++node) {
+                    GridCell cell = { cluster.x, cluster.y };
+                    switch (side) {
+                    case kWest:
+                        cell.y += offsets[k];
+                        break;
+                    case kEast:
+                        cell.x += cluster.width - 1;
+                        cell.y += offsets[k];
+                        break;
+                    case kNorth:
+                        cell.x += offsets[k];
+                        break;
+                    default:
+                        cell.x += offsets[k];
+                        cell.y += cluster.height - 1;
+                        break;
+                    }
+                    node_data[node] = Node{ cell, static_cast<uint32_t>(c), partner_first + k };
+                }
+            }
+
+            // Costs between every pair of entrances. An unchanged cluster
+            // keeps its entrances and so its old cost block.
+            uint32_t n = cluster.node_count;
+            float* block = cost_data + cluster.first_cost;
+            if (!flags[c] && old_data[c].node_count == n) {
+                if (n > 0) memcpy(block, old_costs + old_data[c].first_cost, sizeof(float) * n * n);
+                continue;
+            }
+            for (uint32_t i = 0; i < n; ++i) {
+                search.Run(*map, cluster.x, cluster.y, cluster.width, cluster.height, node_data[cluster.first_node + i].cell);
+                for (uint32_t j = 0; j < n; ++j) {
+                    block[i * n + j] = search.Distance(node_data[cluster.first_node + j].cell);
+                }
+            }
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, count, build_clusters);
+    } else {
+        build_clusters(0, count);
+    }
+
+    nodes.Swap(new_nodes);
+    costs.Swap(new_costs);
+    dirty.Fill(0);
+    any_dirty = false;
+}
+
+const GridMap* HierarchicalGrid::Map() const {
+    return map;
+}
+
+uint32_t HierarchicalGrid::ClusterOf(GridCell cell) const {
+    return static_cast<uint32_t>((cell.y / cluster_size) * clusters_x + cell.x / cluster_size);
+}
+
+uint32_t HierarchicalGrid::ClusterCount() const {
+    return static_cast<uint32_t>(clusters.Size());
+}
+
+uint32_t HierarchicalGrid::NodeCount() const {
+    return static_cast<uint32_t>(nodes.Size());
+}
+
+} // namespace navigation
+} // namespace toybox
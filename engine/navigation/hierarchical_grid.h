@@ -0,0 +1,132 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, int32_t, uint8_t
+
+#include "dynamicarray.h"
+#include "grid_map.h"
+#include "job_system.h"
+
+namespace toybox
+{
+namespace navigation
+{
+
+// Distance of cells a search did not reach
+constexpr float kUnreachable = 1e30f;
+
+// Largest cluster side HierarchicalGrid accepts
+constexpr int32_t kMaxClusterSize = 64;
+
+// Dijkstra confined to a rectangle of the map. The scratch arrays are kept
+// between runs, so reuse one per thread.
+struct ClusterSearch {
+private:
+    struct Entry {
+        float cost;
+        uint32_t cell; // Index inside the rectangle
+    };
+
+    int32_t min_x;
+    int32_t min_y;
+    int32_t width;
+    int32_t height;
+    utils::data_structures::DynamicArray<float> distance;
+    utils::data_structures::DynamicArray<uint32_t> parent;
+    utils::data_structures::DynamicArray<Entry> heap;
+
+public:
+    ClusterSearch();
+
+    // Searches out from source over the open cells of the rectangle. With a
+    // target, stops as soon as the target's distance is final.
+    void Run(const GridMap& map, int32_t x, int32_t y, int32_t width, int32_t height, GridCell source,
+             const GridCell* target = nullptr);
+
+    // Distance from the source, or kUnreachable
+    float Distance(GridCell cell) const;
+
+    // Appends the cells after the source up to and including cell
+    void AppendPath(GridCell cell, utils::data_structures::DynamicArray<GridCell>* path) const;
+};
+
+// Abstraction of a GridMap for HPA*: the map is cut into square clusters,
+// and each open stretch of border between two clusters gets an entrance, a
+// node on either side (two for wide stretches, one at each end). Within a
+// cluster the costs between all its nodes are cached. A search runs on this
+// small graph and only refines the few clusters along the way to cells.
+//
+// Paths are close to optimal, not exact. After editing the map call
+// MarkChanged for each edited cell and then Update, which recomputes only the
+// clusters that were touched.
+struct HierarchicalGrid {
+private:
+    friend struct GridPathfinder;
+
+    // Cluster sides, in the order their entrances are stored
+    enum Side { kWest, kEast, kNorth, kSouth, kSideCount };
+
+    struct Cluster {
+        int32_t x;
+        int32_t y;
+        int32_t width;
+        int32_t height;
+        uint32_t first_node;
+        uint32_t side_count[kSideCount];
+        uint32_t node_count;
+        uint32_t first_cost; // node_count * node_count costs, row by row
+    };
+
+    struct Node {
+        GridCell cell;
+        uint32_t cluster;
+        uint32_t partner; // Node on the other side of the entrance
+    };
+
+    const GridMap* map;
+    int32_t cluster_size;
+    int32_t clusters_x;
+    int32_t clusters_y;
+    utils::data_structures::DynamicArray<Cluster> clusters;
+    utils::data_structures::DynamicArray<Node> nodes;
+    utils::data_structures::DynamicArray<float> costs;
+    utils::data_structures::DynamicArray<uint8_t> dirty;
+    bool any_dirty;
+
+    uint32_t SideEntrances(const Cluster& cluster, Side side, int32_t* offsets) const;
+    uint32_t Neighbour(uint32_t cluster, Side side) const;
+    float Cost(const Cluster& cluster, uint32_t from, uint32_t to) const;
+
+public:
+    HierarchicalGrid();
+
+    HierarchicalGrid(const HierarchicalGrid&) = delete;
+    HierarchicalGrid& operator=(const HierarchicalGrid&) = delete;
+
+    // Builds the abstraction of map, which must outlive it. Clusters are
+    // processed in parallel if a job system is given.
+    void Build(const GridMap& map, int32_t cluster_size = 16, utils::jobs::JobSystem* jobs = nullptr);
+
+    // Records that a cell of the map changed since the last Build or Update
+    void MarkChanged(int32_t x, int32_t y);
+
+    // Recomputes the clusters marked as changed
+    void Update(utils::jobs::JobSystem* jobs = nullptr);
+
+    const GridMap* Map() const;
+    uint32_t ClusterOf(GridCell cell) const;
+    uint32_t ClusterCount() const;
+    uint32_t NodeCount() const;
+};
+
+} // namespace navigation
+} // namespace toybox
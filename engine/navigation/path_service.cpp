@@ -0,0 +1,166 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <atomic> // For std::atomic
+#include <chrono> // For std::chrono::steady_clock
+
+#include "parallel_for.h"
+#include "path_service.h"
+
+namespace toybox
+{
+namespace navigation
+{
+
+PathService::PathService()
+    : map(nullptr), hierarchy(nullptr), jobs(nullptr), slots(nullptr), capacity(0), queue(nullptr), queue_head(0),
+      queue_count(0), pathfinders(nullptr), pathfinder_count(0) {}
+
+PathService::~PathService() {
+    Shutdown();
+}
+
+bool PathService::Init(const GridMap* map, uint32_t max_requests, utils::jobs::JobSystem* jobs,
+                       const HierarchicalGrid* hierarchy) {
+    if (slots || !map || max_requests == 0) return false;
+
+    this->map = map;
+    this->hierarchy = hierarchy;
+    this->jobs = jobs;
+    capacity = max_requests;
+    slots = new Slot[capacity];
+    queue = new uint32_t[capacity];
+    queue_head = 0;
+    queue_count = 0;
+
+    // Hand out low slots first
+    free_slots.Clear();
+    for (uint32_t i = capacity; i > 0; --i) {
+        slots[i - 1].status = PathStatus::Invalid;
+        slots[i - 1].generation = 1;
+        free_slots.PushBack(i - 1);
+    }
+
+    pathfinder_count = jobs ? jobs->ThreadCount() + 1 : 1;
+    pathfinders = new GridPathfinder[pathfinder_count];
+    return true;
+}
+
+void PathService::Shutdown() {
+    delete[] slots;
+    delete[] queue;
+    delete[] pathfinders;
+    slots = nullptr;
+    queue = nullptr;
+    pathfinders = nullptr;
+    capacity = 0;
+    queue_count = 0;
+    pathfinder_count = 0;
+    free_slots.Clear();
+}
+
+PathService::Slot* PathService::Find(PathTicket ticket) const {
+    if (ticket.index >= capacity) return nullptr;
+    Slot* slot = &slots[ticket.index];
+    if (slot->generation != ticket.generation || slot->status == PathStatus::Invalid) return nullptr;
+    return slot;
+}
+
+PathTicket PathService::Submit(const PathRequest& request) {
+    if (free_slots.Empty()) return kNoTicket;
+
+    uint32_t index = free_slots.Back();
+    free_slots.PopBack();
+    Slot& slot = slots[index];
+    slot.request = request;
+    slot.status = PathStatus::Pending;
+    slot.path.Clear();
+
+    queue[(queue_head + queue_count) % capacity] = index;
+    ++queue_count;
+    return PathTicket{ index, slot.generation };
+}
+
+uint32_t PathService::Update(double budget_ms) {
+    if (queue_count == 0) return 0;
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(budget_ms);
+    std::atomic<uint32_t> cursor(0);
+    uint32_t total = queue_count;
+
+    // Every thread pulls the next request until the queue or the budget runs
+    // out. A request taken is always finished, so a frame can overrun by at
+    // most one search per thread.
+    auto work = [this, &cursor, total, deadline](size_t, size_t) {
+        uint32_t thread = jobs ? jobs->CurrentThreadIndex() : 0;
+        GridPathfinder& pathfinder = pathfinders[thread];
+        for (;;) {
+            if (cursor.load(std::memory_order_relaxed) > 0 && std::chrono::steady_clock::now() >= deadline) break;
+            uint32_t i = cursor.fetch_add(1, std::memory_order_relaxed);
+            if (i >= total) break;
+
+            Slot& slot = slots[queue[(queue_head + i) % capacity]];
+            if (slot.status != PathStatus::Pending) continue; // Released while queued
+            const PathRequest& request = slot.request;
+            bool found = pathfinder.FindPath(*map, request.start, request.goal, request.algorithm, &slot.path, hierarchy);
+            slot.status = found ? PathStatus::Found : PathStatus::NotFound;
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, jobs->ThreadCount(), 1, work);
+    } else {
+        work(0, 1);
+    }
+
+    uint32_t taken = cursor.load();
+    if (taken > total) taken = total;
+
+    // Slots released while queued are free once they leave the queue
+    for (uint32_t i = 0; i < taken; ++i) {
+        uint32_t index = queue[(queue_head + i) % capacity];
+        if (slots[index].status == PathStatus::Invalid) free_slots.PushBack(index);
+    }
+    queue_head = (queue_head + taken) % capacity;
+    queue_count -= taken;
+    return taken;
+}
+
+PathStatus PathService::Status(PathTicket ticket) const {
+    Slot* slot = Find(ticket);
+    return slot ? slot->status : PathStatus::Invalid;
+}
+
+const GridCell* PathService::Path(PathTicket ticket, uint32_t* count) const {
+    Slot* slot = Find(ticket);
+    if (!slot || slot->status != PathStatus::Found) {
+        *count = 0;
+        return nullptr;
+    }
+    *count = static_cast<uint32_t>(slot->path.Size());
+    return slot->path.Data();
+}
+
+void PathService::Release(PathTicket ticket) {
+    Slot* slot = Find(ticket);
+    if (!slot) return;
+
+    bool queued = slot->status == PathStatus::Pending;
+    slot->status = PathStatus::Invalid;
+    ++slot->generation;
+    // A queued slot goes back to the free list when Update reaches it
+    if (!queued) free_slots.PushBack(ticket.index);
+}
+
+uint32_t PathService::PendingCount() const {
+    return queue_count;
+}
+
+} // namespace navigation
+} // namespace toybox
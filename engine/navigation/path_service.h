@@ -0,0 +1,115 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint8_t
+
+#include "dynamicarray.h"
+#include "grid_map.h"
+#include "grid_pathfinder.h"
+#include "hierarchical_grid.h"
+#include "job_system.h"
+
+namespace toybox
+{
+namespace navigation
+{
+
+struct PathRequest {
+    GridCell start;
+    GridCell goal;
+    PathAlgorithm algorithm;
+};
+
+struct PathTicket {
+    uint32_t index;
+    uint32_t generation;
+};
+
+constexpr PathTicket kNoTicket = { 0xFFFFFFFF, 0 };
+
+enum class PathStatus : uint8_t {
+    Invalid,  // Unknown or released ticket
+    Pending,  // Queued for a later Update
+    Found,
+    NotFound,
+};
+
+// Queues path requests from many agents and works through them a frame at a
+// time. Update takes requests in submission order and spreads them over the
+// job system's threads, each with its own GridPathfinder, until the queue is
+// empty or the frame's time budget runs out; the rest wait for the next
+// Update.
+//
+// Requests live in a fixed pool of slots. A ticket stays valid, and its path
+// readable, until it is released.
+struct PathService {
+private:
+    struct Slot {
+        PathRequest request;
+        PathStatus status;
+        uint32_t generation;
+        utils::data_structures::DynamicArray<GridCell> path;
+    };
+
+    const GridMap* map;
+    const HierarchicalGrid* hierarchy;
+    utils::jobs::JobSystem* jobs;
+
+    Slot* slots;
+    uint32_t capacity;
+    utils::data_structures::DynamicArray<uint32_t> free_slots;
+
+    // Ring of pending slot indices, oldest first
+    uint32_t* queue;
+    uint32_t queue_head;
+    uint32_t queue_count;
+
+    // One per job system thread, plus one for outside threads
+    GridPathfinder* pathfinders;
+    uint32_t pathfinder_count;
+
+    Slot* Find(PathTicket ticket) const;
+
+public:
+    PathService();
+    ~PathService();
+
+    PathService(const PathService&) = delete;
+    PathService& operator=(const PathService&) = delete;
+
+    // Serve paths on map, holding up to max_requests tickets at once. Requests
+    // run on jobs if given; Hierarchical requests need hierarchy.
+    bool Init(const GridMap* map, uint32_t max_requests, utils::jobs::JobSystem* jobs = nullptr,
+              const HierarchicalGrid* hierarchy = nullptr);
+    void Shutdown();
+
+    // kNoTicket if every slot is taken
+    PathTicket Submit(const PathRequest& request);
+
+    // Runs pending requests until none are left or budget_ms has passed, and
+    // returns how many ran. Always runs at least one, so the queue drains
+    // even when searches take longer than the budget.
+    uint32_t Update(double budget_ms);
+
+    PathStatus Status(PathTicket ticket) const;
+
+    // The found path, start to goal; nullptr unless the status is Found
+    const GridCell* Path(PathTicket ticket, uint32_t* count) const;
+
+    // Frees the ticket's slot. Pending requests are dropped.
+    void Release(PathTicket ticket);
+
+    uint32_t PendingCount() const;
+};
+
+} // namespace navigation
+} // namespace toybox
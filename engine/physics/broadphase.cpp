@@ -0,0 +1,328 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstring> // For memcpy
+
+#include "broadphase.h"
+#include "parallel_for.h"
+
+namespace toybox
+{
+namespace physics
+{
+
+using math::Aabb;
+using math::Vec3;
+using utils::data_structures::DynamicArray;
+
+// The sweep axis only changes when another one spreads this much more, so
+// bodies drifting around the balance point do not force a re-sort every frame
+static const double kAxisSwitchRatio = 1.25;
+
+static float AxisValue(Vec3 v, uint32_t axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// Maps a float to an unsigned integer that sorts the same way
+static uint32_t SortableBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+static uint64_t ProxyKey(const Aabb* bounds, uint32_t id, uint32_t axis) {
+    return (uint64_t(SortableBits(AxisValue(bounds[id].min, axis))) << 32) | id;
+}
+
+// LSD radix sort, a byte per pass. Bytes that are the same in every key are
+// skipped, so small proxy ids and narrow coordinate ranges cost fewer passes.
+static void RadixSortKeys(uint64_t* keys, uint64_t* scratch, size_t count) {
+    if (count < 2) return;
+    size_t histograms[8][256] = {};
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t key = keys[i];
+        for (int b = 0; b < 8; ++b) ++histograms[b][(key >> (b * 8)) & 0xff];
+    }
+
+    uint64_t* source = keys;
+    uint64_t* destination = scratch;
+    for (int b = 0; b < 8; ++b) {
+        size_t* histogram = histograms[b];
+        if (histogram[(source[0] >> (b * 8)) & 0xff] == count) continue;
+        size_t offset = 0;
+        for (int v = 0; v < 256; ++v) {
+            size_t n = histogram[v];
+            histogram[v] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t key = source[i];
+            destination[histogram[(key >> (b * 8)) & 0xff]++] = key;
+        }
+        uint64_t* swap = source;
+        source = destination;
+        destination = swap;
+    }
+    if (source != keys) memcpy(keys, source, count * sizeof(uint64_t));
+}
+
+struct AxisStats {
+    double variance[3]; // Of the box centres
+    double size[3];     // Mean box extent
+    float low[3];
+    float high[3];
+};
+
+static void Measure(const Aabb* bounds, uint32_t count, AxisStats* stats) {
+    double sum[3] = { 0.0, 0.0, 0.0 };
+    double squares[3] = { 0.0, 0.0, 0.0 };
+    double sizes[3] = { 0.0, 0.0, 0.0 };
+    for (int a = 0; a < 3; ++a) {
+        stats->low[a] = AxisValue(bounds[0].min, uint32_t(a));
+        stats->high[a] = AxisValue(bounds[0].max, uint32_t(a));
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        const Aabb& box = bounds[i];
+        for (int a = 0; a < 3; ++a) {
+            float low = AxisValue(box.min, uint32_t(a));
+            float high = AxisValue(box.max, uint32_t(a));
+            double centre = 0.5 * (double(low) + high);
+            sum[a] += centre;
+            squares[a] += centre * centre;
+            sizes[a] += double(high) - low;
+            if (low < stats->low[a]) stats->low[a] = low;
+            if (high > stats->high[a]) stats->high[a] = high;
+        }
+    }
+    for (int a = 0; a < 3; ++a) {
+        double mean = sum[a] / count;
+        stats->variance[a] = squares[a] / count - mean * mean;
+        stats->size[a] = sizes[a] / count;
+    }
+}
+
+SweepAndPrune::SweepAndPrune()
+    : axis(0), stripe_axis(1), cross_axis(2), stripe_count(1), stripe_origin(0.0f), stripe_scale(0.0f), swaps(0),
+      rebuilt(false) {}
+
+uint32_t SweepAndPrune::StripeOf(float value) const {
+    float position = (value - stripe_origin) * stripe_scale;
+    if (!(position > 0.0f)) return 0;
+    uint32_t stripe = uint32_t(position);
+    return stripe < stripe_count ? stripe : stripe_count - 1;
+}
+
+bool SweepAndPrune::ChooseAxes(const Aabb* bounds, uint32_t count) {
+    AxisStats stats;
+    Measure(bounds, count, &stats);
+    uint32_t widest = 0;
+    for (uint32_t a = 1; a < 3; ++a) {
+        if (stats.variance[a] > stats.variance[widest]) widest = a;
+    }
+    bool changed = false;
+    if (stats.variance[widest] > stats.variance[axis] * kAxisSwitchRatio) {
+        changed = widest != axis;
+        axis = widest;
+    }
+
+    // Stripes run across the wider of the other two axes
+    uint32_t first = axis == 0 ? 1 : 0;
+    uint32_t second = axis == 2 ? 1 : 2;
+    stripe_axis = stats.variance[second] > stats.variance[first] ? second : first;
+    cross_axis = stripe_axis == first ? second : first;
+    double extent = double(stats.high[stripe_axis]) - stats.low[stripe_axis];
+    double width = stats.size[stripe_axis] * kStripeWidthInBoxes;
+    stripe_count = 1;
+    if (count >= kStripeMinProxies && width > 0.0 && extent > width) {
+        double stripes = extent / width;
+        stripe_count = stripes < double(kMaxStripes) ? uint32_t(stripes) : kMaxStripes;
+    }
+    stripe_origin = stats.low[stripe_axis];
+    stripe_scale = extent > 0.0 ? float(stripe_count / extent) : 0.0f;
+    return changed;
+}
+
+void SweepAndPrune::Sort(const Aabb* bounds, uint32_t count) {
+    bool fresh = ChooseAxes(bounds, count) || keys.Size() != count;
+
+    swaps = 0;
+    if (!fresh) {
+        // Last frame's order with this frame's values, then fix it up
+        uint64_t* data = keys.Data();
+        for (uint32_t i = 0; i < count; ++i) data[i] = ProxyKey(bounds, uint32_t(data[i]), axis);
+        uint64_t budget = uint64_t(count) * kMaxSwapsPerProxy;
+        uint64_t made = 0;
+        for (uint32_t i = 1; i < count && !fresh; ++i) {
+            uint64_t key = data[i];
+            uint32_t j = i;
+            while (j > 0 && data[j - 1] > key) {
+                data[j] = data[j - 1];
+                --j;
+                if (++made > budget) {
+                    fresh = true;
+                    break;
+                }
+            }
+            data[j] = key;
+        }
+        swaps = uint32_t(made);
+    }
+    if (fresh) {
+        keys.Resize(count);
+        for (uint32_t i = 0; i < count; ++i) keys.Data()[i] = ProxyKey(bounds, i, axis);
+        if (scratch.Size() < count) scratch.Resize(count);
+        RadixSortKeys(keys.Data(), scratch.Data(), count);
+    }
+    rebuilt = fresh;
+}
+
+// A counting sort by stripe that keeps the sweep order within each stripe
+void SweepAndPrune::Distribute(const Aabb* bounds, uint32_t count) {
+    stripe_offsets.Resize(stripe_count + 1);
+    stripe_offsets.Fill(0);
+    uint32_t* offsets = stripe_offsets.Data();
+    for (uint32_t i = 0; i < count; ++i) {
+        const Aabb& box = bounds[uint32_t(keys.Data()[i])];
+        uint32_t last = StripeOf(AxisValue(box.max, stripe_axis));
+        for (uint32_t s = StripeOf(AxisValue(box.min, stripe_axis)); s <= last; ++s) ++offsets[s + 1];
+    }
+    for (uint32_t s = 0; s < stripe_count; ++s) offsets[s + 1] += offsets[s];
+
+    uint32_t total = offsets[stripe_count];
+    stripe_cross.Resize(total);
+    stripe_min.Resize(total);
+    stripe_max.Resize(total);
+    stripe_ids.Resize(total);
+    uint32_t cursor[kMaxStripes];
+    for (uint32_t s = 0; s < stripe_count; ++s) cursor[s] = offsets[s];
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t id = uint32_t(keys.Data()[i]);
+        const Aabb& box = bounds[id];
+        uint32_t last = StripeOf(AxisValue(box.max, stripe_axis));
+        for (uint32_t s = StripeOf(AxisValue(box.min, stripe_axis)); s <= last; ++s) {
+            uint32_t at = cursor[s]++;
+            stripe_cross.Data()[at] = CrossExtent{ AxisValue(box.min, stripe_axis), AxisValue(box.min, cross_axis),
+                                                   AxisValue(box.max, stripe_axis), AxisValue(box.max, cross_axis) };
+            stripe_min.Data()[at] = AxisValue(box.min, axis);
+            stripe_max.Data()[at] = AxisValue(box.max, axis);
+            stripe_ids.Data()[at] = id;
+        }
+    }
+
+    work.Clear();
+    for (uint32_t s = 0; s < stripe_count; ++s) {
+        for (uint32_t begin = offsets[s]; begin < offsets[s + 1]; begin += kSweepChunkSize) {
+            uint32_t end = begin + kSweepChunkSize < offsets[s + 1] ? begin + kSweepChunkSize : offsets[s + 1];
+            work.PushBack(SweepWork{ s, begin, end });
+        }
+    }
+}
+
+void SweepAndPrune::Sweep(const SweepWork& item, DynamicArray<uint64_t>* out) const {
+    const uint32_t last = stripe_offsets.Data()[item.stripe + 1];
+    const CrossExtent* cross = stripe_cross.Data();
+    const float* mins = stripe_min.Data();
+    const uint32_t* ids = stripe_ids.Data();
+    for (uint32_t i = item.begin; i < item.end; ++i) {
+        const CrossExtent box = cross[i];
+        const float limit = stripe_max.Data()[i];
+        const uint32_t id = ids[i];
+        for (uint32_t j = i + 1; j < last && mins[j] <= limit; ++j) {
+            // Non-short-circuit test; which way each compare goes is
+            // unpredictable, so one branch beats four
+            const CrossExtent& other = cross[j];
+            bool overlap = (other.min_b <= box.max_b) & (box.min_b <= other.max_b) & (other.min_c <= box.max_c) &
+                           (box.min_c <= other.max_c);
+            if (!overlap) continue;
+            if (stripe_count > 1) {
+                // Both boxes are in every stripe their overlap spans; the
+                // stripe where it starts reports it
+                float start = box.min_b > other.min_b ? box.min_b : other.min_b;
+                if (StripeOf(start) != item.stripe) continue;
+            }
+            uint32_t other_id = ids[j];
+            out->PushBack(id < other_id ? (uint64_t(id) << 32) | other_id : (uint64_t(other_id) << 32) | id);
+        }
+    }
+}
+
+void SweepAndPrune::Update(const Aabb* bounds, uint32_t count, utils::jobs::JobSystem* jobs) {
+    pair_keys.Clear();
+    pairs.Clear();
+    if (count == 0) {
+        keys.Clear();
+        stripe_count = 1;
+        rebuilt = false;
+        swaps = 0;
+        return;
+    }
+    Sort(bounds, count);
+    Distribute(bounds, count);
+
+    uint32_t items = static_cast<uint32_t>(work.Size());
+    if (jobs && items > 1) {
+        if (work_pairs.Size() < items) work_pairs.Resize(items);
+        utils::jobs::ParallelFor(jobs, 0, items, 1, [this](size_t begin, size_t end) {
+            for (size_t w = begin; w < end; ++w) {
+                DynamicArray<uint64_t>& out = work_pairs.Data()[w];
+                out.Clear();
+                Sweep(work.Data()[w], &out);
+            }
+        });
+        size_t total = 0;
+        for (uint32_t w = 0; w < items; ++w) total += work_pairs.Data()[w].Size();
+        pair_keys.Resize(total);
+        uint64_t* write = pair_keys.Data();
+        for (uint32_t w = 0; w < items; ++w) {
+            const DynamicArray<uint64_t>& found = work_pairs.Data()[w];
+            if (found.Size() == 0) continue;
+            memcpy(write, found.Data(), found.Size() * sizeof(uint64_t));
+            write += found.Size();
+        }
+    } else {
+        for (uint32_t w = 0; w < items; ++w) Sweep(work.Data()[w], &pair_keys);
+    }
+
+    size_t found = pair_keys.Size();
+    if (scratch.Size() < found) scratch.Resize(found);
+    RadixSortKeys(pair_keys.Data(), scratch.Data(), found);
+    pairs.Resize(found);
+    for (size_t i = 0; i < found; ++i) {
+        uint64_t key = pair_keys.Data()[i];
+        pairs.Data()[i] = BroadphasePair{ uint32_t(key >> 32), uint32_t(key) };
+    }
+}
+
+const BroadphasePair* SweepAndPrune::Pairs() const {
+    return pairs.Data();
+}
+
+uint32_t SweepAndPrune::PairCount() const {
+    return static_cast<uint32_t>(pairs.Size());
+}
+
+uint32_t SweepAndPrune::Axis() const {
+    return axis;
+}
+
+uint32_t SweepAndPrune::StripeCount() const {
+    return stripe_count;
+}
+
+bool SweepAndPrune::Rebuilt() const {
+    return rebuilt;
+}
+
+uint32_t SweepAndPrune::SwapCount() const {
+    return swaps;
+}
+
+} // namespace physics
+} // namespace toybox
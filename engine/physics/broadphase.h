@@ -0,0 +1,132 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint64_t
+
+#include "dynamicarray.h"
+#include "geometry.h"
+#include "job_system.h"
+
+namespace toybox
+{
+namespace physics
+{
+
+// Two proxies whose bounds overlap, with a < b
+struct BroadphasePair {
+    uint32_t a;
+    uint32_t b;
+};
+
+// Proxies per work item when sweeping on the job system
+constexpr uint32_t kSweepChunkSize = 2048;
+
+// Insertion sort gives up and re-sorts from scratch past this many swaps
+// per proxy
+constexpr uint32_t kMaxSwapsPerProxy = 8;
+
+// Stripes are about this many average boxes wide, and there are at most
+// kMaxStripes of them. Fewer proxies than kStripeMinProxies use one stripe.
+constexpr float kStripeWidthInBoxes = 2.0f;
+constexpr uint32_t kMaxStripes = 64;
+constexpr uint32_t kStripeMinProxies = 1024;
+
+// Sweep and prune along one axis. Proxies are sorted by their minimum on
+// the axis along which their centres spread the most, and each one is
+// tested only against those that start before it ends.
+//
+// Between updates the previous order is kept and fixed up with an insertion
+// sort, which is close to linear while things move a little per frame. Ties
+// are broken by proxy id, so the order, and with it the output, depends
+// only on the bounds passed in.
+//
+// A single sweep still tests every box against everything overlapping it on
+// the sweep axis alone, which grows quadratically in dense scenes. Large
+// scenes are therefore cut into stripes along a second axis: each proxy is
+// copied, still in sweep order, into every stripe it touches, stripes are
+// swept independently (and in parallel), and a pair is only reported by the
+// stripe where its overlap begins. Pairs come out sorted by (a, b) however
+// many threads swept them.
+struct SweepAndPrune {
+private:
+    // A proxy's extent on the two axes other than the sweep axis, stripe_axis
+    // first. The sweep loop already checks the sweep axis.
+    struct CrossExtent {
+        float min_b;
+        float min_c;
+        float max_b;
+        float max_c;
+    };
+
+    struct SweepWork {
+        uint32_t stripe;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // Sortable minimum on the sweep axis in the high half, proxy id in the low
+    utils::data_structures::DynamicArray<uint64_t> keys;
+    utils::data_structures::DynamicArray<uint64_t> scratch;
+
+    // Proxies per stripe in sweep order, stripe by stripe
+    utils::data_structures::DynamicArray<CrossExtent> stripe_cross;
+    utils::data_structures::DynamicArray<float> stripe_min;
+    utils::data_structures::DynamicArray<float> stripe_max;
+    utils::data_structures::DynamicArray<uint32_t> stripe_ids;
+    utils::data_structures::DynamicArray<uint32_t> stripe_offsets; // stripe_count + 1 entries
+
+    utils::data_structures::DynamicArray<SweepWork> work;
+    utils::data_structures::DynamicArray<utils::data_structures::DynamicArray<uint64_t>> work_pairs;
+    utils::data_structures::DynamicArray<uint64_t> pair_keys;
+    utils::data_structures::DynamicArray<BroadphasePair> pairs;
+
+    uint32_t axis;
+    uint32_t stripe_axis;
+    uint32_t cross_axis; // Neither axis nor stripe_axis
+    uint32_t stripe_count;
+    float stripe_origin;
+    float stripe_scale; // Stripes per unit along stripe_axis
+    uint32_t swaps;
+    bool rebuilt;
+
+    uint32_t StripeOf(float value) const;
+    bool ChooseAxes(const math::Aabb* bounds, uint32_t count);
+    void Sort(const math::Aabb* bounds, uint32_t count);
+    void Distribute(const math::Aabb* bounds, uint32_t count);
+    void Sweep(const SweepWork& item, utils::data_structures::DynamicArray<uint64_t>* out) const;
+
+public:
+    SweepAndPrune();
+
+    SweepAndPrune(const SweepAndPrune&) = delete;
+    SweepAndPrune& operator=(const SweepAndPrune&) = delete;
+
+    // Finds every overlapping pair among bounds[0, count); the index into
+    // bounds is the proxy id. Boxes that only touch count as overlapping.
+    // With a job system, the sweep is split into work items.
+    void Update(const math::Aabb* bounds, uint32_t count, utils::jobs::JobSystem* jobs = nullptr);
+
+    const BroadphasePair* Pairs() const;
+    uint32_t PairCount() const;
+
+    // Sweep axis (0 = x, 1 = y, 2 = z) and stripes of the last Update
+    uint32_t Axis() const;
+    uint32_t StripeCount() const;
+
+    // Whether the last Update sorted from scratch, and how many swaps its
+    // insertion sort made otherwise
+    bool Rebuilt() const;
+    uint32_t SwapCount() const;
+};
+
+} // namespace physics
+} // namespace toybox
@@ -0,0 +1,121 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "islands.h"
+
+namespace toybox
+{
+namespace physics
+{
+
+ContactIslands::ContactIslands()
+    : island_count(0) {}
+
+uint32_t ContactIslands::Find(uint32_t slot) {
+    uint32_t* parent = parents.Data();
+    while (parent[slot] != slot) {
+        // Path halving
+        parent[slot] = parent[parent[slot]];
+        slot = parent[slot];
+    }
+    return slot;
+}
+
+void ContactIslands::Build(const Contact* contact_list, uint32_t contact_count, const uint8_t* linking,
+                           uint32_t slot_count) {
+    parents.Resize(slot_count);
+    islands.Resize(slot_count);
+    islands.Fill(kNoIsland);
+    for (uint32_t slot = 0; slot < slot_count; ++slot) parents.Data()[slot] = slot;
+
+    // The lower root wins, so each set's root is its lowest slot
+    for (uint32_t c = 0; c < contact_count; ++c) {
+        uint32_t a = contact_list[c].a, b = contact_list[c].b;
+        if (!linking[a] || !linking[b]) continue;
+        uint32_t root_a = Find(a), root_b = Find(b);
+        if (root_a < root_b) parents.Data()[root_b] = root_a;
+        else if (root_b < root_a) parents.Data()[root_a] = root_b;
+    }
+
+    // Mark the linking bodies that touch anything
+    for (uint32_t c = 0; c < contact_count; ++c) {
+        uint32_t a = contact_list[c].a, b = contact_list[c].b;
+        if (linking[a]) islands.Data()[a] = 0;
+        if (linking[b]) islands.Data()[b] = 0;
+    }
+
+    // Ascending slots meet every root before the rest of its set
+    island_count = 0;
+    body_offsets.Clear();
+    body_offsets.PushBack(0);
+    for (uint32_t slot = 0; slot < slot_count; ++slot) {
+        if (islands.Data()[slot] == kNoIsland) continue;
+        uint32_t root = Find(slot);
+        if (root == slot) {
+            islands.Data()[slot] = island_count++;
+            body_offsets.PushBack(0);
+        } else {
+            islands.Data()[slot] = islands.Data()[root];
+        }
+        ++body_offsets.Data()[islands.Data()[slot] + 1];
+    }
+    for (uint32_t i = 0; i < island_count; ++i) body_offsets.Data()[i + 1] += body_offsets.Data()[i];
+
+    bodies.Resize(body_offsets.Data()[island_count]);
+    contact_offsets.Resize(island_count + 1);
+    contact_offsets.Fill(0);
+    cursor.Resize(island_count);
+    for (uint32_t i = 0; i < island_count; ++i) cursor.Data()[i] = body_offsets.Data()[i];
+    for (uint32_t slot = 0; slot < slot_count; ++slot) {
+        uint32_t island = islands.Data()[slot];
+        if (island != kNoIsland) bodies.Data()[cursor.Data()[island]++] = slot;
+    }
+
+    for (uint32_t c = 0; c < contact_count; ++c) {
+        uint32_t a = contact_list[c].a;
+        uint32_t island = linking[a] ? islands.Data()[a] : islands.Data()[contact_list[c].b];
+        if (island != kNoIsland) ++contact_offsets.Data()[island + 1];
+    }
+    for (uint32_t i = 0; i < island_count; ++i) contact_offsets.Data()[i + 1] += contact_offsets.Data()[i];
+    contacts.Resize(contact_offsets.Data()[island_count]);
+    for (uint32_t i = 0; i < island_count; ++i) cursor.Data()[i] = contact_offsets.Data()[i];
+    for (uint32_t c = 0; c < contact_count; ++c) {
+        uint32_t a = contact_list[c].a;
+        uint32_t island = linking[a] ? islands.Data()[a] : islands.Data()[contact_list[c].b];
+        if (island != kNoIsland) contacts.Data()[cursor.Data()[island]++] = c;
+    }
+}
+
+uint32_t ContactIslands::Count() const {
+    return island_count;
+}
+
+uint32_t ContactIslands::IslandOf(uint32_t slot) const {
+    return slot < islands.Size() ? islands.Data()[slot] : kNoIsland;
+}
+
+uint32_t ContactIslands::BodyCount(uint32_t island) const {
+    return body_offsets.Data()[island + 1] - body_offsets.Data()[island];
+}
+
+const uint32_t* ContactIslands::Bodies(uint32_t island) const {
+    return bodies.Data() + body_offsets.Data()[island];
+}
+
+uint32_t ContactIslands::ContactCount(uint32_t island) const {
+    return contact_offsets.Data()[island + 1] - contact_offsets.Data()[island];
+}
+
+const uint32_t* ContactIslands::Contacts(uint32_t island) const {
+    return contacts.Data() + contact_offsets.Data()[island];
+}
+
+} // namespace physics
+} // namespace toybox
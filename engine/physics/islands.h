@@ -0,0 +1,79 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t
+
+#include "dynamicarray.h"
+#include "vector.h"
+
+namespace toybox
+{
+namespace physics
+{
+
+// Two bodies, by slot, pressing into each other along normal (from a to b)
+struct Contact {
+    uint32_t a;
+    uint32_t b;
+    math::Vec3 normal;
+    float depth;
+    float normal_impulse;        // Accumulated over solver iterations
+    math::Vec3 friction_impulse; // Accumulated over solver iterations
+};
+
+constexpr uint32_t kNoIsland = 0xFFFFFFFF;
+
+// Groups bodies that touch, directly or through others, into islands that can
+// be solved independently. A union-find over the contacts joins the bodies
+// marked as linking; the others (static and kinematic bodies, which nothing
+// pushes around) belong to no island, so a crate on the ground does not join
+// every other crate on the ground into one island. A contact belongs to the
+// island of its linking body.
+//
+// Islands are numbered by their lowest slot, list their bodies in ascending
+// slot order and their contacts in the order given, so the same contacts
+// always give the same islands.
+struct ContactIslands {
+private:
+    utils::data_structures::DynamicArray<uint32_t> parents; // Union-find forest by slot
+    utils::data_structures::DynamicArray<uint32_t> islands; // Island by slot, or kNoIsland
+    utils::data_structures::DynamicArray<uint32_t> body_offsets;
+    utils::data_structures::DynamicArray<uint32_t> bodies;
+    utils::data_structures::DynamicArray<uint32_t> contact_offsets;
+    utils::data_structures::DynamicArray<uint32_t> contacts; // Indices into the contacts given to Build
+    utils::data_structures::DynamicArray<uint32_t> cursor;
+    uint32_t island_count;
+
+    uint32_t Find(uint32_t slot);
+
+public:
+    ContactIslands();
+
+    ContactIslands(const ContactIslands&) = delete;
+    ContactIslands& operator=(const ContactIslands&) = delete;
+
+    // linking[slot] is nonzero for bodies that join islands; slots are below
+    // slot_count. Contacts between two non-linking bodies are ignored.
+    void Build(const Contact* contact_list, uint32_t contact_count, const uint8_t* linking, uint32_t slot_count);
+
+    uint32_t Count() const;
+    uint32_t IslandOf(uint32_t slot) const;
+
+    uint32_t BodyCount(uint32_t island) const;
+    const uint32_t* Bodies(uint32_t island) const;
+
+    uint32_t ContactCount(uint32_t island) const;
+    const uint32_t* Contacts(uint32_t island) const;
+};
+
+} // namespace physics
+} // namespace toybox
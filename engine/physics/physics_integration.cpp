@@ -0,0 +1,631 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cmath> // For fabsf, fmodf, sqrtf
+
+#include "parallel_for.h"
+#include "physics_integration.h"
+
+namespace toybox
+{
+namespace physics
+{
+
+using math::Quat;
+using math::Vec3;
+using utils::data_structures::DynamicArray;
+
+// Awake bodies per chunk when integrating on the job system
+static const size_t kIntegrateGrain = 1024;
+
+// Pairs per chunk when finding contacts, and islands per chunk when solving
+static const size_t kContactGrain = 1024;
+static const size_t kIslandGrain = 32;
+
+// Velocity passes over each island's contacts per step
+static const uint32_t kSolverIterations = 8;
+
+// Penetration left alone so resting contacts persist, and the share of the
+// rest pushed apart each step
+static const float kContactSlop = 0.01f;
+static const float kPositionCorrection = 0.8f;
+
+static const float kFriction = 0.5f;
+
+static bool SamePose(Vec3 position, Quat rotation, const scene::Transform& pose) {
+    return position == pose.position && rotation.x == pose.rotation.x && rotation.y == pose.rotation.y &&
+           rotation.z == pose.rotation.z && rotation.w == pose.rotation.w;
+}
+
+// World bounds of a rotated box: each axis extent is the half extents
+// through the absolute rotation matrix
+static math::Aabb BoxBounds(Vec3 position, Quat rotation, Vec3 half) {
+    Vec3 x = math::Rotate(rotation, Vec3{ 1.0f, 0.0f, 0.0f });
+    Vec3 y = math::Rotate(rotation, Vec3{ 0.0f, 1.0f, 0.0f });
+    Vec3 z = math::Rotate(rotation, Vec3{ 0.0f, 0.0f, 1.0f });
+    Vec3 extent{ fabsf(x.x) * half.x + fabsf(y.x) * half.y + fabsf(z.x) * half.z,
+                 fabsf(x.y) * half.x + fabsf(y.y) * half.y + fabsf(z.y) * half.z,
+                 fabsf(x.z) * half.x + fabsf(y.z) * half.y + fabsf(z.z) * half.z };
+    return math::Aabb{ position - extent, position + extent };
+}
+
+static void RemoveSlot(DynamicArray<uint32_t>& list, uint32_t slot) {
+    for (size_t i = 0; i < list.Size(); ++i) {
+        if (list.Data()[i] == slot) {
+            list.Data()[i] = list.Back();
+            list.PopBack();
+            return;
+        }
+    }
+}
+
+FixedTimestep::FixedTimestep(float step, uint32_t max_steps)
+    : step(step), accumulator(0.0f), max_steps(max_steps) {}
+
+uint32_t FixedTimestep::Accumulate(float frame_time) {
+    if (frame_time > 0.0f) accumulator += frame_time;
+    uint32_t steps = 0;
+    while (accumulator >= step && steps < max_steps) {
+        accumulator -= step;
+        ++steps;
+    }
+    // Drop the backlog but keep the phase, so interpolation does not jump
+    if (accumulator >= step) accumulator = fmodf(accumulator, step);
+    return steps;
+}
+
+float FixedTimestep::Alpha() const {
+    return accumulator / step;
+}
+
+float FixedTimestep::Step() const {
+    return step;
+}
+
+void FixedTimestep::Reset() {
+    accumulator = 0.0f;
+}
+
+PhysicsWorld::PhysicsWorld(float step)
+    : timestep(step), gravity(Vec3{ 0.0f, -9.81f, 0.0f }), body_count(0), step_count(0) {}
+
+bool PhysicsWorld::Valid(PhysicsBody body) const {
+    return body.index < generations.Size() && (flags.Data()[body.index] & kAlive) &&
+           generations.Data()[body.index] == body.generation;
+}
+
+void PhysicsWorld::Wake(uint32_t slot) {
+    if (types.Data()[slot] == BodyType::Static) return;
+    sleep_timers.Data()[slot] = 0.0f;
+    if (flags.Data()[slot] & kAwake) return;
+    flags.Data()[slot] |= kAwake;
+    awake.PushBack(slot);
+}
+
+void PhysicsWorld::MarkChanged(uint32_t slot) {
+    if (flags.Data()[slot] & kChanged) return;
+    flags.Data()[slot] |= kChanged;
+    changed.PushBack(slot);
+}
+
+PhysicsBody PhysicsWorld::Create(const BodyDesc& desc) {
+    uint32_t slot;
+    if (!free_slots.Empty()) {
+        slot = free_slots.Back();
+        free_slots.PopBack();
+    } else {
+        slot = static_cast<uint32_t>(generations.Size());
+        positions.PushBack(Vec3{ 0.0f, 0.0f, 0.0f });
+        rotations.PushBack(math::QuatIdentity());
+        previous_positions.PushBack(Vec3{ 0.0f, 0.0f, 0.0f });
+        previous_rotations.PushBack(math::QuatIdentity());
+        render_positions.PushBack(Vec3{ 0.0f, 0.0f, 0.0f });
+        render_rotations.PushBack(math::QuatIdentity());
+        linear_velocities.PushBack(Vec3{ 0.0f, 0.0f, 0.0f });
+        angular_velocities.PushBack(Vec3{ 0.0f, 0.0f, 0.0f });
+        half_extents.PushBack(Vec3{ 0.0f, 0.0f, 0.0f });
+        bounds.PushBack(math::Aabb{ Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 0.0f, 0.0f } });
+        inverse_masses.PushBack(0.0f);
+        sleep_timers.PushBack(0.0f);
+        user_data.PushBack(0);
+        generations.PushBack(1);
+        types.PushBack(BodyType::Static);
+        flags.PushBack(0);
+        dynamic.PushBack(0);
+    }
+
+    positions.Data()[slot] = desc.position;
+    rotations.Data()[slot] = desc.rotation;
+    previous_positions.Data()[slot] = desc.position;
+    previous_rotations.Data()[slot] = desc.rotation;
+    render_positions.Data()[slot] = desc.position;
+    render_rotations.Data()[slot] = desc.rotation;
+    bool moves = desc.type != BodyType::Static;
+    linear_velocities.Data()[slot] = moves ? desc.linear_velocity : Vec3{ 0.0f, 0.0f, 0.0f };
+    angular_velocities.Data()[slot] = moves ? desc.angular_velocity : Vec3{ 0.0f, 0.0f, 0.0f };
+    half_extents.Data()[slot] = desc.half_extents;
+    bounds.Data()[slot] = BoxBounds(desc.position, desc.rotation, desc.half_extents);
+    inverse_masses.Data()[slot] = desc.type == BodyType::Dynamic && desc.mass > 0.0f ? 1.0f / desc.mass : 0.0f;
+    user_data.Data()[slot] = desc.user_data;
+    types.Data()[slot] = desc.type;
+    dynamic.Data()[slot] = desc.type == BodyType::Dynamic;
+    flags.Data()[slot] = kAlive;
+    Wake(slot);
+    ++body_count;
+    return PhysicsBody{ slot, generations.Data()[slot] };
+}
+
+void PhysicsWorld::Destroy(PhysicsBody body) {
+    if (!Valid(body)) return;
+    uint32_t slot = body.index;
+    uint8_t state = flags.Data()[slot];
+    if (state & kAwake) RemoveSlot(awake, slot);
+    if (state & kMoved) RemoveSlot(moved, slot);
+    if (state & kChanged) RemoveSlot(changed, slot);
+    flags.Data()[slot] = 0;
+    ++generations.Data()[slot];
+    free_slots.PushBack(slot);
+    --body_count;
+}
+
+bool PhysicsWorld::Alive(PhysicsBody body) const {
+    return Valid(body);
+}
+
+uint32_t PhysicsWorld::Count() const {
+    return body_count;
+}
+
+void PhysicsWorld::SetGravity(Vec3 value) {
+    gravity = value;
+}
+
+void PhysicsWorld::SetPoses(const PhysicsBody* bodies, const scene::Transform* poses, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!Valid(bodies[i])) continue;
+        uint32_t slot = bodies[i].index;
+        const scene::Transform& pose = poses[i];
+        // Transforms written back by a sync hold the render pose
+        if (SamePose(positions.Data()[slot], rotations.Data()[slot], pose) ||
+            SamePose(render_positions.Data()[slot], render_rotations.Data()[slot], pose)) {
+            continue;
+        }
+
+        positions.Data()[slot] = pose.position;
+        rotations.Data()[slot] = pose.rotation;
+        previous_positions.Data()[slot] = pose.position;
+        previous_rotations.Data()[slot] = pose.rotation;
+        render_positions.Data()[slot] = pose.position;
+        render_rotations.Data()[slot] = pose.rotation;
+        bounds.Data()[slot] = BoxBounds(pose.position, pose.rotation, half_extents.Data()[slot]);
+        MarkChanged(slot);
+        Wake(slot);
+    }
+}
+
+void PhysicsWorld::SetVelocity(PhysicsBody body, Vec3 linear, Vec3 angular) {
+    if (!Valid(body) || types.Data()[body.index] == BodyType::Static) return;
+    linear_velocities.Data()[body.index] = linear;
+    angular_velocities.Data()[body.index] = angular;
+    Wake(body.index);
+}
+
+Vec3 PhysicsWorld::Position(PhysicsBody body) const {
+    return Valid(body) ? positions.Data()[body.index] : Vec3{ 0.0f, 0.0f, 0.0f };
+}
+
+Quat PhysicsWorld::Rotation(PhysicsBody body) const {
+    return Valid(body) ? rotations.Data()[body.index] : math::QuatIdentity();
+}
+
+Vec3 PhysicsWorld::LinearVelocity(PhysicsBody body) const {
+    return Valid(body) ? linear_velocities.Data()[body.index] : Vec3{ 0.0f, 0.0f, 0.0f };
+}
+
+Vec3 PhysicsWorld::AngularVelocity(PhysicsBody body) const {
+    return Valid(body) ? angular_velocities.Data()[body.index] : Vec3{ 0.0f, 0.0f, 0.0f };
+}
+
+math::Aabb PhysicsWorld::Bounds(PhysicsBody body) const {
+    return Valid(body) ? bounds.Data()[body.index] : math::Aabb{ Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 0.0f, 0.0f } };
+}
+
+Vec3 PhysicsWorld::RenderPosition(PhysicsBody body) const {
+    return Valid(body) ? render_positions.Data()[body.index] : Vec3{ 0.0f, 0.0f, 0.0f };
+}
+
+Quat PhysicsWorld::RenderRotation(PhysicsBody body) const {
+    return Valid(body) ? render_rotations.Data()[body.index] : math::QuatIdentity();
+}
+
+bool PhysicsWorld::Awake(PhysicsBody body) const {
+    return Valid(body) && (flags.Data()[body.index] & kAwake);
+}
+
+uint64_t PhysicsWorld::UserData(PhysicsBody body) const {
+    return Valid(body) ? user_data.Data()[body.index] : 0;
+}
+
+// Semi-implicit Euler over moved[begin, end). Each body only touches its own
+// slot, so chunks can run in any order on any thread.
+void PhysicsWorld::Integrate(uint32_t begin, uint32_t end) {
+    const float dt = timestep.Step();
+    for (uint32_t i = begin; i < end; ++i) {
+        uint32_t slot = moved.Data()[i];
+        Vec3 linear = linear_velocities.Data()[slot];
+        Vec3 angular = angular_velocities.Data()[slot];
+        if (types.Data()[slot] == BodyType::Dynamic) linear = linear + gravity * dt;
+
+        Vec3 position = positions.Data()[slot] + linear * dt;
+        // q' = q + dt/2 * (w, 0) q
+        Quat q = rotations.Data()[slot];
+        Quat spin = math::Quat{ angular.x, angular.y, angular.z, 0.0f } * q;
+        float half = dt * 0.5f;
+        q = math::Normalize(Quat{ q.x + spin.x * half, q.y + spin.y * half, q.z + spin.z * half, q.w + spin.w * half });
+        positions.Data()[slot] = position;
+        rotations.Data()[slot] = q;
+        bounds.Data()[slot] = BoxBounds(position, q, half_extents.Data()[slot]);
+        linear_velocities.Data()[slot] = linear;
+    }
+}
+
+void PhysicsWorld::Step(utils::jobs::JobSystem* jobs) {
+    // The pose before the last step is no longer needed once it is over
+    for (size_t i = 0; i < moved.Size(); ++i) {
+        uint32_t slot = moved.Data()[i];
+        previous_positions.Data()[slot] = positions.Data()[slot];
+        previous_rotations.Data()[slot] = rotations.Data()[slot];
+        flags.Data()[slot] &= ~kMoved;
+    }
+    moved.Clear();
+    for (size_t i = 0; i < awake.Size(); ++i) {
+        uint32_t slot = awake.Data()[i];
+        flags.Data()[slot] |= kMoved;
+        moved.PushBack(slot);
+        MarkChanged(slot);
+    }
+
+    uint32_t count = static_cast<uint32_t>(moved.Size());
+    if (jobs && count > kIntegrateGrain) {
+        utils::jobs::ParallelFor(jobs, 0, count, kIntegrateGrain, [this](size_t begin, size_t end) {
+            Integrate(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+        });
+    } else {
+        Integrate(0, count);
+    }
+
+    UpdateBroadphase(jobs);
+    BuildIslands(jobs);
+
+    // Waking islands may have added to moved
+    count = static_cast<uint32_t>(moved.Size());
+    if (jobs && count > kIntegrateGrain) {
+        utils::jobs::ParallelFor(jobs, 0, count, kIntegrateGrain, [this](size_t begin, size_t end) {
+            UpdateSleepTimers(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+        });
+    } else {
+        UpdateSleepTimers(0, count);
+    }
+    island_ready.Resize(islands.Count());
+    for (uint32_t island = 0; island < islands.Count(); ++island) {
+        const uint32_t* members = islands.Bodies(island);
+        uint8_t ready = 1;
+        for (uint32_t i = 0; i < islands.BodyCount(island) && ready; ++i) {
+            ready = sleep_timers.Data()[members[i]] >= kSleepDelay;
+        }
+        island_ready.Data()[island] = ready;
+    }
+    if (jobs && count > kIntegrateGrain) {
+        utils::jobs::ParallelFor(jobs, 0, count, kIntegrateGrain, [this](size_t begin, size_t end) {
+            Sleep(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+        });
+    } else {
+        Sleep(0, count);
+    }
+
+    // Bodies that fell asleep stay in moved until their previous pose catches up
+    awake.Clear();
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t slot = moved.Data()[i];
+        if (flags.Data()[slot] & kAwake) awake.PushBack(slot);
+    }
+    ++step_count;
+}
+
+void PhysicsWorld::UpdateBroadphase(utils::jobs::JobSystem* jobs) {
+    proxy_slots.Clear();
+    proxy_bounds.Clear();
+    for (uint32_t slot = 0; slot < generations.Size(); ++slot) {
+        if (!(flags.Data()[slot] & kAlive)) continue;
+        proxy_slots.PushBack(slot);
+        proxy_bounds.PushBack(bounds.Data()[slot]);
+    }
+    broadphase.Update(proxy_bounds.Data(), static_cast<uint32_t>(proxy_slots.Size()), jobs);
+
+    // Proxies ascend with their slots, so the pairs stay in (a, b) order
+    pairs.Clear();
+    const BroadphasePair* found = broadphase.Pairs();
+    for (uint32_t i = 0; i < broadphase.PairCount(); ++i) {
+        uint32_t a = proxy_slots.Data()[found[i].a];
+        uint32_t b = proxy_slots.Data()[found[i].b];
+        bool dynamic_pair = dynamic.Data()[a] || dynamic.Data()[b];
+        bool awake_pair = (flags.Data()[a] & kAwake) || (flags.Data()[b] & kAwake);
+        if (dynamic_pair && awake_pair) pairs.PushBack(BroadphasePair{ a, b });
+    }
+}
+
+// Writes the contact between two overlapping boxes' bounds, pushing them
+// apart along the axis they overlap least on. Returns false if they only touch.
+static bool BoundsContact(const math::Aabb& a, const math::Aabb& b, Vec3 centre_a, Vec3 centre_b, Contact* out) {
+    Vec3 overlap = math::Min(a.max, b.max) - math::Max(a.min, b.min);
+    if (overlap.x <= 0.0f || overlap.y <= 0.0f || overlap.z <= 0.0f) return false;
+    Vec3 apart = centre_b - centre_a;
+    if (overlap.x <= overlap.y && overlap.x <= overlap.z) {
+        out->normal = Vec3{ apart.x < 0.0f ? -1.0f : 1.0f, 0.0f, 0.0f };
+        out->depth = overlap.x;
+    } else if (overlap.y <= overlap.z) {
+        out->normal = Vec3{ 0.0f, apart.y < 0.0f ? -1.0f : 1.0f, 0.0f };
+        out->depth = overlap.y;
+    } else {
+        out->normal = Vec3{ 0.0f, 0.0f, apart.z < 0.0f ? -1.0f : 1.0f };
+        out->depth = overlap.z;
+    }
+    return true;
+}
+
+void PhysicsWorld::FindContacts(uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+        uint32_t a = pairs.Data()[i].a, b = pairs.Data()[i].b;
+        Contact& contact = contacts.Data()[i];
+        contact.a = a;
+        contact.b = b;
+        contact.normal_impulse = 0.0f;
+        contact.friction_impulse = Vec3{ 0.0f, 0.0f, 0.0f };
+        if (!BoundsContact(bounds.Data()[a], bounds.Data()[b], positions.Data()[a], positions.Data()[b], &contact)) {
+            contact.depth = 0.0f;
+        }
+    }
+}
+
+void PhysicsWorld::BuildIslands(utils::jobs::JobSystem* jobs) {
+    // Narrowphase on the bounds, in pair order
+    uint32_t pair_count = static_cast<uint32_t>(pairs.Size());
+    contacts.Resize(pair_count);
+    if (jobs && pair_count > kContactGrain) {
+        utils::jobs::ParallelFor(jobs, 0, pair_count, kContactGrain, [this](size_t begin, size_t end) {
+            FindContacts(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+        });
+    } else {
+        FindContacts(0, pair_count);
+    }
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < pair_count; ++i) {
+        if (contacts.Data()[i].depth > 0.0f) contacts.Data()[kept++] = contacts.Data()[i];
+    }
+    contacts.Resize(kept);
+
+    islands.Build(contacts.Data(), kept, dynamic.Data(), static_cast<uint32_t>(generations.Size()));
+
+    // A body touched by an awake one wakes, and with it its whole island
+    for (uint32_t island = 0; island < islands.Count(); ++island) {
+        const uint32_t* members = islands.Bodies(island);
+        for (uint32_t i = 0; i < islands.BodyCount(island); ++i) {
+            uint32_t slot = members[i];
+            if (flags.Data()[slot] & kAwake) continue;
+            Wake(slot);
+            flags.Data()[slot] |= kMoved;
+            moved.PushBack(slot);
+            MarkChanged(slot);
+        }
+    }
+
+    uint32_t island_count = islands.Count();
+    if (jobs && island_count > kIslandGrain) {
+        utils::jobs::ParallelFor(jobs, 0, island_count, kIslandGrain, [this](size_t begin, size_t end) {
+            SolveIslands(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+        });
+    } else {
+        SolveIslands(0, island_count);
+    }
+}
+
+// Sequential impulses on linear velocity only: bounds contacts carry no
+// contact point to turn about. Only dynamic bodies are written, and each
+// belongs to one island, so islands never write to the same body.
+void PhysicsWorld::SolveIslands(uint32_t begin, uint32_t end) {
+    for (uint32_t island = begin; island < end; ++island) {
+        const uint32_t* list = islands.Contacts(island);
+        const uint32_t contact_count = islands.ContactCount(island);
+        for (uint32_t iteration = 0; iteration < kSolverIterations; ++iteration) {
+            for (uint32_t c = 0; c < contact_count; ++c) {
+                Contact& contact = contacts.Data()[list[c]];
+                float inverse_a = inverse_masses.Data()[contact.a];
+                float inverse_b = inverse_masses.Data()[contact.b];
+                float total = inverse_a + inverse_b;
+                if (total <= 0.0f) continue;
+                Vec3 velocity_a = linear_velocities.Data()[contact.a];
+                Vec3 velocity_b = linear_velocities.Data()[contact.b];
+
+                // Stop the bodies closing, never pull them together
+                float closing = math::Dot(velocity_b - velocity_a, contact.normal);
+                float accumulated = contact.normal_impulse - closing / total;
+                if (accumulated < 0.0f) accumulated = 0.0f;
+                Vec3 push = contact.normal * (accumulated - contact.normal_impulse);
+                contact.normal_impulse = accumulated;
+                velocity_a = velocity_a - push * inverse_a;
+                velocity_b = velocity_b + push * inverse_b;
+
+                // Friction opposes sliding, up to kFriction times the push
+                Vec3 relative = velocity_b - velocity_a;
+                Vec3 sliding = relative - contact.normal * math::Dot(relative, contact.normal);
+                Vec3 friction = contact.friction_impulse - sliding * (1.0f / total);
+                float limit = kFriction * contact.normal_impulse;
+                float length_squared = math::LengthSquared(friction);
+                if (length_squared > limit * limit) friction = friction * (limit / sqrtf(length_squared));
+                Vec3 drag = friction - contact.friction_impulse;
+                contact.friction_impulse = friction;
+                velocity_a = velocity_a - drag * inverse_a;
+                velocity_b = velocity_b + drag * inverse_b;
+
+                if (dynamic.Data()[contact.a]) linear_velocities.Data()[contact.a] = velocity_a;
+                if (dynamic.Data()[contact.b]) linear_velocities.Data()[contact.b] = velocity_b;
+            }
+        }
+
+        // Depths are measured again as earlier contacts push bodies out, so
+        // a body on two contacts is not pushed twice as far. Bounds move with
+        // their bodies.
+        for (uint32_t c = 0; c < contact_count; ++c) {
+            const Contact& contact = contacts.Data()[list[c]];
+            float inverse_a = inverse_masses.Data()[contact.a];
+            float inverse_b = inverse_masses.Data()[contact.b];
+            float total = inverse_a + inverse_b;
+            if (total <= 0.0f) continue;
+            math::Aabb& box_a = bounds.Data()[contact.a];
+            math::Aabb& box_b = bounds.Data()[contact.b];
+            Vec3 overlap = math::Min(box_a.max, box_b.max) - math::Max(box_a.min, box_b.min);
+            float excess = math::Dot(overlap, contact.normal * contact.normal) - kContactSlop;
+            if (excess <= 0.0f) continue;
+            Vec3 shift = contact.normal * (excess * kPositionCorrection / total);
+            if (dynamic.Data()[contact.a]) {
+                Vec3 move = shift * -inverse_a;
+                positions.Data()[contact.a] = positions.Data()[contact.a] + move;
+                box_a = math::Aabb{ box_a.min + move, box_a.max + move };
+            }
+            if (dynamic.Data()[contact.b]) {
+                Vec3 move = shift * inverse_b;
+                positions.Data()[contact.b] = positions.Data()[contact.b] + move;
+                box_b = math::Aabb{ box_b.min + move, box_b.max + move };
+            }
+        }
+    }
+}
+
+void PhysicsWorld::UpdateSleepTimers(uint32_t begin, uint32_t end) {
+    const float linear_limit = kSleepLinearSpeed * kSleepLinearSpeed;
+    const float angular_limit = kSleepAngularSpeed * kSleepAngularSpeed;
+    for (uint32_t i = begin; i < end; ++i) {
+        uint32_t slot = moved.Data()[i];
+        if (!(flags.Data()[slot] & kAwake)) continue;
+        bool slow = math::LengthSquared(linear_velocities.Data()[slot]) < linear_limit &&
+                    math::LengthSquared(angular_velocities.Data()[slot]) < angular_limit;
+        sleep_timers.Data()[slot] = slow ? sleep_timers.Data()[slot] + timestep.Step() : 0.0f;
+    }
+}
+
+// Bodies in an island sleep together, once every one of them has been slow
+// for long enough; the rest go on their own timer
+void PhysicsWorld::Sleep(uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+        uint32_t slot = moved.Data()[i];
+        if (!(flags.Data()[slot] & kAwake)) continue;
+        uint32_t island = islands.IslandOf(slot);
+        bool ready = island != kNoIsland ? island_ready.Data()[island] != 0 : sleep_timers.Data()[slot] >= kSleepDelay;
+        if (!ready) continue;
+        flags.Data()[slot] &= ~kAwake;
+        linear_velocities.Data()[slot] = Vec3{ 0.0f, 0.0f, 0.0f };
+        angular_velocities.Data()[slot] = Vec3{ 0.0f, 0.0f, 0.0f };
+    }
+}
+
+void PhysicsWorld::Interpolate(float alpha) {
+    for (size_t i = 0; i < changed.Size(); ++i) {
+        uint32_t slot = changed.Data()[i];
+        render_positions.Data()[slot] = math::Lerp(previous_positions.Data()[slot], positions.Data()[slot], alpha);
+        render_rotations.Data()[slot] = math::Slerp(previous_rotations.Data()[slot], rotations.Data()[slot], alpha);
+    }
+}
+
+uint32_t PhysicsWorld::Advance(float frame_time, utils::jobs::JobSystem* jobs) {
+    for (size_t i = 0; i < changed.Size(); ++i) flags.Data()[changed.Data()[i]] &= ~kChanged;
+    changed.Clear();
+    // Still between two poses, so their render pose moves with the new alpha
+    for (size_t i = 0; i < moved.Size(); ++i) MarkChanged(moved.Data()[i]);
+
+    uint32_t steps = timestep.Accumulate(frame_time);
+    for (uint32_t s = 0; s < steps; ++s) Step(jobs);
+    Interpolate(timestep.Alpha());
+    return steps;
+}
+
+uint32_t PhysicsWorld::ChangedCount() const {
+    return static_cast<uint32_t>(changed.Size());
+}
+
+const uint32_t* PhysicsWorld::ChangedSlots() const {
+    return changed.Data();
+}
+
+void PhysicsWorld::ReadChangedPoses(scene::Transform* poses) const {
+    for (size_t i = 0; i < changed.Size(); ++i) {
+        uint32_t slot = changed.Data()[i];
+        poses[i] = scene::Transform{ render_positions.Data()[slot], render_rotations.Data()[slot],
+                                     Vec3{ 1.0f, 1.0f, 1.0f } };
+    }
+}
+
+const BroadphasePair* PhysicsWorld::Pairs() const {
+    return pairs.Data();
+}
+
+uint32_t PhysicsWorld::PairCount() const {
+    return static_cast<uint32_t>(pairs.Size());
+}
+
+const SweepAndPrune& PhysicsWorld::Broadphase() const {
+    return broadphase;
+}
+
+uint32_t PhysicsWorld::ContactCount() const {
+    return static_cast<uint32_t>(contacts.Size());
+}
+
+const Contact* PhysicsWorld::Contacts() const {
+    return contacts.Data();
+}
+
+const ContactIslands& PhysicsWorld::Islands() const {
+    return islands;
+}
+
+PhysicsBody PhysicsWorld::BodyAt(uint32_t slot) const {
+    return PhysicsBody{ slot, generations.Data()[slot] };
+}
+
+uint64_t PhysicsWorld::UserDataAt(uint32_t slot) const {
+    return user_data.Data()[slot];
+}
+
+const Vec3* PhysicsWorld::RenderPositions() const {
+    return render_positions.Data();
+}
+
+const Quat* PhysicsWorld::RenderRotations() const {
+    return render_rotations.Data();
+}
+
+float PhysicsWorld::Alpha() const {
+    return timestep.Alpha();
+}
+
+float PhysicsWorld::Timestep() const {
+    return timestep.Step();
+}
+
+uint32_t PhysicsWorld::AwakeCount() const {
+    return static_cast<uint32_t>(awake.Size());
+}
+
+uint64_t PhysicsWorld::StepCount() const {
+    return step_count;
+}
+
+} // namespace physics
+} // namespace toybox
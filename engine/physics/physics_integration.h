@@ -0,0 +1,260 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint64_t, uint8_t
+
+#include "broadphase.h"
+#include "dynamicarray.h"
+#include "geometry.h"
+#include "islands.h"
+#include "job_system.h"
+#include "quaternion.h"
+#include "transform_hierarchy.h"
+#include "vector.h"
+
+namespace toybox
+{
+namespace physics
+{
+
+struct PhysicsBody {
+    uint32_t index;
+    uint32_t generation;
+
+    bool operator==(const PhysicsBody& other) const {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const PhysicsBody& other) const {
+        return !(*this == other);
+    }
+};
+
+constexpr PhysicsBody kNoBody = { 0xFFFFFFFF, 0 };
+
+enum class BodyType : uint8_t {
+    Static,    // Never moves
+    Kinematic, // Moves by its velocity only, unaffected by gravity
+    Dynamic,
+};
+
+struct BodyDesc {
+    BodyType type;
+    math::Vec3 position;
+    math::Quat rotation;
+    math::Vec3 linear_velocity;
+    math::Vec3 angular_velocity;
+    float mass;               // Ignored unless Dynamic
+    math::Vec3 half_extents;  // Collision box
+    uint64_t user_data;       // Handed back untouched, e.g. the owning Toy
+};
+
+inline BodyDesc BodyDescDefault() {
+    return BodyDesc{ BodyType::Dynamic,
+                     math::Vec3{ 0.0f, 0.0f, 0.0f },
+                     math::QuatIdentity(),
+                     math::Vec3{ 0.0f, 0.0f, 0.0f },
+                     math::Vec3{ 0.0f, 0.0f, 0.0f },
+                     1.0f,
+                     math::Vec3{ 0.5f, 0.5f, 0.5f },
+                     0 };
+}
+
+constexpr float kDefaultTimestep = 1.0f / 60.0f;
+
+// Steps run per frame at most before the remaining time is dropped
+constexpr uint32_t kMaxStepsPerFrame = 8;
+
+// Bodies slower than these for kSleepDelay seconds go to sleep
+constexpr float kSleepLinearSpeed = 0.05f;
+constexpr float kSleepAngularSpeed = 0.05f;
+constexpr float kSleepDelay = 0.5f;
+
+// Turns variable frame times into a whole number of fixed steps. Whatever is
+// left over carries to the next frame and, divided by the step, is how far
+// the present lies between the last two steps.
+struct FixedTimestep {
+private:
+    float step;
+    float accumulator;
+    uint32_t max_steps;
+
+public:
+    explicit FixedTimestep(float step = kDefaultTimestep, uint32_t max_steps = kMaxStepsPerFrame);
+
+    // Adds a frame's time and returns how many steps to run now. Time that
+    // would need more than max_steps is dropped, so one long frame cannot
+    // make the next ones longer still.
+    uint32_t Accumulate(float frame_time);
+
+    // Fraction of a step accumulated but not yet run, in [0, 1)
+    float Alpha() const;
+
+    float Step() const;
+    void Reset();
+};
+
+// Rigid bodies in flat arrays indexed by slot, stepped at a fixed rate.
+// Only awake bodies are integrated, and each Advance records which slots
+// changed so syncing out costs nothing for bodies at rest. Bodies are
+// integrated here rather than by Phyzzy, whose submodule is not checked out
+// in this tree; there is no API of its to build against yet.
+//
+// Each step ends with a sweep-and-prune pass over every body's bounds. The
+// pairs it finds that press into each other become contacts, and the dynamic
+// bodies they connect are grouped into islands. Islands share no dynamic
+// body, so they are solved on worker threads with no ordering between them
+// to leak into the result; each is solved in a fixed order, and stepping
+// gives the same bits on any number of threads. Islands fall asleep, and
+// are woken, as a whole. Sleeping islands produce no pairs and are never
+// built or solved.
+//
+// Every body keeps its pose before and after the last step. Advance blends
+// the two by the accumulator's leftover into a render pose, so motion looks
+// smooth at any frame rate while the simulation itself always takes the
+// same steps.
+struct PhysicsWorld {
+private:
+    static constexpr uint8_t kAlive = 1 << 0;
+    static constexpr uint8_t kAwake = 1 << 1;
+    static constexpr uint8_t kMoved = 1 << 2;   // In moved
+    static constexpr uint8_t kChanged = 1 << 3; // In changed
+
+    // Indexed by slot, which is also the body handle's index
+    utils::data_structures::DynamicArray<math::Vec3> positions;
+    utils::data_structures::DynamicArray<math::Quat> rotations;
+    utils::data_structures::DynamicArray<math::Vec3> previous_positions;
+    utils::data_structures::DynamicArray<math::Quat> previous_rotations;
+    utils::data_structures::DynamicArray<math::Vec3> render_positions;
+    utils::data_structures::DynamicArray<math::Quat> render_rotations;
+    utils::data_structures::DynamicArray<math::Vec3> linear_velocities;
+    utils::data_structures::DynamicArray<math::Vec3> angular_velocities;
+    utils::data_structures::DynamicArray<math::Vec3> half_extents;
+    utils::data_structures::DynamicArray<math::Aabb> bounds;
+    utils::data_structures::DynamicArray<float> inverse_masses;
+    utils::data_structures::DynamicArray<float> sleep_timers;
+    utils::data_structures::DynamicArray<uint64_t> user_data;
+    utils::data_structures::DynamicArray<uint32_t> generations;
+    utils::data_structures::DynamicArray<BodyType> types;
+    utils::data_structures::DynamicArray<uint8_t> flags;
+    utils::data_structures::DynamicArray<uint32_t> free_slots;
+
+    utils::data_structures::DynamicArray<uint32_t> awake;   // Integrated by the next step
+    utils::data_structures::DynamicArray<uint32_t> moved;   // Integrated by the last step
+    utils::data_structures::DynamicArray<uint32_t> changed; // Pose or render pose changed this Advance
+
+    // Broadphase proxies are the alive slots in ascending order
+    SweepAndPrune broadphase;
+    utils::data_structures::DynamicArray<uint32_t> proxy_slots;
+    utils::data_structures::DynamicArray<math::Aabb> proxy_bounds;
+    utils::data_structures::DynamicArray<BroadphasePair> pairs;
+
+    utils::data_structures::DynamicArray<uint8_t> dynamic; // By slot, whether islands link through it
+    utils::data_structures::DynamicArray<Contact> contacts;
+    utils::data_structures::DynamicArray<uint8_t> island_ready; // By island, whether all of it can sleep
+    ContactIslands islands;
+
+    FixedTimestep timestep;
+    math::Vec3 gravity;
+    uint32_t body_count;
+    uint64_t step_count;
+
+    bool Valid(PhysicsBody body) const;
+    void Wake(uint32_t slot);
+    void MarkChanged(uint32_t slot);
+    void Integrate(uint32_t begin, uint32_t end);
+    void UpdateBroadphase(utils::jobs::JobSystem* jobs);
+    void FindContacts(uint32_t begin, uint32_t end);
+    void BuildIslands(utils::jobs::JobSystem* jobs);
+    void SolveIslands(uint32_t begin, uint32_t end);
+    void UpdateSleepTimers(uint32_t begin, uint32_t end);
+    void Sleep(uint32_t begin, uint32_t end);
+    void Interpolate(float alpha);
+
+public:
+    explicit PhysicsWorld(float step = kDefaultTimestep);
+
+    PhysicsWorld(const PhysicsWorld&) = delete;
+    PhysicsWorld& operator=(const PhysicsWorld&) = delete;
+
+    PhysicsBody Create(const BodyDesc& desc);
+    void Destroy(PhysicsBody body);
+    bool Alive(PhysicsBody body) const;
+    uint32_t Count() const;
+
+    void SetGravity(math::Vec3 value);
+
+    // Moves bodies to the given poses; scale is ignored. Poses equal to the
+    // body's current or render pose are skipped, so passing a whole block of
+    // transforms of which a few changed costs a compare for the rest. A
+    // moved body teleports: its render pose jumps too, and dynamic bodies
+    // wake up.
+    void SetPoses(const PhysicsBody* bodies, const scene::Transform* poses, uint32_t count);
+
+    // Wakes the body
+    void SetVelocity(PhysicsBody body, math::Vec3 linear, math::Vec3 angular);
+
+    math::Vec3 Position(PhysicsBody body) const;
+    math::Quat Rotation(PhysicsBody body) const;
+    math::Vec3 LinearVelocity(PhysicsBody body) const;
+    math::Vec3 AngularVelocity(PhysicsBody body) const;
+    math::Aabb Bounds(PhysicsBody body) const;
+    math::Vec3 RenderPosition(PhysicsBody body) const;
+    math::Quat RenderRotation(PhysicsBody body) const;
+    bool Awake(PhysicsBody body) const;
+    uint64_t UserData(PhysicsBody body) const;
+
+    // Runs the steps frame_time adds up to, then updates the render poses of
+    // changed bodies. Pass a job system to integrate and solve large steps in
+    // parallel; the results are the same either way. Returns the number of
+    // steps run.
+    uint32_t Advance(float frame_time, utils::jobs::JobSystem* jobs = nullptr);
+
+    // Runs one fixed step right away, outside the accumulator
+    void Step(utils::jobs::JobSystem* jobs = nullptr);
+
+    // Slots whose pose or render pose changed in the last Advance
+    uint32_t ChangedCount() const;
+    const uint32_t* ChangedSlots() const;
+
+    // Copies the render pose of each changed slot to poses, in ChangedSlots
+    // order and with unit scale
+    void ReadChangedPoses(scene::Transform* poses) const;
+
+    // Bodies whose bounds overlapped after the last step, as slots with
+    // a < b in ascending order. Pairs that cannot respond to a contact,
+    // where neither body is dynamic or neither is awake, are left out.
+    const BroadphasePair* Pairs() const;
+    uint32_t PairCount() const;
+    const SweepAndPrune& Broadphase() const;
+
+    // Contacts and islands solved by the last step. A contact's a and b are
+    // slots, and its normal points from a to b.
+    uint32_t ContactCount() const;
+    const Contact* Contacts() const;
+    const ContactIslands& Islands() const;
+
+    PhysicsBody BodyAt(uint32_t slot) const;
+    uint64_t UserDataAt(uint32_t slot) const;
+
+    // Render poses by slot, valid for alive slots
+    const math::Vec3* RenderPositions() const;
+    const math::Quat* RenderRotations() const;
+
+    float Alpha() const;
+    float Timestep() const;
+    uint32_t AwakeCount() const;
+    uint64_t StepCount() const;
+};
+
+} // namespace physics
+} // namespace toybox
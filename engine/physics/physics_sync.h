@@ -0,0 +1,74 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint64_t
+
+#include "dynamicarray.h"
+#include "job_system.h"
+#include "physics_integration.h"
+#include "transform_hierarchy.h"
+#include "world.h"
+
+namespace toybox
+{
+namespace physics
+{
+
+// A body's user data when it is owned by a Toy
+inline uint64_t UserDataFromToy(ecs::Toy toy) {
+    return (uint64_t(toy.generation) << 32) | toy.index;
+}
+
+inline ecs::Toy ToyFromUserData(uint64_t value) {
+    return ecs::Toy{ uint32_t(value), uint32_t(value >> 32) };
+}
+
+// Keeps Toys holding a PhysicsBody Part and a scene::Transform Part in step
+// with their bodies. Both Parts must be packed. Bodies are expected to carry
+// UserDataFromToy(toy) as their user data.
+//
+// Push reads the Transform columns of blocks written since the last sync in
+// place and hands them to the physics world as they are; nothing is staged
+// and untouched blocks are not visited. Pull writes back only the bodies the
+// last Advance changed and ends the Work Push began, so the next Push does
+// not mistake those writes for game edits.
+template<typename Registry>
+struct PhysicsSync {
+private:
+    ecs::WorkClock clock;
+    utils::data_structures::DynamicArray<scene::Transform> poses;
+    uint32_t pushed_blocks;
+    uint32_t pulled;
+
+public:
+    PhysicsSync();
+
+    // Teleports bodies whose Transform was written since the last Push
+    void Push(ecs::World<Registry>& world, PhysicsWorld& physics);
+
+    // Copies render poses back to the Transforms of changed bodies, keeping
+    // each Transform's scale
+    void Pull(ecs::World<Registry>& world, const PhysicsWorld& physics);
+
+    // Push, Advance and Pull. Returns the number of steps run.
+    uint32_t Run(ecs::World<Registry>& world, PhysicsWorld& physics, float frame_time,
+                 utils::jobs::JobSystem* jobs = nullptr);
+
+    // Blocks the last Push visited and Transforms the last Pull wrote
+    uint32_t PushedBlocks() const;
+    uint32_t PulledCount() const;
+};
+
+} // namespace physics
+} // namespace toybox
+
+#include "physics_sync.inl"
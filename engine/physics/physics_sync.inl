@@ -0,0 +1,73 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+namespace toybox
+{
+namespace physics
+{
+
+template<typename Registry>
+PhysicsSync<Registry>::PhysicsSync() : pushed_blocks(0), pulled(0) {}
+
+template<typename Registry>
+void PhysicsSync<Registry>::Push(ecs::World<Registry>& world, PhysicsWorld& physics) {
+    uint32_t since = world.BeginWork(&clock);
+    uint32_t blocks = 0;
+    world.template EachBlock<const PhysicsBody, const scene::Transform>(
+        ecs::Changed<scene::Transform>{ since },
+        [&physics, &blocks](uint32_t count, const ecs::Toy*, const PhysicsBody* bodies,
+                            const scene::Transform* transforms) {
+            physics.SetPoses(bodies, transforms, count);
+            ++blocks;
+        });
+    pushed_blocks = blocks;
+}
+
+template<typename Registry>
+void PhysicsSync<Registry>::Pull(ecs::World<Registry>& world, const PhysicsWorld& physics) {
+    uint32_t count = physics.ChangedCount();
+    poses.Resize(count);
+    physics.ReadChangedPoses(poses.Data());
+
+    const uint32_t* slots = physics.ChangedSlots();
+    pulled = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        ecs::Toy toy = ToyFromUserData(physics.UserDataAt(slots[i]));
+        scene::Transform* transform = world.template Write<scene::Transform>(toy);
+        if (!transform) continue;
+        transform->position = poses.Data()[i].position;
+        transform->rotation = poses.Data()[i].rotation;
+        ++pulled;
+    }
+    // Ends the run Push began, so the next Push only finds game edits
+    world.EndWork(&clock);
+}
+
+template<typename Registry>
+uint32_t PhysicsSync<Registry>::Run(ecs::World<Registry>& world, PhysicsWorld& physics, float frame_time,
+                                    utils::jobs::JobSystem* jobs) {
+    Push(world, physics);
+    uint32_t steps = physics.Advance(frame_time, jobs);
+    Pull(world, physics);
+    return steps;
+}
+
+template<typename Registry>
+uint32_t PhysicsSync<Registry>::PushedBlocks() const {
+    return pushed_blocks;
+}
+
+template<typename Registry>
+uint32_t PhysicsSync<Registry>::PulledCount() const {
+    return pulled;
+}
+
+} // namespace physics
+} // namespace toybox
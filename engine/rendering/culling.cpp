@@ -0,0 +1,172 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstring> // For memmove
+
+#include "culling.h"
+#include "lanes.h"
+#include "parallel_for.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+using math::Aabb;
+using math::Frustum;
+using math::Vec3;
+using utils::data_structures::DynamicArray;
+
+// Tests L::kWidth objects per iteration against all six planes and appends
+// the survivors' indices. The append is branch free: every lane writes its
+// index and only visible lanes move the output on.
+template<typename L>
+static uint32_t FrustumCullLanes(const Frustum& frustum, const CullBounds& bounds, uint32_t i, uint32_t end,
+                                 uint32_t* visible, uint32_t* written) {
+    typedef typename L::Value V;
+    V normal_x[6], normal_y[6], normal_z[6], offset[6];
+    V abs_x[6], abs_y[6], abs_z[6];
+    for (int p = 0; p < 6; ++p) {
+        const math::Plane& plane = frustum.planes[p];
+        normal_x[p] = L::Set(plane.normal.x);
+        normal_y[p] = L::Set(plane.normal.y);
+        normal_z[p] = L::Set(plane.normal.z);
+        offset[p] = L::Set(plane.d);
+        abs_x[p] = L::Abs(normal_x[p]);
+        abs_y[p] = L::Abs(normal_y[p]);
+        abs_z[p] = L::Abs(normal_z[p]);
+    }
+    V zero = L::Set(0.0f);
+
+    uint32_t count = *written;
+    for (; i + L::kWidth <= end; i += static_cast<uint32_t>(L::kWidth)) {
+        V cx = L::Load(bounds.center_x + i);
+        V cy = L::Load(bounds.center_y + i);
+        V cz = L::Load(bounds.center_z + i);
+        V ex = L::Load(bounds.extent_x + i);
+        V ey = L::Load(bounds.extent_y + i);
+        V ez = L::Load(bounds.extent_z + i);
+        V radius = L::Load(bounds.radius + i);
+
+        int outside = 0;
+        for (int p = 0; p < 6; ++p) {
+            V distance = L::Add(L::Add(L::Add(L::Mul(normal_x[p], cx), L::Mul(normal_y[p], cy)),
+                                       L::Mul(normal_z[p], cz)),
+                                offset[p]);
+            // The box's projected radius on the plane normal, or the sphere's
+            // if that is smaller; either shape being outside is enough
+            V box = L::Add(L::Add(L::Mul(abs_x[p], ex), L::Mul(abs_y[p], ey)), L::Mul(abs_z[p], ez));
+            V reach = L::Min(radius, box);
+            outside |= L::LessMask(distance, L::Sub(zero, reach));
+        }
+
+        for (uint32_t lane = 0; lane < L::kWidth; ++lane) {
+            visible[count] = i + lane;
+            count += ((outside >> lane) & 1) ^ 1;
+        }
+    }
+    *written = count;
+    return i;
+}
+
+uint32_t FrustumCull(const Frustum& frustum, const CullBounds& bounds, uint32_t begin, uint32_t end,
+                     uint32_t* visible) {
+    uint32_t written = 0;
+    uint32_t i = begin;
+#if defined(TOYBOX_MATH_AVX2)
+    i = FrustumCullLanes<math::Avx2Lanes>(frustum, bounds, i, end, visible, &written);
+#endif
+#if defined(TOYBOX_MATH_SSE4)
+    i = FrustumCullLanes<math::Sse4Lanes>(frustum, bounds, i, end, visible, &written);
+#endif
+    FrustumCullLanes<math::ScalarLanes>(frustum, bounds, i, end, visible, &written);
+    return written;
+}
+
+namespace scalar
+{
+
+uint32_t FrustumCull(const Frustum& frustum, const CullBounds& bounds, uint32_t begin, uint32_t end,
+                     uint32_t* visible) {
+    uint32_t written = 0;
+    FrustumCullLanes<math::ScalarLanes>(frustum, bounds, begin, end, visible, &written);
+    return written;
+}
+
+} // namespace scalar
+
+CullingStage::CullingStage() : stats{ 0, 0, 0 } {}
+
+// Runs chunk_fn(begin, end, out) over chunks of [0, count), each writing its
+// results to its own stretch of scratch, then packs the results into out
+template<typename Fn>
+uint32_t CullingStage::RunChunked(uint32_t count, uint32_t* out, utils::jobs::JobSystem* jobs, const Fn& chunk_fn) {
+    uint32_t chunks = (count + kCullChunkSize - 1) / kCullChunkSize;
+    scratch.Resize(count);
+    chunk_counts.Resize(chunks);
+    uint32_t* results = scratch.Data();
+    uint32_t* counts = chunk_counts.Data();
+
+    auto body = [count, results, counts, &chunk_fn](size_t first, size_t last) {
+        for (size_t c = first; c < last; ++c) {
+            uint32_t begin = static_cast<uint32_t>(c) * kCullChunkSize;
+            uint32_t end = begin + kCullChunkSize < count ? begin + kCullChunkSize : count;
+            counts[c] = chunk_fn(begin, end, results + begin);
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, chunks, 1, body);
+    } else {
+        body(0, chunks);
+    }
+
+    uint32_t written = 0;
+    for (uint32_t c = 0; c < chunks; ++c) {
+        memmove(out + written, results + c * kCullChunkSize, sizeof(uint32_t) * counts[c]);
+        written += counts[c];
+    }
+    return written;
+}
+
+void CullingStage::Run(const math::Mat4& view_projection, const CullBounds& bounds, uint32_t count,
+                       DynamicArray<uint32_t>* visible, utils::jobs::JobSystem* jobs,
+                       const OcclusionBuffer* occlusion) {
+    Frustum frustum = math::FrustumFromMatrix(view_projection);
+    visible->Resize(count);
+    uint32_t written = RunChunked(count, visible->Data(), jobs, [&frustum, &bounds](uint32_t begin, uint32_t end, uint32_t* out) {
+        return FrustumCull(frustum, bounds, begin, end, out);
+    });
+    stats.tested = count;
+    stats.in_frustum = written;
+
+    if (occlusion) {
+        const uint32_t* candidates = visible->Data();
+        written = RunChunked(written, visible->Data(), jobs,
+                             [candidates, &bounds, occlusion](uint32_t begin, uint32_t end, uint32_t* out) {
+            uint32_t kept = 0;
+            for (uint32_t i = begin; i < end; ++i) {
+                uint32_t object = candidates[i];
+                Vec3 center{ bounds.center_x[object], bounds.center_y[object], bounds.center_z[object] };
+                Vec3 extent{ bounds.extent_x[object], bounds.extent_y[object], bounds.extent_z[object] };
+                if (occlusion->IsVisible(Aabb{ center - extent, center + extent })) out[kept++] = object;
+            }
+            return kept;
+        });
+    }
+    stats.visible = written;
+    visible->Resize(written);
+}
+
+const CullingStats& CullingStage::Stats() const {
+    return stats;
+}
+
+} // namespace rendering
+} // namespace toybox
@@ -0,0 +1,93 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t
+
+#include "dynamicarray.h"
+#include "geometry.h"
+#include "job_system.h"
+#include "matrix.h"
+#include "occlusion_buffer.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+// World bounds of every object in struct-of-arrays form: an axis-aligned box
+// as centre and half extents, and a bounding sphere around the same centre.
+// Objects are culled if either shape is outside, so a sphere radius tighter
+// than the box helps; a radius of FLT_MAX leaves the box alone.
+struct CullBounds {
+    const float* center_x;
+    const float* center_y;
+    const float* center_z;
+    const float* extent_x;
+    const float* extent_y;
+    const float* extent_z;
+    const float* radius;
+};
+
+// Writes the indices in [begin, end) of objects at least partly inside the
+// frustum to visible, in increasing order, and returns how many. visible
+// needs room for end - begin indices.
+uint32_t FrustumCull(const math::Frustum& frustum, const CullBounds& bounds, uint32_t begin, uint32_t end,
+                     uint32_t* visible);
+
+// The same test one object at a time, for checking the SIMD path
+namespace scalar
+{
+
+uint32_t FrustumCull(const math::Frustum& frustum, const CullBounds& bounds, uint32_t begin, uint32_t end,
+                     uint32_t* visible);
+
+} // namespace scalar
+
+// Objects per job in the parallel passes
+constexpr uint32_t kCullChunkSize = 4096;
+
+struct CullingStats {
+    uint32_t tested;
+    uint32_t in_frustum;
+    uint32_t visible;
+};
+
+// Renderer-independent visibility for one view. Objects are tested against
+// the frustum, then optionally against an occlusion buffer holding this
+// frame's occluders, and the survivors come out as a compact list of object
+// indices in increasing order. Both passes are split across the job system
+// when one is given.
+struct CullingStage {
+private:
+    utils::data_structures::DynamicArray<uint32_t> scratch;
+    utils::data_structures::DynamicArray<uint32_t> chunk_counts;
+    CullingStats stats;
+
+    template<typename Fn>
+    uint32_t RunChunked(uint32_t count, uint32_t* out, utils::jobs::JobSystem* jobs, const Fn& chunk_fn);
+
+public:
+    CullingStage();
+
+    // Replaces visible with the indices of the visible objects among the
+    // first count. The occlusion buffer, if any, must have been finished for
+    // the same view_projection.
+    void Run(const math::Mat4& view_projection, const CullBounds& bounds, uint32_t count,
+             utils::data_structures::DynamicArray<uint32_t>* visible, utils::jobs::JobSystem* jobs = nullptr,
+             const OcclusionBuffer* occlusion = nullptr);
+
+    // Counts from the last Run
+    const CullingStats& Stats() const;
+};
+
+} // namespace rendering
+} // namespace toybox
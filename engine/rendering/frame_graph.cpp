@@ -0,0 +1,310 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstdlib> // For abort
+
+#include "frame_graph.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+static const uint32_t kNone = 0xffffffffu;
+
+static uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static bool LifetimesOverlap(uint32_t first_a, uint32_t last_a, uint32_t first_b, uint32_t last_b) {
+    return first_a <= last_b && first_b <= last_a;
+}
+
+FrameGraph::FrameGraph() : transient_size(0), unaliased_size(0) {}
+
+void FrameGraph::Reset() {
+    resources.Clear();
+    passes.Clear();
+    accesses.Clear();
+    barriers.Clear();
+    order.Clear();
+    transient_size = 0;
+    unaliased_size = 0;
+}
+
+FrameResource FrameGraph::CreateTransient(const char* name, const FrameResourceDesc& desc) {
+    uint64_t height = desc.kind == FrameResourceKind::Buffer ? 1 : desc.height;
+    uint64_t size = AlignUp(uint64_t(desc.width) * height * desc.bytes_per_element, kTransientAlignment);
+    resources.PushBack(Resource{ name, desc, ResourceState::Undefined, false, size, 0, kNone, kNone, kNoFrameResource });
+    return static_cast<FrameResource>(resources.Size() - 1);
+}
+
+FrameResource FrameGraph::Import(const char* name, const FrameResourceDesc& desc, ResourceState initial_state) {
+    resources.PushBack(Resource{ name, desc, initial_state, true, 0, 0, kNone, kNone, kNoFrameResource });
+    return static_cast<FrameResource>(resources.Size() - 1);
+}
+
+FramePass FrameGraph::AddPass(const char* name, bool side_effects) {
+    uint32_t first = static_cast<uint32_t>(accesses.Size());
+    passes.PushBack(Pass{ name, side_effects, false, first, 0, 0, 0 });
+    return static_cast<FramePass>(passes.Size() - 1);
+}
+
+void FrameGraph::AddAccess(FramePass pass, FrameResource resource, ResourceState state, bool write) {
+    // Accesses of a pass are stored together, so only the newest pass takes
+    // more of them
+    if (pass + 1 != passes.Size() || resource >= resources.Size()) abort();
+    accesses.PushBack(Access{ resource, state, write, kNone });
+    ++passes.Data()[pass].access_count;
+}
+
+void FrameGraph::Read(FramePass pass, FrameResource resource, ResourceState state) {
+    AddAccess(pass, resource, state, false);
+}
+
+void FrameGraph::Write(FramePass pass, FrameResource resource, ResourceState state) {
+    AddAccess(pass, resource, state, true);
+}
+
+void FrameGraph::Compile() {
+    FindProducers();
+    CullPasses();
+    ComputeLifetimes();
+    PlaceResources();
+    BuildBarriers();
+}
+
+// Links every access to the pass that last wrote its resource before it
+void FrameGraph::FindProducers() {
+    last_writer.Resize(resources.Size());
+    last_writer.Fill(kNone);
+    uint32_t* writers = last_writer.Data();
+    Access* all = accesses.Data();
+    for (uint32_t p = 0; p < passes.Size(); ++p) {
+        const Pass& pass = passes.Data()[p];
+        for (uint32_t a = pass.first_access; a < pass.first_access + pass.access_count; ++a) {
+            all[a].producer = writers[all[a].resource];
+        }
+        for (uint32_t a = pass.first_access; a < pass.first_access + pass.access_count; ++a) {
+            if (all[a].write) writers[all[a].resource] = p;
+        }
+    }
+}
+
+// Producers always come before their readers, so one walk from the last
+// pass back to the first finds everything the kept passes need
+void FrameGraph::CullPasses() {
+    Pass* all = passes.Data();
+    const Access* uses = accesses.Data();
+    for (uint32_t p = 0; p < passes.Size(); ++p) {
+        bool root = all[p].side_effects;
+        for (uint32_t a = all[p].first_access; a < all[p].first_access + all[p].access_count; ++a) {
+            if (uses[a].write && resources.Data()[uses[a].resource].imported) root = true;
+        }
+        all[p].culled = !root;
+    }
+    for (uint32_t p = static_cast<uint32_t>(passes.Size()); p-- > 0;) {
+        if (all[p].culled) continue;
+        for (uint32_t a = all[p].first_access; a < all[p].first_access + all[p].access_count; ++a) {
+            if (!uses[a].write && uses[a].producer != kNone) all[uses[a].producer].culled = false;
+        }
+    }
+}
+
+void FrameGraph::ComputeLifetimes() {
+    order.Clear();
+    for (uint32_t r = 0; r < resources.Size(); ++r) {
+        resources.Data()[r].first_use = kNone;
+        resources.Data()[r].last_use = kNone;
+    }
+    for (uint32_t p = 0; p < passes.Size(); ++p) {
+        const Pass& pass = passes.Data()[p];
+        if (pass.culled) continue;
+        uint32_t step = static_cast<uint32_t>(order.Size());
+        order.PushBack(p);
+        for (uint32_t a = pass.first_access; a < pass.first_access + pass.access_count; ++a) {
+            Resource& resource = resources.Data()[accesses.Data()[a].resource];
+            if (resource.first_use == kNone) resource.first_use = step;
+            resource.last_use = step;
+        }
+    }
+}
+
+// Largest first, each at the lowest offset clear of every resource already
+// placed whose lifetime overlaps its own
+void FrameGraph::PlaceResources() {
+    Resource* all = resources.Data();
+    by_size.Clear();
+    unaliased_size = 0;
+    for (uint32_t r = 0; r < resources.Size(); ++r) {
+        all[r].offset = 0;
+        all[r].aliases = kNoFrameResource;
+        if (all[r].imported || all[r].first_use == kNone) continue;
+        unaliased_size += all[r].size;
+
+        // Insertion sort by size, larger first, then by index
+        by_size.PushBack(r);
+        FrameResource* sorted = by_size.Data();
+        for (size_t i = by_size.Size() - 1; i > 0 && all[sorted[i - 1]].size < all[r].size; --i) {
+            sorted[i] = sorted[i - 1];
+            sorted[i - 1] = r;
+        }
+    }
+
+    transient_size = 0;
+    placed.Clear();
+    for (uint32_t i = 0; i < by_size.Size(); ++i) {
+        Resource& resource = all[by_size.Data()[i]];
+
+        // Address ranges of placed resources alive at the same time, sorted
+        // by offset as [offset, end) pairs
+        ranges.Clear();
+        for (uint32_t j = 0; j < placed.Size(); ++j) {
+            const Resource& other = all[placed.Data()[j]];
+            if (!LifetimesOverlap(resource.first_use, resource.last_use, other.first_use, other.last_use)) continue;
+            ranges.PushBack(other.offset);
+            ranges.PushBack(other.offset + other.size);
+            uint64_t* pairs = ranges.Data();
+            for (size_t k = ranges.Size() / 2 - 1; k > 0 && pairs[(k - 1) * 2] > pairs[k * 2]; --k) {
+                uint64_t offset = pairs[k * 2], end = pairs[k * 2 + 1];
+                pairs[k * 2] = pairs[(k - 1) * 2];
+                pairs[k * 2 + 1] = pairs[(k - 1) * 2 + 1];
+                pairs[(k - 1) * 2] = offset;
+                pairs[(k - 1) * 2 + 1] = end;
+            }
+        }
+
+        uint64_t offset = 0;
+        const uint64_t* pairs = ranges.Data();
+        for (size_t k = 0; k < ranges.Size() / 2; ++k) {
+            if (offset + resource.size <= pairs[k * 2]) break;
+            if (pairs[k * 2 + 1] > offset) offset = pairs[k * 2 + 1];
+        }
+        resource.offset = offset;
+        if (offset + resource.size > transient_size) transient_size = offset + resource.size;
+        placed.PushBack(by_size.Data()[i]);
+    }
+
+    // The latest earlier resource sharing any bytes is the one whose
+    // contents a first use overwrites
+    for (uint32_t i = 0; i < placed.Size(); ++i) {
+        Resource& resource = all[placed.Data()[i]];
+        uint32_t latest = kNone;
+        for (uint32_t j = 0; j < placed.Size(); ++j) {
+            const Resource& other = all[placed.Data()[j]];
+            if (other.last_use >= resource.first_use) continue;
+            if (other.offset >= resource.offset + resource.size || resource.offset >= other.offset + other.size) continue;
+            if (latest == kNone || other.last_use > all[latest].last_use) latest = placed.Data()[j];
+        }
+        resource.aliases = latest;
+    }
+}
+
+void FrameGraph::BuildBarriers() {
+    barriers.Clear();
+    current_state.Resize(resources.Size());
+    last_writer.Fill(kNone);
+    ResourceState* states = current_state.Data();
+    uint32_t* writers = last_writer.Data();
+    for (uint32_t r = 0; r < resources.Size(); ++r) states[r] = resources.Data()[r].initial_state;
+
+    for (uint32_t step = 0; step < order.Size(); ++step) {
+        Pass& pass = passes.Data()[order.Data()[step]];
+        pass.first_barrier = static_cast<uint32_t>(barriers.Size());
+        for (uint32_t a = pass.first_access; a < pass.first_access + pass.access_count; ++a) {
+            const Access& access = accesses.Data()[a];
+            const Resource& resource = resources.Data()[access.resource];
+
+            // One barrier per resource per pass
+            bool seen = false;
+            for (uint32_t b = pass.first_barrier; b < barriers.Size(); ++b) {
+                if (barriers.Data()[b].resource == access.resource) seen = true;
+            }
+            // Storage writes by an earlier pass need a barrier even when the
+            // state does not change
+            bool storage_hazard = access.state == ResourceState::UnorderedAccess && writers[access.resource] != kNone;
+            if (!seen && (access.state != states[access.resource] || storage_hazard)) {
+                bool aliased = step == resource.first_use && resource.aliases != kNoFrameResource;
+                barriers.PushBack(FrameBarrier{ access.resource, states[access.resource], access.state, aliased });
+            }
+        }
+        for (uint32_t a = pass.first_access; a < pass.first_access + pass.access_count; ++a) {
+            const Access& access = accesses.Data()[a];
+            states[access.resource] = access.state;
+            if (access.write) writers[access.resource] = step;
+        }
+        pass.barrier_count = static_cast<uint32_t>(barriers.Size()) - pass.first_barrier;
+    }
+}
+
+bool FrameGraph::IsCulled(FramePass pass) const {
+    return passes.Data()[pass].culled;
+}
+
+const FramePass* FrameGraph::ExecutionOrder() const {
+    return order.Data();
+}
+
+uint32_t FrameGraph::ExecutionCount() const {
+    return static_cast<uint32_t>(order.Size());
+}
+
+const FrameBarrier* FrameGraph::BarriersBefore(FramePass pass, uint32_t* count) const {
+    const Pass& entry = passes.Data()[pass];
+    *count = entry.culled ? 0 : entry.barrier_count;
+    return barriers.Data() + entry.first_barrier;
+}
+
+uint64_t FrameGraph::ResourceOffset(FrameResource resource) const {
+    return resources.Data()[resource].offset;
+}
+
+uint64_t FrameGraph::ResourceSize(FrameResource resource) const {
+    return resources.Data()[resource].size;
+}
+
+bool FrameGraph::IsUsed(FrameResource resource) const {
+    return resources.Data()[resource].first_use != kNone;
+}
+
+uint32_t FrameGraph::FirstUse(FrameResource resource) const {
+    return resources.Data()[resource].first_use;
+}
+
+uint32_t FrameGraph::LastUse(FrameResource resource) const {
+    return resources.Data()[resource].last_use;
+}
+
+uint64_t FrameGraph::TransientMemorySize() const {
+    return transient_size;
+}
+
+uint64_t FrameGraph::UnaliasedMemorySize() const {
+    return unaliased_size;
+}
+
+const char* FrameGraph::PassName(FramePass pass) const {
+    return passes.Data()[pass].name;
+}
+
+const char* FrameGraph::ResourceName(FrameResource resource) const {
+    return resources.Data()[resource].name;
+}
+
+uint32_t FrameGraph::PassCount() const {
+    return static_cast<uint32_t>(passes.Size());
+}
+
+uint32_t FrameGraph::ResourceCount() const {
+    return static_cast<uint32_t>(resources.Size());
+}
+
+} // namespace rendering
+} // namespace toybox
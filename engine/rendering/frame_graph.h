@@ -0,0 +1,183 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint64_t
+
+#include "dynamicarray.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+typedef uint32_t FrameResource;
+typedef uint32_t FramePass;
+
+constexpr uint32_t kNoFrameResource = 0xffffffffu;
+
+// Placement alignment for transient resources sharing memory; the largest
+// that common GPUs require for textures
+constexpr uint64_t kTransientAlignment = 65536;
+
+enum class FrameResourceKind : uint8_t { Texture, Buffer };
+
+struct FrameResourceDesc {
+    FrameResourceKind kind;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_element; // Per pixel for textures, per element for buffers
+};
+
+// How a pass uses a resource; a barrier is needed whenever it changes
+enum class ResourceState : uint8_t {
+    Undefined,
+    RenderTarget,
+    DepthWrite,
+    DepthRead,
+    ShaderRead,
+    UnorderedAccess,
+    CopySource,
+    CopyDest,
+    Present,
+};
+
+struct FrameBarrier {
+    FrameResource resource;
+    ResourceState before;
+    ResourceState after;
+    // First use of a transient resource whose memory another resource had
+    // earlier in the frame; old contents are garbage
+    bool aliased;
+};
+
+// Per-frame render graph. Passes are declared in execution order with the
+// resources they read and write; Compile then
+//
+//   - culls passes whose output nothing needed reads, keeping passes marked
+//     as having side effects and passes that write imported resources,
+//   - works out each transient resource's lifetime over the surviving
+//     passes and places them in one block of memory so resources that are
+//     never alive at the same time share bytes,
+//   - lists the state transitions each surviving pass needs first.
+//
+// Nothing here knows about a graphics API: a backend creates the memory
+// block at TransientMemorySize, places resources at ResourceOffset and
+// turns FrameBarriers into its own barrier calls. Declarations are redone
+// every frame; Reset keeps the memory so a steady frame does not allocate.
+struct FrameGraph {
+private:
+    struct Resource {
+        const char* name;
+        FrameResourceDesc desc;
+        ResourceState initial_state;
+        bool imported;
+        uint64_t size;
+        uint64_t offset;
+        // First and last surviving pass using it, in execution order
+        uint32_t first_use;
+        uint32_t last_use;
+        // Resource that used the same memory before it, if any
+        FrameResource aliases;
+    };
+
+    struct Pass {
+        const char* name;
+        bool side_effects;
+        bool culled;
+        uint32_t first_access;
+        uint32_t access_count;
+        uint32_t first_barrier;
+        uint32_t barrier_count;
+    };
+
+    struct Access {
+        FrameResource resource;
+        ResourceState state;
+        bool write;
+        // Pass that last wrote the resource before this access
+        uint32_t producer;
+    };
+
+    utils::data_structures::DynamicArray<Resource> resources;
+    utils::data_structures::DynamicArray<Pass> passes;
+    utils::data_structures::DynamicArray<Access> accesses;
+    utils::data_structures::DynamicArray<FrameBarrier> barriers;
+    utils::data_structures::DynamicArray<FramePass> order;
+    // Compile scratch
+    utils::data_structures::DynamicArray<uint32_t> last_writer;
+    utils::data_structures::DynamicArray<FrameResource> by_size;
+    utils::data_structures::DynamicArray<FrameResource> placed;
+    utils::data_structures::DynamicArray<uint64_t> ranges;
+    utils::data_structures::DynamicArray<ResourceState> current_state;
+    uint64_t transient_size;
+    uint64_t unaliased_size;
+
+    void AddAccess(FramePass pass, FrameResource resource, ResourceState state, bool write);
+    void FindProducers();
+    void CullPasses();
+    void ComputeLifetimes();
+    void PlaceResources();
+    void BuildBarriers();
+
+public:
+    FrameGraph();
+
+    FrameGraph(const FrameGraph&) = delete;
+    FrameGraph& operator=(const FrameGraph&) = delete;
+
+    // Forgets the last frame's declarations
+    void Reset();
+
+    // Memory the graph places and may share with other transient resources
+    FrameResource CreateTransient(const char* name, const FrameResourceDesc& desc);
+    // Memory owned elsewhere, e.g. the swapchain image or a history buffer;
+    // it is never aliased and writes to it are always kept
+    FrameResource Import(const char* name, const FrameResourceDesc& desc, ResourceState initial_state);
+
+    // Declares a pass that runs after every pass declared before it. Its
+    // reads and writes must be declared before the next AddPass.
+    FramePass AddPass(const char* name, bool side_effects = false);
+    void Read(FramePass pass, FrameResource resource, ResourceState state);
+    // A write that keeps the old contents (blending, load ops) should also
+    // be declared as a read
+    void Write(FramePass pass, FrameResource resource, ResourceState state);
+
+    void Compile();
+
+    // Results of the last Compile
+    bool IsCulled(FramePass pass) const;
+    // Surviving passes in execution order
+    const FramePass* ExecutionOrder() const;
+    uint32_t ExecutionCount() const;
+    // Barriers to issue before a surviving pass
+    const FrameBarrier* BarriersBefore(FramePass pass, uint32_t* count) const;
+    // Byte offset of a transient resource in the shared block
+    uint64_t ResourceOffset(FrameResource resource) const;
+    uint64_t ResourceSize(FrameResource resource) const;
+    // Whether any surviving pass uses the resource
+    bool IsUsed(FrameResource resource) const;
+    // First and last surviving pass (as indices into ExecutionOrder) using it
+    uint32_t FirstUse(FrameResource resource) const;
+    uint32_t LastUse(FrameResource resource) const;
+    // Size of the shared block, and what the used transient resources would
+    // take with memory of their own
+    uint64_t TransientMemorySize() const;
+    uint64_t UnaliasedMemorySize() const;
+
+    const char* PassName(FramePass pass) const;
+    const char* ResourceName(FrameResource resource) const;
+    uint32_t PassCount() const;
+    uint32_t ResourceCount() const;
+};
+
+} // namespace rendering
+} // namespace toybox
@@ -0,0 +1,194 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "instancing.h"
+#include "parallel_for.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+using math::Aabb;
+using math::Mat4;
+using math::Vec3;
+using math::Vec4;
+
+// Group key: pipeline:14 | material:16 | mesh:24, in the sort key's order so
+// groups come out in the order they will be submitted
+static const uint32_t kGroupMeshBits = 24;
+
+static uint64_t GroupKey(uint32_t pipeline, uint32_t material, uint32_t mesh) {
+    return (uint64_t(pipeline & (kMaxSortPipelines - 1)) << (kSortMaterialBits + kGroupMeshBits)) |
+           (uint64_t(material & (kMaxSortMaterials - 1)) << kGroupMeshBits) |
+           uint64_t(mesh & ((1u << kGroupMeshBits) - 1));
+}
+
+InstanceExtractor::InstanceExtractor() : draw_count(0) {}
+
+void InstanceExtractor::Extract(const RenderObjects& objects, const uint32_t* visible, uint32_t visible_count,
+                                const MeshRange* meshes, uint32_t layer, uint32_t pass, CommandBuffer* recorder,
+                                utils::jobs::JobSystem* jobs) {
+    group_keys.Resize(visible_count);
+    group_objects.Resize(visible_count);
+    scratch_keys.Resize(visible_count);
+    scratch_objects.Resize(visible_count);
+    instances.Resize(visible_count);
+    draw_count = 0;
+    if (visible_count == 0) return;
+
+    uint64_t* keys = group_keys.Data();
+    uint32_t* sorted = group_objects.Data();
+    for (uint32_t i = 0; i < visible_count; ++i) {
+        uint32_t object = visible[i];
+        keys[i] = GroupKey(objects.pipeline[object], objects.material[object], objects.mesh[object]);
+        sorted[i] = object;
+    }
+    // Stable, so each group keeps the visible list's order
+    RadixSort(keys, sorted, visible_count, scratch_keys.Data(), scratch_objects.Data());
+
+    InstanceData* stream = instances.Data();
+    auto write = [&objects, sorted, stream](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t object = sorted[i];
+            const float* m = objects.world[object].m;
+            InstanceData& instance = stream[i];
+            instance.rows[0] = Vec4{ m[0], m[4], m[8], m[12] };
+            instance.rows[1] = Vec4{ m[1], m[5], m[9], m[13] };
+            instance.rows[2] = Vec4{ m[2], m[6], m[10], m[14] };
+            instance.color = objects.color[object];
+            instance.object = object;
+            instance.padding[0] = 0;
+            instance.padding[1] = 0;
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, visible_count, write);
+    } else {
+        write(0, visible_count);
+    }
+
+    uint32_t start = 0;
+    for (uint32_t i = 1; i <= visible_count; ++i) {
+        if (i < visible_count && keys[i] == keys[start]) continue;
+        uint32_t object = sorted[start];
+        const MeshRange& mesh = meshes[objects.mesh[object]];
+        recorder->Draw(MakeOpaqueKey(layer, pass, objects.pipeline[object], objects.material[object], 0.0f),
+                       DrawPayload{ objects.mesh[object], mesh.first_index, mesh.index_count, start, i - start });
+        ++draw_count;
+        start = i;
+    }
+}
+
+const InstanceData* InstanceExtractor::Instances() const {
+    return instances.Data();
+}
+
+uint32_t InstanceExtractor::InstanceCount() const {
+    return static_cast<uint32_t>(instances.Size());
+}
+
+uint32_t InstanceExtractor::DrawCount() const {
+    return draw_count;
+}
+
+void StaticBatcher::Add(uint32_t mesh, uint32_t material, uint32_t pipeline, const Mat4& world) {
+    pending.PushBack(Pending{ mesh, material, pipeline, world });
+}
+
+void StaticBatcher::Build(const MeshGeometry* meshes) {
+    uint32_t count = static_cast<uint32_t>(pending.Size());
+    if (count == 0) return;
+
+    // Group by pipeline and material, keeping the order objects were added
+    utils::data_structures::DynamicArray<uint64_t> keys;
+    utils::data_structures::DynamicArray<uint32_t> order;
+    utils::data_structures::DynamicArray<uint64_t> scratch_keys;
+    utils::data_structures::DynamicArray<uint32_t> scratch_order;
+    keys.Resize(count);
+    order.Resize(count);
+    scratch_keys.Resize(count);
+    scratch_order.Resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const Pending& object = pending.Data()[i];
+        keys.Data()[i] = GroupKey(object.pipeline, object.material, 0);
+        order.Data()[i] = i;
+    }
+    RadixSort(keys.Data(), order.Data(), count, scratch_keys.Data(), scratch_order.Data());
+
+    StaticBatch* batch = nullptr;
+    uint32_t batch_vertices = 0;
+    uint64_t batch_key = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Pending& object = pending.Data()[order.Data()[i]];
+        const MeshGeometry& mesh = meshes[object.mesh];
+        bool full = batch_vertices > 0 && batch_vertices + mesh.vertex_count > kMaxBatchVertices;
+        if (!batch || keys.Data()[i] != batch_key || full) {
+            Aabb empty{ Vec3{ 1e30f, 1e30f, 1e30f }, Vec3{ -1e30f, -1e30f, -1e30f } };
+            batches.PushBack(StaticBatch{ object.pipeline, object.material, uint32_t(indices.Size()), 0, empty });
+            batch = &batches.Back();
+            batch_key = keys.Data()[i];
+            batch_vertices = 0;
+        }
+
+        uint32_t base = static_cast<uint32_t>(vertices.Size());
+        for (uint32_t v = 0; v < mesh.vertex_count; ++v) {
+            Vec3 position = math::TransformPoint(object.world, mesh.positions[v]);
+            Vec3 normal = math::Normalize(math::TransformVector(object.world, mesh.normals[v]));
+            vertices.PushBack(BatchVertex{ position, normal });
+            batch->bounds.min = math::Min(batch->bounds.min, position);
+            batch->bounds.max = math::Max(batch->bounds.max, position);
+        }
+        for (uint32_t n = 0; n < mesh.index_count; ++n) indices.PushBack(base + mesh.indices[n]);
+        batch->index_count += mesh.index_count;
+        batch_vertices += mesh.vertex_count;
+    }
+    pending.Clear();
+}
+
+uint32_t StaticBatcher::Submit(const math::Frustum& frustum, uint32_t geometry, uint32_t layer, uint32_t pass,
+                               CommandBuffer* recorder) const {
+    uint32_t submitted = 0;
+    for (uint32_t b = 0; b < batches.Size(); ++b) {
+        const StaticBatch& batch = batches.Data()[b];
+        if (math::Classify(frustum, batch.bounds) == math::Containment::Outside) continue;
+        recorder->Draw(MakeOpaqueKey(layer, pass, batch.pipeline, batch.material, 0.0f),
+                       DrawPayload{ geometry, batch.first_index, batch.index_count, kWorldSpaceInstance, 1 });
+        ++submitted;
+    }
+    return submitted;
+}
+
+const StaticBatch* StaticBatcher::Batches() const {
+    return batches.Data();
+}
+
+uint32_t StaticBatcher::BatchCount() const {
+    return static_cast<uint32_t>(batches.Size());
+}
+
+const BatchVertex* StaticBatcher::Vertices() const {
+    return vertices.Data();
+}
+
+uint32_t StaticBatcher::VertexCount() const {
+    return static_cast<uint32_t>(vertices.Size());
+}
+
+const uint32_t* StaticBatcher::Indices() const {
+    return indices.Data();
+}
+
+uint32_t StaticBatcher::IndexCount() const {
+    return static_cast<uint32_t>(indices.Size());
+}
+
+} // namespace rendering
+} // namespace toybox
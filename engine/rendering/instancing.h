@@ -0,0 +1,159 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint64_t
+
+#include "dynamicarray.h"
+#include "geometry.h"
+#include "job_system.h"
+#include "matrix.h"
+#include "render_queue.h"
+#include "vector.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+// Where a mesh's indices sit in the shared index buffer
+struct MeshRange {
+    uint32_t first_index;
+    uint32_t index_count;
+};
+
+// Per-object render data in struct-of-arrays form, indexed like CullBounds
+struct RenderObjects {
+    const uint32_t* mesh;
+    const uint32_t* material;
+    const uint32_t* pipeline;
+    const math::Mat4* world;
+    const uint32_t* color; // RGBA8
+};
+
+// One instance as the vertex shader reads it: the affine part of the world
+// matrix as three rows, then colour and the object it came from. 64 bytes,
+// so a stream of them suits structured and vertex buffers alike.
+struct InstanceData {
+    math::Vec4 rows[3];
+    uint32_t color;
+    uint32_t object;
+    uint32_t padding[2];
+};
+
+// first_instance of a draw whose vertices are already in world space
+constexpr uint32_t kWorldSpaceInstance = 0xffffffffu;
+
+// Turns a visible list into instanced draws. Objects are grouped by
+// pipeline, material and mesh with a radix sort, each group's instance data
+// is written contiguously to one upload stream, and each group becomes a
+// single draw in a command buffer. The draws of one frame drop from one per
+// object to one per distinct mesh and material.
+struct InstanceExtractor {
+private:
+    utils::data_structures::DynamicArray<InstanceData> instances;
+    utils::data_structures::DynamicArray<uint64_t> group_keys;
+    utils::data_structures::DynamicArray<uint32_t> group_objects;
+    utils::data_structures::DynamicArray<uint64_t> scratch_keys;
+    utils::data_structures::DynamicArray<uint32_t> scratch_objects;
+    uint32_t draw_count;
+
+public:
+    InstanceExtractor();
+
+    InstanceExtractor(const InstanceExtractor&) = delete;
+    InstanceExtractor& operator=(const InstanceExtractor&) = delete;
+
+    // Replaces the instance stream with the visible objects' data and
+    // records one draw per group. With a job system the stream is written
+    // in parallel.
+    void Extract(const RenderObjects& objects, const uint32_t* visible, uint32_t visible_count,
+                 const MeshRange* meshes, uint32_t layer, uint32_t pass, CommandBuffer* recorder,
+                 utils::jobs::JobSystem* jobs = nullptr);
+
+    // The upload stream from the last Extract, in draw order
+    const InstanceData* Instances() const;
+    uint32_t InstanceCount() const;
+    uint32_t DrawCount() const;
+};
+
+// Geometry of a mesh on the CPU
+struct MeshGeometry {
+    const math::Vec3* positions;
+    const math::Vec3* normals;
+    uint32_t vertex_count;
+    const uint32_t* indices;
+    uint32_t index_count;
+};
+
+struct BatchVertex {
+    math::Vec3 position;
+    math::Vec3 normal;
+};
+
+struct StaticBatch {
+    uint32_t pipeline;
+    uint32_t material;
+    uint32_t first_index;
+    uint32_t index_count;
+    math::Aabb bounds;
+};
+
+// Vertices per batch before it is split, so a batch still culls usefully
+constexpr uint32_t kMaxBatchVertices = 1u << 16;
+
+// Merges geometry that never moves into a few large world-space batches,
+// one or more per pipeline and material, at load time. Each batch draws in
+// one call with no instance data, and its bounds cull it as a whole.
+struct StaticBatcher {
+private:
+    struct Pending {
+        uint32_t mesh;
+        uint32_t material;
+        uint32_t pipeline;
+        math::Mat4 world;
+    };
+
+    utils::data_structures::DynamicArray<Pending> pending;
+    utils::data_structures::DynamicArray<BatchVertex> vertices;
+    utils::data_structures::DynamicArray<uint32_t> indices;
+    utils::data_structures::DynamicArray<StaticBatch> batches;
+
+public:
+    StaticBatcher() = default;
+
+    StaticBatcher(const StaticBatcher&) = delete;
+    StaticBatcher& operator=(const StaticBatcher&) = delete;
+
+    // Queues a static object for the next Build
+    void Add(uint32_t mesh, uint32_t material, uint32_t pipeline, const math::Mat4& world);
+
+    // Transforms and merges everything added since the last Build. meshes
+    // is indexed by the mesh ids passed to Add. Batch indices point into
+    // Vertices.
+    void Build(const MeshGeometry* meshes);
+
+    // Records a draw per batch whose bounds are at least partly inside the
+    // frustum, with geometry as the merged buffer's mesh id, and returns how
+    // many
+    uint32_t Submit(const math::Frustum& frustum, uint32_t geometry, uint32_t layer, uint32_t pass,
+                    CommandBuffer* recorder) const;
+
+    const StaticBatch* Batches() const;
+    uint32_t BatchCount() const;
+    const BatchVertex* Vertices() const;
+    uint32_t VertexCount() const;
+    const uint32_t* Indices() const;
+    uint32_t IndexCount() const;
+};
+
+} // namespace rendering
+} // namespace toybox
@@ -0,0 +1,271 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cmath> // For floorf, ceilf, fabsf
+
+#include "occlusion_buffer.h"
+#include "parallel_for.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+using math::Mat4;
+using math::Vec3;
+using math::Vec4;
+
+// Clip w below this counts as behind the camera
+static const float kMinClipW = 1e-5f;
+
+// Screen bands per thread when rasterising in parallel
+static const uint32_t kBandsPerThread = 2;
+
+static Vec4 ToClip(const Mat4& matrix, Vec3 p) {
+    const float* m = matrix.m;
+    return Vec4{ m[0] * p.x + m[4] * p.y + m[8] * p.z + m[12], m[1] * p.x + m[5] * p.y + m[9] * p.z + m[13],
+                 m[2] * p.x + m[6] * p.y + m[10] * p.z + m[14], m[3] * p.x + m[7] * p.y + m[11] * p.z + m[15] };
+}
+
+static float Max3(float a, float b, float c) {
+    float ab = a > b ? a : b;
+    return ab > c ? ab : c;
+}
+
+static float Min3(float a, float b, float c) {
+    float ab = a < b ? a : b;
+    return ab < c ? ab : c;
+}
+
+OcclusionBuffer::OcclusionBuffer() : width(0), height(0), view_projection(math::Mat4Identity()), level_count(0) {}
+
+bool OcclusionBuffer::Init(int32_t width, int32_t height) {
+    if (width <= 0 || height <= 0) return false;
+
+    this->width = width;
+    this->height = height;
+    uint32_t total = 0;
+    int32_t level_width = width;
+    int32_t level_height = height;
+    level_count = 0;
+    while (level_count < kMaxOcclusionLevels) {
+        levels[level_count] = Level{ level_width, level_height, total };
+        total += static_cast<uint32_t>(level_width * level_height);
+        ++level_count;
+        if (level_width == 1 && level_height == 1) break;
+        level_width = (level_width + 1) / 2;
+        level_height = (level_height + 1) / 2;
+    }
+    depth.Resize(total);
+    depth.Fill(1.0f);
+    return true;
+}
+
+void OcclusionBuffer::Begin(const Mat4& view_projection) {
+    this->view_projection = view_projection;
+    float* base = depth.Data();
+    for (int32_t i = 0; i < width * height; ++i) base[i] = 1.0f;
+}
+
+void OcclusionBuffer::RasterizeOccluders(const Vec3* vertices, uint32_t vertex_count, const uint32_t* indices,
+                                         uint32_t triangle_count, utils::jobs::JobSystem* jobs) {
+    // Project every vertex once
+    screen.Resize(vertex_count);
+    Vec4* projected = screen.Data();
+    float half_width = 0.5f * float(width);
+    float half_height = 0.5f * float(height);
+    auto project = [this, vertices, projected, half_width, half_height](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Vec4 clip = ToClip(view_projection, vertices[i]);
+            if (clip.w < kMinClipW) {
+                projected[i] = Vec4{ 0.0f, 0.0f, 0.0f, -1.0f };
+                continue;
+            }
+            float inverse_w = 1.0f / clip.w;
+            // Screen y grows downwards
+            projected[i] = Vec4{ (clip.x * inverse_w + 1.0f) * half_width, (1.0f - clip.y * inverse_w) * half_height,
+                                 clip.z * inverse_w, 1.0f };
+        }
+    };
+
+    // Bands of rows own their pixels outright, so they need no locking
+    uint32_t bands = jobs ? jobs->ThreadCount() * kBandsPerThread : 1;
+    if (bands > static_cast<uint32_t>(height)) bands = static_cast<uint32_t>(height);
+    int32_t rows = (height + static_cast<int32_t>(bands) - 1) / static_cast<int32_t>(bands);
+    auto rasterize = [this, indices, triangle_count, rows](size_t begin, size_t end) {
+        for (size_t band = begin; band < end; ++band) {
+            int32_t min_y = static_cast<int32_t>(band) * rows;
+            int32_t max_y = min_y + rows < height ? min_y + rows : height;
+            RasterizeBand(indices, triangle_count, min_y, max_y);
+        }
+    };
+
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, vertex_count, project);
+        utils::jobs::ParallelFor(jobs, 0, bands, 1, rasterize);
+    } else {
+        project(0, vertex_count);
+        rasterize(0, bands);
+    }
+}
+
+void OcclusionBuffer::RasterizeBand(const uint32_t* indices, uint32_t triangle_count, int32_t min_y, int32_t max_y) {
+    const Vec4* projected = screen.Data();
+    float* buffer = depth.Data();
+
+    for (uint32_t t = 0; t < triangle_count; ++t) {
+        Vec4 a = projected[indices[t * 3]];
+        Vec4 b = projected[indices[t * 3 + 1]];
+        Vec4 c = projected[indices[t * 3 + 2]];
+        if (a.w < 0.0f || b.w < 0.0f || c.w < 0.0f) continue;
+
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (fabsf(area) < 1e-8f) continue;
+
+        int32_t x0 = static_cast<int32_t>(floorf(Min3(a.x, b.x, c.x)));
+        int32_t x1 = static_cast<int32_t>(ceilf(Max3(a.x, b.x, c.x)));
+        int32_t y0 = static_cast<int32_t>(floorf(Min3(a.y, b.y, c.y)));
+        int32_t y1 = static_cast<int32_t>(ceilf(Max3(a.y, b.y, c.y)));
+        if (x0 < 0) x0 = 0;
+        if (x1 > width - 1) x1 = width - 1;
+        if (y0 < min_y) y0 = min_y;
+        if (y1 > max_y - 1) y1 = max_y - 1;
+        if (x0 > x1 || y0 > y1) continue;
+
+        // Barycentric weights from edge functions, scaled by 1 / area so
+        // both windings come out positive inside, and stepped per pixel
+        float inverse_area = 1.0f / area;
+        float step_x0 = (c.y - b.y) * -inverse_area;
+        float step_x1 = (a.y - c.y) * -inverse_area;
+        float step_y0 = (c.x - b.x) * inverse_area;
+        float step_y1 = (a.x - c.x) * inverse_area;
+        float px = float(x0) + 0.5f;
+        float py = float(y0) + 0.5f;
+        float row_w0 = ((c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x)) * inverse_area;
+        float row_w1 = ((a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x)) * inverse_area;
+
+        for (int32_t y = y0; y <= y1; ++y) {
+            float w0 = row_w0;
+            float w1 = row_w1;
+            float* row = buffer + y * width;
+            for (int32_t x = x0; x <= x1; ++x) {
+                float w2 = 1.0f - w0 - w1;
+                if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f) {
+                    float z = a.z * w0 + b.z * w1 + c.z * w2;
+                    if (z < row[x]) row[x] = z;
+                }
+                w0 += step_x0;
+                w1 += step_x1;
+            }
+            row_w0 += step_y0;
+            row_w1 += step_y1;
+        }
+    }
+}
+
+void OcclusionBuffer::Finish(utils::jobs::JobSystem* jobs) {
+    float* base = depth.Data();
+    for (uint32_t l = 1; l < level_count; ++l) {
+        const Level& fine = levels[l - 1];
+        const Level& coarse = levels[l];
+        const float* source = base + fine.offset;
+        float* target = base + coarse.offset;
+
+        // Farthest of the (up to) 2x2 finer texels
+        auto reduce = [fine, coarse, source, target](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y) {
+                int32_t y0 = static_cast<int32_t>(y) * 2;
+                int32_t y1 = y0 + 1 < fine.height ? y0 + 1 : y0;
+                for (int32_t x = 0; x < coarse.width; ++x) {
+                    int32_t x0 = x * 2;
+                    int32_t x1 = x0 + 1 < fine.width ? x0 + 1 : x0;
+                    float a = source[y0 * fine.width + x0];
+                    float b = source[y0 * fine.width + x1];
+                    float c = source[y1 * fine.width + x0];
+                    float d = source[y1 * fine.width + x1];
+                    float ab = a > b ? a : b;
+                    float cd = c > d ? c : d;
+                    target[y * coarse.width + x] = ab > cd ? ab : cd;
+                }
+            }
+        };
+        if (jobs && coarse.height >= 64) {
+            utils::jobs::ParallelFor(jobs, 0, coarse.height, reduce);
+        } else {
+            reduce(0, coarse.height);
+        }
+    }
+}
+
+bool OcclusionBuffer::IsVisible(const math::Aabb& box) const {
+    float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f;
+    float nearest = 1e30f;
+    float half_width = 0.5f * float(width);
+    float half_height = 0.5f * float(height);
+    for (int corner = 0; corner < 8; ++corner) {
+        Vec3 p{ corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y,
+                corner & 4 ? box.max.z : box.min.z };
+        Vec4 clip = ToClip(view_projection, p);
+        // Reaches behind the camera, so it may cover anything
+        if (clip.w < kMinClipW) return true;
+        float inverse_w = 1.0f / clip.w;
+        float x = (clip.x * inverse_w + 1.0f) * half_width;
+        float y = (1.0f - clip.y * inverse_w) * half_height;
+        float z = clip.z * inverse_w;
+        min_x = x < min_x ? x : min_x;
+        max_x = x > max_x ? x : max_x;
+        min_y = y < min_y ? y : min_y;
+        max_y = y > max_y ? y : max_y;
+        nearest = z < nearest ? z : nearest;
+    }
+    // Off screen boxes are the frustum test's business
+    if (max_x < 0.0f || max_y < 0.0f || min_x >= float(width) || min_y >= float(height)) return true;
+
+    int32_t x0 = min_x > 0.0f ? static_cast<int32_t>(min_x) : 0;
+    int32_t y0 = min_y > 0.0f ? static_cast<int32_t>(min_y) : 0;
+    int32_t x1 = max_x < float(width - 1) ? static_cast<int32_t>(max_x) : width - 1;
+    int32_t y1 = max_y < float(height - 1) ? static_cast<int32_t>(max_y) : height - 1;
+
+    // The level where the rectangle covers at most 3x3 texels
+    int32_t size = x1 - x0 > y1 - y0 ? x1 - x0 : y1 - y0;
+    uint32_t level = 0;
+    while ((size >> level) > 1 && level + 1 < level_count) ++level;
+
+    const Level& texels = levels[level];
+    const float* base = depth.Data() + texels.offset;
+    float farthest = 0.0f;
+    for (int32_t y = y0 >> level; y <= (y1 >> level); ++y) {
+        for (int32_t x = x0 >> level; x <= (x1 >> level); ++x) {
+            float d = base[y * texels.width + x];
+            farthest = d > farthest ? d : farthest;
+        }
+    }
+    return nearest <= farthest;
+}
+
+int32_t OcclusionBuffer::Width() const {
+    return width;
+}
+
+int32_t OcclusionBuffer::Height() const {
+    return height;
+}
+
+uint32_t OcclusionBuffer::LevelCount() const {
+    return level_count;
+}
+
+float OcclusionBuffer::DepthAt(uint32_t level, int32_t x, int32_t y) const {
+    const Level& texels = levels[level];
+    return depth.Data()[texels.offset + y * texels.width + x];
+}
+
+} // namespace rendering
+} // namespace toybox
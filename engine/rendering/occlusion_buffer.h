@@ -0,0 +1,92 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, int32_t
+
+#include "dynamicarray.h"
+#include "geometry.h"
+#include "job_system.h"
+#include "matrix.h"
+#include "vector.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+// Most mip levels the depth hierarchy keeps; enough for 32K pixels a side
+constexpr uint32_t kMaxOcclusionLevels = 16;
+
+// Low resolution software depth buffer for occlusion culling. Each frame,
+// Begin with the camera, rasterise a few large occluders (walls, terrain,
+// big buildings), then Finish to build the depth hierarchy: every level
+// holds the farthest depth of the 2x2 texels below it. An object is hidden
+// if its nearest point is behind the farthest occluder depth over the
+// screen rectangle it covers, which a level with about 2x2 texels there
+// answers in a few reads.
+//
+// Depth is clip space z/w from 0 at the near plane to 1 at the far plane.
+// Triangles crossing the near plane are skipped, which is safe: a missing
+// occluder only hides less.
+struct OcclusionBuffer {
+private:
+    struct Level {
+        int32_t width;
+        int32_t height;
+        uint32_t offset;
+    };
+
+    int32_t width;
+    int32_t height;
+    math::Mat4 view_projection;
+    Level levels[kMaxOcclusionLevels];
+    uint32_t level_count;
+    // Level 0 first, then each coarser level
+    utils::data_structures::DynamicArray<float> depth;
+    // Occluder vertices in screen space: x, y in pixels, z depth, w < 0 if
+    // behind the near plane
+    utils::data_structures::DynamicArray<math::Vec4> screen;
+
+    void RasterizeBand(const uint32_t* indices, uint32_t triangle_count, int32_t min_y, int32_t max_y);
+
+public:
+    OcclusionBuffer();
+
+    OcclusionBuffer(const OcclusionBuffer&) = delete;
+    OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+
+    bool Init(int32_t width, int32_t height);
+
+    // Clears to the far plane for a new view
+    void Begin(const math::Mat4& view_projection);
+
+    // Draws world space triangles, three indices each, into the depth
+    // buffer. Both windings count. With a job system the screen is split
+    // into bands rasterised in parallel.
+    void RasterizeOccluders(const math::Vec3* vertices, uint32_t vertex_count, const uint32_t* indices,
+                            uint32_t triangle_count, utils::jobs::JobSystem* jobs = nullptr);
+
+    // Builds the depth hierarchy once every occluder is drawn
+    void Finish(utils::jobs::JobSystem* jobs = nullptr);
+
+    // False only if the box is certainly hidden behind the occluders
+    bool IsVisible(const math::Aabb& box) const;
+
+    int32_t Width() const;
+    int32_t Height() const;
+    uint32_t LevelCount() const;
+    // Depth of a texel of a level
+    float DepthAt(uint32_t level, int32_t x, int32_t y) const;
+};
+
+} // namespace rendering
+} // namespace toybox
@@ -0,0 +1,169 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstring> // For memcpy, memset
+
+#include "parallel_for.h"
+#include "render_queue.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+void CommandBuffer::Draw(uint64_t key, const DrawPayload& payload) {
+    keys.PushBack(key);
+    payloads.PushBack(payload);
+}
+
+uint32_t CommandBuffer::Count() const {
+    return static_cast<uint32_t>(keys.Size());
+}
+
+void CommandBuffer::Clear() {
+    keys.Clear();
+    payloads.Clear();
+}
+
+void RadixSort(uint64_t* keys, uint32_t* values, uint32_t count, uint64_t* scratch_keys, uint32_t* scratch_values) {
+    // Every byte's histogram in one read of the keys
+    uint32_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t key = keys[i];
+        for (uint32_t b = 0; b < 8; ++b) ++histograms[b][(key >> (b * 8)) & 0xff];
+    }
+
+    uint64_t* source_keys = keys;
+    uint32_t* source_values = values;
+    uint64_t* target_keys = scratch_keys;
+    uint32_t* target_values = scratch_values;
+    for (uint32_t b = 0; b < 8; ++b) {
+        uint32_t* histogram = histograms[b];
+        uint32_t shift = b * 8;
+        if (histogram[(source_keys[0] >> shift) & 0xff] == count) continue;
+
+        uint32_t offsets[256];
+        uint32_t sum = 0;
+        for (uint32_t d = 0; d < 256; ++d) {
+            offsets[d] = sum;
+            sum += histogram[d];
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t slot = offsets[(source_keys[i] >> shift) & 0xff]++;
+            target_keys[slot] = source_keys[i];
+            target_values[slot] = source_values[i];
+        }
+
+        uint64_t* swap_keys = source_keys;
+        source_keys = target_keys;
+        target_keys = swap_keys;
+        uint32_t* swap_values = source_values;
+        source_values = target_values;
+        target_values = swap_values;
+    }
+
+    if (source_keys != keys) {
+        memcpy(keys, source_keys, sizeof(uint64_t) * count);
+        memcpy(values, source_values, sizeof(uint32_t) * count);
+    }
+}
+
+void RenderQueue::Init(uint32_t recorder_count) {
+    recorders.Clear();
+    recorders.Resize(recorder_count);
+    recorder_offsets.Resize(recorder_count);
+}
+
+CommandBuffer* RenderQueue::Recorder(uint32_t index) {
+    return &recorders.Data()[index];
+}
+
+uint32_t RenderQueue::RecorderCount() const {
+    return static_cast<uint32_t>(recorders.Size());
+}
+
+void RenderQueue::Sort(utils::jobs::JobSystem* jobs) {
+    uint32_t count = 0;
+    uint32_t* offsets = recorder_offsets.Data();
+    for (uint32_t r = 0; r < recorders.Size(); ++r) {
+        offsets[r] = count;
+        count += recorders.Data()[r].Count();
+    }
+
+    sorted_keys.Resize(count);
+    sorted_draws.Resize(count);
+    scratch_keys.Resize(count);
+    scratch_draws.Resize(count);
+    payloads.Resize(count);
+    if (count == 0) return;
+
+    uint64_t* keys = sorted_keys.Data();
+    uint32_t* draws = sorted_draws.Data();
+    DrawPayload* merged = payloads.Data();
+    const CommandBuffer* buffers = recorders.Data();
+    auto gather = [buffers, offsets, keys, draws, merged](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+            const CommandBuffer& buffer = buffers[r];
+            uint32_t offset = offsets[r];
+            uint32_t recorded = buffer.Count();
+            memcpy(keys + offset, buffer.keys.Data(), sizeof(uint64_t) * recorded);
+            memcpy(merged + offset, buffer.payloads.Data(), sizeof(DrawPayload) * recorded);
+            for (uint32_t i = 0; i < recorded; ++i) draws[offset + i] = offset + i;
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, recorders.Size(), 1, gather);
+    } else {
+        gather(0, recorders.Size());
+    }
+
+    RadixSort(keys, draws, count, scratch_keys.Data(), scratch_draws.Data());
+}
+
+const uint64_t* RenderQueue::SortedKeys() const {
+    return sorted_keys.Data();
+}
+
+uint32_t RenderQueue::DrawCount() const {
+    return static_cast<uint32_t>(sorted_keys.Size());
+}
+
+void RenderQueue::Clear() {
+    for (uint32_t r = 0; r < recorders.Size(); ++r) recorders.Data()[r].Clear();
+}
+
+void NullBackend::BeginPass(uint32_t, uint32_t) {
+    ++passes;
+}
+
+void NullBackend::BindPipeline(uint32_t) {
+    ++pipeline_binds;
+}
+
+void NullBackend::BindMaterial(uint32_t) {
+    ++material_binds;
+}
+
+void NullBackend::Draw(const DrawPayload& payload) {
+    ++draws;
+    indices += uint64_t(payload.index_count) * payload.instance_count;
+}
+
+void NullBackend::Reset() {
+    passes = 0;
+    pipeline_binds = 0;
+    material_binds = 0;
+    draws = 0;
+    indices = 0;
+}
+
+} // namespace rendering
+} // namespace toybox
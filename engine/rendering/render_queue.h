@@ -0,0 +1,126 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint64_t
+
+#include "dynamicarray.h"
+#include "job_system.h"
+#include "sort_key.h"
+
+namespace toybox
+{
+namespace rendering
+{
+
+// What a backend needs to issue one indexed draw. Pipeline and material
+// travel in the sort key.
+struct DrawPayload {
+    uint32_t mesh;
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t first_instance;
+    uint32_t instance_count;
+};
+
+// An append-only list of draws recorded by one thread. Clearing keeps the
+// memory, so a warmed up frame records without allocating.
+struct CommandBuffer {
+private:
+    utils::data_structures::DynamicArray<uint64_t> keys;
+    utils::data_structures::DynamicArray<DrawPayload> payloads;
+
+    friend struct RenderQueue;
+
+public:
+    void Draw(uint64_t key, const DrawPayload& payload);
+
+    uint32_t Count() const;
+    void Clear();
+};
+
+// Sorts count keys in increasing order, carrying values along, with a stable
+// least-significant-digit radix sort over bytes. Bytes that are the same in
+// every key cost no pass. The scratch arrays need count entries each.
+void RadixSort(uint64_t* keys, uint32_t* values, uint32_t count, uint64_t* scratch_keys, uint32_t* scratch_values);
+
+// Backend-agnostic draw submission for a frame. Each recording thread owns a
+// CommandBuffer, typically picked by JobSystem::CurrentThreadIndex; Sort
+// merges them and orders the draws by key, and Execute replays them to a
+// backend, binding pipelines and materials only when the key changes them.
+//
+// A backend is any type with these members:
+//
+//     void BeginPass(uint32_t layer, uint32_t pass);
+//     void BindPipeline(uint32_t pipeline);
+//     void BindMaterial(uint32_t material);
+//     void Draw(const DrawPayload& payload);
+struct RenderQueue {
+private:
+    utils::data_structures::DynamicArray<CommandBuffer> recorders;
+    utils::data_structures::DynamicArray<uint64_t> sorted_keys;
+    utils::data_structures::DynamicArray<uint32_t> sorted_draws;
+    utils::data_structures::DynamicArray<uint64_t> scratch_keys;
+    utils::data_structures::DynamicArray<uint32_t> scratch_draws;
+    utils::data_structures::DynamicArray<uint32_t> recorder_offsets;
+    // Every recorder's payloads, back to back
+    utils::data_structures::DynamicArray<DrawPayload> payloads;
+
+public:
+    RenderQueue() = default;
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    // One recorder per thread that will record, e.g. ThreadCount() + 1 so the
+    // main thread has one too
+    void Init(uint32_t recorder_count);
+
+    CommandBuffer* Recorder(uint32_t index);
+    uint32_t RecorderCount() const;
+
+    // Merges every recorder's draws and sorts them; the job system, if given,
+    // copies the recorders in parallel
+    void Sort(utils::jobs::JobSystem* jobs = nullptr);
+
+    // Replays the sorted draws. Call after Sort.
+    template<typename Backend>
+    void Execute(Backend& backend) const;
+
+    // Sorted keys from the last Sort
+    const uint64_t* SortedKeys() const;
+    uint32_t DrawCount() const;
+
+    // Empties every recorder for the next frame
+    void Clear();
+};
+
+// A backend that draws nothing and counts what it was asked to do, for tests
+// and for measuring how well a frame's draws batch without a GPU
+struct NullBackend {
+    uint32_t passes = 0;
+    uint32_t pipeline_binds = 0;
+    uint32_t material_binds = 0;
+    uint32_t draws = 0;
+    uint64_t indices = 0;
+
+    void BeginPass(uint32_t layer, uint32_t pass);
+    void BindPipeline(uint32_t pipeline);
+    void BindMaterial(uint32_t material);
+    void Draw(const DrawPayload& payload);
+
+    void Reset();
+};
+
+} // namespace rendering
+} // namespace toybox
+
+#include "render_queue.inl"
@@ -0,0 +1,56 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint64_t
+
+namespace toybox
+{
+namespace rendering
+{
+
+template<typename Backend>
+void RenderQueue::Execute(Backend& backend) const {
+    const uint64_t* keys = sorted_keys.Data();
+    const uint32_t* draws = sorted_draws.Data();
+    const DrawPayload* all = payloads.Data();
+    uint32_t count = static_cast<uint32_t>(sorted_keys.Size());
+
+    uint64_t current_pass = ~uint64_t(0);
+    uint32_t current_pipeline = 0;
+    uint32_t current_material = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t key = keys[i];
+        uint32_t pipeline = SortKeyPipeline(key);
+        uint32_t material = SortKeyMaterial(key);
+        // Layer and pass together
+        bool new_pass = (key >> kSortPassShift) != current_pass;
+        if (new_pass) {
+            current_pass = key >> kSortPassShift;
+            backend.BeginPass(SortKeyLayer(key), SortKeyPass(key));
+        }
+        // Material bindings belong to the pipeline's layout, so a new
+        // pipeline needs its material bound again
+        bool new_pipeline = new_pass || pipeline != current_pipeline;
+        if (new_pipeline) {
+            current_pipeline = pipeline;
+            backend.BindPipeline(pipeline);
+        }
+        if (new_pipeline || material != current_material) {
+            current_material = material;
+            backend.BindMaterial(material);
+        }
+        backend.Draw(all[draws[i]]);
+    }
+}
+
+} // namespace rendering
+} // namespace toybox
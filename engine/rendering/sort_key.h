@@ -0,0 +1,94 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint64_t
+
+namespace toybox
+{
+namespace rendering
+{
+
+// A draw's 64-bit sort key. Sorting keys in increasing order gives the
+// submission order, so the most significant fields change least often.
+//
+//   opaque:  layer:4 | pass:5 | 0 | pipeline:14 | material:16 | depth:24
+//   blended: layer:4 | pass:5 | 1 | depth:24 | pipeline:14 | material:16
+//
+// Opaque draws group by pipeline, then material, then front to back depth.
+// Blended draws must be drawn back to front, so depth comes first and state
+// changes only group draws at the same depth.
+constexpr uint32_t kSortLayerBits = 4;
+constexpr uint32_t kSortPassBits = 5;
+constexpr uint32_t kSortPipelineBits = 14;
+constexpr uint32_t kSortMaterialBits = 16;
+constexpr uint32_t kSortDepthBits = 24;
+
+constexpr uint32_t kMaxSortLayers = 1u << kSortLayerBits;
+constexpr uint32_t kMaxSortPasses = 1u << kSortPassBits;
+constexpr uint32_t kMaxSortPipelines = 1u << kSortPipelineBits;
+constexpr uint32_t kMaxSortMaterials = 1u << kSortMaterialBits;
+constexpr uint32_t kMaxSortDepth = (1u << kSortDepthBits) - 1;
+
+constexpr uint32_t kSortLayerShift = 60;
+constexpr uint32_t kSortPassShift = 55;
+constexpr uint32_t kSortBlendedShift = 54;
+
+// Maps a view depth in [0, 1] (0 at the near plane) to the key's depth bits,
+// clamping anything outside
+inline uint32_t QuantizeDepth(float depth) {
+    if (!(depth > 0.0f)) return 0;
+    if (depth >= 1.0f) return kMaxSortDepth;
+    return static_cast<uint32_t>(depth * float(kMaxSortDepth));
+}
+
+// Fields outside their bit ranges are masked off
+inline uint64_t MakeOpaqueKey(uint32_t layer, uint32_t pass, uint32_t pipeline, uint32_t material, float depth) {
+    return (uint64_t(layer & (kMaxSortLayers - 1)) << kSortLayerShift) |
+           (uint64_t(pass & (kMaxSortPasses - 1)) << kSortPassShift) |
+           (uint64_t(pipeline & (kMaxSortPipelines - 1)) << (kSortMaterialBits + kSortDepthBits)) |
+           (uint64_t(material & (kMaxSortMaterials - 1)) << kSortDepthBits) | uint64_t(QuantizeDepth(depth));
+}
+
+inline uint64_t MakeBlendedKey(uint32_t layer, uint32_t pass, uint32_t pipeline, uint32_t material, float depth) {
+    // Farther first
+    uint32_t order = kMaxSortDepth - QuantizeDepth(depth);
+    return (uint64_t(layer & (kMaxSortLayers - 1)) << kSortLayerShift) |
+           (uint64_t(pass & (kMaxSortPasses - 1)) << kSortPassShift) | (uint64_t(1) << kSortBlendedShift) |
+           (uint64_t(order) << (kSortPipelineBits + kSortMaterialBits)) |
+           (uint64_t(pipeline & (kMaxSortPipelines - 1)) << kSortMaterialBits) |
+           uint64_t(material & (kMaxSortMaterials - 1));
+}
+
+inline uint32_t SortKeyLayer(uint64_t key) {
+    return uint32_t(key >> kSortLayerShift);
+}
+
+inline uint32_t SortKeyPass(uint64_t key) {
+    return uint32_t(key >> kSortPassShift) & (kMaxSortPasses - 1);
+}
+
+inline bool SortKeyBlended(uint64_t key) {
+    return ((key >> kSortBlendedShift) & 1) != 0;
+}
+
+inline uint32_t SortKeyPipeline(uint64_t key) {
+    uint32_t shift = SortKeyBlended(key) ? kSortMaterialBits : kSortMaterialBits + kSortDepthBits;
+    return uint32_t(key >> shift) & (kMaxSortPipelines - 1);
+}
+
+inline uint32_t SortKeyMaterial(uint64_t key) {
+    uint32_t shift = SortKeyBlended(key) ? 0 : kSortDepthBits;
+    return uint32_t(key >> shift) & (kMaxSortMaterials - 1);
+}
+
+} // namespace rendering
+} // namespace toybox
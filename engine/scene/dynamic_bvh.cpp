@@ -0,0 +1,444 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "dynamic_bvh.h"
+#include "parallel_for.h"
+
+namespace toybox
+{
+namespace scene
+{
+
+using math::Aabb;
+using math::Vec3;
+using utils::data_structures::DynamicArray;
+
+// Stretch factor applied to the expected displacement when fattening a box
+static const float kDisplacementMultiplier = 2.0f;
+
+// Binary min-heap on cost over a DynamicArray
+template<typename T>
+static void HeapPush(DynamicArray<T>& heap, const T& value) {
+    heap.PushBack(value);
+    T* data = heap.Data();
+    size_t i = heap.Size() - 1;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!(data[i].cost < data[parent].cost)) break;
+        T swap = data[i];
+        data[i] = data[parent];
+        data[parent] = swap;
+        i = parent;
+    }
+}
+
+template<typename T>
+static T HeapPop(DynamicArray<T>& heap) {
+    T* data = heap.Data();
+    T top = data[0];
+    data[0] = heap.Back();
+    heap.PopBack();
+    size_t size = heap.Size();
+    size_t i = 0;
+    for (;;) {
+        size_t smallest = i;
+        size_t left = i * 2 + 1;
+        size_t right = left + 1;
+        if (left < size && data[left].cost < data[smallest].cost) smallest = left;
+        if (right < size && data[right].cost < data[smallest].cost) smallest = right;
+        if (smallest == i) break;
+        T swap = data[i];
+        data[i] = data[smallest];
+        data[smallest] = swap;
+        i = smallest;
+    }
+    return top;
+}
+
+static int32_t MaxHeight(int32_t a, int32_t b) {
+    return a > b ? a : b;
+}
+
+DynamicBvh::DynamicBvh(float margin)
+    : nodes(16), tight_boxes(16), root(kNullProxy), free_list(kNullProxy), proxy_count(0), margin(margin) {}
+
+uint32_t DynamicBvh::AllocateNode() {
+    if (free_list == kNullProxy) {
+        // Grow the pool and thread the new nodes onto the free list
+        uint32_t old_size = static_cast<uint32_t>(nodes.Size());
+        uint32_t new_size = old_size > 0 ? old_size * 2 : 16;
+        nodes.Resize(new_size);
+        tight_boxes.Resize(new_size);
+        for (uint32_t i = old_size; i < new_size; ++i) {
+            Node& node = nodes.Data()[i];
+            node.parent = i + 1 < new_size ? i + 1 : kNullProxy;
+            node.height = -1;
+        }
+        free_list = old_size;
+    }
+
+    uint32_t index = free_list;
+    Node& node = nodes.Data()[index];
+    free_list = node.parent;
+    node.parent = kNullProxy;
+    node.left = kNullProxy;
+    node.right = kNullProxy;
+    node.height = 0;
+    node.user_data = 0;
+    return index;
+}
+
+void DynamicBvh::FreeNode(uint32_t index) {
+    Node& node = nodes.Data()[index];
+    node.parent = free_list;
+    node.height = -1;
+    free_list = index;
+}
+
+uint32_t DynamicBvh::FindBestSibling(const Aabb& box, uint32_t hint) {
+    // Branch and bound over the tree. Pairing the new leaf with a node costs
+    // the area of their union plus the growth of every ancestor ("inherited"
+    // cost). A subtree can be skipped once the leaf's own area plus the cost
+    // inherited so far cannot beat the best found.
+    float leaf_area = math::SurfaceArea(box);
+    uint32_t best = root;
+    float best_cost = math::SurfaceArea(math::Union(nodes.Data()[root].box, box));
+
+    // A leaf that moved a little usually belongs next to its old sibling.
+    // Starting from that pairing's cost prunes most of the search.
+    if (hint != kNullProxy) {
+        float cost = math::SurfaceArea(math::Union(nodes.Data()[hint].box, box));
+        for (uint32_t index = nodes.Data()[hint].parent; index != kNullProxy; index = nodes.Data()[index].parent) {
+            const Aabb& ancestor = nodes.Data()[index].box;
+            cost += math::SurfaceArea(math::Union(ancestor, box)) - math::SurfaceArea(ancestor);
+        }
+        if (cost < best_cost) {
+            best_cost = cost;
+            best = hint;
+        }
+    }
+
+    candidates.Clear();
+    HeapPush(candidates, Candidate{ 0.0f, root });
+    while (!candidates.Empty()) {
+        Candidate candidate = HeapPop(candidates);
+        if (leaf_area + candidate.cost >= best_cost) break;
+
+        const Node& node = nodes.Data()[candidate.node];
+        float direct = math::SurfaceArea(math::Union(node.box, box));
+        float cost = direct + candidate.cost;
+        if (cost < best_cost) {
+            best_cost = cost;
+            best = candidate.node;
+        }
+
+        float inherited = candidate.cost + direct - math::SurfaceArea(node.box);
+        if (node.left != kNullProxy && leaf_area + inherited < best_cost) {
+            HeapPush(candidates, Candidate{ inherited, node.left });
+            HeapPush(candidates, Candidate{ inherited, node.right });
+        }
+    }
+    return best;
+}
+
+void DynamicBvh::Refit(uint32_t index) {
+    Node& node = nodes.Data()[index];
+    const Node& left = nodes.Data()[node.left];
+    const Node& right = nodes.Data()[node.right];
+    node.box = math::Union(left.box, right.box);
+    node.height = 1 + MaxHeight(left.height, right.height);
+}
+
+void DynamicBvh::InsertLeaf(uint32_t leaf, uint32_t hint) {
+    if (root == kNullProxy) {
+        root = leaf;
+        nodes.Data()[leaf].parent = kNullProxy;
+        return;
+    }
+
+    uint32_t sibling = FindBestSibling(nodes.Data()[leaf].box, hint);
+    // Allocate before taking references; the pool may grow
+    uint32_t new_parent = AllocateNode();
+    Node* data = nodes.Data();
+    uint32_t old_parent = data[sibling].parent;
+
+    data[new_parent].parent = old_parent;
+    data[new_parent].left = sibling;
+    data[new_parent].right = leaf;
+    data[sibling].parent = new_parent;
+    data[leaf].parent = new_parent;
+    Refit(new_parent);
+
+    if (old_parent == kNullProxy) {
+        root = new_parent;
+    } else if (data[old_parent].left == sibling) {
+        data[old_parent].left = new_parent;
+    } else {
+        data[old_parent].right = new_parent;
+    }
+
+    for (uint32_t index = old_parent; index != kNullProxy; index = nodes.Data()[index].parent) {
+        index = Balance(index);
+        Refit(index);
+    }
+}
+
+void DynamicBvh::RemoveLeaf(uint32_t leaf) {
+    if (leaf == root) {
+        root = kNullProxy;
+        return;
+    }
+
+    Node* data = nodes.Data();
+    uint32_t parent = data[leaf].parent;
+    uint32_t grandparent = data[parent].parent;
+    uint32_t sibling = data[parent].left == leaf ? data[parent].right : data[parent].left;
+
+    FreeNode(parent);
+    data[sibling].parent = grandparent;
+    if (grandparent == kNullProxy) {
+        root = sibling;
+        return;
+    }
+
+    if (data[grandparent].left == parent) {
+        data[grandparent].left = sibling;
+    } else {
+        data[grandparent].right = sibling;
+    }
+    for (uint32_t index = grandparent; index != kNullProxy; index = data[index].parent) {
+        index = Balance(index);
+        Refit(index);
+    }
+}
+
+// Rotates the taller child of a up when the subtrees differ in height by more
+// than one. Returns the node now in a's place.
+uint32_t DynamicBvh::Balance(uint32_t a) {
+    Node* data = nodes.Data();
+    if (data[a].left == kNullProxy || data[a].height < 2) return a;
+
+    uint32_t b = data[a].left;
+    uint32_t c = data[a].right;
+    int32_t balance = data[c].height - data[b].height;
+    if (balance >= -1 && balance <= 1) return a;
+
+    // up is the taller child; it takes a's place, and a adopts one of its children
+    bool right_heavy = balance > 1;
+    uint32_t up = right_heavy ? c : b;
+    uint32_t stay = right_heavy ? b : c;
+    uint32_t f = data[up].left;
+    uint32_t g = data[up].right;
+
+    data[up].left = a;
+    data[up].parent = data[a].parent;
+    data[a].parent = up;
+    if (data[up].parent == kNullProxy) {
+        root = up;
+    } else if (data[data[up].parent].left == a) {
+        data[data[up].parent].left = up;
+    } else {
+        data[data[up].parent].right = up;
+    }
+
+    // The taller grandchild stays with up, the shorter moves under a
+    uint32_t keep = data[f].height > data[g].height ? f : g;
+    uint32_t give = keep == f ? g : f;
+    data[up].right = keep;
+    data[give].parent = a;
+    if (right_heavy) {
+        data[a].left = stay;
+        data[a].right = give;
+    } else {
+        data[a].left = give;
+        data[a].right = stay;
+    }
+
+    Refit(a);
+    Refit(up);
+    return up;
+}
+
+uint32_t DynamicBvh::CreateProxy(const Aabb& box, uint32_t user_data) {
+    uint32_t proxy = AllocateNode();
+    Node& node = nodes.Data()[proxy];
+    node.box = math::Expand(box, margin);
+    node.user_data = user_data;
+    tight_boxes.Data()[proxy] = box;
+    InsertLeaf(proxy);
+    ++proxy_count;
+    return proxy;
+}
+
+void DynamicBvh::DestroyProxy(uint32_t proxy) {
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --proxy_count;
+}
+
+bool DynamicBvh::MoveProxy(uint32_t proxy, const Aabb& box, Vec3 displacement) {
+    tight_boxes.Data()[proxy] = box;
+
+    Aabb fat = math::Expand(box, margin);
+    Vec3 stretch = displacement * kDisplacementMultiplier;
+    fat.min = fat.min + math::Min(stretch, Vec3{ 0.0f, 0.0f, 0.0f });
+    fat.max = fat.max + math::Max(stretch, Vec3{ 0.0f, 0.0f, 0.0f });
+
+    // Keep the old fat box while it still fits and has not grown far larger
+    // than needed, as it would after a fast mover stops
+    const Aabb& current = nodes.Data()[proxy].box;
+    if (math::Contains(current, box) && math::Contains(math::Expand(fat, 4.0f * margin), current)) {
+        return false;
+    }
+
+    uint32_t sibling = kNullProxy;
+    uint32_t parent = nodes.Data()[proxy].parent;
+    if (parent != kNullProxy) {
+        sibling = nodes.Data()[parent].left == proxy ? nodes.Data()[parent].right : nodes.Data()[parent].left;
+    }
+    RemoveLeaf(proxy);
+    nodes.Data()[proxy].box = fat;
+    InsertLeaf(proxy, sibling);
+    return true;
+}
+
+const Aabb& DynamicBvh::TightBox(uint32_t proxy) const {
+    return tight_boxes.Data()[proxy];
+}
+
+const Aabb& DynamicBvh::FatBox(uint32_t proxy) const {
+    return nodes.Data()[proxy].box;
+}
+
+uint32_t DynamicBvh::UserData(uint32_t proxy) const {
+    return nodes.Data()[proxy].user_data;
+}
+
+RayHit DynamicBvh::RayCastClosest(const math::Ray& ray) const {
+    RayHit hit = { kNullProxy, ray.max_distance };
+    RayCast(ray, [&hit](uint32_t proxy, float distance) {
+        hit.proxy = proxy;
+        hit.distance = distance;
+        return distance;
+    });
+    return hit;
+}
+
+void DynamicBvh::RayCastBatch(const math::Ray* rays, RayHit* hits, size_t count, utils::jobs::JobSystem* jobs) const {
+    auto cast = [this, rays, hits](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            hits[i] = RayCastClosest(rays[i]);
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, count, cast);
+    } else {
+        cast(0, count);
+    }
+}
+
+void DynamicBvh::QueryFrustums(const math::Frustum* frustums, DynamicArray<uint32_t>* results, size_t count,
+                               utils::jobs::JobSystem* jobs) const {
+    auto query = [this, frustums, results](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            DynamicArray<uint32_t>& visible = results[i];
+            visible.Clear();
+            QueryFrustum(frustums[i], [&visible](uint32_t proxy) {
+                visible.PushBack(proxy);
+                return true;
+            });
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, count, 1, query);
+    } else {
+        query(0, count);
+    }
+}
+
+uint32_t DynamicBvh::KNearest(Vec3 point, uint32_t k, uint32_t* proxies, float* distances_squared) const {
+    if (root == kNullProxy || k == 0) return 0;
+
+    // Best first: always expand the node closest to the point, and stop once
+    // it is farther than the k-th best so far. The queue is kept per thread,
+    // so a query only allocates while it is still growing.
+    static thread_local DynamicArray<Candidate> queue(64);
+    queue.Clear();
+    HeapPush(queue, Candidate{ math::DistanceSquared(nodes.Data()[root].box, point), root });
+    uint32_t found = 0;
+    while (!queue.Empty()) {
+        Candidate candidate = HeapPop(queue);
+        if (found == k && candidate.cost >= distances_squared[k - 1]) break;
+
+        const Node& node = nodes.Data()[candidate.node];
+        if (node.left != kNullProxy) {
+            HeapPush(queue, Candidate{ math::DistanceSquared(nodes.Data()[node.left].box, point), node.left });
+            HeapPush(queue, Candidate{ math::DistanceSquared(nodes.Data()[node.right].box, point), node.right });
+            continue;
+        }
+
+        // Insert into the sorted results, dropping the farthest when full
+        float distance = math::DistanceSquared(tight_boxes.Data()[candidate.node], point);
+        if (found == k && distance >= distances_squared[k - 1]) continue;
+        uint32_t slot = found < k ? found++ : k - 1;
+        while (slot > 0 && distances_squared[slot - 1] > distance) {
+            proxies[slot] = proxies[slot - 1];
+            distances_squared[slot] = distances_squared[slot - 1];
+            --slot;
+        }
+        proxies[slot] = candidate.node;
+        distances_squared[slot] = distance;
+    }
+    return found;
+}
+
+uint32_t DynamicBvh::ProxyCount() const {
+    return proxy_count;
+}
+
+uint32_t DynamicBvh::Height() const {
+    return root == kNullProxy ? 0 : static_cast<uint32_t>(nodes.Data()[root].height);
+}
+
+uint32_t DynamicBvh::Capacity() const {
+    return static_cast<uint32_t>(nodes.Size());
+}
+
+bool DynamicBvh::Validate() const {
+    if (root == kNullProxy) return proxy_count == 0;
+    if (nodes.Data()[root].parent != kNullProxy) return false;
+
+    uint32_t leaves = 0;
+    uint32_t stack[kQueryStackSize];
+    uint32_t top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const Node& node = nodes.Data()[index];
+        if (node.left == kNullProxy) {
+            if (node.height != 0 || !math::Contains(node.box, tight_boxes.Data()[index])) return false;
+            ++leaves;
+            continue;
+        }
+
+        const Node& left = nodes.Data()[node.left];
+        const Node& right = nodes.Data()[node.right];
+        if (left.parent != index || right.parent != index) return false;
+        if (node.height != 1 + MaxHeight(left.height, right.height)) return false;
+        if (!math::Contains(node.box, left.box) || !math::Contains(node.box, right.box)) return false;
+        if (top + 2 > kQueryStackSize) return false;
+        stack[top++] = node.left;
+        stack[top++] = node.right;
+    }
+    return leaves == proxy_count;
+}
+
+} // namespace scene
+} // namespace toybox
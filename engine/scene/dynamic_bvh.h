@@ -0,0 +1,143 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint32_t, int32_t
+
+#include "dynamicarray.h"
+#include "geometry.h"
+#include "job_system.h"
+
+namespace toybox
+{
+namespace scene
+{
+
+constexpr uint32_t kNullProxy = 0xFFFFFFFF;
+
+struct RayHit {
+    uint32_t proxy; // kNullProxy for a miss
+    float distance;
+};
+
+// Bounding volume hierarchy over boxes that move every frame. Each proxy is a
+// leaf holding the caller's tight box and a fattened copy; moves that stay
+// inside the fat box cost nothing, and the rest remove and reinsert a single
+// leaf. Insertion picks the sibling with the lowest surface area cost by
+// branch and bound, and AVL rotations on the way up keep the tree shallow.
+//
+// Nodes live in one pooled array with an intrusive free list, and proxy IDs
+// are leaf indices into it, stable until the proxy is destroyed.
+struct DynamicBvh {
+private:
+    struct Node {
+        math::Aabb box;  // Fat box for leaves
+        uint32_t parent; // Next free node while pooled
+        uint32_t left;   // kNullProxy for leaves
+        uint32_t right;
+        int32_t height;  // 0 for leaves, -1 while pooled
+        uint32_t user_data;
+    };
+
+    // Traversal stacks are fixed; balancing keeps the height well below this
+    static constexpr uint32_t kQueryStackSize = 256;
+
+    utils::data_structures::DynamicArray<Node> nodes;
+    utils::data_structures::DynamicArray<math::Aabb> tight_boxes; // By leaf
+    uint32_t root;
+    uint32_t free_list;
+    uint32_t proxy_count;
+    float margin;
+
+    // Search queue entry for insertion and KNearest
+    struct Candidate {
+        float cost;
+        uint32_t node;
+    };
+    utils::data_structures::DynamicArray<Candidate> candidates;
+
+    uint32_t AllocateNode();
+    void FreeNode(uint32_t node);
+    uint32_t FindBestSibling(const math::Aabb& box, uint32_t hint);
+    void InsertLeaf(uint32_t leaf, uint32_t hint = kNullProxy);
+    void RemoveLeaf(uint32_t leaf);
+    uint32_t Balance(uint32_t node);
+    void Refit(uint32_t node);
+    bool IsLeaf(uint32_t node) const;
+
+    template<typename Fn>
+    bool ReportSubtree(uint32_t node, const Fn& fn) const;
+
+public:
+    // margin fattens every proxy box so small moves need no tree update
+    explicit DynamicBvh(float margin = 0.1f);
+
+    DynamicBvh(const DynamicBvh&) = delete;
+    DynamicBvh& operator=(const DynamicBvh&) = delete;
+
+    uint32_t CreateProxy(const math::Aabb& box, uint32_t user_data);
+    void DestroyProxy(uint32_t proxy);
+
+    // displacement is the expected motion until the next move; the fat box is
+    // stretched along it. Returns true if the leaf had to be reinserted.
+    bool MoveProxy(uint32_t proxy, const math::Aabb& box, math::Vec3 displacement = math::Vec3{ 0.0f, 0.0f, 0.0f });
+
+    const math::Aabb& TightBox(uint32_t proxy) const;
+    const math::Aabb& FatBox(uint32_t proxy) const;
+    uint32_t UserData(uint32_t proxy) const;
+
+    // fn(proxy) for every proxy whose tight box overlaps box. Return false from
+    // fn to stop early.
+    template<typename Fn>
+    void QueryBox(const math::Aabb& box, const Fn& fn) const;
+
+    // fn(proxy) for every proxy whose tight box is at least partly inside.
+    // Return false from fn to stop early.
+    template<typename Fn>
+    void QueryFrustum(const math::Frustum& frustum, const Fn& fn) const;
+
+    // fn(proxy, distance) for proxies whose tight box the ray hits, nearer
+    // subtrees first. fn returns the new maximum distance: the hit distance to
+    // keep only closer hits, ray.max_distance to see them all, or zero to stop.
+    template<typename Fn>
+    void RayCast(const math::Ray& ray, const Fn& fn) const;
+
+    // Nearest tight box along the ray
+    RayHit RayCastClosest(const math::Ray& ray) const;
+
+    // RayCastClosest for every ray, split across the job system if given
+    void RayCastBatch(const math::Ray* rays, RayHit* hits, size_t count,
+                      utils::jobs::JobSystem* jobs = nullptr) const;
+
+    // QueryFrustum for every frustum into results[i], which is cleared first.
+    // Frustums run in parallel if a job system is given.
+    void QueryFrustums(const math::Frustum* frustums, utils::data_structures::DynamicArray<uint32_t>* results,
+                       size_t count, utils::jobs::JobSystem* jobs = nullptr) const;
+
+    // Up to k proxies nearest to point, measured to their tight boxes, nearest
+    // first. Returns how many were written.
+    uint32_t KNearest(math::Vec3 point, uint32_t k, uint32_t* proxies, float* distances_squared) const;
+
+    uint32_t ProxyCount() const;
+    uint32_t Height() const;
+
+    // Pooled nodes, in use or free
+    uint32_t Capacity() const;
+
+    // Checks links, heights and bounds; for tests
+    bool Validate() const;
+};
+
+} // namespace scene
+} // namespace toybox
+
+#include "dynamic_bvh.inl"
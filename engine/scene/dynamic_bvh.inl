@@ -0,0 +1,144 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t
+#include <cstdlib> // For abort
+
+namespace toybox
+{
+namespace scene
+{
+
+inline bool DynamicBvh::IsLeaf(uint32_t node) const {
+    return nodes.Data()[node].left == kNullProxy;
+}
+
+template<typename Fn>
+bool DynamicBvh::ReportSubtree(uint32_t node, const Fn& fn) const {
+    uint32_t stack[kQueryStackSize];
+    uint32_t top = 0;
+    stack[top++] = node;
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const Node& current = nodes.Data()[index];
+        if (current.left == kNullProxy) {
+            if (!fn(index)) return false;
+            continue;
+        }
+        if (top + 2 > kQueryStackSize) abort();
+        stack[top++] = current.left;
+        stack[top++] = current.right;
+    }
+    return true;
+}
+
+template<typename Fn>
+void DynamicBvh::QueryBox(const math::Aabb& box, const Fn& fn) const {
+    if (root == kNullProxy) return;
+
+    uint32_t stack[kQueryStackSize];
+    uint32_t top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const Node& node = nodes.Data()[index];
+        if (!math::Overlaps(node.box, box)) continue;
+
+        if (node.left == kNullProxy) {
+            if (math::Overlaps(tight_boxes.Data()[index], box) && !fn(index)) return;
+            continue;
+        }
+        if (top + 2 > kQueryStackSize) abort();
+        stack[top++] = node.left;
+        stack[top++] = node.right;
+    }
+}
+
+template<typename Fn>
+void DynamicBvh::QueryFrustum(const math::Frustum& frustum, const Fn& fn) const {
+    if (root == kNullProxy) return;
+
+    uint32_t stack[kQueryStackSize];
+    uint32_t top = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const Node& node = nodes.Data()[index];
+        math::Containment containment = math::Classify(frustum, node.box);
+        if (containment == math::Containment::Outside) continue;
+
+        if (node.left == kNullProxy) {
+            if (math::Classify(frustum, tight_boxes.Data()[index]) != math::Containment::Outside && !fn(index)) {
+                return;
+            }
+            continue;
+        }
+        // Fat boxes contain the tight ones, so the whole subtree is visible
+        if (containment == math::Containment::Inside) {
+            if (!ReportSubtree(index, fn)) return;
+            continue;
+        }
+        if (top + 2 > kQueryStackSize) abort();
+        stack[top++] = node.left;
+        stack[top++] = node.right;
+    }
+}
+
+template<typename Fn>
+void DynamicBvh::RayCast(const math::Ray& ray, const Fn& fn) const {
+    if (root == kNullProxy) return;
+
+    math::Vec3 inverse = math::InverseDirection(ray.direction);
+    float max_distance = ray.max_distance;
+
+    struct Entry {
+        uint32_t node;
+        float distance;
+    };
+    Entry stack[kQueryStackSize];
+    uint32_t top = 0;
+    float root_distance = math::RayIntersect(nodes.Data()[root].box, ray.origin, inverse, max_distance);
+    if (root_distance < 0.0f) return;
+    stack[top++] = Entry{ root, root_distance };
+
+    while (top > 0) {
+        Entry entry = stack[--top];
+        // Skip boxes that now start beyond a closer hit
+        if (entry.distance > max_distance) continue;
+
+        const Node& node = nodes.Data()[entry.node];
+        if (node.left == kNullProxy) {
+            float distance = math::RayIntersect(tight_boxes.Data()[entry.node], ray.origin, inverse, max_distance);
+            if (distance < 0.0f) continue;
+            max_distance = fn(entry.node, distance);
+            if (max_distance <= 0.0f) return;
+            continue;
+        }
+
+        float left = math::RayIntersect(nodes.Data()[node.left].box, ray.origin, inverse, max_distance);
+        float right = math::RayIntersect(nodes.Data()[node.right].box, ray.origin, inverse, max_distance);
+        if (top + 2 > kQueryStackSize) abort();
+        // Push the farther child first so the nearer one is visited first
+        if (left >= 0.0f && right >= 0.0f) {
+            bool left_first = left <= right;
+            stack[top++] = left_first ? Entry{ node.right, right } : Entry{ node.left, left };
+            stack[top++] = left_first ? Entry{ node.left, left } : Entry{ node.right, right };
+        } else if (left >= 0.0f) {
+            stack[top++] = Entry{ node.left, left };
+        } else if (right >= 0.0f) {
+            stack[top++] = Entry{ node.right, right };
+        }
+    }
+}
+
+} // namespace scene
+} // namespace toybox
@@ -0,0 +1,98 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "parallel_for.h"
+#include "spatial_hash_grid.h"
+
+namespace toybox
+{
+namespace scene
+{
+
+static const uint32_t kMinBuckets = 64;
+
+SpatialHashGrid::SpatialHashGrid(float cell_size)
+    : cell_size(cell_size), inverse_cell_size(1.0f / cell_size), bucket_mask(0), row_shift(0) {
+    bucket_start.ReserveAndInitialize(2, 0);
+}
+
+void SpatialHashGrid::Build(const float* x, const float* y, uint32_t count, utils::jobs::JobSystem* jobs) {
+    // About one bucket per point, in rows of roughly the square root
+    uint32_t buckets = kMinBuckets;
+    while (buckets < count) buckets *= 2;
+    bucket_mask = buckets - 1;
+    row_shift = 0;
+    while ((1u << (row_shift * 2)) < buckets) ++row_shift;
+
+    point_buckets.Resize(count);
+    points.Resize(count);
+    bucket_start.Resize(buckets + 1);
+    bucket_start.Fill(0);
+
+    // Hash every point
+    uint32_t* point_bucket = point_buckets.Data();
+    auto hash = [this, x, y, point_bucket](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            point_bucket[i] = BucketOf(CellOf(x[i]), CellOf(y[i]));
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, count, hash);
+    } else {
+        hash(0, count);
+    }
+
+    // Counting sort. Count into start[b + 1], prefix sum so start[b] is the
+    // first slot of bucket b, then scatter by bumping start[b]. Afterwards
+    // start[b] holds the end of bucket b, so shift everything back by one.
+    uint32_t* start = bucket_start.Data();
+    for (uint32_t i = 0; i < count; ++i) {
+        ++start[point_bucket[i] + 1];
+    }
+    for (uint32_t b = 0; b < buckets; ++b) {
+        start[b + 1] += start[b];
+    }
+    GridPoint* sorted = points.Data();
+    for (uint32_t i = 0; i < count; ++i) {
+        sorted[start[point_bucket[i]]++].id = i;
+    }
+    for (uint32_t b = buckets; b > 0; --b) {
+        start[b] = start[b - 1];
+    }
+    start[0] = 0;
+
+    // Copy positions into sorted order so queries read them contiguously
+    auto gather = [x, y, sorted](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            sorted[i].x = x[sorted[i].id];
+            sorted[i].y = y[sorted[i].id];
+        }
+    };
+    if (jobs) {
+        utils::jobs::ParallelFor(jobs, 0, count, gather);
+    } else {
+        gather(0, count);
+    }
+}
+
+uint32_t SpatialHashGrid::Count() const {
+    return static_cast<uint32_t>(points.Size());
+}
+
+uint32_t SpatialHashGrid::BucketCount() const {
+    return bucket_mask + 1;
+}
+
+float SpatialHashGrid::CellSize() const {
+    return cell_size;
+}
+
+} // namespace scene
+} // namespace toybox
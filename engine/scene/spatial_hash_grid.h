@@ -0,0 +1,109 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, int32_t
+
+#include "dynamicarray.h"
+#include "job_system.h"
+
+namespace toybox
+{
+namespace scene
+{
+
+// Uniform grid over 2D points, hashed so the world needs no bounds. Build
+// counting-sorts every point by cell into flat arrays; rebuild it once per
+// frame after things move. Queries visit cells and test the sorted positions.
+//
+// The hash wraps the grid row by row onto the bucket table, so a run of
+// cells along x is a run of buckets, and a query reads one contiguous span
+// of points per row of cells. Cells that share a bucket are filtered out by
+// the queries, so collisions cost time but never produce wrong results.
+struct SpatialHashGrid {
+private:
+    float cell_size;
+    float inverse_cell_size;
+    uint32_t bucket_mask;
+    uint32_t row_shift; // Buckets per row of cells, as a power of two
+
+    struct GridPoint {
+        float x;
+        float y;
+        uint32_t id;
+    };
+
+    // Bucket of each input point, in input order
+    utils::data_structures::DynamicArray<uint32_t> point_buckets;
+    // Points of bucket b are points[bucket_start[b], bucket_start[b + 1])
+    utils::data_structures::DynamicArray<uint32_t> bucket_start;
+    utils::data_structures::DynamicArray<GridPoint> points;
+
+    int32_t CellOf(float coordinate) const;
+    uint32_t BucketOf(int32_t cell_x, int32_t cell_y) const;
+
+    // True if no two cells in the range share a bucket, and cells that share
+    // a bucket with one in the range lie far outside it
+    bool Unaliased(int32_t min_x, int32_t min_y, int32_t max_x, int32_t max_y) const;
+
+    // fn(point) for the points in cells min_x..max_x of row cell_y; false
+    // from fn stops. Without filter, points from other cells sharing these
+    // buckets are passed too, which is only safe for unaliased ranges and an
+    // fn that tests positions exactly.
+    template<typename Fn>
+    bool VisitRow(int32_t cell_y, int32_t min_x, int32_t max_x, bool filter, const Fn& fn) const;
+
+public:
+    explicit SpatialHashGrid(float cell_size = 1.0f);
+
+    SpatialHashGrid(const SpatialHashGrid&) = delete;
+    SpatialHashGrid& operator=(const SpatialHashGrid&) = delete;
+
+    // Replaces the contents with points 0..count-1. Queries report these
+    // indices. With a job system, hashing and gathering run in parallel; the
+    // result is identical to a serial build.
+    void Build(const float* x, const float* y, uint32_t count, utils::jobs::JobSystem* jobs = nullptr);
+
+    // fn(id) for every point within radius of (x, y). Return false from fn to
+    // stop early.
+    template<typename Fn>
+    void QueryRadius(float x, float y, float radius, const Fn& fn) const;
+
+    // fn(id) for every point inside the box, edges included
+    template<typename Fn>
+    void QueryBox(float min_x, float min_y, float max_x, float max_y, const Fn& fn) const;
+
+    // fn(a, b) once for every pair of points within radius of each other.
+    // Walks the points in cell order, so it is much faster than a radius
+    // query per point.
+    template<typename Fn>
+    void ForEachPair(float radius, const Fn& fn) const;
+
+    // fn(cell_x, cell_y) for every cell the segment passes through, in order
+    // from the start. Returns false if fn stopped the walk by returning false;
+    // with a tile map this is a line-of-sight test.
+    template<typename Fn>
+    bool TraceCells(float x0, float y0, float x1, float y1, const Fn& fn) const;
+
+    // fn(id) for the points in every cell the segment passes through, cell by
+    // cell from the start, so the first blocker found is one of the nearest.
+    template<typename Fn>
+    void QueryLine(float x0, float y0, float x1, float y1, const Fn& fn) const;
+
+    uint32_t Count() const;
+    uint32_t BucketCount() const;
+    float CellSize() const;
+};
+
+} // namespace scene
+} // namespace toybox
+
+#include "spatial_hash_grid.inl"
@@ -0,0 +1,205 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cmath>   // For ceilf, fabsf
+#include <cstdint> // For uint32_t, int32_t
+
+namespace toybox
+{
+namespace scene
+{
+
+inline int32_t SpatialHashGrid::CellOf(float coordinate) const {
+    // floorf is a library call without SSE4.1; truncate and fix up negatives
+    float scaled = coordinate * inverse_cell_size;
+    int32_t cell = static_cast<int32_t>(scaled);
+    return cell - (scaled < static_cast<float>(cell) ? 1 : 0);
+}
+
+inline uint32_t SpatialHashGrid::BucketOf(int32_t cell_x, int32_t cell_y) const {
+    return ((static_cast<uint32_t>(cell_y) << row_shift) + static_cast<uint32_t>(cell_x)) & bucket_mask;
+}
+
+inline bool SpatialHashGrid::Unaliased(int32_t min_x, int32_t min_y, int32_t max_x, int32_t max_y) const {
+    // Rows are (1 << row_shift) buckets apart and the table holds
+    // (bucket_mask + 1) >> row_shift of them before wrapping
+    uint32_t width = static_cast<uint32_t>(max_x - min_x);
+    uint32_t height = static_cast<uint32_t>(max_y - min_y);
+    return width < (1u << row_shift) && height < ((bucket_mask + 1) >> row_shift);
+}
+
+template<typename Fn>
+bool SpatialHashGrid::VisitRow(int32_t cell_y, int32_t min_x, int32_t max_x, bool filter, const Fn& fn) const {
+    const uint32_t* start = bucket_start.Data();
+    const GridPoint* data = points.Data();
+
+    // The row's buckets are consecutive, wrapping at most once at the end of
+    // the table, so its points lie in one or two contiguous spans
+    uint32_t spans[2][2];
+    uint32_t span_count = 1;
+    uint32_t cells = static_cast<uint32_t>(max_x - min_x) + 1;
+    uint32_t first = BucketOf(min_x, cell_y);
+    if (cells > bucket_mask) {
+        spans[0][0] = 0;
+        spans[0][1] = start[bucket_mask + 1];
+    } else if (first + cells - 1 <= bucket_mask) {
+        spans[0][0] = start[first];
+        spans[0][1] = start[first + cells];
+    } else {
+        spans[0][0] = start[first];
+        spans[0][1] = start[bucket_mask + 1];
+        spans[1][0] = 0;
+        spans[1][1] = start[(first + cells) & bucket_mask];
+        span_count = 2;
+    }
+
+    for (uint32_t s = 0; s < span_count; ++s) {
+        for (uint32_t i = spans[s][0]; i < spans[s][1]; ++i) {
+            const GridPoint& point = data[i];
+            if (filter) {
+                // Skip points from cells that share these buckets
+                int32_t cx = CellOf(point.x);
+                if (cx < min_x || cx > max_x || CellOf(point.y) != cell_y) continue;
+            }
+            if (!fn(point)) return false;
+        }
+    }
+    return true;
+}
+
+template<typename Fn>
+void SpatialHashGrid::QueryRadius(float x, float y, float radius, const Fn& fn) const {
+    if (points.Empty()) return;
+
+    float radius_squared = radius * radius;
+    int32_t min_x = CellOf(x - radius);
+    int32_t max_x = CellOf(x + radius);
+    int32_t min_y = CellOf(y - radius);
+    int32_t max_y = CellOf(y + radius);
+    // The distance test rejects strays from far-off cells on its own
+    bool filter = !Unaliased(min_x, min_y, max_x, max_y);
+
+    for (int32_t cy = min_y; cy <= max_y; ++cy) {
+        bool more = VisitRow(cy, min_x, max_x, filter, [&](const GridPoint& point) {
+            float dx = point.x - x;
+            float dy = point.y - y;
+            return dx * dx + dy * dy > radius_squared || fn(point.id);
+        });
+        if (!more) return;
+    }
+}
+
+template<typename Fn>
+void SpatialHashGrid::QueryBox(float min_x, float min_y, float max_x, float max_y, const Fn& fn) const {
+    if (points.Empty()) return;
+
+    int32_t first_x = CellOf(min_x);
+    int32_t first_y = CellOf(min_y);
+    int32_t last_x = CellOf(max_x);
+    int32_t last_y = CellOf(max_y);
+    bool filter = !Unaliased(first_x, first_y, last_x, last_y);
+
+    for (int32_t cy = first_y; cy <= last_y; ++cy) {
+        bool more = VisitRow(cy, first_x, last_x, filter, [&](const GridPoint& point) {
+            bool inside = point.x >= min_x && point.x <= max_x && point.y >= min_y && point.y <= max_y;
+            return !inside || fn(point.id);
+        });
+        if (!more) return;
+    }
+}
+
+template<typename Fn>
+void SpatialHashGrid::ForEachPair(float radius, const Fn& fn) const {
+    float radius_squared = radius * radius;
+    int32_t reach = static_cast<int32_t>(ceilf(radius * inverse_cell_size));
+    const uint32_t* start = bucket_start.Data();
+    const GridPoint* data = points.Data();
+    uint32_t count = static_cast<uint32_t>(points.Size());
+
+    // Pair each point with the later points of its own cell, the next cells
+    // along its row, and the cells in the rows below, so each pair is seen
+    // exactly once
+    for (uint32_t i = 0; i < count; ++i) {
+        const GridPoint& a = data[i];
+        int32_t cx = CellOf(a.x);
+        int32_t cy = CellOf(a.y);
+        bool filter = !Unaliased(cx - reach, cy, cx + reach, cy + reach);
+        auto test = [&](const GridPoint& b) {
+            float dx = b.x - a.x;
+            float dy = b.y - a.y;
+            if (dx * dx + dy * dy <= radius_squared) fn(a.id, b.id);
+            return true;
+        };
+
+        uint32_t end = start[BucketOf(cx, cy) + 1];
+        for (uint32_t j = i + 1; j < end; ++j) {
+            const GridPoint& b = data[j];
+            if (filter && (CellOf(b.x) != cx || CellOf(b.y) != cy)) continue;
+            test(b);
+        }
+        if (reach > 0) VisitRow(cy, cx + 1, cx + reach, filter, test);
+        for (int32_t row = cy + 1; row <= cy + reach; ++row) {
+            VisitRow(row, cx - reach, cx + reach, filter, test);
+        }
+    }
+}
+
+template<typename Fn>
+bool SpatialHashGrid::TraceCells(float x0, float y0, float x1, float y1, const Fn& fn) const {
+    // Amanatides-Woo grid walk, parameterised by t from 0 at the start to 1
+    // at the end
+    int32_t cx = CellOf(x0);
+    int32_t cy = CellOf(y0);
+    int32_t end_x = CellOf(x1);
+    int32_t end_y = CellOf(y1);
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    int32_t step_x = end_x > cx ? 1 : -1;
+    int32_t step_y = end_y > cy ? 1 : -1;
+
+    const float kInfinity = 1e30f;
+    float delta_x = dx != 0.0f ? cell_size / fabsf(dx) : kInfinity;
+    float delta_y = dy != 0.0f ? cell_size / fabsf(dy) : kInfinity;
+    float boundary_x = float(step_x > 0 ? cx + 1 : cx) * cell_size;
+    float boundary_y = float(step_y > 0 ? cy + 1 : cy) * cell_size;
+    float next_x = dx != 0.0f ? (boundary_x - x0) / dx : kInfinity;
+    float next_y = dy != 0.0f ? (boundary_y - y0) / dy : kInfinity;
+
+    // Exactly one cell step per unit of Manhattan distance between the end
+    // cells, so rounding can never walk past the end
+    for (;;) {
+        if (!fn(cx, cy)) return false;
+        bool x_done = cx == end_x;
+        bool y_done = cy == end_y;
+        if (x_done && y_done) return true;
+
+        if (y_done || (!x_done && next_x < next_y)) {
+            cx += step_x;
+            next_x += delta_x;
+        } else {
+            cy += step_y;
+            next_y += delta_y;
+        }
+    }
+}
+
+template<typename Fn>
+void SpatialHashGrid::QueryLine(float x0, float y0, float x1, float y1, const Fn& fn) const {
+    if (points.Empty()) return;
+
+    TraceCells(x0, y0, x1, y1, [&](int32_t cx, int32_t cy) {
+        return VisitRow(cy, cx, cx, true, [&](const GridPoint& point) { return fn(point.id); });
+    });
+}
+
+} // namespace scene
+} // namespace toybox
@@ -0,0 +1,339 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include "parallel_for.h"
+#include "transform_hierarchy.h"
+
+namespace toybox
+{
+namespace scene
+{
+
+using utils::data_structures::DynamicArray;
+
+static math::Mat4 WorldOf(const Transform& local, const math::Mat4* parent) {
+    math::Mat4 matrix = math::Mat4Compose(local.position, local.rotation, local.scale);
+    return parent ? math::Multiply(*parent, matrix) : matrix;
+}
+
+TransformHierarchy::TransformHierarchy()
+    : node_count(0), level_count(0), last_updated(0), unsorted(false), holes(false) {}
+
+TransformHierarchy::NodeRecord* TransformHierarchy::RecordOf(SceneNode node) {
+    if (node.index >= records.Size()) return nullptr;
+    NodeRecord* record = &records.Data()[node.index];
+    return record->alive && record->generation == node.generation ? record : nullptr;
+}
+
+const TransformHierarchy::NodeRecord* TransformHierarchy::RecordOf(SceneNode node) const {
+    if (node.index >= records.Size()) return nullptr;
+    const NodeRecord* record = &records.Data()[node.index];
+    return record->alive && record->generation == node.generation ? record : nullptr;
+}
+
+SceneNode TransformHierarchy::Create(SceneNode parent, const Transform& local) {
+    uint32_t parent_record = kNone;
+    uint32_t parent_slot = kNone;
+    if (parent != kNoNode) {
+        const NodeRecord* record = RecordOf(parent);
+        if (!record) return kNoNode;
+        parent_record = parent.index;
+        parent_slot = record->slot;
+    }
+
+    uint32_t index;
+    if (!free_records.Empty()) {
+        index = free_records.Back();
+        free_records.PopBack();
+    } else {
+        index = static_cast<uint32_t>(records.Size());
+        records.PushBack(NodeRecord{ kNone, 1, kNone, false });
+    }
+
+    uint32_t slot = static_cast<uint32_t>(locals.Size());
+    NodeRecord& record = records.Data()[index];
+    record.slot = slot;
+    record.parent = parent_record;
+    record.alive = true;
+
+    // Appended out of order; the next Update sorts it into place
+    locals.PushBack(local);
+    worlds.PushBack(math::Mat4Identity());
+    parents.PushBack(parent_slot);
+    first_child.PushBack(0);
+    child_count.PushBack(0);
+    levels.PushBack(parent_slot == kNone ? 0 : levels.Data()[parent_slot] + 1);
+    slot_records.PushBack(index);
+    dirty.PushBack(1);
+
+    unsorted = true;
+    ++node_count;
+    return SceneNode{ index, record.generation };
+}
+
+void TransformHierarchy::DestroySubtree(uint32_t root) {
+    // Child ranges are valid here, so walk them with an explicit stack
+    DynamicArray<uint32_t>& stack = scratch_order;
+    stack.Clear();
+    stack.PushBack(root);
+    while (!stack.Empty()) {
+        uint32_t slot = stack.Back();
+        stack.PopBack();
+        uint32_t record_index = slot_records.Data()[slot];
+        if (record_index == kNone) continue;
+
+        for (uint32_t c = 0; c < child_count.Data()[slot]; ++c) {
+            stack.PushBack(first_child.Data()[slot] + c);
+        }
+
+        NodeRecord& record = records.Data()[record_index];
+        record.alive = false;
+        ++record.generation;
+        free_records.PushBack(record_index);
+        slot_records.Data()[slot] = kNone;
+        --node_count;
+    }
+    holes = true;
+}
+
+void TransformHierarchy::Destroy(SceneNode node) {
+    if (!RecordOf(node)) return;
+    if (unsorted) Rebuild();
+    DestroySubtree(RecordOf(node)->slot);
+}
+
+bool TransformHierarchy::Alive(SceneNode node) const {
+    return RecordOf(node) != nullptr;
+}
+
+bool TransformHierarchy::SetParent(SceneNode node, SceneNode parent) {
+    NodeRecord* record = RecordOf(node);
+    if (!record) return false;
+
+    uint32_t parent_record = kNone;
+    if (parent != kNoNode) {
+        if (!RecordOf(parent)) return false;
+        // Refuse to hang a node below itself
+        for (uint32_t walk = parent.index; walk != kNone; walk = records.Data()[walk].parent) {
+            if (walk == node.index) return false;
+        }
+        parent_record = parent.index;
+    }
+
+    record->parent = parent_record;
+    parents.Data()[record->slot] = parent_record == kNone ? kNone : records.Data()[parent_record].slot;
+    dirty.Data()[record->slot] = 1;
+    unsorted = true;
+    return true;
+}
+
+SceneNode TransformHierarchy::Parent(SceneNode node) const {
+    const NodeRecord* record = RecordOf(node);
+    if (!record || record->parent == kNone) return kNoNode;
+    return SceneNode{ record->parent, records.Data()[record->parent].generation };
+}
+
+void TransformHierarchy::MarkDirty(uint32_t slot) {
+    uint8_t& flag = dirty.Data()[slot];
+    if (flag) return;
+    flag = 1;
+    // While unsorted, Rebuild collects dirty slots from the flags instead
+    if (!unsorted) {
+        dirty_levels.Data()[levels.Data()[slot]].PushBack(slot);
+    }
+}
+
+void TransformHierarchy::SetLocal(SceneNode node, const Transform& local) {
+    NodeRecord* record = RecordOf(node);
+    if (!record) return;
+    locals.Data()[record->slot] = local;
+    MarkDirty(record->slot);
+}
+
+const Transform& TransformHierarchy::Local(SceneNode node) const {
+    return locals.Data()[RecordOf(node)->slot];
+}
+
+const math::Mat4& TransformHierarchy::World(SceneNode node) const {
+    return worlds.Data()[RecordOf(node)->slot];
+}
+
+void TransformHierarchy::Rebuild() {
+    uint32_t slot_total = static_cast<uint32_t>(locals.Size());
+
+    // Children of every live slot, grouped by parent slot
+    DynamicArray<uint32_t>& offsets = scratch_offsets;
+    offsets.Clear();
+    offsets.ReserveAndInitialize(slot_total + 1, 0);
+    for (uint32_t s = 0; s < slot_total; ++s) {
+        uint32_t record_index = slot_records.Data()[s];
+        if (record_index == kNone) continue;
+        uint32_t parent = records.Data()[record_index].parent;
+        if (parent != kNone) ++offsets.Data()[records.Data()[parent].slot + 1];
+    }
+    for (uint32_t s = 0; s < slot_total; ++s) {
+        offsets.Data()[s + 1] += offsets.Data()[s];
+    }
+    DynamicArray<uint32_t>& children = scratch_children;
+    children.Resize(offsets.Data()[slot_total]);
+    for (uint32_t s = 0; s < slot_total; ++s) {
+        uint32_t record_index = slot_records.Data()[s];
+        if (record_index == kNone) continue;
+        uint32_t parent = records.Data()[record_index].parent;
+        if (parent != kNone) children.Data()[offsets.Data()[records.Data()[parent].slot]++] = s;
+    }
+    // offsets[s] now marks the end of s's children; the start is offsets[s - 1]
+
+    // Breadth-first order from the roots gives depth order with siblings adjacent
+    DynamicArray<uint32_t>& order = scratch_order;
+    order.Clear();
+    for (uint32_t s = 0; s < slot_total; ++s) {
+        uint32_t record_index = slot_records.Data()[s];
+        if (record_index != kNone && records.Data()[record_index].parent == kNone) order.PushBack(s);
+    }
+
+    uint32_t count = node_count;
+    DynamicArray<Transform> new_locals(count > 0 ? count : 1);
+    DynamicArray<math::Mat4> new_worlds(count > 0 ? count : 1);
+    DynamicArray<uint32_t> new_parents(count > 0 ? count : 1);
+    DynamicArray<uint32_t> new_first_child(count > 0 ? count : 1);
+    DynamicArray<uint32_t> new_child_count(count > 0 ? count : 1);
+    DynamicArray<uint32_t> new_levels(count > 0 ? count : 1);
+    DynamicArray<uint32_t> new_slot_records(count > 0 ? count : 1);
+    DynamicArray<uint8_t> new_dirty(count > 0 ? count : 1);
+
+    level_count = 0;
+    for (uint32_t head = 0; head < order.Size(); ++head) {
+        uint32_t old_slot = order.Data()[head];
+        uint32_t record_index = slot_records.Data()[old_slot];
+        NodeRecord& record = records.Data()[record_index];
+        record.slot = head;
+
+        uint32_t parent_slot = record.parent == kNone ? kNone : records.Data()[record.parent].slot;
+        uint32_t level = parent_slot == kNone ? 0 : new_levels.Data()[parent_slot] + 1;
+        if (level + 1 > level_count) level_count = level + 1;
+
+        uint32_t begin = old_slot == 0 ? 0 : offsets.Data()[old_slot - 1];
+        uint32_t end = offsets.Data()[old_slot];
+
+        new_locals.PushBack(locals.Data()[old_slot]);
+        new_worlds.PushBack(worlds.Data()[old_slot]);
+        new_parents.PushBack(parent_slot);
+        new_first_child.PushBack(static_cast<uint32_t>(order.Size()));
+        new_child_count.PushBack(end - begin);
+        new_levels.PushBack(level);
+        new_slot_records.PushBack(record_index);
+        new_dirty.PushBack(dirty.Data()[old_slot]);
+
+        for (uint32_t c = begin; c < end; ++c) {
+            order.PushBack(children.Data()[c]);
+        }
+    }
+
+    locals.Swap(new_locals);
+    worlds.Swap(new_worlds);
+    parents.Swap(new_parents);
+    first_child.Swap(new_first_child);
+    child_count.Swap(new_child_count);
+    levels.Swap(new_levels);
+    slot_records.Swap(new_slot_records);
+    dirty.Swap(new_dirty);
+
+    // Pending work has new slot numbers; regather it from the flags
+    while (dirty_levels.Size() < level_count) {
+        dirty_levels.PushBack(DynamicArray<uint32_t>());
+    }
+    for (size_t l = 0; l < dirty_levels.Size(); ++l) {
+        dirty_levels.Data()[l].Clear();
+    }
+    for (uint32_t s = 0; s < count; ++s) {
+        if (dirty.Data()[s]) dirty_levels.Data()[levels.Data()[s]].PushBack(s);
+    }
+
+    unsorted = false;
+    holes = false;
+}
+
+void TransformHierarchy::UpdateLevel(uint32_t level, utils::jobs::JobSystem* jobs) {
+    DynamicArray<uint32_t>& pending = dirty_levels.Data()[level];
+    uint32_t count = static_cast<uint32_t>(pending.Size());
+    if (count == 0) return;
+
+    const uint32_t* slots = pending.Data();
+    const Transform* local_data = locals.Data();
+    const uint32_t* parent_data = parents.Data();
+    const uint32_t* record_data = slot_records.Data();
+    math::Mat4* world_data = worlds.Data();
+
+    // Parents are a level up and already final, so every node in the level is
+    // independent
+    auto compute = [=](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t slot = slots[i];
+            if (record_data[slot] == kNone) continue;
+            uint32_t parent = parent_data[slot];
+            world_data[slot] = WorldOf(local_data[slot], parent == kNone ? nullptr : &world_data[parent]);
+        }
+    };
+    if (jobs && count >= kParallelTransformThreshold) {
+        utils::jobs::ParallelFor(jobs, 0, count, compute);
+    } else {
+        compute(0, count);
+    }
+
+    // Push the change down to the children
+    uint8_t* dirty_data = dirty.Data();
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t slot = slots[i];
+        dirty_data[slot] = 0;
+        if (record_data[slot] == kNone) continue;
+
+        uint32_t first = first_child.Data()[slot];
+        uint32_t end = first + child_count.Data()[slot];
+        for (uint32_t c = first; c < end; ++c) {
+            if (dirty_data[c] || record_data[c] == kNone) continue;
+            dirty_data[c] = 1;
+            dirty_levels.Data()[level + 1].PushBack(c);
+        }
+    }
+
+    last_updated += count;
+    pending.Clear();
+}
+
+void TransformHierarchy::Update(utils::jobs::JobSystem* jobs) {
+    if (unsorted || holes) Rebuild();
+
+    last_updated = 0;
+    for (uint32_t level = 0; level < level_count; ++level) {
+        UpdateLevel(level, jobs);
+    }
+}
+
+void TransformHierarchy::MarkAllDirty() {
+    for (uint32_t s = 0; s < locals.Size(); ++s) {
+        if (slot_records.Data()[s] != kNone) MarkDirty(s);
+    }
+}
+
+uint32_t TransformHierarchy::Count() const {
+    return node_count;
+}
+
+uint32_t TransformHierarchy::LevelCount() const {
+    return level_count;
+}
+
+uint32_t TransformHierarchy::LastUpdatedCount() const {
+    return last_updated;
+}
+
+} // namespace scene
+} // namespace toybox
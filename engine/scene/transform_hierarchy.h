@@ -0,0 +1,146 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint32_t, uint8_t
+
+#include "dynamicarray.h"
+#include "job_system.h"
+#include "matrix.h"
+
+namespace toybox
+{
+namespace scene
+{
+
+struct SceneNode {
+    uint32_t index;
+    uint32_t generation;
+
+    bool operator==(const SceneNode& other) const {
+        return index == other.index && generation == other.generation;
+    }
+
+    bool operator!=(const SceneNode& other) const {
+        return !(*this == other);
+    }
+};
+
+constexpr SceneNode kNoNode = { 0xFFFFFFFF, 0 };
+
+struct Transform {
+    math::Vec3 position;
+    math::Quat rotation;
+    math::Vec3 scale;
+};
+
+inline Transform TransformIdentity() {
+    return Transform{ math::Vec3{ 0.0f, 0.0f, 0.0f }, math::QuatIdentity(), math::Vec3{ 1.0f, 1.0f, 1.0f } };
+}
+
+// Levels with at least this many dirty nodes are split across the job system
+constexpr uint32_t kParallelTransformThreshold = 1024;
+
+// Local and world transforms in flat arrays, ordered breadth first: sorted by
+// depth, with the children of each node next to each other. Moving a node
+// marks it dirty; Update recomputes world matrices for dirty nodes and their
+// descendants only, one depth level at a time.
+//
+// Creating and reparenting nodes leaves the arrays unsorted until the next
+// Update, which re-sorts everything in one pass. Batch structural edits.
+struct TransformHierarchy {
+private:
+    struct NodeRecord {
+        uint32_t slot;
+        uint32_t generation;
+        uint32_t parent; // Record index, or kNone
+        bool alive;
+    };
+
+    static constexpr uint32_t kNone = 0xFFFFFFFF;
+
+    utils::data_structures::DynamicArray<NodeRecord> records;
+    utils::data_structures::DynamicArray<uint32_t> free_records;
+
+    // Indexed by slot
+    utils::data_structures::DynamicArray<Transform> locals;
+    utils::data_structures::DynamicArray<math::Mat4> worlds;
+    utils::data_structures::DynamicArray<uint32_t> parents;     // Parent slot, or kNone
+    utils::data_structures::DynamicArray<uint32_t> first_child; // Valid while sorted
+    utils::data_structures::DynamicArray<uint32_t> child_count;
+    utils::data_structures::DynamicArray<uint32_t> levels;
+    utils::data_structures::DynamicArray<uint32_t> slot_records;
+    utils::data_structures::DynamicArray<uint8_t> dirty;
+
+    // Dirty slots waiting for Update, one list per depth level
+    utils::data_structures::DynamicArray<utils::data_structures::DynamicArray<uint32_t>> dirty_levels;
+
+    // Rebuild scratch space
+    utils::data_structures::DynamicArray<uint32_t> scratch_order;
+    utils::data_structures::DynamicArray<uint32_t> scratch_offsets;
+    utils::data_structures::DynamicArray<uint32_t> scratch_children;
+
+    uint32_t node_count;
+    uint32_t level_count;
+    uint32_t last_updated;
+    bool unsorted; // Slots were appended or reparented; child ranges are stale
+    bool holes;    // Dead slots are waiting to be compacted
+
+    NodeRecord* RecordOf(SceneNode node);
+    const NodeRecord* RecordOf(SceneNode node) const;
+    void MarkDirty(uint32_t slot);
+    void Rebuild();
+    void DestroySubtree(uint32_t slot);
+    void UpdateLevel(uint32_t level, utils::jobs::JobSystem* jobs);
+
+public:
+    TransformHierarchy();
+
+    TransformHierarchy(const TransformHierarchy&) = delete;
+    TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+    SceneNode Create(SceneNode parent = kNoNode, const Transform& local = TransformIdentity());
+
+    // Destroys the node and everything below it
+    void Destroy(SceneNode node);
+
+    bool Alive(SceneNode node) const;
+
+    // Fails if parent is node itself or one of its descendants. The local
+    // transform is kept, so the node moves with its new parent.
+    bool SetParent(SceneNode node, SceneNode parent);
+
+    SceneNode Parent(SceneNode node) const;
+
+    void SetLocal(SceneNode node, const Transform& local);
+    const Transform& Local(SceneNode node) const;
+
+    // Valid after the Update following the last change above this node
+    const math::Mat4& World(SceneNode node) const;
+
+    // Recompute world matrices under every dirty node. Pass a job system to
+    // process large levels in parallel.
+    void Update(utils::jobs::JobSystem* jobs = nullptr);
+
+    // Force every world matrix to be recomputed on the next Update
+    void MarkAllDirty();
+
+    uint32_t Count() const;
+
+    // Depth levels as of the last Update
+    uint32_t LevelCount() const;
+
+    // World matrices recomputed by the last Update
+    uint32_t LastUpdatedCount() const;
+};
+
+} // namespace scene
+} // namespace toybox
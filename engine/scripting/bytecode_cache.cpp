@@ -0,0 +1,209 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <algorithm> // For std::sort
+#include <cstring>   // For memcmp, memcpy, memset, strcmp, strlen
+
+#include "bytecode_cache.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+using utils::data_structures::DynamicArray;
+
+// Blobs start 8-byte aligned so programs can be bound where they lie
+static uint64_t AlignBlob(uint64_t size) {
+    return (size + 7) & ~uint64_t(7);
+}
+
+uint64_t HashScriptSource(const char* source, size_t length) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(source[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+BytecodeCache::BytecodeCache(uint32_t program_version)
+    : entries(nullptr), entry_count(0), stats{ 0, 0, 0 }, bytecode_version(program_version) {}
+
+bool BytecodeCache::Open(const char* path) {
+    Close();
+    if (!file.Open(path)) return false;
+    const uint8_t* data = file.Data();
+    size_t size = file.Size();
+    const CacheHeader* header = reinterpret_cast<const CacheHeader*>(data);
+    bool valid = data && size >= sizeof(CacheHeader) && header->magic == kCacheMagic &&
+                 header->format_version == kCacheFormatVersion && header->bytecode_version == bytecode_version &&
+                 header->file_size == size &&
+                 (size - sizeof(CacheHeader)) / sizeof(CacheEntry) >= header->entry_count;
+    if (valid) {
+        const CacheEntry* table = reinterpret_cast<const CacheEntry*>(data + sizeof(CacheHeader));
+        for (uint32_t e = 0; e < header->entry_count && valid; ++e) {
+            const CacheEntry& entry = table[e];
+            valid = entry.blob_offset <= size && entry.blob_size <= size - entry.blob_offset &&
+                    (entry.blob_offset & 7) == 0 && entry.name_offset <= size &&
+                    entry.name_length <= size - entry.name_offset &&
+                    (e == 0 || table[e - 1].name_hash <= entry.name_hash);
+        }
+        if (valid) {
+            entries = table;
+            entry_count = header->entry_count;
+            return true;
+        }
+    }
+    file.Close();
+    return false;
+}
+
+void BytecodeCache::Close() {
+    file.Close();
+    entries = nullptr;
+    entry_count = 0;
+    stored.Clear();
+    stats = BytecodeCacheStats{ 0, 0, 0 };
+}
+
+const CacheEntry* BytecodeCache::FindEntry(const char* name, size_t length, uint64_t name_hash) const {
+    const CacheEntry* first = std::lower_bound(
+        entries, entries + entry_count, name_hash,
+        [](const CacheEntry& entry, uint64_t hash) { return entry.name_hash < hash; });
+    for (const CacheEntry* entry = first; entry < entries + entry_count && entry->name_hash == name_hash; ++entry) {
+        if (entry->name_length == length && memcmp(file.Data() + entry->name_offset, name, length) == 0) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+const BytecodeCache::Stored* BytecodeCache::FindStored(const char* name, uint64_t name_hash) const {
+    for (size_t i = 0; i < stored.Size(); ++i) {
+        const Stored& entry = stored.Data()[i];
+        if (entry.name_hash == name_hash && strcmp(entry.name.CStr(), name) == 0) return &entry;
+    }
+    return nullptr;
+}
+
+bool BytecodeCache::Find(const char* name, uint64_t source_hash, const uint8_t** blob, size_t* size) {
+    size_t length = strlen(name);
+    uint64_t name_hash = HashScriptSource(name, length);
+    if (const Stored* entry = FindStored(name, name_hash)) {
+        if (entry->source_hash != source_hash) {
+            ++stats.stale;
+            return false;
+        }
+        ++stats.hits;
+        *blob = entry->blob.Data();
+        *size = entry->blob.Size();
+        return true;
+    }
+    const CacheEntry* entry = FindEntry(name, length, name_hash);
+    if (!entry) {
+        ++stats.misses;
+        return false;
+    }
+    if (entry->source_hash != source_hash) {
+        ++stats.stale;
+        return false;
+    }
+    ++stats.hits;
+    *blob = file.Data() + entry->blob_offset;
+    *size = static_cast<size_t>(entry->blob_size);
+    return true;
+}
+
+void BytecodeCache::Store(const char* name, uint64_t source_hash, const uint8_t* blob, size_t size) {
+    uint64_t name_hash = HashScriptSource(name, strlen(name));
+    Stored* entry = const_cast<Stored*>(FindStored(name, name_hash));
+    if (!entry) {
+        stored.PushBack(Stored{ utils::data_structures::DynamicString(name), name_hash, 0, DynamicArray<uint8_t>() });
+        entry = &stored.Back();
+    }
+    entry->source_hash = source_hash;
+    entry->blob.Resize(size);
+    if (size > 0) memcpy(entry->blob.Data(), blob, size);
+}
+
+bool BytecodeCache::Save(const char* path) const {
+    // Everything mapped that nothing stored replaces, then everything stored
+    struct Source {
+        uint64_t name_hash;
+        uint64_t source_hash;
+        const char* name;
+        uint32_t name_length;
+        const uint8_t* blob;
+        uint64_t blob_size;
+    };
+    DynamicArray<Source> sources;
+    for (uint32_t e = 0; e < entry_count; ++e) {
+        const CacheEntry& entry = entries[e];
+        const char* name = reinterpret_cast<const char*>(file.Data() + entry.name_offset);
+        bool replaced = false;
+        for (size_t i = 0; i < stored.Size() && !replaced; ++i) {
+            const Stored& candidate = stored.Data()[i];
+            replaced = candidate.name_hash == entry.name_hash && candidate.name.Length() == entry.name_length &&
+                       memcmp(candidate.name.CStr(), name, entry.name_length) == 0;
+        }
+        if (!replaced) {
+            sources.PushBack(Source{ entry.name_hash, entry.source_hash, name, entry.name_length,
+                                     file.Data() + entry.blob_offset, entry.blob_size });
+        }
+    }
+    for (size_t i = 0; i < stored.Size(); ++i) {
+        const Stored& entry = stored.Data()[i];
+        sources.PushBack(Source{ entry.name_hash, entry.source_hash, entry.name.CStr(),
+                                 static_cast<uint32_t>(entry.name.Length()), entry.blob.Data(), entry.blob.Size() });
+    }
+    std::sort(sources.Data(), sources.Data() + sources.Size(), [](const Source& a, const Source& b) {
+        return a.name_hash < b.name_hash;
+    });
+
+    // Header, entries, names, then the blobs
+    uint32_t count = static_cast<uint32_t>(sources.Size());
+    uint64_t names_at = sizeof(CacheHeader) + uint64_t(count) * sizeof(CacheEntry);
+    uint64_t at = names_at;
+    for (uint32_t i = 0; i < count; ++i) at += sources.Data()[i].name_length;
+    at = AlignBlob(at);
+    uint64_t blobs_at = at;
+    for (uint32_t i = 0; i < count; ++i) at += AlignBlob(sources.Data()[i].blob_size);
+    if (at > 0xffffffffull) return false; // Name offsets are 32-bit
+
+    DynamicArray<uint8_t> out;
+    out.Resize(static_cast<size_t>(at));
+    memset(out.Data(), 0, out.Size());
+    *reinterpret_cast<CacheHeader*>(out.Data()) = CacheHeader{ kCacheMagic, kCacheFormatVersion, bytecode_version,
+                                                               count,       at,                  0 };
+    CacheEntry* table = reinterpret_cast<CacheEntry*>(out.Data() + sizeof(CacheHeader));
+    uint64_t name_at = names_at, blob_at = blobs_at;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Source& source = sources.Data()[i];
+        table[i] = CacheEntry{ source.name_hash,         source.source_hash, blob_at, source.blob_size,
+                               uint32_t(name_at),        source.name_length };
+        memcpy(out.Data() + name_at, source.name, source.name_length);
+        if (source.blob_size > 0) memcpy(out.Data() + blob_at, source.blob, static_cast<size_t>(source.blob_size));
+        name_at += source.name_length;
+        blob_at += AlignBlob(source.blob_size);
+    }
+    return utils::io::WriteFileAtomic(path, out.Data(), out.Size());
+}
+
+uint32_t BytecodeCache::EntryCount() const {
+    return entry_count;
+}
+
+BytecodeCacheStats BytecodeCache::Stats() const {
+    return stats;
+}
+
+} // namespace scripting
+} // namespace toybox
@@ -0,0 +1,116 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint32_t, uint64_t
+
+#include "dynamicarray.h"
+#include "dynamicstring.h"
+#include "file_io.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+constexpr uint32_t kCacheMagic = 0x4B434245; // "EBCK"
+constexpr uint32_t kCacheFormatVersion = 1;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t format_version;
+    uint32_t bytecode_version; // Program format of every blob inside, as given to the cache
+    uint32_t entry_count;
+    uint64_t file_size;        // Catches truncated files
+    uint64_t reserved;
+};
+
+// Entries are sorted by name_hash
+struct CacheEntry {
+    uint64_t name_hash;
+    uint64_t source_hash;
+    uint64_t blob_offset; // From the start of the file, 8-byte aligned
+    uint64_t blob_size;
+    uint32_t name_offset; // Name, not terminated, to rule out hash collisions
+    uint32_t name_length;
+};
+
+// FNV-1a, used to key cached programs by name and check them against
+// their source
+uint64_t HashScriptSource(const char* source, size_t length);
+
+struct BytecodeCacheStats {
+    uint32_t hits;
+    uint32_t stale;  // Found by name but compiled from other source
+    uint32_t misses;
+};
+
+// Compiled programs keyed by script name and checked against a hash of the
+// source they were compiled from, so editing a script invalidates only its
+// own entry. Programs are opaque blobs here: the cache knows nothing of the
+// language, only the version of the program format it was created with.
+// The file is mapped rather than read: Find hands back a pointer straight
+// into the mapping, and pages of scripts never loaded are never read from
+// disk.
+//
+// A cache written by another cache format or program version is ignored as
+// a whole. Save writes every entry still current plus everything stored since
+// Open, to a temporary file renamed into place.
+struct BytecodeCache {
+private:
+    struct Stored {
+        utils::data_structures::DynamicString name;
+        uint64_t name_hash;
+        uint64_t source_hash;
+        utils::data_structures::DynamicArray<uint8_t> blob;
+    };
+
+    utils::io::MappedFile file;
+    const CacheEntry* entries;
+    uint32_t entry_count;
+    utils::data_structures::DynamicArray<Stored> stored;
+    BytecodeCacheStats stats;
+    uint32_t bytecode_version;
+
+    const CacheEntry* FindEntry(const char* name, size_t length, uint64_t name_hash) const;
+    const Stored* FindStored(const char* name, uint64_t name_hash) const;
+
+public:
+    // Blobs are 8-byte aligned in the file; program_version goes in the
+    // header and must match for a file to be opened
+    explicit BytecodeCache(uint32_t program_version);
+
+    BytecodeCache(const BytecodeCache&) = delete;
+    BytecodeCache& operator=(const BytecodeCache&) = delete;
+
+    // Maps the cache at path. Returns false, leaving the cache empty, if
+    // there is no file or it is not a valid cache of this version.
+    bool Open(const char* path);
+    void Close();
+
+    // Finds the program compiled from source with this hash. The blob stays
+    // valid until Close, or until the next Store for a stored one.
+    bool Find(const char* name, uint64_t source_hash, const uint8_t** blob, size_t* size);
+
+    // Adds or replaces the program for name
+    void Store(const char* name, uint64_t source_hash, const uint8_t* blob, size_t size);
+
+    // On Windows a mapped file cannot be replaced, so save to another path
+    // than the one open, or Close first.
+    bool Save(const char* path) const;
+
+    uint32_t EntryCount() const;
+    BytecodeCacheStats Stats() const;
+};
+
+} // namespace scripting
+} // namespace toybox
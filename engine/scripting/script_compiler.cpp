@@ -0,0 +1,792 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstdio>  // For snprintf
+#include <cstdlib> // For strtod
+#include <cstring> // For memcpy, memcmp, memset, strlen
+
+#include "script_compiler.h"
+#include "script_program.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+using utils::data_structures::DynamicArray;
+
+static const uint32_t kMaxLocals = 255;
+// Blocks and expressions inside one another; each level recurses through
+// the compiler, so deeper nesting is refused rather than risking its stack
+static const uint32_t kMaxNesting = 200;
+
+enum class Token : uint8_t {
+    Identifier,
+    Number,
+    LeftParen,
+    RightParen,
+    LeftBrace,
+    RightBrace,
+    LeftBracket,
+    RightBracket,
+    Comma,
+    Semicolon,
+    Plus,
+    Minus,
+    Star,
+    Slash,
+    Percent,
+    Bang,
+    BangEqual,
+    Assign,
+    EqualEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    AndAnd,
+    OrOr,
+    Fn,
+    Let,
+    If,
+    Else,
+    While,
+    Return,
+    True,
+    False,
+    Nil,
+    End,
+    Error,
+};
+
+struct Name {
+    const char* text;
+    uint32_t length;
+};
+
+static bool SameName(Name a, Name b) {
+    return a.length == b.length && memcmp(a.text, b.text, a.length) == 0;
+}
+
+// Values an opcode leaves on the stack less those it takes. Calls and
+// NewArray depend on their operands and are counted where they are emitted.
+static int32_t StackEffect(Op op) {
+    switch (op) {
+    case Op::Constant:
+    case Op::Nil:
+    case Op::True:
+    case Op::False:
+    case Op::GetLocal: return 1;
+    case Op::Pop:
+    case Op::Add:
+    case Op::Subtract:
+    case Op::Multiply:
+    case Op::Divide:
+    case Op::Modulo:
+    case Op::Equal:
+    case Op::NotEqual:
+    case Op::Less:
+    case Op::LessEqual:
+    case Op::Greater:
+    case Op::GreaterEqual:
+    case Op::Index:
+    // Takes the value returned; code after it is reached, if at all, by
+    // jumps from where the statement began
+    case Op::Return: return -1;
+    case Op::SetIndex: return -2;
+    default: return 0;
+    }
+}
+
+struct Lexer {
+    const char* at;
+    const char* end;
+    uint32_t line;
+
+    Token kind;
+    Name text;
+    uint32_t token_line;
+
+    static bool IsAlpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    static bool IsDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    Token Keyword(const char* start, uint32_t length) const {
+        struct Entry {
+            const char* word;
+            Token token;
+        };
+        static const Entry kKeywords[] = { { "fn", Token::Fn },         { "let", Token::Let },
+                                           { "if", Token::If },         { "else", Token::Else },
+                                           { "while", Token::While },   { "return", Token::Return },
+                                           { "true", Token::True },     { "false", Token::False },
+                                           { "nil", Token::Nil } };
+        for (const Entry& entry : kKeywords) {
+            if (strlen(entry.word) == length && memcmp(entry.word, start, length) == 0) return entry.token;
+        }
+        return Token::Identifier;
+    }
+
+    void Next() {
+        for (;;) {
+            while (at < end && (*at == ' ' || *at == '\t' || *at == '\r' || *at == '\n')) {
+                if (*at == '\n') ++line;
+                ++at;
+            }
+            if (at + 1 < end && at[0] == '/' && at[1] == '/') {
+                while (at < end && *at != '\n') ++at;
+                continue;
+            }
+            break;
+        }
+        token_line = line;
+        text = Name{ at, 1 };
+        if (at >= end) {
+            kind = Token::End;
+            text.length = 0;
+            return;
+        }
+
+        const char* start = at;
+        char c = *at++;
+        if (IsAlpha(c)) {
+            while (at < end && (IsAlpha(*at) || IsDigit(*at))) ++at;
+            text = Name{ start, uint32_t(at - start) };
+            kind = Keyword(start, text.length);
+            return;
+        }
+        if (IsDigit(c)) {
+            while (at < end && IsDigit(*at)) ++at;
+            if (at + 1 < end && *at == '.' && IsDigit(at[1])) {
+                ++at;
+                while (at < end && IsDigit(*at)) ++at;
+            }
+            text = Name{ start, uint32_t(at - start) };
+            kind = Token::Number;
+            return;
+        }
+
+        auto pair = [&](char second, Token two, Token one) {
+            if (at < end && *at == second) {
+                ++at;
+                text.length = 2;
+                return two;
+            }
+            return one;
+        };
+        switch (c) {
+        case '(': kind = Token::LeftParen; break;
+        case ')': kind = Token::RightParen; break;
+        case '{': kind = Token::LeftBrace; break;
+        case '}': kind = Token::RightBrace; break;
+        case '[': kind = Token::LeftBracket; break;
+        case ']': kind = Token::RightBracket; break;
+        case ',': kind = Token::Comma; break;
+        case ';': kind = Token::Semicolon; break;
+        case '+': kind = Token::Plus; break;
+        case '-': kind = Token::Minus; break;
+        case '*': kind = Token::Star; break;
+        case '/': kind = Token::Slash; break;
+        case '%': kind = Token::Percent; break;
+        case '!': kind = pair('=', Token::BangEqual, Token::Bang); break;
+        case '=': kind = pair('=', Token::EqualEqual, Token::Assign); break;
+        case '<': kind = pair('=', Token::LessEqual, Token::Less); break;
+        case '>': kind = pair('=', Token::GreaterEqual, Token::Greater); break;
+        case '&': kind = pair('&', Token::AndAnd, Token::Error); break;
+        case '|': kind = pair('|', Token::OrOr, Token::Error); break;
+        default: kind = Token::Error; break;
+        }
+    }
+};
+
+struct Compiler {
+    struct Local {
+        Name name;
+        uint32_t depth;
+    };
+
+    struct Function {
+        Name name;
+        uint32_t code_offset;
+        uint32_t code_size;
+        uint8_t arity;
+        uint8_t local_count;
+        uint16_t max_stack;
+    };
+
+    // A call whose target is only known once every function has been seen
+    struct CallSite {
+        uint32_t at; // Offset of the opcode in code
+        Name name;
+        uint8_t argument_count;
+        uint32_t line;
+    };
+
+    Lexer lexer;
+    CompileError* error;
+    bool failed;
+
+    DynamicArray<uint8_t> code;
+    DynamicArray<double> constants;
+    DynamicArray<Function> functions;
+    DynamicArray<Name> imports;
+    DynamicArray<CallSite> calls;
+
+    Local locals[kMaxLocals];
+    uint32_t local_count;
+    uint32_t most_locals;
+    uint32_t depth;
+    uint32_t nesting;
+
+    // Values above the locals after the code emitted so far, and the most
+    // there have been in the function
+    int32_t stack_depth;
+    int32_t most_stack;
+
+    // Where the code of the last indexing expression starts and ends, so an
+    // assignment can tell whether it has one on its left
+    uint32_t index_start;
+    uint32_t index_end;
+
+    void Fail(const char* message) {
+        if (failed) return;
+        failed = true;
+        error->line = lexer.token_line;
+        snprintf(error->message, sizeof(error->message), "%s near '%.*s'", message, int(lexer.text.length),
+                 lexer.text.text);
+    }
+
+    bool Match(Token kind) {
+        if (lexer.kind != kind) return false;
+        lexer.Next();
+        return true;
+    }
+
+    void Expect(Token kind, const char* message) {
+        if (!Match(kind)) Fail(message);
+    }
+
+    void Emit(uint8_t byte) {
+        code.PushBack(byte);
+    }
+
+    void Emit(Op op) {
+        code.PushBack(static_cast<uint8_t>(op));
+        Stack(StackEffect(op));
+    }
+
+    void Stack(int32_t change) {
+        stack_depth += change;
+        if (stack_depth > most_stack) most_stack = stack_depth;
+    }
+
+    // Callers leave with --nesting whether or not this lets them in
+    bool Enter() {
+        if (++nesting <= kMaxNesting) return true;
+        Fail("Nested too deeply");
+        return false;
+    }
+
+    void EmitU16(uint32_t value) {
+        code.PushBack(uint8_t(value & 0xff));
+        code.PushBack(uint8_t(value >> 8));
+    }
+
+    void PatchU16(uint32_t at, uint32_t value) {
+        code.Data()[at] = uint8_t(value & 0xff);
+        code.Data()[at + 1] = uint8_t(value >> 8);
+    }
+
+    // Returns the offset of the distance to patch
+    uint32_t EmitJump(Op op) {
+        Emit(op);
+        EmitU16(0);
+        return static_cast<uint32_t>(code.Size()) - 2;
+    }
+
+    void PatchJump(uint32_t at) {
+        uint32_t distance = static_cast<uint32_t>(code.Size()) - (at + 2);
+        if (distance > 0xffff) Fail("Jump too long");
+        PatchU16(at, distance);
+    }
+
+    void EmitLoop(uint32_t start) {
+        Emit(Op::Loop);
+        uint32_t distance = static_cast<uint32_t>(code.Size()) + 2 - start;
+        if (distance > 0xffff) Fail("Loop too long");
+        EmitU16(distance);
+    }
+
+    void EmitNumber(double value) {
+        uint32_t index = 0;
+        while (index < constants.Size() && memcmp(&constants.Data()[index], &value, sizeof(double)) != 0) ++index;
+        if (index == constants.Size()) {
+            if (index > 0xffff) {
+                Fail("Too many constants");
+                return;
+            }
+            constants.PushBack(value);
+        }
+        Emit(Op::Constant);
+        EmitU16(index);
+    }
+
+    int32_t FindLocal(Name name) const {
+        for (int32_t i = int32_t(local_count) - 1; i >= 0; --i) {
+            if (SameName(locals[i].name, name)) return i;
+        }
+        return -1;
+    }
+
+    void AddLocal(Name name) {
+        if (local_count == kMaxLocals) {
+            Fail("Too many locals");
+            return;
+        }
+        locals[local_count++] = Local{ name, depth };
+        if (local_count > most_locals) most_locals = local_count;
+    }
+
+    // Locals live in fixed slots for the whole call, so leaving a block only
+    // frees its slots for reuse
+    void EndScope() {
+        --depth;
+        while (local_count > 0 && locals[local_count - 1].depth > depth) --local_count;
+    }
+
+    // Expressions, lowest precedence first
+
+    void Expression() {
+        if (Enter()) Assignment();
+        --nesting;
+    }
+
+    void Assignment() {
+        if (lexer.kind == Token::Identifier) {
+            // Assignment needs one token of lookahead
+            Lexer saved = lexer;
+            Name name = lexer.text;
+            lexer.Next();
+            if (Match(Token::Assign)) {
+                int32_t slot = FindLocal(name);
+                if (slot < 0) {
+                    Fail("Assignment to an undeclared variable");
+                    return;
+                }
+                Expression();
+                Emit(Op::SetLocal);
+                Emit(uint8_t(slot));
+                return;
+            }
+            lexer = saved;
+        }
+        uint32_t start = static_cast<uint32_t>(code.Size());
+        Or();
+        if (lexer.kind == Token::Assign && index_start == start && index_end == code.Size()) {
+            // view[i] = value: the Index just emitted becomes a SetIndex
+            lexer.Next();
+            code.PopBack();
+            Stack(1);
+            Expression();
+            Emit(Op::SetIndex);
+        }
+    }
+
+    void Or() {
+        And();
+        while (Match(Token::OrOr)) {
+            // true || x skips x and keeps the true
+            uint32_t skip_right = EmitJump(Op::JumpIfFalse);
+            uint32_t to_end = EmitJump(Op::Jump);
+            PatchJump(skip_right);
+            Emit(Op::Pop);
+            And();
+            PatchJump(to_end);
+        }
+    }
+
+    void And() {
+        Equality();
+        while (Match(Token::AndAnd)) {
+            uint32_t to_end = EmitJump(Op::JumpIfFalse);
+            Emit(Op::Pop);
+            Equality();
+            PatchJump(to_end);
+        }
+    }
+
+    void Equality() {
+        Comparison();
+        for (;;) {
+            if (Match(Token::EqualEqual)) {
+                Comparison();
+                Emit(Op::Equal);
+            } else if (Match(Token::BangEqual)) {
+                Comparison();
+                Emit(Op::NotEqual);
+            } else {
+                return;
+            }
+        }
+    }
+
+    void Comparison() {
+        Term();
+        for (;;) {
+            Op op;
+            if (Match(Token::Less)) op = Op::Less;
+            else if (Match(Token::LessEqual)) op = Op::LessEqual;
+            else if (Match(Token::Greater)) op = Op::Greater;
+            else if (Match(Token::GreaterEqual)) op = Op::GreaterEqual;
+            else return;
+            Term();
+            Emit(op);
+        }
+    }
+
+    void Term() {
+        Factor();
+        for (;;) {
+            Op op;
+            if (Match(Token::Plus)) op = Op::Add;
+            else if (Match(Token::Minus)) op = Op::Subtract;
+            else return;
+            Factor();
+            Emit(op);
+        }
+    }
+
+    void Factor() {
+        Unary();
+        for (;;) {
+            Op op;
+            if (Match(Token::Star)) op = Op::Multiply;
+            else if (Match(Token::Slash)) op = Op::Divide;
+            else if (Match(Token::Percent)) op = Op::Modulo;
+            else return;
+            Unary();
+            Emit(op);
+        }
+    }
+
+    void Unary() {
+        if (Match(Token::Minus)) {
+            if (Enter()) Unary();
+            --nesting;
+            Emit(Op::Negate);
+        } else if (Match(Token::Bang)) {
+            if (Enter()) Unary();
+            --nesting;
+            Emit(Op::Not);
+        } else {
+            Primary();
+        }
+    }
+
+    void Primary() {
+        if (failed) return;
+        uint32_t start = static_cast<uint32_t>(code.Size());
+        Name text = lexer.text;
+        if (Match(Token::Number)) {
+            char buffer[64];
+            uint32_t length = text.length < sizeof(buffer) - 1 ? text.length : uint32_t(sizeof(buffer) - 1);
+            memcpy(buffer, text.text, length);
+            buffer[length] = 0;
+            EmitNumber(strtod(buffer, nullptr));
+        } else if (Match(Token::True)) {
+            Emit(Op::True);
+        } else if (Match(Token::False)) {
+            Emit(Op::False);
+        } else if (Match(Token::Nil)) {
+            Emit(Op::Nil);
+        } else if (Match(Token::LeftParen)) {
+            Expression();
+            Expect(Token::RightParen, "Expected ')'");
+        } else if (Match(Token::LeftBracket)) {
+            ArrayLiteral();
+        } else if (Match(Token::Identifier)) {
+            if (Match(Token::LeftParen)) {
+                Call(text);
+            } else {
+                int32_t slot = FindLocal(text);
+                if (slot < 0) {
+                    Fail("Undeclared variable");
+                    return;
+                }
+                Emit(Op::GetLocal);
+                Emit(uint8_t(slot));
+            }
+        } else {
+            Fail("Expected an expression");
+            return;
+        }
+        while (Match(Token::LeftBracket) && !failed) {
+            Expression();
+            Expect(Token::RightBracket, "Expected ']'");
+            Emit(Op::Index);
+            index_start = start;
+            index_end = static_cast<uint32_t>(code.Size());
+        }
+    }
+
+    // The items are built on the stack, which only has room for so many
+    // temporaries per call
+    void ArrayLiteral() {
+        uint32_t count = 0;
+        if (lexer.kind != Token::RightBracket) {
+            do {
+                Expression();
+                ++count;
+            } while (Match(Token::Comma) && !failed);
+        }
+        Expect(Token::RightBracket, "Expected ']' after array items");
+        if (count > 255) Fail("Too many items in an array literal");
+        Emit(Op::NewArray);
+        EmitU16(count);
+        Stack(1 - int32_t(count));
+    }
+
+    void Call(Name name) {
+        uint32_t line = lexer.token_line;
+        uint32_t count = 0;
+        if (lexer.kind != Token::RightParen) {
+            do {
+                Expression();
+                ++count;
+            } while (Match(Token::Comma) && !failed);
+        }
+        Expect(Token::RightParen, "Expected ')' after arguments");
+        if (count > 255) Fail("Too many arguments");
+        calls.PushBack(CallSite{ static_cast<uint32_t>(code.Size()), name, uint8_t(count), line });
+        Emit(Op::Call);
+        EmitU16(0);
+        Emit(uint8_t(count));
+        Stack(1 - int32_t(count));
+    }
+
+    // Statements
+
+    void Block() {
+        ++depth;
+        if (Enter()) {
+            while (!failed && lexer.kind != Token::RightBrace && lexer.kind != Token::End) Statement();
+            Expect(Token::RightBrace, "Expected '}'");
+        }
+        --nesting;
+        EndScope();
+    }
+
+    void Statement() {
+        if (Match(Token::Let)) {
+            Name name = lexer.text;
+            Expect(Token::Identifier, "Expected a variable name");
+            if (Match(Token::Assign)) Expression();
+            else Emit(Op::Nil);
+            Expect(Token::Semicolon, "Expected ';'");
+            // Declared after its initialiser, so `let x = x;` reads an outer x
+            AddLocal(name);
+            Emit(Op::SetLocal);
+            Emit(uint8_t(local_count - 1));
+            Emit(Op::Pop);
+        } else if (Match(Token::If)) {
+            If();
+        } else if (Match(Token::While)) {
+            uint32_t start = static_cast<uint32_t>(code.Size());
+            Expect(Token::LeftParen, "Expected '(' after while");
+            Expression();
+            Expect(Token::RightParen, "Expected ')'");
+            uint32_t exit = EmitJump(Op::JumpIfFalse);
+            Emit(Op::Pop);
+            Expect(Token::LeftBrace, "Expected '{'");
+            Block();
+            EmitLoop(start);
+            // The condition is still on the stack where exit lands
+            Stack(1);
+            PatchJump(exit);
+            Emit(Op::Pop);
+        } else if (Match(Token::Return)) {
+            if (lexer.kind == Token::Semicolon) Emit(Op::Nil);
+            else Expression();
+            Expect(Token::Semicolon, "Expected ';'");
+            Emit(Op::Return);
+        } else if (Match(Token::LeftBrace)) {
+            Block();
+        } else {
+            Expression();
+            Expect(Token::Semicolon, "Expected ';'");
+            Emit(Op::Pop);
+        }
+    }
+
+    void If() {
+        Expect(Token::LeftParen, "Expected '(' after if");
+        Expression();
+        Expect(Token::RightParen, "Expected ')'");
+        uint32_t to_else = EmitJump(Op::JumpIfFalse);
+        Emit(Op::Pop);
+        Expect(Token::LeftBrace, "Expected '{'");
+        Block();
+        uint32_t to_end = EmitJump(Op::Jump);
+        // The condition is still on the stack where to_else lands
+        Stack(1);
+        PatchJump(to_else);
+        Emit(Op::Pop);
+        if (Match(Token::Else)) {
+            if (Match(Token::If)) {
+                If();
+            } else {
+                Expect(Token::LeftBrace, "Expected '{'");
+                Block();
+            }
+        }
+        PatchJump(to_end);
+    }
+
+    void FunctionDeclaration() {
+        Name name = lexer.text;
+        Expect(Token::Identifier, "Expected a function name");
+        for (size_t f = 0; f < functions.Size(); ++f) {
+            if (SameName(functions.Data()[f].name, name)) Fail("Function defined twice");
+        }
+        Expect(Token::LeftParen, "Expected '('");
+        local_count = 0;
+        most_locals = 0;
+        depth = 0;
+        stack_depth = 0;
+        most_stack = 0;
+        if (lexer.kind != Token::RightParen) {
+            do {
+                Name parameter = lexer.text;
+                Expect(Token::Identifier, "Expected a parameter name");
+                AddLocal(parameter);
+            } while (Match(Token::Comma) && !failed);
+        }
+        Expect(Token::RightParen, "Expected ')'");
+        uint8_t arity = uint8_t(local_count);
+        uint32_t start = static_cast<uint32_t>(code.Size());
+        Expect(Token::LeftBrace, "Expected '{'");
+        Block();
+        // Falling off the end returns nil
+        Emit(Op::Nil);
+        Emit(Op::Return);
+        // Temporaries sit above every local slot, not just those in scope
+        uint32_t max_stack = most_locals + uint32_t(most_stack);
+        if (max_stack > 0xffff) Fail("Function needs too much stack");
+        functions.PushBack(Function{ name, start, static_cast<uint32_t>(code.Size()) - start, arity,
+                                     uint8_t(most_locals), uint16_t(max_stack) });
+    }
+
+    void ResolveCalls() {
+        for (size_t c = 0; c < calls.Size() && !failed; ++c) {
+            const CallSite& call = calls.Data()[c];
+            uint32_t target = 0;
+            while (target < functions.Size() && !SameName(functions.Data()[target].name, call.name)) ++target;
+            if (target < functions.Size()) {
+                if (functions.Data()[target].arity != call.argument_count) {
+                    failed = true;
+                    error->line = call.line;
+                    snprintf(error->message, sizeof(error->message), "'%.*s' takes %u arguments",
+                             int(call.name.length), call.name.text, unsigned(functions.Data()[target].arity));
+                }
+                PatchU16(call.at + 1, target);
+                continue;
+            }
+            uint32_t import = 0;
+            while (import < imports.Size() && !SameName(imports.Data()[import], call.name)) ++import;
+            if (import == imports.Size()) imports.PushBack(call.name);
+            code.Data()[call.at] = static_cast<uint8_t>(Op::CallNative);
+            PatchU16(call.at + 1, import);
+        }
+        if (functions.Size() > 0xffff || imports.Size() > 0xffff) Fail("Too many functions");
+    }
+
+    void Write(DynamicArray<uint8_t>* blob) const {
+        // Strings: function names, then imports
+        uint32_t string_size = 0;
+        for (size_t f = 0; f < functions.Size(); ++f) string_size += functions.Data()[f].name.length + 1;
+        for (size_t i = 0; i < imports.Size(); ++i) string_size += imports.Data()[i].length + 1;
+
+        ProgramHeader header = { kProgramMagic,
+                                 kBytecodeVersion,
+                                 static_cast<uint32_t>(functions.Size()),
+                                 static_cast<uint32_t>(imports.Size()),
+                                 static_cast<uint32_t>(constants.Size()),
+                                 static_cast<uint32_t>(code.Size()),
+                                 string_size,
+                                 0 };
+        size_t constants_at = sizeof(ProgramHeader);
+        size_t functions_at = constants_at + AlignProgramSection(constants.Size() * sizeof(double));
+        size_t imports_at = functions_at + AlignProgramSection(functions.Size() * sizeof(FunctionInfo));
+        size_t code_at = imports_at + AlignProgramSection(imports.Size() * sizeof(uint32_t));
+        size_t strings_at = code_at + AlignProgramSection(code.Size());
+        size_t total = strings_at + AlignProgramSection(string_size);
+
+        blob->Resize(total);
+        uint8_t* out = blob->Data();
+        memset(out, 0, total);
+        memcpy(out, &header, sizeof(header));
+        if (!constants.Empty()) memcpy(out + constants_at, constants.Data(), constants.Size() * sizeof(double));
+        if (!code.Empty()) memcpy(out + code_at, code.Data(), code.Size());
+
+        char* strings = reinterpret_cast<char*>(out + strings_at);
+        uint32_t string_at = 0;
+        auto add_string = [&](Name name) {
+            uint32_t offset = string_at;
+            memcpy(strings + string_at, name.text, name.length);
+            string_at += name.length;
+            strings[string_at++] = 0;
+            return offset;
+        };
+        FunctionInfo* table = reinterpret_cast<FunctionInfo*>(out + functions_at);
+        for (size_t f = 0; f < functions.Size(); ++f) {
+            const Function& function = functions.Data()[f];
+            table[f] = FunctionInfo{ add_string(function.name), function.code_offset, function.code_size,
+                                     function.arity, function.local_count, function.max_stack };
+        }
+        uint32_t* import_table = reinterpret_cast<uint32_t*>(out + imports_at);
+        for (size_t i = 0; i < imports.Size(); ++i) import_table[i] = add_string(imports.Data()[i]);
+    }
+};
+
+bool CompileScript(const char* source, size_t length, DynamicArray<uint8_t>* blob, CompileError* error) {
+    Compiler compiler;
+    compiler.lexer.at = source;
+    compiler.lexer.end = source + length;
+    compiler.lexer.line = 1;
+    compiler.error = error;
+    compiler.failed = false;
+    compiler.local_count = 0;
+    compiler.most_locals = 0;
+    compiler.depth = 0;
+    compiler.nesting = 0;
+    compiler.stack_depth = 0;
+    compiler.most_stack = 0;
+    compiler.index_start = 0xffffffff;
+    compiler.index_end = 0xffffffff;
+    error->line = 0;
+    error->message[0] = 0;
+
+    compiler.lexer.Next();
+    while (!compiler.failed && compiler.lexer.kind != Token::End) {
+        compiler.Expect(Token::Fn, "Expected a function");
+        compiler.FunctionDeclaration();
+    }
+    compiler.ResolveCalls();
+    if (compiler.failed) return false;
+    compiler.Write(blob);
+    return true;
+}
+
+} // namespace scripting
+} // namespace toybox
@@ -0,0 +1,48 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint32_t
+
+#include "dynamicarray.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+struct CompileError {
+    uint32_t line;
+    char message[128];
+};
+
+// Compiles script source in one pass into a program blob (see
+// ScriptProgram). A script is a list of functions:
+//
+//     fn damage(health, amount) {
+//         let left = health - amount;
+//         if (left < 0) { return 0; }
+//         return left;
+//     }
+//
+// Values are numbers, booleans and nil. Statements are let, assignment, if
+// and else, while, return and expressions; operators are the usual
+// arithmetic, comparison and short-circuit logical ones. Calls to names no
+// function in the script has become imports, bound to native functions when
+// the program is loaded.
+//
+// Returns false and fills error on the first mistake.
+bool CompileScript(const char* source, size_t length, utils::data_structures::DynamicArray<uint8_t>* blob,
+                   CompileError* error);
+
+} // namespace scripting
+} // namespace toybox
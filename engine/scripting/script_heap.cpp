@@ -0,0 +1,274 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <chrono>  // For std::chrono::steady_clock
+#include <cstdlib> // For malloc, free, abort
+#include <cstring> // For memcpy
+
+#include "script_heap.h"
+#include "script_vm.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+static_assert(sizeof(ScriptArray) % alignof(Value) == 0, "Array items must be aligned");
+static_assert((kScriptHeapMinBlock << 7) == kScriptHeapMaxBlock, "One size class per power of two");
+
+static uint64_t NowNs() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count());
+}
+
+static size_t ClassOf(size_t bytes) {
+    size_t index = 0;
+    size_t block = kScriptHeapMinBlock;
+    while (block < bytes) {
+        block *= 2;
+        ++index;
+    }
+    return index;
+}
+
+ScriptHeap::ScriptHeap()
+    : nursery(nullptr), nursery_bytes(0), nursery_used(0), major_at_bytes(kScriptMajorCollectionBytes),
+      frame_allocations(0), stats{} {
+    for (size_t i = 0; i < kClassCount; ++i) {
+        classes[i].block_bytes = kScriptHeapMinBlock << i;
+        classes[i].free_list = nullptr;
+    }
+    SetNurseryBytes(kScriptNurseryBytes);
+}
+
+ScriptHeap::~ScriptHeap() {
+    for (SizeClass& size_class : classes) {
+        for (size_t i = 0; i < size_class.slabs.Size(); ++i) free(size_class.slabs.Data()[i]);
+    }
+    for (size_t i = 0; i < large.Size(); ++i) free(large.Data()[i]);
+    free(nursery);
+}
+
+void ScriptHeap::SetNurseryBytes(size_t bytes) {
+    CollectYoung();
+    free(nursery);
+    nursery = nullptr;
+    nursery_bytes = bytes;
+    if (bytes == 0) return;
+    nursery = static_cast<uint8_t*>(malloc(bytes));
+    if (!nursery) abort();
+    ++stats.system_allocations;
+}
+
+ScriptObject* ScriptHeap::Allocate(size_t bytes) {
+    ++stats.allocations;
+    ++frame_allocations;
+    if (bytes <= kScriptHeapMaxBlock) {
+        size_t aligned = (bytes + 7) & ~size_t(7);
+        if (nursery_bytes - nursery_used >= aligned) {
+            ScriptObject* object = reinterpret_cast<ScriptObject*>(nursery + nursery_used);
+            nursery_used += aligned;
+            return object;
+        }
+        if (nursery_bytes > 0) ++stats.nursery_overflows;
+    }
+    return AllocateOld(bytes);
+}
+
+ScriptObject* ScriptHeap::AllocateOld(size_t bytes) {
+    if (bytes > kScriptHeapMaxBlock) {
+        ScriptObject* object = static_cast<ScriptObject*>(malloc(bytes));
+        if (!object) abort();
+        ++stats.system_allocations;
+        large.PushBack(object);
+        stats.old_bytes += bytes;
+        return object;
+    }
+
+    SizeClass& size_class = classes[ClassOf(bytes)];
+    if (!size_class.free_list) {
+        // Slabs are never returned; each class only grows to its peak
+        uint8_t* slab = static_cast<uint8_t*>(malloc(kScriptHeapSlabBytes));
+        if (!slab) abort();
+        ++stats.system_allocations;
+        size_class.slabs.PushBack(slab);
+        for (size_t at = kScriptHeapSlabBytes; at >= size_class.block_bytes;) {
+            at -= size_class.block_bytes;
+            ScriptObject* block = reinterpret_cast<ScriptObject*>(slab + at);
+            block->kind = ObjectKind::Free;
+            block->forward = size_class.free_list;
+            size_class.free_list = block;
+        }
+    }
+    ScriptObject* object = size_class.free_list;
+    size_class.free_list = object->forward;
+    stats.old_bytes += size_class.block_bytes;
+    return object;
+}
+
+void ScriptHeap::FreeOld(ScriptObject* object) {
+    ++stats.freed_objects;
+    if (object->bytes > kScriptHeapMaxBlock) {
+        stats.old_bytes -= object->bytes;
+        free(object);
+        return;
+    }
+    SizeClass& size_class = classes[ClassOf(object->bytes)];
+    stats.old_bytes -= size_class.block_bytes;
+    object->kind = ObjectKind::Free;
+    object->forward = size_class.free_list;
+    size_class.free_list = object;
+}
+
+ScriptArray* ScriptHeap::NewArray(const Value* items, uint32_t count) {
+    if (count > kScriptMaxArrayCount) return nullptr;
+    size_t bytes = sizeof(ScriptArray) + size_t(count) * sizeof(Value);
+    ScriptArray* array = static_cast<ScriptArray*>(Allocate(bytes));
+    array->forward = nullptr;
+    array->bytes = uint32_t(bytes);
+    array->kind = ObjectKind::Array;
+    array->flags = 0;
+    array->reserved = 0;
+    array->count = count;
+    array->reserved_count = 0;
+    Value* out = array->Items();
+    if (!items) {
+        for (uint32_t i = 0; i < count; ++i) out[i] = NilValue();
+        return array;
+    }
+    memcpy(static_cast<void*>(out), items, size_t(count) * sizeof(Value));
+    // Made old with the nursery full, it may already point into it
+    if (!IsYoung(array)) {
+        for (uint32_t i = 0; i < count; ++i) {
+            if (out[i].type == ValueType::Array) WriteBarrier(array, out[i].array);
+        }
+    }
+    return array;
+}
+
+void ScriptHeap::AddRoot(Value* slot) {
+    roots.PushBack(slot);
+}
+
+void ScriptHeap::RemoveRoot(Value* slot) {
+    roots.Remove(slot);
+}
+
+void ScriptHeap::Remember(ScriptArray* array) {
+    array->flags |= kObjectRemembered;
+    remembered.PushBack(array);
+}
+
+// Copies a nursery object out the first time it is reached, leaving the
+// copy's address behind for every later reference to it
+void ScriptHeap::Promote(Value* value) {
+    if (value->type != ValueType::Array || !IsYoung(value->array)) return;
+    ScriptArray* young = value->array;
+    if (!young->forward) {
+        ScriptObject* copy = AllocateOld(young->bytes);
+        memcpy(static_cast<void*>(copy), young, young->bytes);
+        copy->forward = nullptr;
+        copy->flags = 0;
+        young->forward = copy;
+        ++stats.promoted_objects;
+        stats.promoted_bytes += young->bytes;
+        work.PushBack(copy);
+    }
+    value->array = static_cast<ScriptArray*>(young->forward);
+}
+
+void ScriptHeap::CollectYoung() {
+    if (nursery_used == 0) return;
+    work.Clear();
+    for (size_t i = 0; i < roots.Size(); ++i) Promote(roots.Data()[i]);
+    for (size_t r = 0; r < remembered.Size(); ++r) {
+        ScriptArray* array = remembered.Data()[r];
+        array->flags &= uint8_t(~kObjectRemembered);
+        for (uint32_t i = 0; i < array->count; ++i) Promote(&array->Items()[i]);
+    }
+    remembered.Clear();
+    // Promoting a copy's items can add more copies to scan
+    for (size_t w = 0; w < work.Size(); ++w) {
+        ScriptArray* array = static_cast<ScriptArray*>(work.Data()[w]);
+        for (uint32_t i = 0; i < array->count; ++i) Promote(&array->Items()[i]);
+    }
+    work.Clear();
+    nursery_used = 0;
+    ++stats.minor_collections;
+}
+
+void ScriptHeap::Mark(const Value& value) {
+    if (value.type != ValueType::Array || (value.array->flags & kObjectMarked)) return;
+    value.array->flags |= kObjectMarked;
+    work.PushBack(value.array);
+}
+
+// Runs with the nursery empty, so every object is old
+void ScriptHeap::CollectOld() {
+    work.Clear();
+    for (size_t i = 0; i < roots.Size(); ++i) Mark(*roots.Data()[i]);
+    while (!work.Empty()) {
+        ScriptArray* array = static_cast<ScriptArray*>(work.Back());
+        work.PopBack();
+        for (uint32_t i = 0; i < array->count; ++i) Mark(array->Items()[i]);
+    }
+
+    for (SizeClass& size_class : classes) {
+        for (size_t s = 0; s < size_class.slabs.Size(); ++s) {
+            uint8_t* slab = size_class.slabs.Data()[s];
+            for (size_t at = 0; at + size_class.block_bytes <= kScriptHeapSlabBytes; at += size_class.block_bytes) {
+                ScriptObject* object = reinterpret_cast<ScriptObject*>(slab + at);
+                if (object->kind == ObjectKind::Free) continue;
+                if (object->flags & kObjectMarked) object->flags &= uint8_t(~kObjectMarked);
+                else FreeOld(object);
+            }
+        }
+    }
+    large.RemoveIf([this](ScriptObject* object) {
+        if (object->flags & kObjectMarked) {
+            object->flags &= uint8_t(~kObjectMarked);
+            return false;
+        }
+        FreeOld(object);
+        return true;
+    });
+
+    major_at_bytes = stats.old_bytes * 2 > kScriptMajorCollectionBytes ? stats.old_bytes * 2
+                                                                         : kScriptMajorCollectionBytes;
+    ++stats.major_collections;
+}
+
+void ScriptHeap::Collect(bool full) {
+    uint64_t start = NowNs();
+    CollectYoung();
+    if (full || stats.old_bytes >= major_at_bytes) CollectOld();
+    uint64_t pause = NowNs() - start;
+    stats.last_pause_ns = pause;
+    if (pause > stats.max_pause_ns) stats.max_pause_ns = pause;
+    stats.total_pause_ns += pause;
+    stats.frame_allocations = frame_allocations;
+    frame_allocations = 0;
+}
+
+void ScriptHeap::EndFrame() {
+    Collect(false);
+}
+
+void ScriptHeap::CollectAll() {
+    Collect(true);
+}
+
+ScriptHeapStats ScriptHeap::Stats() const {
+    return stats;
+}
+
+} // namespace scripting
+} // namespace toybox
@@ -0,0 +1,173 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint32_t, uint64_t, uintptr_t
+
+#include "dynamicarray.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+struct Value;
+
+// Objects at most this large are made in the nursery and pooled once old;
+// larger ones get a heap allocation of their own
+constexpr size_t kScriptHeapMinBlock = 32;
+constexpr size_t kScriptHeapMaxBlock = 4096;
+
+// Pool blocks are carved out of slabs this large
+constexpr size_t kScriptHeapSlabBytes = 64 * 1024;
+
+constexpr size_t kScriptNurseryBytes = 1024 * 1024;
+
+// Old bytes the heap may reach before a frame end also collects the old
+// objects; after that it waits until the old bytes have doubled
+constexpr size_t kScriptMajorCollectionBytes = 1024 * 1024;
+
+constexpr uint32_t kScriptMaxArrayCount = 1u << 24;
+
+enum class ObjectKind : uint8_t {
+    Free, // A pool block on its free list
+    Array,
+};
+
+// ScriptObject flags
+constexpr uint8_t kObjectRemembered = 1; // Old, and may point into the nursery
+constexpr uint8_t kObjectMarked = 2;
+
+struct ScriptObject {
+    ScriptObject* forward; // The promoted copy, or the next free block
+    uint32_t bytes;
+    ObjectKind kind;
+    uint8_t flags;
+    uint16_t reserved;
+};
+
+// A fixed-length array of values, stored right after it
+struct ScriptArray : ScriptObject {
+    uint32_t count;
+    uint32_t reserved_count;
+
+    Value* Items() {
+        return reinterpret_cast<Value*>(this + 1);
+    }
+
+    const Value* Items() const {
+        return reinterpret_cast<const Value*>(this + 1);
+    }
+};
+
+struct ScriptHeapStats {
+    uint64_t allocations;        // Objects made, since the heap was created
+    uint64_t frame_allocations;  // Objects made in the last frame
+    uint64_t nursery_overflows;  // Made old because the nursery was full
+    uint64_t promoted_objects;   // Nursery objects still reachable when their frame ended
+    uint64_t promoted_bytes;
+    uint64_t freed_objects;      // Old objects found unreachable
+    uint64_t minor_collections;
+    uint64_t major_collections;
+    uint64_t system_allocations; // Slabs, large objects and nurseries taken from malloc
+    uint64_t last_pause_ns;      // Time the last frame end spent collecting
+    uint64_t max_pause_ns;
+    uint64_t total_pause_ns;
+    size_t old_bytes;            // In pool blocks and large objects, live or not yet found dead
+};
+
+// The memory behind the arrays scripts make. Objects start in a nursery,
+// an arena that is bumped through during a frame and emptied as a whole
+// when it ends: whatever the roots can still reach is first copied into
+// size-class pools, and the rest, usually almost all of it, costs nothing
+// to free. Old objects are marked and swept once they add up to enough
+// bytes, their blocks going back on the free list of their size.
+//
+// Collections only run from EndFrame and CollectAll, between script calls,
+// so the VM never needs to find roots on its own stack. The roots are the
+// Value slots the host registers; an object a script returns that is not
+// held in one does not survive the end of the frame. Stores into old
+// arrays go through WriteBarrier, which remembers the arrays that may
+// point into the nursery.
+struct ScriptHeap {
+private:
+    struct SizeClass {
+        size_t block_bytes;
+        ScriptObject* free_list;
+        utils::data_structures::DynamicArray<uint8_t*> slabs;
+    };
+
+    static constexpr size_t kClassCount = 8; // 32 bytes to 4096
+
+    SizeClass classes[kClassCount];
+    utils::data_structures::DynamicArray<ScriptObject*> large;
+    uint8_t* nursery;
+    size_t nursery_bytes;
+    size_t nursery_used;
+    size_t major_at_bytes;
+    utils::data_structures::DynamicArray<Value*> roots;
+    utils::data_structures::DynamicArray<ScriptArray*> remembered;
+    utils::data_structures::DynamicArray<ScriptObject*> work; // Promoted copies to scan, or marked objects
+    uint64_t frame_allocations;
+    ScriptHeapStats stats;
+
+    ScriptObject* Allocate(size_t bytes);
+    ScriptObject* AllocateOld(size_t bytes);
+    void FreeOld(ScriptObject* object);
+    void Remember(ScriptArray* array);
+    void Promote(Value* value);
+    void CollectYoung();
+    void CollectOld();
+    void Mark(const Value& value);
+    void Collect(bool full);
+
+public:
+    ScriptHeap();
+    ~ScriptHeap();
+
+    ScriptHeap(const ScriptHeap&) = delete;
+    ScriptHeap& operator=(const ScriptHeap&) = delete;
+
+    // Resizes the nursery, promoting what it holds first. With 0 bytes
+    // every object goes straight into the pools.
+    void SetNurseryBytes(size_t bytes);
+
+    // Returns an array holding a copy of count items, or of nils if items
+    // is null. Returns null if count is over kScriptMaxArrayCount.
+    ScriptArray* NewArray(const Value* items, uint32_t count);
+
+    // slot is traced by every collection and updated when what it refers
+    // to moves. It must stay valid until removed.
+    void AddRoot(Value* slot);
+    void RemoveRoot(Value* slot);
+
+    bool IsYoung(const ScriptObject* object) const {
+        return uintptr_t(object) - uintptr_t(nursery) < nursery_used;
+    }
+
+    // Call after storing stored into target
+    void WriteBarrier(ScriptArray* target, const ScriptObject* stored) {
+        if (IsYoung(stored) && !IsYoung(target) && !(target->flags & kObjectRemembered)) Remember(target);
+    }
+
+    // Empties the nursery, promoting what the roots reach, and collects the
+    // old objects too if they have grown enough. No script may be running.
+    void EndFrame();
+
+    // Like EndFrame, but always collects the old objects
+    void CollectAll();
+
+    ScriptHeapStats Stats() const;
+};
+
+} // namespace scripting
+} // namespace toybox
@@ -0,0 +1,202 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <chrono>  // For std::chrono::steady_clock
+#include <cstdio>  // For snprintf
+#include <cstring> // For strlen
+
+#include "file_io.h"
+#include "script_profiler.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+using utils::data_structures::DynamicString;
+
+static const uint32_t kNoNode = 0xFFFFFFFF;
+
+static uint64_t NowNs() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count());
+}
+
+// Appends with room to spare, so building a long report stays linear
+static void AppendText(DynamicString* out, const char* text) {
+    size_t needed = out->Length() + strlen(text) + 1;
+    if (needed > out->Capacity()) out->Resize(needed * 2);
+    out->Append(text);
+}
+
+ScriptProfiler::ScriptProfiler()
+    : mode(ProfileMode::Off), interval_us(1000), sample_count(0), sample_due(false), timer_running(false) {
+    Reset();
+}
+
+ScriptProfiler::~ScriptProfiler() {
+    StopTimer();
+}
+
+void ScriptProfiler::StopTimer() {
+    if (!timer.joinable()) return;
+    timer_running.store(false, std::memory_order_relaxed);
+    timer.join();
+    sample_due.store(false, std::memory_order_relaxed);
+}
+
+void ScriptProfiler::SetMode(ProfileMode new_mode, uint32_t new_interval_us) {
+    StopTimer();
+    mode = new_mode;
+    interval_us = new_interval_us > 0 ? new_interval_us : 1;
+    if (mode != ProfileMode::Sample) return;
+    timer_running.store(true, std::memory_order_relaxed);
+    timer = std::thread([this]() {
+        while (timer_running.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+            sample_due.store(true, std::memory_order_relaxed);
+        }
+    });
+}
+
+ProfileMode ScriptProfiler::Mode() const {
+    return mode;
+}
+
+void ScriptProfiler::Reset() {
+    functions.Clear();
+    recursion.Clear();
+    function_of.Clear();
+    nodes.Clear();
+    stack.Clear();
+    sample_count = 0;
+    // The root stands for the host, outside any script
+    nodes.PushBack(Node{ ~uint64_t(0), kNoNode, kNoNode, kNoNode, kNoNode, 0, 0 });
+}
+
+void ScriptProfiler::NameScript(uint32_t script, const char* name) {
+    while (script_names.Size() <= script) script_names.PushBack(DynamicString("?"));
+    script_names.Data()[script] = DynamicString(name);
+}
+
+uint32_t ScriptProfiler::FindFunction(uint64_t key, const char* name) {
+    if (const uint32_t* found = function_of.Find(key)) return *found;
+    uint32_t script = uint32_t(key >> 32);
+
+    char full[256];
+    snprintf(full, sizeof(full), "%s:%s", script < script_names.Size() ? script_names.Data()[script].CStr() : "?",
+             name);
+    uint32_t index = static_cast<uint32_t>(functions.Size());
+    functions.PushBack(FunctionProfile{ DynamicString(full), 0, 0, 0, 0 });
+    recursion.PushBack(0);
+    function_of.Insert(key, index);
+    return index;
+}
+
+// Only a stack never seen before needs the function looked up
+uint32_t ScriptProfiler::ChildOf(uint32_t parent, uint64_t key, const char* name) {
+    uint32_t child = nodes.Data()[parent].first_child;
+    while (child != kNoNode && nodes.Data()[child].key != key) child = nodes.Data()[child].next_sibling;
+    if (child != kNoNode) return child;
+
+    uint32_t function = FindFunction(key, name);
+    child = static_cast<uint32_t>(nodes.Size());
+    nodes.PushBack(Node{ key, function, parent, kNoNode, nodes.Data()[parent].first_child, 0, 0 });
+    nodes.Data()[parent].first_child = child;
+    return child;
+}
+
+void ScriptProfiler::Enter(uint32_t script, uint32_t function, const char* name) {
+    uint32_t parent = stack.Empty() ? 0 : stack.Back().node;
+    uint32_t node = ChildOf(parent, (uint64_t(script) << 32) | function, name);
+    uint32_t index = nodes.Data()[node].function;
+    ++functions.Data()[index].calls;
+    ++recursion.Data()[index];
+    stack.PushBack(Active{ node, mode == ProfileMode::Instrument ? NowNs() : 0, 0 });
+}
+
+void ScriptProfiler::Exit() {
+    if (stack.Empty()) return;
+    Active active = stack.Back();
+    stack.PopBack();
+    Node& node = nodes.Data()[active.node];
+    --recursion.Data()[node.function];
+    if (mode != ProfileMode::Instrument) return;
+
+    uint64_t elapsed = NowNs() - active.start_ns;
+    uint64_t self = elapsed > active.child_ns ? elapsed - active.child_ns : 0;
+    FunctionProfile& profile = functions.Data()[node.function];
+    profile.exclusive_ns += self;
+    // Only the outermost of a recursion counts, or time would be counted twice
+    if (recursion.Data()[node.function] == 0) profile.inclusive_ns += elapsed;
+    node.self_ns += self;
+    if (!stack.Empty()) stack.Back().child_ns += elapsed;
+}
+
+uint32_t ScriptProfiler::Depth() const {
+    return static_cast<uint32_t>(stack.Size());
+}
+
+void ScriptProfiler::Unwind(uint32_t depth) {
+    while (stack.Size() > depth) Exit();
+}
+
+void ScriptProfiler::TakeSample() {
+    sample_due.store(false, std::memory_order_relaxed);
+    if (stack.Empty()) return;
+    Node& node = nodes.Data()[stack.Back().node];
+    ++node.samples;
+    ++functions.Data()[node.function].samples;
+    ++sample_count;
+}
+
+uint32_t ScriptProfiler::FunctionCount() const {
+    return static_cast<uint32_t>(functions.Size());
+}
+
+const FunctionProfile& ScriptProfiler::Function(uint32_t index) const {
+    return functions.Data()[index];
+}
+
+uint64_t ScriptProfiler::SampleCount() const {
+    return sample_count;
+}
+
+void ScriptProfiler::WriteStack(uint32_t node, DynamicString* out) const {
+    const Node& entry = nodes.Data()[node];
+    if (entry.parent != 0) {
+        WriteStack(entry.parent, out);
+        AppendText(out, ";");
+    }
+    AppendText(out, functions.Data()[entry.function].name.CStr());
+}
+
+void ScriptProfiler::WriteFoldedStacks(DynamicString* out) const {
+    bool by_samples = sample_count > 0;
+    for (size_t n = 1; n < nodes.Size(); ++n) {
+        const Node& node = nodes.Data()[n];
+        uint64_t weight = by_samples ? node.samples : node.self_ns;
+        if (weight == 0) continue;
+        WriteStack(static_cast<uint32_t>(n), out);
+        char count[32];
+        snprintf(count, sizeof(count), " %llu\n", (unsigned long long)weight);
+        AppendText(out, count);
+    }
+}
+
+bool ScriptProfiler::ExportFoldedStacks(const char* path) const {
+    DynamicString text;
+    WriteFoldedStacks(&text);
+    return utils::io::WriteFileAtomic(path, text.CStr(), text.Length());
+}
+
+} // namespace scripting
+} // namespace toybox
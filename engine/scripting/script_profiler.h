@@ -0,0 +1,129 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <atomic>  // For std::atomic
+#include <cstdint> // For uint32_t, uint64_t
+#include <thread>  // For std::thread
+
+#include "dynamicarray.h"
+#include "dynamicstring.h"
+#include "hashmap.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+enum class ProfileMode : uint8_t {
+    Off,
+    Instrument, // Times every script call
+    Sample,     // Records the script call stack at a fixed interval
+};
+
+struct FunctionProfile {
+    utils::data_structures::DynamicString name; // "script:function"
+    uint64_t calls;
+    uint64_t inclusive_ns; // Recursive calls are counted once
+    uint64_t exclusive_ns; // Less the time in script functions it called
+    uint64_t samples;      // Samples taken while it was on top of the stack
+};
+
+// Profiles script functions for the VM. The VM reports each call and
+// return while a mode is on, and the profiler keeps a calling-context tree:
+// one node per distinct call stack. In Instrument mode each call is timed;
+// in Sample mode calls only move the cursor through the tree, and a timer
+// thread raises a flag the VM checks at calls, returns and loop back-edges,
+// so a sample costs nothing until it is due and then one counter increment.
+//
+// With the mode Off the VM runs an interpreter built without any of this.
+// Time spent in natives counts as time in the script function calling them.
+struct ScriptProfiler {
+private:
+    struct Node {
+        uint64_t key;      // script << 32 | function
+        uint32_t function; // Index into functions
+        uint32_t parent;
+        uint32_t first_child;
+        uint32_t next_sibling;
+        uint64_t self_ns;
+        uint64_t samples;
+    };
+
+    struct Active {
+        uint32_t node;
+        uint64_t start_ns;
+        uint64_t child_ns;
+    };
+
+    ProfileMode mode;
+    uint32_t interval_us;
+    utils::data_structures::DynamicArray<FunctionProfile> functions;
+    utils::data_structures::DynamicArray<uint32_t> recursion; // By function, how often it is on the stack
+    utils::data_structures::HashMap<uint64_t, uint32_t> function_of; // (script << 32 | function) -> index
+    utils::data_structures::DynamicArray<utils::data_structures::DynamicString> script_names;
+    utils::data_structures::DynamicArray<Node> nodes;
+    utils::data_structures::DynamicArray<Active> stack;
+    uint64_t sample_count;
+    std::atomic<bool> sample_due;
+    std::atomic<bool> timer_running;
+    std::thread timer;
+
+    uint32_t FindFunction(uint64_t key, const char* name);
+    uint32_t ChildOf(uint32_t parent, uint64_t key, const char* name);
+    void StopTimer();
+    void WriteStack(uint32_t node, utils::data_structures::DynamicString* out) const;
+
+public:
+    ScriptProfiler();
+    ~ScriptProfiler();
+
+    ScriptProfiler(const ScriptProfiler&) = delete;
+    ScriptProfiler& operator=(const ScriptProfiler&) = delete;
+
+    // Switches mode, keeping what was recorded so far. interval_us is the
+    // time between samples in Sample mode. Must not be called while a
+    // script runs.
+    void SetMode(ProfileMode mode, uint32_t interval_us = 1000);
+    ProfileMode Mode() const;
+
+    // Forgets every call and sample. Must not be called while a script runs.
+    void Reset();
+
+    // Names a script for reports; functions of unnamed scripts show as "?"
+    void NameScript(uint32_t script, const char* name);
+
+    // Called by the VM as script functions are entered and left. Depth and
+    // Unwind let it drop the frames of a script that failed part way.
+    void Enter(uint32_t script, uint32_t function, const char* name);
+    void Exit();
+    uint32_t Depth() const;
+    void Unwind(uint32_t depth);
+
+    bool SampleDue() const {
+        return sample_due.load(std::memory_order_relaxed);
+    }
+    void TakeSample();
+
+    uint32_t FunctionCount() const;
+    const FunctionProfile& Function(uint32_t index) const;
+    uint64_t SampleCount() const;
+
+    // Writes one line per distinct call stack, root first and separated by
+    // ';', followed by its weight: samples if any were taken, exclusive
+    // nanoseconds otherwise. This is the input flamegraph.pl and most flame
+    // graph viewers take.
+    void WriteFoldedStacks(utils::data_structures::DynamicString* out) const;
+    bool ExportFoldedStacks(const char* path) const;
+};
+
+} // namespace scripting
+} // namespace toybox
@@ -0,0 +1,284 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstring> // For strcmp, memchr
+
+#include "dynamicarray.h"
+#include "script_program.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+static uint32_t ReadU16(const uint8_t* at) {
+    return uint32_t(at[0]) | (uint32_t(at[1]) << 8);
+}
+
+enum class Flow : uint8_t {
+    Next,
+    Jump,   // Forward, and nothing falls through
+    Branch, // Forward, or falls through
+    Loop,   // Backward, and nothing falls through
+    End,
+};
+
+// Operand bytes, values taken and pushed, and where control goes, by
+// opcode. Calls and NewArray take as many values as their operands say.
+struct OpShape {
+    uint8_t operands;
+    uint8_t takes;
+    uint8_t pushes;
+    Flow flow;
+};
+
+static const OpShape kOpShapes[] = {
+    { 2, 0, 1, Flow::Next },   // Constant
+    { 0, 0, 1, Flow::Next },   // Nil
+    { 0, 0, 1, Flow::Next },   // True
+    { 0, 0, 1, Flow::Next },   // False
+    { 0, 1, 0, Flow::Next },   // Pop
+    { 1, 0, 1, Flow::Next },   // GetLocal
+    { 1, 1, 1, Flow::Next },   // SetLocal
+    { 0, 2, 1, Flow::Next },   // Add
+    { 0, 2, 1, Flow::Next },   // Subtract
+    { 0, 2, 1, Flow::Next },   // Multiply
+    { 0, 2, 1, Flow::Next },   // Divide
+    { 0, 2, 1, Flow::Next },   // Modulo
+    { 0, 1, 1, Flow::Next },   // Negate
+    { 0, 1, 1, Flow::Next },   // Not
+    { 0, 2, 1, Flow::Next },   // Equal
+    { 0, 2, 1, Flow::Next },   // NotEqual
+    { 0, 2, 1, Flow::Next },   // Less
+    { 0, 2, 1, Flow::Next },   // LessEqual
+    { 0, 2, 1, Flow::Next },   // Greater
+    { 0, 2, 1, Flow::Next },   // GreaterEqual
+    { 2, 0, 0, Flow::Jump },   // Jump
+    { 2, 1, 1, Flow::Branch }, // JumpIfFalse
+    { 2, 0, 0, Flow::Loop },   // Loop
+    { 3, 0, 1, Flow::Next },   // Call
+    { 3, 0, 1, Flow::Next },   // CallNative
+    { 0, 1, 0, Flow::End },    // Return
+    { 0, 2, 1, Flow::Next },   // Index
+    { 0, 3, 1, Flow::Next },   // SetIndex
+    { 2, 0, 1, Flow::Next },   // NewArray
+};
+static_assert(sizeof(kOpShapes) / sizeof(kOpShapes[0]) == size_t(Op::NewArray) + 1, "An opcode has no shape");
+
+// Decodes a function's code in one pass, checking each operand and the
+// stack depth before every instruction. Jumps only go forward and loops only
+// back, so a jump's target is always decoded after the jump, and a loop's
+// before it; the depth along every path into an instruction must agree, stay
+// above the locals and never pass max_stack. depth_at holds one entry per
+// code byte: the depth on arrival, kUnseen, or kInside for operand bytes.
+static bool VerifyFunction(const ProgramHeader& head, const FunctionInfo* table, const FunctionInfo& info,
+                           const uint8_t* function_code, int32_t* depth_at) {
+    const int32_t kUnseen = -1;
+    const int32_t kInside = -2;
+    const uint32_t size = info.code_size;
+    const int32_t locals = info.local_count;
+    const int32_t most = info.max_stack;
+    for (uint32_t i = 0; i < size; ++i) depth_at[i] = kUnseen;
+
+    // Code after a return, jump or loop is only reached if something jumps
+    // to it. Unreachable code is decoded and its operands checked, but has no
+    // depth to check against.
+    bool reachable = true;
+    int32_t depth = locals;
+    uint32_t pc = 0;
+    while (pc < size) {
+        if (depth_at[pc] >= 0) {
+            if (reachable && depth_at[pc] != depth) return false;
+            depth = depth_at[pc];
+            reachable = true;
+        } else if (reachable) {
+            depth_at[pc] = depth;
+        }
+        uint8_t op = function_code[pc];
+        if (op >= sizeof(kOpShapes) / sizeof(kOpShapes[0])) return false;
+        const OpShape& shape = kOpShapes[op];
+        uint32_t next = pc + 1 + shape.operands;
+        if (next > size) return false;
+        const uint8_t* operands = function_code + pc + 1;
+        int32_t takes = shape.takes;
+        if (shape.operands != 0) {
+            for (uint32_t i = pc + 1; i < next; ++i) {
+                // A forward jump into the middle of this instruction
+                if (depth_at[i] != kUnseen) return false;
+                depth_at[i] = kInside;
+            }
+            switch (static_cast<Op>(op)) {
+            case Op::Constant:
+                if (ReadU16(operands) >= head.constant_count) return false;
+                break;
+            case Op::GetLocal:
+            case Op::SetLocal:
+                if (operands[0] >= info.local_count) return false;
+                break;
+            case Op::Call: {
+                uint32_t callee = ReadU16(operands);
+                if (callee >= head.function_count || operands[2] != table[callee].arity) return false;
+                takes = operands[2];
+                break;
+            }
+            case Op::CallNative:
+                if (ReadU16(operands) >= head.import_count) return false;
+                takes = operands[2];
+                break;
+            case Op::NewArray: takes = int32_t(ReadU16(operands)); break;
+            default: break;
+            }
+        }
+        if (reachable) {
+            if (depth - takes < locals || depth - takes + shape.pushes > most) return false;
+            depth += shape.pushes - takes;
+        }
+        if (shape.flow != Flow::Next) {
+            uint32_t distance = shape.flow == Flow::End ? 0 : ReadU16(operands);
+            if (shape.flow == Flow::Loop) {
+                // Back to the start of an instruction at or before this one,
+                // already reached at the same depth. A shorter distance would
+                // land inside the Loop's own operand or past it.
+                if (distance < 1u + shape.operands || distance > next) return false;
+                int32_t target_depth = depth_at[next - distance];
+                if (target_depth == kInside || (reachable && target_depth != depth)) return false;
+            } else if (shape.flow != Flow::End && reachable) {
+                uint64_t target = uint64_t(next) + distance;
+                if (target >= size || (depth_at[target] != kUnseen && depth_at[target] != depth)) return false;
+                depth_at[target] = depth;
+            }
+            if (shape.flow != Flow::Branch) reachable = false;
+        }
+        pc = next;
+    }
+    // Running off the end
+    return !reachable;
+}
+
+ScriptProgram::ScriptProgram()
+    : blob(nullptr), blob_size(0), header(nullptr), constants(nullptr), functions(nullptr), imports(nullptr),
+      code(nullptr), strings(nullptr) {}
+
+bool ScriptProgram::Bind(const uint8_t* data, size_t size) {
+    *this = ScriptProgram();
+    if (!data || size < sizeof(ProgramHeader) || (reinterpret_cast<uintptr_t>(data) & 7) != 0) return false;
+    const ProgramHeader* head = reinterpret_cast<const ProgramHeader*>(data);
+    if (head->magic != kProgramMagic || head->version != kBytecodeVersion) return false;
+
+    // 64-bit sums, so huge counts in a damaged blob cannot wrap around
+    uint64_t at = sizeof(ProgramHeader);
+    uint64_t constants_at = at;
+    at += AlignProgramSection(uint64_t(head->constant_count) * sizeof(double));
+    uint64_t functions_at = at;
+    at += AlignProgramSection(uint64_t(head->function_count) * sizeof(FunctionInfo));
+    uint64_t imports_at = at;
+    at += AlignProgramSection(uint64_t(head->import_count) * sizeof(uint32_t));
+    uint64_t code_at = at;
+    at += AlignProgramSection(head->code_size);
+    uint64_t strings_at = at;
+    at += AlignProgramSection(head->string_size);
+    if (at > size) return false;
+
+    const char* pool = reinterpret_cast<const char*>(data + strings_at);
+    auto valid_string = [&](uint32_t offset) {
+        return offset < head->string_size && memchr(pool + offset, 0, head->string_size - offset) != nullptr;
+    };
+    const FunctionInfo* table = reinterpret_cast<const FunctionInfo*>(data + functions_at);
+    for (uint32_t f = 0; f < head->function_count; ++f) {
+        const FunctionInfo& info = table[f];
+        if (!valid_string(info.name)) return false;
+        if (uint64_t(info.code_offset) + info.code_size > head->code_size) return false;
+        if (info.local_count < info.arity || info.max_stack < info.local_count) return false;
+    }
+    const uint32_t* import_table = reinterpret_cast<const uint32_t*>(data + imports_at);
+    for (uint32_t i = 0; i < head->import_count; ++i) {
+        if (!valid_string(import_table[i])) return false;
+    }
+    // The VM checks nothing but max_stack as it runs, so the code must be
+    // sound before it is used, wherever the blob came from. Most scripts'
+    // code fits the buffer on the stack.
+    int32_t small_depths[2048];
+    utils::data_structures::DynamicArray<int32_t> large_depths;
+    int32_t* depths = small_depths;
+    if (head->code_size > 2048) {
+        large_depths.Resize(head->code_size);
+        depths = large_depths.Data();
+    }
+    for (uint32_t f = 0; f < head->function_count; ++f) {
+        const FunctionInfo& info = table[f];
+        if (!VerifyFunction(*head, table, info, data + code_at + info.code_offset, depths + info.code_offset)) {
+            return false;
+        }
+    }
+
+    blob = data;
+    blob_size = size;
+    header = head;
+    constants = reinterpret_cast<const double*>(data + constants_at);
+    functions = table;
+    imports = import_table;
+    code = data + code_at;
+    strings = pool;
+    return true;
+}
+
+bool ScriptProgram::Valid() const {
+    return header != nullptr;
+}
+
+uint32_t ScriptProgram::FunctionCount() const {
+    return header ? header->function_count : 0;
+}
+
+const FunctionInfo& ScriptProgram::Function(uint32_t index) const {
+    return functions[index];
+}
+
+const char* ScriptProgram::FunctionName(uint32_t index) const {
+    return strings + functions[index].name;
+}
+
+int32_t ScriptProgram::FindFunction(const char* name) const {
+    for (uint32_t f = 0; f < FunctionCount(); ++f) {
+        if (strcmp(strings + functions[f].name, name) == 0) return int32_t(f);
+    }
+    return -1;
+}
+
+uint32_t ScriptProgram::ImportCount() const {
+    return header ? header->import_count : 0;
+}
+
+const char* ScriptProgram::ImportName(uint32_t index) const {
+    return strings + imports[index];
+}
+
+uint32_t ScriptProgram::ConstantCount() const {
+    return header ? header->constant_count : 0;
+}
+
+const double* ScriptProgram::Constants() const {
+    return constants;
+}
+
+const uint8_t* ScriptProgram::Code() const {
+    return code;
+}
+
+const uint8_t* ScriptProgram::Blob() const {
+    return blob;
+}
+
+size_t ScriptProgram::BlobSize() const {
+    return blob_size;
+}
+
+} // namespace scripting
+} // namespace toybox
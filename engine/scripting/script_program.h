@@ -0,0 +1,131 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint16_t, uint32_t, uint64_t
+
+namespace toybox
+{
+namespace scripting
+{
+
+// Bumped whenever the opcodes or the program layout change; programs and
+// caches written by another version are rejected
+constexpr uint32_t kBytecodeVersion = 4;
+
+constexpr uint32_t kProgramMagic = 0x434D4245; // "EBMC"
+
+// Operands follow the opcode byte, little-endian
+enum class Op : uint8_t {
+    Constant,     // u16 index into the number pool
+    Nil,
+    True,
+    False,
+    Pop,
+    GetLocal,     // u8 slot
+    SetLocal,     // u8 slot; leaves the value on the stack
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Modulo,
+    Negate,
+    Not,
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Jump,         // u16 forward distance
+    JumpIfFalse,  // u16 forward distance; leaves the condition on the stack
+    Loop,         // u16 backward distance
+    Call,         // u16 function, u8 argument count
+    CallNative,   // u16 import, u8 argument count
+    Return,
+    Index,        // view or array, index -> element
+    SetIndex,     // view or array, index, value -> value
+    NewArray,     // u16 count; that many values -> array
+};
+
+struct ProgramHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t function_count;
+    uint32_t import_count;
+    uint32_t constant_count;
+    uint32_t code_size;
+    uint32_t string_size;
+    uint32_t reserved;
+};
+
+struct FunctionInfo {
+    uint32_t name;        // Offset into the string pool
+    uint32_t code_offset;
+    uint32_t code_size;
+    uint8_t arity;
+    uint8_t local_count;  // Arguments included
+    uint16_t max_stack;   // Values on the stack at the deepest point, locals included
+};
+
+// A compiled script is one flat blob: the header, then the number pool,
+// the function table, the imports (string offsets of the natives it calls),
+// the code and the string pool, each section 8-byte aligned. The blob is the
+// same in memory and on disk, so a program is used straight out of a mapped
+// cache file with nothing to decode.
+//
+// ScriptProgram is a view over such a blob and does not own it.
+struct ScriptProgram {
+private:
+    const uint8_t* blob;
+    size_t blob_size;
+    const ProgramHeader* header;
+    const double* constants;
+    const FunctionInfo* functions;
+    const uint32_t* imports;
+    const uint8_t* code;
+    const char* strings;
+
+public:
+    ScriptProgram();
+
+    // Checks the header, that every section and offset lies inside the
+    // blob, and every instruction: its operands, where it jumps to, and the
+    // stack depth it runs at against the function's locals and max_stack.
+    // blob must be 8-byte aligned.
+    bool Bind(const uint8_t* data, size_t size);
+    bool Valid() const;
+
+    uint32_t FunctionCount() const;
+    const FunctionInfo& Function(uint32_t index) const;
+    const char* FunctionName(uint32_t index) const;
+    // Returns the function's index, or -1 if there is none by that name
+    int32_t FindFunction(const char* name) const;
+
+    uint32_t ImportCount() const;
+    const char* ImportName(uint32_t index) const;
+
+    uint32_t ConstantCount() const;
+    const double* Constants() const;
+    const uint8_t* Code() const;
+
+    const uint8_t* Blob() const;
+    size_t BlobSize() const;
+};
+
+// Rounds a section size up to the blob's alignment
+constexpr uint64_t AlignProgramSection(uint64_t size) {
+    return (size + 7) & ~uint64_t(7);
+}
+
+} // namespace scripting
+} // namespace toybox
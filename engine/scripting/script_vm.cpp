@@ -0,0 +1,361 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cmath>   // For fmod
+#include <cstdarg> // For va_list, va_start, va_end
+#include <cstdio>  // For vsnprintf
+#include <cstdlib> // For malloc, free
+#include <cstring> // For strcmp
+
+#include "script_vm.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+static bool Truthy(const Value& value) {
+    return !(value.type == ValueType::Nil || (value.type == ValueType::Bool && !value.boolean));
+}
+
+static bool ValuesEqual(const Value& a, const Value& b) {
+    if (a.type != b.type) return false;
+    switch (a.type) {
+    case ValueType::Nil: return true;
+    case ValueType::Bool: return a.boolean == b.boolean;
+    case ValueType::Number: return a.number == b.number;
+    case ValueType::View: return a.view == b.view;
+    case ValueType::Array: return a.array == b.array;
+    }
+    return false;
+}
+
+static double ReadElement(const ScriptView& view, uint32_t index) {
+    const uint8_t* at = view.data + size_t(index) * view.stride;
+    switch (view.element) {
+    case ViewElement::Float32: return *reinterpret_cast<const float*>(at);
+    case ViewElement::Float64: return *reinterpret_cast<const double*>(at);
+    case ViewElement::Int32: return *reinterpret_cast<const int32_t*>(at);
+    case ViewElement::UInt32: return *reinterpret_cast<const uint32_t*>(at);
+    }
+    return 0.0;
+}
+
+static void WriteElement(const ScriptView& view, uint32_t index, double value) {
+    uint8_t* at = view.data + size_t(index) * view.stride;
+    switch (view.element) {
+    case ViewElement::Float32: *reinterpret_cast<float*>(at) = float(value); break;
+    case ViewElement::Float64: *reinterpret_cast<double*>(at) = value; break;
+    case ViewElement::Int32: *reinterpret_cast<int32_t*>(at) = int32_t(value); break;
+    case ViewElement::UInt32: *reinterpret_cast<uint32_t*>(at) = uint32_t(value); break;
+    }
+}
+
+static uint32_t ReadU16(const uint8_t* at) {
+    return uint32_t(at[0]) | (uint32_t(at[1]) << 8);
+}
+
+ScriptVM::ScriptVM()
+    : stack(static_cast<Value*>(malloc(sizeof(Value) * kScriptStackSize))),
+      frames(static_cast<Frame*>(malloc(sizeof(Frame) * kScriptMaxFrames))), profiler(nullptr),
+      heap(nullptr) {
+    if (!stack || !frames) abort();
+    error[0] = 0;
+}
+
+ScriptVM::~ScriptVM() {
+    free(stack);
+    free(frames);
+}
+
+bool ScriptVM::Fail(const char* format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+    vsnprintf(error, sizeof(error), format, arguments);
+    va_end(arguments);
+    return false;
+}
+
+void ScriptVM::RegisterNative(const char* name, NativeFunction function, void* context) {
+    for (size_t i = 0; i < natives.Size(); ++i) {
+        Native& native = natives.Data()[i];
+        if (strcmp(native.name.CStr(), name) == 0) {
+            native.function = function;
+            native.context = context;
+            return;
+        }
+    }
+    natives.PushBack(Native{ utils::data_structures::DynamicString(name), function, context });
+}
+
+bool ScriptVM::Link(const ScriptProgram& program, ScriptModule* module) {
+    if (!program.Valid()) return Fail("Program is not valid");
+    module->program = program;
+    module->natives.Resize(program.ImportCount());
+    for (uint32_t i = 0; i < program.ImportCount(); ++i) {
+        const char* name = program.ImportName(i);
+        uint32_t found = 0;
+        while (found < natives.Size() && strcmp(natives.Data()[found].name.CStr(), name) != 0) ++found;
+        if (found == natives.Size()) return Fail("No native function '%s'", name);
+        module->natives.Data()[i] = found;
+    }
+    return true;
+}
+
+bool ScriptVM::Call(const ScriptModule& module, uint32_t function, const Value* arguments, uint32_t count,
+                    Value* result) {
+    error[0] = 0;
+    if (function >= module.program.FunctionCount()) return Fail("No function %u", function);
+    const FunctionInfo& info = module.program.Function(function);
+    if (info.max_stack > kScriptStackSize) {
+        return Fail("Script stack overflow in '%s'", module.program.FunctionName(function));
+    }
+    for (uint32_t i = 0; i < info.local_count; ++i) {
+        stack[i] = i < count && i < info.arity ? arguments[i] : NilValue();
+    }
+    Frame* entry = frames;
+    entry->function = &info;
+    entry->ip = module.program.Code() + info.code_offset;
+    entry->base = stack;
+    if (!profiler || profiler->Mode() == ProfileMode::Off) return Run<false>(module, entry, result);
+
+    uint32_t depth = profiler->Depth();
+    profiler->Enter(module.id, function, module.program.FunctionName(function));
+    if (Run<true>(module, entry, result)) return true;
+    profiler->Unwind(depth);
+    return false;
+}
+
+void ScriptVM::SetProfiler(ScriptProfiler* new_profiler) {
+    profiler = new_profiler;
+}
+
+void ScriptVM::SetHeap(ScriptHeap* new_heap) {
+    heap = new_heap;
+}
+
+template<bool kProfiled>
+bool ScriptVM::Run(const ScriptModule& module, Frame* entry, Value* result) {
+    const ScriptProgram& program = module.program;
+    const double* constants = program.Constants();
+    const uint8_t* code = program.Code();
+    const Native* native_table = natives.Data();
+    const uint32_t* bound = module.natives.Data();
+    Value* const stack_end = stack + kScriptStackSize;
+    ScriptProfiler* const profile = profiler;
+
+    Frame* frame = entry;
+    const uint8_t* ip = frame->ip;
+    Value* base = frame->base;
+    Value* top = base + frame->function->local_count;
+    auto running = [&]() {
+        return program.FunctionName(static_cast<uint32_t>(frame->function - &program.Function(0)));
+    };
+
+    // Pops the right operand into b and reads the left into a
+#define TOYBOX_SCRIPT_NUMBERS(a, b)                                                                                \
+    if (top[-2].type != ValueType::Number || top[-1].type != ValueType::Number) {                                  \
+        return Fail("Operands must be numbers in '%s'", running());                                                \
+    }                                                                                                              \
+    double a = top[-2].number, b = top[-1].number;                                                                 \
+    --top
+
+    // Checks the view or array and index below the top `depth` values,
+    // leaving the index in i
+#define TOYBOX_SCRIPT_ELEMENT(i, depth)                                                                            \
+    if (top[-(depth)].type != ValueType::View && top[-(depth)].type != ValueType::Array) {                         \
+        return Fail("Only views and arrays can be indexed, in '%s'", running());                                   \
+    }                                                                                                              \
+    if (top[-(depth) + 1].type != ValueType::Number) return Fail("Index must be a number in '%s'", running());     \
+    double i = top[-(depth) + 1].number;                                                                           \
+    uint32_t i##_count = top[-(depth)].type == ValueType::View ? top[-(depth)].view->count                         \
+                                                                : top[-(depth)].array->count;                      \
+    if (!(i >= 0.0 && i < double(i##_count))) {                                                                    \
+        return Fail("Index %g out of range in '%s', which holds %u", i, running(), i##_count);                     \
+    }
+
+    for (;;) {
+        Op op = static_cast<Op>(*ip++);
+        switch (op) {
+        case Op::Constant:
+            *top++ = NumberValue(constants[ReadU16(ip)]);
+            ip += 2;
+            break;
+        case Op::Nil: *top++ = NilValue(); break;
+        case Op::True: *top++ = BoolValue(true); break;
+        case Op::False: *top++ = BoolValue(false); break;
+        case Op::Pop: --top; break;
+        case Op::GetLocal: *top++ = base[*ip++]; break;
+        case Op::SetLocal: base[*ip++] = top[-1]; break;
+        case Op::Add: {
+            TOYBOX_SCRIPT_NUMBERS(a, b);
+            top[-1] = NumberValue(a + b);
+            break;
+        }
+        case Op::Subtract: {
+            TOYBOX_SCRIPT_NUMBERS(a, b);
+            top[-1] = NumberValue(a - b);
+            break;
+        }
+        case Op::Multiply: {
+            TOYBOX_SCRIPT_NUMBERS(a, b);
+            top[-1] = NumberValue(a * b);
+            break;
+        }
+        case Op::Divide: {
+            TOYBOX_SCRIPT_NUMBERS(a, b);
+            top[-1] = NumberValue(a / b);
+            break;
+        }
+        case Op::Modulo: {
+            TOYBOX_SCRIPT_NUMBERS(a, b);
+            top[-1] = NumberValue(fmod(a, b));
+            break;
+        }
+        case Op::Less: {
+            TOYBOX_SCRIPT_NUMBERS(a, b);
+            top[-1] = BoolValue(a < b);
+            break;
+        }
+        case Op::LessEqual: {
+            TOYBOX_SCRIPT_NUMBERS(a, b);
+            top[-1] = BoolValue(a <= b);
+            break;
+        }
+        case Op::Greater: {
+            TOYBOX_SCRIPT_NUMBERS(a, b);
+            top[-1] = BoolValue(a > b);
+            break;
+        }
+        case Op::GreaterEqual: {
+            TOYBOX_SCRIPT_NUMBERS(a, b);
+            top[-1] = BoolValue(a >= b);
+            break;
+        }
+        case Op::Negate:
+            if (top[-1].type != ValueType::Number) {
+                return Fail("Operand must be a number in '%s'", running());
+            }
+            top[-1].number = -top[-1].number;
+            break;
+        case Op::Not: top[-1] = BoolValue(!Truthy(top[-1])); break;
+        case Op::Equal:
+            top[-2] = BoolValue(ValuesEqual(top[-2], top[-1]));
+            --top;
+            break;
+        case Op::NotEqual:
+            top[-2] = BoolValue(!ValuesEqual(top[-2], top[-1]));
+            --top;
+            break;
+        case Op::Jump: ip += ReadU16(ip) + 2; break;
+        case Op::JumpIfFalse: ip += Truthy(top[-1]) ? 2 : ReadU16(ip) + 2; break;
+        case Op::Loop:
+            ip -= ReadU16(ip) - 2;
+            if constexpr (kProfiled) {
+                if (profile->SampleDue()) profile->TakeSample();
+            }
+            break;
+        case Op::Call: {
+            uint32_t callee_index = ReadU16(ip);
+            const FunctionInfo& callee = program.Function(callee_index);
+            uint32_t count = ip[2];
+            ip += 3;
+            if (frame + 1 == frames + kScriptMaxFrames) return Fail("Too many nested calls");
+            Value* callee_base = top - count;
+            // Nothing is checked as values are pushed: max_stack bounds them
+            if (callee_base + callee.max_stack > stack_end) return Fail("Script stack overflow");
+            for (uint32_t i = count; i < callee.local_count; ++i) callee_base[i] = NilValue();
+            frame->ip = ip;
+            ++frame;
+            frame->function = &callee;
+            frame->base = callee_base;
+            ip = code + callee.code_offset;
+            base = callee_base;
+            top = base + callee.local_count;
+            if constexpr (kProfiled) {
+                profile->Enter(module.id, callee_index, program.FunctionName(callee_index));
+                if (profile->SampleDue()) profile->TakeSample();
+            }
+            break;
+        }
+        case Op::CallNative: {
+            const Native& native = native_table[bound[ReadU16(ip)]];
+            uint32_t count = ip[2];
+            ip += 3;
+            Value returned = NilValue();
+            if (!native.function(native.context, top - count, count, &returned)) {
+                return Fail("Native '%s' failed", native.name.CStr());
+            }
+            top -= count;
+            *top++ = returned;
+            break;
+        }
+        case Op::Return: {
+            if constexpr (kProfiled) {
+                if (profile->SampleDue()) profile->TakeSample();
+                profile->Exit();
+            }
+            Value returned = top[-1];
+            if (frame == entry) {
+                *result = returned;
+                return true;
+            }
+            top = base;
+            *top++ = returned;
+            --frame;
+            ip = frame->ip;
+            base = frame->base;
+            break;
+        }
+        case Op::Index: {
+            TOYBOX_SCRIPT_ELEMENT(index, 2);
+            if (top[-2].type == ValueType::Array) top[-2] = top[-2].array->Items()[uint32_t(index)];
+            else top[-2] = NumberValue(ReadElement(*top[-2].view, uint32_t(index)));
+            --top;
+            break;
+        }
+        case Op::SetIndex: {
+            TOYBOX_SCRIPT_ELEMENT(index, 3);
+            if (top[-3].type == ValueType::Array) {
+                ScriptArray* array = top[-3].array;
+                array->Items()[uint32_t(index)] = top[-1];
+                if (top[-1].type == ValueType::Array) heap->WriteBarrier(array, top[-1].array);
+            } else {
+                const ScriptView& view = *top[-3].view;
+                if (view.read_only) return Fail("Write to a read-only view in '%s'", running());
+                if (top[-1].type != ValueType::Number) return Fail("Views hold numbers, in '%s'", running());
+                WriteElement(view, uint32_t(index), top[-1].number);
+            }
+            top[-3] = top[-1];
+            top -= 2;
+            break;
+        }
+        case Op::NewArray: {
+            uint32_t count = ReadU16(ip);
+            ip += 2;
+            if (!heap) return Fail("No heap to make an array in, in '%s'", running());
+            ScriptArray* array = heap->NewArray(top - count, count);
+            top -= count;
+            *top++ = ArrayValue(array);
+            break;
+        }
+        default: return Fail("Bad opcode %u", unsigned(op));
+        }
+    }
+#undef TOYBOX_SCRIPT_NUMBERS
+#undef TOYBOX_SCRIPT_ELEMENT
+}
+
+const char* ScriptVM::Error() const {
+    return error;
+}
+
+} // namespace scripting
+} // namespace toybox
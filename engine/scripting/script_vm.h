@@ -0,0 +1,187 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstdint> // For uint8_t, uint32_t
+
+#include "dynamicarray.h"
+#include "dynamicstring.h"
+#include "script_heap.h"
+#include "script_profiler.h"
+#include "script_program.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+enum class ValueType : uint8_t {
+    Nil,
+    Bool,
+    Number,
+    View,
+    Array, // Made by a script, in the heap
+};
+
+enum class ViewElement : uint8_t {
+    Float32,
+    Float64,
+    Int32,
+    UInt32,
+};
+
+inline uint32_t ViewElementSize(ViewElement element) {
+    switch (element) {
+    case ViewElement::Float32: return 4;
+    case ViewElement::Float64: return 8;
+    case ViewElement::Int32: return 4;
+    case ViewElement::UInt32: return 4;
+    }
+    return 0;
+}
+
+// A strided window onto host memory, such as one field of a Part column.
+// Scripts index it like an array and read and write the host's memory in
+// place; elements convert to and from numbers as they are accessed. The host
+// owns both the view and the memory, and must keep them alive while a script
+// can reach them.
+struct ScriptView {
+    uint8_t* data;
+    uint32_t count;
+    uint32_t stride; // Bytes from one element to the next
+    ViewElement element;
+    bool read_only;
+};
+
+struct Value {
+    ValueType type;
+    union {
+        bool boolean;
+        double number;
+        ScriptView* view;
+        ScriptArray* array;
+    };
+};
+
+inline Value NilValue() {
+    Value value;
+    value.type = ValueType::Nil;
+    value.number = 0.0;
+    return value;
+}
+
+inline Value BoolValue(bool boolean) {
+    Value value;
+    value.type = ValueType::Bool;
+    value.number = 0.0;
+    value.boolean = boolean;
+    return value;
+}
+
+inline Value NumberValue(double number) {
+    Value value;
+    value.type = ValueType::Number;
+    value.number = number;
+    return value;
+}
+
+inline Value ViewValue(ScriptView* view) {
+    Value value;
+    value.type = ValueType::View;
+    value.view = view;
+    return value;
+}
+
+inline Value ArrayValue(ScriptArray* array) {
+    Value value;
+    value.type = ValueType::Array;
+    value.array = array;
+    return value;
+}
+
+// Host functions scripts can call. Returning false stops the script with an
+// error.
+typedef bool (*NativeFunction)(void* context, const Value* arguments, uint32_t count, Value* result);
+
+// Values on the stack, locals included, and nested calls a script may make
+constexpr uint32_t kScriptStackSize = 4096;
+constexpr uint32_t kScriptMaxFrames = 256;
+
+// A program whose imports have been bound to natives
+struct ScriptModule {
+    ScriptProgram program;
+    utils::data_structures::DynamicArray<uint32_t> natives; // By import, index into the VM's natives
+    uint32_t id = 0; // Identifies the script to the profiler
+};
+
+// Runs compiled programs on a value stack. The stack and frames are fixed
+// arrays owned by the VM; the arrays scripts make come from the heap it is
+// given, and nothing else is allocated while a script runs.
+// A call only goes ahead if its function's max_stack fits on what is left
+// of the stack, so pushes within it need no checks of their own.
+struct ScriptVM {
+private:
+    struct Native {
+        utils::data_structures::DynamicString name;
+        NativeFunction function;
+        void* context;
+    };
+
+    struct Frame {
+        const FunctionInfo* function;
+        const uint8_t* ip;
+        Value* base;
+    };
+
+    utils::data_structures::DynamicArray<Native> natives;
+    Value* stack;
+    Frame* frames;
+    ScriptProfiler* profiler;
+    ScriptHeap* heap;
+    char error[160];
+
+    bool Fail(const char* format, ...);
+
+    // Built twice, so the interpreter runs without any profiling code
+    // unless a profiler is on
+    template<bool kProfiled>
+    bool Run(const ScriptModule& module, Frame* entry, Value* result);
+
+public:
+    ScriptVM();
+    ~ScriptVM();
+
+    ScriptVM(const ScriptVM&) = delete;
+    ScriptVM& operator=(const ScriptVM&) = delete;
+
+    // Registering a name again replaces the function for modules linked
+    // from then on
+    void RegisterNative(const char* name, NativeFunction function, void* context);
+
+    // Binds program's imports to registered natives. Fails, naming the first
+    // missing native, if any is not registered.
+    bool Link(const ScriptProgram& program, ScriptModule* module);
+
+    // Calls a function of a linked module. Missing arguments are nil and
+    // extra ones are dropped. On failure Error() says why.
+    bool Call(const ScriptModule& module, uint32_t function, const Value* arguments, uint32_t count, Value* result);
+
+    // Reports calls to profiler while its mode is not Off; null detaches
+    void SetProfiler(ScriptProfiler* profiler);
+
+    // Where scripts make arrays; without one, making an array fails
+    void SetHeap(ScriptHeap* heap);
+
+    const char* Error() const;
+};
+
+} // namespace scripting
+} // namespace toybox
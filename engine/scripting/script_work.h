@@ -0,0 +1,127 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For int32_t, uint32_t
+
+#include "dynamicarray.h"
+#include "scripting_integration.h"
+#include "world.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+// The element a view reads and writes a member of type T as
+template<typename T>
+struct ViewElementOf {
+    static_assert(sizeof(T) == 0, "Views only expose float, double, int32_t and uint32_t members");
+};
+
+template<>
+struct ViewElementOf<float> {
+    static constexpr ViewElement value = ViewElement::Float32;
+};
+
+template<>
+struct ViewElementOf<double> {
+    static constexpr ViewElement value = ViewElement::Float64;
+};
+
+template<>
+struct ViewElementOf<int32_t> {
+    static constexpr ViewElement value = ViewElement::Int32;
+};
+
+template<>
+struct ViewElementOf<uint32_t> {
+    static constexpr ViewElement value = ViewElement::UInt32;
+};
+
+// Runs a script function as a Work over every block of Toys holding Parts...,
+// calling into the script once per block rather than once per Toy. The
+// function is called as
+//
+//     fn update(count, <arguments...>, <views...>)
+//
+// with the block's row count, the arguments given to Run, then one view per
+// bound field in the order they were bound. Views index the block's Part
+// columns directly, so the script reads and writes the Parts in place and
+// nothing is copied in or out. Fields of const Parts are read-only, and the
+// columns of the other Parts are stamped as changed like any EachBlock write.
+//
+// All of Parts... must be packed.
+template<typename Registry, typename... Parts>
+struct ScriptWork {
+    static_assert(sizeof...(Parts) > 0, "A script Work needs at least one Part");
+
+private:
+    struct Field {
+        uint32_t part;   // Position in Parts...
+        uint32_t offset; // Bytes into the Part
+        ViewElement element;
+        bool read_only;
+    };
+
+    ScriptingSystem* system;
+    Script script;
+    int32_t function;
+    utils::data_structures::DynamicArray<Field> fields;
+    utils::data_structures::DynamicArray<ScriptView> views;
+    utils::data_structures::DynamicArray<Value> arguments;
+    uint32_t block_count;
+    uint32_t row_count;
+
+    template<typename Filter>
+    bool RunBlocks(ecs::World<Registry>& world, const Filter& filter, const Value* extra, uint32_t extra_count);
+
+public:
+    // Fails, leaving Valid() false, if the script has no such function
+    ScriptWork(ScriptingSystem& system, Script script, const char* function);
+
+    bool Valid() const;
+
+    // Exposes member of every Part in the column as the next view, e.g.
+    // BindField(&Health::value); the member's type sets the view's element
+    template<typename Part, typename Member>
+    void BindField(Member Part::*member);
+
+    // As above for a member of a member, e.g.
+    // BindField(&Transform::position, &Vec3::y)
+    template<typename Part, typename Outer, typename Member>
+    void BindField(Outer Part::*outer, Member Outer::*member);
+
+    // Exposes the element at offset bytes into every Part in the column, for
+    // fields no member pointer names, such as one item of an array member.
+    // Aborts unless the element lies wholly inside the Part and is aligned.
+    template<typename Part>
+    void BindField(size_t offset, ViewElement element);
+
+    // Calls the function for every block. Stops at the first block the
+    // script fails on and returns false; the system's Error() says why.
+    bool Run(ecs::World<Registry>& world, const Value* extra = nullptr, uint32_t extra_count = 0);
+
+    // As Run, over the blocks that pass a Changed or Added filter
+    template<typename Filter>
+    bool Run(ecs::World<Registry>& world, const Filter& filter, const Value* extra = nullptr,
+             uint32_t extra_count = 0);
+
+    // Script calls the last Run made, and the Toys they covered
+    uint32_t BlockCount() const;
+    uint32_t RowCount() const;
+};
+
+} // namespace scripting
+} // namespace toybox
+
+#include "script_work.inl"
@@ -0,0 +1,131 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstddef>     // For size_t
+#include <cstdlib>     // For abort
+#include <type_traits> // For std::remove_const, std::remove_cv
+
+namespace toybox
+{
+namespace scripting
+{
+
+template<typename Registry, typename... Parts>
+ScriptWork<Registry, Parts...>::ScriptWork(ScriptingSystem& system, Script script, const char* function)
+    : system(&system), script(script), function(system.FindFunction(script, function)), block_count(0),
+      row_count(0) {}
+
+template<typename Registry, typename... Parts>
+bool ScriptWork<Registry, Parts...>::Valid() const {
+    return function >= 0;
+}
+
+// Where member lies in an Outer, found through storage shaped like one as
+// no Outer need be constructible
+template<typename Outer, typename Member>
+size_t MemberOffset(Member Outer::*member) {
+    alignas(Outer) static const unsigned char storage[sizeof(Outer)] = {};
+    const Outer* outer = reinterpret_cast<const Outer*>(storage);
+    return static_cast<size_t>(reinterpret_cast<const unsigned char*>(&(outer->*member)) - storage);
+}
+
+template<typename Registry, typename... Parts>
+template<typename Part, typename Member>
+void ScriptWork<Registry, Parts...>::BindField(Member Part::*member) {
+    BindField<Part>(MemberOffset(member), ViewElementOf<typename std::remove_cv<Member>::type>::value);
+}
+
+template<typename Registry, typename... Parts>
+template<typename Part, typename Outer, typename Member>
+void ScriptWork<Registry, Parts...>::BindField(Outer Part::*outer, Member Outer::*member) {
+    BindField<Part>(MemberOffset(outer) + MemberOffset(member),
+                    ViewElementOf<typename std::remove_cv<Member>::type>::value);
+}
+
+template<typename Registry, typename... Parts>
+template<typename Part>
+void ScriptWork<Registry, Parts...>::BindField(size_t offset, ViewElement element) {
+    typedef typename std::remove_const<Part>::type Plain;
+    static_assert(ecs::PartListContains<Plain, typename std::remove_const<Parts>::type...>::value,
+                  "Part is not one of the Work's Parts");
+    static_assert(!Registry::template IsSparse<Plain>(), "Script Works only walk packed Parts");
+    uint32_t size = ViewElementSize(element);
+    if (offset > sizeof(Plain) || sizeof(Plain) - offset < size || offset % size != 0) abort();
+    uint32_t part = ecs::PartIndexOf<Plain, typename std::remove_const<Parts>::type...>::value;
+    bool read_only = ecs::PartListContains<const Plain, Parts...>::value;
+    fields.PushBack(Field{ part, static_cast<uint32_t>(offset), element, read_only });
+}
+
+template<typename Registry, typename... Parts>
+template<typename Filter>
+bool ScriptWork<Registry, Parts...>::RunBlocks(ecs::World<Registry>& world, const Filter& filter, const Value* extra,
+                                               uint32_t extra_count) {
+    block_count = 0;
+    row_count = 0;
+    if (function < 0) return false;
+
+    // The argument list is built once; each block only moves the views
+    uint32_t field_count = static_cast<uint32_t>(fields.Size());
+    views.Resize(field_count);
+    arguments.Resize(1 + extra_count + field_count);
+    Value* values = arguments.Data();
+    for (uint32_t i = 0; i < extra_count; ++i) values[1 + i] = extra[i];
+    for (uint32_t f = 0; f < field_count; ++f) {
+        const Field& field = fields.Data()[f];
+        views.Data()[f] = ScriptView{ nullptr, 0, 0, field.element, field.read_only };
+        values[1 + extra_count + f] = ViewValue(&views.Data()[f]);
+    }
+
+    bool ok = true;
+    world.template EachBlock<Parts...>(filter, [&](uint32_t count, const ecs::Toy*, Parts*... columns) {
+        if (!ok) return;
+        uint8_t* bases[] = { reinterpret_cast<uint8_t*>(
+            const_cast<typename std::remove_const<Parts>::type*>(columns))... };
+        const uint32_t strides[] = { static_cast<uint32_t>(sizeof(Parts))... };
+        for (uint32_t f = 0; f < field_count; ++f) {
+            const Field& field = fields.Data()[f];
+            ScriptView& view = views.Data()[f];
+            view.data = bases[field.part] + field.offset;
+            view.count = count;
+            view.stride = strides[field.part];
+        }
+        values[0] = NumberValue(double(count));
+        Value result;
+        ok = system->Call(script, uint32_t(function), values, static_cast<uint32_t>(arguments.Size()), &result);
+        ++block_count;
+        row_count += count;
+    });
+    return ok;
+}
+
+template<typename Registry, typename... Parts>
+bool ScriptWork<Registry, Parts...>::Run(ecs::World<Registry>& world, const Value* extra, uint32_t extra_count) {
+    return RunBlocks(world, ecs::NoFilter(), extra, extra_count);
+}
+
+template<typename Registry, typename... Parts>
+template<typename Filter>
+bool ScriptWork<Registry, Parts...>::Run(ecs::World<Registry>& world, const Filter& filter, const Value* extra,
+                                         uint32_t extra_count) {
+    return RunBlocks(world, filter, extra, extra_count);
+}
+
+template<typename Registry, typename... Parts>
+uint32_t ScriptWork<Registry, Parts...>::BlockCount() const {
+    return block_count;
+}
+
+template<typename Registry, typename... Parts>
+uint32_t ScriptWork<Registry, Parts...>::RowCount() const {
+    return row_count;
+}
+
+} // namespace scripting
+} // namespace toybox
@@ -0,0 +1,191 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstdio>  // For snprintf
+#include <cstdlib> // For malloc, free
+#include <cstring> // For memcpy
+
+#include "scripting_integration.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+static bool ArrayNative(void* context, const Value* arguments, uint32_t count, Value* result) {
+    if (count != 1 || arguments[0].type != ValueType::Number) return false;
+    double length = arguments[0].number;
+    if (!(length >= 0.0 && length <= double(kScriptMaxArrayCount))) return false;
+    *result = ArrayValue(static_cast<ScriptHeap*>(context)->NewArray(nullptr, uint32_t(length)));
+    return true;
+}
+
+static bool LenNative(void*, const Value* arguments, uint32_t count, Value* result) {
+    if (count != 1) return false;
+    if (arguments[0].type == ValueType::Array) *result = NumberValue(arguments[0].array->count);
+    else if (arguments[0].type == ValueType::View) *result = NumberValue(arguments[0].view->count);
+    else return false;
+    return true;
+}
+
+ScriptingSystem::ScriptingSystem()
+    : cache(kBytecodeVersion), cache_enabled(false), stats{ 0, 0, 0 } {
+    error[0] = 0;
+    vm.SetProfiler(&profiler);
+    vm.SetHeap(&heap);
+    vm.RegisterNative("array", ArrayNative, &heap);
+    vm.RegisterNative("len", LenNative, nullptr);
+}
+
+ScriptingSystem::~ScriptingSystem() {
+    for (size_t i = 0; i < scripts.Size(); ++i) free(scripts.Data()[i].owned_blob);
+}
+
+void ScriptingSystem::SetError(const char* name, const char* message) {
+    snprintf(error, sizeof(error), "%s: %s", name, message);
+}
+
+bool ScriptingSystem::OpenCache(const char* path) {
+    cache_path = utils::data_structures::DynamicString(path);
+    cache_enabled = true;
+    return cache.Open(path);
+}
+
+bool ScriptingSystem::SaveCache() {
+    if (!cache_enabled) return false;
+    if (stats.compiled == 0) return true;
+    return cache.Save(cache_path.CStr());
+}
+
+void ScriptingSystem::RegisterNative(const char* name, NativeFunction function, void* context) {
+    vm.RegisterNative(name, function, context);
+}
+
+// Programs are used in place, so each needs a home that never moves
+static uint8_t* CopyBlob(const uint8_t* blob, size_t size) {
+    uint8_t* copy = static_cast<uint8_t*>(malloc(size));
+    if (!copy) abort();
+    memcpy(copy, blob, size);
+    return copy;
+}
+
+Script ScriptingSystem::Load(const char* name, const char* source, size_t length) {
+    uint64_t source_hash = cache_enabled ? HashScriptSource(source, length) : 0;
+    LoadedScript loaded = { utils::data_structures::DynamicString(name), ScriptModule(), nullptr };
+    loaded.module.id = static_cast<uint32_t>(scripts.Size());
+
+    const uint8_t* blob = nullptr;
+    size_t blob_size = 0;
+    BytecodeCacheStats before = cache.Stats();
+    if (cache_enabled && cache.Find(name, source_hash, &blob, &blob_size)) {
+        // Copied out like a compiled program: a stored blob moves on the next
+        // Store, and a mapped one goes away when the cache is opened again
+        loaded.owned_blob = CopyBlob(blob, blob_size);
+        ScriptProgram program;
+        // A blob that does not bind is treated like a stale one
+        if (program.Bind(loaded.owned_blob, blob_size) && vm.Link(program, &loaded.module)) {
+            profiler.NameScript(loaded.module.id, name);
+            scripts.PushBack(loaded);
+            ++stats.from_cache;
+            return Script{ static_cast<uint32_t>(scripts.Size() - 1) };
+        }
+        free(loaded.owned_blob);
+        loaded.owned_blob = nullptr;
+    }
+    if (cache.Stats().stale > before.stale) ++stats.stale;
+
+    CompileError compile_error;
+    if (!CompileScript(source, length, &compile_buffer, &compile_error)) {
+        char message[192];
+        snprintf(message, sizeof(message), "line %u: %s", compile_error.line, compile_error.message);
+        SetError(name, message);
+        return kNoScript;
+    }
+    loaded.owned_blob = CopyBlob(compile_buffer.Data(), compile_buffer.Size());
+    ScriptProgram program;
+    if (!program.Bind(loaded.owned_blob, compile_buffer.Size()) || !vm.Link(program, &loaded.module)) {
+        SetError(name, vm.Error());
+        free(loaded.owned_blob);
+        return kNoScript;
+    }
+    if (cache_enabled) cache.Store(name, source_hash, compile_buffer.Data(), compile_buffer.Size());
+    profiler.NameScript(loaded.module.id, name);
+    scripts.PushBack(loaded);
+    ++stats.compiled;
+    return Script{ static_cast<uint32_t>(scripts.Size() - 1) };
+}
+
+int32_t ScriptingSystem::FindFunction(Script script, const char* function) const {
+    if (script.index >= scripts.Size()) return -1;
+    return scripts.Data()[script.index].module.program.FindFunction(function);
+}
+
+bool ScriptingSystem::Call(Script script, uint32_t function, const Value* arguments, uint32_t count,
+                           Value* result) {
+    if (script.index >= scripts.Size()) {
+        SetError("?", "No such script");
+        return false;
+    }
+    const LoadedScript& loaded = scripts.Data()[script.index];
+    if (!vm.Call(loaded.module, function, arguments, count, result)) {
+        SetError(loaded.name.CStr(), vm.Error());
+        return false;
+    }
+    return true;
+}
+
+bool ScriptingSystem::Call(Script script, const char* function, const Value* arguments, uint32_t count,
+                           Value* result) {
+    int32_t index = FindFunction(script, function);
+    if (index < 0) {
+        SetError(script.index < scripts.Size() ? scripts.Data()[script.index].name.CStr() : "?", "No such function");
+        return false;
+    }
+    return Call(script, uint32_t(index), arguments, count, result);
+}
+
+void ScriptingSystem::EndFrame() {
+    heap.EndFrame();
+}
+
+ScriptHeap& ScriptingSystem::Heap() {
+    return heap;
+}
+
+const ScriptHeap& ScriptingSystem::Heap() const {
+    return heap;
+}
+
+ScriptProfiler& ScriptingSystem::Profiler() {
+    return profiler;
+}
+
+const ScriptProfiler& ScriptingSystem::Profiler() const {
+    return profiler;
+}
+
+const ScriptProgram& ScriptingSystem::Program(Script script) const {
+    return scripts.Data()[script.index].module.program;
+}
+
+uint32_t ScriptingSystem::ScriptCount() const {
+    return static_cast<uint32_t>(scripts.Size());
+}
+
+ScriptLoadStats ScriptingSystem::LoadStats() const {
+    return stats;
+}
+
+const char* ScriptingSystem::Error() const {
+    return error;
+}
+
+} // namespace scripting
+} // namespace toybox
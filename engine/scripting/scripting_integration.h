@@ -0,0 +1,131 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint32_t
+
+#include "bytecode_cache.h"
+#include "dynamicarray.h"
+#include "dynamicstring.h"
+#include "script_compiler.h"
+#include "script_heap.h"
+#include "script_profiler.h"
+#include "script_program.h"
+#include "script_vm.h"
+
+namespace toybox
+{
+namespace scripting
+{
+
+struct Script {
+    uint32_t index;
+
+    bool operator==(const Script& other) const {
+        return index == other.index;
+    }
+
+    bool operator!=(const Script& other) const {
+        return index != other.index;
+    }
+};
+
+constexpr Script kNoScript = { 0xFFFFFFFF };
+
+struct ScriptLoadStats {
+    uint32_t compiled;    // Parsed and compiled this run
+    uint32_t from_cache;  // Linked from the cache, not compiled
+    uint32_t stale;       // In the cache, but from older source
+};
+
+// Loads scripts and runs them. With a cache open, a script whose source
+// hashes the same as when it was cached is copied out of the mapped cache
+// file and linked, and the compiler never sees it; anything else is
+// compiled and stored, so SaveCache makes the next start faster.
+//
+// Scripts are compiled by CompileScript and run by ScriptVM, not by
+// EmberScript: the EmberScript submodule is not checked out in this tree,
+// so there is no compiler of theirs whose output could be cached, nor an
+// API to build against. The language is the part to swap once it is;
+// BytecodeCache only stores versioned blobs and would take its programs
+// unchanged.
+//
+// Natives have to be registered before the scripts that call them load.
+// Two come built in: array(n), a new array of n nils, and len(x), the
+// length of an array or view. Arrays scripts make live in Heap(); call
+// EndFrame once a frame, outside any script call, to collect them.
+struct ScriptingSystem {
+private:
+    struct LoadedScript {
+        utils::data_structures::DynamicString name;
+        ScriptModule module;
+        uint8_t* owned_blob; // The bound program, compiled or copied out of the cache
+    };
+
+    ScriptVM vm;
+    ScriptProfiler profiler;
+    ScriptHeap heap;
+    BytecodeCache cache;
+    utils::data_structures::DynamicString cache_path;
+    bool cache_enabled;
+    utils::data_structures::DynamicArray<LoadedScript> scripts;
+    utils::data_structures::DynamicArray<uint8_t> compile_buffer;
+    ScriptLoadStats stats;
+    char error[256];
+
+    void SetError(const char* name, const char* message);
+
+public:
+    ScriptingSystem();
+    ~ScriptingSystem();
+
+    ScriptingSystem(const ScriptingSystem&) = delete;
+    ScriptingSystem& operator=(const ScriptingSystem&) = delete;
+
+    // Caches compiled scripts at path from now on, loading what is already
+    // there. Returns whether an existing cache was usable.
+    bool OpenCache(const char* path);
+
+    // Writes the cache back if anything was compiled since it was opened
+    bool SaveCache();
+
+    void RegisterNative(const char* name, NativeFunction function, void* context);
+
+    // Returns kNoScript and sets Error() if the script does not compile or
+    // calls natives that are not registered
+    Script Load(const char* name, const char* source, size_t length);
+
+    // Returns -1 if the script has no such function
+    int32_t FindFunction(Script script, const char* function) const;
+
+    bool Call(Script script, uint32_t function, const Value* arguments, uint32_t count, Value* result);
+    bool Call(Script script, const char* function, const Value* arguments, uint32_t count, Value* result);
+
+    // Collects the arrays scripts made this frame that the heap's roots no
+    // longer reach
+    void EndFrame();
+
+    ScriptHeap& Heap();
+    const ScriptHeap& Heap() const;
+
+    // Off until given a mode; see ScriptProfiler
+    ScriptProfiler& Profiler();
+    const ScriptProfiler& Profiler() const;
+
+    const ScriptProgram& Program(Script script) const;
+    uint32_t ScriptCount() const;
+    ScriptLoadStats LoadStats() const;
+    const char* Error() const;
+};
+
+} // namespace scripting
+} // namespace toybox
@@ -12,6 +12,8 @@
 
 #include <cstddef> // For size_t
 #include <cstdlib> // For malloc, free
+#include <new>     // For placement new
+#include <utility> // For std::forward
 
 namespace toybox
 {
@@ -86,7 +86,7 @@ private:
     // Hash function
     size_t Hash(const Key& key) const;
 
-    // Probing for collisions
+    // Linear probing: the slot after index
     size_t Probe(size_t index) const;
 
     // Key equality comparison
@@ -102,7 +102,8 @@ public:
     // Insert or update a key-value pair
     void Insert(const Key& key, const Value& value);
 
-    // Remove a key-value pair
+    // Remove a key-value pair, moving back the keys probed past it so they
+    // stay reachable
     void Remove(const Key& key);
 
     // Retrieve a value by key
@@ -52,16 +52,9 @@ bool HashMap<Key, Value>::KeysEqual(const Key& key1, const Key& key2) const {
 
 template<typename Key, typename Value>
 size_t HashMap<Key, Value>::Probe(size_t index) const {
-    size_t original_index = index;
-    do {
-        // Check if the current slot is empty or a valid slot to return
-        if (!table[index].occupied) {
-            return index;
-        }
-        index = (index + 1) % capacity;
-    } while (index != original_index); 
-
-    return capacity; // Use capacity as a sentinel value for failure
+    // The next slot, occupied or not: a key that collided lies somewhere
+    // along the run of occupied slots, so lookups have to walk all of it
+    return (index + 1) % capacity;
 }
 
 
@@ -97,7 +90,22 @@ void HashMap<Key, Value>::Remove(const Key& key) {
     size_t original_index = index;
     while (table[index].occupied) {
         if (KeysEqual(table[index].key, key)) {
-            table[index].occupied = false;
+            // Emptying the slot alone would cut the run short for the keys
+            // after it, so pull each back into the hole unless its home
+            // lies cyclically between the hole and where it sits
+            size_t hole = index;
+            size_t next = Probe(hole);
+            while (table[next].occupied) {
+                size_t home = Hash(table[next].key);
+                bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+                if (!stays) {
+                    table[hole].key = table[next].key;
+                    table[hole].value = table[next].value;
+                    hole = next;
+                }
+                next = Probe(next);
+            }
+            table[hole].occupied = false;
             --size;
             return;
         }
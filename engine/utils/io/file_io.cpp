@@ -0,0 +1,230 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <atomic>  // For std::atomic
+#include <cerrno>  // For errno, EEXIST
+#include <cstdio>  // For FILE, fopen, fread, fwrite, fclose, remove, rename, snprintf
+#include <cstring> // For memcpy, strlen
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h> // For CreateFileA, CreateFileMappingA, MapViewOfFile, MoveFileExA
+#else
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap, munmap
+#include <sys/stat.h> // For fstat, stat, mkdir
+#include <unistd.h>   // For close, getpid
+#endif
+
+#include "file_io.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace io
+{
+
+MappedFile::MappedFile()
+    : data(nullptr), size(0)
+#if defined(_WIN32)
+    , file(nullptr), mapping(nullptr)
+#endif
+{}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const char* path) {
+    Close();
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(handle, &length)) {
+        CloseHandle(handle);
+        return false;
+    }
+    file = handle;
+    size = static_cast<size_t>(length.QuadPart);
+    if (size == 0) return true;
+
+    mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!data) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    data = nullptr;
+    size = 0;
+    file = nullptr;
+    mapping = nullptr;
+}
+
+bool MappedFile::IsOpen() const {
+    return file != nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const char* path) {
+    Close();
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) return false;
+    struct stat info;
+    if (fstat(descriptor, &info) != 0) {
+        close(descriptor);
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+        // mmap refuses empty files; an empty mapping still counts as open
+        close(descriptor);
+        data = reinterpret_cast<const uint8_t*>(this);
+        return true;
+    }
+    void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    // The mapping keeps the file alive on its own
+    close(descriptor);
+    if (view == MAP_FAILED) {
+        size = 0;
+        return false;
+    }
+    data = static_cast<const uint8_t*>(view);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (data && size > 0) munmap(const_cast<uint8_t*>(data), size);
+    data = nullptr;
+    size = 0;
+}
+
+bool MappedFile::IsOpen() const {
+    return data != nullptr;
+}
+
+#endif
+
+const uint8_t* MappedFile::Data() const {
+    return size > 0 ? data : nullptr;
+}
+
+size_t MappedFile::Size() const {
+    return size;
+}
+
+bool ReadFile(const char* path, data_structures::DynamicArray<uint8_t>* out) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    out->Clear();
+    uint8_t buffer[64 * 1024];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        size_t at = out->Size();
+        out->Resize(at + read);
+        memcpy(out->Data() + at, buffer, read);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+static std::atomic<uint32_t> temporary_count{ 0 };
+
+bool WriteFileAtomic(const char* path, const void* data, size_t size) {
+#if defined(_WIN32)
+    unsigned process = unsigned(GetCurrentProcessId());
+#else
+    unsigned process = unsigned(getpid());
+#endif
+    char temporary[1024];
+    unsigned count = temporary_count.fetch_add(1, std::memory_order_relaxed);
+    if (snprintf(temporary, sizeof(temporary), "%s.%u.%u.tmp", path, process, count) >= int(sizeof(temporary))) {
+        return false;
+    }
+    FILE* file = fopen(temporary, "wb");
+    if (!file) return false;
+    bool ok = size == 0 || fwrite(data, 1, size, file) == size;
+    ok = fclose(file) == 0 && ok;
+#if defined(_WIN32)
+    ok = ok && MoveFileExA(temporary, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    ok = ok && rename(temporary, path) == 0;
+#endif
+    if (!ok) remove(temporary);
+    return ok;
+}
+
+#if defined(_WIN32)
+
+bool StatFile(const char* path, FileStat* out) {
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExA(path, GetFileExInfoStandard, &info)) return false;
+    if (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) return false;
+    out->size = (uint64_t(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    uint64_t ticks = (uint64_t(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+    out->modified_ns = int64_t(ticks) * 100;
+    return true;
+}
+
+static bool MakeDirectory(const char* path) {
+    return CreateDirectoryA(path, nullptr) != 0 || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+#else
+
+bool StatFile(const char* path, FileStat* out) {
+    struct stat info;
+    if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) return false;
+    out->size = uint64_t(info.st_size);
+#if defined(__APPLE__)
+    out->modified_ns = int64_t(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    out->modified_ns = int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+    return true;
+}
+
+static bool MakeDirectory(const char* path) {
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+#endif
+
+bool CreateDirectories(const char* path) {
+    char partial[1024];
+    size_t length = strlen(path);
+    if (length == 0 || length >= sizeof(partial)) return false;
+    memcpy(partial, path, length + 1);
+    // Each parent in turn, skipping a leading separator
+    for (size_t i = 1; i < length; ++i) {
+        if (partial[i] != '/' && partial[i] != '\\') continue;
+        partial[i] = 0;
+        bool made = MakeDirectory(partial);
+        partial[i] = path[i];
+        if (!made && !(i == 2 && partial[1] == ':')) return false;
+    }
+    return MakeDirectory(partial);
+}
+
+} // namespace io
+} // namespace utils
+} // namespace toybox
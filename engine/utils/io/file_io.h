@@ -0,0 +1,77 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+#include <cstdint> // For uint8_t, uint64_t, int64_t
+
+#include "dynamicarray.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace io
+{
+
+// A whole file mapped read-only into memory. Pages come off the disk as they
+// are first touched, so opening costs the same whatever the file's size, and
+// clean pages are shared between processes mapping the same file.
+struct MappedFile {
+private:
+    const uint8_t* data;
+    size_t size;
+#if defined(_WIN32)
+    void* file;
+    void* mapping;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Closes any file already open. An empty file opens with a null Data().
+    bool Open(const char* path);
+    void Close();
+
+    bool IsOpen() const;
+    const uint8_t* Data() const;
+    size_t Size() const;
+};
+
+// Reads a whole file into out, replacing its contents
+bool ReadFile(const char* path, data_structures::DynamicArray<uint8_t>* out);
+
+// Writes to a temporary file next to path and renames it over path, so a
+// reader never sees a half-written file. On POSIX systems anyone who still
+// has the old file mapped keeps seeing the old contents. Threads and
+// processes writing the same path at once each use their own temporary, and
+// one of them wins the rename.
+bool WriteFileAtomic(const char* path, const void* data, size_t size);
+
+// What can be learned about a file without opening it
+struct FileStat {
+    uint64_t size;
+    int64_t modified_ns; // Since an epoch of the platform's choosing
+};
+
+// Returns false if path does not exist or is not a regular file
+bool StatFile(const char* path, FileStat* out);
+
+// Creates path and any missing parents. Succeeds if it already exists.
+bool CreateDirectories(const char* path);
+
+} // namespace io
+} // namespace utils
+} // namespace toybox
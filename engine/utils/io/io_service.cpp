@@ -0,0 +1,653 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <chrono> // For std::chrono::steady_clock
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h> // For CreateFileA, ReadFile, CloseHandle
+#else
+#include <cerrno>     // For errno, EINTR
+#include <fcntl.h>    // For open
+#include <sys/uio.h>  // For preadv, iovec
+#include <unistd.h>   // For close, read, write
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define TOYBOX_IO_URING 1
+#include <linux/io_uring.h> // For io_uring_params, io_uring_sqe, io_uring_cqe
+#include <sys/eventfd.h>    // For eventfd
+#include <sys/mman.h>       // For mmap, munmap
+#include <sys/syscall.h>    // For __NR_io_uring_setup, __NR_io_uring_enter
+#else
+#define TOYBOX_IO_URING 0
+#endif
+
+#include "io_service.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace io
+{
+
+static const uint32_t kNoRequest = 0xFFFFFFFF;
+
+// How far into a queue to look for a range that continues the read being
+// built
+static const uint32_t kCoalesceWindow = 64;
+
+static uint64_t NowNs() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch())
+                        .count());
+}
+
+// Reads the batch's buffers in order from offset, stopping at the end of
+// the file. Returns the bytes read, or -1 on an error.
+static int64_t ReadRanges(int64_t file, uint64_t offset, uint8_t* const* buffers, const size_t* sizes,
+                          uint32_t count) {
+    int64_t total = 0;
+#if defined(_WIN32)
+    HANDLE handle = reinterpret_cast<HANDLE>(file);
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t done = 0;
+        while (done < sizes[i]) {
+            OVERLAPPED at = {};
+            uint64_t position = offset + uint64_t(total);
+            at.Offset = DWORD(position & 0xFFFFFFFF);
+            at.OffsetHigh = DWORD(position >> 32);
+            DWORD chunk = sizes[i] - done > 0x40000000 ? 0x40000000 : DWORD(sizes[i] - done);
+            DWORD read = 0;
+            if (!ReadFile(handle, buffers[i] + done, chunk, &read, &at)) {
+                if (GetLastError() == ERROR_HANDLE_EOF) return total;
+                return -1;
+            }
+            if (read == 0) return total;
+            done += read;
+            total += read;
+        }
+    }
+#else
+    struct iovec spans[kIoMaxCoalesced];
+    uint32_t first = 0;
+    for (uint32_t i = 0; i < count; ++i) spans[i] = iovec{ buffers[i], sizes[i] };
+    // preadv may stop short anywhere; carry on from where it did
+    while (first < count) {
+        ssize_t read = preadv(int(file), spans + first, int(count - first), off_t(offset + uint64_t(total)));
+        if (read < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (read == 0) return total;
+        total += read;
+        size_t left = size_t(read);
+        while (first < count && left >= spans[first].iov_len) left -= spans[first++].iov_len;
+        if (first < count) {
+            spans[first].iov_base = static_cast<uint8_t*>(spans[first].iov_base) + left;
+            spans[first].iov_len -= left;
+        }
+    }
+#endif
+    return total;
+}
+
+#if TOYBOX_IO_URING
+
+// The ring is driven through the raw system calls, so nothing beyond the
+// kernel headers is needed
+struct UringRing {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+
+struct IoService::UringState {
+    UringRing ring;
+    int wake;              // eventfd the main thread writes to; a read of it is always queued
+    uint64_t wake_value;
+    struct iovec wake_span;
+    utils::data_structures::DynamicArray<Batch> batches; // By slot, one per read in flight
+    utils::data_structures::DynamicArray<struct iovec> spans; // kIoMaxCoalesced per slot
+    utils::data_structures::DynamicArray<uint32_t> free_slots;
+    uint32_t in_flight;
+    std::thread thread;
+};
+
+static const uint64_t kWakeTag = ~uint64_t(0);
+
+#endif
+
+IoService::IoService()
+    : backend(IoBackend::Threads), running(false), first_free(kNoRequest), outstanding(0), budget_left(0),
+      budget_stalled(false), stats{}, threads(nullptr), thread_count(0), uring(nullptr) {
+    for (uint32_t& head : queue_heads) head = 0;
+}
+
+IoService::~IoService() {
+    Shutdown();
+    for (size_t i = 0; i < files.Size(); ++i) CloseFile(int32_t(i));
+}
+
+bool IoService::Init(const IoServiceConfig& new_config) {
+    Shutdown();
+    config = new_config;
+    if (config.max_requests == 0 || config.queue_depth == 0) return false;
+    requests.Resize(config.max_requests);
+    for (uint32_t i = 0; i < config.max_requests; ++i) {
+        Request& request = requests.Data()[i];
+        request.generation = 1;
+        request.state = RequestState::Free;
+        request.next_free = i + 1 < config.max_requests ? i + 1 : kNoRequest;
+    }
+    first_free = 0;
+    outstanding = 0;
+    budget_left = config.frame_byte_budget;
+    budget_stalled = false;
+    stats = IoServiceStats{};
+    running = true;
+
+    if (config.backend != IoBackend::Threads && StartUring()) {
+        backend = IoBackend::Uring;
+        return true;
+    }
+    if (config.backend == IoBackend::Uring) {
+        running = false;
+        return false;
+    }
+    backend = IoBackend::Threads;
+    thread_count = config.worker_threads > 0 ? config.worker_threads : 1;
+    threads = new std::thread[thread_count];
+    for (uint32_t i = 0; i < thread_count; ++i) threads[i] = std::thread([this]() { WorkerMain(); });
+    return true;
+}
+
+void IoService::Shutdown() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!running) return;
+        running = false;
+    }
+    work_ready.notify_all();
+    if (threads) {
+        for (uint32_t i = 0; i < thread_count; ++i) threads[i].join();
+        delete[] threads;
+        threads = nullptr;
+        thread_count = 0;
+    }
+    if (uring) StopUring();
+    for (Request& request : requests) {
+        if (request.state != RequestState::Free) ++request.generation;
+        request.state = RequestState::Free;
+    }
+    for (uint32_t p = 0; p < kIoPriorityCount; ++p) {
+        queues[p].Clear();
+        queue_heads[p] = 0;
+    }
+    finished.Clear();
+    outstanding = 0;
+}
+
+IoBackend IoService::Backend() const {
+    return backend;
+}
+
+int32_t IoService::OpenFile(const char* path) {
+#if defined(_WIN32)
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return -1;
+    int64_t native = reinterpret_cast<int64_t>(handle);
+#else
+    int descriptor = open(path, O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) return -1;
+    int64_t native = descriptor;
+#endif
+    for (size_t i = 0; i < files.Size(); ++i) {
+        if (files.Data()[i] < 0) {
+            files.Data()[i] = native;
+            return int32_t(i);
+        }
+    }
+    files.PushBack(native);
+    return int32_t(files.Size() - 1);
+}
+
+void IoService::CloseFile(int32_t file) {
+    if (file < 0 || size_t(file) >= files.Size() || files.Data()[file] < 0) return;
+#if defined(_WIN32)
+    CloseHandle(reinterpret_cast<HANDLE>(files.Data()[file]));
+#else
+    close(int(files.Data()[file]));
+#endif
+    files.Data()[file] = -1;
+}
+
+IoHandle IoService::Read(int32_t file, uint64_t offset, size_t size, uint8_t* buffer, IoPriority priority,
+                         void* user) {
+    if (file < 0 || size_t(file) >= files.Size() || files.Data()[file] < 0) return kNoIo;
+    IoHandle handle;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!running || first_free == kNoRequest) return kNoIo;
+        uint32_t index = first_free;
+        Request& request = requests.Data()[index];
+        first_free = request.next_free;
+        request.file = files.Data()[file];
+        request.offset = offset;
+        request.size = size;
+        request.buffer = buffer;
+        request.user = user;
+        request.submitted_ns = NowNs();
+        request.completed_ns = 0;
+        request.bytes = 0;
+        request.priority = priority;
+        request.state = RequestState::Queued;
+        request.status = IoStatus::Done;
+        request.cancel = false;
+        handle = IoHandle{ index, request.generation };
+        queues[uint32_t(priority)].PushBack(handle);
+        ++outstanding;
+        ++stats.requests;
+    }
+    Wake();
+    return handle;
+}
+
+bool IoService::Cancel(IoHandle handle) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (handle.index >= requests.Size()) return false;
+    Request& request = requests.Data()[handle.index];
+    if (request.generation != handle.generation) return false;
+    if (request.state == RequestState::InFlight) {
+        request.cancel = true;
+        return true;
+    }
+    if (request.state != RequestState::Queued) return false;
+    // Its queue entry is skipped when reached
+    request.state = RequestState::Finished;
+    request.status = IoStatus::Cancelled;
+    request.completed_ns = NowNs();
+    finished.PushBack(handle.index);
+    ++stats.cancelled;
+    return true;
+}
+
+uint32_t IoService::Update(utils::data_structures::DynamicArray<IoCompletion>* out) {
+    uint32_t delivered;
+    bool stalled;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        delivered = static_cast<uint32_t>(finished.Size());
+        for (uint32_t f = 0; f < delivered; ++f) {
+            uint32_t index = finished.Data()[f];
+            Request& request = requests.Data()[index];
+            out->PushBack(IoCompletion{ IoHandle{ index, request.generation }, request.status, request.bytes,
+                                        request.buffer, request.user, request.submitted_ns,
+                                        request.completed_ns });
+            ++request.generation;
+            request.state = RequestState::Free;
+            request.next_free = first_free;
+            first_free = index;
+        }
+        finished.Clear();
+        outstanding -= delivered;
+        budget_left = config.frame_byte_budget;
+        stalled = budget_stalled;
+        budget_stalled = false;
+    }
+    // Reads the budget held back may go now
+    if (stalled) Wake();
+    return delivered;
+}
+
+uint32_t IoService::Outstanding() {
+    std::lock_guard<std::mutex> guard(lock);
+    return outstanding;
+}
+
+IoServiceStats IoService::Stats() {
+    std::lock_guard<std::mutex> guard(lock);
+    return stats;
+}
+
+// Pops the most urgent queued request the budget allows, and after it any
+// queued requests of the same priority that carry on where it ends in the
+// same file. Called with the lock held.
+bool IoService::TakeBatch(Batch* batch) {
+    for (uint32_t p = 0; p < kIoPriorityCount; ++p) {
+        utils::data_structures::DynamicArray<IoHandle>& queue = queues[p];
+        uint32_t& head = queue_heads[p];
+        auto queued = [this](IoHandle entry) {
+            const Request& request = requests.Data()[entry.index];
+            return request.generation == entry.generation && request.state == RequestState::Queued;
+        };
+        while (head < queue.Size() && !queued(queue.Data()[head])) ++head;
+        if (head == queue.Size()) {
+            queue.Clear();
+            head = 0;
+            continue;
+        }
+
+        // Lower priorities wait too, or they would overtake
+        const bool critical = p == uint32_t(IoPriority::Critical);
+        const bool limited = config.frame_byte_budget > 0 && !critical;
+        Request& first = requests.Data()[queue.Data()[head].index];
+        bool fresh_frame = budget_left == config.frame_byte_budget;
+        if (limited && first.size > budget_left && !fresh_frame) {
+            if (!budget_stalled) ++stats.budget_stalls;
+            budget_stalled = true;
+            return false;
+        }
+
+        uint32_t index = queue.Data()[head++].index;
+        batch->file = first.file;
+        batch->offset = first.offset;
+        batch->count = 0;
+        uint64_t end = first.offset;
+        for (;;) {
+            Request& request = requests.Data()[index];
+            request.state = RequestState::InFlight;
+            batch->requests[batch->count++] = index;
+            end += request.size;
+            budget_left -= request.size < budget_left ? request.size : budget_left;
+
+            index = kNoRequest;
+            if (batch->count == kIoMaxCoalesced) break;
+            uint32_t window_end = head + kCoalesceWindow < queue.Size() ? head + kCoalesceWindow
+                                                                        : static_cast<uint32_t>(queue.Size());
+            for (uint32_t q = head; q < window_end; ++q) {
+                IoHandle entry = queue.Data()[q];
+                if (!queued(entry)) continue;
+                const Request& next = requests.Data()[entry.index];
+                if (next.file != batch->file || next.offset != end) continue;
+                if (limited && next.size > budget_left) continue;
+                index = entry.index;
+                break;
+            }
+            if (index == kNoRequest) break;
+            ++stats.coalesced;
+        }
+
+        // Drop what has been taken off the front now and then
+        if (head >= 1024 && head * 2 >= queue.Size()) {
+            size_t left = queue.Size() - head;
+            for (size_t i = 0; i < left; ++i) queue.Data()[i] = queue.Data()[head + i];
+            queue.Resize(left);
+            head = 0;
+        }
+        ++stats.reads_issued;
+        return true;
+    }
+    return false;
+}
+
+// Shares result out over the batch's requests in order. Called with the
+// lock held.
+void IoService::FinishBatch(const Batch& batch, int64_t result) {
+    uint64_t now = NowNs();
+    uint64_t left = result > 0 ? uint64_t(result) : 0;
+    for (uint32_t i = 0; i < batch.count; ++i) {
+        Request& request = requests.Data()[batch.requests[i]];
+        request.bytes = left < request.size ? size_t(left) : request.size;
+        left -= request.bytes;
+        request.completed_ns = now;
+        request.state = RequestState::Finished;
+        if (request.cancel) {
+            request.status = IoStatus::Cancelled;
+            ++stats.cancelled;
+        } else if (result < 0) {
+            request.status = IoStatus::Failed;
+            ++stats.failed;
+        } else {
+            request.status = IoStatus::Done;
+            ++stats.completed;
+        }
+        stats.bytes_read += request.bytes;
+        finished.PushBack(batch.requests[i]);
+    }
+}
+
+void IoService::Wake() {
+    if (backend == IoBackend::Threads) {
+        work_ready.notify_all();
+        return;
+    }
+#if TOYBOX_IO_URING
+    if (uring) {
+        uint64_t one = 1;
+        ssize_t written = write(uring->wake, &one, sizeof(one));
+        (void)written;
+    }
+#endif
+}
+
+void IoService::WorkerMain() {
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        Batch batch;
+        while (running && !TakeBatch(&batch)) work_ready.wait(guard);
+        if (!running) return;
+        uint8_t* buffers[kIoMaxCoalesced];
+        size_t sizes[kIoMaxCoalesced];
+        for (uint32_t i = 0; i < batch.count; ++i) {
+            buffers[i] = requests.Data()[batch.requests[i]].buffer;
+            sizes[i] = requests.Data()[batch.requests[i]].size;
+        }
+        guard.unlock();
+        int64_t result = ReadRanges(batch.file, batch.offset, buffers, sizes, batch.count);
+        guard.lock();
+        FinishBatch(batch, result);
+    }
+}
+
+#if TOYBOX_IO_URING
+
+static int UringEnter(int fd, unsigned submit, unsigned wait) {
+    return int(syscall(__NR_io_uring_enter, fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+}
+
+// Only ever called from the ring's own thread
+static void QueueReadv(UringRing* ring, int file, const struct iovec* spans, uint32_t count, uint64_t offset,
+                       uint64_t tag) {
+    unsigned tail = *ring->sq_tail;
+    unsigned slot = tail & *ring->sq_mask;
+    io_uring_sqe* sqe = &ring->sqes[slot];
+    *sqe = io_uring_sqe{};
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = file;
+    sqe->addr = uint64_t(reinterpret_cast<uintptr_t>(spans));
+    sqe->len = count;
+    sqe->off = offset;
+    sqe->user_data = tag;
+    ring->sq_array[slot] = slot;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void UnmapRing(UringRing* ring) {
+    if (ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    if (ring->sq_ring != MAP_FAILED) munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+static bool MapRing(UringRing* ring, uint32_t entries) {
+    io_uring_params params = {};
+    ring->fd = int(syscall(__NR_io_uring_setup, entries, &params));
+    if (ring->fd < 0) return false;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    ring->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    const int protection = PROT_READ | PROT_WRITE;
+    const int flags = MAP_SHARED | MAP_POPULATE;
+    ring->sq_ring = mmap(nullptr, ring->sq_ring_size, protection, flags, ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = single ? ring->sq_ring
+                           : mmap(nullptr, ring->cq_ring_size, protection, flags, ring->fd, IORING_OFF_CQ_RING);
+    void* sqes = mmap(nullptr, ring->sqes_size, protection, flags, ring->fd, IORING_OFF_SQES);
+    ring->sqes = static_cast<io_uring_sqe*>(sqes);
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+        UnmapRing(ring);
+        return false;
+    }
+    uint8_t* sq = static_cast<uint8_t*>(ring->sq_ring);
+    uint8_t* cq = static_cast<uint8_t*>(ring->cq_ring);
+    ring->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    ring->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    ring->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    ring->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    ring->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    ring->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    ring->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+bool IoService::StartUring() {
+    UringState* state = new UringState();
+    // The wake read takes one entry
+    if (!MapRing(&state->ring, config.queue_depth + 1)) {
+        delete state;
+        return false;
+    }
+    state->wake = eventfd(0, EFD_CLOEXEC);
+    if (state->wake < 0) {
+        UnmapRing(&state->ring);
+        delete state;
+        return false;
+    }
+    state->wake_span = iovec{ &state->wake_value, sizeof(state->wake_value) };
+    state->batches.Resize(config.queue_depth);
+    state->spans.Resize(size_t(config.queue_depth) * kIoMaxCoalesced);
+    for (uint32_t i = config.queue_depth; i-- > 0;) state->free_slots.PushBack(i);
+    state->in_flight = 0;
+    uring = state;
+    state->thread = std::thread([this]() { UringMain(); });
+    return true;
+}
+
+// Keeps up to queue_depth reads in the ring and sleeps in the kernel until
+// one finishes or the main thread writes to the wake eventfd
+void IoService::UringMain() {
+    UringState* state = uring;
+    UringRing* ring = &state->ring;
+    QueueReadv(ring, state->wake, &state->wake_span, 1, 0, kWakeTag);
+    unsigned to_submit = 1;
+    std::unique_lock<std::mutex> guard(lock);
+    for (;;) {
+        if (!running && state->in_flight == 0) return;
+        Batch batch;
+        while (running && !state->free_slots.Empty() && TakeBatch(&batch)) {
+            uint32_t slot = state->free_slots.Back();
+            state->free_slots.PopBack();
+            state->batches.Data()[slot] = batch;
+            struct iovec* spans = state->spans.Data() + size_t(slot) * kIoMaxCoalesced;
+            for (uint32_t i = 0; i < batch.count; ++i) {
+                const Request& request = requests.Data()[batch.requests[i]];
+                spans[i] = iovec{ request.buffer, request.size };
+            }
+            QueueReadv(ring, int(batch.file), spans, batch.count, batch.offset, slot);
+            ++state->in_flight;
+            ++to_submit;
+        }
+        guard.unlock();
+        int entered = UringEnter(ring->fd, to_submit, 1);
+        guard.lock();
+        // Entries the kernel did not take are offered again next time round
+        if (entered > 0) to_submit -= unsigned(entered) < to_submit ? unsigned(entered) : to_submit;
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = ring->cqes[head & *ring->cq_mask];
+            if (cqe.user_data == kWakeTag) {
+                if (running) {
+                    QueueReadv(ring, state->wake, &state->wake_span, 1, 0, kWakeTag);
+                    ++to_submit;
+                }
+                continue;
+            }
+            uint32_t slot = uint32_t(cqe.user_data);
+            const Batch& done = state->batches.Data()[slot];
+            const struct iovec* spans = state->spans.Data() + size_t(slot) * kIoMaxCoalesced;
+            int64_t result = cqe.res < 0 ? -1 : cqe.res;
+            size_t asked = 0;
+            for (uint32_t i = 0; i < done.count; ++i) asked += spans[i].iov_len;
+            // The kernel may stop short before the end of the file; finish
+            // such a read here
+            if (result > 0 && size_t(result) < asked) {
+                uint8_t* buffers[kIoMaxCoalesced];
+                size_t sizes[kIoMaxCoalesced];
+                uint32_t count = 0;
+                size_t skip = size_t(result);
+                for (uint32_t i = 0; i < done.count; ++i) {
+                    if (skip >= spans[i].iov_len) {
+                        skip -= spans[i].iov_len;
+                        continue;
+                    }
+                    buffers[count] = static_cast<uint8_t*>(spans[i].iov_base) + skip;
+                    sizes[count++] = spans[i].iov_len - skip;
+                    skip = 0;
+                }
+                guard.unlock();
+                int64_t rest = ReadRanges(done.file, done.offset + uint64_t(result), buffers, sizes, count);
+                guard.lock();
+                result = rest < 0 ? rest : result + rest;
+            }
+            FinishBatch(done, result);
+            state->free_slots.PushBack(slot);
+            --state->in_flight;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+
+void IoService::StopUring() {
+    Wake();
+    uring->thread.join();
+    // Closing the ring cancels the wake read still queued
+    UnmapRing(&uring->ring);
+    close(uring->wake);
+    delete uring;
+    uring = nullptr;
+}
+
+#else
+
+bool IoService::StartUring() {
+    return false;
+}
+
+void IoService::UringMain() {}
+
+void IoService::StopUring() {}
+
+#endif
+
+} // namespace io
+} // namespace utils
+} // namespace toybox
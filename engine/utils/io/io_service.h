@@ -0,0 +1,206 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <condition_variable> // For std::condition_variable
+#include <cstddef>            // For size_t
+#include <cstdint>            // For uint8_t, uint32_t, uint64_t
+#include <mutex>              // For std::mutex
+#include <thread>             // For std::thread
+
+#include "dynamicarray.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace io
+{
+
+// Queues are served strictly in this order
+enum class IoPriority : uint8_t {
+    Critical, // Needed this frame; issued even over the frame's budget
+    Visible,  // On screen or about to be
+    Prefetch, // Might be needed later
+};
+
+constexpr uint32_t kIoPriorityCount = 3;
+
+enum class IoBackend : uint8_t {
+    Auto,    // io_uring where the kernel allows it, threads otherwise
+    Uring,   // Linux only
+    Threads, // Blocking positional reads on worker threads
+};
+
+enum class IoStatus : uint8_t {
+    Done,      // bytes may be short of the size asked for at the end of a file
+    Failed,
+    Cancelled, // The buffer may have been partly written
+};
+
+// Reads of adjacent ranges of one file merge into one vectored read of at
+// most this many requests
+constexpr uint32_t kIoMaxCoalesced = 16;
+
+struct IoHandle {
+    uint32_t index;
+    uint32_t generation;
+};
+
+constexpr IoHandle kNoIo = { 0xFFFFFFFF, 0 };
+
+struct IoCompletion {
+    IoHandle handle;
+    IoStatus status;
+    size_t bytes;
+    uint8_t* buffer;
+    void* user;
+    uint64_t submitted_ns; // steady_clock, when Read was called
+    uint64_t completed_ns; // When the read finished, before Update delivered it
+};
+
+struct IoServiceConfig {
+    IoBackend backend = IoBackend::Auto;
+    uint32_t queue_depth = 32;       // Reads in flight on io_uring
+    uint32_t worker_threads = 4;     // Threads for the thread backend
+    uint64_t frame_byte_budget = 0;  // Bytes issued between two Updates, critical reads included; 0 for no limit
+    uint32_t max_requests = 4096;    // Queued, in flight or awaiting delivery
+};
+
+struct IoServiceStats {
+    uint64_t requests;
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t cancelled;
+    uint64_t bytes_read;
+    uint64_t reads_issued;     // Backend reads; coalesced requests share one
+    uint64_t coalesced;        // Requests that rode along with another's read
+    uint64_t budget_stalls;    // Times the budget held back a queued read
+};
+
+// Streams file ranges into caller buffers in the background. Reads are
+// queued by priority from the main thread, issued by the backend in
+// priority order as the frame's byte budget allows, and their completions
+// are handed back in one batch by Update, which the main thread calls once
+// a frame. Nothing the main thread calls waits on the disk.
+//
+// Read, Cancel, Update and the file functions belong to one thread. A
+// buffer must stay valid until its request's completion is delivered,
+// cancelled or not.
+struct IoService {
+private:
+    enum class RequestState : uint8_t {
+        Free,
+        Queued,
+        InFlight,
+        Finished, // Awaiting delivery
+    };
+
+    struct Request {
+        int64_t file;
+        uint64_t offset;
+        size_t size;
+        uint8_t* buffer;
+        void* user;
+        uint64_t submitted_ns;
+        uint64_t completed_ns;
+        size_t bytes;
+        uint32_t generation;
+        uint32_t next_free;
+        IoPriority priority;
+        RequestState state;
+        IoStatus status;
+        bool cancel;
+    };
+
+    // One backend read, covering one or more requests
+    struct Batch {
+        int64_t file;
+        uint64_t offset;
+        uint32_t count;
+        uint32_t requests[kIoMaxCoalesced];
+    };
+
+    struct UringState;
+
+    IoServiceConfig config;
+    IoBackend backend;
+    std::mutex lock;
+    std::condition_variable work_ready;
+    bool running;
+    utils::data_structures::DynamicArray<Request> requests;
+    uint32_t first_free;
+    uint32_t outstanding;
+    // Handles rather than indices, so an entry left by a cancel is told
+    // apart from a later request in the same slot
+    utils::data_structures::DynamicArray<IoHandle> queues[kIoPriorityCount];
+    uint32_t queue_heads[kIoPriorityCount];
+    utils::data_structures::DynamicArray<uint32_t> finished;
+    utils::data_structures::DynamicArray<int64_t> files; // Native handles, -1 once closed
+    uint64_t budget_left;
+    bool budget_stalled;
+    IoServiceStats stats;
+    std::thread* threads;
+    uint32_t thread_count;
+    UringState* uring;
+
+    bool TakeBatch(Batch* batch);
+    void FinishBatch(const Batch& batch, int64_t result);
+    void Wake();
+    void WorkerMain();
+    bool StartUring();
+    void UringMain();
+    void StopUring();
+
+public:
+    IoService();
+    ~IoService();
+
+    IoService(const IoService&) = delete;
+    IoService& operator=(const IoService&) = delete;
+
+    bool Init(const IoServiceConfig& config = IoServiceConfig());
+
+    // Waits for reads in flight and drops the rest undelivered
+    void Shutdown();
+
+    // The backend Init settled on
+    IoBackend Backend() const;
+
+    // Returns a file index for Read, or -1 if it cannot be opened
+    int32_t OpenFile(const char* path);
+
+    // No request for the file may be outstanding
+    void CloseFile(int32_t file);
+
+    // Queues a read of size bytes at offset into buffer. Returns kNoIo if
+    // config.max_requests are already outstanding.
+    IoHandle Read(int32_t file, uint64_t offset, size_t size, uint8_t* buffer, IoPriority priority,
+                  void* user = nullptr);
+
+    // A queued read is dropped; one already issued finishes but is reported
+    // Cancelled. Either way its completion is still delivered. Returns false
+    // if handle is stale or already finished.
+    bool Cancel(IoHandle handle);
+
+    // Appends the completions since the last call to out, frees their
+    // requests and starts a new frame's budget. Returns how many it added.
+    uint32_t Update(utils::data_structures::DynamicArray<IoCompletion>* out);
+
+    // Requests neither delivered nor dropped by Shutdown
+    uint32_t Outstanding();
+
+    IoServiceStats Stats();
+};
+
+} // namespace io
+} // namespace utils
+} // namespace toybox
@@ -0,0 +1,367 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <chrono>  // For std::chrono::milliseconds
+#include <cstdlib> // For abort
+#include <cstring> // For memcpy
+
+#include "job_system.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace jobs
+{
+
+// How many empty polls a worker makes before going to sleep
+static const uint32_t kIdleSpins = 64;
+
+static thread_local JobSystem* t_system = nullptr;
+static thread_local uint32_t t_thread_index = 0;
+
+static void LockContinuations(Job* job) {
+    while (job->continuation_lock.exchange(true, std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+static void UnlockContinuations(Job* job) {
+    job->continuation_lock.store(false, std::memory_order_release);
+}
+
+static uint32_t NextRandom(uint32_t* state) {
+    // xorshift32
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void ResetJob(Job* job) {
+    job->function = nullptr;
+    job->parent = nullptr;
+    job->unfinished.store(0, std::memory_order_relaxed);
+    job->dependencies.store(0, std::memory_order_relaxed);
+    job->generation.store(0, std::memory_order_relaxed);
+    job->continuation_lock.store(false, std::memory_order_relaxed);
+    job->finished.store(true, std::memory_order_relaxed);
+    job->continuation_count = 0;
+}
+
+JobSystem::JobSystem()
+    : threads(nullptr), workers(nullptr), worker_count(0), running(false),
+      queued(0), sleepers(0), external_queue(nullptr), external_head(0),
+      external_count(0), external_jobs(nullptr), external_next_job(0) {}
+
+JobSystem::~JobSystem() {
+    Shutdown();
+}
+
+bool JobSystem::Init(uint32_t worker_threads) {
+    if (threads) return false;
+
+    uint32_t thread_count = worker_threads + 1;
+    threads = new ThreadState[thread_count];
+    for (uint32_t i = 0; i < thread_count; ++i) {
+        ThreadState* state = &threads[i];
+        state->jobs = new Job[kJobsPerThread];
+        for (uint32_t j = 0; j < kJobsPerThread; ++j) {
+            ResetJob(&state->jobs[j]);
+        }
+        state->next_job = 0;
+        state->random = 0x9E3779B9u * (i + 1);
+    }
+
+    external_queue = new Job*[kJobsPerThread];
+    external_jobs = new Job[kJobsPerThread];
+    for (uint32_t j = 0; j < kJobsPerThread; ++j) {
+        ResetJob(&external_jobs[j]);
+    }
+    external_head = 0;
+    external_count = 0;
+    external_next_job = 0;
+
+    t_system = this;
+    t_thread_index = 0;
+
+    worker_count = worker_threads;
+    running.store(true, std::memory_order_release);
+    workers = new std::thread[worker_count];
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        workers[i] = std::thread(&JobSystem::WorkerMain, this, i + 1);
+    }
+    return true;
+}
+
+void JobSystem::Shutdown() {
+    if (!threads) return;
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        running.store(false, std::memory_order_release);
+    }
+    wake.notify_all();
+    for (uint32_t i = 0; i < worker_count; ++i) {
+        workers[i].join();
+    }
+    delete[] workers;
+    workers = nullptr;
+
+    for (uint32_t i = 0; i < worker_count + 1; ++i) {
+        delete[] threads[i].jobs;
+    }
+    delete[] threads;
+    threads = nullptr;
+
+    delete[] external_queue;
+    delete[] external_jobs;
+    external_queue = nullptr;
+    external_jobs = nullptr;
+
+    if (t_system == this) {
+        t_system = nullptr;
+    }
+    worker_count = 0;
+}
+
+uint32_t JobSystem::WorkerCount() const {
+    return worker_count;
+}
+
+uint32_t JobSystem::ThreadCount() const {
+    return worker_count + 1;
+}
+
+uint32_t JobSystem::CurrentThreadIndex() const {
+    return t_system == this ? t_thread_index : ThreadCount();
+}
+
+void JobSystem::WorkerMain(uint32_t index) {
+    t_system = this;
+    t_thread_index = index;
+
+    uint32_t idle = 0;
+    while (running.load(std::memory_order_acquire)) {
+        Job* job = Take(index);
+        if (job) {
+            Execute(job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < kIdleSpins) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Announce ourselves before checking for work so a concurrent Push
+        // either sees a sleeper or we see its job.
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(2), [this] {
+                return !running.load(std::memory_order_acquire) || queued.load(std::memory_order_seq_cst) > 0;
+            });
+        }
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+        idle = 0;
+    }
+
+    t_system = nullptr;
+}
+
+Job* JobSystem::Allocate() {
+    uint32_t index = CurrentThreadIndex();
+    Job* job;
+    if (index < ThreadCount()) {
+        ThreadState& state = threads[index];
+        job = &state.jobs[state.next_job++ & (kJobsPerThread - 1)];
+
+        // The ring wrapped onto a job that is still running; help until it is done
+        while (!job->finished.load(std::memory_order_acquire)) {
+            if (!RunPendingJob()) std::this_thread::yield();
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(external_mutex);
+        job = &external_jobs[external_next_job++ & (kJobsPerThread - 1)];
+        if (!job->finished.load(std::memory_order_acquire)) abort(); // Too many external jobs in flight
+    }
+
+    job->generation.fetch_add(1, std::memory_order_relaxed);
+    return job;
+}
+
+JobHandle JobSystem::Create(JobFunction fn, const void* data, size_t size, JobHandle parent) {
+    if (size > kJobPayloadBytes) abort();
+
+    Job* job = Allocate();
+    job->function = fn;
+    job->parent = nullptr;
+    job->finished.store(false, std::memory_order_relaxed);
+    job->continuation_count = 0;
+    job->dependencies.store(1, std::memory_order_relaxed);
+    if (size > 0) {
+        memcpy(job->payload, data, size);
+    }
+
+    if (parent.job && !IsFinished(parent)) {
+        parent.job->unfinished.fetch_add(1, std::memory_order_relaxed);
+        job->parent = parent.job;
+    }
+    job->unfinished.store(1, std::memory_order_release);
+    return HandleOf(job);
+}
+
+void JobSystem::AddDependency(JobHandle job, JobHandle prerequisite) {
+    if (!prerequisite.job) return;
+
+    job.job->dependencies.fetch_add(1, std::memory_order_relaxed);
+
+    Job* before = prerequisite.job;
+    LockContinuations(before);
+    bool pending = !before->finished.load(std::memory_order_relaxed) &&
+                   before->generation.load(std::memory_order_relaxed) == prerequisite.generation;
+    if (pending) {
+        if (before->continuation_count == kMaxJobContinuations) abort(); // Too many dependents on one job
+        before->continuations[before->continuation_count++] = job.job;
+    }
+    UnlockContinuations(before);
+
+    if (!pending) {
+        job.job->dependencies.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void JobSystem::Run(JobHandle job) {
+    if (job.job->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        Push(job.job);
+    }
+}
+
+void JobSystem::Push(Job* job) {
+    uint32_t index = CurrentThreadIndex();
+    bool queued_locally = index < ThreadCount() && threads[index].queue.Push(job);
+
+    if (!queued_locally) {
+        std::unique_lock<std::mutex> lock(external_mutex);
+        if (external_count == kJobsPerThread) {
+            // Everything is full; do the work right here
+            lock.unlock();
+            Execute(job);
+            return;
+        }
+        external_queue[(external_head + external_count++) & (kJobsPerThread - 1)] = job;
+    }
+
+    queued.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        wake.notify_one();
+    }
+}
+
+Job* JobSystem::Take(uint32_t index) {
+    Job* job = nullptr;
+    if (index < ThreadCount()) {
+        job = threads[index].queue.Pop();
+    }
+
+    if (!job && queued.load(std::memory_order_relaxed) > 0) {
+        // Steal, starting from a random victim so thieves spread out
+        uint32_t count = ThreadCount();
+        uint32_t start = index < count ? NextRandom(&threads[index].random) % count : 0;
+        for (uint32_t i = 0; i < count && !job; ++i) {
+            uint32_t victim = (start + i) % count;
+            if (victim != index) {
+                job = threads[victim].queue.Steal();
+            }
+        }
+
+        if (!job) {
+            std::lock_guard<std::mutex> lock(external_mutex);
+            if (external_count > 0) {
+                job = external_queue[external_head];
+                external_head = (external_head + 1) & (kJobsPerThread - 1);
+                --external_count;
+            }
+        }
+    }
+
+    if (job) {
+        queued.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+void JobSystem::Execute(Job* job) {
+    job->function(job, job->payload);
+    Finish(job);
+}
+
+void JobSystem::Finish(Job* job) {
+    Job* parent = job->parent;
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+    // Waiters see the job as done from here, but the slot is only handed back
+    // for reuse once its continuations have been collected.
+    Job* ready[kMaxJobContinuations];
+    LockContinuations(job);
+    uint32_t ready_count = job->continuation_count;
+    for (uint32_t i = 0; i < ready_count; ++i) {
+        ready[i] = job->continuations[i];
+    }
+    job->continuation_count = 0;
+    job->finished.store(true, std::memory_order_release);
+    UnlockContinuations(job);
+
+    for (uint32_t i = 0; i < ready_count; ++i) {
+        if (ready[i]->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            Push(ready[i]);
+        }
+    }
+    if (parent) {
+        Finish(parent);
+    }
+}
+
+void JobSystem::Wait(JobHandle job) {
+    while (!IsFinished(job)) {
+        if (!RunPendingJob()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::IsFinished(JobHandle job) const {
+    if (!job.job) return true;
+    return job.job->generation.load(std::memory_order_acquire) != job.generation ||
+           job.job->unfinished.load(std::memory_order_acquire) == 0;
+}
+
+bool JobSystem::RunPendingJob() {
+    Job* job = Take(CurrentThreadIndex());
+    if (!job) return false;
+    Execute(job);
+    return true;
+}
+
+JobHandle JobSystem::HandleOf(Job* job) {
+    JobHandle handle;
+    handle.job = job;
+    handle.generation = job->generation.load(std::memory_order_relaxed);
+    return handle;
+}
+
+} // namespace jobs
+} // namespace utils
+} // namespace toybox
@@ -0,0 +1,168 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <atomic>             // For std::atomic
+#include <condition_variable> // For std::condition_variable
+#include <cstddef>            // For size_t
+#include <cstdint>            // For uint32_t
+#include <cstring>            // For memcpy
+#include <mutex>              // For std::mutex
+#include <thread>             // For std::thread
+#include <type_traits>        // For std::is_trivially_copyable
+
+#include "work_stealing_deque.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace jobs
+{
+
+struct Job;
+
+typedef void (*JobFunction)(Job* job, void* payload);
+
+constexpr size_t kJobPayloadBytes = 64;
+constexpr uint32_t kMaxJobContinuations = 6;
+
+// Jobs come from a ring per thread and each thread has a deque of this size.
+// A thread may have at most this many jobs in flight at once.
+constexpr uint32_t kJobsPerThread = 4096;
+
+// A unit of work. Jobs are recycled, so they are referred to through a
+// JobHandle whose generation no longer matches once the slot is reused.
+struct alignas(64) Job {
+    JobFunction function;
+    Job* parent;
+    std::atomic<int32_t> unfinished;   // This job plus its unfinished children
+    std::atomic<int32_t> dependencies; // Unfinished prerequisites, plus one until Run
+    std::atomic<uint32_t> generation;
+    std::atomic<bool> continuation_lock;
+    std::atomic<bool> finished;        // Continuations released; the slot may be reused
+    uint32_t continuation_count;
+    Job* continuations[kMaxJobContinuations];
+    alignas(16) unsigned char payload[kJobPayloadBytes];
+};
+
+struct JobHandle {
+    Job* job;
+    uint32_t generation;
+};
+
+constexpr JobHandle kNoJob = { nullptr, 0 };
+
+// A work-stealing scheduler. Every worker owns a Chase-Lev deque; idle workers
+// steal from the others. The thread that calls Init counts as thread 0 and
+// takes part whenever it waits, so a system with no workers still runs every
+// job, on the waiting thread.
+struct JobSystem {
+private:
+    struct ThreadState {
+        WorkStealingDeque<Job, kJobsPerThread> queue;
+        Job* jobs;
+        uint32_t next_job;
+        uint32_t random;
+    };
+
+    ThreadState* threads;
+    std::thread* workers;
+    uint32_t worker_count;
+    std::atomic<bool> running;
+
+    // Sleeping workers are woken when work is queued
+    std::atomic<int32_t> queued;
+    std::atomic<uint32_t> sleepers;
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    // Threads outside the system queue through here
+    std::mutex external_mutex;
+    Job** external_queue;
+    uint32_t external_head;
+    uint32_t external_count;
+    Job* external_jobs;
+    uint32_t external_next_job;
+
+    void WorkerMain(uint32_t index);
+    Job* Allocate();
+    void Push(Job* job);
+    Job* Take(uint32_t index);
+    void Execute(Job* job);
+    void Finish(Job* job);
+
+public:
+    JobSystem();
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Start worker_threads workers; the calling thread becomes thread 0
+    bool Init(uint32_t worker_threads);
+
+    // Stop and join the workers. Outstanding jobs must have been waited on.
+    void Shutdown();
+
+    // Workers started by Init, not counting the main thread
+    uint32_t WorkerCount() const;
+
+    // Workers plus the main thread
+    uint32_t ThreadCount() const;
+
+    // Index of the calling thread inside this system, or ThreadCount() for
+    // threads that do not belong to it
+    uint32_t CurrentThreadIndex() const;
+
+    // Create a job that runs fn(job, payload) with a copy of data as payload.
+    // A job with a parent keeps the parent unfinished until it completes.
+    JobHandle Create(JobFunction fn, const void* data, size_t size, JobHandle parent = kNoJob);
+
+    // Create a job from a small trivially copyable callable, e.g. a lambda
+    // capturing by reference or a few values
+    template<typename Fn>
+    JobHandle Create(const Fn& fn, JobHandle parent = kNoJob);
+
+    // The job will not start before prerequisite has finished. Must be called
+    // before Run(job).
+    void AddDependency(JobHandle job, JobHandle prerequisite);
+
+    // Submit a job; it is queued once all its dependencies have finished
+    void Run(JobHandle job);
+
+    // Run other jobs on the calling thread until job has finished
+    void Wait(JobHandle job);
+
+    bool IsFinished(JobHandle job) const;
+
+    // Run one queued job on the calling thread if there is one. Lets the main
+    // thread help out between frame phases.
+    bool RunPendingJob();
+
+    static JobHandle HandleOf(Job* job);
+};
+
+template<typename Fn>
+void InvokeJobCallable(Job*, void* payload) {
+    (*static_cast<Fn*>(payload))();
+}
+
+template<typename Fn>
+JobHandle JobSystem::Create(const Fn& fn, JobHandle parent) {
+    static_assert(sizeof(Fn) <= kJobPayloadBytes, "Job callable does not fit in the payload");
+    static_assert(std::is_trivially_copyable<Fn>::value, "Job callables must be trivially copyable");
+    return Create(&InvokeJobCallable<Fn>, &fn, sizeof(Fn), parent);
+}
+
+} // namespace jobs
+} // namespace utils
+} // namespace toybox
@@ -0,0 +1,99 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+
+#include "dynamicarray.h"
+#include "job_system.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace jobs
+{
+
+// Chunks handed to each thread when the grain size is picked automatically.
+// More than one per thread leaves room for stealing to even out uneven work.
+constexpr size_t kChunksPerThread = 4;
+
+// Grain size that splits count items into a few chunks per thread
+inline size_t AutoGrainSize(const JobSystem* system, size_t count) {
+    size_t chunks = system->ThreadCount() * kChunksPerThread;
+    size_t grain = (count + chunks - 1) / chunks;
+    return grain > 0 ? grain : 1;
+}
+
+template<typename Fn>
+struct ParallelForRange {
+    JobSystem* system;
+    const Fn* fn;
+    size_t begin;
+    size_t end;
+    size_t grain;
+};
+
+// Splits its range in half, hands the upper half to a child job and keeps
+// going with the lower half until it is down to the grain size.
+template<typename Fn>
+void ParallelForJob(Job* job, void* payload) {
+    ParallelForRange<Fn> range = *static_cast<ParallelForRange<Fn>*>(payload);
+    JobHandle self = JobSystem::HandleOf(job);
+
+    while (range.end - range.begin > range.grain) {
+        size_t middle = range.begin + (range.end - range.begin) / 2;
+        ParallelForRange<Fn> upper = range;
+        upper.begin = middle;
+        range.end = middle;
+        range.system->Run(range.system->Create(&ParallelForJob<Fn>, &upper, sizeof(upper), self));
+    }
+    (*range.fn)(range.begin, range.end);
+}
+
+// Calls fn(chunk_begin, chunk_end) over [begin, end) in chunks of at most
+// grain indices and returns once every chunk is done. The calling thread runs
+// chunks too while it waits.
+template<typename Fn>
+void ParallelFor(JobSystem* system, size_t begin, size_t end, size_t grain, const Fn& fn) {
+    if (end <= begin) return;
+    if (grain == 0) grain = AutoGrainSize(system, end - begin);
+
+    if (end - begin <= grain) {
+        fn(begin, end);
+        return;
+    }
+
+    ParallelForRange<Fn> range = { system, &fn, begin, end, grain };
+    JobHandle root = system->Create(&ParallelForJob<Fn>, &range, sizeof(range));
+    system->Run(root);
+    system->Wait(root);
+}
+
+template<typename Fn>
+void ParallelFor(JobSystem* system, size_t begin, size_t end, const Fn& fn) {
+    ParallelFor(system, begin, end, 0, fn);
+}
+
+// Calls fn(element, index) for every element of the array
+template<typename T, typename Fn>
+void ParallelFor(JobSystem* system, data_structures::DynamicArray<T>& array, const Fn& fn) {
+    T* data = array.Data();
+    ParallelFor(system, 0, array.Size(), 0, [data, &fn](size_t chunk_begin, size_t chunk_end) {
+        for (size_t i = chunk_begin; i < chunk_end; ++i) {
+            fn(data[i], i);
+        }
+    });
+}
+
+} // namespace jobs
+} // namespace utils
+} // namespace toybox
@@ -0,0 +1,105 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <atomic>  // For std::atomic, std::atomic_thread_fence
+#include <cstdint> // For int64_t
+
+namespace toybox
+{
+namespace utils
+{
+namespace jobs
+{
+
+// Fixed-capacity Chase-Lev deque, following the C11 formulation from
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al.).
+// The owning thread pushes and pops at the bottom; any thread may steal from
+// the top.
+template<typename T, int64_t Capacity>
+struct WorkStealingDeque {
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static constexpr int64_t kMask = Capacity - 1;
+
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    alignas(64) std::atomic<T*> buffer[Capacity];
+
+public:
+    WorkStealingDeque() : top(0), bottom(0) {
+        for (int64_t i = 0; i < Capacity; ++i) {
+            buffer[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    // Owner only. Returns false if the deque is full.
+    bool Push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= Capacity) return false;
+
+        // Release on the slot as well as the fence keeps thread sanitizers,
+        // which do not model fences, from flagging the handoff
+        buffer[b & kMask].store(item, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Owner only. Returns nullptr if empty or if a thief won the last item.
+    T* Pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = buffer[b & kMask].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last item: race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread. Returns nullptr if empty or if the race was lost.
+    T* Steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) return nullptr;
+
+        T* item = buffer[t & kMask].load(std::memory_order_acquire);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // Approximate; only meaningful as a hint
+    int64_t Size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+};
+
+} // namespace jobs
+} // namespace utils
+} // namespace toybox
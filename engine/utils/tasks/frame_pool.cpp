@@ -0,0 +1,122 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <atomic>  // For std::atomic
+#include <cstdlib> // For malloc, free, abort
+#include <thread>  // For std::this_thread::yield
+
+#include "frame_pool.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace tasks
+{
+
+struct FreeFrame {
+    FreeFrame* next;
+};
+
+struct FrameClass {
+    std::atomic<bool> lock;
+    FreeFrame* free_list;
+};
+
+static constexpr size_t ClassCount() {
+    size_t count = 0;
+    for (size_t bytes = kTaskFrameMinBytes; bytes <= kTaskFrameMaxBytes; bytes *= 2) {
+        ++count;
+    }
+    return count;
+}
+
+static FrameClass s_classes[ClassCount()];
+static std::atomic<size_t> s_frames_in_use(0);
+static std::atomic<size_t> s_slab_allocations(0);
+static std::atomic<size_t> s_oversize_allocations(0);
+
+static size_t ClassOf(size_t size) {
+    size_t index = 0;
+    size_t bytes = kTaskFrameMinBytes;
+    while (bytes < size) {
+        bytes *= 2;
+        ++index;
+    }
+    return index;
+}
+
+static void Lock(FrameClass* frame_class) {
+    while (frame_class->lock.exchange(true, std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+static void Unlock(FrameClass* frame_class) {
+    frame_class->lock.store(false, std::memory_order_release);
+}
+
+void* AllocateTaskFrame(size_t size) {
+    s_frames_in_use.fetch_add(1, std::memory_order_relaxed);
+    if (size > kTaskFrameMaxBytes) {
+        s_oversize_allocations.fetch_add(1, std::memory_order_relaxed);
+        void* frame = malloc(size);
+        if (!frame) abort();
+        return frame;
+    }
+
+    size_t index = ClassOf(size);
+    FrameClass* frame_class = &s_classes[index];
+    Lock(frame_class);
+    if (!frame_class->free_list) {
+        // Slabs are never returned; the pool only grows to the peak task count
+        size_t block = kTaskFrameMinBytes << index;
+        unsigned char* slab = static_cast<unsigned char*>(malloc(block * kTaskFramesPerSlab));
+        if (!slab) abort();
+        s_slab_allocations.fetch_add(1, std::memory_order_relaxed);
+        for (size_t i = kTaskFramesPerSlab; i-- > 0;) {
+            FreeFrame* frame = reinterpret_cast<FreeFrame*>(slab + i * block);
+            frame->next = frame_class->free_list;
+            frame_class->free_list = frame;
+        }
+    }
+    FreeFrame* frame = frame_class->free_list;
+    frame_class->free_list = frame->next;
+    Unlock(frame_class);
+    return frame;
+}
+
+void FreeTaskFrame(void* frame, size_t size) {
+    if (!frame) return;
+    s_frames_in_use.fetch_sub(1, std::memory_order_relaxed);
+    if (size > kTaskFrameMaxBytes) {
+        free(frame);
+        return;
+    }
+
+    FrameClass* frame_class = &s_classes[ClassOf(size)];
+    FreeFrame* node = static_cast<FreeFrame*>(frame);
+    Lock(frame_class);
+    node->next = frame_class->free_list;
+    frame_class->free_list = node;
+    Unlock(frame_class);
+}
+
+TaskFramePoolStats GetTaskFramePoolStats() {
+    TaskFramePoolStats stats;
+    stats.frames_in_use = s_frames_in_use.load(std::memory_order_relaxed);
+    stats.slab_allocations = s_slab_allocations.load(std::memory_order_relaxed);
+    stats.oversize_allocations = s_oversize_allocations.load(std::memory_order_relaxed);
+    return stats;
+}
+
+} // namespace tasks
+} // namespace utils
+} // namespace toybox
@@ -0,0 +1,44 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <cstddef> // For size_t
+
+namespace toybox
+{
+namespace utils
+{
+namespace tasks
+{
+
+// Coroutine frames are rounded up to a power of two between these sizes and
+// recycled through a free list per size. Larger frames go to the heap.
+constexpr size_t kTaskFrameMinBytes = 128;
+constexpr size_t kTaskFrameMaxBytes = 4096;
+
+// Frames are carved out of slabs of this many blocks
+constexpr size_t kTaskFramesPerSlab = 64;
+
+struct TaskFramePoolStats {
+    size_t frames_in_use;
+    size_t slab_allocations;     // Heap allocations made to grow the pool
+    size_t oversize_allocations; // Frames too large for the pool
+};
+
+// Thread safe; frames may be freed on a different thread than they came from
+void* AllocateTaskFrame(size_t size);
+void FreeTaskFrame(void* frame, size_t size);
+
+TaskFramePoolStats GetTaskFramePoolStats();
+
+} // namespace tasks
+} // namespace utils
+} // namespace toybox
@@ -0,0 +1,177 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <coroutine>   // For std::coroutine_handle, std::suspend_always
+#include <cstddef>     // For size_t
+#include <cstdlib>     // For abort
+#include <optional>    // For std::optional
+#include <type_traits> // For std::is_void
+#include <utility>     // For std::move, std::forward, std::exchange
+
+#include "frame_pool.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace tasks
+{
+
+template<typename T>
+struct Task;
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation;
+    bool detached = false;
+
+    // Frames come from the task frame pool rather than the heap
+    static void* operator new(size_t size) {
+        return AllocateTaskFrame(size);
+    }
+
+    static void operator delete(void* frame, size_t size) {
+        FreeTaskFrame(frame, size);
+    }
+
+    // Resumes whoever awaited the task, or frees a detached task's frame
+    struct FinalAwaiter {
+        bool await_ready() noexcept {
+            return false;
+        }
+
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            TaskPromiseBase& promise = handle.promise();
+            if (promise.continuation) return promise.continuation;
+            if (promise.detached) handle.destroy();
+            return std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    // Tasks are lazy: nothing runs until the task is awaited or spawned
+    std::suspend_always initial_suspend() noexcept {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() noexcept {
+        return {};
+    }
+
+    void unhandled_exception() {
+        abort();
+    }
+};
+
+template<typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+
+    template<typename U>
+    void return_value(U&& result) {
+        value.emplace(std::forward<U>(result));
+    }
+};
+
+template<>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+
+    void return_void() {}
+};
+
+// A lazily started coroutine producing a T. Awaiting a task starts it and
+// resumes the awaiter, on whichever thread the task finished on, once it
+// completes. A Task owns its frame; TaskScheduler::Spawn takes ownership for
+// tasks nobody awaits.
+template<typename T = void>
+struct Task {
+    typedef TaskPromise<T> promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+
+private:
+    Handle handle;
+
+public:
+    struct Awaiter {
+        Handle handle;
+
+        bool await_ready() const noexcept {
+            return !handle || handle.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+            handle.promise().continuation = awaiter;
+            return handle;
+        }
+
+        T await_resume() {
+            if constexpr (!std::is_void<T>::value) {
+                return std::move(*handle.promise().value);
+            }
+        }
+    };
+
+    Task() : handle(nullptr) {}
+
+    explicit Task(Handle coroutine) : handle(coroutine) {}
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    bool Valid() const {
+        return static_cast<bool>(handle);
+    }
+
+    bool Done() const {
+        return handle && handle.done();
+    }
+
+    // Give up ownership of the frame
+    Handle Release() {
+        return std::exchange(handle, nullptr);
+    }
+
+    Awaiter operator co_await() const noexcept {
+        return Awaiter{ handle };
+    }
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+} // namespace tasks
+} // namespace utils
+} // namespace toybox
@@ -0,0 +1,148 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#include <cstdio> // For fopen, fread, fseek, ftell, fclose
+
+#include "task_scheduler.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace tasks
+{
+
+static bool ReadWholeFile(const char* path, FileData* out) {
+    out->bytes.Clear();
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+
+    bool ok = fseek(file, 0, SEEK_END) == 0;
+    long length = ok ? ftell(file) : -1;
+    ok = length >= 0 && fseek(file, 0, SEEK_SET) == 0;
+    if (ok) {
+        out->bytes.Resize(static_cast<size_t>(length));
+        ok = fread(out->bytes.Data(), 1, static_cast<size_t>(length), file) == static_cast<size_t>(length);
+    }
+    fclose(file);
+    return ok;
+}
+
+// The scheduler and phase RunPhase is resuming on this thread, if any
+static thread_local const TaskScheduler* t_running_scheduler = nullptr;
+static thread_local FramePhase t_running_phase = FramePhase::Count;
+
+TaskScheduler::TaskScheduler(jobs::JobSystem* jobs)
+    : job_system(jobs), now(0.0), active_tasks(0) {}
+
+Task<void> TaskScheduler::RunSpawned(TaskScheduler* scheduler, Task<void> task) {
+    co_await task;
+    scheduler->active_tasks.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void TaskScheduler::Spawn(Task<void> task) {
+    if (!task.Valid()) return;
+
+    active_tasks.fetch_add(1, std::memory_order_relaxed);
+    Task<void>::Handle handle = RunSpawned(this, std::move(task)).Release();
+    handle.promise().detached = true;
+    handle.resume();
+}
+
+uint32_t TaskScheduler::ActiveTasks() const {
+    return active_tasks.load(std::memory_order_acquire);
+}
+
+void TaskScheduler::AdvanceTime(double seconds) {
+    std::lock_guard<std::mutex> lock(main_mutex);
+    now += seconds;
+
+    size_t i = 0;
+    while (i < timers.Size()) {
+        Timer& timer = timers.Data()[i];
+        if (timer.deadline > now) {
+            ++i;
+            continue;
+        }
+        phase_queues[static_cast<uint32_t>(timer.phase)].PushBack(timer.handle);
+        timer = timers.Back();
+        timers.PopBack();
+    }
+}
+
+double TaskScheduler::Now() {
+    std::lock_guard<std::mutex> lock(main_mutex);
+    return now;
+}
+
+void TaskScheduler::RunPhase(FramePhase phase) {
+    {
+        std::lock_guard<std::mutex> lock(main_mutex);
+        resuming.Swap(phase_queues[static_cast<uint32_t>(phase)]);
+    }
+
+    const TaskScheduler* outer_scheduler = t_running_scheduler;
+    FramePhase outer_phase = t_running_phase;
+    t_running_scheduler = this;
+    t_running_phase = phase;
+    for (size_t i = 0; i < resuming.Size(); ++i) {
+        resuming.Data()[i].resume();
+    }
+    resuming.Clear();
+    t_running_scheduler = outer_scheduler;
+    t_running_phase = outer_phase;
+}
+
+bool TaskScheduler::RunningPhase(FramePhase phase) const {
+    return t_running_scheduler == this && t_running_phase == phase;
+}
+
+TaskScheduler::WorkerAwaiter TaskScheduler::OnWorker() {
+    return WorkerAwaiter{ this };
+}
+
+TaskScheduler::PhaseAwaiter TaskScheduler::OnMainThread(FramePhase phase) {
+    return PhaseAwaiter{ this, phase };
+}
+
+TaskScheduler::DelayAwaiter TaskScheduler::Delay(double seconds, FramePhase phase) {
+    return DelayAwaiter{ this, seconds, phase };
+}
+
+TaskScheduler::ReadFileAwaiter TaskScheduler::ReadFile(const char* path) {
+    return ReadFileAwaiter{ this, path, nullptr, FileData{ {}, false } };
+}
+
+void TaskScheduler::ResumeOnWorker(std::coroutine_handle<> handle) {
+    job_system->Run(job_system->Create([handle]() { handle.resume(); }));
+}
+
+void TaskScheduler::ResumeAtPhase(std::coroutine_handle<> handle, FramePhase phase) {
+    std::lock_guard<std::mutex> lock(main_mutex);
+    phase_queues[static_cast<uint32_t>(phase)].PushBack(handle);
+}
+
+void TaskScheduler::ResumeAfter(std::coroutine_handle<> handle, double seconds, FramePhase phase) {
+    std::lock_guard<std::mutex> lock(main_mutex);
+    timers.PushBack(Timer{ now + seconds, phase, handle });
+}
+
+void TaskScheduler::ReadFileAwaiter::await_suspend(std::coroutine_handle<> awaiter) {
+    handle = awaiter;
+    ReadFileAwaiter* self = this;
+    scheduler->job_system->Run(scheduler->job_system->Create([self]() {
+        self->result.ok = ReadWholeFile(self->path, &self->result);
+        self->handle.resume();
+    }));
+}
+
+} // namespace tasks
+} // namespace utils
+} // namespace toybox
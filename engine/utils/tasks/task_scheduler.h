@@ -0,0 +1,194 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+#pragma once
+
+#include <atomic>    // For std::atomic
+#include <coroutine> // For std::coroutine_handle
+#include <cstdint>   // For uint32_t
+#include <mutex>     // For std::mutex
+
+#include "dynamicarray.h"
+#include "job_system.h"
+#include "task.h"
+
+namespace toybox
+{
+namespace utils
+{
+namespace tasks
+{
+
+// Points in the frame at which the main thread resumes waiting tasks
+enum class FramePhase : uint32_t {
+    BeginFrame,
+    Update,
+    LateUpdate,
+    EndFrame,
+    Count
+};
+
+struct FileData {
+    data_structures::DynamicArray<unsigned char> bytes;
+    bool ok;
+};
+
+// Decides where suspended tasks continue: on a job system worker, or on the
+// main thread when it reaches a frame phase. The main thread drives it once
+// per frame:
+//
+//     scheduler.AdvanceTime(delta_seconds);
+//     scheduler.RunPhase(FramePhase::BeginFrame);
+//     ...
+//     scheduler.RunPhase(FramePhase::EndFrame);
+//
+// With a job system that has no workers, worker continuations only run while
+// the main thread is inside JobSystem::Wait or RunPendingJob. Tasks still
+// suspended when the scheduler goes away are never resumed.
+struct TaskScheduler {
+private:
+    struct Timer {
+        double deadline;
+        FramePhase phase;
+        std::coroutine_handle<> handle;
+    };
+
+    jobs::JobSystem* job_system;
+
+    // Pushed to from any thread, drained by RunPhase on the main thread
+    std::mutex main_mutex;
+    data_structures::DynamicArray<std::coroutine_handle<>> phase_queues[static_cast<uint32_t>(FramePhase::Count)];
+    data_structures::DynamicArray<Timer> timers;
+    double now;
+
+    data_structures::DynamicArray<std::coroutine_handle<>> resuming;
+    std::atomic<uint32_t> active_tasks;
+
+    static Task<void> RunSpawned(TaskScheduler* scheduler, Task<void> task);
+
+    // Whether the calling thread is inside RunPhase(phase) on this scheduler
+    bool RunningPhase(FramePhase phase) const;
+
+public:
+    struct WorkerAwaiter {
+        TaskScheduler* scheduler;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            scheduler->ResumeOnWorker(handle);
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct PhaseAwaiter {
+        TaskScheduler* scheduler;
+        FramePhase phase;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            scheduler->ResumeAtPhase(handle, phase);
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct DelayAwaiter {
+        TaskScheduler* scheduler;
+        double seconds;
+        FramePhase phase;
+
+        // No delay only skips the suspension when this thread is already
+        // resuming that phase; anywhere else the task still has to get there
+        bool await_ready() const noexcept {
+            return seconds <= 0.0 && scheduler->RunningPhase(phase);
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            if (seconds <= 0.0) {
+                scheduler->ResumeAtPhase(handle, phase);
+            } else {
+                scheduler->ResumeAfter(handle, seconds, phase);
+            }
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    struct ReadFileAwaiter {
+        TaskScheduler* scheduler;
+        const char* path;
+        std::coroutine_handle<> handle;
+        FileData result;
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiter);
+
+        FileData await_resume() {
+            return std::move(result);
+        }
+    };
+
+    explicit TaskScheduler(jobs::JobSystem* jobs);
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Start a task on the calling thread and let it run to its first
+    // suspension. The scheduler owns the frame from here on.
+    void Spawn(Task<void> task);
+
+    // Spawned tasks that have not finished yet
+    uint32_t ActiveTasks() const;
+
+    // Advance the scheduler clock and queue timers that have come due.
+    // Main thread, once per frame before the first RunPhase.
+    void AdvanceTime(double seconds);
+
+    double Now();
+
+    // Resume everything queued for this phase. Tasks that queue themselves for
+    // the same phase again are resumed next frame. Main thread only.
+    void RunPhase(FramePhase phase);
+
+    // co_await scheduler.OnWorker() continues on a job system thread
+    WorkerAwaiter OnWorker();
+
+    // co_await scheduler.OnMainThread(phase) continues on the main thread the
+    // next time it runs that phase
+    PhaseAwaiter OnMainThread(FramePhase phase);
+
+    // co_await scheduler.Delay(seconds) continues on the main thread at the
+    // given phase once the scheduler clock has advanced by seconds. With no
+    // delay it continues at once if already running that phase, and
+    // otherwise the next time the main thread runs it.
+    DelayAwaiter Delay(double seconds, FramePhase phase = FramePhase::Update);
+
+    // co_await scheduler.ReadFile(path) reads the whole file on a worker and
+    // continues there with the contents. path must stay valid until then.
+    ReadFileAwaiter ReadFile(const char* path);
+
+    void ResumeOnWorker(std::coroutine_handle<> handle);
+    void ResumeAtPhase(std::coroutine_handle<> handle, FramePhase phase);
+    void ResumeAfter(std::coroutine_handle<> handle, double seconds, FramePhase phase);
+};
+
+} // namespace tasks
+} // namespace utils
+} // namespace toybox
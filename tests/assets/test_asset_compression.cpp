@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include "asset_compression.h"
+#include "asset_pack.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace toybox::assets;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+// Text-like data with plenty of repeats at all distances
+static std::vector<uint8_t> Text(size_t size, uint32_t seed) {
+    static const char* words[] = { "mesh",   "texture", "vertex", "index", "normal", "material", "shader",
+                                   "sampler", "albedo", "light",  "shadow", "bone",   "anim",     "=", " ",
+                                   "\n",     "{",       "}",      "0.5",   "1.0",    "-2.25" };
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> bytes;
+    while (bytes.size() < size) {
+        const char* word = words[rng() % (sizeof(words) / sizeof(words[0]))];
+        bytes.insert(bytes.end(), word, word + strlen(word));
+    }
+    bytes.resize(size);
+    return bytes;
+}
+
+static std::vector<uint8_t> Noise(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& byte : bytes) byte = uint8_t(rng());
+    return bytes;
+}
+
+static void ExpectRoundTrip(const std::vector<uint8_t>& bytes, AssetCompression level) {
+    std::vector<uint8_t> compressed(CompressBlockBound(bytes.size()));
+    size_t size = CompressBlock(bytes.data(), bytes.size(), compressed.data(), compressed.size(), level);
+    if (size == 0) return; // Not worth compressing; stored as it is
+    EXPECT_LT(size, bytes.size());
+    // Exactly sized, so the sanitizers see any write past the end
+    std::vector<uint8_t> decoded(bytes.size());
+    ASSERT_TRUE(DecompressBlock(compressed.data(), size, decoded.data(), decoded.size()));
+    EXPECT_TRUE(decoded == bytes);
+}
+
+TEST(AssetCompressionTests, BlocksRoundTrip) {
+    std::vector<std::vector<uint8_t>> inputs;
+    inputs.push_back({});
+    inputs.push_back({ 7 });
+    inputs.push_back(Text(13, 1));
+    inputs.push_back(Text(100, 2));
+    inputs.push_back(Text(256 * 1024, 3));
+    inputs.push_back(Noise(70000, 4));
+    // Runs with every short period, which overlap their own output
+    for (size_t period = 1; period <= 20; ++period) {
+        std::vector<uint8_t> run(5000 + period);
+        for (size_t i = 0; i < run.size(); ++i) run[i] = uint8_t(i % period * 37);
+        inputs.push_back(run);
+    }
+    // Long literal runs and long matches, far apart
+    std::vector<uint8_t> mixed = Noise(100000, 5);
+    std::vector<uint8_t> text = Text(60000, 6);
+    mixed.insert(mixed.end(), text.begin(), text.end());
+    mixed.insert(mixed.end(), text.begin(), text.end());
+    inputs.push_back(mixed);
+
+    for (const std::vector<uint8_t>& input : inputs) {
+        ExpectRoundTrip(input, AssetCompression::Fast);
+        ExpectRoundTrip(input, AssetCompression::High);
+    }
+
+    std::vector<uint8_t> noise = Noise(4096, 7);
+    std::vector<uint8_t> out(CompressBlockBound(noise.size()));
+    EXPECT_EQ(CompressBlock(noise.data(), noise.size(), out.data(), out.size(), AssetCompression::Fast), 0u);
+    EXPECT_EQ(CompressBlock(noise.data(), noise.size(), out.data(), 10, AssetCompression::Fast), 0u);
+}
+
+TEST(AssetCompressionTests, HighModeCompressesFurther) {
+    std::vector<uint8_t> text = Text(200000, 8);
+    std::vector<uint8_t> out(CompressBlockBound(text.size()));
+    size_t fast = CompressBlock(text.data(), text.size(), out.data(), out.size(), AssetCompression::Fast);
+    size_t high = CompressBlock(text.data(), text.size(), out.data(), out.size(), AssetCompression::High);
+    ASSERT_GT(fast, 0u);
+    ASSERT_GT(high, 0u);
+    EXPECT_LT(high, fast);
+    EXPECT_LT(fast, text.size() / 2);
+}
+
+TEST(AssetCompressionTests, DamagedBlocksFailWithoutOverrunning) {
+    std::vector<uint8_t> text = Text(30000, 9);
+    std::vector<uint8_t> compressed(CompressBlockBound(text.size()));
+    size_t size = CompressBlock(text.data(), text.size(), compressed.data(), compressed.size(),
+                                AssetCompression::High);
+    ASSERT_GT(size, 0u);
+    compressed.resize(size);
+    std::vector<uint8_t> decoded(text.size());
+
+    EXPECT_FALSE(DecompressBlock(compressed.data(), size - 1, decoded.data(), decoded.size()));
+    EXPECT_FALSE(DecompressBlock(compressed.data(), size, decoded.data(), decoded.size() - 1));
+    EXPECT_FALSE(DecompressBlock(compressed.data(), 0, decoded.data(), decoded.size()));
+    // Whatever the damage, the decoder stays inside its buffers
+    std::mt19937 rng(10);
+    for (int trial = 0; trial < 2000; ++trial) {
+        std::vector<uint8_t> damaged = compressed;
+        for (int flips = 0; flips < 1 + trial % 4; ++flips) damaged[rng() % damaged.size()] ^= uint8_t(1 + rng() % 255);
+        std::vector<uint8_t> out(text.size());
+        DecompressBlock(damaged.data(), damaged.size(), out.data(), out.size());
+    }
+}
+
+TEST(AssetCompressionTests, BlockedAssetsDecodeWholeInRangesAndInParallel) {
+    std::vector<uint8_t> bytes = Text(1000000, 11);
+    // An incompressible stretch makes a stored block
+    std::vector<uint8_t> noise = Noise(70000, 12);
+    memcpy(bytes.data() + 300000, noise.data(), noise.size());
+
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(3));
+    for (AssetCompression level : { AssetCompression::Fast, AssetCompression::High }) {
+        DynamicArray<uint8_t> packed;
+        CompressAsset(bytes.data(), bytes.size(), level, &packed, 64 * 1024, &jobs);
+        DynamicArray<uint8_t> serial;
+        CompressAsset(bytes.data(), bytes.size(), level, &serial, 64 * 1024);
+        ASSERT_TRUE(packed == serial);
+        EXPECT_LT(packed.Size(), bytes.size() * 3 / 4);
+
+        CompressedAsset asset;
+        ASSERT_TRUE(asset.Open(packed.Data(), packed.Size()));
+        EXPECT_EQ(asset.RawSize(), bytes.size());
+        EXPECT_EQ(asset.BlockSize(), 64u * 1024);
+        EXPECT_EQ(asset.BlockCount(), (bytes.size() + 65535) / 65536);
+
+        std::vector<uint8_t> whole(bytes.size());
+        ASSERT_TRUE(asset.Decode(whole.data()));
+        EXPECT_TRUE(whole == bytes);
+        std::vector<uint8_t> parallel(bytes.size());
+        ASSERT_TRUE(asset.Decode(parallel.data(), &jobs));
+        EXPECT_TRUE(parallel == bytes);
+
+        const uint64_t ranges[][2] = { { 0, 1 }, { 65535, 2 }, { 65536, 65536 }, { 1000, 200000 },
+                                       { 999999, 1 }, { 0, 1000000 }, { 500000, 0 } };
+        for (const auto& range : ranges) {
+            std::vector<uint8_t> part(range[1]);
+            ASSERT_TRUE(asset.DecodeRange(range[0], part.size(), part.data()));
+            EXPECT_TRUE(std::equal(part.begin(), part.end(), bytes.begin() + range[0])) << range[0];
+        }
+        uint8_t byte;
+        EXPECT_FALSE(asset.DecodeRange(1000000, 1, &byte));
+    }
+    jobs.Shutdown();
+
+    // Block sizes are held to the range the format allows
+    DynamicArray<uint8_t> clamped;
+    CompressAsset(bytes.data(), bytes.size(), AssetCompression::Fast, &clamped, 1024);
+    CompressedAsset asset;
+    ASSERT_TRUE(asset.Open(clamped.Data(), clamped.Size()));
+    EXPECT_EQ(asset.BlockSize(), kMinCompressionBlock);
+
+    DynamicArray<uint8_t> empty;
+    CompressAsset(nullptr, 0, AssetCompression::Fast, &empty);
+    ASSERT_TRUE(asset.Open(empty.Data(), empty.Size()));
+    EXPECT_EQ(asset.RawSize(), 0u);
+    EXPECT_TRUE(asset.Decode(nullptr));
+
+    EXPECT_FALSE(asset.Open(clamped.Data(), clamped.Size() - 1));
+    clamped.Data()[0] ^= 1;
+    EXPECT_FALSE(asset.Open(clamped.Data(), clamped.Size()));
+}
+
+TEST(AssetCompressionTests, PacksStoreCompressedAssets) {
+    std::vector<uint8_t> text = Text(300000, 13);
+    std::vector<uint8_t> noise = Noise(5000, 14);
+    AssetPackWriter writer;
+    writer.Add("text/fast", text.data(), text.size(), AssetCompression::Fast);
+    writer.Add("text/high", text.data(), text.size(), AssetCompression::High);
+    writer.Add("text/plain", text.data(), text.size());
+    writer.Add("noise", noise.data(), noise.size(), AssetCompression::High);
+    writer.Add("empty", nullptr, 0, AssetCompression::Fast);
+    std::string path = ::testing::TempDir() + "compressed.pack";
+    ASSERT_TRUE(writer.Write(path.c_str())) << writer.Error();
+    EXPECT_EQ(writer.RawSize(), 3 * text.size() + noise.size());
+    EXPECT_LT(writer.PayloadSize(), 2 * text.size());
+
+    AssetPack pack;
+    ASSERT_TRUE(pack.Open(path.c_str()));
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(2));
+    const char* names[] = { "text/fast", "text/high", "text/plain", "noise", "empty" };
+    for (const char* name : names) {
+        AssetSpan span = {};
+        ASSERT_TRUE(pack.Find(name, &span)) << name;
+        const std::vector<uint8_t>& expected = strcmp(name, "noise") == 0 ? noise : text;
+        size_t raw = strcmp(name, "empty") == 0 ? 0 : expected.size();
+        EXPECT_EQ(span.raw_size, raw) << name;
+        // Only assets that shrink are kept compressed
+        EXPECT_EQ(span.compressed, strncmp(name, "text/", 5) == 0 && strcmp(name, "text/plain") != 0) << name;
+        std::vector<uint8_t> loaded(raw);
+        ASSERT_TRUE(LoadAsset(span, loaded.data(), &jobs)) << name;
+        EXPECT_TRUE(std::equal(loaded.begin(), loaded.end(), expected.begin())) << name;
+    }
+    jobs.Shutdown();
+}
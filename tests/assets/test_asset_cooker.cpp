@@ -0,0 +1,347 @@
+#include <gtest/gtest.h>
+#include "asset_cooker.h"
+#include "job_system.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+namespace fs = std::filesystem;
+using namespace toybox::assets;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static std::atomic<int> cooks{ 0 };
+
+static std::string Text(const DynamicArray<uint8_t>& bytes) {
+    return std::string(reinterpret_cast<const char*>(bytes.Data()), bytes.Size());
+}
+
+static void Put(DynamicArray<uint8_t>* out, const std::string& text) {
+    size_t at = out->Size();
+    out->Resize(at + text.size());
+    memcpy(out->Data() + at, text.data(), text.size());
+}
+
+// Upper-cases the source, splicing in the file named by an "include " line
+static bool Shout(CookContext* context) {
+    ++cooks;
+    std::string source(reinterpret_cast<const char*>(context->Source()), context->SourceSize());
+    if (source.find("fail") != std::string::npos) {
+        context->Fail("asked to fail");
+        return false;
+    }
+    if (source.rfind("include ", 0) == 0) {
+        DynamicArray<uint8_t> included;
+        if (!context->ReadInput(source.substr(8).c_str(), &included)) {
+            context->Fail("missing include");
+            return false;
+        }
+        source = Text(included);
+    }
+    for (char& c : source) c = char(toupper(c));
+    Put(context->Output(), std::string(context->Settings()) + ":" + source);
+    return true;
+}
+
+// Joins the cooked output of every dependency after the source
+static bool Join(CookContext* context) {
+    ++cooks;
+    Put(context->Output(), std::string(reinterpret_cast<const char*>(context->Source()), context->SourceSize()));
+    std::string names = context->Settings();
+    size_t start = 0;
+    while (start < names.size()) {
+        size_t end = names.find(',', start);
+        if (end == std::string::npos) end = names.size();
+        DynamicArray<uint8_t> dependency;
+        if (!context->ReadDependency(names.substr(start, end - start).c_str(), &dependency)) return false;
+        Put(context->Output(), "+");
+        Put(context->Output(), Text(dependency));
+        start = end + 1;
+    }
+    return true;
+}
+
+class AssetCookerTests : public ::testing::Test {
+protected:
+    fs::path root;
+    AssetProcessor shout = { "shout", 1, &Shout };
+    AssetProcessor join = { "join", 1, &Join };
+
+    void SetUp() override {
+        root = fs::path(::testing::TempDir()) / ::testing::UnitTest::GetInstance()->current_test_info()->name();
+        fs::remove_all(root);
+        fs::create_directories(root / "source");
+        cooks = 0;
+    }
+
+    void TearDown() override {
+        fs::remove_all(root);
+    }
+
+    std::string Source(const std::string& name) {
+        return (root / "source" / name).string();
+    }
+
+    // Written an hour ago unless fresh, as if by an earlier session, so the
+    // cooker can trust its stat
+    void Write(const std::string& name, const std::string& text, bool fresh = false) {
+        FILE* file = fopen(Source(name).c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        fwrite(text.data(), 1, text.size(), file);
+        fclose(file);
+        if (!fresh) fs::last_write_time(Source(name), fs::file_time_type::clock::now() - std::chrono::hours(1));
+    }
+
+    std::string Cooked(AssetCooker& cooker, const char* name) {
+        DynamicArray<uint8_t> bytes;
+        uint32_t index = cooker.FindAsset(name);
+        EXPECT_NE(index, kNoCookedAsset) << name;
+        if (index == kNoCookedAsset || !cooker.ReadCooked(index, &bytes)) return "<missing>";
+        return Text(bytes);
+    }
+};
+
+TEST(AssetCookerHashTests, HashContentIsXxh64) {
+    EXPECT_EQ(HashContent("", 0), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(HashContent("abc", 3), 0x44BC2CF5AD770999ULL);
+    const char* longer = "Nobody inspects the spammish repetition";
+    EXPECT_EQ(HashContent(longer, strlen(longer)), 0xFBCEA83C8A378BF1ULL);
+    EXPECT_NE(HashContent("abc", 3, 1), HashContent("abc", 3));
+}
+
+TEST_F(AssetCookerTests, RebuildsCookOnlyWhatChanged) {
+    Write("a.txt", "alpha");
+    Write("b.txt", "include " + Source("shared.txt"));
+    Write("c.txt", "include " + Source("shared.txt"));
+    Write("shared.txt", "shared");
+    std::string cache = (root / "cache").string();
+
+    // Each build from a fresh cooker, as from a fresh run of the tool
+    auto build = [&](CookStats* stats) {
+        AssetCooker cooker;
+        EXPECT_TRUE(cooker.Open(cache.c_str())) << cooker.Error();
+        uint32_t processor = cooker.AddProcessor(shout);
+        cooker.Add("a", Source("a.txt").c_str(), processor, "x");
+        cooker.Add("b", Source("b.txt").c_str(), processor, "x");
+        cooker.Add("c", Source("c.txt").c_str(), processor, "y");
+        EXPECT_TRUE(cooker.Build()) << cooker.Error();
+        *stats = cooker.Stats();
+        return Cooked(cooker, "a") + "|" + Cooked(cooker, "b") + "|" + Cooked(cooker, "c");
+    };
+
+    CookStats stats;
+    EXPECT_EQ(build(&stats), "x:ALPHA|x:SHARED|y:SHARED");
+    EXPECT_EQ(stats.cooked, 3u);
+    EXPECT_EQ(cooks, 3);
+
+    EXPECT_EQ(build(&stats), "x:ALPHA|x:SHARED|y:SHARED");
+    EXPECT_EQ(stats.up_to_date, 3u);
+    EXPECT_EQ(stats.files_hashed, 0u);
+    EXPECT_EQ(cooks, 3);
+
+    // A changed source recooks its asset alone
+    Write("a.txt", "alpha two", true);
+    EXPECT_EQ(build(&stats), "x:ALPHA TWO|x:SHARED|y:SHARED");
+    EXPECT_EQ(stats.cooked, 1u);
+    EXPECT_EQ(stats.up_to_date, 2u);
+    EXPECT_EQ(stats.files_hashed, 1u);
+    EXPECT_EQ(cooks, 4);
+
+    // A changed include recooks everything that read it
+    Write("shared.txt", "common");
+    EXPECT_EQ(build(&stats), "x:ALPHA TWO|x:COMMON|y:COMMON");
+    EXPECT_EQ(stats.cooked, 2u);
+    EXPECT_EQ(cooks, 6);
+
+    // Putting things back finds the old objects without cooking
+    Write("a.txt", "alpha");
+    Write("shared.txt", "shared");
+    EXPECT_EQ(build(&stats), "x:ALPHA|x:SHARED|y:SHARED");
+    EXPECT_EQ(stats.from_cache, 3u);
+    EXPECT_EQ(cooks, 6);
+
+    // Touching a file without changing it costs a hash, not a cook
+    Write("a.txt", "alpha", true);
+    build(&stats);
+    EXPECT_EQ(stats.up_to_date, 3u);
+    EXPECT_EQ(stats.files_hashed, 1u);
+    EXPECT_EQ(cooks, 6);
+}
+
+TEST_F(AssetCookerTests, SettingsAndProcessorVersionsArePartOfTheKey) {
+    Write("a.txt", "alpha");
+    std::string cache = (root / "cache").string();
+    AssetCooker cooker;
+    ASSERT_TRUE(cooker.Open(cache.c_str()));
+    uint32_t processor = cooker.AddProcessor(shout);
+    cooker.Add("one", Source("a.txt").c_str(), processor, "x");
+    cooker.Add("same", Source("a.txt").c_str(), processor, "x");
+    cooker.Add("other", Source("a.txt").c_str(), processor, "z");
+    ASSERT_TRUE(cooker.Build()) << cooker.Error();
+    // The same source cooked the same way is one object
+    EXPECT_EQ(cooker.CookedKey(0), cooker.CookedKey(1));
+    EXPECT_NE(cooker.CookedKey(0), cooker.CookedKey(2));
+    EXPECT_EQ(Cooked(cooker, "other"), "z:ALPHA");
+    uint64_t key = cooker.CookedKey(0);
+
+    AssetCooker newer;
+    ASSERT_TRUE(newer.Open(cache.c_str()));
+    AssetProcessor bumped = shout;
+    bumped.version = 2;
+    newer.Add("one", Source("a.txt").c_str(), newer.AddProcessor(bumped), "x");
+    ASSERT_TRUE(newer.Build()) << newer.Error();
+    EXPECT_EQ(newer.Stats().cooked, 1u);
+    EXPECT_NE(newer.CookedKey(0), key);
+}
+
+TEST_F(AssetCookerTests, DependenciesCookFirstAndUnchangedOutputStopsThere) {
+    Write("base.txt", "base");
+    Write("mid.txt", "mid");
+    Write("top.txt", "top");
+    std::string cache = (root / "cache").string();
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(3));
+
+    auto build = [&](CookStats* stats) {
+        AssetCooker cooker;
+        EXPECT_TRUE(cooker.Open(cache.c_str()));
+        uint32_t shouting = cooker.AddProcessor(shout);
+        uint32_t joining = cooker.AddProcessor(join);
+        const char* top_needs[] = { "mid", "base" };
+        const char* mid_needs[] = { "base" };
+        // Declared out of order; the graph decides
+        cooker.Add("top", Source("top.txt").c_str(), joining, "mid,base", top_needs, 2);
+        cooker.Add("mid", Source("mid.txt").c_str(), joining, "base", mid_needs, 1);
+        cooker.Add("base", Source("base.txt").c_str(), shouting, "s");
+        EXPECT_TRUE(cooker.Build(&jobs)) << cooker.Error();
+        *stats = cooker.Stats();
+        return Cooked(cooker, "top");
+    };
+
+    CookStats stats;
+    EXPECT_EQ(build(&stats), "top+mid+s:BASE+s:BASE");
+    EXPECT_EQ(stats.cooked, 3u);
+
+    // Cooks to the same bytes, so nothing above it needs cooking
+    Write("base.txt", "BASE");
+    EXPECT_EQ(build(&stats), "top+mid+s:BASE+s:BASE");
+    EXPECT_EQ(stats.cooked, 1u);
+    EXPECT_EQ(stats.up_to_date, 2u);
+
+    Write("base.txt", "floor");
+    EXPECT_EQ(build(&stats), "top+mid+s:FLOOR+s:FLOOR");
+    EXPECT_EQ(stats.cooked, 3u);
+    jobs.Shutdown();
+}
+
+TEST_F(AssetCookerTests, WideWavesFitTheJobSystem) {
+    // More assets in one wave than a thread may have jobs in flight, on a
+    // system with no workers at all
+    const int count = 5000;
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(0));
+    AssetCooker cooker;
+    ASSERT_TRUE(cooker.Open((root / "cache").string().c_str()));
+    uint32_t processor = cooker.AddProcessor(shout);
+    for (int i = 0; i < count; ++i) {
+        std::string name = "n";
+        name += std::to_string(i);
+        Write(name, name);
+        cooker.Add(name.c_str(), Source(name).c_str(), processor);
+    }
+    ASSERT_TRUE(cooker.Build(&jobs)) << cooker.Error();
+    EXPECT_EQ(cooker.Stats().cooked, uint32_t(count));
+    EXPECT_EQ(Cooked(cooker, "n4321"), ":N4321");
+    jobs.Shutdown();
+}
+
+TEST_F(AssetCookerTests, FailuresAreReportedAndSpreadToDependents) {
+    Write("good.txt", "good");
+    Write("bad.txt", "fail");
+    std::string cache = (root / "cache").string();
+    AssetCooker cooker;
+    ASSERT_TRUE(cooker.Open(cache.c_str()));
+    uint32_t shouting = cooker.AddProcessor(shout);
+    uint32_t joining = cooker.AddProcessor(join);
+    EXPECT_EQ(cooker.FindProcessor("join"), joining);
+    EXPECT_EQ(cooker.FindProcessor("nope"), kNoCookProcessor);
+
+    const char* needs_bad[] = { "bad" };
+    cooker.Add("good", Source("good.txt").c_str(), shouting);
+    cooker.Add("bad", Source("bad.txt").c_str(), shouting);
+    cooker.Add("above", Source("good.txt").c_str(), joining, "bad", needs_bad, 1);
+    EXPECT_FALSE(cooker.Build());
+    EXPECT_STREQ(cooker.Error(), "'bad': asked to fail");
+    EXPECT_EQ(cooker.Stats().cooked, 1u);
+    EXPECT_EQ(cooker.Stats().failed, 2u);
+    EXPECT_EQ(Cooked(cooker, "good"), ":GOOD");
+    DynamicArray<uint8_t> bytes;
+    EXPECT_FALSE(cooker.ReadCooked(cooker.FindAsset("above"), &bytes));
+
+    cooker.Reset();
+    const char* needs_missing[] = { "missing" };
+    cooker.Add("orphan", Source("good.txt").c_str(), joining, "", needs_missing, 1);
+    EXPECT_FALSE(cooker.Build());
+    EXPECT_STREQ(cooker.Error(), "'orphan' depends on 'missing', which was not added");
+
+    cooker.Reset();
+    const char* needs_b[] = { "b" };
+    const char* needs_a[] = { "a" };
+    cooker.Add("a", Source("good.txt").c_str(), joining, "", needs_b, 1);
+    cooker.Add("b", Source("good.txt").c_str(), joining, "", needs_a, 1);
+    cooker.Add("fine", Source("good.txt").c_str(), shouting);
+    EXPECT_FALSE(cooker.Build());
+    EXPECT_STREQ(cooker.Error(), "'a' depends on itself");
+    // Cooked the same way as "good", so already in the cache
+    EXPECT_EQ(cooker.Stats().from_cache, 1u);
+    EXPECT_EQ(cooker.Stats().failed, 2u);
+
+    cooker.Reset();
+    cooker.Add("twice", Source("good.txt").c_str(), shouting);
+    cooker.Add("twice", Source("bad.txt").c_str(), shouting);
+    cooker.Add("gone", Source("missing.txt").c_str(), shouting);
+    EXPECT_FALSE(cooker.Build());
+    EXPECT_STREQ(cooker.Error(), "'twice' was added twice");
+    EXPECT_EQ(cooker.Stats().failed, 1u);
+}
+
+TEST_F(AssetCookerTests, DamagedManifestsAndObjectsAreNotTrusted) {
+    Write("a.txt", "alpha");
+    std::string cache = (root / "cache").string();
+    uint64_t key;
+    {
+        AssetCooker cooker;
+        ASSERT_TRUE(cooker.Open(cache.c_str()));
+        cooker.Add("a", Source("a.txt").c_str(), cooker.AddProcessor(shout));
+        ASSERT_TRUE(cooker.Build());
+        key = cooker.CookedKey(0);
+    }
+    // A manifest cut short is ignored; the object is still found
+    fs::resize_file(fs::path(cache) / "manifest", 10);
+    {
+        AssetCooker cooker;
+        ASSERT_TRUE(cooker.Open(cache.c_str()));
+        cooker.Add("a", Source("a.txt").c_str(), cooker.AddProcessor(shout));
+        ASSERT_TRUE(cooker.Build());
+        EXPECT_EQ(cooker.Stats().from_cache, 1u);
+    }
+    // A damaged object fails to read back
+    char name[32];
+    snprintf(name, sizeof(name), "%02x/%016llx", unsigned(key >> 56), static_cast<unsigned long long>(key));
+    fs::path object = fs::path(cache) / "objects" / name;
+    ASSERT_TRUE(fs::exists(object));
+    FILE* file = fopen(object.string().c_str(), "r+b");
+    fseek(file, -1, SEEK_END);
+    fputc('!', file);
+    fclose(file);
+    AssetCooker cooker;
+    ASSERT_TRUE(cooker.Open(cache.c_str()));
+    cooker.Add("a", Source("a.txt").c_str(), cooker.AddProcessor(shout));
+    ASSERT_TRUE(cooker.Build());
+    DynamicArray<uint8_t> bytes;
+    EXPECT_FALSE(cooker.ReadCooked(0, &bytes));
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "asset_pack.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace toybox::assets;
+
+static std::string TempPath(const char* name) {
+    return ::testing::TempDir() + name;
+}
+
+static std::vector<uint8_t> Contents(uint32_t index) {
+    // Sizes from empty up to a few pages, none of them aligned
+    std::vector<uint8_t> bytes((index * 37) % 9000);
+    for (size_t i = 0; i < bytes.size(); ++i) bytes[i] = uint8_t(index * 31 + i);
+    return bytes;
+}
+
+static std::string NameOf(uint32_t index) {
+    return "meshes/level" + std::to_string(index % 7) + "/prop_" + std::to_string(index) + ".mesh";
+}
+
+TEST(AssetPackTests, FindsEveryAssetInPlace) {
+    const uint32_t count = 2000;
+    AssetPackWriter writer;
+    for (uint32_t i = 0; i < count; ++i) {
+        std::vector<uint8_t> bytes = Contents(i);
+        writer.Add(NameOf(i).c_str(), bytes.data(), bytes.size());
+    }
+    std::string path = TempPath("many.pack");
+    ASSERT_TRUE(writer.Write(path.c_str())) << writer.Error();
+
+    AssetPack pack;
+    ASSERT_TRUE(pack.Open(path.c_str()));
+    EXPECT_EQ(pack.AssetCount(), count);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string name = NameOf(i);
+        AssetSpan span = {};
+        ASSERT_TRUE(pack.Find(name.c_str(), &span)) << name;
+        std::vector<uint8_t> bytes = Contents(i);
+        ASSERT_EQ(span.size, bytes.size());
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(span.data) % kAssetPackAlignment, 0u);
+        EXPECT_TRUE(bytes.empty() || memcmp(span.data, bytes.data(), bytes.size()) == 0) << name;
+        EXPECT_STREQ(pack.AssetName(i), name.c_str());
+        EXPECT_EQ(pack.Asset(i).data, span.data);
+    }
+
+    AssetSpan span = {};
+    EXPECT_FALSE(pack.Find("meshes/level0/prop_2000.mesh", &span));
+    EXPECT_FALSE(pack.Find("", &span));
+    // A prefix of a real name is not that name
+    std::string name = NameOf(5);
+    EXPECT_FALSE(pack.Find(name.c_str(), name.size() - 1, &span));
+    pack.Close();
+    EXPECT_FALSE(pack.IsOpen());
+    EXPECT_FALSE(pack.Find(name.c_str(), &span));
+}
+
+TEST(AssetPackTests, EmptyPacksAndFilesFromDisk) {
+    AssetPackWriter empty;
+    std::string empty_path = TempPath("empty.pack");
+    ASSERT_TRUE(empty.Write(empty_path.c_str())) << empty.Error();
+    AssetPack pack;
+    ASSERT_TRUE(pack.Open(empty_path.c_str()));
+    EXPECT_EQ(pack.AssetCount(), 0u);
+    AssetSpan span = {};
+    EXPECT_FALSE(pack.Find("anything", &span));
+
+    std::string loose = TempPath("strings.txt");
+    FILE* file = fopen(loose.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    fputs("hello=Hello\n", file);
+    fclose(file);
+    AssetPackWriter writer;
+    ASSERT_TRUE(writer.AddFile("text/strings.txt", loose.c_str()));
+    EXPECT_FALSE(writer.AddFile("missing", TempPath("no_such_file").c_str()));
+    std::string path = TempPath("one.pack");
+    ASSERT_TRUE(writer.Write(path.c_str())) << writer.Error();
+    ASSERT_TRUE(pack.Open(path.c_str()));
+    ASSERT_TRUE(pack.Find("text/strings.txt", &span));
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(span.data), span.size), "hello=Hello\n");
+}
+
+TEST(AssetPackTests, RejectsDuplicatesAndDamagedPacks) {
+    AssetPackWriter writer;
+    writer.Add("a", "1", 1);
+    writer.Add("b", "2", 1);
+    writer.Add("a", "3", 1);
+    EXPECT_FALSE(writer.Write(TempPath("duplicate.pack").c_str()));
+    EXPECT_NE(strstr(writer.Error(), "'a'"), nullptr) << writer.Error();
+
+    AssetPackWriter good;
+    for (uint32_t i = 0; i < 50; ++i) {
+        std::vector<uint8_t> bytes = Contents(i + 1);
+        good.Add(NameOf(i).c_str(), bytes.data(), bytes.size());
+    }
+    std::string path = TempPath("good.pack");
+    ASSERT_TRUE(good.Write(path.c_str()));
+    FILE* file = fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    std::vector<uint8_t> bytes;
+    int c;
+    while ((c = fgetc(file)) != EOF) bytes.push_back(uint8_t(c));
+    fclose(file);
+
+    auto write = [](const std::string& to, const std::vector<uint8_t>& data) {
+        FILE* out = fopen(to.c_str(), "wb");
+        fwrite(data.data(), 1, data.size(), out);
+        fclose(out);
+    };
+    AssetPack pack;
+    std::string damaged = TempPath("damaged.pack");
+
+    std::vector<uint8_t> truncated(bytes.begin(), bytes.end() - 1);
+    write(damaged, truncated);
+    EXPECT_FALSE(pack.Open(damaged.c_str()));
+
+    std::vector<uint8_t> bad_entry = bytes;
+    AssetPackHeader header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    AssetPackEntry entry;
+    memcpy(&entry, bytes.data() + header.entries_offset, sizeof(entry));
+    entry.size = bytes.size();
+    memcpy(bad_entry.data() + header.entries_offset, &entry, sizeof(entry));
+    write(damaged, bad_entry);
+    EXPECT_FALSE(pack.Open(damaged.c_str()));
+
+    std::vector<uint8_t> other_version = bytes;
+    header.version = kAssetPackVersion + 1;
+    memcpy(other_version.data(), &header, sizeof(header));
+    write(damaged, other_version);
+    EXPECT_FALSE(pack.Open(damaged.c_str()));
+    EXPECT_FALSE(pack.IsOpen());
+
+    write(damaged, bytes);
+    EXPECT_TRUE(pack.Open(damaged.c_str()));
+}
@@ -0,0 +1,502 @@
+#include <gtest/gtest.h>
+#include "world.h"
+
+#include <string>
+
+using namespace toybox::ecs;
+
+struct Position {
+    float x, y, z;
+};
+
+struct Velocity {
+    float x, y, z;
+};
+
+struct Health {
+    int value;
+};
+
+struct Grounded {
+    static constexpr PartStorage kStorage = PartStorage::Sparse;
+    int frames;
+};
+
+struct Stunned {
+    static constexpr PartStorage kStorage = PartStorage::Sparse;
+    float seconds;
+};
+
+typedef PartRegistry<Position, Velocity, Health, Grounded, Stunned> TestParts;
+typedef World<TestParts> TestWorld;
+
+static size_t CountBlocks(TestWorld& world, uint32_t since) {
+    size_t blocks = 0;
+    world.EachBlock<const Position>(Changed<Position>{ since },
+        [&blocks](uint32_t, const Toy*, const Position*) { ++blocks; });
+    return blocks;
+}
+
+TEST(ECSTests, CreateAndDestroy) {
+    TestWorld world;
+    Toy a = world.Create();
+    Toy b = world.Create();
+    EXPECT_TRUE(world.Alive(a));
+    EXPECT_EQ(world.Count(), 2);
+
+    world.Destroy(a);
+    EXPECT_FALSE(world.Alive(a));
+    EXPECT_TRUE(world.Alive(b));
+
+    // Recycled slots get a new generation
+    Toy c = world.Create();
+    EXPECT_EQ(c.index, a.index);
+    EXPECT_NE(c.generation, a.generation);
+    EXPECT_FALSE(world.Alive(a));
+}
+
+TEST(ECSTests, AddRemoveParts) {
+    TestWorld world;
+    Toy toy = world.Create();
+    world.Add<Position>(toy, Position{ 1.0f, 2.0f, 3.0f });
+    world.Add<Health>(toy, Health{ 10 });
+
+    ASSERT_TRUE(world.Has<Position>(toy));
+    EXPECT_FALSE(world.Has<Velocity>(toy));
+    EXPECT_EQ(world.Read<Position>(toy)->y, 2.0f);
+    EXPECT_EQ(world.Read<Health>(toy)->value, 10);
+
+    world.Remove<Position>(toy);
+    EXPECT_FALSE(world.Has<Position>(toy));
+    EXPECT_EQ(world.Read<Health>(toy)->value, 10);
+}
+
+TEST(ECSTests, SwapRemoveKeepsRecordsValid) {
+    TestWorld world;
+    Toy toys[100];
+    for (int i = 0; i < 100; ++i) {
+        toys[i] = world.Create();
+        world.Add<Health>(toys[i], Health{ i });
+    }
+    for (int i = 0; i < 100; i += 3) {
+        world.Destroy(toys[i]);
+    }
+    for (int i = 0; i < 100; ++i) {
+        if (i % 3 == 0) continue;
+        EXPECT_EQ(world.Read<Health>(toys[i])->value, i);
+    }
+}
+
+TEST(ECSTests, EachVisitsMatchingToys) {
+    TestWorld world;
+    for (int i = 0; i < 10; ++i) {
+        Toy toy = world.Create();
+        world.Add<Position>(toy, Position{ float(i), 0.0f, 0.0f });
+        if (i % 2 == 0) world.Add<Velocity>(toy, Velocity{ 1.0f, 0.0f, 0.0f });
+    }
+
+    world.Each<Position, const Velocity>([](Toy, Position& p, const Velocity& v) {
+        p.x += v.x;
+    });
+
+    int visited = 0;
+    float sum = 0.0f;
+    world.Each<const Position>([&](Toy, const Position& p) {
+        ++visited;
+        sum += p.x;
+    });
+    EXPECT_EQ(visited, 10);
+    EXPECT_EQ(sum, 45.0f + 5.0f);
+}
+
+TEST(ECSTests, ChangedSkipsUntouchedBlocks) {
+    TestWorld world;
+    const int count = 10000;
+    Toy* toys = new Toy[count];
+    for (int i = 0; i < count; ++i) {
+        toys[i] = world.Create();
+        world.Add<Position>(toys[i]);
+    }
+
+    size_t total_blocks = CountBlocks(world, 0);
+    EXPECT_GT(total_blocks, 1u);
+
+    WorkClock clock;
+    uint32_t since = world.BeginWork(&clock);
+    EXPECT_EQ(CountBlocks(world, since), total_blocks);
+
+    // Nothing written since the last run
+    since = world.BeginWork(&clock);
+    EXPECT_EQ(CountBlocks(world, since), 0u);
+
+    // A single write dirties exactly one block
+    world.AdvanceTick();
+    world.Write<Position>(toys[count / 2])->x = 5.0f;
+    since = world.BeginWork(&clock);
+    EXPECT_EQ(CountBlocks(world, since), 1u);
+
+    // Reads never dirty anything
+    world.AdvanceTick();
+    EXPECT_EQ(world.Read<Position>(toys[0])->x, 0.0f);
+    since = world.BeginWork(&clock);
+    EXPECT_EQ(CountBlocks(world, since), 0u);
+    delete[] toys;
+}
+
+TEST(ECSTests, WritesAfterBeginWorkAreSeenNextRun) {
+    TestWorld world;
+    Toy toy = world.Create();
+    world.Add<Position>(toy);
+
+    WorkClock physics, render;
+    world.BeginWork(&physics);
+    world.BeginWork(&render);
+
+    // Both Works begin, then the game writes within the same tick
+    world.BeginWork(&physics);
+    world.BeginWork(&render);
+    world.Write<Position>(toy)->x = 1.0f;
+
+    int physics_changes = 0;
+    int render_changes = 0;
+    uint32_t since = world.BeginWork(&physics);
+    world.Each<const Position>(Changed<Position>{ since }, [&](Toy, const Position&) { ++physics_changes; });
+    since = world.BeginWork(&render);
+    world.Each<const Position>(Changed<Position>{ since }, [&](Toy, const Position&) { ++render_changes; });
+    EXPECT_EQ(physics_changes, 1);
+    EXPECT_EQ(render_changes, 1);
+
+    // Seen once, not again
+    since = world.BeginWork(&render);
+    render_changes = 0;
+    world.Each<const Position>(Changed<Position>{ since }, [&](Toy, const Position&) { ++render_changes; });
+    EXPECT_EQ(render_changes, 0);
+}
+
+TEST(ECSTests, EndWorkHidesTheRunsOwnWrites) {
+    TestWorld world;
+    Toy toy = world.Create();
+    world.Add<Position>(toy);
+
+    // A Work that moves whatever changed
+    WorkClock clock;
+    auto run = [&]() {
+        int moved = 0;
+        uint32_t since = world.BeginWork(&clock);
+        world.Each<Position>(Changed<Position>{ since }, [&](Toy, Position& p) {
+            p.x += 1.0f;
+            ++moved;
+        });
+        world.EndWork(&clock);
+        return moved;
+    };
+    EXPECT_EQ(run(), 1);
+    EXPECT_EQ(run(), 0);
+
+    // Writes made after the run are still found
+    world.Write<Position>(toy)->x = 0.0f;
+    EXPECT_EQ(run(), 1);
+    EXPECT_EQ(run(), 0);
+}
+
+TEST(ECSTests, MutableIterationMarksChanged) {
+    TestWorld world;
+    Toy toy = world.Create();
+    world.Add<Position>(toy);
+    world.Add<Velocity>(toy);
+
+    WorkClock clock;
+    uint32_t since = world.BeginWork(&clock);
+    since = world.BeginWork(&clock);
+
+    world.AdvanceTick();
+    world.Each<const Position, Velocity>([](Toy, const Position&, Velocity& v) { v.x = 1.0f; });
+
+    int position_changes = 0;
+    int velocity_changes = 0;
+    since = world.BeginWork(&clock);
+    world.Each<const Position>(Changed<Position>{ since }, [&](Toy, const Position&) { ++position_changes; });
+    world.Each<const Velocity>(Changed<Velocity>{ since }, [&](Toy, const Velocity&) { ++velocity_changes; });
+    EXPECT_EQ(position_changes, 0);
+    EXPECT_EQ(velocity_changes, 1);
+}
+
+TEST(ECSTests, AddedFilter) {
+    TestWorld world;
+    Toy a = world.Create();
+    world.Add<Position>(a);
+
+    WorkClock clock;
+    uint32_t since = world.BeginWork(&clock);
+    int added = 0;
+    world.Each<const Position>(Added<Position>{ since }, [&](Toy, const Position&) { ++added; });
+    EXPECT_EQ(added, 1);
+
+    since = world.BeginWork(&clock);
+    added = 0;
+    world.Each<const Position>(Added<Position>{ since }, [&](Toy, const Position&) { ++added; });
+    EXPECT_EQ(added, 0);
+
+    // Writing is not adding
+    world.AdvanceTick();
+    world.Write<Position>(a)->x = 1.0f;
+    since = world.BeginWork(&clock);
+    added = 0;
+    world.Each<const Position>(Added<Position>{ since }, [&](Toy, const Position&) { ++added; });
+    EXPECT_EQ(added, 0);
+}
+
+TEST(ECSTests, AddedVersionsFollowMovedRows) {
+    // The Position is added, then its Toy changes group when Health is added
+    {
+        TestWorld world;
+        WorkClock clock;
+        world.BeginWork(&clock);
+        Toy toy = world.Create();
+        world.Add<Position>(toy);
+        world.Add<Health>(toy);
+        uint32_t since = world.BeginWork(&clock);
+        int added = 0;
+        world.Each<const Position>(Added<Position>{ since }, [&](Toy, const Position&) { ++added; });
+        EXPECT_EQ(added, 1);
+    }
+
+    // Destroying an old Toy swaps a newer row from the last block into its place
+    {
+        TestWorld world;
+        WorkClock clock;
+        world.BeginWork(&clock);
+        DynamicArray<Toy> old;
+        size_t blocks = 0;
+        while (blocks < 2) {
+            old.PushBack(world.Create());
+            world.Add<Position>(old.Back());
+            world.Add<Health>(old.Back());
+            blocks = 0;
+            world.EachBlock<const Position>([&](uint32_t, const Toy*, const Position*) { ++blocks; });
+        }
+        world.Destroy(old.Back());
+
+        world.BeginWork(&clock);
+        Toy fresh = world.Create();
+        world.Add<Position>(fresh);
+        world.Add<Health>(fresh);
+        world.Destroy(old.At(0));
+        uint32_t since = world.BeginWork(&clock);
+        bool seen = false;
+        world.Each<const Position>(Added<Position>{ since }, [&](Toy toy, const Position&) {
+            if (toy == fresh) seen = true;
+        });
+        EXPECT_TRUE(seen);
+    }
+
+    // The same holds for sparse Parts swapped into an older chunk
+    {
+        TestWorld world;
+        WorkClock clock;
+        world.BeginWork(&clock);
+        Toy first = world.Create();
+        world.Add<Grounded>(first);
+        for (uint32_t i = 0; i < kSparseChunkSize; ++i) {
+            world.Add<Grounded>(world.Create());
+        }
+
+        world.BeginWork(&clock);
+        Toy fresh = world.Create();
+        world.Add<Grounded>(fresh);
+        world.Remove<Grounded>(first);
+        uint32_t since = world.BeginWork(&clock);
+        bool seen = false;
+        world.Each<const Grounded>(Added<Grounded>{ since }, [&](Toy toy, const Grounded&) {
+            if (toy == fresh) seen = true;
+        });
+        EXPECT_TRUE(seen);
+    }
+}
+
+TEST(ECSTests, VersionComparisonWraps) {
+    EXPECT_TRUE(VersionNewerThan(2u, 1u));
+    EXPECT_FALSE(VersionNewerThan(1u, 1u));
+    EXPECT_TRUE(VersionNewerThan(1u, 0xFFFFFFF0u));
+}
+
+struct alignas(32) Wide {
+    static constexpr PartStorage kStorage = PartStorage::Sparse;
+    float lanes[8];
+};
+
+TEST(ECSTests, SparsePartsKeepTheirAlignment) {
+    World<PartRegistry<Position, Wide>> world;
+    Toy toys[300];
+    for (int i = 0; i < 300; ++i) {
+        toys[i] = world.Create();
+        world.Add<Wide>(toys[i], Wide{ { float(i) } });
+    }
+    // Several grows later every Part is still where an aligned load can read it
+    for (int i = 0; i < 300; ++i) {
+        const Wide* wide = world.Read<Wide>(toys[i]);
+        ASSERT_NE(wide, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(wide) % alignof(Wide), 0u);
+        EXPECT_EQ(wide->lanes[0], float(i));
+    }
+}
+
+TEST(ECSTests, SparsePartsDoNotMoveGroups) {
+    TestWorld world;
+    Toy toy = world.Create();
+    world.Add<Position>(toy, Position{ 1.0f, 0.0f, 0.0f });
+
+    size_t blocks_before = 0;
+    world.EachBlock<const Position>([&](uint32_t, const Toy*, const Position*) { ++blocks_before; });
+
+    world.Add<Grounded>(toy, Grounded{ 3 });
+    EXPECT_TRUE(world.Has<Grounded>(toy));
+    EXPECT_EQ(world.Read<Grounded>(toy)->frames, 3);
+    EXPECT_EQ(world.Read<Position>(toy)->x, 1.0f);
+
+    size_t blocks_after = 0;
+    world.EachBlock<const Position>([&](uint32_t, const Toy*, const Position*) { ++blocks_after; });
+    EXPECT_EQ(blocks_before, blocks_after);
+
+    world.Remove<Grounded>(toy);
+    EXPECT_FALSE(world.Has<Grounded>(toy));
+    EXPECT_TRUE(world.Has<Position>(toy));
+}
+
+TEST(ECSTests, EachMixesPackedAndSparse) {
+    TestWorld world;
+    for (int i = 0; i < 1000; ++i) {
+        Toy toy = world.Create();
+        world.Add<Position>(toy, Position{ float(i), 0.0f, 0.0f });
+        if (i % 10 == 0) world.Add<Grounded>(toy, Grounded{ i });
+        if (i % 20 == 0) world.Add<Stunned>(toy, Stunned{ 1.0f });
+    }
+
+    int mixed = 0;
+    world.Each<const Position, Grounded>([&](Toy, const Position& p, Grounded& g) {
+        EXPECT_EQ(int(p.x), g.frames);
+        ++mixed;
+    });
+    EXPECT_EQ(mixed, 100);
+
+    int sparse_only = 0;
+    world.Each<const Grounded, const Stunned>([&](Toy, const Grounded& g, const Stunned&) {
+        EXPECT_EQ(g.frames % 20, 0);
+        ++sparse_only;
+    });
+    EXPECT_EQ(sparse_only, 50);
+}
+
+TEST(ECSTests, SparseChangeTracking) {
+    TestWorld world;
+    Toy toys[10];
+    for (int i = 0; i < 10; ++i) {
+        toys[i] = world.Create();
+        world.Add<Grounded>(toys[i]);
+    }
+
+    WorkClock clock;
+    uint32_t since = world.BeginWork(&clock);
+    since = world.BeginWork(&clock);
+
+    int changed = 0;
+    world.Each<const Grounded>(Changed<Grounded>{ since }, [&](Toy, const Grounded&) { ++changed; });
+    EXPECT_EQ(changed, 0);
+
+    world.AdvanceTick();
+    world.Write<Grounded>(toys[4])->frames = 1;
+    since = world.BeginWork(&clock);
+    world.Each<const Grounded>(Changed<Grounded>{ since }, [&](Toy, const Grounded&) { ++changed; });
+    EXPECT_GT(changed, 0);
+}
+
+TEST(ECSTests, DestroyClearsSparseParts) {
+    TestWorld world;
+    Toy a = world.Create();
+    Toy b = world.Create();
+    world.Add<Grounded>(a, Grounded{ 1 });
+    world.Add<Grounded>(b, Grounded{ 2 });
+    world.Destroy(a);
+
+    Toy c = world.Create();
+    EXPECT_FALSE(world.Has<Grounded>(c));
+    EXPECT_EQ(world.Read<Grounded>(b)->frames, 2);
+}
+
+struct Named {
+    std::string name;
+};
+
+typedef PartRegistry<Position, Named, Grounded> LifecycleParts;
+
+TEST(ECSTests, RegistryIdsAreDenseAndConstexpr) {
+    static_assert(TestParts::IdOf<Position>() == 0, "ids follow the registry order");
+    static_assert(TestParts::IdOf<const Stunned>() == 4, "const does not change the id");
+    static_assert(TestParts::kCount == 5, "one id per Part");
+    static_assert(TestParts::Contains<Health>() && !LifecycleParts::Contains<Health>(), "membership");
+
+    constexpr PartSignature signature = TestParts::SignatureOf<Position, Health>();
+    static_assert(signature.Test(0) && signature.Test(2) && !signature.Test(1), "signature bits");
+    static_assert(TestParts::PackedSignatureOf<Position, Grounded>() == TestParts::SignatureOf<Position>(),
+                  "sparse Parts stay out of packed signatures");
+    static_assert(TestParts::SparseSignature() == TestParts::SignatureOf<Grounded, Stunned>(), "sparse Parts");
+    SUCCEED();
+}
+
+TEST(ECSTests, SignatureSpansWords) {
+    PartSignature high = PartSignature::Of(100);
+    PartSignature low = PartSignature::Of(3);
+    PartSignature both = high | low;
+    EXPECT_TRUE(both.Test(100));
+    EXPECT_TRUE(both.Test(3));
+    EXPECT_TRUE(both.Contains(high));
+    EXPECT_FALSE(high.Contains(both));
+    EXPECT_EQ(both & ~low, high);
+    EXPECT_TRUE(PartSignature().Empty());
+}
+
+TEST(ECSTests, NameHashesAreStable) {
+    static_assert(PartNameHash<Position>() != PartNameHash<Velocity>(), "distinct Parts hash differently");
+    static_assert(PartNameHash<Position>() == PartNameHash<Position>(), "hashes are deterministic");
+    EXPECT_EQ(PartTypeName<Position>(), "Position");
+    EXPECT_EQ(TestParts::IdOfNameHash(PartNameHash<Health>()), TestParts::IdOf<Health>());
+    EXPECT_EQ(TestParts::IdOfNameHash(PartNameHash<Named>()), TestParts::kCount);
+}
+
+TEST(ECSTests, LifecycleTables) {
+    constexpr const PartInfo& trivial = LifecycleParts::kInfos[LifecycleParts::IdOf<Position>()];
+    static_assert(trivial.move == nullptr && trivial.destroy == nullptr, "trivial Parts are memcpy'd");
+    static_assert(trivial.size == sizeof(Position), "size");
+
+    const PartInfo& named = LifecycleParts::Infos()[LifecycleParts::IdOf<Named>()];
+    ASSERT_NE(named.move, nullptr);
+    ASSERT_NE(named.copy, nullptr);
+    ASSERT_NE(named.destroy, nullptr);
+
+    alignas(Named) unsigned char a[sizeof(Named)];
+    alignas(Named) unsigned char b[sizeof(Named)];
+    new (a) Named{ "rubber duck" };
+    CopyPart(named, b, a);
+    EXPECT_EQ(reinterpret_cast<Named*>(b)->name, "rubber duck");
+    DestroyPart(named, b);
+    DestroyPart(named, a);
+}
+
+TEST(ECSTests, NonTrivialPartsSurviveGroupMoves) {
+    World<LifecycleParts> world;
+    Toy toys[64];
+    for (int i = 0; i < 64; ++i) {
+        toys[i] = world.Create();
+        world.Add<Named>(toys[i], Named{ "toy " + std::to_string(i) });
+    }
+    for (int i = 0; i < 64; i += 2) {
+        world.Add<Position>(toys[i]);
+    }
+    for (int i = 0; i < 64; i += 4) {
+        world.Destroy(toys[i]);
+    }
+    for (int i = 0; i < 64; ++i) {
+        if (i % 4 == 0) continue;
+        EXPECT_EQ(world.Read<Named>(toys[i])->name, "toy " + std::to_string(i));
+    }
+}
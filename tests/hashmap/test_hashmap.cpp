@@ -97,6 +97,68 @@ TEST(HashMapTests, ProbeAndResolveCollision) {
     EXPECT_STREQ(*map.Find(11), "eleven");
 }*/
 
+TEST(HashMapTests, FindKeysThatCollide) {
+    HashMap<int, int> map(16);
+
+    // All hash to the same slot, so each lies further along the run
+    for (int i = 0; i < 8; ++i) map.Insert(3 + 16 * i, i);
+    EXPECT_EQ(map.Size(), 8);
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_NE(map.Find(3 + 16 * i), nullptr);
+        EXPECT_EQ(*map.Find(3 + 16 * i), i);
+        EXPECT_TRUE(map.Contains(3 + 16 * i));
+    }
+    EXPECT_EQ(map.Find(3 + 16 * 8), nullptr);
+
+    map.Insert(3 + 16 * 5, 50);
+    EXPECT_EQ(map.Size(), 8);
+    EXPECT_EQ(*map.Find(3 + 16 * 5), 50);
+
+    // Removing a key from the run leaves the keys after it reachable
+    map.Remove(3);
+    map.Remove(3 + 16 * 4);
+    EXPECT_EQ(map.Size(), 6);
+    EXPECT_FALSE(map.Contains(3));
+    EXPECT_FALSE(map.Contains(3 + 16 * 4));
+    for (int i = 1; i < 8; ++i) {
+        if (i == 4) continue;
+        ASSERT_NE(map.Find(3 + 16 * i), nullptr);
+        EXPECT_EQ(*map.Find(3 + 16 * i), i == 5 ? 50 : i);
+    }
+    map.Insert(3 + 16 * 7, 70);
+    EXPECT_EQ(map.Size(), 6);
+    EXPECT_EQ(*map.Find(3 + 16 * 7), 70);
+
+    HashMap<int, int> pair(16);
+    pair.Insert(3, 1);
+    pair.Insert(19, 2);
+    pair.Remove(3);
+    ASSERT_NE(pair.Find(19), nullptr);
+    EXPECT_EQ(*pair.Find(19), 2);
+    pair.Insert(19, 3);
+    EXPECT_EQ(pair.Size(), 1);
+
+    // A run that wraps past the end of the table, with a key whose home is
+    // the first slot sitting behind the wrapped ones
+    HashMap<int, int> wrapped(16);
+    wrapped.Insert(15, 0);
+    wrapped.Insert(31, 1);
+    wrapped.Insert(16, 2);
+    wrapped.Insert(47, 3);
+    wrapped.Remove(15);
+    EXPECT_EQ(wrapped.Size(), 3);
+    ASSERT_NE(wrapped.Find(31), nullptr);
+    ASSERT_NE(wrapped.Find(16), nullptr);
+    ASSERT_NE(wrapped.Find(47), nullptr);
+    EXPECT_EQ(*wrapped.Find(31), 1);
+    EXPECT_EQ(*wrapped.Find(16), 2);
+    EXPECT_EQ(*wrapped.Find(47), 3);
+    wrapped.Remove(16);
+    ASSERT_NE(wrapped.Find(47), nullptr);
+    EXPECT_EQ(*wrapped.Find(47), 3);
+    EXPECT_EQ(wrapped.Size(), 2);
+}
+
 TEST(HashMapTests, LargeResize) {
     HashMap<int, const char*> map(4);
 
@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+#include "io_service.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace toybox::utils::io;
+using toybox::utils::data_structures::DynamicArray;
+
+static const size_t kFileSize = 1 << 20;
+
+static uint8_t ByteAt(uint64_t offset) {
+    return uint8_t((offset * 2654435761u) >> 13);
+}
+
+static std::string MakeFile(const char* name) {
+    std::string path = ::testing::TempDir() + name;
+    std::vector<uint8_t> bytes(kFileSize);
+    for (size_t i = 0; i < kFileSize; ++i) bytes[i] = ByteAt(i);
+    FILE* file = fopen(path.c_str(), "wb");
+    EXPECT_NE(file, nullptr);
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+    return path;
+}
+
+static bool Matches(const uint8_t* buffer, uint64_t offset, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (buffer[i] != ByteAt(offset + i)) return false;
+    }
+    return true;
+}
+
+// Waits until the backend has finished `count` requests without delivering
+// them, so the frame's budget is not refilled
+static bool WaitFinished(IoService& service, uint64_t count) {
+    for (int i = 0; i < 5000; ++i) {
+        IoServiceStats stats = service.Stats();
+        if (stats.completed + stats.failed + stats.cancelled >= count) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+// Calls Update a frame at a time until nothing is outstanding
+static bool Drain(IoService& service, DynamicArray<IoCompletion>* out) {
+    for (int i = 0; i < 5000 && service.Outstanding() > 0; ++i) {
+        service.Update(out);
+        if (service.Outstanding() > 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return service.Outstanding() == 0;
+}
+
+// Each test runs on the thread pool and on io_uring; the io_uring runs are
+// skipped where the kernel does not allow it
+class IoServiceTests : public ::testing::TestWithParam<IoBackend> {
+protected:
+    bool Start(IoService* service, IoServiceConfig config = IoServiceConfig()) {
+        config.backend = GetParam();
+        if (service->Init(config)) return true;
+        EXPECT_EQ(GetParam(), IoBackend::Uring);
+        return false;
+    }
+};
+
+TEST_P(IoServiceTests, ReadsRangesIntoBuffers) {
+    std::string path = MakeFile("io_ranges.bin");
+    IoService service;
+    if (!Start(&service)) GTEST_SKIP() << "io_uring is not available";
+    EXPECT_EQ(service.Backend(), GetParam());
+    EXPECT_EQ(service.OpenFile((path + ".missing").c_str()), -1);
+    int32_t file = service.OpenFile(path.c_str());
+    ASSERT_GE(file, 0);
+
+    const uint32_t count = 500;
+    std::mt19937 rng(7);
+    std::vector<std::vector<uint8_t>> buffers(count);
+    std::vector<uint64_t> offsets(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        size_t size = 1 + rng() % 20000;
+        offsets[i] = rng() % (kFileSize - size);
+        buffers[i].resize(size);
+        IoPriority priority = IoPriority(i % kIoPriorityCount);
+        IoHandle handle = service.Read(file, offsets[i], size, buffers[i].data(), priority,
+                                       reinterpret_cast<void*>(uintptr_t(i)));
+        ASSERT_NE(handle.index, kNoIo.index);
+    }
+    // Past the end of the file the read comes back short
+    uint8_t tail[4096];
+    service.Read(file, kFileSize - 100, sizeof(tail), tail, IoPriority::Critical);
+
+    DynamicArray<IoCompletion> completions;
+    ASSERT_TRUE(Drain(service, &completions));
+    ASSERT_EQ(completions.Size(), count + 1);
+    for (const IoCompletion& completion : completions) {
+        EXPECT_EQ(completion.status, IoStatus::Done);
+        EXPECT_LE(completion.submitted_ns, completion.completed_ns);
+        if (completion.buffer == tail) {
+            EXPECT_EQ(completion.bytes, 100u);
+            EXPECT_TRUE(Matches(tail, kFileSize - 100, 100));
+            continue;
+        }
+        uint32_t i = uint32_t(reinterpret_cast<uintptr_t>(completion.user));
+        ASSERT_LT(i, count);
+        EXPECT_EQ(completion.buffer, buffers[i].data());
+        EXPECT_EQ(completion.bytes, buffers[i].size());
+        EXPECT_TRUE(Matches(buffers[i].data(), offsets[i], buffers[i].size())) << i;
+    }
+    IoServiceStats stats = service.Stats();
+    EXPECT_EQ(stats.requests, count + 1);
+    EXPECT_EQ(stats.completed, count + 1);
+    service.CloseFile(file);
+}
+
+TEST_P(IoServiceTests, BudgetHoldsBackAndCoalescesAdjacentReads) {
+    std::string path = MakeFile("io_budget.bin");
+    IoServiceConfig config;
+    config.frame_byte_budget = 64 * 1024;
+    IoService service;
+    if (!Start(&service, config)) GTEST_SKIP() << "io_uring is not available";
+    int32_t file = service.OpenFile(path.c_str());
+    ASSERT_GE(file, 0);
+
+    // A critical read spends the whole budget, so the visible reads after it
+    // wait for the next frame
+    std::vector<uint8_t> first(64 * 1024);
+    service.Read(file, 512 * 1024, first.size(), first.data(), IoPriority::Critical);
+    const uint32_t pieces = kIoMaxCoalesced;
+    std::vector<uint8_t> joined(pieces * 4096);
+    for (uint32_t i = 0; i < pieces; ++i) {
+        service.Read(file, 8192 + i * 4096, 4096, joined.data() + i * 4096, IoPriority::Visible);
+    }
+    ASSERT_TRUE(WaitFinished(service, 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    IoServiceStats stats = service.Stats();
+    EXPECT_EQ(stats.completed, 1u);
+    EXPECT_GE(stats.budget_stalls, 1u);
+    EXPECT_EQ(service.Outstanding(), pieces + 1);
+
+    DynamicArray<IoCompletion> completions;
+    EXPECT_EQ(service.Update(&completions), 1u);
+    ASSERT_TRUE(Drain(service, &completions));
+    ASSERT_EQ(completions.Size(), pieces + 1);
+    EXPECT_TRUE(Matches(joined.data(), 8192, joined.size()));
+    stats = service.Stats();
+    EXPECT_EQ(stats.reads_issued, 2u);
+    EXPECT_EQ(stats.coalesced, pieces - 1);
+    EXPECT_EQ(stats.bytes_read, first.size() + joined.size());
+}
+
+TEST_P(IoServiceTests, ServesHigherPrioritiesFirst) {
+    std::string path = MakeFile("io_priority.bin");
+    IoServiceConfig config;
+    config.frame_byte_budget = 4096;
+    IoService service;
+    if (!Start(&service, config)) GTEST_SKIP() << "io_uring is not available";
+    int32_t file = service.OpenFile(path.c_str());
+    ASSERT_GE(file, 0);
+
+    uint8_t critical[4096], prefetch[4096], visible[4096];
+    service.Read(file, 0, sizeof(critical), critical, IoPriority::Critical);
+    service.Read(file, 100000, sizeof(prefetch), prefetch, IoPriority::Prefetch);
+    service.Read(file, 200000, sizeof(visible), visible, IoPriority::Visible);
+    ASSERT_TRUE(WaitFinished(service, 1));
+
+    // One read fits each frame, and the visible one goes first though it
+    // was queued last
+    DynamicArray<IoCompletion> completions;
+    service.Update(&completions);
+    ASSERT_TRUE(WaitFinished(service, 2));
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    service.Update(&completions);
+    ASSERT_EQ(completions.Size(), 2u);
+    EXPECT_EQ(completions.Data()[0].buffer, critical);
+    EXPECT_EQ(completions.Data()[1].buffer, visible);
+    EXPECT_EQ(service.Outstanding(), 1u);
+    ASSERT_TRUE(Drain(service, &completions));
+    ASSERT_EQ(completions.Size(), 3u);
+    EXPECT_EQ(completions.Data()[2].buffer, prefetch);
+    EXPECT_TRUE(Matches(prefetch, 100000, sizeof(prefetch)));
+}
+
+TEST_P(IoServiceTests, CancelsQueuedReadsAndLimitsRequests) {
+    std::string path = MakeFile("io_cancel.bin");
+    IoServiceConfig config;
+    config.frame_byte_budget = 4096;
+    config.max_requests = 4;
+    IoService service;
+    if (!Start(&service, config)) GTEST_SKIP() << "io_uring is not available";
+    int32_t file = service.OpenFile(path.c_str());
+    ASSERT_GE(file, 0);
+
+    uint8_t buffers[5][4096];
+    IoHandle spend = service.Read(file, 0, 4096, buffers[0], IoPriority::Critical);
+    IoHandle kept = service.Read(file, 40960, 4096, buffers[1], IoPriority::Visible);
+    IoHandle dropped = service.Read(file, 81920, 4096, buffers[2], IoPriority::Visible);
+    IoHandle also_dropped = service.Read(file, 122880, 4096, buffers[3], IoPriority::Prefetch);
+    EXPECT_EQ(service.Read(file, 0, 4096, buffers[4], IoPriority::Critical).index, kNoIo.index);
+    ASSERT_TRUE(WaitFinished(service, 1));
+
+    EXPECT_TRUE(service.Cancel(dropped));
+    EXPECT_TRUE(service.Cancel(also_dropped));
+    EXPECT_FALSE(service.Cancel(dropped));
+    DynamicArray<IoCompletion> completions;
+    ASSERT_TRUE(Drain(service, &completions));
+    ASSERT_EQ(completions.Size(), 4u);
+    int cancelled = 0;
+    for (const IoCompletion& completion : completions) {
+        if (completion.status == IoStatus::Cancelled) {
+            ++cancelled;
+            EXPECT_TRUE(completion.buffer == buffers[2] || completion.buffer == buffers[3]);
+        } else {
+            EXPECT_EQ(completion.status, IoStatus::Done);
+        }
+    }
+    EXPECT_EQ(cancelled, 2);
+    EXPECT_EQ(service.Stats().cancelled, 2u);
+    EXPECT_EQ(service.Stats().reads_issued, 2u);
+
+    // Delivered handles are stale, even once their slots are reused
+    EXPECT_FALSE(service.Cancel(spend));
+    EXPECT_FALSE(service.Cancel(kept));
+    IoHandle reused = service.Read(file, 0, 4096, buffers[4], IoPriority::Visible);
+    EXPECT_FALSE(service.Cancel(dropped));
+    EXPECT_NE(reused.index, kNoIo.index);
+    ASSERT_TRUE(Drain(service, &completions));
+    EXPECT_EQ(completions.Back().status, IoStatus::Done);
+    EXPECT_TRUE(Matches(buffers[4], 0, 4096));
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, IoServiceTests, ::testing::Values(IoBackend::Threads, IoBackend::Uring),
+                         [](const ::testing::TestParamInfo<IoBackend>& info) {
+                             return std::string(info.param == IoBackend::Uring ? "Uring" : "Threads");
+                         });
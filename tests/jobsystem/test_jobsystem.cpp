@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include "job_system.h"
+#include "parallel_for.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace toybox::utils::jobs;
+using toybox::utils::data_structures::DynamicArray;
+
+TEST(JobSystemTests, DequePushPopSteal) {
+    static WorkStealingDeque<int, 8> deque;
+    int values[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_TRUE(deque.Push(&values[i]));
+    }
+    EXPECT_FALSE(deque.Push(&values[0]));
+
+    // Owner pops newest first, thieves take the oldest
+    EXPECT_EQ(deque.Pop(), &values[7]);
+    EXPECT_EQ(deque.Steal(), &values[0]);
+    EXPECT_EQ(deque.Size(), 6);
+
+    while (deque.Pop()) {}
+    EXPECT_EQ(deque.Steal(), nullptr);
+    EXPECT_EQ(deque.Size(), 0);
+}
+
+TEST(JobSystemTests, RunsWithoutWorkers) {
+    JobSystem system;
+    ASSERT_TRUE(system.Init(0));
+    EXPECT_EQ(system.ThreadCount(), 1u);
+
+    int value = 0;
+    int* target = &value;
+    JobHandle job = system.Create([target]() { *target = 42; });
+    system.Run(job);
+    system.Wait(job);
+    EXPECT_EQ(value, 42);
+    EXPECT_TRUE(system.IsFinished(job));
+}
+
+TEST(JobSystemTests, ParentWaitsForChildren) {
+    JobSystem system;
+    ASSERT_TRUE(system.Init(3));
+
+    std::atomic<int> done(0);
+    std::atomic<int>* counter = &done;
+    JobHandle parent = system.Create([]() {});
+    for (int i = 0; i < 100; ++i) {
+        system.Run(system.Create([counter]() { counter->fetch_add(1); }, parent));
+    }
+    system.Run(parent);
+    system.Wait(parent);
+    EXPECT_EQ(done.load(), 100);
+}
+
+TEST(JobSystemTests, DependenciesRunInOrder) {
+    JobSystem system;
+    ASSERT_TRUE(system.Init(3));
+
+    for (int round = 0; round < 200; ++round) {
+        std::atomic<int> step(0);
+        int seen[3] = { -1, -1, -1 };
+        std::atomic<int>* s = &step;
+        int* out = seen;
+
+        JobHandle first = system.Create([s, out]() { out[0] = s->fetch_add(1); });
+        JobHandle second = system.Create([s, out]() { out[1] = s->fetch_add(1); });
+        JobHandle third = system.Create([s, out]() { out[2] = s->fetch_add(1); });
+        system.AddDependency(second, first);
+        system.AddDependency(third, second);
+
+        // Submit in reverse so only the dependencies enforce the order
+        system.Run(third);
+        system.Run(second);
+        system.Run(first);
+        system.Wait(third);
+
+        EXPECT_EQ(seen[0], 0);
+        EXPECT_EQ(seen[1], 1);
+        EXPECT_EQ(seen[2], 2);
+    }
+}
+
+TEST(JobSystemTests, DependencyOnFinishedJob) {
+    JobSystem system;
+    ASSERT_TRUE(system.Init(1));
+
+    JobHandle first = system.Create([]() {});
+    system.Run(first);
+    system.Wait(first);
+
+    bool ran = false;
+    bool* flag = &ran;
+    JobHandle second = system.Create([flag]() { *flag = true; });
+    system.AddDependency(second, first);
+    system.Run(second);
+    system.Wait(second);
+    EXPECT_TRUE(ran);
+}
+
+TEST(JobSystemTests, ParallelForCoversRange) {
+    JobSystem system;
+    ASSERT_TRUE(system.Init(3));
+
+    const size_t count = 100000;
+    std::atomic<uint64_t> sum(0);
+    std::atomic<size_t> chunks(0);
+    ParallelFor(&system, 0, count, 1000, [&](size_t begin, size_t end) {
+        EXPECT_LE(end - begin, 1000u);
+        uint64_t local = 0;
+        for (size_t i = begin; i < end; ++i) local += i;
+        sum.fetch_add(local);
+        chunks.fetch_add(1);
+    });
+    EXPECT_EQ(sum.load(), uint64_t(count) * (count - 1) / 2);
+    EXPECT_GE(chunks.load(), count / 1000);
+}
+
+TEST(JobSystemTests, ParallelForSmallRangeRunsInline) {
+    JobSystem system;
+    ASSERT_TRUE(system.Init(2));
+
+    std::thread::id caller = std::this_thread::get_id();
+    std::thread::id ran_on;
+    ParallelFor(&system, 0, 10, 64, [&](size_t, size_t) { ran_on = std::this_thread::get_id(); });
+    EXPECT_EQ(ran_on, caller);
+}
+
+TEST(JobSystemTests, ParallelForOverArray) {
+    JobSystem system;
+    ASSERT_TRUE(system.Init(3));
+
+    DynamicArray<int> values;
+    for (int i = 0; i < 10000; ++i) values.PushBack(i);
+
+    ParallelFor(&system, values, [](int& value, size_t index) { value = int(index) * 2; });
+    for (size_t i = 0; i < values.Size(); ++i) {
+        ASSERT_EQ(values.Data()[i], int(i) * 2);
+    }
+}
+
+TEST(JobSystemTests, ManyJobsReuseSlots) {
+    JobSystem system;
+    ASSERT_TRUE(system.Init(3));
+
+    // More jobs than fit in one thread's ring, spread over several frames
+    std::atomic<int> done(0);
+    std::atomic<int>* counter = &done;
+    for (int frame = 0; frame < 10; ++frame) {
+        JobHandle root = system.Create([]() {});
+        for (uint32_t i = 0; i < kJobsPerThread / 2; ++i) {
+            system.Run(system.Create([counter]() { counter->fetch_add(1); }, root));
+        }
+        system.Run(root);
+        system.Wait(root);
+    }
+    EXPECT_EQ(done.load(), 10 * int(kJobsPerThread / 2));
+}
+
+TEST(JobSystemTests, ExternalThreadCanSubmit) {
+    JobSystem system;
+    ASSERT_TRUE(system.Init(2));
+
+    std::atomic<int> done(0);
+    std::atomic<int>* counter = &done;
+    std::thread outside([&system, counter]() {
+        EXPECT_EQ(system.CurrentThreadIndex(), system.ThreadCount());
+        JobHandle job = system.Create([counter]() { counter->fetch_add(1); });
+        system.Run(job);
+        system.Wait(job);
+    });
+    outside.join();
+    EXPECT_EQ(done.load(), 1);
+}
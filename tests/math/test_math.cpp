@@ -0,0 +1,278 @@
+#include <gtest/gtest.h>
+#include "batch.h"
+#include "matrix.h"
+#include "quaternion.h"
+#include "vector.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace toybox::math;
+
+// Distance between two floats in units in the last place
+static uint32_t UlpDistance(float a, float b) {
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(a));
+    memcpy(&ib, &b, sizeof(b));
+    if (ia < 0) ia = INT32_MIN - ia;
+    if (ib < 0) ib = INT32_MIN - ib;
+    return ia > ib ? uint32_t(ia) - uint32_t(ib) : uint32_t(ib) - uint32_t(ia);
+}
+
+static void ExpectBitExact(const float* a, const float* b, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        ASSERT_EQ(UlpDistance(a[i], b[i]), 0u) << "element " << i << ": " << a[i] << " vs " << b[i];
+    }
+}
+
+static Mat4 RandomTransform(std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+    Vec3 axis = Normalize(Vec3{ unit(rng), unit(rng), unit(rng) + 2.0f });
+    Quat rotation = QuatFromAxisAngle(axis, unit(rng) * 3.0f);
+    return Mat4Compose(Vec3{ unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f }, rotation,
+                       Vec3{ scale(rng), scale(rng), scale(rng) });
+}
+
+TEST(MathTests, ReportsSimdLevel) {
+    std::string level = SimdLevelName();
+    EXPECT_TRUE(level == "AVX2" || level == "SSE4" || level == "Scalar");
+}
+
+TEST(MathTests, Vec4MatchesScalar) {
+    Vec4 a{ 1.5f, -2.25f, 3.0f, 0.125f };
+    Vec4 b{ -0.5f, 4.0f, 1e-3f, 7.0f };
+    Vec4 sum = a + b;
+    Vec4 reference = scalar::Add(a, b);
+    ExpectBitExact(&sum.x, &reference.x, 4);
+    EXPECT_EQ(UlpDistance(Dot(a, b), scalar::Dot(a, b)), 0u);
+    Vec4 low = Min(a, b);
+    Vec4 low_reference = scalar::Min(a, b);
+    ExpectBitExact(&low.x, &low_reference.x, 4);
+}
+
+TEST(MathTests, QuaternionMultiplyMatchesScalar) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int i = 0; i < 1000; ++i) {
+        Quat a = scalar::Normalize(Quat{ unit(rng), unit(rng), unit(rng), unit(rng) });
+        Quat b = scalar::Normalize(Quat{ unit(rng), unit(rng), unit(rng), unit(rng) });
+        Quat simd = a * b;
+        Quat reference = scalar::Multiply(a, b);
+        ExpectBitExact(&simd.x, &reference.x, 4);
+
+        Quat n = Normalize(a * b);
+        Quat n_reference = scalar::Normalize(reference);
+        ExpectBitExact(&n.x, &n_reference.x, 4);
+    }
+}
+
+TEST(MathTests, QuaternionRotationMatchesMatrix) {
+    Quat q = QuatFromAxisAngle(Vec3{ 0.0f, 0.0f, 1.0f }, 1.5707963f);
+    Vec3 rotated = Rotate(q, Vec3{ 1.0f, 0.0f, 0.0f });
+    EXPECT_NEAR(rotated.x, 0.0f, 1e-6f);
+    EXPECT_NEAR(rotated.y, 1.0f, 1e-6f);
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int i = 0; i < 100; ++i) {
+        Quat r = Normalize(Quat{ unit(rng), unit(rng), unit(rng), unit(rng) });
+        Vec3 v{ unit(rng), unit(rng), unit(rng) };
+        Vec3 by_quat = Rotate(r, v);
+        Vec3 by_matrix = TransformVector(Mat4Rotation(r), v);
+        EXPECT_NEAR(by_quat.x, by_matrix.x, 1e-5f);
+        EXPECT_NEAR(by_quat.y, by_matrix.y, 1e-5f);
+        EXPECT_NEAR(by_quat.z, by_matrix.z, 1e-5f);
+    }
+}
+
+TEST(MathTests, SlerpEndpoints) {
+    Quat a = QuatIdentity();
+    Quat b = QuatFromAxisAngle(Vec3{ 0.0f, 1.0f, 0.0f }, 1.0f);
+    Quat start = Slerp(a, b, 0.0f);
+    Quat end = Slerp(a, b, 1.0f);
+    Quat middle = Slerp(a, b, 0.5f);
+    EXPECT_NEAR(start.w, 1.0f, 1e-6f);
+    EXPECT_NEAR(end.y, b.y, 1e-6f);
+    EXPECT_NEAR(middle.y, sinf(0.25f), 1e-6f);
+}
+
+TEST(MathTests, MatrixMultiplyMatchesScalar) {
+    std::mt19937 rng(11);
+    for (int i = 0; i < 1000; ++i) {
+        Mat4 a = RandomTransform(rng);
+        Mat4 b = RandomTransform(rng);
+        Mat4 simd = a * b;
+        Mat4 reference = scalar::Multiply(a, b);
+        ExpectBitExact(simd.m, reference.m, 16);
+    }
+}
+
+TEST(MathTests, InverseRoundTrips) {
+    std::mt19937 rng(5);
+    for (int i = 0; i < 100; ++i) {
+        Mat4 a = RandomTransform(rng);
+        Mat4 inverse;
+        ASSERT_TRUE(Inverse(a, &inverse));
+        Mat4 identity = a * inverse;
+        Mat4 expected = Mat4Identity();
+        for (int k = 0; k < 16; ++k) {
+            EXPECT_NEAR(identity.m[k], expected.m[k], 1e-4f);
+        }
+    }
+
+    Mat4 singular = Mat4Scale(Vec3{ 1.0f, 0.0f, 1.0f });
+    Mat4 untouched = Mat4Identity();
+    EXPECT_FALSE(Inverse(singular, &untouched));
+    EXPECT_EQ(untouched.m[5], 1.0f);
+}
+
+TEST(MathTests, InverseRigidMatchesGeneralInverse) {
+    Mat4 a = Mat4Compose(Vec3{ 3.0f, -2.0f, 5.0f }, QuatFromAxisAngle(Vec3{ 0.0f, 1.0f, 0.0f }, 0.7f),
+                         Vec3{ 1.0f, 1.0f, 1.0f });
+    Mat4 general;
+    ASSERT_TRUE(Inverse(a, &general));
+    Mat4 rigid = InverseRigid(a);
+    for (int k = 0; k < 16; ++k) {
+        EXPECT_NEAR(rigid.m[k], general.m[k], 1e-5f);
+    }
+}
+
+// Batch kernels run over lengths that are not multiples of any lane width, so
+// every SIMD path and the scalar tail are exercised
+class MathBatchTests : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(MathBatchTests, TransformPointsMatchesScalar) {
+    size_t count = GetParam();
+    std::mt19937 rng(static_cast<uint32_t>(count));
+    std::uniform_real_distribution<float> unit(-1000.0f, 1000.0f);
+    std::vector<float> x(count), y(count), z(count);
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = unit(rng);
+        y[i] = unit(rng);
+        z[i] = unit(rng);
+    }
+    Mat4 matrix = RandomTransform(rng);
+
+    std::vector<float> ox(count), oy(count), oz(count), rx(count), ry(count), rz(count);
+    TransformPoints(matrix, Vec3SoA{ x.data(), y.data(), z.data() }, Vec3SoA{ ox.data(), oy.data(), oz.data() }, count);
+    scalar::TransformPoints(matrix, Vec3SoA{ x.data(), y.data(), z.data() },
+                            Vec3SoA{ rx.data(), ry.data(), rz.data() }, count);
+    ExpectBitExact(ox.data(), rx.data(), count);
+    ExpectBitExact(oy.data(), ry.data(), count);
+    ExpectBitExact(oz.data(), rz.data(), count);
+
+    // And the single-point path agrees with both
+    for (size_t i = 0; i < count; ++i) {
+        Vec3 p = TransformPoint(matrix, Vec3{ x[i], y[i], z[i] });
+        ASSERT_EQ(UlpDistance(p.x, ox[i]), 0u);
+        ASSERT_EQ(UlpDistance(p.z, oz[i]), 0u);
+    }
+
+    // In place
+    TransformPoints(matrix, Vec3SoA{ x.data(), y.data(), z.data() }, Vec3SoA{ x.data(), y.data(), z.data() }, count);
+    ExpectBitExact(x.data(), rx.data(), count);
+}
+
+TEST_P(MathBatchTests, MultiplyMatricesMatchesScalar) {
+    size_t count = GetParam();
+    std::mt19937 rng(uint32_t(count) + 1);
+    std::vector<Mat4> a(count), b(count), out(count), reference(count);
+    for (size_t i = 0; i < count; ++i) {
+        a[i] = RandomTransform(rng);
+        b[i] = RandomTransform(rng);
+    }
+    MultiplyMatrices(a.data(), b.data(), out.data(), count);
+    scalar::MultiplyMatrices(a.data(), b.data(), reference.data(), count);
+    for (size_t i = 0; i < count; ++i) {
+        ExpectBitExact(out[i].m, reference[i].m, 16);
+    }
+}
+
+TEST_P(MathBatchTests, NormalizeQuaternionsMatchesScalar) {
+    size_t count = GetParam();
+    std::mt19937 rng(uint32_t(count) + 2);
+    std::uniform_real_distribution<float> unit(-3.0f, 3.0f);
+    std::vector<float> q[4], r[4];
+    for (int c = 0; c < 4; ++c) {
+        q[c].resize(count);
+        for (size_t i = 0; i < count; ++i) q[c][i] = unit(rng) + (c == 3 ? 5.0f : 0.0f);
+        r[c] = q[c];
+    }
+    NormalizeQuaternions(QuatSoA{ q[0].data(), q[1].data(), q[2].data(), q[3].data() }, count);
+    scalar::NormalizeQuaternions(QuatSoA{ r[0].data(), r[1].data(), r[2].data(), r[3].data() }, count);
+    for (int c = 0; c < 4; ++c) {
+        ExpectBitExact(q[c].data(), r[c].data(), count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        float length = sqrtf(q[0][i] * q[0][i] + q[1][i] * q[1][i] + q[2][i] * q[2][i] + q[3][i] * q[3][i]);
+        ASSERT_NEAR(length, 1.0f, 1e-6f);
+    }
+}
+
+TEST_P(MathBatchTests, TransformAabbsMatchesScalarAndEnclosesCorners) {
+    size_t count = GetParam();
+    std::mt19937 rng(uint32_t(count) + 3);
+    std::uniform_real_distribution<float> unit(-10.0f, 10.0f);
+    std::uniform_real_distribution<float> size(0.1f, 5.0f);
+
+    std::vector<Mat4> matrices(count);
+    std::vector<float> local[6], world[6], reference[6];
+    for (int c = 0; c < 6; ++c) {
+        local[c].resize(count);
+        world[c].resize(count);
+        reference[c].resize(count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        matrices[i] = RandomTransform(rng);
+        for (int c = 0; c < 3; ++c) {
+            local[c][i] = unit(rng);
+            local[c + 3][i] = local[c][i] + size(rng);
+        }
+    }
+
+    auto soa = [](std::vector<float>* s) {
+        return AabbSoA{ s[0].data(), s[1].data(), s[2].data(), s[3].data(), s[4].data(), s[5].data() };
+    };
+    TransformAabbs(matrices.data(), soa(local), soa(world), count);
+    scalar::TransformAabbs(matrices.data(), soa(local), soa(reference), count);
+    for (int c = 0; c < 6; ++c) {
+        ExpectBitExact(world[c].data(), reference[c].data(), count);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        for (int corner = 0; corner < 8; ++corner) {
+            Vec3 p{ local[(corner & 1) ? 3 : 0][i], local[(corner & 2) ? 4 : 1][i], local[(corner & 4) ? 5 : 2][i] };
+            Vec3 t = TransformPoint(matrices[i], p);
+            const float slack = 1e-3f;
+            ASSERT_GE(t.x, world[0][i] - slack);
+            ASSERT_LE(t.x, world[3][i] + slack);
+            ASSERT_GE(t.y, world[1][i] - slack);
+            ASSERT_LE(t.y, world[4][i] + slack);
+            ASSERT_GE(t.z, world[2][i] - slack);
+            ASSERT_LE(t.z, world[5][i] + slack);
+        }
+    }
+}
+
+TEST_P(MathBatchTests, BoundsOfPointsMatchesScalar) {
+    size_t count = GetParam();
+    std::mt19937 rng(uint32_t(count) + 4);
+    std::uniform_real_distribution<float> unit(-50.0f, 50.0f);
+    std::vector<float> x(count), y(count), z(count);
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = unit(rng);
+        y[i] = unit(rng);
+        z[i] = unit(rng);
+    }
+    Vec3SoA points{ x.data(), y.data(), z.data() };
+    Aabb bounds = BoundsOfPoints(points, count);
+    Aabb reference = scalar::BoundsOfPoints(points, count);
+    EXPECT_TRUE(bounds.min == reference.min);
+    EXPECT_TRUE(bounds.max == reference.max);
+}
+
+INSTANTIATE_TEST_SUITE_P(Lengths, MathBatchTests, ::testing::Values(1, 3, 4, 7, 8, 9, 31, 1000, 1027));
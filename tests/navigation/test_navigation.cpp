@@ -0,0 +1,250 @@
+#include <gtest/gtest.h>
+#include "grid_map.h"
+#include "grid_pathfinder.h"
+#include "hierarchical_grid.h"
+#include "job_system.h"
+#include "path_service.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace toybox::navigation;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static void FillRandom(GridMap& map, int32_t width, int32_t height, float blocked, std::mt19937& rng) {
+    map.Init(width, height);
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+    for (int32_t y = 0; y < height; ++y) {
+        for (int32_t x = 0; x < width; ++x) {
+            map.SetBlocked(x, y, chance(rng) < blocked);
+        }
+    }
+}
+
+static GridCell RandomOpenCell(const GridMap& map, std::mt19937& rng) {
+    std::uniform_int_distribution<int32_t> x(0, map.Width() - 1);
+    std::uniform_int_distribution<int32_t> y(0, map.Height() - 1);
+    for (;;) {
+        GridCell cell = { x(rng), y(rng) };
+        if (map.IsWalkable(cell.x, cell.y)) return cell;
+    }
+}
+
+// Every step is to a neighbour the map allows
+static void ExpectValidPath(const GridMap& map, const DynamicArray<GridCell>& path, GridCell start, GridCell goal) {
+    ASSERT_FALSE(path.Empty());
+    const GridCell* cells = path.Data();
+    EXPECT_EQ(cells[0], start);
+    EXPECT_EQ(path.Back(), goal);
+    for (size_t i = 1; i < path.Size(); ++i) {
+        int32_t dx = cells[i].x - cells[i - 1].x;
+        int32_t dy = cells[i].y - cells[i - 1].y;
+        ASSERT_TRUE(std::abs(dx) <= 1 && std::abs(dy) <= 1 && (dx != 0 || dy != 0));
+        ASSERT_TRUE(map.CanStep(cells[i - 1].x, cells[i - 1].y, dx, dy));
+    }
+}
+
+TEST(NavigationTests, OpenMapPathsAreOctile) {
+    GridMap map;
+    map.Init(32, 32);
+    GridPathfinder pathfinder;
+    DynamicArray<GridCell> path;
+
+    for (PathAlgorithm algorithm : { PathAlgorithm::AStar, PathAlgorithm::JumpPoint }) {
+        ASSERT_TRUE(pathfinder.FindPath(map, { 1, 2 }, { 20, 9 }, algorithm, &path));
+        ExpectValidPath(map, path, { 1, 2 }, { 20, 9 });
+        EXPECT_NEAR(PathCost(path.Data(), uint32_t(path.Size())), 7 * kDiagonalCost + 12 * kStraightCost, 1e-4f);
+    }
+
+    // Start and goal the same, or blocked
+    ASSERT_TRUE(pathfinder.FindPath(map, { 3, 3 }, { 3, 3 }, PathAlgorithm::AStar, &path));
+    EXPECT_EQ(path.Size(), 1u);
+    map.SetBlocked(5, 5, true);
+    EXPECT_FALSE(pathfinder.FindPath(map, { 3, 3 }, { 5, 5 }, PathAlgorithm::JumpPoint, &path));
+    EXPECT_TRUE(path.Empty());
+}
+
+TEST(NavigationTests, CornersAreNotCut) {
+    // Two blocked cells touching at a corner close the diagonal between them
+    GridMap map;
+    map.Init(3, 3);
+    map.SetBlocked(1, 0, true);
+    map.SetBlocked(0, 1, true);
+    GridPathfinder pathfinder;
+    DynamicArray<GridCell> path;
+    EXPECT_FALSE(pathfinder.FindPath(map, { 0, 0 }, { 2, 2 }, PathAlgorithm::AStar, &path));
+    EXPECT_FALSE(pathfinder.FindPath(map, { 0, 0 }, { 2, 2 }, PathAlgorithm::JumpPoint, &path));
+
+    // One blocked cell rules out the diagonal beside it, leaving three
+    // straight steps
+    map.SetBlocked(0, 1, false);
+    ASSERT_TRUE(pathfinder.FindPath(map, { 0, 0 }, { 2, 1 }, PathAlgorithm::JumpPoint, &path));
+    ExpectValidPath(map, path, { 0, 0 }, { 2, 1 });
+    EXPECT_NEAR(PathCost(path.Data(), uint32_t(path.Size())), 3.0f, 1e-4f);
+}
+
+TEST(NavigationTests, JumpPointMatchesAStar) {
+    std::mt19937 rng(1);
+    GridPathfinder pathfinder;
+    DynamicArray<GridCell> a_star;
+    DynamicArray<GridCell> jump_point;
+
+    for (float blocked : { 0.1f, 0.25f, 0.4f }) {
+        GridMap map;
+        FillRandom(map, 64, 48, blocked, rng);
+        for (int q = 0; q < 100; ++q) {
+            GridCell start = RandomOpenCell(map, rng);
+            GridCell goal = RandomOpenCell(map, rng);
+            bool found = pathfinder.FindPath(map, start, goal, PathAlgorithm::AStar, &a_star);
+            uint32_t a_star_expanded = pathfinder.ExpandedNodes();
+            ASSERT_EQ(pathfinder.FindPath(map, start, goal, PathAlgorithm::JumpPoint, &jump_point), found);
+            if (!found) continue;
+
+            ExpectValidPath(map, jump_point, start, goal);
+            EXPECT_NEAR(PathCost(jump_point.Data(), uint32_t(jump_point.Size())),
+                        PathCost(a_star.Data(), uint32_t(a_star.Size())), 1e-3f);
+            EXPECT_LE(pathfinder.ExpandedNodes(), a_star_expanded);
+        }
+    }
+}
+
+TEST(NavigationTests, HierarchicalPathsAreNearOptimal) {
+    std::mt19937 rng(2);
+    GridMap map;
+    FillRandom(map, 100, 70, 0.25f, rng);
+    HierarchicalGrid hierarchy;
+    hierarchy.Build(map, 10);
+    EXPECT_EQ(hierarchy.ClusterCount(), 70u);
+    EXPECT_GT(hierarchy.NodeCount(), 0u);
+
+    GridPathfinder pathfinder;
+    DynamicArray<GridCell> optimal;
+    DynamicArray<GridCell> path;
+    for (int q = 0; q < 200; ++q) {
+        GridCell start = RandomOpenCell(map, rng);
+        GridCell goal = RandomOpenCell(map, rng);
+        bool found = pathfinder.FindPath(map, start, goal, PathAlgorithm::AStar, &optimal);
+        // The abstraction keeps every connection, so it finds a path
+        // whenever one exists
+        ASSERT_EQ(pathfinder.FindPath(map, start, goal, PathAlgorithm::Hierarchical, &path, &hierarchy), found);
+        if (!found) continue;
+
+        ExpectValidPath(map, path, start, goal);
+        float best = PathCost(optimal.Data(), uint32_t(optimal.Size()));
+        float cost = PathCost(path.Data(), uint32_t(path.Size()));
+        EXPECT_GE(cost, best - 1e-3f);
+        EXPECT_LE(cost, best * 1.3f + 2.0f);
+    }
+}
+
+TEST(NavigationTests, HierarchicalUpdateMatchesRebuild) {
+    std::mt19937 rng(3);
+    GridMap map;
+    FillRandom(map, 64, 64, 0.2f, rng);
+    JobSystem jobs;
+    jobs.Init(2);
+    HierarchicalGrid updated;
+    updated.Build(map, 8, &jobs);
+
+    // Wall off the left half, with a single gap
+    for (int32_t y = 0; y < 64; ++y) {
+        map.SetBlocked(31, y, y != 40);
+        updated.MarkChanged(31, y);
+    }
+    map.SetBlocked(30, 40, false);
+    map.SetBlocked(32, 40, false);
+    updated.MarkChanged(30, 40);
+    updated.MarkChanged(32, 40);
+    updated.Update(&jobs);
+
+    HierarchicalGrid rebuilt;
+    rebuilt.Build(map, 8);
+    EXPECT_EQ(updated.NodeCount(), rebuilt.NodeCount());
+
+    GridPathfinder pathfinder;
+    DynamicArray<GridCell> a;
+    DynamicArray<GridCell> b;
+    for (int q = 0; q < 50; ++q) {
+        GridCell start = RandomOpenCell(map, rng);
+        GridCell goal = RandomOpenCell(map, rng);
+        bool found = pathfinder.FindPath(map, start, goal, PathAlgorithm::Hierarchical, &a, &updated);
+        ASSERT_EQ(pathfinder.FindPath(map, start, goal, PathAlgorithm::Hierarchical, &b, &rebuilt), found);
+        if (!found) continue;
+        ExpectValidPath(map, a, start, goal);
+        EXPECT_NEAR(PathCost(a.Data(), uint32_t(a.Size())), PathCost(b.Data(), uint32_t(b.Size())), 1e-3f);
+    }
+    jobs.Shutdown();
+}
+
+TEST(NavigationTests, ServiceRunsBatchesWithinBudget) {
+    std::mt19937 rng(4);
+    GridMap map;
+    FillRandom(map, 128, 128, 0.2f, rng);
+    HierarchicalGrid hierarchy;
+    hierarchy.Build(map);
+
+    JobSystem jobs;
+    jobs.Init(3);
+    PathService service;
+    ASSERT_TRUE(service.Init(&map, 300, &jobs, &hierarchy));
+
+    const PathAlgorithm algorithms[] = { PathAlgorithm::AStar, PathAlgorithm::JumpPoint, PathAlgorithm::Hierarchical };
+    std::vector<PathRequest> requests;
+    std::vector<PathTicket> tickets;
+    for (int i = 0; i < 300; ++i) {
+        PathRequest request = { RandomOpenCell(map, rng), RandomOpenCell(map, rng), algorithms[i % 3] };
+        requests.push_back(request);
+        tickets.push_back(service.Submit(request));
+        EXPECT_EQ(service.Status(tickets.back()), PathStatus::Pending);
+    }
+    EXPECT_EQ(service.Submit(requests[0]).index, kNoTicket.index);
+
+    // A zero budget still makes progress
+    EXPECT_GE(service.Update(0.0), 1u);
+    int updates = 1;
+    while (service.PendingCount() > 0) {
+        service.Update(1.0);
+        ++updates;
+    }
+    EXPECT_GT(updates, 1);
+
+    GridPathfinder pathfinder;
+    DynamicArray<GridCell> expected;
+    for (size_t i = 0; i < requests.size(); ++i) {
+        bool found = pathfinder.FindPath(map, requests[i].start, requests[i].goal, requests[i].algorithm, &expected,
+                                         &hierarchy);
+        ASSERT_EQ(service.Status(tickets[i]), found ? PathStatus::Found : PathStatus::NotFound);
+        uint32_t count = 0;
+        const GridCell* cells = service.Path(tickets[i], &count);
+        ASSERT_EQ(count, uint32_t(expected.Size()));
+        for (uint32_t c = 0; c < count; ++c) EXPECT_EQ(cells[c], expected.Data()[c]);
+        service.Release(tickets[i]);
+        EXPECT_EQ(service.Status(tickets[i]), PathStatus::Invalid);
+    }
+
+    service.Shutdown();
+    jobs.Shutdown();
+}
+
+TEST(NavigationTests, ReleasedRequestsAreDropped) {
+    GridMap map;
+    map.Init(16, 16);
+    PathService service;
+    ASSERT_TRUE(service.Init(&map, 2));
+
+    PathTicket dropped = service.Submit({ { 0, 0 }, { 15, 15 }, PathAlgorithm::AStar });
+    PathTicket kept = service.Submit({ { 0, 0 }, { 5, 0 }, PathAlgorithm::JumpPoint });
+    service.Release(dropped);
+    EXPECT_EQ(service.Status(dropped), PathStatus::Invalid);
+    // The slot is still queued, so the pool is full
+    EXPECT_EQ(service.Submit({ { 1, 1 }, { 2, 2 }, PathAlgorithm::AStar }).index, kNoTicket.index);
+
+    EXPECT_EQ(service.Update(100.0), 2u);
+    EXPECT_EQ(service.Status(kept), PathStatus::Found);
+    EXPECT_EQ(service.Status(dropped), PathStatus::Invalid);
+    PathTicket reused = service.Submit({ { 1, 1 }, { 2, 2 }, PathAlgorithm::AStar });
+    EXPECT_EQ(reused.index, dropped.index);
+    EXPECT_NE(reused.generation, dropped.generation);
+}
@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "broadphase.h"
+#include "job_system.h"
+#include "physics_integration.h"
+
+#include <random>
+#include <vector>
+
+using namespace toybox::physics;
+using namespace toybox::math;
+using toybox::utils::jobs::JobSystem;
+
+static std::vector<Aabb> RandomBoxes(uint32_t count, Vec3 spread, std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Aabb> boxes;
+    for (uint32_t i = 0; i < count; ++i) {
+        Vec3 centre{ spread.x * unit(rng), spread.y * unit(rng), spread.z * unit(rng) };
+        Vec3 half{ 0.2f + unit(rng), 0.2f + unit(rng), 0.2f + unit(rng) };
+        boxes.push_back(Aabb{ centre - half, centre + half });
+    }
+    return boxes;
+}
+
+static std::vector<uint64_t> BruteForce(const std::vector<Aabb>& boxes) {
+    std::vector<uint64_t> pairs;
+    for (uint32_t a = 0; a < boxes.size(); ++a) {
+        for (uint32_t b = a + 1; b < boxes.size(); ++b) {
+            if (Overlaps(boxes[a], boxes[b])) pairs.push_back((uint64_t(a) << 32) | b);
+        }
+    }
+    return pairs;
+}
+
+static std::vector<uint64_t> Found(const SweepAndPrune& sap) {
+    std::vector<uint64_t> pairs;
+    for (uint32_t i = 0; i < sap.PairCount(); ++i) {
+        pairs.push_back((uint64_t(sap.Pairs()[i].a) << 32) | sap.Pairs()[i].b);
+    }
+    return pairs;
+}
+
+TEST(BroadphaseTests, MatchesBruteForceWhileBoxesMove) {
+    std::mt19937 rng(11);
+    std::vector<Aabb> boxes = RandomBoxes(3000, Vec3{ 60.0f, 20.0f, 60.0f }, rng);
+    std::normal_distribution<float> drift(0.0f, 0.2f);
+    SweepAndPrune sap;
+    for (int frame = 0; frame < 10; ++frame) {
+        sap.Update(boxes.data(), uint32_t(boxes.size()));
+        EXPECT_EQ(Found(sap), BruteForce(boxes)) << "frame " << frame;
+        EXPECT_EQ(sap.Rebuilt(), frame == 0);
+        EXPECT_NE(sap.Axis(), 1u);
+        EXPECT_GT(sap.StripeCount(), 1u);
+        for (Aabb& box : boxes) {
+            Vec3 move{ drift(rng), drift(rng), drift(rng) };
+            box = Aabb{ box.min + move, box.max + move };
+        }
+    }
+    EXPECT_GT(sap.SwapCount(), 0u);
+}
+
+TEST(BroadphaseTests, PicksTheWidestAxisAndRebuildsWhenItChanges) {
+    std::mt19937 rng(5);
+    std::vector<Aabb> boxes = RandomBoxes(500, Vec3{ 5.0f, 5.0f, 400.0f }, rng);
+    SweepAndPrune sap;
+    sap.Update(boxes.data(), uint32_t(boxes.size()));
+    EXPECT_EQ(sap.Axis(), 2u);
+    EXPECT_EQ(sap.StripeCount(), 1u); // Too few to be worth it
+
+    // Turn the scene on its side
+    for (Aabb& box : boxes) {
+        box = Aabb{ Vec3{ box.min.z, box.min.y, box.min.x }, Vec3{ box.max.z, box.max.y, box.max.x } };
+    }
+    sap.Update(boxes.data(), uint32_t(boxes.size()));
+    EXPECT_EQ(sap.Axis(), 0u);
+    EXPECT_TRUE(sap.Rebuilt());
+    EXPECT_EQ(Found(sap), BruteForce(boxes));
+
+    // Shuffling every box far from where it was blows the swap budget
+    std::shuffle(boxes.begin(), boxes.end(), rng);
+    sap.Update(boxes.data(), uint32_t(boxes.size()));
+    EXPECT_TRUE(sap.Rebuilt());
+    EXPECT_EQ(Found(sap), BruteForce(boxes));
+
+    sap.Update(nullptr, 0);
+    EXPECT_EQ(sap.PairCount(), 0u);
+}
+
+TEST(BroadphaseTests, ThreadCountDoesNotChangeTheOutput) {
+    std::mt19937 rng(3);
+    std::vector<Aabb> boxes = RandomBoxes(20000, Vec3{ 150.0f, 40.0f, 150.0f }, rng);
+    JobSystem jobs;
+    jobs.Init(3);
+    SweepAndPrune serial, parallel;
+    for (int frame = 0; frame < 3; ++frame) {
+        serial.Update(boxes.data(), uint32_t(boxes.size()));
+        parallel.Update(boxes.data(), uint32_t(boxes.size()), &jobs);
+        ASSERT_GT(serial.PairCount(), 1000u);
+        EXPECT_EQ(Found(serial), Found(parallel));
+        for (Aabb& box : boxes) box = Aabb{ box.min + Vec3{ 0.1f, 0.0f, 0.0f }, box.max + Vec3{ 0.1f, 0.0f, 0.0f } };
+    }
+    jobs.Shutdown();
+}
+
+TEST(BroadphaseTests, WorldPairsDoNotDependOnThreadCount) {
+    // Spread wide enough on x and z for the sweep to be cut into stripes
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> range(-20.0f, 20.0f);
+    PhysicsWorld serial, parallel;
+    for (int i = 0; i < 20000; ++i) {
+        BodyDesc desc = BodyDescDefault();
+        desc.type = i % 10 == 0 ? BodyType::Kinematic : BodyType::Dynamic;
+        desc.position = Vec3{ range(rng) * 10.0f, range(rng), range(rng) * 10.0f };
+        desc.linear_velocity = Vec3{ range(rng), range(rng), range(rng) };
+        serial.Create(desc);
+        parallel.Create(desc);
+    }
+
+    JobSystem jobs;
+    jobs.Init(3);
+    for (int step = 0; step < 10; ++step) {
+        serial.Step();
+        parallel.Step(&jobs);
+        ASSERT_GT(parallel.Broadphase().StripeCount(), 1u);
+        ASSERT_GT(serial.PairCount(), 100u);
+        ASSERT_EQ(serial.PairCount(), parallel.PairCount());
+        for (uint32_t i = 0; i < serial.PairCount(); ++i) {
+            ASSERT_EQ(serial.Pairs()[i].a, parallel.Pairs()[i].a);
+            ASSERT_EQ(serial.Pairs()[i].b, parallel.Pairs()[i].b);
+        }
+    }
+    jobs.Shutdown();
+}
+
+TEST(BroadphaseTests, WorldReportsPairsThatCanRespond) {
+    PhysicsWorld world;
+    world.SetGravity(Vec3{ 0.0f, 0.0f, 0.0f });
+    BodyDesc floor = BodyDescDefault();
+    floor.type = BodyType::Static;
+    floor.half_extents = Vec3{ 50.0f, 0.5f, 50.0f };
+    PhysicsBody ground = world.Create(floor);
+    PhysicsBody wall = world.Create(floor); // Static against static: never reported
+
+    BodyDesc crate = BodyDescDefault();
+    crate.position = Vec3{ 0.0f, 0.9f, 0.0f };
+    crate.linear_velocity = Vec3{ 1.0f, 0.0f, 0.0f };
+    PhysicsBody falling = world.Create(crate);
+    crate.position = Vec3{ 30.0f, 0.9f, 0.0f };
+    crate.linear_velocity = Vec3{ 0.0f, 0.0f, 0.0f };
+    PhysicsBody resting = world.Create(crate);
+
+    world.Step();
+    ASSERT_EQ(world.PairCount(), 4u);
+    EXPECT_EQ(world.Pairs()[0].a, ground.index);
+    EXPECT_EQ(world.Pairs()[0].b, falling.index);
+    EXPECT_EQ(world.Pairs()[1].a, ground.index);
+    EXPECT_EQ(world.Pairs()[1].b, resting.index);
+    EXPECT_EQ(world.Pairs()[2].a, wall.index);
+    EXPECT_EQ(world.Pairs()[3].b, resting.index);
+
+    // Once the resting crate sleeps, only the moving one keeps its pairs
+    for (int s = 0; s < 60; ++s) world.Step();
+    EXPECT_FALSE(world.Awake(resting));
+    ASSERT_EQ(world.PairCount(), 2u);
+    EXPECT_EQ(world.Pairs()[0].b, falling.index);
+    EXPECT_EQ(world.Pairs()[1].b, falling.index);
+
+    // Bounds follow rotation
+    EXPECT_NEAR(world.Bounds(falling).max.y - world.Bounds(falling).min.y, 1.0f, 1e-5f);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include "job_system.h"
+#include "physics_integration.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace toybox::physics;
+using namespace toybox::math;
+using toybox::utils::jobs::JobSystem;
+
+static Contact Touching(uint32_t a, uint32_t b) {
+    return Contact{ a, b, Vec3{ 0.0f, 1.0f, 0.0f }, 0.1f, 0.0f, Vec3{ 0.0f, 0.0f, 0.0f } };
+}
+
+static PhysicsBody AddGround(PhysicsWorld& world) {
+    BodyDesc floor = BodyDescDefault();
+    floor.type = BodyType::Static;
+    floor.position = Vec3{ 0.0f, -0.5f, 0.0f };
+    floor.half_extents = Vec3{ 500.0f, 0.5f, 500.0f };
+    return world.Create(floor);
+}
+
+static PhysicsBody AddCrate(PhysicsWorld& world, Vec3 position) {
+    BodyDesc crate = BodyDescDefault();
+    crate.position = position;
+    return world.Create(crate);
+}
+
+TEST(IslandTests, StaticBodiesDoNotJoinIslands) {
+    // 0 is the ground; 1-2-3 are stacked, 4 rests alone, 5 touches 3
+    uint8_t linking[7] = { 0, 1, 1, 1, 1, 1, 1 };
+    Contact contacts[6] = { Touching(0, 1), Touching(0, 4), Touching(1, 2), Touching(2, 3), Touching(3, 5),
+                            Touching(0, 5) };
+    ContactIslands islands;
+    islands.Build(contacts, 6, linking, 7);
+
+    ASSERT_EQ(islands.Count(), 2u);
+    EXPECT_EQ(islands.IslandOf(0), kNoIsland);
+    EXPECT_EQ(islands.IslandOf(6), kNoIsland); // Touches nothing
+    EXPECT_EQ(islands.IslandOf(1), 0u);
+    EXPECT_EQ(islands.IslandOf(5), 0u);
+    EXPECT_EQ(islands.IslandOf(4), 1u);
+
+    ASSERT_EQ(islands.BodyCount(0), 4u);
+    const uint32_t stack[4] = { 1, 2, 3, 5 };
+    EXPECT_EQ(std::memcmp(islands.Bodies(0), stack, sizeof(stack)), 0);
+    ASSERT_EQ(islands.ContactCount(0), 5u);
+    const uint32_t stack_contacts[5] = { 0, 2, 3, 4, 5 };
+    EXPECT_EQ(std::memcmp(islands.Contacts(0), stack_contacts, sizeof(stack_contacts)), 0);
+    ASSERT_EQ(islands.ContactCount(1), 1u);
+    EXPECT_EQ(islands.Contacts(1)[0], 1u);
+
+    islands.Build(contacts, 0, linking, 7);
+    EXPECT_EQ(islands.Count(), 0u);
+}
+
+TEST(IslandTests, StacksSettleAndSleepTogether) {
+    PhysicsWorld world;
+    AddGround(world);
+    PhysicsBody stack[3];
+    for (int i = 0; i < 3; ++i) stack[i] = AddCrate(world, Vec3{ 0.0f, 0.5f + float(i) * 0.98f, 0.0f });
+    PhysicsBody loner = AddCrate(world, Vec3{ 10.0f, 0.5f, 0.0f });
+
+    world.Step();
+    ASSERT_EQ(world.Islands().Count(), 2u);
+    EXPECT_EQ(world.Islands().BodyCount(world.Islands().IslandOf(stack[0].index)), 3u);
+
+    for (int s = 0; s < 180; ++s) world.Step();
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_FALSE(world.Awake(stack[i]));
+        // Resting on what is below, less the slop left in each contact
+        EXPECT_NEAR(world.Position(stack[i]).y, 0.5f + float(i), 0.05f);
+        EXPECT_NEAR(world.Position(stack[i]).x, 0.0f, 1e-5f);
+    }
+    EXPECT_FALSE(world.Awake(loner));
+    EXPECT_EQ(world.AwakeCount(), 0u);
+
+    // Sleeping islands are skipped outright
+    world.Step();
+    EXPECT_EQ(world.PairCount(), 0u);
+    EXPECT_EQ(world.Islands().Count(), 0u);
+
+    // Knocking the top crate wakes the one under it, and that one the next
+    world.SetVelocity(stack[2], Vec3{ 0.5f, 0.0f, 0.0f }, Vec3{ 0.0f, 0.0f, 0.0f });
+    world.Step();
+    EXPECT_TRUE(world.Awake(stack[1]));
+    world.Step();
+    EXPECT_TRUE(world.Awake(stack[0]));
+    EXPECT_FALSE(world.Awake(loner));
+}
+
+TEST(IslandTests, ThreadCountDoesNotChangeTheResult) {
+    // Crates dropped in overlapping heaps, so islands of all sizes form and merge
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+    PhysicsWorld serial, parallel;
+    AddGround(serial);
+    AddGround(parallel);
+    std::vector<PhysicsBody> bodies;
+    for (int heap = 0; heap < 400; ++heap) {
+        float x = float(heap % 20) * 6.0f, z = float(heap / 20) * 6.0f;
+        for (int i = 0; i < 10; ++i) {
+            BodyDesc desc = BodyDescDefault();
+            desc.type = i == 9 && heap % 4 == 0 ? BodyType::Kinematic : BodyType::Dynamic;
+            desc.position = Vec3{ x + spread(rng), 1.0f + float(i) * 0.9f, z + spread(rng) };
+            desc.linear_velocity = Vec3{ spread(rng), 0.0f, spread(rng) };
+            desc.mass = 1.0f + spread(rng) * 0.5f;
+            bodies.push_back(serial.Create(desc));
+            parallel.Create(desc);
+        }
+    }
+
+    JobSystem jobs;
+    jobs.Init(3);
+    uint32_t most_islands = 0;
+    for (int s = 0; s < 120; ++s) {
+        serial.Step();
+        parallel.Step(&jobs);
+        if (parallel.Islands().Count() > most_islands) most_islands = parallel.Islands().Count();
+    }
+    jobs.Shutdown();
+    EXPECT_GT(most_islands, 100u);
+    ASSERT_EQ(serial.ContactCount(), parallel.ContactCount());
+    EXPECT_EQ(serial.AwakeCount(), parallel.AwakeCount());
+
+    for (PhysicsBody body : bodies) {
+        Vec3 a = serial.Position(body), b = parallel.Position(body);
+        Vec3 v = serial.LinearVelocity(body), w = parallel.LinearVelocity(body);
+        ASSERT_EQ(std::memcmp(&a, &b, sizeof(a)), 0);
+        ASSERT_EQ(std::memcmp(&v, &w, sizeof(v)), 0);
+        ASSERT_EQ(serial.Awake(body), parallel.Awake(body));
+        // Nothing fell through the ground
+        ASSERT_GT(a.y, 0.0f);
+    }
+}
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include "job_system.h"
+#include "physics_sync.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace toybox::physics;
+using namespace toybox::math;
+using toybox::scene::Transform;
+using toybox::scene::TransformIdentity;
+using toybox::utils::jobs::JobSystem;
+
+typedef toybox::ecs::PartRegistry<PhysicsBody, Transform> SyncParts;
+typedef toybox::ecs::World<SyncParts> SyncWorld;
+
+static BodyDesc Falling(Vec3 position) {
+    BodyDesc desc = BodyDescDefault();
+    desc.position = position;
+    return desc;
+}
+
+TEST(PhysicsTests, FixedTimestepCarriesTheRemainder) {
+    FixedTimestep timestep(0.01f, 4);
+    EXPECT_EQ(timestep.Accumulate(0.025f), 2u);
+    EXPECT_NEAR(timestep.Alpha(), 0.5f, 1e-4f);
+    EXPECT_EQ(timestep.Accumulate(0.0051f), 1u);
+    EXPECT_NEAR(timestep.Alpha(), 0.01f, 1e-3f);
+
+    // A long hitch runs at most max_steps and drops the rest
+    EXPECT_EQ(timestep.Accumulate(1.0f), 4u);
+    EXPECT_GE(timestep.Alpha(), 0.0f);
+    EXPECT_LT(timestep.Alpha(), 1.0f);
+    EXPECT_EQ(timestep.Accumulate(0.0f), 0u);
+}
+
+TEST(PhysicsTests, StepsAreIndependentOfFrameRate) {
+    // Binary fractions, so the accumulator adds up exactly
+    const float dt = 1.0f / 64.0f;
+    PhysicsWorld fast(dt), slow(dt);
+    PhysicsBody a = fast.Create(Falling(Vec3{ 0.0f, 100.0f, 0.0f }));
+    PhysicsBody b = slow.Create(Falling(Vec3{ 0.0f, 100.0f, 0.0f }));
+
+    // One second at 256 fps and at 16 fps runs the same 64 steps
+    uint32_t fast_steps = 0;
+    for (int f = 0; f < 256; ++f) fast_steps += fast.Advance(1.0f / 256.0f);
+    for (int f = 0; f < 16; ++f) slow.Advance(1.0f / 16.0f);
+    EXPECT_EQ(fast.StepCount(), 64u);
+    EXPECT_EQ(slow.StepCount(), 64u);
+    EXPECT_EQ(fast_steps, 64u);
+    EXPECT_EQ(fast.Position(a).y, slow.Position(b).y);
+
+    // Semi-implicit Euler: after n steps y drops by g dt^2 n(n+1)/2
+    float n = float(fast.StepCount());
+    EXPECT_NEAR(fast.Position(a).y, 100.0f - 9.81f * dt * dt * n * (n + 1.0f) * 0.5f, 1e-2f);
+}
+
+TEST(PhysicsTests, RenderPoseBlendsTheLastTwoSteps) {
+    PhysicsWorld world(0.1f);
+    world.SetGravity(Vec3{ 0.0f, 0.0f, 0.0f });
+    BodyDesc desc = BodyDescDefault();
+    desc.linear_velocity = Vec3{ 10.0f, 0.0f, 0.0f };
+    desc.angular_velocity = Vec3{ 0.0f, 1.0f, 0.0f };
+    PhysicsBody body = world.Create(desc);
+
+    EXPECT_EQ(world.Advance(0.15f), 1u);
+    EXPECT_NEAR(world.Alpha(), 0.5f, 1e-4f);
+    EXPECT_NEAR(world.Position(body).x, 1.0f, 1e-5f);
+    EXPECT_NEAR(world.RenderPosition(body).x, 0.5f, 1e-5f);
+    Quat half = world.RenderRotation(body);
+    Quat full = world.Rotation(body);
+    EXPECT_GT(half.y, 0.0f);
+    EXPECT_LT(half.y, full.y);
+
+    // No step this frame, but the render pose still moves on
+    EXPECT_EQ(world.Advance(0.04f), 0u);
+    EXPECT_NEAR(world.RenderPosition(body).x, 0.9f, 1e-4f);
+    EXPECT_EQ(world.ChangedCount(), 1u);
+
+    // Teleports jump without blending
+    Transform pose = TransformIdentity();
+    pose.position = Vec3{ -5.0f, 0.0f, 0.0f };
+    world.SetPoses(&body, &pose, 1);
+    EXPECT_EQ(world.RenderPosition(body).x, -5.0f);
+    world.Advance(0.05f);
+    EXPECT_NEAR(world.RenderPosition(body).x, -5.0f + 10.0f * 0.1f * world.Alpha(), 1e-4f);
+}
+
+TEST(PhysicsTests, RestingBodiesSleepAndStopChanging) {
+    PhysicsWorld world;
+    world.SetGravity(Vec3{ 0.0f, 0.0f, 0.0f });
+    PhysicsBody resting = world.Create(BodyDescDefault());
+    BodyDesc moving = BodyDescDefault();
+    moving.linear_velocity = Vec3{ 1.0f, 0.0f, 0.0f };
+    PhysicsBody mover = world.Create(moving);
+    BodyDesc fixed = BodyDescDefault();
+    fixed.type = BodyType::Static;
+    PhysicsBody wall = world.Create(fixed);
+    EXPECT_FALSE(world.Awake(wall));
+
+    for (int f = 0; f < 60; ++f) world.Advance(kDefaultTimestep);
+    EXPECT_FALSE(world.Awake(resting));
+    EXPECT_TRUE(world.Awake(mover));
+    EXPECT_EQ(world.AwakeCount(), 1u);
+    world.Advance(kDefaultTimestep);
+    ASSERT_EQ(world.ChangedCount(), 1u);
+    EXPECT_EQ(world.ChangedSlots()[0], mover.index);
+
+    world.SetVelocity(resting, Vec3{ 0.0f, 2.0f, 0.0f }, Vec3{ 0.0f, 0.0f, 0.0f });
+    EXPECT_TRUE(world.Awake(resting));
+    world.Advance(kDefaultTimestep);
+    EXPECT_EQ(world.ChangedCount(), 2u);
+    EXPECT_GT(world.Position(resting).y, 0.0f);
+
+    // Static bodies ignore velocity, and dead handles are rejected
+    world.SetVelocity(wall, Vec3{ 1.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 0.0f, 0.0f });
+    EXPECT_FALSE(world.Awake(wall));
+    world.Destroy(mover);
+    EXPECT_FALSE(world.Alive(mover));
+    EXPECT_EQ(world.Count(), 2u);
+    world.Advance(kDefaultTimestep);
+    EXPECT_EQ(world.ChangedCount(), 1u);
+    PhysicsBody reused = world.Create(BodyDescDefault());
+    EXPECT_EQ(reused.index, mover.index);
+    EXPECT_NE(reused.generation, mover.generation);
+}
+
+TEST(PhysicsTests, ParallelStepsMatchSerialBitForBit) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> range(-20.0f, 20.0f);
+    PhysicsWorld serial, parallel;
+    std::vector<PhysicsBody> bodies;
+    for (int i = 0; i < 20000; ++i) {
+        BodyDesc desc = BodyDescDefault();
+        desc.type = i % 10 == 0 ? BodyType::Kinematic : BodyType::Dynamic;
+        desc.position = Vec3{ range(rng), range(rng), range(rng) };
+        desc.linear_velocity = Vec3{ range(rng), range(rng), range(rng) };
+        desc.angular_velocity = Vec3{ range(rng) * 0.1f, range(rng) * 0.1f, range(rng) * 0.1f };
+        bodies.push_back(serial.Create(desc));
+        parallel.Create(desc);
+    }
+
+    JobSystem jobs;
+    jobs.Init(3);
+    for (int f = 0; f < 30; ++f) {
+        serial.Advance(1.0f / 45.0f);
+        parallel.Advance(1.0f / 45.0f, &jobs);
+    }
+    jobs.Shutdown();
+
+    for (PhysicsBody body : bodies) {
+        Vec3 a = serial.Position(body), b = parallel.Position(body);
+        Quat p = serial.Rotation(body), q = parallel.Rotation(body);
+        ASSERT_EQ(std::memcmp(&a, &b, sizeof(a)), 0);
+        ASSERT_EQ(std::memcmp(&p, &q, sizeof(p)), 0);
+        Vec3 r = serial.RenderPosition(body), s = parallel.RenderPosition(body);
+        ASSERT_EQ(std::memcmp(&r, &s, sizeof(r)), 0);
+    }
+}
+
+TEST(PhysicsTests, SyncTouchesOnlyChangedToys) {
+    SyncWorld world;
+    PhysicsWorld physics;
+    std::vector<toybox::ecs::Toy> toys;
+    for (int i = 0; i < 3000; ++i) {
+        toybox::ecs::Toy toy = world.Create();
+        Transform transform = TransformIdentity();
+        transform.position = Vec3{ float(i), 10.0f, 0.0f };
+        transform.scale = Vec3{ 2.0f, 2.0f, 2.0f };
+        BodyDesc desc = Falling(transform.position);
+        desc.type = i % 3 == 0 ? BodyType::Dynamic : BodyType::Static;
+        desc.user_data = UserDataFromToy(toy);
+        world.Add<Transform>(toy, transform);
+        world.Add<PhysicsBody>(toy, physics.Create(desc));
+        toys.push_back(toy);
+    }
+
+    // Half a step left over, so Transforms get a pose between the last two
+    PhysicsSync<SyncParts> sync;
+    EXPECT_EQ(sync.Run(world, physics, kDefaultTimestep * 1.5f), 1u);
+    EXPECT_GT(sync.PushedBlocks(), 0u); // Everything is new the first time
+    EXPECT_EQ(sync.PulledCount(), 1000u);
+    PhysicsBody first = *world.Read<PhysicsBody>(toys[0]);
+    const Transform* falling = world.Read<Transform>(toys[0]);
+    EXPECT_LT(falling->position.y, 10.0f);
+    EXPECT_GT(falling->position.y, physics.Position(first).y);
+    EXPECT_EQ(falling->position.y, physics.RenderPosition(first).y);
+    EXPECT_EQ(falling->scale.x, 2.0f);
+    EXPECT_EQ(world.Read<Transform>(toys[1])->position.y, 10.0f);
+
+    // The sync's own writes do not come back as edits
+    sync.Run(world, physics, kDefaultTimestep);
+    EXPECT_EQ(sync.PushedBlocks(), 0u);
+    EXPECT_EQ(sync.PulledCount(), 1000u);
+
+    // A game edit teleports the body; its block neighbours are compared and skipped
+    world.Write<Transform>(toys[1])->position = Vec3{ 0.0f, 50.0f, 0.0f };
+    sync.Push(world, physics);
+    EXPECT_EQ(sync.PushedBlocks(), 1u);
+    PhysicsBody body = *world.Read<PhysicsBody>(toys[1]);
+    EXPECT_EQ(physics.Position(body).y, 50.0f);
+    physics.Advance(kDefaultTimestep);
+    EXPECT_EQ(physics.ChangedCount(), 1000u);
+    sync.Pull(world, physics);
+
+    // A destroyed Toy's body is skipped on the way out
+    world.Destroy(toys[3]);
+    sync.Run(world, physics, kDefaultTimestep);
+    EXPECT_EQ(sync.PulledCount(), 999u);
+}
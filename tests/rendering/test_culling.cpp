@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+#include "culling.h"
+#include "job_system.h"
+#include "occlusion_buffer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <random>
+#include <vector>
+
+using namespace toybox::rendering;
+using namespace toybox::math;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+struct Objects {
+    std::vector<float> center_x, center_y, center_z;
+    std::vector<float> extent_x, extent_y, extent_z;
+    std::vector<float> radius;
+
+    void Add(Vec3 center, Vec3 extent, float sphere) {
+        center_x.push_back(center.x);
+        center_y.push_back(center.y);
+        center_z.push_back(center.z);
+        extent_x.push_back(extent.x);
+        extent_y.push_back(extent.y);
+        extent_z.push_back(extent.z);
+        radius.push_back(sphere);
+    }
+
+    CullBounds Bounds() const {
+        return CullBounds{ center_x.data(), center_y.data(), center_z.data(), extent_x.data(),
+                           extent_y.data(), extent_z.data(), radius.data() };
+    }
+
+    uint32_t Count() const { return uint32_t(center_x.size()); }
+};
+
+// Objects scattered all round a camera at the origin, some with spheres
+// tighter than their boxes and some with no sphere at all
+static Objects MakeObjects(uint32_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+    std::uniform_real_distribution<float> size(0.1f, 8.0f);
+    Objects objects;
+    for (uint32_t i = 0; i < count; ++i) {
+        Vec3 extent{ size(rng), size(rng), size(rng) };
+        float sphere = i % 3 == 0 ? FLT_MAX : Length(extent) * (i % 3 == 1 ? 1.0f : 0.6f);
+        objects.Add(Vec3{ position(rng), position(rng), position(rng) }, extent, sphere);
+    }
+    return objects;
+}
+
+static Mat4 MakeCamera(Vec3 eye, Vec3 target) {
+    return Mat4Perspective(1.0f, 16.0f / 9.0f, 0.5f, 300.0f) * Mat4LookAt(eye, target, Vec3{ 0.0f, 1.0f, 0.0f });
+}
+
+static bool ReferenceVisible(const Frustum& frustum, const Objects& objects, uint32_t i) {
+    Vec3 center{ objects.center_x[i], objects.center_y[i], objects.center_z[i] };
+    Vec3 extent{ objects.extent_x[i], objects.extent_y[i], objects.extent_z[i] };
+    if (Classify(frustum, Aabb{ center - extent, center + extent }) == Containment::Outside) return false;
+    for (const Plane& plane : frustum.planes) {
+        if (Dot(plane.normal, center) + plane.d < -objects.radius[i]) return false;
+    }
+    return true;
+}
+
+TEST(CullingTests, FrustumCullMatchesReference) {
+    std::mt19937 rng(5);
+    Objects objects = MakeObjects(5003, rng);
+    Frustum frustum = FrustumFromMatrix(MakeCamera(Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 1.0f, 0.2f, -1.0f }));
+
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < objects.Count(); ++i) {
+        if (ReferenceVisible(frustum, objects, i)) expected.push_back(i);
+    }
+    ASSERT_GT(expected.size(), 100u);
+    ASSERT_LT(expected.size(), objects.Count() / 2);
+
+    // Odd ranges exercise the narrower lanes and the scalar tail
+    const uint32_t ranges[][2] = { { 0, objects.Count() }, { 3, 4000 }, { 17, 22 }, { 100, 100 } };
+    std::vector<uint32_t> visible(objects.Count());
+    for (const auto& range : ranges) {
+        std::vector<uint32_t> in_range;
+        for (uint32_t index : expected) {
+            if (index >= range[0] && index < range[1]) in_range.push_back(index);
+        }
+
+        uint32_t count = FrustumCull(frustum, objects.Bounds(), range[0], range[1], visible.data());
+        ASSERT_EQ(count, in_range.size());
+        EXPECT_TRUE(std::equal(in_range.begin(), in_range.end(), visible.begin()));
+
+        count = toybox::rendering::scalar::FrustumCull(frustum, objects.Bounds(), range[0], range[1], visible.data());
+        ASSERT_EQ(count, in_range.size());
+        EXPECT_TRUE(std::equal(in_range.begin(), in_range.end(), visible.begin()));
+    }
+}
+
+TEST(CullingTests, TightSphereCullsBoxCorner) {
+    Frustum frustum = FrustumFromMatrix(MakeCamera(Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 0.0f, -1.0f }));
+    // A box whose corner pokes into the view from behind the camera, and the
+    // same box with a sphere that stays behind the near plane
+    Objects objects;
+    objects.Add(Vec3{ 0.0f, 0.0f, 1.0f }, Vec3{ 2.0f, 2.0f, 2.0f }, FLT_MAX);
+    objects.Add(Vec3{ 0.0f, 0.0f, 1.0f }, Vec3{ 2.0f, 2.0f, 2.0f }, 1.0f);
+
+    uint32_t visible[2];
+    ASSERT_EQ(FrustumCull(frustum, objects.Bounds(), 0, 2, visible), 1u);
+    EXPECT_EQ(visible[0], 0u);
+}
+
+TEST(CullingTests, ParallelStageMatchesSerial) {
+    std::mt19937 rng(9);
+    Objects objects = MakeObjects(3 * kCullChunkSize + 123, rng);
+    Mat4 camera = MakeCamera(Vec3{ 10.0f, 5.0f, 10.0f }, Vec3{ -50.0f, 0.0f, -20.0f });
+
+    JobSystem jobs;
+    jobs.Init(3);
+    CullingStage stage;
+    DynamicArray<uint32_t> serial;
+    DynamicArray<uint32_t> parallel;
+    stage.Run(camera, objects.Bounds(), objects.Count(), &serial);
+    CullingStats serial_stats = stage.Stats();
+    stage.Run(camera, objects.Bounds(), objects.Count(), &parallel, &jobs);
+    jobs.Shutdown();
+
+    EXPECT_EQ(serial_stats.tested, objects.Count());
+    EXPECT_EQ(serial_stats.visible, serial.Size());
+    ASSERT_EQ(serial.Size(), parallel.Size());
+    for (size_t i = 0; i < serial.Size(); ++i) {
+        EXPECT_EQ(serial.Data()[i], parallel.Data()[i]);
+        if (i > 0) {
+            EXPECT_LT(serial.Data()[i - 1], serial.Data()[i]);
+        }
+    }
+}
+
+// A wall 20 units wide and 10 high across the view, 20 units ahead
+static void DrawWall(OcclusionBuffer& buffer, JobSystem* jobs) {
+    const Vec3 vertices[] = { { -10.0f, -5.0f, -20.0f }, { 10.0f, -5.0f, -20.0f },
+                              { 10.0f, 5.0f, -20.0f },   { -10.0f, 5.0f, -20.0f } };
+    // One triangle of each winding
+    const uint32_t indices[] = { 0, 1, 2, 0, 3, 2 };
+    buffer.RasterizeOccluders(vertices, 4, indices, 2, jobs);
+    buffer.Finish(jobs);
+}
+
+TEST(CullingTests, OcclusionHidesObjectsBehindWall) {
+    Mat4 camera = MakeCamera(Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 0.0f, -1.0f });
+    JobSystem jobs;
+    jobs.Init(2);
+    for (JobSystem* system : { static_cast<JobSystem*>(nullptr), &jobs }) {
+        OcclusionBuffer buffer;
+        ASSERT_TRUE(buffer.Init(256, 144));
+        buffer.Begin(camera);
+        DrawWall(buffer, system);
+
+        Vec3 one{ 1.0f, 1.0f, 1.0f };
+        Vec3 behind{ 0.0f, 0.0f, -40.0f };
+        Vec3 in_front{ 0.0f, 0.0f, -10.0f };
+        Vec3 beside{ 30.0f, 0.0f, -40.0f };
+        Vec3 above{ 0.0f, 14.0f, -40.0f };
+        EXPECT_FALSE(buffer.IsVisible(Aabb{ behind - one, behind + one }));
+        EXPECT_TRUE(buffer.IsVisible(Aabb{ in_front - one, in_front + one }));
+        EXPECT_TRUE(buffer.IsVisible(Aabb{ beside - one, beside + one }));
+        EXPECT_TRUE(buffer.IsVisible(Aabb{ above - one, above + one }));
+        // Straddles the wall's edge, so part of it shows
+        Vec3 edge{ 20.0f, 0.0f, -40.0f };
+        EXPECT_TRUE(buffer.IsVisible(Aabb{ edge - one * 4.0f, edge + one * 4.0f }));
+        // Reaches behind the camera
+        EXPECT_TRUE(buffer.IsVisible(Aabb{ Vec3{ -1.0f, -1.0f, -30.0f }, Vec3{ 1.0f, 1.0f, 5.0f } }));
+    }
+    jobs.Shutdown();
+}
+
+TEST(CullingTests, HierarchyKeepsFarthestDepth) {
+    Mat4 camera = MakeCamera(Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 0.0f, -1.0f });
+    OcclusionBuffer buffer;
+    ASSERT_TRUE(buffer.Init(100, 60));
+    buffer.Begin(camera);
+    DrawWall(buffer, nullptr);
+
+    EXPECT_EQ(buffer.DepthAt(buffer.LevelCount() - 1, 0, 0), 1.0f);
+    bool any_wall = false;
+    for (uint32_t level = 1; level < buffer.LevelCount(); ++level) {
+        int32_t width = (buffer.Width() + (1 << level) - 1) >> level;
+        int32_t height = (buffer.Height() + (1 << level) - 1) >> level;
+        int32_t fine_width = (buffer.Width() + (1 << (level - 1)) - 1) >> (level - 1);
+        int32_t fine_height = (buffer.Height() + (1 << (level - 1)) - 1) >> (level - 1);
+        for (int32_t y = 0; y < height; ++y) {
+            for (int32_t x = 0; x < width; ++x) {
+                float farthest = 0.0f;
+                for (int32_t dy = 0; dy < 2; ++dy) {
+                    for (int32_t dx = 0; dx < 2; ++dx) {
+                        int32_t fx = std::min(x * 2 + dx, fine_width - 1);
+                        int32_t fy = std::min(y * 2 + dy, fine_height - 1);
+                        farthest = std::max(farthest, buffer.DepthAt(level - 1, fx, fy));
+                    }
+                }
+                EXPECT_EQ(buffer.DepthAt(level, x, y), farthest);
+                any_wall = any_wall || farthest < 1.0f;
+            }
+        }
+    }
+    EXPECT_TRUE(any_wall);
+}
+
+TEST(CullingTests, StageAppliesOcclusion) {
+    Mat4 camera = MakeCamera(Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 0.0f, -1.0f });
+    OcclusionBuffer buffer;
+    buffer.Init(256, 144);
+    buffer.Begin(camera);
+    DrawWall(buffer, nullptr);
+
+    Objects objects;
+    objects.Add(Vec3{ 0.0f, 0.0f, -40.0f }, Vec3{ 1.0f, 1.0f, 1.0f }, FLT_MAX);  // Hidden
+    objects.Add(Vec3{ 0.0f, 0.0f, -10.0f }, Vec3{ 1.0f, 1.0f, 1.0f }, FLT_MAX);  // In front
+    objects.Add(Vec3{ 0.0f, 0.0f, 40.0f }, Vec3{ 1.0f, 1.0f, 1.0f }, FLT_MAX);   // Behind the camera
+    objects.Add(Vec3{ 30.0f, 0.0f, -40.0f }, Vec3{ 1.0f, 1.0f, 1.0f }, FLT_MAX); // Beside
+
+    CullingStage stage;
+    DynamicArray<uint32_t> visible;
+    stage.Run(camera, objects.Bounds(), objects.Count(), &visible, nullptr, &buffer);
+    EXPECT_EQ(stage.Stats().in_frustum, 3u);
+    ASSERT_EQ(visible.Size(), 2u);
+    EXPECT_EQ(visible.Data()[0], 1u);
+    EXPECT_EQ(visible.Data()[1], 3u);
+}
@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include "frame_graph.h"
+
+#include <random>
+#include <vector>
+
+using namespace toybox::rendering;
+
+static FrameResourceDesc Texture(uint32_t width, uint32_t height, uint32_t bytes = 4) {
+    return FrameResourceDesc{ FrameResourceKind::Texture, width, height, bytes };
+}
+
+static std::vector<FrameBarrier> Barriers(const FrameGraph& graph, FramePass pass) {
+    uint32_t count = 0;
+    const FrameBarrier* barriers = graph.BarriersBefore(pass, &count);
+    return std::vector<FrameBarrier>(barriers, barriers + count);
+}
+
+TEST(FrameGraphTests, CullsPassesNothingNeeds) {
+    FrameGraph graph;
+    FrameResource backbuffer = graph.Import("backbuffer", Texture(1920, 1080), ResourceState::Present);
+    FrameResource shadow = graph.CreateTransient("shadow", Texture(2048, 2048));
+    FrameResource albedo = graph.CreateTransient("albedo", Texture(1920, 1080));
+    FrameResource depth = graph.CreateTransient("depth", Texture(1920, 1080));
+    FrameResource scratch = graph.CreateTransient("debug scratch", Texture(1920, 1080));
+    FrameResource debug = graph.CreateTransient("debug", Texture(1920, 1080));
+    FrameResource hdr = graph.CreateTransient("hdr", Texture(1920, 1080, 8));
+    FrameResource stats = graph.CreateTransient("stats", FrameResourceDesc{ FrameResourceKind::Buffer, 256, 0, 4 });
+
+    FramePass shadows = graph.AddPass("shadows");
+    graph.Write(shadows, shadow, ResourceState::DepthWrite);
+    FramePass gbuffer = graph.AddPass("gbuffer");
+    graph.Write(gbuffer, albedo, ResourceState::RenderTarget);
+    graph.Write(gbuffer, depth, ResourceState::DepthWrite);
+    FramePass debug_prep = graph.AddPass("debug prep");
+    graph.Read(debug_prep, depth, ResourceState::ShaderRead);
+    graph.Write(debug_prep, scratch, ResourceState::RenderTarget);
+    FramePass debug_view = graph.AddPass("debug view");
+    graph.Read(debug_view, scratch, ResourceState::ShaderRead);
+    graph.Write(debug_view, debug, ResourceState::RenderTarget);
+    FramePass lighting = graph.AddPass("lighting");
+    graph.Read(lighting, albedo, ResourceState::ShaderRead);
+    graph.Read(lighting, depth, ResourceState::ShaderRead);
+    graph.Read(lighting, shadow, ResourceState::ShaderRead);
+    graph.Write(lighting, hdr, ResourceState::RenderTarget);
+    FramePass luminance = graph.AddPass("luminance readback", true);
+    graph.Read(luminance, hdr, ResourceState::ShaderRead);
+    graph.Write(luminance, stats, ResourceState::UnorderedAccess);
+    FramePass tonemap = graph.AddPass("tonemap");
+    graph.Read(tonemap, hdr, ResourceState::ShaderRead);
+    graph.Write(tonemap, backbuffer, ResourceState::RenderTarget);
+    graph.Compile();
+
+    EXPECT_FALSE(graph.IsCulled(shadows));
+    EXPECT_FALSE(graph.IsCulled(gbuffer));
+    EXPECT_TRUE(graph.IsCulled(debug_prep));
+    EXPECT_TRUE(graph.IsCulled(debug_view));
+    EXPECT_FALSE(graph.IsCulled(lighting));
+    EXPECT_FALSE(graph.IsCulled(luminance));
+    EXPECT_FALSE(graph.IsCulled(tonemap));
+    EXPECT_FALSE(graph.IsUsed(scratch));
+    EXPECT_FALSE(graph.IsUsed(debug));
+    ASSERT_EQ(graph.ExecutionCount(), 5u);
+    EXPECT_EQ(graph.ExecutionOrder()[2], lighting);
+
+    // First use of each target comes from undefined contents
+    std::vector<FrameBarrier> before_gbuffer = Barriers(graph, gbuffer);
+    ASSERT_EQ(before_gbuffer.size(), 2u);
+    EXPECT_EQ(before_gbuffer[0].resource, albedo);
+    EXPECT_EQ(before_gbuffer[0].before, ResourceState::Undefined);
+    EXPECT_EQ(before_gbuffer[0].after, ResourceState::RenderTarget);
+
+    std::vector<FrameBarrier> before_lighting = Barriers(graph, lighting);
+    ASSERT_EQ(before_lighting.size(), 4u);
+    EXPECT_EQ(before_lighting[0].before, ResourceState::RenderTarget);
+    EXPECT_EQ(before_lighting[0].after, ResourceState::ShaderRead);
+    EXPECT_EQ(before_lighting[2].resource, shadow);
+    EXPECT_EQ(before_lighting[2].before, ResourceState::DepthWrite);
+
+    // hdr is already readable after the readback pass
+    std::vector<FrameBarrier> before_tonemap = Barriers(graph, tonemap);
+    ASSERT_EQ(before_tonemap.size(), 1u);
+    EXPECT_EQ(before_tonemap[0].resource, backbuffer);
+    EXPECT_EQ(before_tonemap[0].before, ResourceState::Present);
+    EXPECT_TRUE(Barriers(graph, debug_view).empty());
+}
+
+TEST(FrameGraphTests, PostChainReusesMemory) {
+    FrameGraph graph;
+    FrameResource output = graph.Import("output", Texture(1280, 720), ResourceState::Undefined);
+    FrameResource targets[4];
+    const char* names[4] = { "scene", "bloom", "blur", "composite" };
+    for (int i = 0; i < 4; ++i) targets[i] = graph.CreateTransient(names[i], Texture(1280, 720));
+
+    FramePass draw = graph.AddPass("draw");
+    graph.Write(draw, targets[0], ResourceState::RenderTarget);
+    for (int i = 1; i < 4; ++i) {
+        FramePass pass = graph.AddPass(names[i]);
+        graph.Read(pass, targets[i - 1], ResourceState::ShaderRead);
+        graph.Write(pass, targets[i], ResourceState::RenderTarget);
+    }
+    FramePass copy = graph.AddPass("copy");
+    graph.Read(copy, targets[3], ResourceState::CopySource);
+    graph.Write(copy, output, ResourceState::CopyDest);
+    graph.Compile();
+
+    // A ping-pong pair is enough
+    uint64_t size = graph.ResourceSize(targets[0]);
+    EXPECT_EQ(graph.UnaliasedMemorySize(), 4 * size);
+    EXPECT_EQ(graph.TransientMemorySize(), 2 * size);
+    EXPECT_EQ(graph.ResourceOffset(targets[2]), graph.ResourceOffset(targets[0]));
+    EXPECT_EQ(graph.ResourceOffset(targets[3]), graph.ResourceOffset(targets[1]));
+    EXPECT_NE(graph.ResourceOffset(targets[0]), graph.ResourceOffset(targets[1]));
+
+    std::vector<FrameBarrier> before_blur = Barriers(graph, 2);
+    ASSERT_EQ(before_blur.size(), 2u);
+    EXPECT_FALSE(before_blur[0].aliased);
+    EXPECT_EQ(before_blur[1].resource, targets[2]);
+    EXPECT_TRUE(before_blur[1].aliased);
+
+    // Reset forgets the frame
+    graph.Reset();
+    EXPECT_EQ(graph.PassCount(), 0u);
+    EXPECT_EQ(graph.ResourceCount(), 0u);
+}
+
+TEST(FrameGraphTests, StorageWritesAreOrdered) {
+    FrameGraph graph;
+    FrameResource particles = graph.CreateTransient("particles", FrameResourceDesc{ FrameResourceKind::Buffer, 4096, 0, 32 });
+    FramePass emit = graph.AddPass("emit");
+    graph.Write(emit, particles, ResourceState::UnorderedAccess);
+    FramePass simulate = graph.AddPass("simulate", true);
+    graph.Read(simulate, particles, ResourceState::UnorderedAccess);
+    graph.Write(simulate, particles, ResourceState::UnorderedAccess);
+    graph.Compile();
+
+    EXPECT_FALSE(graph.IsCulled(emit));
+    std::vector<FrameBarrier> before_simulate = Barriers(graph, simulate);
+    ASSERT_EQ(before_simulate.size(), 1u);
+    EXPECT_EQ(before_simulate[0].before, ResourceState::UnorderedAccess);
+    EXPECT_EQ(before_simulate[0].after, ResourceState::UnorderedAccess);
+}
+
+TEST(FrameGraphTests, RandomGraphsNeverShareLiveMemory) {
+    std::mt19937 rng(21);
+    FrameGraph graph;
+    for (int trial = 0; trial < 50; ++trial) {
+        graph.Reset();
+        uint32_t resource_count = 4 + rng() % 40;
+        FrameResource output = graph.Import("output", Texture(64, 64), ResourceState::Undefined);
+        for (uint32_t r = 0; r < resource_count; ++r) {
+            graph.CreateTransient("transient", Texture(16 << (rng() % 5), 16 << (rng() % 5), 1 + rng() % 8));
+        }
+
+        uint32_t pass_count = 3 + rng() % 40;
+        for (uint32_t p = 0; p < pass_count; ++p) {
+            FramePass pass = graph.AddPass("pass", rng() % 10 == 0);
+            for (uint32_t a = rng() % 3; a > 0; --a) {
+                graph.Read(pass, 1 + rng() % resource_count, ResourceState::ShaderRead);
+            }
+            graph.Write(pass, 1 + rng() % resource_count, ResourceState::RenderTarget);
+            if (rng() % 8 == 0) graph.Write(pass, output, ResourceState::RenderTarget);
+        }
+        graph.Compile();
+
+        EXPECT_LE(graph.TransientMemorySize(), graph.UnaliasedMemorySize());
+        for (FrameResource a = 1; a <= resource_count; ++a) {
+            if (!graph.IsUsed(a)) continue;
+            EXPECT_EQ(graph.ResourceOffset(a) % kTransientAlignment, 0u);
+            EXPECT_LE(graph.ResourceOffset(a) + graph.ResourceSize(a), graph.TransientMemorySize());
+            for (FrameResource b = a + 1; b <= resource_count; ++b) {
+                if (!graph.IsUsed(b)) continue;
+                bool alive_together = graph.FirstUse(a) <= graph.LastUse(b) && graph.FirstUse(b) <= graph.LastUse(a);
+                bool share_bytes = graph.ResourceOffset(a) < graph.ResourceOffset(b) + graph.ResourceSize(b) &&
+                                   graph.ResourceOffset(b) < graph.ResourceOffset(a) + graph.ResourceSize(a);
+                EXPECT_FALSE(alive_together && share_bytes);
+            }
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include "instancing.h"
+#include "job_system.h"
+
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace toybox::rendering;
+using namespace toybox::math;
+using toybox::utils::jobs::JobSystem;
+
+struct Toys {
+    std::vector<uint32_t> mesh, material, pipeline, color;
+    std::vector<Mat4> world;
+
+    RenderObjects Objects() const {
+        return RenderObjects{ mesh.data(), material.data(), pipeline.data(), world.data(), color.data() };
+    }
+};
+
+static Toys MakeToys(uint32_t count, uint32_t meshes, uint32_t materials, std::mt19937& rng) {
+    Toys toys;
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t material = rng() % materials;
+        toys.mesh.push_back(rng() % meshes);
+        toys.material.push_back(material);
+        toys.pipeline.push_back(material % 3);
+        toys.color.push_back(rng());
+        toys.world.push_back(Mat4Translation(Vec3{ position(rng), position(rng), position(rng) }));
+    }
+    return toys;
+}
+
+TEST(InstancingTests, GroupsVisibleObjectsIntoInstancedDraws) {
+    std::mt19937 rng(2);
+    const uint32_t meshes = 5;
+    const uint32_t materials = 4;
+    Toys toys = MakeToys(3000, meshes, materials, rng);
+    std::vector<MeshRange> ranges;
+    for (uint32_t m = 0; m < meshes; ++m) ranges.push_back(MeshRange{ m * 100, 36 + m });
+
+    // Every other object is visible
+    std::vector<uint32_t> visible;
+    for (uint32_t i = 0; i < toys.mesh.size(); i += 2) visible.push_back(i);
+
+    JobSystem jobs;
+    jobs.Init(2);
+    for (JobSystem* system : { static_cast<JobSystem*>(nullptr), &jobs }) {
+        RenderQueue queue;
+        queue.Init(1);
+        InstanceExtractor extractor;
+        extractor.Extract(toys.Objects(), visible.data(), uint32_t(visible.size()), ranges.data(), 0, 0,
+                          queue.Recorder(0), system);
+        EXPECT_EQ(extractor.InstanceCount(), visible.size());
+        EXPECT_EQ(extractor.DrawCount(), meshes * materials);
+        queue.Sort();
+
+        // Each draw's instance range holds exactly its mesh and material,
+        // and every visible object shows up once
+        std::set<uint32_t> seen;
+        struct Checker {
+            const Toys* toys;
+            const InstanceExtractor* extractor;
+            std::set<uint32_t>* seen;
+            uint32_t material = 0;
+            void BeginPass(uint32_t, uint32_t) {}
+            void BindPipeline(uint32_t) {}
+            void BindMaterial(uint32_t value) { material = value; }
+            void Draw(const DrawPayload& payload) {
+                EXPECT_GT(payload.instance_count, 0u);
+                for (uint32_t i = payload.first_instance; i < payload.first_instance + payload.instance_count; ++i) {
+                    const InstanceData& instance = extractor->Instances()[i];
+                    EXPECT_EQ(toys->mesh[instance.object], payload.mesh);
+                    EXPECT_EQ(toys->material[instance.object], material);
+                    EXPECT_EQ(toys->color[instance.object], instance.color);
+                    EXPECT_EQ(instance.rows[0].w, toys->world[instance.object].m[12]);
+                    EXPECT_EQ(instance.rows[2].w, toys->world[instance.object].m[14]);
+                    EXPECT_TRUE(seen->insert(instance.object).second);
+                }
+                EXPECT_EQ(payload.index_count, 36 + payload.mesh);
+            }
+        } checker{ &toys, &extractor, &seen };
+        queue.Execute(checker);
+        EXPECT_EQ(seen.size(), visible.size());
+
+        NullBackend backend;
+        queue.Execute(backend);
+        EXPECT_EQ(backend.draws, meshes * materials);
+        EXPECT_EQ(backend.pipeline_binds, 3u);
+    }
+    jobs.Shutdown();
+}
+
+TEST(InstancingTests, EmptyVisibleListDrawsNothing) {
+    Toys toys;
+    RenderQueue queue;
+    queue.Init(1);
+    InstanceExtractor extractor;
+    extractor.Extract(toys.Objects(), nullptr, 0, nullptr, 0, 0, queue.Recorder(0));
+    EXPECT_EQ(extractor.DrawCount(), 0u);
+    EXPECT_EQ(queue.Recorder(0)->Count(), 0u);
+}
+
+// A unit quad in the xy plane facing +z
+static const Vec3 kQuadPositions[] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 } };
+static const Vec3 kQuadNormals[] = { { 0, 0, 1 }, { 0, 0, 1 }, { 0, 0, 1 }, { 0, 0, 1 } };
+static const uint32_t kQuadIndices[] = { 0, 1, 2, 0, 2, 3 };
+
+TEST(InstancingTests, StaticBatchesMergeByMaterial) {
+    MeshGeometry quad{ kQuadPositions, kQuadNormals, 4, kQuadIndices, 6 };
+    StaticBatcher batcher;
+    const uint32_t count = 40000;
+    for (uint32_t i = 0; i < count; ++i) {
+        Vec3 offset{ float(i % 200) * 2.0f, 0.0f, -float(i / 200) * 2.0f };
+        batcher.Add(0, i % 2, 0, Mat4Translation(offset));
+    }
+    batcher.Build(&quad);
+
+    // Two materials of 20000 quads (80000 vertices) each, split to stay
+    // under the vertex limit
+    ASSERT_EQ(batcher.BatchCount(), 4u);
+    EXPECT_EQ(batcher.VertexCount(), count * 4);
+    EXPECT_EQ(batcher.IndexCount(), count * 6);
+    uint32_t indices = 0;
+    for (uint32_t b = 0; b < batcher.BatchCount(); ++b) {
+        const StaticBatch& batch = batcher.Batches()[b];
+        EXPECT_EQ(batch.material, b < 2 ? 0u : 1u);
+        EXPECT_EQ(batch.first_index, indices);
+        indices += batch.index_count;
+
+        // Every vertex the batch uses is inside its bounds and in world space
+        for (uint32_t i = batch.first_index; i < batch.first_index + batch.index_count; ++i) {
+            const BatchVertex& vertex = batcher.Vertices()[batcher.Indices()[i]];
+            EXPECT_TRUE(vertex.position.x >= batch.bounds.min.x && vertex.position.x <= batch.bounds.max.x);
+            EXPECT_TRUE(vertex.position.z >= batch.bounds.min.z && vertex.position.z <= batch.bounds.max.z);
+            EXPECT_EQ(vertex.normal.z, 1.0f);
+        }
+        EXPECT_LE(batch.index_count / 6 * 4, kMaxBatchVertices);
+    }
+    // The first quad of material 1 sits at the second grid cell
+    const BatchVertex& first = batcher.Vertices()[batcher.Indices()[batcher.Batches()[2].first_index]];
+    EXPECT_EQ(first.position.x, 2.0f);
+
+    // A camera seeing only the near rows submits only the batches there
+    Mat4 camera = Mat4Perspective(1.0f, 1.0f, 0.1f, 30.0f) *
+                  Mat4LookAt(Vec3{ 10.0f, 5.0f, 10.0f }, Vec3{ 10.0f, 0.0f, 0.0f }, Vec3{ 0.0f, 1.0f, 0.0f });
+    RenderQueue queue;
+    queue.Init(1);
+    EXPECT_EQ(batcher.Submit(FrustumFromMatrix(camera), 7, 0, 0, queue.Recorder(0)), 2u);
+    queue.Sort();
+    NullBackend backend;
+    queue.Execute(backend);
+    EXPECT_EQ(backend.draws, 2u);
+    EXPECT_EQ(backend.material_binds, 2u);
+}
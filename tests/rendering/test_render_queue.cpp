@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include "job_system.h"
+#include "parallel_for.h"
+#include "render_queue.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace toybox::rendering;
+using toybox::utils::jobs::JobSystem;
+
+// Remembers the order of calls, for checking Execute against the keys
+struct RecordingBackend {
+    uint32_t pipeline = ~0u;
+    uint32_t material = ~0u;
+    std::vector<uint32_t> meshes;
+    std::vector<uint32_t> pipelines;
+    std::vector<uint32_t> materials;
+    uint32_t passes = 0;
+
+    void BeginPass(uint32_t, uint32_t) {
+        ++passes;
+        pipeline = ~0u;
+        material = ~0u;
+    }
+    void BindPipeline(uint32_t value) {
+        pipeline = value;
+        material = ~0u;
+    }
+    void BindMaterial(uint32_t value) { material = value; }
+    void Draw(const DrawPayload& payload) {
+        meshes.push_back(payload.mesh);
+        pipelines.push_back(pipeline);
+        materials.push_back(material);
+    }
+};
+
+TEST(RenderQueueTests, KeysRoundTrip) {
+    uint64_t opaque = MakeOpaqueKey(3, 17, 1234, 54321, 0.25f);
+    EXPECT_EQ(SortKeyLayer(opaque), 3u);
+    EXPECT_EQ(SortKeyPass(opaque), 17u);
+    EXPECT_FALSE(SortKeyBlended(opaque));
+    EXPECT_EQ(SortKeyPipeline(opaque), 1234u);
+    EXPECT_EQ(SortKeyMaterial(opaque), 54321u);
+
+    uint64_t blended = MakeBlendedKey(15, 31, kMaxSortPipelines - 1, kMaxSortMaterials - 1, 0.9f);
+    EXPECT_EQ(SortKeyLayer(blended), 15u);
+    EXPECT_EQ(SortKeyPass(blended), 31u);
+    EXPECT_TRUE(SortKeyBlended(blended));
+    EXPECT_EQ(SortKeyPipeline(blended), kMaxSortPipelines - 1);
+    EXPECT_EQ(SortKeyMaterial(blended), kMaxSortMaterials - 1);
+
+    // Layers outrank passes, which outrank state; opaque depth is front to
+    // back and blended depth back to front
+    EXPECT_LT(MakeOpaqueKey(0, 31, 9, 9, 1.0f), MakeOpaqueKey(1, 0, 0, 0, 0.0f));
+    EXPECT_LT(MakeOpaqueKey(0, 1, 9, 9, 1.0f), MakeOpaqueKey(0, 2, 0, 0, 0.0f));
+    EXPECT_LT(MakeOpaqueKey(0, 0, 1, 9, 1.0f), MakeOpaqueKey(0, 0, 2, 0, 0.0f));
+    EXPECT_LT(MakeOpaqueKey(0, 0, 1, 1, 0.2f), MakeOpaqueKey(0, 0, 1, 1, 0.3f));
+    EXPECT_LT(MakeBlendedKey(0, 0, 9, 9, 0.3f), MakeBlendedKey(0, 0, 1, 1, 0.2f));
+    EXPECT_EQ(QuantizeDepth(-1.0f), 0u);
+    EXPECT_EQ(QuantizeDepth(2.0f), kMaxSortDepth);
+}
+
+TEST(RenderQueueTests, RadixSortMatchesStableSort) {
+    std::mt19937_64 rng(3);
+    for (uint32_t count : { 1u, 2u, 100u, 5000u }) {
+        std::vector<uint64_t> keys(count);
+        std::vector<uint32_t> values(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            // Few distinct high bytes, many duplicates, and some bytes the
+            // same in every key so passes get skipped
+            keys[i] = ((rng() % 7) << 56) | ((rng() % 300) << 8) | 0x40;
+            values[i] = i;
+        }
+        std::vector<std::pair<uint64_t, uint32_t>> expected;
+        for (uint32_t i = 0; i < count; ++i) expected.push_back({ keys[i], values[i] });
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) {
+            return a.first < b.first;
+        });
+
+        std::vector<uint64_t> scratch_keys(count);
+        std::vector<uint32_t> scratch_values(count);
+        RadixSort(keys.data(), values.data(), count, scratch_keys.data(), scratch_values.data());
+        for (uint32_t i = 0; i < count; ++i) {
+            ASSERT_EQ(keys[i], expected[i].first);
+            ASSERT_EQ(values[i], expected[i].second);
+        }
+    }
+}
+
+TEST(RenderQueueTests, ExecuteBindsStateOncePerRun) {
+    std::mt19937 rng(11);
+    RenderQueue queue;
+    queue.Init(1);
+    CommandBuffer* recorder = queue.Recorder(0);
+    const uint32_t pipelines = 8;
+    const uint32_t materials = 32;
+    for (uint32_t i = 0; i < 2000; ++i) {
+        uint32_t material = rng() % materials;
+        // Each material belongs to one pipeline
+        uint32_t pipeline = material % pipelines;
+        float depth = float(rng() % 1000) / 1000.0f;
+        recorder->Draw(MakeOpaqueKey(0, 0, pipeline, material, depth), DrawPayload{ i, 0, 36, 0, 1 });
+    }
+    queue.Sort();
+
+    NullBackend backend;
+    queue.Execute(backend);
+    EXPECT_EQ(backend.passes, 1u);
+    EXPECT_EQ(backend.pipeline_binds, pipelines);
+    EXPECT_EQ(backend.material_binds, materials);
+    EXPECT_EQ(backend.draws, 2000u);
+    EXPECT_EQ(backend.indices, 2000u * 36u);
+
+    // Every draw sees the state its key asked for, in key order
+    RecordingBackend recording;
+    queue.Execute(recording);
+    const uint64_t* keys = queue.SortedKeys();
+    for (uint32_t i = 0; i < queue.DrawCount(); ++i) {
+        EXPECT_EQ(recording.pipelines[i], SortKeyPipeline(keys[i]));
+        EXPECT_EQ(recording.materials[i], SortKeyMaterial(keys[i]));
+        if (i > 0) {
+            EXPECT_LE(keys[i - 1], keys[i]);
+        }
+    }
+}
+
+TEST(RenderQueueTests, BlendedDrawsGoBackToFrontAfterOpaque) {
+    RenderQueue queue;
+    queue.Init(1);
+    CommandBuffer* recorder = queue.Recorder(0);
+    const float depths[] = { 0.4f, 0.9f, 0.1f, 0.6f };
+    for (uint32_t i = 0; i < 4; ++i) {
+        recorder->Draw(MakeBlendedKey(0, 1, i % 2, 0, depths[i]), DrawPayload{ 100 + i, 0, 3, 0, 1 });
+        recorder->Draw(MakeOpaqueKey(0, 1, i % 2, 0, depths[i]), DrawPayload{ i, 0, 3, 0, 1 });
+    }
+    queue.Sort();
+
+    RecordingBackend recording;
+    queue.Execute(recording);
+    const uint32_t expected[] = { 2, 0, 3, 1, 101, 103, 100, 102 };
+    ASSERT_EQ(recording.meshes.size(), 8u);
+    for (uint32_t i = 0; i < 8; ++i) EXPECT_EQ(recording.meshes[i], expected[i]);
+    EXPECT_EQ(recording.passes, 1u);
+}
+
+TEST(RenderQueueTests, ParallelRecordingMatchesSerial) {
+    JobSystem jobs;
+    jobs.Init(3);
+    RenderQueue queue;
+    queue.Init(jobs.ThreadCount() + 1);
+
+    const uint32_t count = 20000;
+    auto key_of = [](uint32_t i) {
+        return MakeOpaqueKey(i % 3, i % 5, (i * 7) % 50, (i * 13) % 400, float(i % 97) / 97.0f);
+    };
+    for (int frame = 0; frame < 2; ++frame) {
+        queue.Clear();
+        toybox::utils::jobs::ParallelFor(&jobs, 0, count, 256, [&](size_t begin, size_t end) {
+            CommandBuffer* recorder = queue.Recorder(jobs.CurrentThreadIndex());
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t index = uint32_t(i);
+                recorder->Draw(key_of(index), DrawPayload{ index, 0, 6, 0, 1 });
+            }
+        });
+        queue.Sort(&jobs);
+        ASSERT_EQ(queue.DrawCount(), count);
+
+        std::vector<uint64_t> expected;
+        for (uint32_t i = 0; i < count; ++i) expected.push_back(key_of(i));
+        std::sort(expected.begin(), expected.end());
+        RecordingBackend recording;
+        queue.Execute(recording);
+        for (uint32_t i = 0; i < count; ++i) {
+            ASSERT_EQ(queue.SortedKeys()[i], expected[i]);
+            ASSERT_EQ(key_of(recording.meshes[i]), expected[i]);
+        }
+    }
+    jobs.Shutdown();
+}
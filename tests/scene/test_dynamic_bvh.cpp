@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include "dynamic_bvh.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace toybox::scene;
+using namespace toybox::math;
+using toybox::utils::data_structures::DynamicArray;
+using toybox::utils::jobs::JobSystem;
+
+static Aabb RandomBox(std::mt19937& rng, float world = 100.0f) {
+    std::uniform_real_distribution<float> position(-world, world);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+    Vec3 min{ position(rng), position(rng), position(rng) };
+    return Aabb{ min, min + Vec3{ size(rng), size(rng), size(rng) } };
+}
+
+// Proxies and their boxes, mirrored for brute-force checks
+struct Scene {
+    DynamicBvh bvh;
+    std::vector<uint32_t> proxies;
+    std::vector<Aabb> boxes;
+
+    Scene(size_t count, std::mt19937& rng) {
+        for (size_t i = 0; i < count; ++i) {
+            boxes.push_back(RandomBox(rng));
+            proxies.push_back(bvh.CreateProxy(boxes.back(), uint32_t(i)));
+        }
+    }
+};
+
+static std::vector<uint32_t> Sorted(std::vector<uint32_t> values) {
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+TEST(DynamicBvhTests, CreateAndDestroyKeepTreeValid) {
+    std::mt19937 rng(1);
+    Scene scene(1000, rng);
+    EXPECT_TRUE(scene.bvh.Validate());
+    EXPECT_EQ(scene.bvh.ProxyCount(), 1000u);
+    // Balanced: far below the 999 a degenerate tree would reach
+    EXPECT_LT(scene.bvh.Height(), 30u);
+    EXPECT_EQ(scene.bvh.UserData(scene.proxies[17]), 17u);
+
+    for (size_t i = 0; i < scene.proxies.size(); i += 2) {
+        scene.bvh.DestroyProxy(scene.proxies[i]);
+    }
+    EXPECT_TRUE(scene.bvh.Validate());
+    EXPECT_EQ(scene.bvh.ProxyCount(), 500u);
+
+    // Freed nodes go back to the pool
+    uint32_t capacity = scene.bvh.Capacity();
+    for (int i = 0; i < 500; ++i) {
+        scene.bvh.CreateProxy(RandomBox(rng), 0);
+    }
+    EXPECT_EQ(scene.bvh.Capacity(), capacity);
+    EXPECT_TRUE(scene.bvh.Validate());
+}
+
+TEST(DynamicBvhTests, SmallMovesStayInFatBox) {
+    DynamicBvh bvh(0.5f);
+    uint32_t proxy = bvh.CreateProxy(Aabb{ Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 1.0f, 1.0f, 1.0f } }, 0);
+    bvh.CreateProxy(Aabb{ Vec3{ 5.0f, 0.0f, 0.0f }, Vec3{ 6.0f, 1.0f, 1.0f } }, 1);
+
+    EXPECT_FALSE(bvh.MoveProxy(proxy, Aabb{ Vec3{ 0.2f, 0.0f, 0.0f }, Vec3{ 1.2f, 1.0f, 1.0f } }));
+    EXPECT_FLOAT_EQ(bvh.TightBox(proxy).min.x, 0.2f);
+    EXPECT_TRUE(bvh.MoveProxy(proxy, Aabb{ Vec3{ 3.0f, 0.0f, 0.0f }, Vec3{ 4.0f, 1.0f, 1.0f } },
+                              Vec3{ 1.0f, 0.0f, 0.0f }));
+    // Stretched ahead along the displacement
+    EXPECT_GT(bvh.FatBox(proxy).max.x, 5.0f);
+    EXPECT_FLOAT_EQ(bvh.FatBox(proxy).min.x, 2.5f);
+    EXPECT_TRUE(bvh.Validate());
+}
+
+TEST(DynamicBvhTests, BoxQueryMatchesBruteForce) {
+    std::mt19937 rng(2);
+    Scene scene(2000, rng);
+    std::uniform_real_distribution<float> step(-2.0f, 2.0f);
+
+    for (int round = 0; round < 10; ++round) {
+        for (size_t i = 0; i < scene.proxies.size(); i += 3) {
+            Vec3 delta{ step(rng), step(rng), step(rng) };
+            scene.boxes[i] = Aabb{ scene.boxes[i].min + delta, scene.boxes[i].max + delta };
+            scene.bvh.MoveProxy(scene.proxies[i], scene.boxes[i], delta);
+        }
+        ASSERT_TRUE(scene.bvh.Validate());
+
+        Aabb query = RandomBox(rng);
+        query.max = query.max + Vec3{ 20.0f, 20.0f, 20.0f };
+        std::vector<uint32_t> expected;
+        for (size_t i = 0; i < scene.boxes.size(); ++i) {
+            if (Overlaps(scene.boxes[i], query)) expected.push_back(scene.proxies[i]);
+        }
+        std::vector<uint32_t> found;
+        scene.bvh.QueryBox(query, [&found](uint32_t proxy) {
+            found.push_back(proxy);
+            return true;
+        });
+        EXPECT_EQ(Sorted(found), Sorted(expected));
+    }
+}
+
+TEST(DynamicBvhTests, FrustumQueryMatchesBruteForce) {
+    std::mt19937 rng(3);
+    Scene scene(3000, rng);
+    Mat4 projection = Mat4Perspective(1.0f, 16.0f / 9.0f, 0.5f, 120.0f);
+
+    Frustum frustums[4];
+    for (int f = 0; f < 4; ++f) {
+        Vec3 target{ float(f) * 20.0f - 30.0f, 0.0f, 0.0f };
+        frustums[f] = FrustumFromMatrix(projection * Mat4LookAt(Vec3{ 0.0f, 10.0f, 80.0f }, target,
+                                                                Vec3{ 0.0f, 1.0f, 0.0f }));
+    }
+
+    JobSystem jobs;
+    jobs.Init(2);
+    DynamicArray<uint32_t> results[4];
+    scene.bvh.QueryFrustums(frustums, results, 4, &jobs);
+    jobs.Shutdown();
+
+    for (int f = 0; f < 4; ++f) {
+        std::vector<uint32_t> expected;
+        for (size_t i = 0; i < scene.boxes.size(); ++i) {
+            if (Classify(frustums[f], scene.boxes[i]) != Containment::Outside) expected.push_back(scene.proxies[i]);
+        }
+        std::vector<uint32_t> found(results[f].Data(), results[f].Data() + results[f].Size());
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(Sorted(found), Sorted(expected));
+    }
+}
+
+TEST(DynamicBvhTests, RayCastFindsClosestHit) {
+    std::mt19937 rng(4);
+    Scene scene(2000, rng);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<Ray> rays;
+    for (int r = 0; r < 200; ++r) {
+        Vec3 direction = Normalize(Vec3{ unit(rng), unit(rng), unit(rng) });
+        rays.push_back(Ray{ Vec3{ unit(rng) * 50.0f, unit(rng) * 50.0f, unit(rng) * 50.0f }, direction, 300.0f });
+    }
+    // Axis-aligned rays exercise the infinite reciprocal components
+    rays.push_back(Ray{ Vec3{ -150.0f, 0.5f, 0.5f }, Vec3{ 1.0f, 0.0f, 0.0f }, 300.0f });
+
+    std::vector<RayHit> hits(rays.size());
+    JobSystem jobs;
+    jobs.Init(2);
+    scene.bvh.RayCastBatch(rays.data(), hits.data(), rays.size(), &jobs);
+    jobs.Shutdown();
+
+    size_t hit_count = 0;
+    for (size_t r = 0; r < rays.size(); ++r) {
+        Vec3 inverse = InverseDirection(rays[r].direction);
+        float best = rays[r].max_distance;
+        bool any = false;
+        for (const Aabb& box : scene.boxes) {
+            float distance = RayIntersect(box, rays[r].origin, inverse, rays[r].max_distance);
+            if (distance >= 0.0f && distance <= best) {
+                best = distance;
+                any = true;
+            }
+        }
+        if (!any) {
+            EXPECT_EQ(hits[r].proxy, kNullProxy);
+            continue;
+        }
+        ++hit_count;
+        ASSERT_NE(hits[r].proxy, kNullProxy);
+        EXPECT_FLOAT_EQ(hits[r].distance, best);
+    }
+    EXPECT_GT(hit_count, 0u);
+}
+
+TEST(DynamicBvhTests, KNearestMatchesBruteForce) {
+    std::mt19937 rng(5);
+    Scene scene(2000, rng);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    for (int q = 0; q < 50; ++q) {
+        Vec3 point{ unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f };
+        std::vector<float> expected;
+        for (const Aabb& box : scene.boxes) expected.push_back(DistanceSquared(box, point));
+        std::sort(expected.begin(), expected.end());
+
+        uint32_t proxies[16];
+        float distances[16];
+        uint32_t found = scene.bvh.KNearest(point, 16, proxies, distances);
+        ASSERT_EQ(found, 16u);
+        for (uint32_t i = 0; i < found; ++i) {
+            EXPECT_FLOAT_EQ(distances[i], expected[i]);
+            EXPECT_FLOAT_EQ(DistanceSquared(scene.bvh.TightBox(proxies[i]), point), distances[i]);
+        }
+    }
+
+    DynamicBvh small;
+    small.CreateProxy(Aabb{ Vec3{ 0.0f, 0.0f, 0.0f }, Vec3{ 1.0f, 1.0f, 1.0f } }, 0);
+    uint32_t proxy;
+    float distance;
+    EXPECT_EQ(small.KNearest(Vec3{ 0.5f, 0.5f, 0.5f }, 1, &proxy, &distance), 1u);
+    EXPECT_EQ(distance, 0.0f);
+}
@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+#include "job_system.h"
+#include "transform_hierarchy.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace toybox::scene;
+using namespace toybox::math;
+using toybox::utils::jobs::JobSystem;
+
+static Transform Offset(float x, float y, float z) {
+    Transform local = TransformIdentity();
+    local.position = Vec3{ x, y, z };
+    return local;
+}
+
+static Transform RandomLocal(std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    Transform local;
+    local.position = Vec3{ unit(rng) * 10.0f, unit(rng) * 10.0f, unit(rng) * 10.0f };
+    local.rotation = QuatFromAxisAngle(Normalize(Vec3{ unit(rng), unit(rng), unit(rng) + 2.0f }), unit(rng));
+    local.scale = Vec3{ 1.0f, 1.0f, 1.0f };
+    return local;
+}
+
+// World matrix computed the slow way, walking up the parent chain
+static Mat4 ReferenceWorld(const TransformHierarchy& hierarchy, SceneNode node) {
+    const Transform& local = hierarchy.Local(node);
+    Mat4 matrix = Mat4Compose(local.position, local.rotation, local.scale);
+    SceneNode parent = hierarchy.Parent(node);
+    return parent == kNoNode ? matrix : Multiply(ReferenceWorld(hierarchy, parent), matrix);
+}
+
+static bool SameMatrix(const Mat4& a, const Mat4& b) {
+    return memcmp(a.m, b.m, sizeof(a.m)) == 0;
+}
+
+// Random forest where each node hangs below an earlier one
+static std::vector<SceneNode> BuildRandomTree(TransformHierarchy& hierarchy, size_t count, std::mt19937& rng) {
+    std::vector<SceneNode> nodes;
+    for (size_t i = 0; i < count; ++i) {
+        SceneNode parent = kNoNode;
+        if (i > 0 && rng() % 8 != 0) parent = nodes[rng() % i];
+        nodes.push_back(hierarchy.Create(parent, RandomLocal(rng)));
+    }
+    return nodes;
+}
+
+TEST(SceneTests, WorldIsParentTimesLocal) {
+    TransformHierarchy hierarchy;
+    SceneNode root = hierarchy.Create(kNoNode, Offset(1.0f, 0.0f, 0.0f));
+    SceneNode child = hierarchy.Create(root, Offset(0.0f, 2.0f, 0.0f));
+    SceneNode grandchild = hierarchy.Create(child, Offset(0.0f, 0.0f, 3.0f));
+    hierarchy.Update();
+
+    Vec3 position = Translation(hierarchy.World(grandchild));
+    EXPECT_FLOAT_EQ(position.x, 1.0f);
+    EXPECT_FLOAT_EQ(position.y, 2.0f);
+    EXPECT_FLOAT_EQ(position.z, 3.0f);
+    EXPECT_EQ(hierarchy.LevelCount(), 3u);
+    EXPECT_EQ(hierarchy.Count(), 3u);
+    EXPECT_EQ(hierarchy.Parent(grandchild), child);
+}
+
+TEST(SceneTests, OnlyDirtySubtreesAreRecomputed) {
+    TransformHierarchy hierarchy;
+    SceneNode left = hierarchy.Create();
+    SceneNode right = hierarchy.Create();
+    SceneNode left_child = hierarchy.Create(left);
+    hierarchy.Create(left_child);
+    hierarchy.Create(right);
+    hierarchy.Update();
+    EXPECT_EQ(hierarchy.LastUpdatedCount(), 5u);
+
+    hierarchy.Update();
+    EXPECT_EQ(hierarchy.LastUpdatedCount(), 0u);
+
+    hierarchy.SetLocal(left_child, Offset(5.0f, 0.0f, 0.0f));
+    hierarchy.Update();
+    EXPECT_EQ(hierarchy.LastUpdatedCount(), 2u);
+
+    hierarchy.SetLocal(left, Offset(1.0f, 0.0f, 0.0f));
+    hierarchy.SetLocal(left_child, Offset(2.0f, 0.0f, 0.0f));
+    hierarchy.Update();
+    EXPECT_EQ(hierarchy.LastUpdatedCount(), 3u);
+    EXPECT_FLOAT_EQ(Translation(hierarchy.World(left_child)).x, 3.0f);
+
+    hierarchy.MarkAllDirty();
+    hierarchy.Update();
+    EXPECT_EQ(hierarchy.LastUpdatedCount(), 5u);
+}
+
+TEST(SceneTests, ReparentingMovesTheSubtree) {
+    TransformHierarchy hierarchy;
+    SceneNode a = hierarchy.Create(kNoNode, Offset(10.0f, 0.0f, 0.0f));
+    SceneNode b = hierarchy.Create(kNoNode, Offset(0.0f, 20.0f, 0.0f));
+    SceneNode child = hierarchy.Create(a, Offset(1.0f, 0.0f, 0.0f));
+    SceneNode leaf = hierarchy.Create(child, Offset(0.0f, 0.0f, 1.0f));
+    hierarchy.Update();
+    EXPECT_FLOAT_EQ(Translation(hierarchy.World(leaf)).x, 11.0f);
+
+    EXPECT_TRUE(hierarchy.SetParent(child, b));
+    hierarchy.Update();
+    Vec3 position = Translation(hierarchy.World(leaf));
+    EXPECT_FLOAT_EQ(position.x, 1.0f);
+    EXPECT_FLOAT_EQ(position.y, 20.0f);
+    EXPECT_FLOAT_EQ(position.z, 1.0f);
+    EXPECT_EQ(hierarchy.Parent(child), b);
+
+    EXPECT_TRUE(hierarchy.SetParent(child, kNoNode));
+    hierarchy.Update();
+    EXPECT_FLOAT_EQ(Translation(hierarchy.World(leaf)).y, 0.0f);
+    EXPECT_EQ(hierarchy.LevelCount(), 2u);
+}
+
+TEST(SceneTests, RejectsCycles) {
+    TransformHierarchy hierarchy;
+    SceneNode root = hierarchy.Create();
+    SceneNode child = hierarchy.Create(root);
+    SceneNode grandchild = hierarchy.Create(child);
+
+    EXPECT_FALSE(hierarchy.SetParent(root, grandchild));
+    EXPECT_FALSE(hierarchy.SetParent(child, child));
+    EXPECT_EQ(hierarchy.Parent(root), kNoNode);
+    hierarchy.Update();
+    EXPECT_EQ(hierarchy.LevelCount(), 3u);
+}
+
+TEST(SceneTests, DestroyRemovesSubtreeAndReusesHandles) {
+    TransformHierarchy hierarchy;
+    SceneNode root = hierarchy.Create();
+    SceneNode doomed = hierarchy.Create(root);
+    SceneNode doomed_child = hierarchy.Create(doomed);
+    SceneNode survivor = hierarchy.Create(root, Offset(0.0f, 4.0f, 0.0f));
+    hierarchy.Update();
+
+    hierarchy.Destroy(doomed);
+    EXPECT_FALSE(hierarchy.Alive(doomed));
+    EXPECT_FALSE(hierarchy.Alive(doomed_child));
+    EXPECT_TRUE(hierarchy.Alive(survivor));
+    EXPECT_EQ(hierarchy.Count(), 2u);
+
+    SceneNode reused = hierarchy.Create(survivor, Offset(1.0f, 0.0f, 0.0f));
+    EXPECT_EQ(reused.index == doomed.index || reused.index == doomed_child.index, true);
+    EXPECT_FALSE(hierarchy.Alive(doomed));
+    EXPECT_FALSE(hierarchy.Alive(doomed_child));
+
+    hierarchy.Update();
+    Vec3 position = Translation(hierarchy.World(reused));
+    EXPECT_FLOAT_EQ(position.x, 1.0f);
+    EXPECT_FLOAT_EQ(position.y, 4.0f);
+    EXPECT_EQ(hierarchy.Count(), 3u);
+}
+
+TEST(SceneTests, RandomEditsMatchReference) {
+    std::mt19937 rng(11);
+    TransformHierarchy hierarchy;
+    std::vector<SceneNode> nodes = BuildRandomTree(hierarchy, 500, rng);
+
+    for (int round = 0; round < 20; ++round) {
+        for (int edit = 0; edit < 25; ++edit) {
+            SceneNode node = nodes[rng() % nodes.size()];
+            if (!hierarchy.Alive(node)) continue;
+            switch (rng() % 10) {
+            case 0:
+                hierarchy.SetParent(node, nodes[rng() % nodes.size()]);
+                break;
+            case 1:
+                if (rng() % 4 == 0) hierarchy.Destroy(node);
+                break;
+            case 2:
+                nodes.push_back(hierarchy.Create(node, RandomLocal(rng)));
+                break;
+            default:
+                hierarchy.SetLocal(node, RandomLocal(rng));
+                break;
+            }
+        }
+        hierarchy.Update();
+
+        for (SceneNode node : nodes) {
+            if (!hierarchy.Alive(node)) continue;
+            ASSERT_TRUE(SameMatrix(hierarchy.World(node), ReferenceWorld(hierarchy, node)))
+                << "round " << round << ", node " << node.index;
+        }
+    }
+}
+
+TEST(SceneTests, ParallelUpdateMatchesSerial) {
+    JobSystem jobs;
+    jobs.Init(3);
+
+    std::mt19937 rng(5);
+    TransformHierarchy serial;
+    TransformHierarchy parallel;
+    std::vector<SceneNode> serial_nodes;
+    std::vector<SceneNode> parallel_nodes;
+    // Wide and shallow, so levels cross the parallel threshold
+    for (size_t i = 0; i < 20000; ++i) {
+        size_t parent_index = i < 16 ? SIZE_MAX : rng() % (i < 2000 ? i : 2000);
+        Transform local = RandomLocal(rng);
+        serial_nodes.push_back(serial.Create(parent_index == SIZE_MAX ? kNoNode : serial_nodes[parent_index], local));
+        parallel_nodes.push_back(
+            parallel.Create(parent_index == SIZE_MAX ? kNoNode : parallel_nodes[parent_index], local));
+    }
+    serial.Update();
+    parallel.Update(&jobs);
+
+    for (int round = 0; round < 3; ++round) {
+        for (int edit = 0; edit < 500; ++edit) {
+            size_t index = rng() % serial_nodes.size();
+            Transform local = RandomLocal(rng);
+            serial.SetLocal(serial_nodes[index], local);
+            parallel.SetLocal(parallel_nodes[index], local);
+        }
+        serial.Update();
+        parallel.Update(&jobs);
+        EXPECT_EQ(serial.LastUpdatedCount(), parallel.LastUpdatedCount());
+        for (size_t i = 0; i < serial_nodes.size(); ++i) {
+            ASSERT_TRUE(SameMatrix(serial.World(serial_nodes[i]), parallel.World(parallel_nodes[i])));
+        }
+    }
+
+    jobs.Shutdown();
+}
@@ -0,0 +1,232 @@
+#include <gtest/gtest.h>
+#include "job_system.h"
+#include "spatial_hash_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace toybox::scene;
+using toybox::utils::jobs::JobSystem;
+
+struct Points {
+    std::vector<float> x;
+    std::vector<float> y;
+
+    Points(size_t count, float extent, std::mt19937& rng) {
+        std::uniform_real_distribution<float> position(-extent, extent);
+        for (size_t i = 0; i < count; ++i) {
+            x.push_back(position(rng));
+            y.push_back(position(rng));
+        }
+    }
+};
+
+static std::vector<uint32_t> Sorted(std::vector<uint32_t> values) {
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+TEST(SpatialHashGridTests, RadiusQueryMatchesBruteForce) {
+    std::mt19937 rng(1);
+    Points points(5000, 100.0f, rng);
+    SpatialHashGrid grid(4.0f);
+    grid.Build(points.x.data(), points.y.data(), uint32_t(points.x.size()));
+    EXPECT_EQ(grid.Count(), 5000u);
+
+    std::uniform_real_distribution<float> position(-110.0f, 110.0f);
+    std::uniform_real_distribution<float> radius(0.0f, 15.0f);
+    for (int q = 0; q < 200; ++q) {
+        float qx = position(rng);
+        float qy = position(rng);
+        float r = radius(rng);
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < points.x.size(); ++i) {
+            float dx = points.x[i] - qx;
+            float dy = points.y[i] - qy;
+            if (dx * dx + dy * dy <= r * r) expected.push_back(i);
+        }
+        std::vector<uint32_t> found;
+        grid.QueryRadius(qx, qy, r, [&found](uint32_t id) {
+            found.push_back(id);
+            return true;
+        });
+        EXPECT_EQ(Sorted(found), expected);
+    }
+}
+
+TEST(SpatialHashGridTests, BoxQueryMatchesBruteForce) {
+    std::mt19937 rng(2);
+    Points points(5000, 50.0f, rng);
+    // Small cells force many hash collisions
+    SpatialHashGrid grid(0.5f);
+    grid.Build(points.x.data(), points.y.data(), uint32_t(points.x.size()));
+
+    std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> size(0.0f, 20.0f);
+    for (int q = 0; q < 200; ++q) {
+        float min_x = position(rng);
+        float min_y = position(rng);
+        float max_x = min_x + size(rng);
+        float max_y = min_y + size(rng);
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < points.x.size(); ++i) {
+            if (points.x[i] >= min_x && points.x[i] <= max_x && points.y[i] >= min_y && points.y[i] <= max_y) {
+                expected.push_back(i);
+            }
+        }
+        std::vector<uint32_t> found;
+        grid.QueryBox(min_x, min_y, max_x, max_y, [&found](uint32_t id) {
+            found.push_back(id);
+            return true;
+        });
+        EXPECT_EQ(Sorted(found), expected);
+    }
+}
+
+TEST(SpatialHashGridTests, PairsMatchBruteForce) {
+    std::mt19937 rng(4);
+    Points points(3000, 40.0f, rng);
+    // Cells both larger and much smaller than the radius
+    for (float cell_size : { 4.0f, 0.5f }) {
+        SpatialHashGrid grid(cell_size);
+        grid.Build(points.x.data(), points.y.data(), uint32_t(points.x.size()));
+
+        const float radius = 3.0f;
+        std::vector<std::pair<uint32_t, uint32_t>> expected;
+        for (uint32_t i = 0; i < points.x.size(); ++i) {
+            for (uint32_t j = i + 1; j < points.x.size(); ++j) {
+                float dx = points.x[j] - points.x[i];
+                float dy = points.y[j] - points.y[i];
+                if (dx * dx + dy * dy <= radius * radius) expected.push_back({ i, j });
+            }
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> found;
+        grid.ForEachPair(radius, [&found](uint32_t a, uint32_t b) {
+            found.push_back({ std::min(a, b), std::max(a, b) });
+        });
+        std::sort(found.begin(), found.end());
+        EXPECT_EQ(found, expected);
+    }
+}
+
+TEST(SpatialHashGridTests, QueriesStopEarly) {
+    float x[] = { 0.5f, 0.6f, 0.7f };
+    float y[] = { 0.5f, 0.5f, 0.5f };
+    SpatialHashGrid grid;
+    grid.Build(x, y, 3);
+
+    int visits = 0;
+    grid.QueryRadius(0.5f, 0.5f, 2.0f, [&visits](uint32_t) {
+        ++visits;
+        return false;
+    });
+    EXPECT_EQ(visits, 1);
+}
+
+TEST(SpatialHashGridTests, TraceCellsWalksEveryCrossedCell) {
+    SpatialHashGrid grid(1.0f);
+
+    std::vector<std::pair<int32_t, int32_t>> cells;
+    auto record = [&cells](int32_t cx, int32_t cy) {
+        cells.push_back({ cx, cy });
+        return true;
+    };
+
+    EXPECT_TRUE(grid.TraceCells(0.5f, 0.5f, 3.5f, 0.5f, record));
+    std::vector<std::pair<int32_t, int32_t>> straight = { { 0, 0 }, { 1, 0 }, { 2, 0 }, { 3, 0 } };
+    EXPECT_EQ(cells, straight);
+
+    cells.clear();
+    grid.TraceCells(0.5f, 0.5f, -1.5f, 2.5f, record);
+    ASSERT_EQ(cells.size(), 5u);
+    EXPECT_EQ(cells.front(), std::make_pair(0, 0));
+    EXPECT_EQ(cells.back(), std::make_pair(-2, 2));
+    // Neighbouring cells in the walk share an edge
+    for (size_t i = 1; i < cells.size(); ++i) {
+        int step = std::abs(cells[i].first - cells[i - 1].first) + std::abs(cells[i].second - cells[i - 1].second);
+        EXPECT_EQ(step, 1);
+    }
+
+    // A wall tile blocks sight
+    bool visible = grid.TraceCells(0.5f, 0.5f, 5.5f, 0.5f, [](int32_t cx, int32_t) { return cx != 3; });
+    EXPECT_FALSE(visible);
+}
+
+TEST(SpatialHashGridTests, LineQueryVisitsPointsInOrder) {
+    float x[] = { 8.5f, 2.5f, 5.5f, 5.5f };
+    float y[] = { 0.5f, 0.5f, 0.5f, 4.5f };
+    SpatialHashGrid grid(1.0f);
+    grid.Build(x, y, 4);
+
+    std::vector<uint32_t> found;
+    grid.QueryLine(0.5f, 0.5f, 9.5f, 0.5f, [&found](uint32_t id) {
+        found.push_back(id);
+        return true;
+    });
+    std::vector<uint32_t> expected = { 1, 2, 0 };
+    EXPECT_EQ(found, expected);
+
+    // First blocker along the line
+    uint32_t first = 0xFFFFFFFF;
+    grid.QueryLine(9.5f, 0.5f, 0.5f, 0.5f, [&first](uint32_t id) {
+        first = id;
+        return false;
+    });
+    EXPECT_EQ(first, 0u);
+}
+
+TEST(SpatialHashGridTests, ParallelBuildMatchesSerial) {
+    std::mt19937 rng(3);
+    Points points(50000, 500.0f, rng);
+    SpatialHashGrid serial(2.0f);
+    SpatialHashGrid parallel(2.0f);
+    serial.Build(points.x.data(), points.y.data(), uint32_t(points.x.size()));
+
+    JobSystem jobs;
+    jobs.Init(3);
+    parallel.Build(points.x.data(), points.y.data(), uint32_t(points.x.size()), &jobs);
+    jobs.Shutdown();
+
+    for (int q = 0; q < 50; ++q) {
+        float qx = points.x[q * 100];
+        float qy = points.y[q * 100];
+        std::vector<uint32_t> a;
+        std::vector<uint32_t> b;
+        serial.QueryRadius(qx, qy, 10.0f, [&a](uint32_t id) {
+            a.push_back(id);
+            return true;
+        });
+        parallel.QueryRadius(qx, qy, 10.0f, [&b](uint32_t id) {
+            b.push_back(id);
+            return true;
+        });
+        // Same order too, not just the same set
+        EXPECT_EQ(a, b);
+        EXPECT_FALSE(a.empty());
+    }
+}
+
+TEST(SpatialHashGridTests, RebuildReplacesContents) {
+    float x[] = { 0.5f, 10.5f };
+    float y[] = { 0.5f, 10.5f };
+    SpatialHashGrid grid;
+    grid.Build(x, y, 2);
+    grid.Build(x + 1, y + 1, 1);
+    EXPECT_EQ(grid.Count(), 1u);
+
+    int found = 0;
+    grid.QueryRadius(0.5f, 0.5f, 1.0f, [&found](uint32_t) {
+        ++found;
+        return true;
+    });
+    EXPECT_EQ(found, 0);
+    grid.QueryRadius(10.5f, 10.5f, 1.0f, [&found](uint32_t id) {
+        EXPECT_EQ(id, 0u);
+        ++found;
+        return true;
+    });
+    EXPECT_EQ(found, 1);
+}
@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+#include "scripting_integration.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace toybox::scripting;
+
+static std::string CachePath(const char* name) {
+    std::string path = ::testing::TempDir() + name;
+    std::remove(path.c_str());
+    return path;
+}
+
+static const char* kEnemy = "fn damage(health, amount) { return health - amount * 2; }";
+static const char* kPlayer = "fn heal(health) { return health + 10; }";
+
+static Script Load(ScriptingSystem& system, const char* name, const char* source) {
+    return system.Load(name, source, strlen(source));
+}
+
+static double CallScript(ScriptingSystem& system, Script script, const char* function, double a, double b) {
+    Value arguments[2] = { NumberValue(a), NumberValue(b) };
+    Value result = NilValue();
+    EXPECT_TRUE(system.Call(script, function, arguments, 2, &result)) << system.Error();
+    return result.number;
+}
+
+TEST(BytecodeCacheTests, SecondRunSkipsTheCompiler) {
+    std::string path = CachePath("scripts_warm.ebc");
+    {
+        ScriptingSystem first;
+        EXPECT_FALSE(first.OpenCache(path.c_str()));
+        Load(first, "enemy", kEnemy);
+        Load(first, "player", kPlayer);
+        EXPECT_EQ(first.LoadStats().compiled, 2u);
+        ASSERT_TRUE(first.SaveCache());
+    }
+
+    ScriptingSystem second;
+    ASSERT_TRUE(second.OpenCache(path.c_str()));
+    Script enemy = Load(second, "enemy", kEnemy);
+    Script player = Load(second, "player", kPlayer);
+    EXPECT_EQ(second.LoadStats().compiled, 0u);
+    EXPECT_EQ(second.LoadStats().from_cache, 2u);
+    EXPECT_EQ(CallScript(second, enemy, "damage", 100, 15), 70.0);
+    EXPECT_EQ(CallScript(second, player, "heal", 5, 0), 15.0);
+
+    // Nothing new was compiled, so there is nothing to write
+    EXPECT_TRUE(second.SaveCache());
+}
+
+TEST(BytecodeCacheTests, EditedScriptsAreRecompiled) {
+    std::string path = CachePath("scripts_stale.ebc");
+    {
+        ScriptingSystem first;
+        first.OpenCache(path.c_str());
+        Load(first, "enemy", kEnemy);
+        Load(first, "player", kPlayer);
+        first.SaveCache();
+    }
+
+    const char* edited = "fn damage(health, amount) { return health - amount; }";
+    {
+        ScriptingSystem second;
+        ASSERT_TRUE(second.OpenCache(path.c_str()));
+        Script enemy = Load(second, "enemy", edited);
+        Load(second, "player", kPlayer);
+        EXPECT_EQ(second.LoadStats().stale, 1u);
+        EXPECT_EQ(second.LoadStats().compiled, 1u);
+        EXPECT_EQ(second.LoadStats().from_cache, 1u);
+        EXPECT_EQ(CallScript(second, enemy, "damage", 100, 15), 85.0);
+        ASSERT_TRUE(second.SaveCache());
+    }
+
+    // The rewrite kept the untouched entry and replaced the edited one
+    ScriptingSystem third;
+    ASSERT_TRUE(third.OpenCache(path.c_str()));
+    Script enemy = Load(third, "enemy", edited);
+    Load(third, "player", kPlayer);
+    EXPECT_EQ(third.LoadStats().from_cache, 2u);
+    EXPECT_EQ(CallScript(third, enemy, "damage", 100, 15), 85.0);
+}
+
+TEST(BytecodeCacheTests, DamagedOrForeignCachesAreIgnored) {
+    std::string path = CachePath("scripts_bad.ebc");
+    {
+        ScriptingSystem first;
+        first.OpenCache(path.c_str());
+        Load(first, "enemy", kEnemy);
+        first.SaveCache();
+    }
+    BytecodeCache cache(kBytecodeVersion);
+    ASSERT_TRUE(cache.Open(path.c_str()));
+    EXPECT_EQ(cache.EntryCount(), 1u);
+    cache.Close();
+
+    // Another bytecode version
+    FILE* file = fopen(path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    CacheHeader header;
+    ASSERT_EQ(fread(&header, sizeof(header), 1, file), 1u);
+    header.bytecode_version = kBytecodeVersion + 1;
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+    EXPECT_FALSE(cache.Open(path.c_str()));
+
+    // Truncated
+    header.bytecode_version = kBytecodeVersion;
+    file = fopen(path.c_str(), "wb");
+    fwrite(&header, sizeof(header), 1, file);
+    fclose(file);
+    EXPECT_FALSE(cache.Open(path.c_str()));
+
+    // Still loads, from source
+    ScriptingSystem system;
+    EXPECT_FALSE(system.OpenCache(path.c_str()));
+    Script enemy = Load(system, "enemy", kEnemy);
+    EXPECT_EQ(system.LoadStats().compiled, 1u);
+    EXPECT_EQ(CallScript(system, enemy, "damage", 10, 1), 8.0);
+}
+
+TEST(BytecodeCacheTests, ProgramsRejectBadBlobs) {
+    toybox::utils::data_structures::DynamicArray<uint8_t> blob;
+    CompileError error;
+    ASSERT_TRUE(CompileScript(kEnemy, strlen(kEnemy), &blob, &error));
+    ScriptProgram program;
+    ASSERT_TRUE(program.Bind(blob.Data(), blob.Size()));
+    EXPECT_EQ(program.FunctionCount(), 1u);
+    EXPECT_STREQ(program.FunctionName(0), "damage");
+    EXPECT_FALSE(program.Bind(blob.Data(), blob.Size() - 8));
+
+    ProgramHeader* header = reinterpret_cast<ProgramHeader*>(blob.Data());
+    header->code_size = 0xFFFFFFF0u;
+    EXPECT_FALSE(program.Bind(blob.Data(), blob.Size()));
+    EXPECT_FALSE(program.Valid());
+}
+
+TEST(BytecodeCacheTests, ProgramsOutliveLaterStores) {
+    ScriptingSystem system;
+    system.OpenCache(CachePath("scripts_reload.ebc").c_str());
+    Load(system, "a", kEnemy);
+    // Found among the programs stored this run
+    Script a = Load(system, "a", kEnemy);
+    ASSERT_NE(a, kNoScript) << system.Error();
+    EXPECT_EQ(system.LoadStats().from_cache, 1u);
+
+    // Each store may move the blobs stored before it
+    for (int i = 0; i < 40; ++i) {
+        std::string name = "other_" + std::to_string(i);
+        ASSERT_NE(Load(system, name.c_str(), kPlayer), kNoScript) << system.Error();
+    }
+    Load(system, "a", "fn damage(health, amount) { return health - amount; }");
+    EXPECT_EQ(system.LoadStats().compiled, 42u);
+    EXPECT_EQ(CallScript(system, a, "damage", 100, 15), 70.0);
+}
+
+TEST(BytecodeCacheTests, BadBytecodeIsRejected) {
+    toybox::utils::data_structures::DynamicArray<uint8_t> blob;
+    CompileError error;
+    const char* source = "fn pick(x) { if (x) { return 1; } return x * 2; }";
+    ASSERT_TRUE(CompileScript(source, strlen(source), &blob, &error));
+    ScriptProgram program;
+    ASSERT_TRUE(program.Bind(blob.Data(), blob.Size()));
+    uint8_t* code = blob.Data() + (program.Code() - blob.Data());
+    FunctionInfo* info = reinterpret_cast<FunctionInfo*>(blob.Data() + (reinterpret_cast<const uint8_t*>(
+                                                                             &program.Function(0)) - blob.Data()));
+    // GetLocal 0, JumpIfFalse, Pop, Constant 0, Return, Jump, Pop, GetLocal 0, Constant 1, Multiply, Return
+    ASSERT_EQ(code[0], uint8_t(Op::GetLocal));
+    ASSERT_EQ(code[2], uint8_t(Op::JumpIfFalse));
+    ASSERT_EQ(code[6], uint8_t(Op::Constant));
+    ASSERT_EQ(code[9], uint8_t(Op::Return));
+    ASSERT_EQ(info->max_stack, 3u);
+
+    auto binds_with = [&](uint8_t* at, uint8_t value) {
+        uint8_t was = *at;
+        *at = value;
+        bool bound = program.Bind(blob.Data(), blob.Size());
+        *at = was;
+        return bound;
+    };
+    EXPECT_FALSE(binds_with(&code[1], 1));                    // Local slot past the locals
+    EXPECT_FALSE(binds_with(&code[7], 2));                    // Constant past the pool
+    EXPECT_FALSE(binds_with(&code[3], 0xF0));                 // Jump past the end
+    EXPECT_FALSE(binds_with(&code[3], 2));                    // Jump into an operand
+    EXPECT_FALSE(binds_with(&code[9], uint8_t(Op::Nil)));     // Paths meet at different depths
+    EXPECT_FALSE(binds_with(&code[5], uint8_t(Op::Nil)));     // Pushes past max_stack
+    EXPECT_FALSE(binds_with(&code[0], uint8_t(Op::Pop)));     // Pops a local
+    EXPECT_FALSE(binds_with(&code[0], 0xEE));                 // No such opcode
+    EXPECT_FALSE(binds_with(reinterpret_cast<uint8_t*>(&info->max_stack), 2));
+    EXPECT_TRUE(program.Bind(blob.Data(), blob.Size()));
+
+    // The Jump at 10 turned into a Loop: it has to land on an instruction at
+    // or before itself, not on the Pop that JumpIfFalse already reached
+    ASSERT_EQ(code[10], uint8_t(Op::Jump));
+    auto binds_with_loop = [&](uint16_t distance) {
+        uint8_t was[3] = { code[10], code[11], code[12] };
+        code[10] = uint8_t(Op::Loop);
+        code[11] = uint8_t(distance & 0xff);
+        code[12] = uint8_t(distance >> 8);
+        bool bound = program.Bind(blob.Data(), blob.Size());
+        memcpy(&code[10], was, sizeof(was));
+        return bound;
+    };
+    EXPECT_FALSE(binds_with_loop(0));  // Forward onto the next instruction
+    EXPECT_FALSE(binds_with_loop(1));  // Into its own operand
+    EXPECT_FALSE(binds_with_loop(6));  // Into the Constant's operand
+    EXPECT_FALSE(binds_with_loop(14)); // Before the code starts
+    EXPECT_TRUE(binds_with_loop(7));   // Back onto the Constant
+    EXPECT_TRUE(program.Bind(blob.Data(), blob.Size()));
+}
+
+TEST(BytecodeCacheTests, CachedBlobsThatFailToBindAreRecompiled) {
+    std::string path = CachePath("scripts_tampered.ebc");
+    {
+        ScriptingSystem first;
+        first.OpenCache(path.c_str());
+        Load(first, "enemy", kEnemy);
+        ASSERT_TRUE(first.SaveCache());
+    }
+
+    // The source hash still matches, but the bytecode reads a local the
+    // function does not have
+    toybox::utils::data_structures::DynamicArray<uint8_t> blob;
+    CompileError error;
+    ASSERT_TRUE(CompileScript(kEnemy, strlen(kEnemy), &blob, &error));
+    ScriptProgram program;
+    ASSERT_TRUE(program.Bind(blob.Data(), blob.Size()));
+    size_t code_at = size_t(program.Code() - blob.Data());
+    ASSERT_EQ(blob.Data()[code_at], uint8_t(Op::GetLocal));
+
+    FILE* file = fopen(path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    std::string bytes;
+    char buffer[4096];
+    for (size_t read; (read = fread(buffer, 1, sizeof(buffer), file)) > 0;) bytes.append(buffer, read);
+    size_t at = bytes.find(std::string(reinterpret_cast<const char*>(blob.Data()), blob.Size()));
+    ASSERT_NE(at, std::string::npos);
+    fseek(file, long(at + code_at + 1), SEEK_SET);
+    fputc(200, file);
+    fclose(file);
+
+    ScriptingSystem system;
+    EXPECT_TRUE(system.OpenCache(path.c_str()));
+    Script enemy = Load(system, "enemy", kEnemy);
+    ASSERT_NE(enemy, kNoScript) << system.Error();
+    EXPECT_EQ(system.LoadStats().from_cache, 0u);
+    EXPECT_EQ(system.LoadStats().compiled, 1u);
+    EXPECT_EQ(CallScript(system, enemy, "damage", 100, 15), 70.0);
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "file_io.h"
+#include "scripting_integration.h"
+
+#include <cstring>
+#include <string>
+
+using namespace toybox::scripting;
+
+static const char* kSource = "fn fib(n) {\n"
+                             "    if (n < 2) { return n; }\n"
+                             "    return fib(n - 1) + fib(n - 2);\n"
+                             "}\n"
+                             "fn spin(n) {\n"
+                             "    let i = 0;\n"
+                             "    while (i < n) { i = i + 1; }\n"
+                             "    return i;\n"
+                             "}\n"
+                             "fn main(n) { return fib(n) + spin(n * 100); }\n"
+                             "fn busy(n) {\n"
+                             "    let total = 0;\n"
+                             "    while (n > 0) { total = total + spin(100); n = n - 1; }\n"
+                             "    return total;\n"
+                             "}\n"
+                             "fn broken(n) { if (n == 0) { return nil + 1; } return broken(n - 1); }\n";
+
+static const FunctionProfile* FindProfile(const ScriptProfiler& profiler, const char* name) {
+    for (uint32_t i = 0; i < profiler.FunctionCount(); ++i) {
+        if (strcmp(profiler.Function(i).name.CStr(), name) == 0) return &profiler.Function(i);
+    }
+    return nullptr;
+}
+
+static double CallScript(ScriptingSystem& system, Script script, const char* function, double n) {
+    Value argument = NumberValue(n);
+    Value result = NilValue();
+    EXPECT_TRUE(system.Call(script, function, &argument, 1, &result)) << system.Error();
+    return result.number;
+}
+
+TEST(ScriptProfilerTests, OffRecordsNothing) {
+    ScriptingSystem system;
+    Script script = system.Load("game", kSource, strlen(kSource));
+    ASSERT_NE(script, kNoScript) << system.Error();
+    EXPECT_EQ(system.Profiler().Mode(), ProfileMode::Off);
+    EXPECT_EQ(CallScript(system, script, "main", 10), 55.0 + 1000.0);
+    EXPECT_EQ(system.Profiler().FunctionCount(), 0u);
+}
+
+TEST(ScriptProfilerTests, InstrumentCountsAndTimesCalls) {
+    ScriptingSystem system;
+    Script script = system.Load("game", kSource, strlen(kSource));
+    ScriptProfiler& profiler = system.Profiler();
+    profiler.SetMode(ProfileMode::Instrument);
+    EXPECT_EQ(CallScript(system, script, "main", 10), 55.0 + 1000.0);
+    EXPECT_EQ(CallScript(system, script, "main", 10), 55.0 + 1000.0);
+
+    const FunctionProfile* main = FindProfile(profiler, "game:main");
+    const FunctionProfile* fib = FindProfile(profiler, "game:fib");
+    const FunctionProfile* spin = FindProfile(profiler, "game:spin");
+    ASSERT_TRUE(main && fib && spin);
+    EXPECT_EQ(main->calls, 2u);
+    EXPECT_EQ(fib->calls, 2u * 177u);
+    EXPECT_EQ(spin->calls, 2u);
+
+    // main's time is its own plus its callees', and fib's recursion is
+    // counted once
+    EXPECT_GE(main->inclusive_ns, main->exclusive_ns + fib->inclusive_ns + spin->inclusive_ns);
+    EXPECT_LE(fib->inclusive_ns, main->inclusive_ns);
+    EXPECT_GE(fib->inclusive_ns, fib->exclusive_ns);
+    EXPECT_GT(spin->exclusive_ns, 0u);
+
+    toybox::utils::data_structures::DynamicString folded;
+    profiler.WriteFoldedStacks(&folded);
+    std::string text = folded.CStr();
+    EXPECT_NE(text.find("game:main;game:spin "), std::string::npos) << text;
+    EXPECT_NE(text.find("game:main;game:fib;game:fib;game:fib "), std::string::npos) << text;
+    EXPECT_EQ(text.find("game:spin;"), std::string::npos) << text;
+
+    profiler.Reset();
+    EXPECT_EQ(profiler.FunctionCount(), 0u);
+}
+
+TEST(ScriptProfilerTests, FailedCallsUnwindTheStack) {
+    ScriptingSystem system;
+    Script script = system.Load("game", kSource, strlen(kSource));
+    ScriptProfiler& profiler = system.Profiler();
+    profiler.SetMode(ProfileMode::Instrument);
+    Value argument = NumberValue(5);
+    Value result;
+    EXPECT_FALSE(system.Call(script, "broken", &argument, 1, &result));
+    EXPECT_EQ(profiler.Depth(), 0u);
+    EXPECT_EQ(FindProfile(profiler, "game:broken")->calls, 6u);
+    CallScript(system, script, "spin", 10);
+
+    // The next call starts from the root, not under the failed one
+    toybox::utils::data_structures::DynamicString folded;
+    profiler.WriteFoldedStacks(&folded);
+    std::string text = folded.CStr();
+    EXPECT_TRUE(text.compare(0, 10, "game:spin ") == 0 || text.find("\ngame:spin ") != std::string::npos) << text;
+}
+
+TEST(ScriptProfilerTests, SamplesLandInTheBusyFunction) {
+    ScriptingSystem system;
+    Script script = system.Load("game", kSource, strlen(kSource));
+    ScriptProfiler& profiler = system.Profiler();
+    profiler.SetMode(ProfileMode::Sample, 200);
+    // Keep going until a good number of samples is in, however fast this runs
+    for (int i = 0; i < 1000 && profiler.SampleCount() < 20; ++i) CallScript(system, script, "busy", 200);
+    profiler.SetMode(ProfileMode::Off);
+    EXPECT_GE(profiler.SampleCount(), 20u);
+
+    const FunctionProfile* busy = FindProfile(profiler, "game:busy");
+    const FunctionProfile* spin = FindProfile(profiler, "game:spin");
+    ASSERT_TRUE(busy && spin);
+    EXPECT_EQ(busy->samples + spin->samples, profiler.SampleCount());
+    EXPECT_GT(spin->samples, 0u);
+    EXPECT_EQ(busy->inclusive_ns, 0u);
+
+    std::string path = ::testing::TempDir() + "script_profile.folded";
+    ASSERT_TRUE(profiler.ExportFoldedStacks(path.c_str()));
+    toybox::utils::data_structures::DynamicArray<uint8_t> file;
+    ASSERT_TRUE(toybox::utils::io::ReadFile(path.c_str(), &file));
+    std::string text(reinterpret_cast<const char*>(file.Data()), file.Size());
+    EXPECT_NE(text.find("game:busy;game:spin "), std::string::npos) << text;
+
+    // Every line is a stack and a count
+    size_t lines = 0, at = 0;
+    uint64_t total = 0;
+    while (at < text.size()) {
+        size_t end = text.find('\n', at);
+        ASSERT_NE(end, std::string::npos);
+        size_t space = text.rfind(' ', end);
+        ASSERT_GT(space, at);
+        total += std::stoull(text.substr(space + 1, end - space - 1));
+        ++lines;
+        at = end + 1;
+    }
+    EXPECT_GE(lines, 1u);
+    EXPECT_EQ(total, profiler.SampleCount());
+}
@@ -0,0 +1,193 @@
+#include <gtest/gtest.h>
+#include "scripting_integration.h"
+
+#include <cstring>
+
+using namespace toybox::scripting;
+
+static const char* kSource = "fn add(a, b) { return [a[0] + b[0], a[1] + b[1]]; }\n"
+                             "fn sum(n) {\n"
+                             "    let total = [0, 0];\n"
+                             "    let i = 0;\n"
+                             "    while (i < n) { total = add(total, [i, 1]); i = i + 1; }\n"
+                             "    return total[0] + total[1];\n"
+                             "}\n"
+                             "fn pair(a, b) { return [[a], [b]]; }\n"
+                             "fn first(p) { return p[0][0] + p[1][0]; }\n"
+                             "fn make(n) { return array(n); }\n"
+                             "fn put(slots, i, value) { slots[i] = [value, [value * 2]]; }\n"
+                             "fn get(slots, i) { return slots[i][0] + slots[i][1][0]; }\n"
+                             "fn shapes() {\n"
+                             "    let a = [1, nil, true, [2]];\n"
+                             "    let b = a;\n"
+                             "    let empty = [];\n"
+                             "    b[1] = 5;\n"
+                             "    if (a != b || a == [1, 5, true, [2]]) { return -1; }\n"
+                             "    return a[1] + a[3][0] + len(a) * 10 + len(empty) + len(array(7)) * 100;\n"
+                             "}\n"
+                             "fn out_of_range() { let a = [1, 2]; return a[2]; }\n";
+
+static Script LoadHeapScript(ScriptingSystem& system) {
+    Script script = system.Load("heap", kSource, strlen(kSource));
+    EXPECT_NE(script, kNoScript) << system.Error();
+    return script;
+}
+
+static Value Call(ScriptingSystem& system, Script script, const char* function, const Value* arguments = nullptr,
+                  uint32_t count = 0) {
+    Value result = NilValue();
+    EXPECT_TRUE(system.Call(script, function, arguments, count, &result)) << system.Error();
+    return result;
+}
+
+TEST(ScriptHeapTests, ScriptsMakeAndIndexArrays) {
+    ScriptingSystem system;
+    Script script = LoadHeapScript(system);
+    EXPECT_EQ(Call(system, script, "shapes").number, 5.0 + 2.0 + 40.0 + 0.0 + 700.0);
+    Value n = NumberValue(100);
+    EXPECT_EQ(Call(system, script, "sum", &n, 1).number, 4950.0 + 100.0);
+
+    Value result;
+    EXPECT_FALSE(system.Call(script, "out_of_range", nullptr, 0, &result));
+    EXPECT_NE(strstr(system.Error(), "out of range"), nullptr) << system.Error();
+}
+
+TEST(ScriptHeapTests, UnreachableArraysDieWithTheFrame) {
+    ScriptingSystem system;
+    Script script = LoadHeapScript(system);
+    Value n = NumberValue(1000);
+    Call(system, script, "sum", &n, 1);
+    system.EndFrame();
+
+    ScriptHeapStats stats = system.Heap().Stats();
+    EXPECT_EQ(stats.frame_allocations, 2001u);
+    EXPECT_EQ(stats.minor_collections, 1u);
+    EXPECT_EQ(stats.promoted_objects, 0u);
+    EXPECT_EQ(stats.nursery_overflows, 0u);
+    EXPECT_EQ(stats.old_bytes, 0u);
+
+    // Steady frames take nothing more from the system
+    uint64_t system_allocations = stats.system_allocations;
+    for (int frame = 0; frame < 10; ++frame) {
+        Call(system, script, "sum", &n, 1);
+        system.EndFrame();
+    }
+    EXPECT_EQ(system.Heap().Stats().system_allocations, system_allocations);
+}
+
+TEST(ScriptHeapTests, RootedArraysArePromotedIntact) {
+    ScriptingSystem system;
+    Script script = LoadHeapScript(system);
+    Value arguments[2] = { NumberValue(3), NumberValue(4) };
+    Value kept = Call(system, script, "pair", arguments, 2);
+    ASSERT_EQ(kept.type, ValueType::Array);
+    system.Heap().AddRoot(&kept);
+    EXPECT_TRUE(system.Heap().IsYoung(kept.array));
+    system.EndFrame();
+
+    EXPECT_FALSE(system.Heap().IsYoung(kept.array));
+    EXPECT_EQ(system.Heap().Stats().promoted_objects, 3u);
+
+    // New arrays reuse the nursery without touching the promoted ones
+    Value n = NumberValue(1000);
+    for (int frame = 0; frame < 3; ++frame) {
+        Call(system, script, "sum", &n, 1);
+        system.EndFrame();
+    }
+    EXPECT_EQ(Call(system, script, "first", &kept, 1).number, 7.0);
+    EXPECT_EQ(system.Heap().Stats().promoted_objects, 3u);
+    system.Heap().RemoveRoot(&kept);
+}
+
+TEST(ScriptHeapTests, OldArraysKeepTheNurseryArraysStoredInThem) {
+    ScriptingSystem system;
+    Script script = LoadHeapScript(system);
+    Value size = NumberValue(8);
+    Value slots = Call(system, script, "make", &size, 1);
+    system.Heap().AddRoot(&slots);
+    system.EndFrame();
+    ASSERT_FALSE(system.Heap().IsYoung(slots.array));
+
+    // Only the old array refers to the new ones
+    for (int i = 0; i < 8; ++i) {
+        Value arguments[3] = { slots, NumberValue(i), NumberValue(i + 1) };
+        Call(system, script, "put", arguments, 3);
+    }
+    system.EndFrame();
+    Value n = NumberValue(1000);
+    Call(system, script, "sum", &n, 1);
+    system.EndFrame();
+
+    for (int i = 0; i < 8; ++i) {
+        Value arguments[2] = { slots, NumberValue(i) };
+        EXPECT_EQ(Call(system, script, "get", arguments, 2).number, 3.0 * (i + 1));
+    }
+    system.Heap().RemoveRoot(&slots);
+}
+
+TEST(ScriptHeapTests, AFullNurseryOverflowsIntoThePools) {
+    ScriptingSystem system;
+    Script script = LoadHeapScript(system);
+    system.Heap().SetNurseryBytes(4096);
+    Value size = NumberValue(4);
+    Value slots = Call(system, script, "make", &size, 1);
+    system.Heap().AddRoot(&slots);
+
+    // Fill the nursery so later arrays, slots' items among them, are made old
+    Value n = NumberValue(200);
+    Call(system, script, "sum", &n, 1);
+    for (int i = 0; i < 4; ++i) {
+        Value arguments[3] = { slots, NumberValue(i), NumberValue(i + 1) };
+        Call(system, script, "put", arguments, 3);
+    }
+    EXPECT_GT(system.Heap().Stats().nursery_overflows, 0u);
+    system.EndFrame();
+    for (int i = 0; i < 4; ++i) {
+        Value arguments[2] = { slots, NumberValue(i) };
+        EXPECT_EQ(Call(system, script, "get", arguments, 2).number, 3.0 * (i + 1));
+    }
+
+    // With no nursery every array goes to the pools
+    system.Heap().SetNurseryBytes(0);
+    uint64_t overflows = system.Heap().Stats().nursery_overflows;
+    EXPECT_EQ(Call(system, script, "sum", &n, 1).number, 19900.0 + 200.0);
+    EXPECT_EQ(system.Heap().Stats().nursery_overflows, overflows);
+    system.Heap().RemoveRoot(&slots);
+}
+
+TEST(ScriptHeapTests, MajorCollectionsFreeUnreachableOldArrays) {
+    ScriptingSystem system;
+    Script script = LoadHeapScript(system);
+    Value size = NumberValue(1000);
+    Value big = Call(system, script, "make", &size, 1);
+    Value arguments[2] = { NumberValue(1), NumberValue(2) };
+    Value small = Call(system, script, "pair", arguments, 2);
+    system.Heap().AddRoot(&big);
+    system.Heap().AddRoot(&small);
+    system.EndFrame();
+    ScriptHeapStats stats = system.Heap().Stats();
+    EXPECT_GT(stats.old_bytes, 1000u * sizeof(Value));
+
+    system.Heap().RemoveRoot(&big);
+    system.Heap().CollectAll();
+    stats = system.Heap().Stats();
+    EXPECT_EQ(stats.major_collections, 1u);
+    EXPECT_EQ(stats.freed_objects, 1u);
+    EXPECT_LT(stats.old_bytes, 1000u * sizeof(Value));
+    EXPECT_EQ(Call(system, script, "first", &small, 1).number, 3.0);
+
+    system.Heap().RemoveRoot(&small);
+    system.Heap().CollectAll();
+    stats = system.Heap().Stats();
+    EXPECT_EQ(stats.freed_objects, 4u);
+    EXPECT_EQ(stats.old_bytes, 0u);
+    EXPECT_GT(stats.max_pause_ns, 0u);
+
+    // Freed blocks are reused before the pools grow
+    uint64_t system_allocations = stats.system_allocations;
+    small = Call(system, script, "pair", arguments, 2);
+    system.Heap().AddRoot(&small);
+    system.EndFrame();
+    EXPECT_EQ(system.Heap().Stats().system_allocations, system_allocations);
+    system.Heap().RemoveRoot(&small);
+}
@@ -0,0 +1,233 @@
+#include <gtest/gtest.h>
+#include "script_work.h"
+
+#include <cstddef>
+#include <cstring>
+
+using namespace toybox::scripting;
+using toybox::ecs::Changed;
+using toybox::ecs::PartRegistry;
+using toybox::ecs::Toy;
+using toybox::ecs::WorkClock;
+using toybox::ecs::World;
+
+struct Position {
+    float x, y, z;
+};
+
+struct Velocity {
+    float x, y, z;
+};
+
+struct Health {
+    int32_t value;
+};
+
+struct Vec2 {
+    float x, y;
+};
+
+struct Body {
+    Vec2 centre;
+    double mass;
+    uint32_t flags;
+    float samples[3];
+};
+
+typedef PartRegistry<Position, Velocity, Health, Body> WorkParts;
+typedef World<WorkParts> WorkWorld;
+
+static const char* kMovement = "fn move(count, dt, px, py, vx, vy) {\n"
+                               "    let i = 0;\n"
+                               "    while (i < count) {\n"
+                               "        px[i] = px[i] + vx[i] * dt;\n"
+                               "        vy[i] = vy[i] - 10 * dt;\n"
+                               "        py[i] = py[i] + vy[i] * dt;\n"
+                               "        i = i + 1;\n"
+                               "    }\n"
+                               "}\n"
+                               "fn poison(count, amount, health) {\n"
+                               "    let i = 0;\n"
+                               "    while (i < count) { health[i] = health[i] - amount; i = i + 1; }\n"
+                               "}\n"
+                               "fn sneaky(count, px) { px[0] = 1; }\n"
+                               "fn past_end(count, px) { return px[count]; }\n";
+
+static Script LoadMovement(ScriptingSystem& system) {
+    return system.Load("movement", kMovement, strlen(kMovement));
+}
+
+TEST(ScriptWorkTests, ViewsIndexHostMemory) {
+    ScriptingSystem system;
+    const char* source = "fn sum(count, values) {\n"
+                         "    let total = 0;\n"
+                         "    let i = 0;\n"
+                         "    while (i < count) { total = total + values[i]; i = i + 1; }\n"
+                         "    return total;\n"
+                         "}\n"
+                         "fn double_all(count, values) {\n"
+                         "    let i = 0;\n"
+                         "    while (i < count) { values[i] = values[i] * 2; i = i + 1; }\n"
+                         "    return values[1] = values[0] + 1;\n"
+                         "}\n"
+                         "fn same(a, b) { return a == b; }\n";
+    Script script = system.Load("views", source, strlen(source));
+    ASSERT_NE(script, kNoScript) << system.Error();
+
+    // Every other double, to check the stride is honoured
+    double memory[8] = { 1, -1, 2, -1, 3, -1, 4, -1 };
+    ScriptView view = { reinterpret_cast<uint8_t*>(memory), 4, 2 * sizeof(double), ViewElement::Float64, false };
+    Value arguments[2] = { NumberValue(4), ViewValue(&view) };
+    Value result;
+    ASSERT_TRUE(system.Call(script, "sum", arguments, 2, &result)) << system.Error();
+    EXPECT_EQ(result.number, 10.0);
+    ASSERT_TRUE(system.Call(script, "double_all", arguments, 2, &result)) << system.Error();
+    EXPECT_EQ(result.number, 3.0);
+    EXPECT_EQ(memory[0], 2.0);
+    EXPECT_EQ(memory[2], 3.0);
+    EXPECT_EQ(memory[6], 8.0);
+    EXPECT_EQ(memory[7], -1.0);
+
+    Value pair[2] = { ViewValue(&view), ViewValue(&view) };
+    ASSERT_TRUE(system.Call(script, "same", pair, 2, &result));
+    EXPECT_TRUE(result.boolean);
+
+    view.read_only = true;
+    EXPECT_FALSE(system.Call(script, "double_all", arguments, 2, &result));
+    EXPECT_NE(strstr(system.Error(), "read-only"), nullptr) << system.Error();
+
+    arguments[0] = NumberValue(5);
+    EXPECT_FALSE(system.Call(script, "sum", arguments, 2, &result));
+    EXPECT_NE(strstr(system.Error(), "out of range"), nullptr) << system.Error();
+
+    // Only a view, or something indexing one, can be assigned to with []
+    const char* bad = "fn a(v) { v[0] + 1 = 2; }";
+    EXPECT_EQ(system.Load("bad", bad, strlen(bad)), kNoScript);
+    Value number[2] = { NumberValue(1), NumberValue(2) };
+    EXPECT_FALSE(system.Call(script, "sum", number, 2, &result));
+    EXPECT_NE(strstr(system.Error(), "views"), nullptr) << system.Error();
+}
+
+TEST(ScriptWorkTests, RunsOncePerBlockInPlace) {
+    WorkWorld world;
+    const uint32_t kCount = 5000;
+    for (uint32_t i = 0; i < kCount; ++i) {
+        Toy toy = world.Create();
+        world.Add<Position>(toy, Position{ float(i), 100.0f, 0.0f });
+        world.Add<Velocity>(toy, Velocity{ 1.0f, 0.0f, 0.0f });
+        // Half of them in a second group
+        if (i % 2 == 0) world.Add<Health>(toy, Health{ 100 });
+    }
+
+    ScriptingSystem system;
+    Script script = LoadMovement(system);
+    ASSERT_NE(script, kNoScript) << system.Error();
+    ScriptWork<WorkParts, Position, Velocity> movement(system, script, "move");
+    ASSERT_TRUE(movement.Valid());
+    movement.BindField(&Position::x);
+    movement.BindField(&Position::y);
+    movement.BindField(&Velocity::x);
+    movement.BindField(&Velocity::y);
+
+    Value dt = NumberValue(0.5);
+    ASSERT_TRUE(movement.Run(world, &dt, 1)) << system.Error();
+    EXPECT_EQ(movement.RowCount(), kCount);
+    EXPECT_GE(movement.BlockCount(), 2u);
+    EXPECT_LT(movement.BlockCount(), kCount / 10);
+
+    uint32_t checked = 0;
+    world.Each<const Position, const Velocity>(
+        [&checked](Toy toy, const Position& position, const Velocity& velocity) {
+            EXPECT_FLOAT_EQ(position.x, float(toy.index) + 0.5f);
+            EXPECT_FLOAT_EQ(velocity.y, -5.0f);
+            EXPECT_FLOAT_EQ(position.y, 97.5f);
+            EXPECT_EQ(position.z, 0.0f);
+            ++checked;
+        });
+    EXPECT_EQ(checked, kCount);
+
+    ScriptWork<WorkParts, Health> poison(system, script, "poison");
+    poison.BindField(&Health::value);
+    Value amount = NumberValue(7);
+    ASSERT_TRUE(poison.Run(world, &amount, 1)) << system.Error();
+    EXPECT_EQ(poison.RowCount(), kCount / 2);
+    world.Each<const Health>([](Toy, const Health& health) { EXPECT_EQ(health.value, 93); });
+
+    ScriptWork<WorkParts, Health> missing(system, script, "nope");
+    EXPECT_FALSE(missing.Valid());
+    EXPECT_FALSE(missing.Run(world));
+}
+
+TEST(ScriptWorkTests, ConstPartsAreReadOnlyAndWritesAreStamped) {
+    WorkWorld world;
+    for (uint32_t i = 0; i < 100; ++i) {
+        Toy toy = world.Create();
+        world.Add<Position>(toy, Position{ 0.0f, 0.0f, 0.0f });
+    }
+    ScriptingSystem system;
+    Script script = LoadMovement(system);
+
+    ScriptWork<WorkParts, const Position> reader(system, script, "sneaky");
+    reader.BindField(&Position::x);
+    EXPECT_FALSE(reader.Run(world));
+    EXPECT_NE(strstr(system.Error(), "read-only"), nullptr) << system.Error();
+    EXPECT_EQ(reader.BlockCount(), 1u);
+
+    ScriptWork<WorkParts, const Position> overrun(system, script, "past_end");
+    overrun.BindField(&Position::x);
+    EXPECT_FALSE(overrun.Run(world));
+
+    WorkClock clock;
+    uint32_t since = world.BeginWork(&clock);
+    ScriptWork<WorkParts, Position> writer(system, script, "sneaky");
+    writer.BindField(&Position::x);
+    ASSERT_TRUE(writer.Run(world, Changed<Position>{ since })) << system.Error();
+    EXPECT_EQ(writer.BlockCount(), 1u);
+    world.EndWork(&clock);
+
+    // Nothing written since the last run, so the filter skips the block
+    since = world.BeginWork(&clock);
+    ASSERT_TRUE(writer.Run(world, Changed<Position>{ since }));
+    EXPECT_EQ(writer.BlockCount(), 0u);
+    world.EndWork(&clock);
+}
+
+TEST(ScriptWorkTests, FieldsBindByMemberOrCheckedOffset) {
+    WorkWorld world;
+    for (uint32_t i = 0; i < 10; ++i) {
+        Toy toy = world.Create();
+        world.Add<Body>(toy, Body{ Vec2{ 0.0f, float(i) }, 1.5, 7u, { 0.0f, 0.0f, 0.0f } });
+    }
+    ScriptingSystem system;
+    const char* source = "fn weigh(count, y, mass, flags, last) {\n"
+                         "    let i = 0;\n"
+                         "    while (i < count) {\n"
+                         "        mass[i] = mass[i] * 2 + y[i];\n"
+                         "        flags[i] = flags[i] + 1;\n"
+                         "        last[i] = -y[i];\n"
+                         "        i = i + 1;\n"
+                         "    }\n"
+                         "}\n";
+    Script script = system.Load("weigh", source, strlen(source));
+    ASSERT_NE(script, kNoScript) << system.Error();
+
+    // Each member's type picks its element, so a double is read as one
+    ScriptWork<WorkParts, Body> weigh(system, script, "weigh");
+    weigh.BindField(&Body::centre, &Vec2::y);
+    weigh.BindField(&Body::mass);
+    weigh.BindField(&Body::flags);
+    weigh.BindField<Body>(offsetof(Body, samples) + 2 * sizeof(float), ViewElement::Float32);
+    ASSERT_TRUE(weigh.Run(world)) << system.Error();
+    EXPECT_EQ(weigh.RowCount(), 10u);
+    world.Each<const Body>([](Toy, const Body& body) {
+        EXPECT_EQ(body.mass, 3.0 + body.centre.y);
+        EXPECT_EQ(body.flags, 8u);
+        EXPECT_EQ(body.samples[2], -body.centre.y);
+        EXPECT_EQ(body.samples[1], 0.0f);
+        EXPECT_EQ(body.centre.x, 0.0f);
+    });
+
+    // A double starting in the Part's last four bytes would run past it
+    EXPECT_DEATH(weigh.BindField<Body>(sizeof(Body) - 4, ViewElement::Float64), "");
+    EXPECT_DEATH(weigh.BindField<Body>(offsetof(Body, flags) + 2, ViewElement::UInt32), "");
+}
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "scripting_integration.h"
+
+#include <cstring>
+#include <string>
+
+using namespace toybox::scripting;
+
+static Script LoadText(ScriptingSystem& system, const char* name, const char* source) {
+    return system.Load(name, source, strlen(source));
+}
+
+static double CallNumber(ScriptingSystem& system, Script script, const char* function, double a, double b = 0.0) {
+    Value arguments[2] = { NumberValue(a), NumberValue(b) };
+    Value result = NilValue();
+    EXPECT_TRUE(system.Call(script, function, arguments, 2, &result)) << system.Error();
+    EXPECT_EQ(result.type, ValueType::Number);
+    return result.number;
+}
+
+static bool Sum(void* context, const Value* arguments, uint32_t count, Value* result) {
+    ++*static_cast<int*>(context);
+    double total = 0.0;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (arguments[i].type != ValueType::Number) return false;
+        total += arguments[i].number;
+    }
+    *result = NumberValue(total);
+    return true;
+}
+
+TEST(ScriptingTests, ArithmeticAndControlFlow) {
+    ScriptingSystem system;
+    Script script = LoadText(system, "math",
+                             "// Functions may call ones defined later\n"
+                             "fn twice_fib(n) { return fib(n) * 2; }\n"
+                             "fn fib(n) {\n"
+                             "    if (n < 2) { return n; }\n"
+                             "    return fib(n - 1) + fib(n - 2);\n"
+                             "}\n"
+                             "fn count(n) {\n"
+                             "    let total = 0;\n"
+                             "    let i = 0;\n"
+                             "    while (i < n) {\n"
+                             "        if (i % 3 == 0 || i % 5 == 0) { total = total + i; }\n"
+                             "        else if (i == 7) { total = total - 1; }\n"
+                             "        i = i + 1;\n"
+                             "    }\n"
+                             "    return total;\n"
+                             "}\n"
+                             "fn logic(a, b) {\n"
+                             "    if (a > 0 && !(b >= 10)) { return -a; }\n"
+                             "    return (a + b) / 4;\n"
+                             "}\n"
+                             "fn nothing() { }\n");
+    ASSERT_NE(script, kNoScript) << system.Error();
+    EXPECT_EQ(CallNumber(system, script, "fib", 20), 6765.0);
+    EXPECT_EQ(CallNumber(system, script, "twice_fib", 10), 110.0);
+    EXPECT_EQ(CallNumber(system, script, "count", 16), 60.0 - 1.0);
+    EXPECT_EQ(CallNumber(system, script, "logic", 3, 2), -3.0);
+    EXPECT_EQ(CallNumber(system, script, "logic", 3, 13), 4.0);
+
+    Value result = NumberValue(1.0);
+    EXPECT_TRUE(system.Call(script, "nothing", nullptr, 0, &result));
+    EXPECT_EQ(result.type, ValueType::Nil);
+    EXPECT_EQ(system.Program(script).FunctionCount(), 5u);
+    EXPECT_EQ(system.FindFunction(script, "missing"), -1);
+}
+
+TEST(ScriptingTests, NativesAreBoundAtLoad) {
+    ScriptingSystem system;
+    int calls = 0;
+    system.RegisterNative("sum", Sum, &calls);
+    Script script = LoadText(system, "natives", "fn go(x) { return sum(x, 2, sum(3, 4)); }\n"
+                                                "fn bad() { return sum(true); }\n");
+    ASSERT_NE(script, kNoScript) << system.Error();
+    ASSERT_EQ(system.Program(script).ImportCount(), 1u);
+    EXPECT_STREQ(system.Program(script).ImportName(0), "sum");
+    EXPECT_EQ(CallNumber(system, script, "go", 1), 10.0);
+    EXPECT_EQ(calls, 2);
+
+    Value result;
+    EXPECT_FALSE(system.Call(script, "bad", nullptr, 0, &result));
+    EXPECT_NE(strstr(system.Error(), "sum"), nullptr);
+
+    EXPECT_EQ(LoadText(system, "unbound", "fn go() { return spawn(1); }"), kNoScript);
+    EXPECT_NE(strstr(system.Error(), "spawn"), nullptr);
+}
+
+TEST(ScriptingTests, ErrorsNameTheLine) {
+    ScriptingSystem system;
+    EXPECT_EQ(LoadText(system, "broken", "fn a() {\n  return 1;\n}\nfn b() {\n  return x;\n}\n"), kNoScript);
+    EXPECT_NE(strstr(system.Error(), "broken: line 5"), nullptr) << system.Error();
+    EXPECT_EQ(LoadText(system, "arity", "fn a(x) { return x; }\nfn b() { return a(1, 2); }"), kNoScript);
+    EXPECT_NE(strstr(system.Error(), "line 2"), nullptr) << system.Error();
+    EXPECT_EQ(LoadText(system, "twice", "fn a() { }\nfn a() { }"), kNoScript);
+    EXPECT_EQ(LoadText(system, "syntax", "fn a() { let = 3; }"), kNoScript);
+    EXPECT_EQ(system.ScriptCount(), 0u);
+
+    Script script = LoadText(system, "types", "fn add(a, b) { return a + b; }\nfn deep(n) { return deep(n + 1); }");
+    ASSERT_NE(script, kNoScript);
+    Value arguments[2] = { NumberValue(1.0), BoolValue(true) };
+    Value result;
+    EXPECT_FALSE(system.Call(script, "add", arguments, 2, &result));
+    EXPECT_NE(strstr(system.Error(), "'add'"), nullptr) << system.Error();
+    EXPECT_FALSE(system.Call(script, "deep", arguments, 1, &result));
+    EXPECT_NE(strstr(system.Error(), "nested"), nullptr) << system.Error();
+}
+
+TEST(ScriptingTests, DeepExpressionsCannotOverflowTheStack) {
+    ScriptingSystem system;
+    Script script = LoadText(system, "sized", "fn f(a, b) { return a + b * 2; }");
+    ASSERT_NE(script, kNoScript) << system.Error();
+    // Two locals, then a, b and 2 on top of them
+    EXPECT_EQ(system.Program(script).Function(0).max_stack, 5u);
+
+    // 1 + (1 + (...)) nested far past what the compiler will take
+    std::string source = "fn deep() { return ";
+    for (int i = 0; i < 5000; ++i) source += "1 + (";
+    source += "1";
+    source += std::string(5000, ')');
+    source += "; }";
+    EXPECT_EQ(LoadText(system, "deep", source.c_str()), kNoScript);
+    EXPECT_NE(strstr(system.Error(), "Nested too deeply"), nullptr) << system.Error();
+
+    source = "fn nested() { return ";
+    for (int i = 0; i < 150; ++i) source += "1 + (";
+    source += "1";
+    source += std::string(150, ')');
+    source += "; }";
+    script = LoadText(system, "nested", source.c_str());
+    ASSERT_NE(script, kNoScript) << system.Error();
+    Value result;
+    ASSERT_TRUE(system.Call(script, "nested", nullptr, 0, &result)) << system.Error();
+    EXPECT_EQ(result.number, 151.0);
+
+    // Arrays within arrays, each holding 254 items before the next, need
+    // more stack than the VM has in a single function
+    source = "fn wide() { return ";
+    for (int level = 0; level < 17; ++level) {
+        source += "[";
+        for (int i = 0; i < 254; ++i) source += "1, ";
+    }
+    source += "1";
+    source += std::string(17, ']');
+    source += "; }";
+    script = LoadText(system, "wide", source.c_str());
+    ASSERT_NE(script, kNoScript) << system.Error();
+    EXPECT_GT(uint32_t(system.Program(script).Function(0).max_stack), kScriptStackSize);
+    EXPECT_FALSE(system.Call(script, "wide", nullptr, 0, &result));
+    EXPECT_NE(strstr(system.Error(), "overflow"), nullptr) << system.Error();
+
+    // Recursion runs out of stack before it runs out of frames
+    source = "fn recurse(n) {\n";
+    for (int i = 0; i < 64; ++i) source += "    let l" + std::to_string(i) + " = n;\n";
+    source += "    return recurse(n + 1);\n}\n";
+    script = LoadText(system, "recurse", source.c_str());
+    ASSERT_NE(script, kNoScript) << system.Error();
+    Value argument = NumberValue(0.0);
+    EXPECT_FALSE(system.Call(script, "recurse", &argument, 1, &result));
+    EXPECT_NE(strstr(system.Error(), "overflow"), nullptr) << system.Error();
+}
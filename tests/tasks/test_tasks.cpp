@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include "task.h"
+#include "task_scheduler.h"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+using namespace toybox::utils::tasks;
+using toybox::utils::jobs::JobSystem;
+
+static void PumpUntil(JobSystem& jobs, TaskScheduler& scheduler, uint32_t remaining) {
+    while (scheduler.ActiveTasks() > remaining) {
+        if (!jobs.RunPendingJob()) std::this_thread::yield();
+        scheduler.RunPhase(FramePhase::Update);
+    }
+}
+
+static Task<int> Answer() {
+    co_return 42;
+}
+
+static Task<int> Add(int a, int b) {
+    int first = co_await Answer();
+    co_return first + a + b;
+}
+
+TEST(TasksTests, AwaitingTasksReturnsValues) {
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(0));
+    TaskScheduler scheduler(&jobs);
+
+    int result = 0;
+    scheduler.Spawn([](int* out) -> Task<void> {
+        *out = co_await Add(1, 2);
+    }(&result));
+
+    // Nothing suspends, so the task finishes inside Spawn
+    EXPECT_EQ(result, 45);
+    EXPECT_EQ(scheduler.ActiveTasks(), 0u);
+}
+
+TEST(TasksTests, TasksAreLazy) {
+    bool started = false;
+    {
+        Task<void> task = [](bool* flag) -> Task<void> {
+            *flag = true;
+            co_return;
+        }(&started);
+        EXPECT_TRUE(task.Valid());
+        EXPECT_FALSE(task.Done());
+    }
+    EXPECT_FALSE(started);
+}
+
+TEST(TasksTests, ResumesAtFramePhase) {
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(0));
+    TaskScheduler scheduler(&jobs);
+
+    int stage = 0;
+    scheduler.Spawn([](TaskScheduler* s, int* out) -> Task<void> {
+        *out = 1;
+        co_await s->OnMainThread(FramePhase::LateUpdate);
+        *out = 2;
+        co_await s->OnMainThread(FramePhase::LateUpdate);
+        *out = 3;
+    }(&scheduler, &stage));
+
+    EXPECT_EQ(stage, 1);
+    scheduler.RunPhase(FramePhase::Update);
+    EXPECT_EQ(stage, 1);
+
+    // Requeueing for the same phase waits for the next frame
+    scheduler.RunPhase(FramePhase::LateUpdate);
+    EXPECT_EQ(stage, 2);
+    scheduler.RunPhase(FramePhase::LateUpdate);
+    EXPECT_EQ(stage, 3);
+    EXPECT_EQ(scheduler.ActiveTasks(), 0u);
+}
+
+TEST(TasksTests, DelayWaitsForSchedulerClock) {
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(0));
+    TaskScheduler scheduler(&jobs);
+
+    bool woke = false;
+    scheduler.Spawn([](TaskScheduler* s, bool* flag) -> Task<void> {
+        co_await s->Delay(0.5);
+        *flag = true;
+    }(&scheduler, &woke));
+
+    for (int frame = 0; frame < 4; ++frame) {
+        scheduler.AdvanceTime(0.1);
+        scheduler.RunPhase(FramePhase::Update);
+    }
+    EXPECT_FALSE(woke);
+
+    scheduler.AdvanceTime(0.1);
+    scheduler.RunPhase(FramePhase::Update);
+    EXPECT_TRUE(woke);
+}
+
+TEST(TasksTests, ZeroDelayStillWaitsForItsPhase) {
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(0));
+    TaskScheduler scheduler(&jobs);
+
+    // Spawned outside any phase, so it has to wait for LateUpdate
+    int stage = 0;
+    scheduler.Spawn([](TaskScheduler* s, int* out) -> Task<void> {
+        co_await s->Delay(0.0, FramePhase::LateUpdate);
+        *out = 1;
+        // Already in LateUpdate: carries straight on
+        co_await s->Delay(0.0, FramePhase::LateUpdate);
+        *out = 2;
+        co_await s->Delay(0.0, FramePhase::Update);
+        *out = 3;
+    }(&scheduler, &stage));
+    EXPECT_EQ(stage, 0);
+
+    scheduler.RunPhase(FramePhase::Update);
+    EXPECT_EQ(stage, 0);
+    scheduler.RunPhase(FramePhase::LateUpdate);
+    EXPECT_EQ(stage, 2);
+    scheduler.RunPhase(FramePhase::Update);
+    EXPECT_EQ(stage, 3);
+    EXPECT_EQ(scheduler.ActiveTasks(), 0u);
+}
+
+TEST(TasksTests, HopsBetweenWorkerAndMainThread) {
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(2));
+    TaskScheduler scheduler(&jobs);
+
+    std::thread::id main_id = std::this_thread::get_id();
+    std::thread::id worker_id;
+    std::thread::id back_id;
+    scheduler.Spawn([](TaskScheduler* s, std::thread::id* worker, std::thread::id* back) -> Task<void> {
+        co_await s->OnWorker();
+        *worker = std::this_thread::get_id();
+        co_await s->OnMainThread(FramePhase::Update);
+        *back = std::this_thread::get_id();
+    }(&scheduler, &worker_id, &back_id));
+
+    PumpUntil(jobs, scheduler, 0);
+    EXPECT_EQ(back_id, main_id);
+    EXPECT_NE(worker_id, std::thread::id());
+}
+
+TEST(TasksTests, ReadsFiles) {
+    const char* path = "tasks_test_file.bin";
+    FILE* file = fopen(path, "wb");
+    ASSERT_NE(file, nullptr);
+    fwrite("toybox", 1, 6, file);
+    fclose(file);
+
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(1));
+    TaskScheduler scheduler(&jobs);
+
+    FileData found;
+    FileData missing;
+    scheduler.Spawn([](TaskScheduler* s, const char* p, FileData* out, FileData* none) -> Task<void> {
+        *out = co_await s->ReadFile(p);
+        *none = co_await s->ReadFile("does_not_exist.bin");
+        co_await s->OnMainThread(FramePhase::Update);
+    }(&scheduler, path, &found, &missing));
+
+    PumpUntil(jobs, scheduler, 0);
+    ASSERT_TRUE(found.ok);
+    ASSERT_EQ(found.bytes.Size(), 6u);
+    EXPECT_EQ(found.bytes.Data()[0], 't');
+    EXPECT_FALSE(missing.ok);
+    remove(path);
+}
+
+TEST(TasksTests, ThousandsOfTasksReuseFrames) {
+    JobSystem jobs;
+    ASSERT_TRUE(jobs.Init(3));
+    TaskScheduler scheduler(&jobs);
+
+    std::atomic<int> finished(0);
+    auto spawn_wave = [&]() {
+        for (int i = 0; i < 2000; ++i) {
+            scheduler.Spawn([](TaskScheduler* s, std::atomic<int>* done) -> Task<void> {
+                co_await s->OnWorker();
+                int value = co_await Answer();
+                co_await s->OnMainThread(FramePhase::EndFrame);
+                done->fetch_add(value == 42 ? 1 : 0);
+            }(&scheduler, &finished));
+        }
+        while (scheduler.ActiveTasks() > 0) {
+            jobs.RunPendingJob();
+            scheduler.RunPhase(FramePhase::EndFrame);
+        }
+    };
+
+    spawn_wave();
+    TaskFramePoolStats warmed = GetTaskFramePoolStats();
+    spawn_wave();
+    TaskFramePoolStats after = GetTaskFramePoolStats();
+
+    EXPECT_EQ(finished.load(), 4000);
+    EXPECT_EQ(after.frames_in_use, 0u);
+    // The second wave is served entirely from frames freed by the first
+    EXPECT_EQ(after.slab_allocations, warmed.slab_allocations);
+    EXPECT_EQ(after.oversize_allocations, 0u);
+}
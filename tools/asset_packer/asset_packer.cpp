@@ -0,0 +1,112 @@
+/*
+ * Toy Box: A Creative Engine for Imaginative and Quirky Games
+ *
+ * Licensed under the GNU General Public License, Version 3.
+ * For license details, visit: https://www.gnu.org/licenses/gpl-3.0.html
+ *
+ * Questions or contributions? Reach out to Simon Devenish:
+ * simon.devenish@outlook.com
+ */
+
+// Packs loose asset files into a Toy Box asset pack.
+//
+// Usage: AssetPacker [--compress fast|high] <output.pack> <file or directory>...
+//        AssetPacker --list <input.pack>
+//
+// Files in a directory are named by their path below it, with '/' between
+// the parts whatever the platform; files given on their own are named by
+// their file name. Assets go in sorted by name, so the same inputs always
+// make the same pack. With --compress, assets are stored compressed in
+// blocks wherever that makes them smaller.
+
+#include <algorithm>  // For std::sort
+#include <cstdio>     // For printf, fprintf
+#include <cstring>    // For strcmp
+#include <filesystem> // For std::filesystem
+#include <string>     // For std::string
+#include <utility>    // For std::pair
+#include <vector>     // For std::vector
+
+#include "asset_pack.h"
+
+namespace fs = std::filesystem;
+using toybox::assets::AssetCompression;
+using toybox::assets::AssetPack;
+using toybox::assets::AssetPackWriter;
+using toybox::assets::AssetSpan;
+
+static int Usage() {
+    fprintf(stderr, "Usage: AssetPacker [--compress fast|high] <output.pack> <file or directory>...\n"
+                    "       AssetPacker --list <input.pack>\n");
+    return 2;
+}
+
+static int List(const char* path) {
+    AssetPack pack;
+    if (!pack.Open(path)) {
+        fprintf(stderr, "%s is not an asset pack of version %u\n", path, toybox::assets::kAssetPackVersion);
+        return 1;
+    }
+    for (uint32_t i = 0; i < pack.AssetCount(); ++i) {
+        AssetSpan span = pack.Asset(i);
+        if (span.compressed) {
+            printf("%12llu  %s (%zu compressed)\n", (unsigned long long)span.raw_size, pack.AssetName(i), span.size);
+        } else {
+            printf("%12zu  %s\n", span.size, pack.AssetName(i));
+        }
+    }
+    printf("%u assets\n", pack.AssetCount());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && strcmp(argv[1], "--list") == 0) return List(argv[2]);
+    AssetCompression compression = AssetCompression::None;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "--compress") == 0) {
+        if (strcmp(argv[2], "fast") == 0) compression = AssetCompression::Fast;
+        else if (strcmp(argv[2], "high") == 0) compression = AssetCompression::High;
+        else return Usage();
+        first = 3;
+    }
+    if (argc - first < 2) return Usage();
+    const char* output = argv[first];
+
+    // (name, path)
+    std::vector<std::pair<std::string, std::string>> inputs;
+    for (int i = first + 1; i < argc; ++i) {
+        std::error_code error;
+        fs::path input(argv[i]);
+        if (fs::is_directory(input, error)) {
+            for (const fs::directory_entry& entry : fs::recursive_directory_iterator(input, error)) {
+                if (!entry.is_regular_file(error)) continue;
+                inputs.emplace_back(entry.path().lexically_relative(input).generic_string(), entry.path().string());
+            }
+        } else if (fs::is_regular_file(input, error)) {
+            inputs.emplace_back(input.filename().generic_string(), input.string());
+        } else {
+            fprintf(stderr, "No file or directory %s\n", argv[i]);
+            return 1;
+        }
+        if (error) {
+            fprintf(stderr, "Could not read %s: %s\n", argv[i], error.message().c_str());
+            return 1;
+        }
+    }
+    std::sort(inputs.begin(), inputs.end());
+
+    AssetPackWriter writer;
+    for (const auto& input : inputs) {
+        if (!writer.AddFile(input.first.c_str(), input.second.c_str(), compression)) {
+            fprintf(stderr, "%s\n", writer.Error());
+            return 1;
+        }
+    }
+    if (!writer.Write(output)) {
+        fprintf(stderr, "%s\n", writer.Error());
+        return 1;
+    }
+    printf("Packed %u assets, %llu bytes stored as %llu, into %s\n", writer.AssetCount(),
+           (unsigned long long)writer.RawSize(), (unsigned long long)writer.PayloadSize(), output);
+    return 0;
+}